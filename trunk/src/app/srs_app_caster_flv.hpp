@@ -21,7 +21,7 @@ class SrsPithyPrint;
 class ISrsHttpResponseReader;
 class SrsFlvDecoder;
 class SrsTcpClient;
-class SrsSimpleRtmpClient;
+class SrsCasterPublisher;
 class SrsAppCasterFlv;
 
 #include <srs_app_st.hpp>
@@ -81,7 +81,7 @@ private:
     ISrsResourceManager* manager;
     std::string output;
     SrsPithyPrint* pprint;
-    SrsSimpleRtmpClient* sdk;
+    SrsCasterPublisher* sdk;
     SrsTcpConnection* skt;
     SrsHttpConn* conn;
 private:
@@ -2348,7 +2348,7 @@ srs_error_t SrsConfig::check_normal_config()
             && n != "inotify_auto_reload" && n != "auto_reload_for_docker" && n != "tcmalloc_release_rate"
             && n != "query_latest_version" && n != "first_wait_for_qlv" && n != "threads"
             && n != "circuit_breaker" && n != "is_full" && n != "in_docker" && n != "tencentcloud_cls"
-            && n != "exporter"
+            && n != "exporter" && n != "handshake_key_rotation"
             ) {
             return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal directive %s", n.c_str());
         }
@@ -2603,7 +2603,8 @@ srs_error_t SrsConfig::check_normal_config()
                 for (int j = 0; j < (int)conf->directives.size(); j++) {
                     string m = conf->at(j)->name;
                     if (m != "enabled"  && m != "dvr_apply" && m != "dvr_path" && m != "dvr_plan"
-                        && m != "dvr_duration" && m != "dvr_wait_keyframe" && m != "time_jitter") {
+                        && m != "dvr_duration" && m != "dvr_wait_keyframe" && m != "time_jitter"
+                        && m != "dvr_mp4_fragment" && m != "dvr_mp4_faststart") {
                         return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.dvr.%s of %s", m.c_str(), vhost->arg0().c_str());
                     }
                 }
@@ -2626,7 +2627,7 @@ srs_error_t SrsConfig::check_normal_config()
                     string m = conf->at(j)->name;
                     if (m != "time_jitter" && m != "mix_correct" && m != "atc" && m != "atc_auto" && m != "mw_latency"
                         && m != "gop_cache" && m != "gop_cache_max_frames" && m != "queue_length" && m != "send_min_interval" && m != "reduce_sequence_header"
-                        && m != "mw_msgs") {
+                        && m != "mw_msgs" && m != "mw_adaptive" && m != "zerocopy") {
                         return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.play.%s of %s", m.c_str(), vhost->arg0().c_str());
                     }
                 }
@@ -2634,7 +2635,7 @@ srs_error_t SrsConfig::check_normal_config()
                 for (int j = 0; j < (int)conf->directives.size(); j++) {
                     string m = conf->at(j)->name;
                     if (m != "mode" && m != "origin" && m != "token_traverse" && m != "vhost" && m != "debug_srs_upnode" && m != "coworkers"
-                        && m != "origin_cluster" && m != "protocol" && m != "follow_client") {
+                        && m != "origin_cluster" && m != "protocol" && m != "follow_client" && m != "load_balance" && m != "parents") {
                         return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.cluster.%s of %s", m.c_str(), vhost->arg0().c_str());
                     }
                 }
@@ -2642,7 +2643,7 @@ srs_error_t SrsConfig::check_normal_config()
                 for (int j = 0; j < (int)conf->directives.size(); j++) {
                     string m = conf->at(j)->name;
                     if (m != "mr" && m != "mr_latency" && m != "firstpkt_timeout" && m != "normal_timeout"
-                        && m != "parse_sps" && m != "try_annexb_first" && m != "kickoff_for_idle") {
+                        && m != "parse_sps" && m != "try_annexb_first" && m != "kickoff_for_idle" && m != "mr_adaptive") {
                         return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.publish.%s of %s", m.c_str(), vhost->arg0().c_str());
                     }
                 }
@@ -2672,7 +2673,8 @@ srs_error_t SrsConfig::check_normal_config()
                 for (int j = 0; j < (int)conf->directives.size(); j++) {
                     string m = conf->at(j)->name;
                     if (m != "enabled" && m != "dash_fragment" && m != "dash_update_period" && m != "dash_timeshift" && m != "dash_path"
-                        && m != "dash_mpd_file" && m != "dash_window_size" && m != "dash_dispose" && m != "dash_cleanup") {
+                        && m != "dash_mpd_file" && m != "dash_window_size" && m != "dash_dispose" && m != "dash_cleanup"
+                        && m != "dash_low_latency" && m != "dash_chunk_duration") {
                         return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.dash.%s of %s", m.c_str(), vhost->arg0().c_str());
                     }
                 }
@@ -2697,7 +2699,7 @@ srs_error_t SrsConfig::check_normal_config()
                     string m = conf->at(j)->name;
                     if (m != "enabled" && m != "on_connect" && m != "on_close" && m != "on_publish"
                         && m != "on_unpublish" && m != "on_play" && m != "on_stop"
-                        && m != "on_dvr" && m != "on_hls" && m != "on_hls_notify") {
+                        && m != "on_dvr" && m != "on_hls" && m != "on_hls_notify" && m != "cache_ttl") {
                         return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.http_hooks.%s of %s", m.c_str(), vhost->arg0().c_str());
                     }
                 }
@@ -2720,7 +2722,7 @@ srs_error_t SrsConfig::check_normal_config()
                 for (int j = 0; j < (int)conf->directives.size(); j++) {
                     SrsConfDirective* trans = conf->at(j);
                     string m = trans->name.c_str();
-                    if (m != "enabled" && m != "ffmpeg" && m != "engine") {
+                    if (m != "enabled" && m != "ffmpeg" && m != "ladder" && m != "engine") {
                         return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.transcode.%s of %s", m.c_str(), vhost->arg0().c_str());
                     }
                     if (m == "engine") {
@@ -2744,7 +2746,8 @@ srs_error_t SrsConfig::check_normal_config()
                         && m != "bframe" && m != "aac" && m != "stun_timeout" && m != "stun_strict_check"
                         && m != "dtls_role" && m != "dtls_version" && m != "drop_for_pt" && m != "rtc_to_rtmp"
                         && m != "pli_for_rtmp" && m != "rtmp_to_rtc" && m != "keep_bframe" && m != "opus_bitrate"
-                        && m != "aac_bitrate" && m != "keep_avc_nalu_sei") {
+                        && m != "aac_bitrate" && m != "keep_avc_nalu_sei" && m != "bwe" && m != "pacer"
+                        && m != "jitter_for_rtmp" && m != "fec") {
                         return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.rtc.%s of %s", m.c_str(), vhost->arg0().c_str());
                     }
                 }
@@ -3296,6 +3299,20 @@ double SrsConfig::tcmalloc_release_rate()
     return trr;
 }
 
+srs_utime_t SrsConfig::get_handshake_key_rotation()
+{
+    SRS_OVERWRITE_BY_ENV_SECONDS("srs.handshake_key_rotation"); // SRS_HANDSHAKE_KEY_ROTATION
+
+    static srs_utime_t DEFAULT = 60 * SRS_UTIME_SECONDS;
+
+    SrsConfDirective* conf = root->get("handshake_key_rotation");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return srs_max(0, ::atoi(conf->arg0().c_str())) * SRS_UTIME_SECONDS;
+}
+
 srs_utime_t SrsConfig::get_threads_interval()
 {
     SRS_OVERWRITE_BY_ENV_SECONDS("srs.threads.interval"); // SRS_THREADS_INTERVAL
@@ -3320,6 +3337,82 @@ srs_utime_t SrsConfig::get_threads_interval()
     return v * SRS_UTIME_SECONDS;
 }
 
+int SrsConfig::get_threads_transcode()
+{
+    SRS_OVERWRITE_BY_ENV_INT("srs.threads.transcode"); // SRS_THREADS_TRANSCODE
+
+    static int DEFAULT = 2;
+
+    SrsConfDirective* conf = root->get("threads");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("transcode");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return srs_max(0, ::atoi(conf->arg0().c_str()));
+}
+
+int SrsConfig::get_threads_max_transcoders()
+{
+    SRS_OVERWRITE_BY_ENV_INT("srs.threads.max_transcoders"); // SRS_THREADS_MAX_TRANSCODERS
+
+    static int DEFAULT = 64;
+
+    SrsConfDirective* conf = root->get("threads");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("max_transcoders");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return srs_max(0, ::atoi(conf->arg0().c_str()));
+}
+
+int SrsConfig::get_threads_gb28181()
+{
+    SRS_OVERWRITE_BY_ENV_INT("srs.threads.gb28181"); // SRS_THREADS_GB28181
+
+    static int DEFAULT = 0;
+
+    SrsConfDirective* conf = root->get("threads");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("gb28181");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return srs_max(0, ::atoi(conf->arg0().c_str()));
+}
+
+int SrsConfig::get_threads_handshake()
+{
+    SRS_OVERWRITE_BY_ENV_INT("srs.threads.handshake"); // SRS_THREADS_HANDSHAKE
+
+    static int DEFAULT = 0;
+
+    SrsConfDirective* conf = root->get("threads");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("handshake");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return srs_max(0, ::atoi(conf->arg0().c_str()));
+}
+
 bool SrsConfig::get_circuit_breaker()
 {
     SRS_OVERWRITE_BY_ENV_BOOL2("srs.circuit_breaker.enabled"); // SRS_CIRCUIT_BREAKER_ENABLED
@@ -4679,6 +4772,35 @@ srs_utime_t SrsConfig::get_rtc_pli_for_rtmp(string vhost)
     return v;
 }
 
+srs_utime_t SrsConfig::get_rtc_jitter_for_rtmp(string vhost)
+{
+    static srs_utime_t DEFAULT = 1 * SRS_UTIME_SECONDS;
+    srs_utime_t v = 0;
+
+    if (!srs_getenv("srs.vhost.rtc.jitter_for_rtmp").empty()) { // SRS_VHOST_RTC_JITTER_FOR_RTMP
+        v = (srs_utime_t)(::atof(srs_getenv("srs.vhost.rtc.jitter_for_rtmp").c_str()) * SRS_UTIME_SECONDS);
+    } else {
+        SrsConfDirective* conf = get_rtc(vhost);
+        if (!conf) {
+            return DEFAULT;
+        }
+
+        conf = conf->get("jitter_for_rtmp");
+        if (!conf || conf->arg0().empty()) {
+            return DEFAULT;
+        }
+
+        v = (srs_utime_t)(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+    }
+
+    if (v < 50 * SRS_UTIME_MILLISECONDS || v > 10 * SRS_UTIME_SECONDS) {
+        srs_warn("Reset jitter %dms to %dms", srsu2msi(v), srsu2msi(DEFAULT));
+        return DEFAULT;
+    }
+
+    return v;
+}
+
 bool SrsConfig::get_rtc_nack_enabled(string vhost)
 {
     SRS_OVERWRITE_BY_ENV_BOOL2("srs.vhost.rtc.nack"); // SRS_VHOST_RTC_NACK
@@ -4736,6 +4858,63 @@ bool SrsConfig::get_rtc_twcc_enabled(string vhost)
     return SRS_CONF_PREFER_TRUE(conf->arg0());
 }
 
+bool SrsConfig::get_rtc_bwe_enabled(string vhost)
+{
+    SRS_OVERWRITE_BY_ENV_BOOL2("srs.vhost.rtc.bwe"); // SRS_VHOST_RTC_BWE
+
+    static bool DEFAULT = true;
+
+    SrsConfDirective* conf = get_rtc(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("bwe");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    return SRS_CONF_PREFER_TRUE(conf->arg0());
+}
+
+bool SrsConfig::get_rtc_pacer_enabled(string vhost)
+{
+    SRS_OVERWRITE_BY_ENV_BOOL2("srs.vhost.rtc.pacer"); // SRS_VHOST_RTC_PACER
+
+    static bool DEFAULT = true;
+
+    SrsConfDirective* conf = get_rtc(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("pacer");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    return SRS_CONF_PREFER_TRUE(conf->arg0());
+}
+
+bool SrsConfig::get_rtc_fec_enabled(string vhost)
+{
+    SRS_OVERWRITE_BY_ENV_BOOL("srs.vhost.rtc.fec"); // SRS_VHOST_RTC_FEC
+
+    static bool DEFAULT = false;
+
+    SrsConfDirective* conf = get_rtc(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("fec");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    return SRS_CONF_PREFER_FALSE(conf->arg0());
+}
+
 int SrsConfig::get_rtc_opus_bitrate(string vhost)
 {
     static int DEFAULT = 48000;
@@ -5291,6 +5470,78 @@ srs_utime_t SrsConfig::get_mr_sleep(string vhost)
     return (srs_utime_t)(::atoi(conf->arg0().c_str()) * SRS_UTIME_MILLISECONDS);
 }
 
+bool SrsConfig::get_mr_adaptive(string vhost)
+{
+    SRS_OVERWRITE_BY_ENV_BOOL("srs.vhost.publish.mr_adaptive"); // SRS_VHOST_PUBLISH_MR_ADAPTIVE
+
+    static bool DEFAULT = false;
+
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("publish");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("mr_adaptive");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return SRS_CONF_PREFER_FALSE(conf->arg0());
+}
+
+bool SrsConfig::get_mw_adaptive(string vhost)
+{
+    SRS_OVERWRITE_BY_ENV_BOOL("srs.vhost.play.mw_adaptive"); // SRS_VHOST_PLAY_MW_ADAPTIVE
+
+    static bool DEFAULT = false;
+
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("play");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("mw_adaptive");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return SRS_CONF_PREFER_FALSE(conf->arg0());
+}
+
+bool SrsConfig::get_zerocopy(string vhost)
+{
+    SRS_OVERWRITE_BY_ENV_BOOL("srs.vhost.play.zerocopy"); // SRS_VHOST_PLAY_ZEROCOPY
+
+    static bool DEFAULT = false;
+
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("play");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("zerocopy");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return SRS_CONF_PREFER_FALSE(conf->arg0());
+}
+
 srs_utime_t SrsConfig::get_mw_sleep(string vhost, bool is_rtc)
 {
     if (!srs_getenv("srs.vhost.play.mw_latency").empty()) { // SRS_VHOST_PLAY_MW_LATENCY
@@ -5775,6 +6026,25 @@ SrsConfDirective* SrsConfig::get_vhost_on_hls_notify(string vhost)
     return conf->get("on_hls_notify");
 }
 
+srs_utime_t SrsConfig::get_vhost_http_hooks_cache_ttl(string vhost)
+{
+    SRS_OVERWRITE_BY_ENV_SECONDS("srs.vhost.http_hooks.cache_ttl"); // SRS_VHOST_HTTP_HOOKS_CACHE_TTL
+
+    static srs_utime_t DEFAULT = 0;
+
+    SrsConfDirective* conf = get_vhost_http_hooks(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("cache_ttl");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return srs_utime_t(::atoi(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+}
+
 bool SrsConfig::get_vhost_is_edge(string vhost)
 {
     SrsConfDirective* conf = get_vhost(vhost);
@@ -5862,6 +6132,53 @@ bool SrsConfig::get_vhost_edge_follow_client(string vhost)
     return SRS_CONF_PREFER_FALSE(conf->arg0());
 }
 
+string SrsConfig::get_vhost_edge_load_balance(string vhost)
+{
+    static string DEFAULT = "round_robin";
+
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("cluster");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("load_balance");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return conf->arg0();
+}
+
+vector<string> SrsConfig::get_vhost_edge_parents(string vhost)
+{
+    vector<string> parents;
+
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return parents;
+    }
+
+    conf = conf->get("cluster");
+    if (!conf) {
+        return parents;
+    }
+
+    conf = conf->get("parents");
+    if (!conf) {
+        return parents;
+    }
+    for (int i = 0; i < (int)conf->args.size(); i++) {
+        parents.push_back(conf->args.at(i));
+    }
+
+    return parents;
+}
+
 bool SrsConfig::get_vhost_edge_token_traverse(string vhost)
 {
     static bool DEFAULT = false;
@@ -6045,6 +6362,22 @@ string SrsConfig::get_transcode_ffmpeg(SrsConfDirective* conf)
     return conf->arg0();
 }
 
+bool SrsConfig::get_transcode_ladder(SrsConfDirective* conf)
+{
+    static bool DEFAULT = false;
+
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("ladder");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return SRS_CONF_PREFER_FALSE(conf->arg0());
+}
+
 vector<SrsConfDirective*> SrsConfig::get_transcode_engines(SrsConfDirective* conf)
 {
     vector<SrsConfDirective*> engines;
@@ -6896,6 +7229,44 @@ srs_utime_t SrsConfig::get_dash_dispose(std::string vhost)
     return (srs_utime_t)(::atoi(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
 }
 
+bool SrsConfig::get_dash_low_latency(string vhost)
+{
+    SRS_OVERWRITE_BY_ENV_BOOL("srs.vhost.dash.dash_low_latency"); // SRS_VHOST_DASH_DASH_LOW_LATENCY
+
+    static bool DEFAULT = false;
+
+    SrsConfDirective* conf = get_dash(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("dash_low_latency");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return SRS_CONF_PREFER_FALSE(conf->arg0());
+}
+
+srs_utime_t SrsConfig::get_dash_chunk_duration(string vhost)
+{
+    SRS_OVERWRITE_BY_ENV_FLOAT_SECONDS("srs.vhost.dash.dash_chunk_duration"); // SRS_VHOST_DASH_DASH_CHUNK_DURATION
+
+    static srs_utime_t DEFAULT = 0;
+
+    SrsConfDirective* conf = get_dash(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("dash_chunk_duration");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return (srs_utime_t)(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+}
+
 SrsConfDirective* SrsConfig::get_hls(string vhost)
 {
     SrsConfDirective* conf = get_vhost(vhost);
@@ -7630,6 +8001,44 @@ bool SrsConfig::get_dvr_wait_keyframe(string vhost)
     return SRS_CONF_PREFER_TRUE(conf->arg0());
 }
 
+srs_utime_t SrsConfig::get_dvr_mp4_fragment(string vhost)
+{
+    SRS_OVERWRITE_BY_ENV_FLOAT_SECONDS("srs.vhost.dvr.dvr_mp4_fragment"); // SRS_VHOST_DVR_DVR_MP4_FRAGMENT
+
+    static srs_utime_t DEFAULT = 0;
+
+    SrsConfDirective* conf = get_dvr(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("dvr_mp4_fragment");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return (srs_utime_t)(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+}
+
+bool SrsConfig::get_dvr_mp4_faststart(string vhost)
+{
+    SRS_OVERWRITE_BY_ENV_BOOL2("srs.vhost.dvr.dvr_mp4_faststart"); // SRS_VHOST_DVR_DVR_MP4_FASTSTART
+
+    static bool DEFAULT = true;
+
+    SrsConfDirective* conf = get_dvr(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("dvr_mp4_faststart");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return SRS_CONF_PREFER_TRUE(conf->arg0());
+}
+
 int SrsConfig::get_dvr_time_jitter(string vhost)
 {
     if (!srs_getenv("srs.vhost.dvr.time_jitter").empty()) { // SRS_VHOST_DVR_TIME_JITTER
@@ -456,9 +456,15 @@ public:
     virtual bool auto_reload_for_docker();
     // For tcmalloc, get the release rate.
     virtual double tcmalloc_release_rate();
+    // The period to rotate the DH key pair of RTMP complex handshake.
+    virtual srs_utime_t get_handshake_key_rotation();
 // Thread pool section.
 public:
     virtual srs_utime_t get_threads_interval();
+    virtual int get_threads_transcode();
+    virtual int get_threads_max_transcoders();
+    virtual int get_threads_gb28181();
+    virtual int get_threads_handshake();
     virtual bool get_circuit_breaker();
     virtual int get_high_threshold();
     virtual int get_high_pulse();
@@ -545,9 +551,13 @@ public:
     int get_rtc_drop_for_pt(std::string vhost);
     bool get_rtc_to_rtmp(std::string vhost);
     srs_utime_t get_rtc_pli_for_rtmp(std::string vhost);
+    srs_utime_t get_rtc_jitter_for_rtmp(std::string vhost);
     bool get_rtc_nack_enabled(std::string vhost);
     bool get_rtc_nack_no_copy(std::string vhost);
     bool get_rtc_twcc_enabled(std::string vhost);
+    bool get_rtc_bwe_enabled(std::string vhost);
+    bool get_rtc_pacer_enabled(std::string vhost);
+    bool get_rtc_fec_enabled(std::string vhost);
     int get_rtc_opus_bitrate(std::string vhost);
     int get_rtc_aac_bitrate(std::string vhost);
 
@@ -633,6 +643,12 @@ public:
     // @param vhost, the vhost to get the mr sleep time.
     // TODO: FIXME: add utest for mr config.
     virtual srs_utime_t get_mr_sleep(std::string vhost);
+    // Whether tune the mr by the live bitrate, the mr_latency is the latency target.
+    virtual bool get_mr_adaptive(std::string vhost);
+    // Whether tune the mw by the live bitrate, the mw_latency is the latency target.
+    virtual bool get_mw_adaptive(std::string vhost);
+    // Whether send the large payload of messages by MSG_ZEROCOPY, for RTMP and HTTP-FLV players.
+    virtual bool get_zerocopy(std::string vhost);
     // Get the mw_latency, mw sleep time in srs_utime_t for vhost.
     // @param vhost, the vhost to get the mw sleep time.
     // TODO: FIXME: add utest for mw config.
@@ -751,6 +767,8 @@ public:
     // Get the on_hls_notify callbacks of vhost.
     // @return the on_hls_notify callback directive, the args is the url to callback.
     virtual SrsConfDirective* get_vhost_on_hls_notify(std::string vhost);
+    // Get the TTL to cache the decision of on_connect, on_publish and on_play, 0 to disable.
+    virtual srs_utime_t get_vhost_http_hooks_cache_ttl(std::string vhost);
 // vhost cluster section
 public:
     // Whether vhost is edge mode.
@@ -768,6 +786,10 @@ public:
     virtual std::string get_vhost_edge_protocol(std::string vhost);
     // Whether follow client protocol to connect to origin.
     virtual bool get_vhost_edge_follow_client(std::string vhost);
+    // Get the load balance algorithm to select origin, round_robin, p2c or hash.
+    virtual std::string get_vhost_edge_load_balance(std::string vhost);
+    // Get the HTTP APIs of parent edges, for multi-tier edge to discover the parent which is delivering stream.
+    virtual std::vector<std::string> get_vhost_edge_parents(std::string vhost);
     // Whether edge token tranverse is enabled,
     // If  true, edge will send connect origin to verfy the token of client.
     // For example, we verify all clients on the origin FMS by server-side as,
@@ -805,6 +827,8 @@ public:
     virtual bool get_transcode_enabled(SrsConfDirective* conf);
     // Get the ffmpeg tool path of transcode.
     virtual std::string get_transcode_ffmpeg(SrsConfDirective* conf);
+    // Whether transcode all engines by one ffmpeg, which decodes the input once.
+    virtual bool get_transcode_ladder(SrsConfDirective* conf);
     // Get the engines of transcode.
     virtual std::vector<SrsConfDirective*> get_transcode_engines(SrsConfDirective* conf);
     // Whether the engine is enabled.
@@ -925,6 +949,10 @@ public:
     virtual bool get_dash_cleanup(std::string vhost);
     // The timeout in srs_utime_t to dispose the dash.
     virtual srs_utime_t get_dash_dispose(std::string vhost);
+    // Whether LL-DASH is enabled, to write CMAF chunks and serve the in-progress segment.
+    virtual bool get_dash_low_latency(std::string vhost);
+    // The duration of CMAF chunk in srs_utime_t, 0 for a chunk per frame.
+    virtual srs_utime_t get_dash_chunk_duration(std::string vhost);
 // hls section
 private:
     // Get the hls directive of vhost.
@@ -1020,6 +1048,10 @@ public:
     virtual srs_utime_t get_dvr_duration(std::string vhost);
     // Whether wait keyframe to reap segment.
     virtual bool get_dvr_wait_keyframe(std::string vhost);
+    // For DVR MP4, get the duration of fragment to write fMP4, zero to write classic MP4.
+    virtual srs_utime_t get_dvr_mp4_fragment(std::string vhost);
+    // For DVR fMP4, whether finalize to classic MP4 with moov before mdat in background.
+    virtual bool get_dvr_mp4_faststart(std::string vhost);
     // Get the time_jitter algorithm for dvr.
     virtual int get_dvr_time_jitter(std::string vhost);
 // http api section
@@ -465,6 +465,29 @@ srs_error_t SrsTcpConnection::set_tcp_nodelay(bool v)
 }
 
 srs_error_t SrsTcpConnection::set_socket_buffer(srs_utime_t buffer_v)
+{
+    // the bytes:
+    //      4KB=4096, 8KB=8192, 16KB=16384, 32KB=32768, 64KB=65536,
+    //      128KB=131072, 256KB=262144, 512KB=524288
+    // the buffer should set to sleep*kbps/8,
+    // for example, your system delivery stream in 1000kbps,
+    // sleep 800ms for small bytes, the buffer should set to:
+    //      800*1000/8=100000B(about 128KB).
+    // other examples:
+    //      2000*3000/8=750000B(about 732KB).
+    //      2000*5000/8=1250000B(about 1220KB).
+    int kbps = 4000;
+    int size = srsu2ms(buffer_v) * kbps / 8;
+
+    // override the send buffer by macro.
+#ifdef SRS_PERF_SO_SNDBUF_SIZE
+    size = SRS_PERF_SO_SNDBUF_SIZE;
+#endif
+
+    return set_socket_buffer_size(size);
+}
+
+srs_error_t SrsTcpConnection::set_socket_buffer_size(int size)
 {
     srs_error_t err = srs_success;
 
@@ -482,26 +505,8 @@ srs_error_t SrsTcpConnection::set_socket_buffer(srs_utime_t buffer_v)
     return err;
 #endif
 
-    // the bytes:
-    //      4KB=4096, 8KB=8192, 16KB=16384, 32KB=32768, 64KB=65536,
-    //      128KB=131072, 256KB=262144, 512KB=524288
-    // the buffer should set to sleep*kbps/8,
-    // for example, your system delivery stream in 1000kbps,
-    // sleep 800ms for small bytes, the buffer should set to:
-    //      800*1000/8=100000B(about 128KB).
-    // other examples:
-    //      2000*3000/8=750000B(about 732KB).
-    //      2000*5000/8=1250000B(about 1220KB).
-    int kbps = 4000;
-    int iv = srsu2ms(buffer_v) * kbps / 8;
-
     // socket send buffer, system will double it.
-    iv = iv / 2;
-
-    // override the send buffer by macro.
-#ifdef SRS_PERF_SO_SNDBUF_SIZE
-    iv = SRS_PERF_SO_SNDBUF_SIZE / 2;
-#endif
+    int iv = size / 2;
 
     // set the socket send buffer when required larger buffer
     if (setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &iv, nb_v) < 0) {
@@ -511,11 +516,21 @@ srs_error_t SrsTcpConnection::set_socket_buffer(srs_utime_t buffer_v)
         return srs_error_new(ERROR_SOCKET_SNDBUF, "getsockopt fd=%d, r0=%d", fd, r0);
     }
 
-    srs_trace("set fd=%d, SO_SNDBUF=%d=>%d, buffer=%dms", fd, ov, iv, srsu2ms(buffer_v));
+    srs_trace("set fd=%d, SO_SNDBUF=%d=>%d, size=%d", fd, ov, iv, size);
 
     return err;
 }
 
+srs_error_t SrsTcpConnection::enable_zerocopy(int min_bytes)
+{
+    return skt->enable_zerocopy(min_bytes);
+}
+
+SrsZerocopySender* SrsTcpConnection::zerocopy()
+{
+    return skt->zerocopy();
+}
+
 void SrsTcpConnection::set_recv_timeout(srs_utime_t tm)
 {
     skt->set_recv_timeout(tm);
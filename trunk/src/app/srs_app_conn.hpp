@@ -218,6 +218,12 @@ public:
     virtual srs_error_t set_tcp_nodelay(bool v);
     // Set socket option SO_SNDBUF in srs_utime_t.
     virtual srs_error_t set_socket_buffer(srs_utime_t buffer_v);
+    // Set socket option SO_SNDBUF in bytes.
+    virtual srs_error_t set_socket_buffer_size(int size);
+    // Enable MSG_ZEROCOPY for writev larger than min_bytes.
+    virtual srs_error_t enable_zerocopy(int min_bytes);
+    // Get the zero-copy sender, NULL if disabled.
+    virtual SrsZerocopySender* zerocopy();
 // Interface ISrsProtocolReadWriter
 public:
     virtual void set_recv_timeout(srs_utime_t tm);
@@ -63,6 +63,18 @@ SrsJsonAny* SrsCoWorkers::dumps(string vhost, string coworker, string app, strin
         }
     }
 
+    // The HTTP stream port, for multi-tier edge to pull stream over HTTP-FLV.
+    int http_port = 0;
+    if (_srs_config->get_http_stream_enabled()) {
+        string http_host;
+        string http_hostport = _srs_config->get_http_stream_listen();
+        if (http_hostport.find(":") != string::npos) {
+            srs_parse_hostport(http_hostport, http_host, http_port);
+        } else {
+            http_port = ::atoi(http_hostport.c_str());
+        }
+    }
+
     // The ip of server, we use the request coworker-host as ip, if listen host is localhost or loopback.
     // For example, the server may behind a NAT(192.x.x.x), while its ip is a docker ip(172.x.x.x),
     // we should use the NAT(192.x.x.x) address as it's the exposed ip.
@@ -99,6 +111,7 @@ SrsJsonAny* SrsCoWorkers::dumps(string vhost, string coworker, string app, strin
     return SrsJsonAny::object()
         ->set("ip", SrsJsonAny::str(service_ip.c_str()))
         ->set("port", SrsJsonAny::integer(listen_port))
+        ->set("http", SrsJsonAny::integer(http_port))
         ->set("vhost", SrsJsonAny::str(r->vhost.c_str()))
         ->set("api", SrsJsonAny::str(backend.c_str()))
         ->set("routers", routers);
@@ -71,6 +71,9 @@ SrsFragmentedMp4::SrsFragmentedMp4()
 {
     fw = new SrsFileWriter();
     enc = new SrsMp4M2tsSegmentEncoder();
+    low_latency_ = false;
+    chunk_duration_ = 0;
+    chunk_dts_ = -1;
 }
 
 SrsFragmentedMp4::~SrsFragmentedMp4()
@@ -93,6 +96,9 @@ srs_error_t SrsFragmentedMp4::initialize(SrsRequest* r, bool video, int64_t time
 
     string home = _srs_config->get_dash_path(r->vhost);
     set_path(home + "/" + file_home + "/" + file_name);
+
+    low_latency_ = _srs_config->get_dash_low_latency(r->vhost);
+    chunk_duration_ = _srs_config->get_dash_chunk_duration(r->vhost);
     // Set number of the fragment, use in mpd SegmentTemplate@startNumber later.
     set_number(sequence_number);
     
@@ -115,6 +121,28 @@ srs_error_t SrsFragmentedMp4::initialize(SrsRequest* r, bool video, int64_t time
 srs_error_t SrsFragmentedMp4::write(SrsSharedPtrMessage* shared_msg, SrsFormat* format)
 {
     srs_error_t err = srs_success;
+
+    if (!shared_msg->is_audio() && !shared_msg->is_video()) {
+        return err;
+    }
+
+    // For LL-DASH, write the cached samples as a CMAF chunk, because the duration of last sample
+    // is known now, then flush it to the tmp file, which is served by HTTP chunked transfer.
+    if (low_latency_) {
+        if (chunk_dts_ >= 0 && (shared_msg->timestamp - chunk_dts_) * SRS_UTIME_MILLISECONDS >= chunk_duration_) {
+            if ((err = enc->write_chunk(shared_msg->timestamp)) != srs_success) {
+                return srs_error_wrap(err, "write chunk, dts=%" PRId64, shared_msg->timestamp);
+            }
+            if ((err = fw->flush()) != srs_success) {
+                return srs_error_wrap(err, "flush chunk");
+            }
+            chunk_dts_ = -1;
+        }
+
+        if (chunk_dts_ < 0) {
+            chunk_dts_ = shared_msg->timestamp;
+        }
+    }
     
     if (shared_msg->is_audio()) {
         uint8_t* sample = (uint8_t*)format->raw;
@@ -132,8 +160,6 @@ srs_error_t SrsFragmentedMp4::write(SrsSharedPtrMessage* shared_msg, SrsFormat*
         uint8_t* sample = (uint8_t*)format->raw;
         uint32_t nb_sample = (uint32_t)format->nb_raw;
         err = enc->write_sample(SrsMp4HandlerTypeVIDE, frame_type, dts, pts, sample, nb_sample);
-    } else {
-        return err;
     }
     
     append(shared_msg->timestamp);
@@ -168,6 +194,9 @@ SrsMpdWriter::SrsMpdWriter()
 
     video_number_ = 0;
     audio_number_ = 0;
+
+    low_latency_ = false;
+    chunk_duration_ = 0;
 }
 
 SrsMpdWriter::~SrsMpdWriter()
@@ -204,9 +233,12 @@ srs_error_t SrsMpdWriter::on_publish()
     string mpd_path = srs_path_build_stream(mpd_file, req->vhost, req->app, req->stream);
     fragment_home = srs_path_dirname(mpd_path) + "/" + req->stream;
     window_size_ = _srs_config->get_dash_window_size(r->vhost);
+    low_latency_ = _srs_config->get_dash_low_latency(r->vhost);
+    chunk_duration_ = _srs_config->get_dash_chunk_duration(r->vhost);
 
-    srs_trace("DASH: Config fragment=%dms, period=%dms, window=%d, timeshit=%dms, home=%s, mpd=%s",
-        srsu2msi(fragment), srsu2msi(update_period), window_size_, srsu2msi(timeshit), home.c_str(), mpd_file.c_str());
+    srs_trace("DASH: Config fragment=%dms, period=%dms, window=%d, timeshit=%dms, home=%s, mpd=%s, ll=%d, chunk=%dms",
+        srsu2msi(fragment), srsu2msi(update_period), window_size_, srsu2msi(timeshit), home.c_str(), mpd_file.c_str(),
+        low_latency_, srsu2msi(chunk_duration_));
 
     return srs_success;
 }
@@ -236,6 +268,14 @@ srs_error_t SrsMpdWriter::write(SrsFormat* format, SrsFragmentWindow* afragments
 
     double last_duration = srsu2s(srs_max(vfragments->at(vfragments->size() - 1)->duration(), afragments->at(afragments->size() - 1)->duration()));
 
+    // For LL-DASH, the segment is available once its first chunk is written, so player is able to request
+    // the in-progress segment earlier, which is served by HTTP chunked transfer.
+    string ll_attrs;
+    if (low_latency_) {
+        double offset = srs_max(0.0, last_duration - srsu2s(chunk_duration_));
+        ll_attrs = "availabilityTimeOffset=\"" + srs_fmt("%.3f", offset) + "\" availabilityTimeComplete=\"false\" ";
+    }
+
     stringstream ss;
     ss << "<?xml version=\"1.0\" encoding=\"utf-8\"?>" << endl
        << "<MPD profiles=\"urn:mpeg:dash:profile:isoff-live:2011,http://dashif.org/guidelines/dash-if-simple\" " << endl
@@ -257,7 +297,7 @@ srs_error_t SrsMpdWriter::write(SrsFormat* format, SrsFragmentWindow* afragments
         ss << "        <AdaptationSet mimeType=\"audio/mp4\" segmentAlignment=\"true\" startWithSAP=\"1\">" << endl;
         ss << "            <Representation id=\"audio\" bandwidth=\"48000\" codecs=\"mp4a.40.2\">" << endl;
         ss << "                <SegmentTemplate initialization=\"$RepresentationID$-init.mp4\" "
-                                            << "media=\"$RepresentationID$-$Number$.m4s\" "
+                                            << "media=\"$RepresentationID$-$Number$.m4s\" " << ll_attrs
                                             << "startNumber=\"" << afragments->at(start_index)->number() << "\" "
                                             << "timescale=\"1000\">" << endl;
         ss << "                    <SegmentTimeline>" << endl;
@@ -278,7 +318,7 @@ srs_error_t SrsMpdWriter::write(SrsFormat* format, SrsFragmentWindow* afragments
         ss << "        <AdaptationSet mimeType=\"video/mp4\" segmentAlignment=\"true\" startWithSAP=\"1\">" << endl;
         ss << "            <Representation id=\"video\" bandwidth=\"800000\" codecs=\"avc1.64001e\" " << "width=\"" << w << "\" height=\"" << h << "\">" << endl;
         ss << "                <SegmentTemplate initialization=\"$RepresentationID$-init.mp4\" "
-                                            << "media=\"$RepresentationID$-$Number$.m4s\" "
+                                            << "media=\"$RepresentationID$-$Number$.m4s\" " << ll_attrs
                                             << "startNumber=\"" << vfragments->at(start_index)->number() << "\" "
                                             << "timescale=\"1000\">" << endl;
         ss << "                    <SegmentTimeline>" << endl;
@@ -292,6 +332,10 @@ srs_error_t SrsMpdWriter::write(SrsFormat* format, SrsFragmentWindow* afragments
         ss << "        </AdaptationSet>" << endl;
     }
     ss << "    </Period>" << endl;
+    // For LL-DASH, player should sync its clock with SRS, see SrsGoApiUtcTiming.
+    if (low_latency_) {
+        ss << "    <UTCTiming schemeIdUri=\"urn:mpeg:dash:utc:http-iso:2014\" value=\"/api/v1/utc\" />" << endl;
+    }
     ss << "</MPD>" << endl;
 
     SrsUniquePtr<SrsFileWriter> fw(new SrsFileWriter());
@@ -43,6 +43,13 @@ class SrsFragmentedMp4 : public SrsFragment
 private:
     SrsFileWriter* fw;
     SrsMp4M2tsSegmentEncoder* enc;
+private:
+    // Whether write CMAF chunks for LL-DASH.
+    bool low_latency_;
+    // The duration of CMAF chunk in srs_utime_t, 0 for a chunk per frame.
+    srs_utime_t chunk_duration_;
+    // The dts in ms of first sample in current chunk, -1 if no sample.
+    int64_t chunk_dts_;
 public:
     SrsFragmentedMp4();
     virtual ~SrsFragmentedMp4();
@@ -50,6 +57,8 @@ public:
     // Initialize the fragment, create the home dir, open the file.
     virtual srs_error_t initialize(SrsRequest* r, bool video, int64_t time, SrsMpdWriter* mpd, uint32_t tid);
     // Write media message to fragment.
+    // @remark For LL-DASH, the cached samples are written as a chunk and flushed to file, when the
+    //      chunk duration is reached.
     virtual srs_error_t write(SrsSharedPtrMessage* shared_msg, SrsFormat* format);
     // Reap the fragment, close the fd and rename tmp to official file.
     virtual srs_error_t reap(uint64_t& dts);
@@ -79,6 +88,10 @@ private:
     uint64_t video_number_;
     // The number of current audio segment.
     uint64_t audio_number_;
+    // Whether LL-DASH is enabled.
+    bool low_latency_;
+    // The duration of CMAF chunk in srs_utime_t, for LL-DASH.
+    srs_utime_t chunk_duration_;
 private:
     // The home for fragment, relative to home.
     std::string fragment_home;
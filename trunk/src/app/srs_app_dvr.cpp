@@ -7,6 +7,8 @@
 #include <srs_app_dvr.hpp>
 
 #include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
 #include <sstream>
 #include <algorithm>
 using namespace std;
@@ -190,6 +192,11 @@ srs_error_t SrsDvrSegmenter::close()
     return err;
 }
 
+srs_error_t SrsDvrSegmenter::on_reap_segment(ISrsAsyncCallTask* on_dvr)
+{
+    return _srs_dvr_async->execute(on_dvr);
+}
+
 string SrsDvrSegmenter::generate_path()
 {
     // the path in config, for example,
@@ -421,11 +428,14 @@ srs_error_t SrsDvrFlvSegmenter::close_encoder()
 SrsDvrMp4Segmenter::SrsDvrMp4Segmenter()
 {
     enc = new SrsMp4Encoder();
+    idx = new SrsFileWriter();
+    finalize_ = false;
 }
 
 SrsDvrMp4Segmenter::~SrsDvrMp4Segmenter()
 {
     srs_freep(enc);
+    srs_freep(idx);
 }
 
 srs_error_t SrsDvrMp4Segmenter::refresh_metadata()
@@ -433,14 +443,54 @@ srs_error_t SrsDvrMp4Segmenter::refresh_metadata()
     return srs_success;
 }
 
+srs_error_t SrsDvrMp4Segmenter::close()
+{
+    srs_error_t err = srs_success;
+
+    // Only finalize the fMP4 with sample index, after renamed to the final path.
+    finalize_ = fs->is_open() && idx->is_open();
+    err = SrsDvrSegmenter::close();
+    finalize_ = false;
+
+    if (err != srs_success) {
+        return srs_error_wrap(err, "close");
+    }
+
+    return err;
+}
+
+srs_error_t SrsDvrMp4Segmenter::on_reap_segment(ISrsAsyncCallTask* on_dvr)
+{
+    // Fire the on_dvr event after the fMP4 is finalized, so the callback never gets an incomplete file.
+    if (finalize_) {
+        _srs_dvr_mp4_finalizer->finalize(fragment->fullpath(), on_dvr);
+        return srs_success;
+    }
+
+    return SrsDvrSegmenter::on_reap_segment(on_dvr);
+}
+
 srs_error_t SrsDvrMp4Segmenter::open_encoder()
 {
     srs_error_t err = srs_success;
     
     srs_freep(enc);
     enc = new SrsMp4Encoder();
+
+    // For fMP4, write the sample index when finalize it to classic MP4.
+    srs_utime_t duration = _srs_config->get_dvr_mp4_fragment(req->vhost);
+    if (duration > 0 && _srs_config->get_dvr_mp4_faststart(req->vhost)) {
+        string index = fragment->fullpath() + ".idx";
+        if ((err = idx->open(index)) != srs_success) {
+            return srs_error_wrap(err, "open index %s", index.c_str());
+        }
+
+        if ((err = idx->set_iobuf_size(SRS_FWRITE_CACHE_SIZE)) != srs_success) {
+            return srs_error_wrap(err, "set iobuf size for index %s", index.c_str());
+        }
+    }
     
-    if ((err = enc->initialize(fs)) != srs_success) {
+    if ((err = enc->initialize(fs, duration, idx->is_open()? idx : NULL)) != srs_success) {
         return srs_error_wrap(err, "init encoder");
     }
     
@@ -510,13 +560,257 @@ srs_error_t SrsDvrMp4Segmenter::close_encoder()
 {
     srs_error_t err = srs_success;
     
-    if ((err = enc->flush()) != srs_success) {
+    err = enc->flush();
+    idx->close(); // Always close the index.
+    if (err != srs_success) {
         return srs_error_wrap(err, "flush encoder");
     }
     
     return err;
 }
 
+// The max number of tasks in finalizer.
+#define SRS_DVR_MP4_FINALIZE_TASKS 1024
+// The max time for finalizer thread to wait for tasks.
+#define SRS_DVR_MP4_FINALIZE_WAIT (1 * SRS_UTIME_SECONDS)
+// The interval for ST thread to consume the finalized tasks.
+#define SRS_DVR_MP4_FINALIZE_INTERVAL (100 * SRS_UTIME_MILLISECONDS)
+
+SrsDvrMp4FinalizeTask::SrsDvrMp4FinalizeTask(string p, ISrsAsyncCallTask* t)
+{
+    path = p;
+    on_dvr = t;
+    err = srs_success;
+}
+
+SrsDvrMp4FinalizeTask::~SrsDvrMp4FinalizeTask()
+{
+    srs_freep(on_dvr);
+    srs_freep(err);
+}
+
+SrsDvrMp4Finalizer::SrsDvrMp4Finalizer()
+{
+    started_ = false;
+    entry_ = NULL;
+    cond_ = new SrsThreadCond();
+    quit_ = 0;
+    tasks_ = new SrsThreadQueue<SrsDvrMp4FinalizeTask*>(SRS_DVR_MP4_FINALIZE_TASKS);
+    done_ = new SrsThreadQueue<SrsDvrMp4FinalizeTask*>(SRS_DVR_MP4_FINALIZE_TASKS);
+    nn_inflight_ = 0;
+    trd_ = new SrsDummyCoroutine();
+}
+
+SrsDvrMp4Finalizer::~SrsDvrMp4Finalizer()
+{
+    stop();
+
+    SrsDvrMp4FinalizeTask* task = NULL;
+    while (done_->pop(task)) {
+        srs_freep(task);
+    }
+
+    srs_freep(trd_);
+    srs_freep(tasks_);
+    srs_freep(done_);
+    srs_freep(cond_);
+}
+
+void SrsDvrMp4Finalizer::finalize(string path, ISrsAsyncCallTask* on_dvr)
+{
+    if (!started_) {
+        started_ = true;
+        start_thread();
+    }
+
+    SrsDvrMp4FinalizeTask* task = new SrsDvrMp4FinalizeTask(path, on_dvr);
+
+    // Finalize in finalizer thread, which never writes log, the ST thread consumes the result.
+    if (entry_ && nn_inflight_ < SRS_DVR_MP4_FINALIZE_TASKS && tasks_->push(task)) {
+        nn_inflight_++;
+        cond_->signal();
+        return;
+    }
+
+    // Finalize in ST thread, if no finalizer thread or too many tasks, so the index is never left.
+    task->err = do_finalize(path);
+    nn_inflight_++;
+    on_finalized(task);
+}
+
+void SrsDvrMp4Finalizer::stop()
+{
+    if (entry_) {
+        __atomic_store_n(&quit_, 1, __ATOMIC_RELEASE);
+        cond_->signal();
+
+        srs_error_t err = _srs_thread_pool->join(entry_);
+        if (err != srs_success) {
+            srs_warn("DVR: ignore stop finalizer err %s", srs_error_desc(err).c_str());
+            srs_freep(err);
+        }
+        entry_ = NULL;
+    }
+
+    trd_->stop();
+
+    // The finalizer thread finalizes all tasks before quit, so we fire the events for them.
+    SrsDvrMp4FinalizeTask* task = NULL;
+    while (done_->pop(task)) {
+        on_finalized(task);
+    }
+}
+
+void SrsDvrMp4Finalizer::start_thread()
+{
+    srs_error_t err = srs_success;
+
+    srs_freep(trd_);
+    trd_ = new SrsSTCoroutine("dvr-finalize", this);
+    if ((err = trd_->start()) != srs_success) {
+        srs_warn("DVR: ignore start finalizer coroutine err %s", srs_error_desc(err).c_str());
+        srs_freep(err);
+        return;
+    }
+
+    if ((err = _srs_thread_pool->execute("dvr", SrsDvrMp4Finalizer::start, this, &entry_)) != srs_success) {
+        srs_warn("DVR: ignore start finalizer err %s", srs_error_desc(err).c_str());
+        srs_freep(err);
+        entry_ = NULL;
+    }
+}
+
+// Finalize the fMP4 at path with the index, to the classic MP4 at tmp.
+static srs_error_t srs_dvr_mp4_finalize_to(string path, string index, string tmp)
+{
+    srs_error_t err = srs_success;
+
+    SrsFileReader fr;
+    if ((err = fr.open(path)) != srs_success) {
+        return srs_error_wrap(err, "open %s", path.c_str());
+    }
+
+    SrsFileReader ir;
+    if ((err = ir.open(index)) != srs_success) {
+        return srs_error_wrap(err, "open %s", index.c_str());
+    }
+
+    SrsFileWriter fw;
+    if ((err = fw.open(tmp)) != srs_success) {
+        return srs_error_wrap(err, "open %s", tmp.c_str());
+    }
+
+    if ((err = fw.set_iobuf_size(SRS_FWRITE_CACHE_SIZE)) != srs_success) {
+        return srs_error_wrap(err, "set iobuf size for %s", tmp.c_str());
+    }
+
+    SrsMp4Finalizer finalizer;
+    return finalizer.finalize(&fr, &ir, &fw);
+}
+
+srs_error_t SrsDvrMp4Finalizer::do_finalize(string path)
+{
+    srs_error_t err = srs_success;
+
+    string index = path + ".idx";
+    string tmp = path + ".finalize";
+
+    err = srs_dvr_mp4_finalize_to(path, index, tmp);
+
+    // Replace the fMP4 atomically, or remove the temporary file if failed.
+    if (err == srs_success && ::rename(tmp.c_str(), path.c_str()) < 0) {
+        err = srs_error_new(ERROR_SYSTEM_FILE_RENAME, "rename %s to %s", tmp.c_str(), path.c_str());
+    }
+
+    // Always remove the temporary file and index, even if failed.
+    if (srs_path_exists(tmp)) {
+        ::unlink(tmp.c_str());
+    }
+    ::unlink(index.c_str());
+
+    return err;
+}
+
+srs_error_t SrsDvrMp4Finalizer::notify(ISrsAsyncCallTask* on_dvr)
+{
+    return _srs_dvr_async->execute(on_dvr);
+}
+
+void SrsDvrMp4Finalizer::on_finalized(SrsDvrMp4FinalizeTask* task)
+{
+    srs_error_t err = srs_success;
+
+    nn_inflight_--;
+
+    // The fMP4 is a valid file, so we keep it and fire the event, even if failed to finalize.
+    if (task->err != srs_success) {
+        srs_warn("DVR: ignore finalize %s err %s", task->path.c_str(), srs_error_desc(task->err).c_str());
+    } else {
+        srs_trace("DVR: finalize %s to classic MP4", task->path.c_str());
+    }
+
+    // The event is owned by async worker now.
+    ISrsAsyncCallTask* on_dvr = task->on_dvr;
+    task->on_dvr = NULL;
+    srs_freep(task);
+
+    if (on_dvr && (err = notify(on_dvr)) != srs_success) {
+        srs_warn("DVR: ignore on_dvr err %s", srs_error_desc(err).c_str());
+        srs_freep(err);
+    }
+}
+
+srs_error_t SrsDvrMp4Finalizer::start(void* arg)
+{
+    SrsDvrMp4Finalizer* finalizer = (SrsDvrMp4Finalizer*)arg;
+    finalizer->thread_cycle();
+    return srs_success;
+}
+
+void SrsDvrMp4Finalizer::thread_cycle()
+{
+    // Note that we should never write log in finalizer thread, for the log is not thread-safe.
+    while (true) {
+        // Finalize all the tasks in queue before quit.
+        bool quit = __atomic_load_n(&quit_, __ATOMIC_ACQUIRE);
+
+        // The done queue never overflows, because the ST thread limits the tasks in flight.
+        SrsDvrMp4FinalizeTask* task = NULL;
+        while (tasks_->pop(task)) {
+            task->err = do_finalize(task->path);
+            done_->push(task);
+        }
+
+        if (quit) {
+            break;
+        }
+
+        cond_->wait(SRS_DVR_MP4_FINALIZE_WAIT);
+    }
+}
+
+srs_error_t SrsDvrMp4Finalizer::cycle()
+{
+    srs_error_t err = srs_success;
+
+    while (true) {
+        if ((err = trd_->pull()) != srs_success) {
+            return srs_error_wrap(err, "dvr finalizer");
+        }
+
+        SrsDvrMp4FinalizeTask* task = NULL;
+        while (done_->pop(task)) {
+            on_finalized(task);
+        }
+
+        srs_usleep(SRS_DVR_MP4_FINALIZE_INTERVAL);
+    }
+
+    return err;
+}
+
+SrsDvrMp4Finalizer* _srs_dvr_mp4_finalizer = new SrsDvrMp4Finalizer();
+
 SrsDvrAsyncCallOnDvr::SrsDvrAsyncCallOnDvr(SrsContextId c, SrsRequest* r, string p)
 {
     cid = c;
@@ -659,7 +953,7 @@ srs_error_t SrsDvrPlan::on_reap_segment()
     SrsFragment* fragment = segment->current();
     string fullpath = fragment->fullpath();
     
-    if ((err = _srs_dvr_async->execute(new SrsDvrAsyncCallOnDvr(cid, req, fullpath))) != srs_success) {
+    if ((err = segment->on_reap_segment(new SrsDvrAsyncCallOnDvr(cid, req, fullpath))) != srs_success) {
         return srs_error_wrap(err, "reap segment");
     }
     
@@ -31,6 +31,7 @@ class SrsFormat;
 #include <srs_app_source.hpp>
 #include <srs_app_reload.hpp>
 #include <srs_app_async_call.hpp>
+#include <srs_app_threads.hpp>
 
 // The segmenter for DVR, to write a segment file in flv/mp4.
 class SrsDvrSegmenter : public ISrsReloadHandler
@@ -42,8 +43,9 @@ protected:
     bool wait_keyframe;
     // The FLV/MP4 fragment file.
     SrsFragment* fragment;
-private:
+protected:
     SrsRequest* req;
+private:
     SrsDvrPlan* plan;
 private:
     SrsRtmpJitter* jitter;
@@ -75,6 +77,8 @@ public:
     // Close current segment.
     // @remark ignore when already closed.
     virtual srs_error_t close();
+    // Fire the on_dvr event of the closed segment, in async.
+    virtual srs_error_t on_reap_segment(ISrsAsyncCallTask* on_dvr);
 protected:
     virtual srs_error_t open_encoder() = 0;
     virtual srs_error_t encode_metadata(SrsSharedPtrMessage* metadata) = 0;
@@ -125,11 +129,19 @@ class SrsDvrMp4Segmenter : public SrsDvrSegmenter
 private:
     // The MP4 encoder, for MP4 target.
     SrsMp4Encoder* enc;
+    // For fMP4, the writer for sample index, to finalize to classic MP4.
+    SrsFileWriter* idx;
+    // Whether the closing segment should be finalized.
+    bool finalize_;
 public:
     SrsDvrMp4Segmenter();
     virtual ~SrsDvrMp4Segmenter();
 public:
     virtual srs_error_t refresh_metadata();
+    // Close the segment, and finalize the fMP4 in background.
+    virtual srs_error_t close();
+    // Fire the on_dvr event after the fMP4 is finalized.
+    virtual srs_error_t on_reap_segment(ISrsAsyncCallTask* on_dvr);
 protected:
     virtual srs_error_t open_encoder();
     virtual srs_error_t encode_metadata(SrsSharedPtrMessage* metadata);
@@ -138,6 +150,65 @@ protected:
     virtual srs_error_t close_encoder();
 };
 
+// The task to finalize a fMP4 file, and fire the on_dvr event when done.
+class SrsDvrMp4FinalizeTask
+{
+public:
+    std::string path;
+    // The on_dvr event, fired by ST thread when finalized.
+    ISrsAsyncCallTask* on_dvr;
+    // The error of finalize, set by finalizer thread.
+    srs_error_t err;
+public:
+    SrsDvrMp4FinalizeTask(std::string p, ISrsAsyncCallTask* t);
+    virtual ~SrsDvrMp4FinalizeTask();
+};
+
+// Finalize the fMP4 of DVR to classic MP4 in a background thread, because it reads and writes
+// the whole file, which blocks the ST thread for long recordings. The finalized tasks are posted
+// back to ST thread, which writes the log and fires the on_dvr event.
+// @remark Finalize in ST thread, if failed to start the thread or too many tasks.
+class SrsDvrMp4Finalizer : public ISrsCoroutineHandler
+{
+private:
+    bool started_;
+    SrsThreadEntry* entry_;
+    SrsThreadCond* cond_;
+    int quit_;
+    // The tasks to finalize, from ST thread to finalizer thread.
+    SrsThreadQueue<SrsDvrMp4FinalizeTask*>* tasks_;
+    // The finalized tasks, from finalizer thread to ST thread.
+    SrsThreadQueue<SrsDvrMp4FinalizeTask*>* done_;
+    // The number of tasks not consumed by ST thread, never exceed the capacity of queue.
+    int nn_inflight_;
+    // The ST coroutine to consume the finalized tasks.
+    SrsCoroutine* trd_;
+public:
+    SrsDvrMp4Finalizer();
+    virtual ~SrsDvrMp4Finalizer();
+public:
+    // Finalize the fMP4 file with its sample index at path.idx, which is removed when done,
+    // then fire the on_dvr event, which is owned by finalizer.
+    void finalize(std::string path, ISrsAsyncCallTask* on_dvr);
+    // Stop the finalizer thread, after all tasks are finalized.
+    void stop();
+    // Finalize the fMP4 file in current thread, and replace it by classic MP4 atomically.
+    static srs_error_t do_finalize(std::string path);
+protected:
+    // Fire the on_dvr event in async.
+    virtual srs_error_t notify(ISrsAsyncCallTask* on_dvr);
+private:
+    void start_thread();
+    void on_finalized(SrsDvrMp4FinalizeTask* task);
+    static srs_error_t start(void* arg);
+    void thread_cycle();
+// Interface ISrsCoroutineHandler
+public:
+    virtual srs_error_t cycle();
+};
+
+extern SrsDvrMp4Finalizer* _srs_dvr_mp4_finalizer;
+
 // the dvr async call.
 class SrsDvrAsyncCallOnDvr : public ISrsAsyncCallTask
 {
@@ -36,6 +36,7 @@ using namespace std;
 #include <srs_protocol_amf0.hpp>
 #include <srs_app_http_client.hpp>
 #include <srs_app_tencentcloud.hpp>
+#include <srs_app_http_hooks.hpp>
 
 // when edge timeout, retry next.
 #define SRS_EDGE_INGESTER_TIMEOUT (5 * SRS_UTIME_SECONDS)
@@ -43,6 +44,31 @@ using namespace std;
 // when edge error, wait for quit
 #define SRS_EDGE_FORWARDER_TIMEOUT (150 * SRS_UTIME_MILLISECONDS)
 
+SrsLbHealth* _srs_edge_origins = NULL;
+
+ISrsLbBalancer* srs_edge_create_lb(SrsRequest* req)
+{
+    string lb = _srs_config->get_vhost_edge_load_balance(req->vhost);
+
+    if (lb == "p2c") {
+        return new SrsLbPowerOfTwo(_srs_edge_origins);
+    }
+
+    // Hash by the stream url, so all edges pull the same stream from the same origin.
+    if (lb == "hash") {
+        return new SrsLbConsistentHash(_srs_edge_origins, req->get_stream_url());
+    }
+
+    return new SrsLbRoundRobin();
+}
+
+// Whether the error is caused by origin server, so we should eject it for a while.
+bool srs_edge_is_origin_failure(srs_error_t err)
+{
+    int code = srs_error_code(err);
+    return code != ERROR_EDGE_VHOST_REMOVED && code != ERROR_RTMP_STREAM_NOT_FOUND;
+}
+
 SrsEdgeUpstream::SrsEdgeUpstream()
 {
 }
@@ -63,7 +89,7 @@ SrsEdgeRtmpUpstream::~SrsEdgeRtmpUpstream()
     close();
 }
 
-srs_error_t SrsEdgeRtmpUpstream::connect(SrsRequest* r, SrsLbRoundRobin* lb)
+srs_error_t SrsEdgeRtmpUpstream::connect(SrsRequest* r, ISrsLbBalancer* lb)
 {
     srs_error_t err = srs_success;
     
@@ -163,8 +189,9 @@ void SrsEdgeRtmpUpstream::kbps_sample(const char* label, srs_utime_t age)
     sdk->kbps_sample(label, age);
 }
 
-SrsEdgeFlvUpstream::SrsEdgeFlvUpstream(std::string schema)
+SrsEdgeFlvUpstream::SrsEdgeFlvUpstream(std::string schema, std::string redirect)
 {
+    redirect_ = redirect;
     schema_ = schema;
     selected_port = 0;
 
@@ -180,7 +207,7 @@ SrsEdgeFlvUpstream::~SrsEdgeFlvUpstream()
     close();
 }
 
-srs_error_t SrsEdgeFlvUpstream::connect(SrsRequest* r, SrsLbRoundRobin* lb)
+srs_error_t SrsEdgeFlvUpstream::connect(SrsRequest* r, ISrsLbBalancer* lb)
 {
     // Because we might modify the r, which cause retry fail, so we must copy it.
     SrsRequest* cp = r->copy();
@@ -192,7 +219,7 @@ srs_error_t SrsEdgeFlvUpstream::connect(SrsRequest* r, SrsLbRoundRobin* lb)
     return do_connect(cp, lb, 0);
 }
 
-srs_error_t SrsEdgeFlvUpstream::do_connect(SrsRequest* r, SrsLbRoundRobin* lb, int redirect_depth)
+srs_error_t SrsEdgeFlvUpstream::do_connect(SrsRequest* r, ISrsLbBalancer* lb, int redirect_depth)
 {
     srs_error_t err = srs_success;
 
@@ -215,6 +242,11 @@ srs_error_t SrsEdgeFlvUpstream::do_connect(SrsRequest* r, SrsLbRoundRobin* lb, i
         }
         srs_parse_hostport(server, server, port);
 
+        // override the origin info by parent edge.
+        if (!redirect_.empty()) {
+            srs_parse_hostport(redirect_, server, port);
+        }
+
         // Remember the current selected server.
         selected_ip = server;
         selected_port = port;
@@ -389,6 +421,91 @@ void SrsEdgeFlvUpstream::kbps_sample(const char* label, srs_utime_t age)
     sdk_->kbps_sample(label, age);
 }
 
+// The time to cache the discovered parent edge.
+#define SRS_EDGE_PARENT_TTL (10 * SRS_UTIME_SECONDS)
+// The total time to ask all parent edges.
+#define SRS_EDGE_PARENT_TIMEOUT (3 * SRS_UTIME_SECONDS)
+
+SrsEdgeParentDiscovery::SrsEdgeParentDiscovery(srs_utime_t ttl, srs_utime_t timeout)
+{
+    expired_at_ = 0;
+    ttl_ = ttl;
+    timeout_ = timeout;
+}
+
+SrsEdgeParentDiscovery::~SrsEdgeParentDiscovery()
+{
+}
+
+string SrsEdgeParentDiscovery::discover(SrsRequest* req, const vector<string>& parents)
+{
+    srs_error_t err = srs_success;
+
+    if (parents.empty()) {
+        return "";
+    }
+
+    srs_utime_t starttime = srs_update_system_time();
+    if (expired_at_ > starttime) {
+        return parent_;
+    }
+
+    parent_ = "";
+    for (int i = 0; i < (int)parents.size(); i++) {
+        // Stop when exceed the total timeout, so the dead parents never stall the edge.
+        srs_utime_t elapsed = srs_update_system_time() - starttime;
+        if (elapsed >= timeout_) {
+            srs_warn("edge: discover parent timeout %dms, asked %d/%d parents", srsu2msi(timeout_), i, (int)parents.size());
+            break;
+        }
+
+        string api = parents.at(i);
+        string parent;
+        if ((err = query(req, api, timeout_ - elapsed, parent)) != srs_success) {
+            // The parent is not delivering the stream, try the next one.
+            srs_freep(err);
+            continue;
+        }
+
+        parent_ = parent;
+        srs_trace("edge: discover parent %s by %s for %s", parent.c_str(), api.c_str(), req->get_stream_url().c_str());
+        break;
+    }
+
+    // Cache the result even not found, to avoid asking the parents for each retry.
+    expired_at_ = srs_update_system_time() + ttl_;
+
+    return parent_;
+}
+
+void SrsEdgeParentDiscovery::reset()
+{
+    parent_ = "";
+    expired_at_ = 0;
+}
+
+srs_error_t SrsEdgeParentDiscovery::query(SrsRequest* req, string api, srs_utime_t timeout, string& parent)
+{
+    srs_error_t err = srs_success;
+
+    string url = "http://" + api + "/api/v1/clusters?"
+        + "vhost=" + req->vhost + "&ip=" + req->host + "&app=" + req->app + "&stream=" + req->stream
+        + "&coworker=" + api;
+
+    string host; int port = 0, http_port = 0;
+    if ((err = SrsHttpHooks::discover_co_workers(url, host, port, &http_port, timeout)) != srs_success) {
+        return srs_error_wrap(err, "discover by %s", url.c_str());
+    }
+
+    // Ignore if the parent does not serve HTTP-FLV.
+    if (host.empty() || http_port <= 0) {
+        return srs_error_new(ERROR_OCLUSTER_DISCOVER, "no http stream, host=%s, http=%d", host.c_str(), http_port);
+    }
+
+    parent = host + ":" + srs_int2str(http_port);
+    return err;
+}
+
 SrsEdgeIngester::SrsEdgeIngester()
 {
     source_ = NULL;
@@ -399,8 +516,9 @@ SrsEdgeIngester::SrsEdgeIngester()
 #endif
     
     upstream = new SrsEdgeRtmpUpstream("");
-    lb = new SrsLbRoundRobin();
+    lb = NULL;
     trd = new SrsDummyCoroutine();
+    discovery_ = new SrsEdgeParentDiscovery(SRS_EDGE_PARENT_TTL, SRS_EDGE_PARENT_TIMEOUT);
 }
 
 SrsEdgeIngester::~SrsEdgeIngester()
@@ -413,6 +531,7 @@ SrsEdgeIngester::~SrsEdgeIngester()
     srs_freep(upstream);
     srs_freep(lb);
     srs_freep(trd);
+    srs_freep(discovery_);
 }
 
 srs_error_t SrsEdgeIngester::initialize(SrsSharedPtr<SrsLiveSource> s, SrsPlayEdge* e, SrsRequest* r)
@@ -423,6 +542,9 @@ srs_error_t SrsEdgeIngester::initialize(SrsSharedPtr<SrsLiveSource> s, SrsPlayEd
     edge = e;
     req = r;
 
+    srs_freep(lb);
+    lb = srs_edge_create_lb(req);
+
 #ifdef SRS_APM
     // We create a dedicate span for edge ingester, and all players will link to this one.
     // Note that we use a producer span and end it immediately.
@@ -464,7 +586,7 @@ void SrsEdgeIngester::stop()
 
 string SrsEdgeIngester::get_curr_origin()
 {
-    return lb->selected();
+    return lb ? lb->selected() : "";
 }
 
 #ifdef SRS_APM
@@ -543,9 +665,17 @@ srs_error_t SrsEdgeIngester::do_cycle()
             edge_protocol = req->protocol;
         }
 
+        // For multi-tier edge, pull from the parent which is delivering the stream.
+        string parent;
+        if (redirect.empty()) {
+            parent = discovery_->discover(req, _srs_config->get_vhost_edge_parents(req->vhost));
+        }
+
         // Create object by protocol.
         srs_freep(upstream);
-        if (edge_protocol == "flv" || edge_protocol == "flvs") {
+        if (!parent.empty()) {
+            upstream = new SrsEdgeFlvUpstream("http", parent);
+        } else if (edge_protocol == "flv" || edge_protocol == "flvs") {
             upstream = new SrsEdgeFlvUpstream(edge_protocol == "flv"? "http" : "https");
         } else {
             upstream = new SrsEdgeRtmpUpstream(redirect);
@@ -555,9 +685,22 @@ srs_error_t SrsEdgeIngester::do_cycle()
             return srs_error_wrap(err, "on source id changed");
         }
         
+        // Feedback the connect time to balancer, ignore the redirect or parent server which is not selected by it.
+        bool selected_by_lb = redirect.empty() && parent.empty();
+        srs_utime_t starttime = srs_update_system_time();
         if ((err = upstream->connect(req, lb)) != srs_success) {
+            if (selected_by_lb && srs_edge_is_origin_failure(err)) {
+                lb->on_failure(lb->selected());
+            }
+            // Discover again, for the parent might stop delivering the stream.
+            if (!parent.empty()) {
+                discovery_->reset();
+            }
             return srs_error_wrap(err, "connect upstream");
         }
+        if (selected_by_lb) {
+            lb->on_success(lb->selected(), srs_update_system_time() - starttime);
+        }
         
         if ((err = edge->on_ingest_play()) != srs_success) {
             return srs_error_wrap(err, "notify edge play");
@@ -567,6 +710,11 @@ srs_error_t SrsEdgeIngester::do_cycle()
         upstream->set_recv_timeout(SRS_EDGE_INGESTER_TIMEOUT);
         
         err = ingest(redirect);
+
+        // The parent stops delivering the stream, so discover again.
+        if (!parent.empty()) {
+            discovery_->reset();
+        }
         
         // retry for rtmp 302 immediately.
         if (srs_error_code(err) == ERROR_CONTROL_REDIRECT) {
@@ -729,7 +877,7 @@ SrsEdgeForwarder::SrsEdgeForwarder()
     source_ = NULL;
     
     sdk = NULL;
-    lb = new SrsLbRoundRobin();
+    lb = NULL;
     trd = new SrsDummyCoroutine();
     queue = new SrsMessageQueue();
 }
@@ -756,6 +904,9 @@ srs_error_t SrsEdgeForwarder::initialize(SrsSharedPtr<SrsLiveSource> s, SrsPubli
     edge = e;
     req = r;
 
+    srs_freep(lb);
+    lb = srs_edge_create_lb(req);
+
     return srs_success;
 }
 
@@ -800,9 +951,14 @@ srs_error_t SrsEdgeForwarder::start()
         ->as_child(_srs_apm->load()), sdk->extra_args()));
 #endif
     
+    srs_utime_t starttime = srs_update_system_time();
     if ((err = sdk->connect()) != srs_success) {
+        if (srs_edge_is_origin_failure(err)) {
+            lb->on_failure(lb->selected());
+        }
         return srs_error_wrap(err, "sdk connect %s failed, cto=%dms, sto=%dms.", url.c_str(), srsu2msi(cto), srsu2msi(sto));
     }
+    lb->on_success(lb->selected(), srs_update_system_time() - starttime);
 
     // For RTMP client, we pass the vhost in tcUrl when connecting,
     // so we publish without vhost in stream.
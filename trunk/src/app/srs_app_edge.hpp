@@ -13,6 +13,7 @@
 #include <srs_core_autofree.hpp>
 
 #include <string>
+#include <vector>
 
 class SrsStSocket;
 class SrsRtmpServer;
@@ -25,7 +26,8 @@ class SrsCommonMessage;
 class SrsMessageQueue;
 class ISrsProtocolReadWriter;
 class SrsKbps;
-class SrsLbRoundRobin;
+class ISrsLbBalancer;
+class SrsLbHealth;
 class SrsTcpClient;
 class SrsSimpleRtmpClient;
 class SrsPacket;
@@ -35,6 +37,12 @@ class SrsHttpFileReader;
 class SrsFlvDecoder;
 class ISrsApmSpan;
 
+// The health of origin servers, shared by all edge streams.
+extern SrsLbHealth* _srs_edge_origins;
+
+// Create the load balance algorithm for edge to select origin.
+extern ISrsLbBalancer* srs_edge_create_lb(SrsRequest* req);
+
 // The state of edge, auto machine
 enum SrsEdgeState
 {
@@ -66,7 +74,7 @@ public:
     SrsEdgeUpstream();
     virtual ~SrsEdgeUpstream();
 public:
-    virtual srs_error_t connect(SrsRequest* r, SrsLbRoundRobin* lb) = 0;
+    virtual srs_error_t connect(SrsRequest* r, ISrsLbBalancer* lb) = 0;
     virtual srs_error_t recv_message(SrsCommonMessage** pmsg) = 0;
     virtual srs_error_t decode_message(SrsCommonMessage* msg, SrsPacket** ppacket) = 0;
     virtual void close() = 0;
@@ -92,7 +100,7 @@ public:
     SrsEdgeRtmpUpstream(std::string r);
     virtual ~SrsEdgeRtmpUpstream();
 public:
-    virtual srs_error_t connect(SrsRequest* r, SrsLbRoundRobin* lb);
+    virtual srs_error_t connect(SrsRequest* r, ISrsLbBalancer* lb);
     virtual srs_error_t recv_message(SrsCommonMessage** pmsg);
     virtual srs_error_t decode_message(SrsCommonMessage* msg, SrsPacket** ppacket);
     virtual void close();
@@ -105,6 +113,9 @@ public:
 class SrsEdgeFlvUpstream : public SrsEdgeUpstream
 {
 private:
+    // For multi-tier edge, if not empty,
+    // use this <ip[:port]> of parent edge as upstream.
+    std::string redirect_;
     std::string schema_;
     SrsHttpClient* sdk_;
     ISrsHttpMessage* hr_;
@@ -118,12 +129,13 @@ private:
     std::string selected_ip;
     int selected_port;
 public:
-    SrsEdgeFlvUpstream(std::string schema);
+    // @param redirect, override the server. ignore if empty.
+    SrsEdgeFlvUpstream(std::string schema, std::string redirect = "");
     virtual ~SrsEdgeFlvUpstream();
 public:
-    virtual srs_error_t connect(SrsRequest* r, SrsLbRoundRobin* lb);
+    virtual srs_error_t connect(SrsRequest* r, ISrsLbBalancer* lb);
 private:
-    virtual srs_error_t do_connect(SrsRequest* r, SrsLbRoundRobin* lb, int redirect_depth);
+    virtual srs_error_t do_connect(SrsRequest* r, ISrsLbBalancer* lb, int redirect_depth);
 public:
     virtual srs_error_t recv_message(SrsCommonMessage** pmsg);
     virtual srs_error_t decode_message(SrsCommonMessage* msg, SrsPacket** ppacket);
@@ -134,6 +146,34 @@ public:
     virtual void kbps_sample(const char* label, srs_utime_t age);
 };
 
+// The discovery of parent edge for multi-tier edge, which asks each parent whether it's delivering the stream. The
+// result is cached for a while, and the total time to ask parents is limited, so dead parents never stall the retry.
+class SrsEdgeParentDiscovery
+{
+private:
+    // The discovered parent in <ip:port>, empty if not found.
+    std::string parent_;
+    // The time when the cached result expires, 0 if not discovered.
+    srs_utime_t expired_at_;
+    // The time to cache the result.
+    srs_utime_t ttl_;
+    // The total time to ask all parents.
+    srs_utime_t timeout_;
+public:
+    SrsEdgeParentDiscovery(srs_utime_t ttl, srs_utime_t timeout);
+    virtual ~SrsEdgeParentDiscovery();
+public:
+    // Discover the parent which is delivering the stream, use the cached result if not expired.
+    // @return The <ip:port> of parent, empty if not found.
+    virtual std::string discover(SrsRequest* req, const std::vector<std::string>& parents);
+    // Drop the cached result, for example, when failed to pull from the parent.
+    virtual void reset();
+protected:
+    // Ask the parent by its API whether it's delivering the stream.
+    // @param parent Output the <ip:port> of the HTTP stream of parent.
+    virtual srs_error_t query(SrsRequest* req, std::string api, srs_utime_t timeout, std::string& parent);
+};
+
 // The edge used to ingest stream from origin.
 class SrsEdgeIngester : public ISrsCoroutineHandler
 {
@@ -144,8 +184,10 @@ private:
     SrsPlayEdge* edge;
     SrsRequest* req;
     SrsCoroutine* trd;
-    SrsLbRoundRobin* lb;
+    ISrsLbBalancer* lb;
     SrsEdgeUpstream* upstream;
+    // For multi-tier edge, to discover the parent edge which is delivering the stream.
+    SrsEdgeParentDiscovery* discovery_;
 #ifdef SRS_APM
     ISrsApmSpan* span_main_;
 #endif
@@ -182,7 +224,7 @@ private:
     SrsRequest* req;
     SrsCoroutine* trd;
     SrsSimpleRtmpClient* sdk;
-    SrsLbRoundRobin* lb;
+    ISrsLbBalancer* lb;
     // we must ensure one thread one fd principle,
     // that is, a fd must be write/read by the one thread.
     // The publish service thread will proxy(msg), and the edge forward thread
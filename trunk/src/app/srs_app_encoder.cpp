@@ -131,6 +131,10 @@ srs_error_t SrsEncoder::do_cycle()
 
 void SrsEncoder::clear_engines()
 {
+    // The renditions are outputs of ffmpegs, so free them together.
+    ffmpegs.insert(ffmpegs.end(), renditions.begin(), renditions.end());
+    renditions.clear();
+
     std::vector<SrsFFMPEG*>::iterator it;
     
     for (it = ffmpegs.begin(); it != ffmpegs.end(); ++it) {
@@ -214,6 +218,11 @@ srs_error_t SrsEncoder::parse_ffmpeg(SrsRequest* req, SrsConfDirective* conf)
         return err;
     }
     
+    // For ladder, all engines are outputs of the first ffmpeg, to decode the input once.
+    bool ladder = _srs_config->get_transcode_ladder(conf);
+    SrsFFMPEG* primary = NULL;
+    int nn_renditions = 0;
+
     // create engine
     for (int i = 0; i < (int)engines.size(); i++) {
         SrsConfDirective* engine = engines[i];
@@ -227,9 +236,21 @@ srs_error_t SrsEncoder::parse_ffmpeg(SrsRequest* req, SrsConfDirective* conf)
             srs_freep(ffmpeg);
             return srs_error_wrap(err, "init ffmpeg");
         }
+
+        if (ladder && primary) {
+            primary->append_rendition(ffmpeg);
+            renditions.push_back(ffmpeg);
+            nn_renditions++;
+            continue;
+        }
         
+        primary = ffmpeg;
         ffmpegs.push_back(ffmpeg);
     }
+
+    if (ladder && primary) {
+        srs_trace("transcode ladder %s, renditions=%d", conf->arg0().c_str(), nn_renditions + 1);
+    }
     
     return err;
 }
@@ -314,8 +335,8 @@ void SrsEncoder::show_encode_log_message()
     // reportable
     if (pprint->can_print()) {
         // TODO: FIXME: show more info.
-        srs_trace("-> " SRS_CONSTS_LOG_ENCODER " time=%" PRId64 ", encoders=%d, input=%s",
-                  pprint->age(), (int)ffmpegs.size(), input_stream_name.c_str());
+        srs_trace("-> " SRS_CONSTS_LOG_ENCODER " time=%" PRId64 ", encoders=%d, renditions=%d, input=%s",
+                  pprint->age(), (int)ffmpegs.size(), (int)renditions.size(), input_stream_name.c_str());
     }
 }
 
@@ -26,6 +26,8 @@ class SrsEncoder : public ISrsCoroutineHandler
 private:
     std::string input_stream_name;
     std::vector<SrsFFMPEG*> ffmpegs;
+    // The renditions of ladder, which are outputs of other ffmpeg, so never start them.
+    std::vector<SrsFFMPEG*> renditions;
 private:
     SrsCoroutine* trd;
     SrsPithyPrint* pprint;
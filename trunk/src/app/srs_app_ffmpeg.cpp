@@ -82,6 +82,11 @@ string SrsFFMPEG::output()
     return _output;
 }
 
+void SrsFFMPEG::append_rendition(SrsFFMPEG* rendition)
+{
+    renditions_.push_back(rendition);
+}
+
 srs_error_t SrsFFMPEG::initialize(string in, string out, string log)
 {
     srs_error_t err = srs_success;
@@ -241,6 +246,34 @@ srs_error_t SrsFFMPEG::start()
     params.push_back("-i");
     params.push_back(input);
 
+    // The output of this engine, then the renditions share the same input and decoder.
+    append_output(params);
+    for (int i = 0; i < (int)renditions_.size(); i++) {
+        renditions_.at(i)->append_output(params);
+    }
+
+    // when specified the log file.
+    if (!log_file.empty()) {
+        // stdout
+        params.push_back("1");
+        params.push_back(">");
+        params.push_back(log_file);
+        // stderr
+        params.push_back("2");
+        params.push_back(">");
+        params.push_back(log_file);
+    }
+
+    // initialize the process.
+    if ((err = process->initialize(ffmpeg, params)) != srs_success) {
+        return srs_error_wrap(err, "init process");
+    }
+
+    return process->start();
+}
+
+void SrsFFMPEG::append_output(vector<string>& params)
+{
     // build the filter
     if (!vfilter.empty()) {
         std::vector<std::string>::iterator it;
@@ -369,25 +402,6 @@ srs_error_t SrsFFMPEG::start()
 
     params.push_back("-y");
     params.push_back(_output);
-
-    // when specified the log file.
-    if (!log_file.empty()) {
-        // stdout
-        params.push_back("1");
-        params.push_back(">");
-        params.push_back(log_file);
-        // stderr
-        params.push_back("2");
-        params.push_back(">");
-        params.push_back(log_file);
-    }
-
-    // initialize the process.
-    if ((err = process->initialize(ffmpeg, params)) != srs_success) {
-        return srs_error_wrap(err, "init process");
-    }
-
-    return process->start();
 }
 
 srs_error_t SrsFFMPEG::cycle()
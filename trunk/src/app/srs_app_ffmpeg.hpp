@@ -49,6 +49,9 @@ private:
     std::vector<std::string>    aparams;
     std::string                 oformat;
     std::string                 _output;
+private:
+    // The renditions share the input and decoder of this engine, as extra outputs of ffmpeg.
+    std::vector<SrsFFMPEG*>     renditions_;
 public:
     SrsFFMPEG(std::string ffmpeg_bin);
     virtual ~SrsFFMPEG();
@@ -56,6 +59,8 @@ public:
     virtual void append_iparam(std::string iparam);
     virtual void set_oformat(std::string format);
     virtual std::string output();
+    // Add a rendition as extra output of this engine, which is not owned by this engine.
+    virtual void append_rendition(SrsFFMPEG* rendition);
 public:
     virtual srs_error_t initialize(std::string in, std::string out, std::string log);
     virtual srs_error_t initialize_transcode(SrsConfDirective* engine);
@@ -67,6 +72,8 @@ public:
 public:
     virtual void fast_stop();
     virtual void fast_kill();
+private:
+    virtual void append_output(std::vector<std::string>& params);
 };
 
 #endif
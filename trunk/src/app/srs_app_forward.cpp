@@ -30,28 +30,21 @@ using namespace std;
 #include <srs_kernel_utility.hpp>
 #include <srs_app_rtmp_conn.hpp>
 
-SrsForwarder::SrsForwarder(SrsOriginHub* h)
+SrsForwarder::SrsForwarder(SrsMessageRing* ring)
 {
-    hub = h;
-    
     req = NULL;
-    sh_video = sh_audio = NULL;
+    nn_failures = 0;
     
     sdk = NULL;
     trd = new SrsDummyCoroutine();
-    queue = new SrsMessageQueue();
-    jitter = new SrsRtmpJitter();
+    cursor = new SrsMessageRingCursor(ring);
 }
 
 SrsForwarder::~SrsForwarder()
 {
     srs_freep(sdk);
     srs_freep(trd);
-    srs_freep(queue);
-    srs_freep(jitter);
-    
-    srs_freep(sh_video);
-    srs_freep(sh_audio);
+    srs_freep(cursor);
     
     srs_freep(req);
 }
@@ -73,11 +66,6 @@ srs_error_t SrsForwarder::initialize(SrsRequest* r, string ep)
     return err;
 }
 
-void SrsForwarder::set_queue_size(srs_utime_t queue_size)
-{
-    queue->set_queue_size(queue_size);
-}
-
 srs_error_t SrsForwarder::on_publish()
 {
     srs_error_t err = srs_success;
@@ -97,72 +85,10 @@ void SrsForwarder::on_unpublish()
     if (sdk) sdk->close();
 }
 
-srs_error_t SrsForwarder::on_meta_data(SrsSharedPtrMessage* shared_metadata)
-{
-    srs_error_t err = srs_success;
-    
-    SrsSharedPtrMessage* metadata = shared_metadata->copy();
-    
-    // TODO: FIXME: config the jitter of Forwarder.
-    if ((err = jitter->correct(metadata, SrsRtmpJitterAlgorithmOFF)) != srs_success) {
-        return srs_error_wrap(err, "jitter");
-    }
-    
-    if ((err = queue->enqueue(metadata)) != srs_success) {
-        return srs_error_wrap(err, "enqueue metadata");
-    }
-    
-    return err;
-}
-
-srs_error_t SrsForwarder::on_audio(SrsSharedPtrMessage* shared_audio)
-{
-    srs_error_t err = srs_success;
-    
-    SrsSharedPtrMessage* msg = shared_audio->copy();
-    
-    // TODO: FIXME: config the jitter of Forwarder.
-    if ((err = jitter->correct(msg, SrsRtmpJitterAlgorithmOFF)) != srs_success) {
-        return srs_error_wrap(err, "jitter");
-    }
-    
-    if (SrsFlvAudio::sh(msg->payload, msg->size)) {
-        srs_freep(sh_audio);
-        sh_audio = msg->copy();
-    }
-    
-    if ((err = queue->enqueue(msg)) != srs_success) {
-        return srs_error_wrap(err, "enqueue audio");
-    }
-    
-    return err;
-}
-
-srs_error_t SrsForwarder::on_video(SrsSharedPtrMessage* shared_video)
-{
-    srs_error_t err = srs_success;
-    
-    SrsSharedPtrMessage* msg = shared_video->copy();
-    
-    // TODO: FIXME: config the jitter of Forwarder.
-    if ((err = jitter->correct(msg, SrsRtmpJitterAlgorithmOFF)) != srs_success) {
-        return srs_error_wrap(err, "jitter");
-    }
-    
-    if (SrsFlvVideo::sh(msg->payload, msg->size)) {
-        srs_freep(sh_video);
-        sh_video = msg->copy();
-    }
-    
-    if ((err = queue->enqueue(msg)) != srs_success) {
-        return srs_error_wrap(err, "enqueue video");
-    }
-    
-    return err;
-}
-
 // when error, forwarder sleep for a while and retry.
 #define SRS_FORWARDER_CIMS (3 * SRS_UTIME_SECONDS)
+// The max backoff to retry, when forwarder fails continuously.
+#define SRS_FORWARDER_MAX_BACKOFF (30 * SRS_UTIME_SECONDS)
 
 srs_error_t SrsForwarder::cycle()
 {
@@ -189,12 +115,25 @@ srs_error_t SrsForwarder::cycle()
             return srs_error_wrap(err, "forwarder");
         }
 
-        srs_usleep(SRS_FORWARDER_CIMS);
+        srs_usleep(backoff());
     }
     
     return err;
 }
 
+srs_utime_t SrsForwarder::backoff()
+{
+    // Double the interval for each failure, in [CIMS, MAX_BACKOFF].
+    srs_utime_t interval = SRS_FORWARDER_CIMS;
+    for (int i = 1; i < nn_failures && interval < SRS_FORWARDER_MAX_BACKOFF; i++) {
+        interval *= 2;
+    }
+    interval = srs_min(interval, SRS_FORWARDER_MAX_BACKOFF);
+
+    // Jitter in [interval/2, interval], to avoid all forwarders retry at the same time.
+    return interval / 2 + srs_random() % (interval / 2 + 1);
+}
+
 srs_error_t SrsForwarder::do_cycle()
 {
     srs_error_t err = srs_success;
@@ -216,6 +155,9 @@ srs_error_t SrsForwarder::do_cycle()
     srs_utime_t sto = SRS_CONSTS_RTMP_TIMEOUT;
     sdk = new SrsSimpleRtmpClient(url, cto, sto);
     
+    // Assume it fails, reset the backoff when published.
+    nn_failures++;
+    
     if ((err = sdk->connect()) != srs_success) {
         return srs_error_wrap(err, "sdk connect url=%s, cto=%dms, sto=%dms.", url.c_str(), srsu2msi(cto), srsu2msi(sto));
     }
@@ -227,9 +169,10 @@ srs_error_t SrsForwarder::do_cycle()
         return srs_error_wrap(err, "sdk publish");
     }
     
-    if ((err = hub->on_forwarder_start(this)) != srs_success) {
-        return srs_error_wrap(err, "notify hub start");
-    }
+    nn_failures = 0;
+
+    // Always send the metadata and sequence headers first, because the slave might restart.
+    cursor->request_sh();
     
     if ((err = forward()) != srs_success) {
         return srs_error_wrap(err, "forward");
@@ -251,18 +194,8 @@ srs_error_t SrsForwarder::forward()
 
     SrsMessageArray msgs(SYS_MAX_FORWARD_SEND_MSGS);
     
-    // update sequence header
-    // TODO: FIXME: maybe need to zero the sequence header timestamp.
-    if (sh_video) {
-        if ((err = sdk->send_and_free_message(sh_video->copy())) != srs_success) {
-            return srs_error_wrap(err, "send video sh");
-        }
-    }
-    if (sh_audio) {
-        if ((err = sdk->send_and_free_message(sh_audio->copy())) != srs_success) {
-            return srs_error_wrap(err, "send audio sh");
-        }
-    }
+    // Whether there are more messages in ring, never wait for the control message.
+    bool pending = false;
     
     while (true) {
         if ((err = trd->pull()) != srs_success) {
@@ -272,7 +205,7 @@ srs_error_t SrsForwarder::forward()
         pprint->elapse();
         
         // read from client.
-        if (true) {
+        if (!pending) {
             SrsCommonMessage* msg = NULL;
             err = sdk->recv_message(&msg);
             
@@ -287,9 +220,10 @@ srs_error_t SrsForwarder::forward()
         // forward all messages.
         // each msg in msgs.msgs must be free, for the SrsMessageArray never free them.
         int count = 0;
-        if ((err = queue->dump_packets(msgs.max, msgs.msgs, count)) != srs_success) {
+        if ((err = cursor->dump_packets(msgs.max, msgs.msgs, count)) != srs_success) {
             return srs_error_wrap(err, "dump packets");
         }
+        pending = cursor->size() > 0;
         
         // pithy print
         if (pprint->can_print()) {
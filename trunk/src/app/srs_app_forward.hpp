@@ -16,16 +16,16 @@
 class ISrsProtocolReadWriter;
 class SrsSharedPtrMessage;
 class SrsOnMetaDataPacket;
-class SrsMessageQueue;
-class SrsRtmpJitter;
+class SrsMessageRing;
+class SrsMessageRingCursor;
 class SrsRtmpClient;
 class SrsRequest;
 class SrsLiveSource;
-class SrsOriginHub;
 class SrsKbps;
 class SrsSimpleRtmpClient;
 
-// Forward the stream to other servers.
+// Forward the stream to other servers. All forwarders of a source read the same ring by cursor,
+// so the publisher never copies messages for each forwarder, and each forwarder retries independently.
 class SrsForwarder : public ISrsCoroutineHandler
 {
 private:
@@ -38,35 +38,26 @@ private:
 private:
     SrsCoroutine* trd;
 private:
-    SrsOriginHub* hub;
     SrsSimpleRtmpClient* sdk;
-    SrsRtmpJitter* jitter;
-    SrsMessageQueue* queue;
-    // Cache the sequence header for retry when slave is failed.
-    SrsSharedPtrMessage* sh_audio;
-    SrsSharedPtrMessage* sh_video;
+    // The cursor to read the shared ring of source.
+    SrsMessageRingCursor* cursor;
+    // The number of continuous failures, for backoff of retry.
+    int nn_failures;
 public:
-    SrsForwarder(SrsOriginHub* h);
+    // @param ring The shared ring of source, which must outlive the forwarder.
+    SrsForwarder(SrsMessageRing* ring);
     virtual ~SrsForwarder();
 public:
     virtual srs_error_t initialize(SrsRequest* r, std::string ep);
-    virtual void set_queue_size(srs_utime_t queue_size);
 public:
     virtual srs_error_t on_publish();
     virtual void on_unpublish();
-    // Forward the audio packet.
-    // @param shared_metadata, directly ptr, copy it if need to save it.
-    virtual srs_error_t on_meta_data(SrsSharedPtrMessage* shared_metadata);
-    // Forward the audio packet.
-    // @param shared_audio, directly ptr, copy it if need to save it.
-    virtual srs_error_t on_audio(SrsSharedPtrMessage* shared_audio);
-    // Forward the video packet.
-    // @param shared_video, directly ptr, copy it if need to save it.
-    virtual srs_error_t on_video(SrsSharedPtrMessage* shared_video);
 // Interface ISrsReusableThread2Handler.
 public:
     virtual srs_error_t cycle();
 private:
+    // Get the jittered exponential backoff to retry.
+    virtual srs_utime_t backoff();
     virtual srs_error_t do_cycle();
 private:
     virtual srs_error_t forward();
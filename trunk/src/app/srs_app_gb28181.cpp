@@ -26,8 +26,11 @@
 #include <srs_protocol_json.hpp>
 #include <srs_app_http_api.hpp>
 #include <srs_app_statistic.hpp>
+#include <srs_app_stream_bridge.hpp>
+#include <srs_app_threads.hpp>
 
 #include <sstream>
+#include <unistd.h>
 using namespace std;
 
 // See https://www.ietf.org/rfc/rfc3261.html#section-8.1.1.7
@@ -36,7 +39,24 @@ using namespace std;
 #define SRS_GB_MAX_RECOVER 16
 #define SRS_GB_MAX_TIMEOUT 3
 #define SRS_GB_LARGE_PACKET 1500
-#define SRS_GB_SESSION_DRIVE_INTERVAL (300 * SRS_UTIME_MILLISECONDS)
+// The max number of freed messages to reuse for PS pack.
+#define SRS_GB_FREE_MESSAGES 16
+// The max interval to drive the session, when no event.
+#define SRS_GB_SESSION_DRIVE_INTERVAL (1 * SRS_UTIME_SECONDS)
+// The max bytes reserved for next packet, the room before each RTP packet.
+#define SRS_GB_MAX_RESERVED 128
+// The capacity of queues between ST thread and media workers.
+#define SRS_GB_WORKER_PACKETS 1024
+#define SRS_GB_WORKER_PACKS 64
+// The interval for ST thread to yield, when the packets queue of worker is full.
+#define SRS_GB_WORKER_IDLE (1 * SRS_UTIME_MILLISECONDS)
+// The max time to wait for next RTP packet, to consume the packs demuxed by worker when camera pauses.
+#define SRS_GB_WORKER_PULL (10 * SRS_UTIME_MILLISECONDS)
+// The max time for media worker to wait for packets, to free the closed channels if idle.
+#define SRS_GB_WORKER_WAIT (100 * SRS_UTIME_MILLISECONDS)
+
+// Whether current thread is a media worker thread, which should never write log.
+static __thread bool _srs_gb_worker = false;
 
 extern bool srs_is_rtcp(const uint8_t* data, size_t len);
 
@@ -81,6 +101,8 @@ SrsGbSession::SrsGbSession() : sip_(new SrsGbSipTcpConn()), media_(new SrsGbMedi
     owner_cid_ = NULL;
 
     muxer_ = new SrsGbMuxer(this);
+    video_ = new SrsTsMessage();
+    wait_ = srs_cond_new();
     state_ = SrsGbSessionStateInit;
 
     connecting_starttime_ = 0;
@@ -112,7 +134,9 @@ SrsGbSession::SrsGbSession() : sip_(new SrsGbSipTcpConn()), media_(new SrsGbMedi
 SrsGbSession::~SrsGbSession()
 {
     srs_freep(muxer_);
+    srs_freep(video_);
     srs_freep(ppp_);
+    srs_cond_destroy(wait_);
 }
 
 void SrsGbSession::setup(SrsConfDirective* conf)
@@ -167,19 +191,31 @@ void SrsGbSession::on_ps_pack(SrsPackContext* ctx, SrsPsPacket* ps, const std::v
     media_msgs_dropped_ = ctx->media_nn_msgs_dropped_;
     media_reserved_ = ctx->media_reserved_;
 
-    // Group all video in pack to a video frame, because only allows one video for each PS pack.
-    SrsUniquePtr<SrsTsMessage> video(new SrsTsMessage());
+    // Group all video in pack to a video frame, because only allows one video for each PS pack. We directly use the
+    // message if only one video PES, or group them to the reused video message.
+    SrsTsMessage* video = NULL;
+    video_->payload->erase(video_->payload->length());
 
     for (vector<SrsTsMessage*>::const_iterator it = msgs.begin(); it != msgs.end(); ++it) {
         SrsTsMessage* msg = *it;
 
         // Group all videos to one video.
         if (msg->sid == SrsTsPESStreamIdVideoCommon) {
-            video->ps_helper_ = msg->ps_helper_;
-            video->dts = msg->dts;
-            video->pts = msg->pts;
-            video->sid = msg->sid;
-            video->payload->append(msg->payload);
+            if (!video) {
+                video = msg;
+                continue;
+            }
+
+            if (video != video_) {
+                video_->payload->append(video->payload);
+                video = video_;
+            }
+
+            video_->ps_helper_ = msg->ps_helper_;
+            video_->dts = msg->dts;
+            video_->pts = msg->pts;
+            video_->sid = msg->sid;
+            video_->payload->append(msg->payload);
             continue;
         }
 
@@ -192,8 +228,8 @@ void SrsGbSession::on_ps_pack(SrsPackContext* ctx, SrsPsPacket* ps, const std::v
     }
 
     // Send the generated video message.
-    if (video->payload->length() > 0) {
-        srs_error_t err = muxer_->on_ts_message(video.get());
+    if (video && video->payload->length() > 0) {
+        srs_error_t err = muxer_->on_ts_message(video);
         if (err != srs_success) {
             srs_warn("Muxer: Ignore video err %s", srs_error_desc(err).c_str());
             srs_freep(err);
@@ -206,6 +242,7 @@ void SrsGbSession::on_sip_transport(SrsSharedResource<SrsGbSipTcpConn> sip)
     sip_ = sip;
     // Change id of SIP and all its child coroutines.
     sip_->set_cid(cid_);
+    notify();
 }
 
 SrsSharedResource<SrsGbSipTcpConn> SrsGbSession::sip_transport()
@@ -219,6 +256,7 @@ void SrsGbSession::on_media_transport(SrsSharedResource<SrsGbMediaTcpConn> media
 
     // Change id of SIP and all its child coroutines.
     media_->set_cid(cid_);
+    notify();
 }
 
 std::string SrsGbSession::pip()
@@ -226,6 +264,11 @@ std::string SrsGbSession::pip()
     return pip_;
 }
 
+void SrsGbSession::notify()
+{
+    srs_cond_signal(wait_);
+}
+
 srs_error_t SrsGbSession::cycle()
 {
     srs_error_t err = srs_success;
@@ -280,8 +323,8 @@ srs_error_t SrsGbSession::do_cycle()
             return srs_error_wrap(err, "pull");
         }
 
-        // Drive the state in a fixed interval.
-        srs_usleep(SRS_GB_SESSION_DRIVE_INTERVAL);
+        // Drive the state when SIP or media changed, or timeout of state machine.
+        srs_cond_timedwait(wait_, drive_timeout());
 
         // Client send bye, we should dispose the session.
         if (sip_->is_bye()) {
@@ -378,6 +421,24 @@ srs_error_t SrsGbSession::drive_state()
     return err;
 }
 
+srs_utime_t SrsGbSession::drive_timeout()
+{
+    srs_utime_t timeout = SRS_GB_SESSION_DRIVE_INTERVAL;
+    srs_utime_t now = srs_update_system_time();
+
+    // Wait util connecting timeout.
+    if (state_ == SrsGbSessionStateConnecting) {
+        timeout = srs_min(timeout, connecting_starttime_ + connecting_timeout_ - now);
+    }
+
+    // Wait util re-invite, note that we re-invite when exceed the wait time.
+    if (state_ == SrsGbSessionStateEstablished && reinviting_starttime_) {
+        timeout = srs_min(timeout, reinviting_starttime_ + reinvite_wait_ + SRS_UTIME_MILLISECONDS - now);
+    }
+
+    return srs_max(timeout, SRS_UTIME_MILLISECONDS);
+}
+
 SrsGbSessionState SrsGbSession::set_state(SrsGbSessionState v)
 {
     SrsGbSessionState state = state_;
@@ -906,6 +967,12 @@ SrsGbSipState SrsGbSipTcpConn::set_state(SrsGbSipState v)
 {
     SrsGbSipState state = state_;
     state_ = v;
+
+    // Drive the session, for example, to invite when registered.
+    if (session_ && state != v) {
+        session_->notify();
+    }
+
     return state;
 }
 
@@ -1240,7 +1307,11 @@ ISrsPsPackHandler::~ISrsPsPackHandler()
 SrsGbMediaTcpConn::SrsGbMediaTcpConn()
 {
     pack_ = new SrsPackContext(this);
-    buffer_ = new uint8_t[65535];
+    demuxer_ = new SrsGbPsDemuxer(pack_);
+    channel_ = NULL;
+    worker_video_stream_type_ = SrsTsStreamReserved;
+    worker_audio_stream_type_ = SrsTsStreamReserved;
+    buffer_ = new uint8_t[SRS_GB_MAX_RESERVED + 65535];
     conn_ = NULL;
 
     wrapper_ = NULL;
@@ -1257,7 +1328,13 @@ SrsGbMediaTcpConn::~SrsGbMediaTcpConn()
 {
     srs_freep(conn_);
     srs_freepa(buffer_);
+    srs_freep(demuxer_);
     srs_freep(pack_);
+
+    // The channel is freed by worker thread.
+    if (channel_) {
+        channel_->close();
+    }
 }
 
 void SrsGbMediaTcpConn::setup(srs_netfd_t stfd)
@@ -1347,15 +1424,6 @@ srs_error_t SrsGbMediaTcpConn::do_cycle()
 {
     srs_error_t err = srs_success;
 
-    // The PS context to decode all PS packets.
-    SrsRecoverablePsContext context;
-
-    // If bytes is not enough(defined by SRS_PS_MIN_REQUIRED), ignore.
-    context.ctx_.set_detect_ps_integrity(true);
-
-    // Previous left bytes, to parse in next loop.
-    uint32_t reserved = 0;
-
     for (;;) {
         if (!owner_coroutine_) return err;
         if ((err = owner_coroutine_->pull()) != srs_success) {
@@ -1366,7 +1434,15 @@ srs_error_t SrsGbMediaTcpConn::do_cycle()
         uint16_t length = 0;
         if (true) {
             uint8_t lbuffer[2];
-            if ((err = conn_->read_fully(lbuffer, sizeof(lbuffer), NULL)) != srs_success) {
+            if ((err = read_length(lbuffer)) != srs_success) {
+                // Consume the packs demuxed by worker, when camera pauses, because there is no next packet.
+                if (srs_error_code(err) == ERROR_SOCKET_TIMEOUT) {
+                    srs_freep(err);
+                    if ((err = consume_packs()) != srs_success) {
+                        return srs_error_wrap(err, "consume packs");
+                    }
+                    continue;
+                }
                 return srs_error_wrap(err, "read");
             }
 
@@ -1376,18 +1452,14 @@ srs_error_t SrsGbMediaTcpConn::do_cycle()
             }
         }
 
-        if (length > SRS_GB_LARGE_PACKET) {
-            const SrsPsDecodeHelper& h = context.ctx_.helper_;
-            srs_warn("PS: Large length=%u, previous-seq=%u, previous-ts=%u", length, h.rtp_seq_, h.rtp_ts_);
-        }
-
-        // Read length of bytes of RTP packet.
-        if ((err = conn_->read_fully(buffer_ + reserved, length, NULL)) != srs_success) {
+        // Read length of bytes of RTP packet, after the room for reserved bytes.
+        uint8_t* p = buffer_ + SRS_GB_MAX_RESERVED;
+        if ((err = conn_->read_fully(p, length, NULL)) != srs_success) {
             return srs_error_wrap(err, "read");
         }
 
         // Drop all RTCP packets.
-        if (srs_is_rtcp(buffer_ + reserved, length)) {
+        if (srs_is_rtcp(p, length)) {
             nn_rtcp_++; srs_warn("PS: Drop RTCP packets nn=%d", nn_rtcp_);
             continue;
         }
@@ -1395,7 +1467,7 @@ srs_error_t SrsGbMediaTcpConn::do_cycle()
         // If no session, try to finger out it.
         if (!session_) {
             SrsRtpPacket rtp;
-            SrsBuffer b((char*)(buffer_ + reserved), length);
+            SrsBuffer b((char*)p, length);
             if ((err = rtp.decode(&b)) != srs_success) {
                 srs_warn("PS: Ignore packet length=%d for err %s", length, srs_error_desc(err).c_str());
                 srs_freep(err); // We ignore any error when decoding the RTP packet.
@@ -1405,41 +1477,146 @@ srs_error_t SrsGbMediaTcpConn::do_cycle()
             if ((err = bind_session(rtp.header.get_ssrc(), &session_)) != srs_success) {
                 return srs_error_wrap(err, "bind session");
             }
+
+            // Demux PS in the worker of camera, if enabled.
+            if (session_ && !channel_) {
+                channel_ = _srs_gb_workers->create_channel(rtp.header.get_ssrc());
+            }
         }
         if (!session_) {
             srs_warn("PS: Ignore packet length=%d for no session", length);
             continue; // Ignore any media packet when no session.
         }
 
-        // Show tips about the buffer to parse.
-        if (reserved) {
-            string bytes = srs_string_dumps_hex((const char*)(buffer_ + reserved), length, 16);
-            srs_trace("PS: Consume reserved=%dB, length=%d, bytes=[%s]", reserved, length, bytes.c_str());
+        // Parse RTP over TCP, RFC4571, in current thread.
+        if (!channel_) {
+            if ((err = demuxer_->decode(p, length)) != srs_success) {
+                return srs_error_wrap(err, "decode pack");
+            }
+            continue;
         }
 
-        // Parse RTP over TCP, RFC4571.
-        SrsBuffer b((char*)buffer_, length + reserved);
-        if ((err = context.decode_rtp(&b, reserved, pack_)) != srs_success) {
-            return srs_error_wrap(err, "decode pack");
+        // Or demux in worker thread, and consume the demuxed packs.
+        SrsGbMediaPacket* pkt = new SrsGbMediaPacket(length);
+        memcpy(pkt->payload(), p, length);
+        err = push_packet(pkt);
+        if (err != srs_success) {
+            srs_freep(pkt);
+            return srs_error_wrap(err, "push packet");
         }
 
-        // There might some messages left to parse in next loop.
-        reserved = b.left();
-        if (reserved > 128) {
-            srs_warn("PS: Drop too many reserved=%d bytes", reserved);
-            reserved = 0; // Avoid reserving too much data.
+        if ((err = consume_packs()) != srs_success) {
+            return srs_error_wrap(err, "consume packs");
         }
-        if (reserved) {
-            string bytes = srs_string_dumps_hex(b.head(), reserved, 16);
-            srs_trace("PS: Reserved bytes for next loop, pos=%d, left=%d, total=%d, bytes=[%s]",
-                b.pos(), b.left(), b.size(), bytes.c_str());
-            // Copy the bytes left to the start of buffer. Note that the left(reserved) bytes might be overlapped with
-            // buffer, so we must use memmove not memcpy, see https://github.com/ossrs/srs/issues/3300#issuecomment-1352907075
-            memmove(buffer_, b.head(), reserved);
-            pack_->media_reserved_++;
+    }
+
+    return err;
+}
+
+srs_error_t SrsGbMediaTcpConn::read_length(uint8_t* lbuffer)
+{
+    srs_error_t err = srs_success;
+
+    if (!channel_) {
+        return conn_->read_fully(lbuffer, 2, NULL);
+    }
+
+    // Wait for the first byte with timeout, because the packs in worker are only consumed by current coroutine. Note
+    // that we never read the length with timeout, which might lose the partial read bytes.
+    srs_utime_t timeout = conn_->get_recv_timeout();
+    conn_->set_recv_timeout(SRS_GB_WORKER_PULL);
+    err = conn_->read(lbuffer, 1, NULL);
+    conn_->set_recv_timeout(timeout);
+
+    if (err != srs_success) {
+        return err;
+    }
+
+    return conn_->read_fully(lbuffer + 1, 1, NULL);
+}
+
+srs_error_t SrsGbMediaTcpConn::push_packet(SrsGbMediaPacket* pkt)
+{
+    srs_error_t err = srs_success;
+
+    // Apply backpressure if worker queue is full, never drop the packet because it corrupts the PS stream. We consume
+    // the packs to make room for worker, and yield to other coroutines until worker demuxes the packets.
+    while (true) {
+        if (channel_->failed()) {
+            return srs_error_wrap(channel_->error(), "worker");
+        }
+
+        if (channel_->packets_->push(pkt)) {
+            break;
+        }
+
+        channel_->wakeup();
+
+        if ((err = consume_packs()) != srs_success) {
+            return srs_error_wrap(err, "consume packs");
+        }
+
+        srs_usleep(SRS_GB_WORKER_IDLE);
+
+        if (!owner_coroutine_) return srs_error_new(ERROR_GB_PS_MEDIA, "stopped");
+        if ((err = owner_coroutine_->pull()) != srs_success) {
+            return srs_error_wrap(err, "pull");
         }
     }
 
+    channel_->wakeup();
+    return err;
+}
+
+srs_error_t SrsGbMediaTcpConn::consume_packs()
+{
+    srs_error_t err = srs_success;
+
+    if (!channel_) {
+        return err;
+    }
+
+    int nn_packs = 0;
+    SrsGbMediaPack* pack = NULL;
+    while (channel_->packs_->pop(pack)) {
+        nn_packs++;
+
+        // Report the recover of worker, because the worker never writes log.
+        if (pack->media_nn_recovered_ != pack_->media_nn_recovered_) {
+            srs_warn("PS: Worker recover=%" PRId64 ", msgs-dropped=%" PRId64 ", reserved=%" PRId64, pack->media_nn_recovered_,
+                pack->media_nn_msgs_dropped_, pack->media_reserved_);
+        }
+
+        // Report the PSM of worker, because the worker never writes log.
+        if (pack->ctx_->video_stream_type_ != worker_video_stream_type_ || pack->ctx_->audio_stream_type_ != worker_audio_stream_type_) {
+            srs_trace("PS: Worker got PSM for video=%#x, audio=%#x", pack->ctx_->video_stream_type_, pack->ctx_->audio_stream_type_);
+            worker_video_stream_type_ = pack->ctx_->video_stream_type_;
+            worker_audio_stream_type_ = pack->ctx_->audio_stream_type_;
+        }
+
+        // Update the statistic of media, from the worker.
+        pack_->media_nn_recovered_ = pack->media_nn_recovered_;
+        pack_->media_nn_msgs_dropped_ = pack->media_nn_msgs_dropped_;
+        pack_->media_reserved_ = pack->media_reserved_;
+
+        err = on_ps_pack(pack->ps_, pack->msgs_);
+
+        // Return the pack to worker to reuse.
+        pack->clear();
+        if (!channel_->free_packs_->push(pack)) {
+            srs_freep(pack);
+        }
+
+        if (err != srs_success) {
+            return srs_error_wrap(err, "on ps pack");
+        }
+    }
+
+    // Wakeup the worker which might wait for the free room of packs.
+    if (nn_packs) {
+        channel_->wakeup();
+    }
+
     return err;
 }
 
@@ -1451,6 +1628,7 @@ srs_error_t SrsGbMediaTcpConn::on_ps_pack(SrsPsPacket* ps, const std::vector<Srs
     if (!connected_) {
         connected_ = true;
         srs_trace("PS: Media connected");
+        session_->notify();
     }
 
     // Notify session about the media pack.
@@ -2112,14 +2290,9 @@ srs_error_t SrsGbMuxer::connect()
 
     srs_utime_t cto = SRS_CONSTS_RTMP_TIMEOUT;
     srs_utime_t sto = SRS_CONSTS_RTMP_PULSE;
-    sdk_ = new SrsSimpleRtmpClient(url, cto, sto);
+    sdk_ = new SrsCasterPublisher(url, cto, sto);
 
-    if ((err = sdk_->connect()) != srs_success) {
-        close();
-        return srs_error_wrap(err, "connect %s failed, cto=%dms, sto=%dms.", url.c_str(), srsu2msi(cto), srsu2msi(sto));
-    }
-
-    if ((err = sdk_->publish(SRS_CONSTS_RTMP_PROTOCOL_CHUNK_SIZE)) != srs_success) {
+    if ((err = sdk_->publish()) != srs_success) {
         close();
         return srs_error_wrap(err, "publish");
     }
@@ -2455,13 +2628,26 @@ SrsPackContext::~SrsPackContext()
 {
     clear();
     srs_freep(ps_);
+
+    for (vector<SrsTsMessage*>::iterator it = free_msgs_.begin(); it != free_msgs_.end(); ++it) {
+        SrsTsMessage* msg = *it;
+        srs_freep(msg);
+    }
 }
 
 void SrsPackContext::clear()
 {
     for (vector<SrsTsMessage*>::iterator it = msgs_.begin(); it != msgs_.end(); ++it) {
         SrsTsMessage* msg = *it;
-        srs_freep(msg);
+
+        // Keep the message and its payload buffer to reuse.
+        if (free_msgs_.size() >= SRS_GB_FREE_MESSAGES) {
+            srs_freep(msg);
+            continue;
+        }
+
+        msg->payload->erase(msg->payload->length());
+        free_msgs_.push_back(msg);
     }
 
     msgs_.clear();
@@ -2506,8 +2692,17 @@ srs_error_t SrsPackContext::on_ts_message(SrsTsMessage* msg)
         *ps_ = *h->ps_;
     }
 
-    // Store the message to current pack.
-    msgs_.push_back(msg->detach());
+    // Store the message to current pack. We swap the payload with a reused message, so the PS context also reuses
+    // the empty payload buffer of it.
+    SrsTsMessage* cp = NULL;
+    if (free_msgs_.empty()) {
+        cp = new SrsTsMessage();
+    } else {
+        cp = free_msgs_.back();
+        free_msgs_.pop_back();
+    }
+    msg->detach_to(cp);
+    msgs_.push_back(cp);
 
     return err;
 }
@@ -2617,19 +2812,21 @@ srs_error_t SrsRecoverablePsContext::enter_recover_mode(SrsBuffer* stream, ISrsP
     // Enter recover mode. Increase the recover counter because we might fail for many times.
     recover_++;
 
-    // Print the error information for debugging.
+    // Print the error information for debugging, except in worker thread, which is counted by handler.
     int npos = stream->pos();
     stream->skip(pos - stream->pos());
-    string bytes = srs_string_dumps_hex(stream->head(), stream->left(), 8);
 
     SrsPsDecodeHelper& h = ctx_.helper_;
-    uint16_t pack_seq = h.pack_first_seq_;
-    uint16_t pack_msgs = h.pack_nn_msgs_;
-    uint16_t lsopm = h.pack_pre_msg_last_seq_;
-    SrsTsMessage* last = ctx_.last();
-    srs_warn("PS: Enter recover=%d, seq=%u, ts=%u, pt=%u, pack=%u, msgs=%u, lsopm=%u, last=%u/%u, bytes=[%s], pos=%d, left=%d for err %s",
-        recover_, h.rtp_seq_, h.rtp_ts_, h.rtp_pt_, pack_seq, pack_msgs, lsopm, last->PES_packet_length, last->payload->length(),
-        bytes.c_str(), npos, stream->left(), srs_error_desc(err).c_str());
+    if (!_srs_gb_worker) {
+        string bytes = srs_string_dumps_hex(stream->head(), stream->left(), 8);
+        uint16_t pack_seq = h.pack_first_seq_;
+        uint16_t pack_msgs = h.pack_nn_msgs_;
+        uint16_t lsopm = h.pack_pre_msg_last_seq_;
+        SrsTsMessage* last = ctx_.last();
+        srs_warn("PS: Enter recover=%d, seq=%u, ts=%u, pt=%u, pack=%u, msgs=%u, lsopm=%u, last=%u/%u, bytes=[%s], pos=%d, left=%d for err %s",
+            recover_, h.rtp_seq_, h.rtp_ts_, h.rtp_pt_, pack_seq, pack_msgs, lsopm, last->PES_packet_length, last->payload->length(),
+            bytes.c_str(), npos, stream->left(), srs_error_desc(err).c_str());
+    }
 
     // If RTP packet exceed SRS_GB_LARGE_PACKET, which is large packet, might be correct length and impossible to
     // recover, so we directly fail it and re-inivte.
@@ -2643,8 +2840,8 @@ srs_error_t SrsRecoverablePsContext::enter_recover_mode(SrsBuffer* stream, ISrsP
             h.pack_id_, h.pack_first_seq_, h.rtp_seq_);
     }
 
-    // Reap and dispose last incomplete message.
-    SrsTsMessage* msg = ctx_.reap(); srs_freep(msg);
+    // Reap and dispose last incomplete message, which is reused by context.
+    ctx_.release_message(ctx_.reap());
     // Skip all left bytes in buffer, reset error because recovered.
     stream->skip(stream->left()); srs_freep(err);
 
@@ -2656,32 +2853,513 @@ srs_error_t SrsRecoverablePsContext::enter_recover_mode(SrsBuffer* stream, ISrsP
 
 void SrsRecoverablePsContext::quit_recover_mode(SrsBuffer* stream, ISrsPsMessageHandler* handler)
 {
-    string bytes = srs_string_dumps_hex(stream->head(), stream->left(), 8);
-    srs_warn("PS: Quit recover=%d, seq=%u, bytes=[%s], pos=%d, left=%d", recover_, ctx_.helper_.rtp_seq_,
-        bytes.c_str(), stream->pos(), stream->left());
+    if (!_srs_gb_worker) {
+        string bytes = srs_string_dumps_hex(stream->head(), stream->left(), 8);
+        srs_warn("PS: Quit recover=%d, seq=%u, bytes=[%s], pos=%d, left=%d", recover_, ctx_.helper_.rtp_seq_,
+            bytes.c_str(), stream->pos(), stream->left());
+    }
     recover_ = 0;
 }
 
-bool srs_skip_util_pack(SrsBuffer* stream)
+SrsGbPsDemuxer::SrsGbPsDemuxer(SrsPackContext* pack)
+{
+    pack_ = pack;
+    reserved_bytes_ = new uint8_t[SRS_GB_MAX_RESERVED];
+    reserved_ = 0;
+
+    // If bytes is not enough(defined by SRS_PS_MIN_REQUIRED), ignore.
+    context_.ctx_.set_detect_ps_integrity(true);
+}
+
+SrsGbPsDemuxer::~SrsGbPsDemuxer()
+{
+    srs_freepa(reserved_bytes_);
+}
+
+void SrsGbPsDemuxer::set_quiet(bool v)
+{
+    context_.ctx_.set_quiet(v);
+}
+
+srs_error_t SrsGbPsDemuxer::decode(uint8_t* p, int length)
+{
+    srs_error_t err = srs_success;
+
+    // Never write log in worker thread, see SrsGbMediaTcpConn::consume_packs for the statistic.
+    if (!_srs_gb_worker && length > SRS_GB_LARGE_PACKET) {
+        const SrsPsDecodeHelper& h = context_.ctx_.helper_;
+        srs_warn("PS: Large length=%u, previous-seq=%u, previous-ts=%u", length, h.rtp_seq_, h.rtp_ts_);
+    }
+
+    // Show tips about the buffer to parse.
+    if (!_srs_gb_worker && reserved_) {
+        string bytes = srs_string_dumps_hex((const char*)p, length, 16);
+        srs_trace("PS: Consume reserved=%dB, length=%d, bytes=[%s]", reserved_, length, bytes.c_str());
+    }
+
+    // Prepend the reserved bytes of previous packet, in the room before packet.
+    uint8_t* start = p - reserved_;
+    if (reserved_) {
+        memcpy(start, reserved_bytes_, reserved_);
+    }
+
+    // Parse RTP over TCP, RFC4571.
+    SrsBuffer b((char*)start, length + reserved_);
+    if ((err = context_.decode_rtp(&b, reserved_, pack_)) != srs_success) {
+        return srs_error_wrap(err, "decode pack");
+    }
+
+    // There might some messages left to parse in next packet.
+    reserved_ = b.left();
+    if (reserved_ > SRS_GB_MAX_RESERVED) {
+        if (!_srs_gb_worker) srs_warn("PS: Drop too many reserved=%d bytes", reserved_);
+        reserved_ = 0; // Avoid reserving too much data.
+    }
+    if (reserved_) {
+        if (!_srs_gb_worker) {
+            string bytes = srs_string_dumps_hex(b.head(), reserved_, 16);
+            srs_trace("PS: Reserved bytes for next loop, pos=%d, left=%d, total=%d, bytes=[%s]",
+                b.pos(), b.left(), b.size(), bytes.c_str());
+        }
+        memcpy(reserved_bytes_, b.head(), reserved_);
+        pack_->media_reserved_++;
+    }
+
+    return err;
+}
+
+SrsGbMediaPacket::SrsGbMediaPacket(int size)
+{
+    size_ = size;
+    data_ = new uint8_t[SRS_GB_MAX_RESERVED + size];
+}
+
+SrsGbMediaPacket::~SrsGbMediaPacket()
+{
+    srs_freepa(data_);
+}
+
+uint8_t* SrsGbMediaPacket::payload()
+{
+    return data_ + SRS_GB_MAX_RESERVED;
+}
+
+SrsGbMediaPack::SrsGbMediaPack()
+{
+    ctx_ = new SrsPsContext();
+    ps_ = new SrsPsPacket(ctx_);
+    helper_.ctx_ = ctx_;
+    helper_.ps_ = ps_;
+
+    media_nn_recovered_ = 0;
+    media_nn_msgs_dropped_ = 0;
+    media_reserved_ = 0;
+}
+
+SrsGbMediaPack::~SrsGbMediaPack()
+{
+    clear();
+
+    for (vector<SrsTsMessage*>::iterator it = free_msgs_.begin(); it != free_msgs_.end(); ++it) {
+        SrsTsMessage* msg = *it;
+        srs_freep(msg);
+    }
+
+    srs_freep(ps_);
+    srs_freep(ctx_);
+}
+
+void SrsGbMediaPack::clear()
+{
+    for (vector<SrsTsMessage*>::iterator it = msgs_.begin(); it != msgs_.end(); ++it) {
+        SrsTsMessage* msg = *it;
+
+        // Keep the message and its payload buffer to reuse.
+        if (free_msgs_.size() >= SRS_GB_FREE_MESSAGES) {
+            srs_freep(msg);
+            continue;
+        }
+
+        msg->payload->erase(msg->payload->length());
+        free_msgs_.push_back(msg);
+    }
+
+    msgs_.clear();
+}
+
+SrsGbMediaChannel::SrsGbMediaChannel(SrsThreadCond* cond)
+{
+    packets_ = new SrsThreadQueue<SrsGbMediaPacket*>(SRS_GB_WORKER_PACKETS);
+    packs_ = new SrsThreadQueue<SrsGbMediaPack*>(SRS_GB_WORKER_PACKS);
+    free_packs_ = new SrsThreadQueue<SrsGbMediaPack*>(SRS_GB_WORKER_PACKS);
+
+    cond_ = cond;
+    closed_ = false;
+    failed_ = false;
+    err_ = srs_success;
+    pack_ = new SrsPackContext(this);
+    demuxer_ = new SrsGbPsDemuxer(pack_);
+
+    // Never write log in worker thread, the PSM is reported by ST thread.
+    demuxer_->set_quiet(true);
+}
+
+SrsGbMediaChannel::~SrsGbMediaChannel()
+{
+    srs_freep(demuxer_);
+    srs_freep(pack_);
+    srs_freep(err_);
+
+    SrsGbMediaPacket* pkt = NULL;
+    while (packets_->pop(pkt)) {
+        srs_freep(pkt);
+    }
+    srs_freep(packets_);
+
+    SrsGbMediaPack* pack = NULL;
+    while (packs_->pop(pack)) {
+        srs_freep(pack);
+    }
+    srs_freep(packs_);
+
+    for (vector<SrsGbMediaPack*>::iterator it = pending_packs_.begin(); it != pending_packs_.end(); ++it) {
+        pack = *it;
+        srs_freep(pack);
+    }
+
+    while (free_packs_->pop(pack)) {
+        srs_freep(pack);
+    }
+    srs_freep(free_packs_);
+}
+
+void SrsGbMediaChannel::wakeup()
+{
+    cond_->signal();
+}
+
+void SrsGbMediaChannel::close()
+{
+    // Never touch the channel after closed, because it might be freed by worker.
+    SrsThreadCond* cond = cond_;
+    __atomic_store_n(&closed_, true, __ATOMIC_RELEASE);
+    cond->signal();
+}
+
+bool SrsGbMediaChannel::closed()
 {
-    while (stream->require(4)) {
-        uint8_t* p = (uint8_t*)stream->head();
+    return __atomic_load_n(&closed_, __ATOMIC_ACQUIRE);
+}
+
+bool SrsGbMediaChannel::failed()
+{
+    return __atomic_load_n(&failed_, __ATOMIC_ACQUIRE);
+}
 
-        // When searching pack header from payload, mostly not zero.
-        if (p[0] != 0x00 && p[1] != 0x00 && p[2] != 0x00 && p[3] != 0x00) {
-            stream->skip(4);
-        } else if (p[0] != 0x00 && p[1] != 0x00 && p[2] != 0x00) {
-            stream->skip(3);
-        } else if (p[0] != 0x00 && p[1] != 0x00) {
-            stream->skip(2);
+void SrsGbMediaChannel::fail(srs_error_t err)
+{
+    // The error is never changed after failed, so ST thread is able to read it.
+    if (failed()) {
+        srs_freep(err);
+        return;
+    }
+
+    err_ = err;
+    __atomic_store_n(&failed_, true, __ATOMIC_RELEASE);
+}
+
+srs_error_t SrsGbMediaChannel::error()
+{
+    return failed() ? srs_error_copy(err_) : srs_success;
+}
+
+int SrsGbMediaChannel::consume()
+{
+    int nn = 0;
+
+    // Never drop the demuxed packs, instead stop demuxing packets until ST thread consumes the packs, so the packets
+    // queue is full and ST thread stops reading the media transport.
+    SrsGbMediaPacket* pkt = NULL;
+    while (!failed() && flush_pending_packs(nn) && packs_->size() < SRS_GB_WORKER_PACKS / 2 && packets_->pop(pkt)) {
+        srs_error_t err = demuxer_->decode(pkt->payload(), pkt->size_);
+        srs_freep(pkt);
+        nn++;
+
+        // Never write log in worker thread, the error is reported by ST thread.
+        if (err != srs_success) {
+            fail(srs_error_wrap(err, "worker demux"));
+        }
+    }
+
+    return nn;
+}
+
+bool SrsGbMediaChannel::flush_pending_packs(int& nn)
+{
+    while (!pending_packs_.empty()) {
+        if (!packs_->push(pending_packs_.front())) {
+            return false;
+        }
+
+        pending_packs_.erase(pending_packs_.begin());
+        nn++;
+    }
+
+    return true;
+}
+
+srs_error_t SrsGbMediaChannel::on_ps_pack(SrsPsPacket* ps, const std::vector<SrsTsMessage*>& msgs)
+{
+    srs_error_t err = srs_success;
+
+    SrsGbMediaPack* pack = NULL;
+    if (!free_packs_->pop(pack)) {
+        pack = new SrsGbMediaPack();
+    }
+
+    // Copy the PS context for muxer, because the context of worker is changed by next packet.
+    SrsPsDecodeHelper* h = (SrsPsDecodeHelper*)msgs.front()->ps_helper_;
+    pack->ctx_->video_stream_type_ = h->ctx_->video_stream_type_;
+    pack->ctx_->audio_stream_type_ = h->ctx_->audio_stream_type_;
+    *pack->ps_ = *ps;
+    pack->ps_->context_ = pack->ctx_;
+    pack->helper_ = *h;
+    pack->helper_.ctx_ = pack->ctx_;
+    pack->helper_.ps_ = pack->ps_;
+
+    // Swap the payload with reused messages, like SrsPackContext.
+    for (vector<SrsTsMessage*>::const_iterator it = msgs.begin(); it != msgs.end(); ++it) {
+        SrsTsMessage* cp = NULL;
+        if (pack->free_msgs_.empty()) {
+            cp = new SrsTsMessage();
         } else {
-            if (p[0] == 0x00 && p[1] == 0x00 && p[2] == 0x01 && p[3] == 0xba) {
-                return true;
+            cp = pack->free_msgs_.back();
+            pack->free_msgs_.pop_back();
+        }
+
+        (*it)->detach_to(cp);
+        cp->ps_helper_ = &pack->helper_;
+        pack->msgs_.push_back(cp);
+    }
+
+    pack->media_nn_recovered_ = pack_->media_nn_recovered_;
+    pack->media_nn_msgs_dropped_ = pack_->media_nn_msgs_dropped_;
+    pack->media_reserved_ = pack_->media_reserved_;
+
+    // Keep the order of packs, push to the pending packs if there is any or the queue is full.
+    if (!pending_packs_.empty() || !packs_->push(pack)) {
+        pending_packs_.push_back(pack);
+    }
+
+    return err;
+}
+
+SrsGbMediaWorker::SrsGbMediaWorker()
+{
+    attached_ = new SrsThreadQueue<SrsGbMediaChannel*>(SRS_GB_WORKER_PACKETS);
+    cond_ = new SrsThreadCond();
+    quit_ = 0;
+    entry_ = NULL;
+}
+
+SrsGbMediaWorker::~SrsGbMediaWorker()
+{
+    stop();
+
+    SrsGbMediaChannel* channel = NULL;
+    while (attached_->pop(channel)) {
+        srs_freep(channel);
+    }
+    srs_freep(attached_);
+
+    for (vector<SrsGbMediaChannel*>::iterator it = channels_.begin(); it != channels_.end(); ++it) {
+        channel = *it;
+        srs_freep(channel);
+    }
+
+    srs_freep(cond_);
+}
+
+SrsGbMediaChannel* SrsGbMediaWorker::create_channel()
+{
+    SrsGbMediaChannel* channel = new SrsGbMediaChannel(cond_);
+    if (!attached_->push(channel)) {
+        srs_freep(channel);
+        return NULL;
+    }
+
+    cond_->signal();
+    return channel;
+}
+
+int SrsGbMediaWorker::consume()
+{
+    int nn = 0;
+
+    SrsGbMediaChannel* channel = NULL;
+    while (attached_->pop(channel)) {
+        channels_.push_back(channel);
+    }
+
+    for (vector<SrsGbMediaChannel*>::iterator it = channels_.begin(); it != channels_.end();) {
+        channel = *it;
+
+        // Free the channel closed by ST thread, which never touches it again.
+        if (channel->closed()) {
+            it = channels_.erase(it);
+            srs_freep(channel);
+            continue;
+        }
+
+        nn += channel->consume();
+        ++it;
+    }
+
+    return nn;
+}
+
+srs_error_t SrsGbMediaWorker::start()
+{
+    return _srs_thread_pool->execute("gb28181", SrsGbMediaWorker::start, this, &entry_);
+}
+
+void SrsGbMediaWorker::stop()
+{
+    if (!entry_) {
+        return;
+    }
+
+    __atomic_store_n(&quit_, 1, __ATOMIC_RELEASE);
+    cond_->signal();
+
+    srs_error_t err = _srs_thread_pool->join(entry_);
+    if (err != srs_success) {
+        srs_warn("GB: ignore stop worker err %s", srs_error_desc(err).c_str());
+        srs_freep(err);
+    }
+    entry_ = NULL;
+}
+
+srs_error_t SrsGbMediaWorker::start(void* arg)
+{
+    SrsGbMediaWorker* worker = (SrsGbMediaWorker*)arg;
+    return worker->cycle();
+}
+
+srs_error_t SrsGbMediaWorker::cycle()
+{
+    srs_error_t err = srs_success;
+
+    // Never write log in worker thread, including the PS demuxer.
+    _srs_gb_worker = true;
+
+    while (!__atomic_load_n(&quit_, __ATOMIC_ACQUIRE)) {
+        // Wait for the packets or channels, which signaled by ST thread.
+        if (!consume()) {
+            cond_->wait(SRS_GB_WORKER_WAIT);
+        }
+    }
+
+    // Fail the channels still used by ST thread, so the cameras are disconnected and never wait for the packs.
+    SrsGbMediaChannel* channel = NULL;
+    while (attached_->pop(channel)) {
+        channels_.push_back(channel);
+    }
+    for (vector<SrsGbMediaChannel*>::iterator it = channels_.begin(); it != channels_.end(); ++it) {
+        channel = *it;
+        channel->fail(srs_error_new(ERROR_GB_PS_MEDIA, "worker stopped"));
+    }
+
+    return err;
+}
+
+SrsGbMediaWorkers::SrsGbMediaWorkers()
+{
+    started_ = false;
+}
+
+SrsGbMediaWorkers::~SrsGbMediaWorkers()
+{
+    stop();
+}
+
+SrsGbMediaChannel* SrsGbMediaWorkers::create_channel(uint32_t ssrc)
+{
+    srs_error_t err = srs_success;
+
+    if (!started_) {
+        started_ = true;
+
+        int nn_workers = _srs_config->get_threads_gb28181();
+        for (int i = 0; i < nn_workers; i++) {
+            SrsGbMediaWorker* worker = new SrsGbMediaWorker();
+
+            if ((err = worker->start()) != srs_success) {
+                srs_warn("GB: ignore start worker err %s", srs_error_desc(err).c_str());
+                srs_freep(err);
+                srs_freep(worker);
+                break;
             }
-            stream->skip(1);
+
+            workers_.push_back(worker);
+        }
+
+        srs_trace("GB: start %d media workers", (int)workers_.size());
+    }
+
+    if (workers_.empty()) {
+        return NULL;
+    }
+
+    // Select worker by SSRC, so the camera always sticks to the same thread.
+    SrsGbMediaWorker* worker = workers_.at(ssrc % workers_.size());
+
+    SrsGbMediaChannel* channel = worker->create_channel();
+    if (!channel) {
+        srs_warn("GB: demux ssrc=%u in ST thread for worker queue full", ssrc);
+    }
+
+    return channel;
+}
+
+void SrsGbMediaWorkers::stop()
+{
+    // Never start the workers again, the new cameras demux in ST thread.
+    started_ = true;
+
+    // Note that the workers are never freed, because the channels of cameras still refer to them.
+    for (int i = 0; i < (int)workers_.size(); i++) {
+        SrsGbMediaWorker* worker = workers_.at(i);
+        worker->stop();
+    }
+    workers_.clear();
+}
+
+SrsGbMediaWorkers* _srs_gb_workers = new SrsGbMediaWorkers();
+
+bool srs_skip_util_pack(SrsBuffer* stream)
+{
+    if (!stream->require(4)) {
+        return false;
+    }
+
+    // Search the last byte 0xba of pack header by memchr, which is vectorized by libc, then check the prefix
+    // 00 00 01, so we jump straight to the next pack header. Note that 0xba is much more rare than 0x00 in payload.
+    char* start = stream->head();
+    char* end = start + stream->left();
+    for (char* p = start + 3; p < end; p++) {
+        if ((p = (char*)memchr(p, 0xba, end - p)) == NULL) {
+            break;
+        }
+
+        if (p[-3] == 0x00 && p[-2] == 0x00 && p[-1] == 0x01) {
+            stream->skip((int)(p - 3 - start));
+            return true;
         }
     }
 
+    // Keep the last 3 bytes, which might be the start of pack header.
+    stream->skip(stream->left() - 3);
     return false;
 }
 
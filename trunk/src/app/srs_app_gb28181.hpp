@@ -33,7 +33,7 @@ class SrsGbSipTcpReceiver;
 class SrsGbSipTcpSender;
 class SrsAlonePithyPrint;
 class SrsGbMuxer;
-class SrsSimpleRtmpClient;
+class SrsCasterPublisher;
 struct SrsRawAacStreamCodec;
 class SrsRawH264Stream;
 #ifdef SRS_H265
@@ -42,6 +42,13 @@ class SrsRawHEVCStream;
 class SrsSharedPtrMessage;
 class SrsPithyPrint;
 class SrsRawAacStream;
+class SrsGbPsDemuxer;
+class SrsGbMediaChannel;
+class SrsGbMediaPacket;
+class SrsThreadCond;
+class SrsThreadEntry;
+template<typename T>
+class SrsThreadQueue;
 
 // The state machine for GB session.
 // init:
@@ -136,6 +143,10 @@ private:
     SrsSharedResource<SrsGbSipTcpConn> sip_;
     SrsSharedResource<SrsGbMediaTcpConn> media_;
     SrsGbMuxer* muxer_;
+    // The video frame grouped from PES messages in pack, reused for each pack.
+    SrsTsMessage* video_;
+    // Signal to drive the state machine, when state of SIP or media changed.
+    srs_cond_t wait_;
 private:
     // The candidate for SDP in configuration.
     std::string candidate_;
@@ -188,12 +199,16 @@ public:
     void on_media_transport(SrsSharedResource<SrsGbMediaTcpConn> media);
     // Get the candidate for SDP generation, the public IP address for device to connect to.
     std::string pip();
+    // Notify session to drive the state machine, when state of SIP or media changed.
+    void notify();
 // Interface ISrsCoroutineHandler
 public:
     virtual srs_error_t cycle();
 private:
     virtual srs_error_t do_cycle();
     srs_error_t drive_state();
+    // The time to wait for event, util the next timeout of state machine.
+    srs_utime_t drive_timeout();
 private:
     SrsGbSessionState set_state(SrsGbSessionState v);
 // Interface ISrsResource
@@ -397,7 +412,15 @@ private:
     ISrsContextIdSetter* owner_cid_;
     SrsContextId cid_;
 private:
+    // For statistic of media, and also to group PS packs when demux in current thread.
     SrsPackContext* pack_;
+    // To demux PS in current thread, when no worker threads.
+    SrsGbPsDemuxer* demuxer_;
+    // To demux PS in the worker thread selected by SSRC, NULL if no worker threads.
+    SrsGbMediaChannel* channel_;
+    // The stream type of latest PSM demuxed by worker, which is reported by current coroutine.
+    SrsTsStream worker_video_stream_type_;
+    SrsTsStream worker_audio_stream_type_;
     SrsTcpConnection* conn_;
     uint8_t* buffer_;
 public:
@@ -433,6 +456,13 @@ public:
 private:
     // Create session if no one, or bind to an existed session.
     srs_error_t bind_session(uint32_t ssrc, SrsGbSession** psession);
+    // Read the 2 bytes length of RTP packet. If demux in worker thread, it returns ERROR_SOCKET_TIMEOUT when no packet
+    // for a while, to consume the demuxed packs.
+    srs_error_t read_length(uint8_t* lbuffer);
+    // Push the packet to worker thread, wait for the worker if queue is full.
+    srs_error_t push_packet(SrsGbMediaPacket* pkt);
+    // Consume the packs demuxed by worker thread.
+    srs_error_t consume_packs();
 };
 
 // The queue for mpegts over udp to send packets.
@@ -460,7 +490,7 @@ private:
     // The owner session object, note that we use the raw pointer and should never free it.
     SrsGbSession* session_;
     std::string output_;
-    SrsSimpleRtmpClient* sdk_;
+    SrsCasterPublisher* sdk_;
 private:
     SrsRawH264Stream* avc_;
     std::string h264_sps_;
@@ -503,9 +533,9 @@ private:
     virtual srs_error_t write_audio_raw_frame(char* frame, int frame_size, SrsRawAacStreamCodec* codec, uint32_t dts);
     virtual srs_error_t rtmp_write_packet(char type, uint32_t timestamp, char* data, int size);
 private:
-    // Connect to RTMP server.
+    // Start to publish the stream, to the source in process or the RTMP server.
     virtual srs_error_t connect();
-    // Close the connection to RTMP server.
+    // Stop publishing the stream.
     virtual void close();
 };
 
@@ -691,6 +721,8 @@ private:
     SrsPsPacket* ps_;
     // The messages in current PS pack.
     std::vector<SrsTsMessage*> msgs_;
+    // The messages to reuse, with the payload buffer which keeps its capacity.
+    std::vector<SrsTsMessage*> free_msgs_;
 public:
     SrsPackContext(ISrsPsPackHandler* handler);
     virtual ~SrsPackContext();
@@ -702,6 +734,162 @@ public:
     virtual void on_recover_mode(int nn_recover);
 };
 
+// The PS demuxer for a media transport, to demux RTP packets to PS packs. Note that the bytes not parsed in previous
+// packet are reserved, and decoded with the next packet.
+class SrsGbPsDemuxer
+{
+private:
+    SrsRecoverablePsContext context_;
+    // The pack context to group PES messages to PS pack, not owned by demuxer.
+    SrsPackContext* pack_;
+    // The bytes left by previous packet.
+    uint8_t* reserved_bytes_;
+    int reserved_;
+public:
+    SrsGbPsDemuxer(SrsPackContext* pack);
+    virtual ~SrsGbPsDemuxer();
+public:
+    // Set whether never write log, for demuxer in worker thread.
+    void set_quiet(bool v);
+    // Demux the RTP packet of length bytes. Note that there must be SRS_GB_MAX_RESERVED bytes before p, to prepend the
+    // reserved bytes of previous packet.
+    srs_error_t decode(uint8_t* p, int length);
+};
+
+// The RTP packet from media transport to worker, with the room before payload for reserved bytes.
+class SrsGbMediaPacket
+{
+public:
+    uint8_t* data_;
+    int size_;
+public:
+    SrsGbMediaPacket(int size);
+    virtual ~SrsGbMediaPacket();
+public:
+    // The start of RTP packet, after the room for reserved bytes.
+    uint8_t* payload();
+};
+
+// The PS pack demuxed by worker, with a copy of the PS context for muxer, reused to avoid allocating messages.
+class SrsGbMediaPack
+{
+public:
+    SrsPsContext* ctx_;
+    SrsPsPacket* ps_;
+    SrsPsDecodeHelper helper_;
+    // The messages in pack, which refer to the helper of pack.
+    std::vector<SrsTsMessage*> msgs_;
+    // The messages to reuse, with the payload buffer which keeps its capacity.
+    std::vector<SrsTsMessage*> free_msgs_;
+    // The snapshot of media statistic, when pack is demuxed.
+    uint64_t media_nn_recovered_;
+    uint64_t media_nn_msgs_dropped_;
+    uint64_t media_reserved_;
+public:
+    SrsGbMediaPack();
+    virtual ~SrsGbMediaPack();
+public:
+    // Move the messages to free list, to reuse the pack.
+    void clear();
+};
+
+// The media channel of a camera, demux the RTP packets from ST thread to PS packs in a worker thread. The channel is
+// created by ST thread, then owned and freed by worker thread after closed by ST thread.
+class SrsGbMediaChannel : public ISrsPsPackHandler
+{
+public:
+    // The RTP packets from ST thread to worker.
+    SrsThreadQueue<SrsGbMediaPacket*>* packets_;
+    // The demuxed packs from worker to ST thread.
+    SrsThreadQueue<SrsGbMediaPack*>* packs_;
+    // The consumed packs from ST thread to worker, to reuse.
+    SrsThreadQueue<SrsGbMediaPack*>* free_packs_;
+private:
+    // The condition of worker, to wakeup the worker by ST thread.
+    SrsThreadCond* cond_;
+    // Set by ST thread, never touch the channel after closed.
+    bool closed_;
+    // Set by worker thread, when failed to demux the packets.
+    bool failed_;
+    // The error of worker thread, which is never changed after failed.
+    srs_error_t err_;
+    // The packs demuxed by worker thread but not pushed for queue full, which are pushed before demuxing more packets.
+    std::vector<SrsGbMediaPack*> pending_packs_;
+    SrsPackContext* pack_;
+    SrsGbPsDemuxer* demuxer_;
+public:
+    SrsGbMediaChannel(SrsThreadCond* cond);
+    virtual ~SrsGbMediaChannel();
+public:
+    // Wakeup the worker by ST thread, after pushing packets or consuming packs.
+    void wakeup();
+    // Close the channel by ST thread, the worker will free it.
+    void close();
+    bool closed();
+    bool failed();
+    // Fail the channel by worker thread, the err is reported by ST thread.
+    void fail(srs_error_t err);
+    // Get a copy of the error of worker thread, for ST thread.
+    srs_error_t error();
+    // Demux the packets in worker thread, return the number of consumed packets and pushed pending packs.
+    int consume();
+private:
+    // Push the pending packs to ST thread, return false if queue is full.
+    bool flush_pending_packs(int& nn);
+// Interface ISrsPsPackHandler
+public:
+    virtual srs_error_t on_ps_pack(SrsPsPacket* ps, const std::vector<SrsTsMessage*>& msgs);
+};
+
+// The worker thread to demux the PS stream of media channels.
+class SrsGbMediaWorker
+{
+private:
+    // The new channels from ST thread to worker.
+    SrsThreadQueue<SrsGbMediaChannel*>* attached_;
+    // The channels owned by worker thread.
+    std::vector<SrsGbMediaChannel*> channels_;
+    // The worker waits on the condition when idle, signaled by ST thread.
+    SrsThreadCond* cond_;
+    int quit_;
+    SrsThreadEntry* entry_;
+public:
+    SrsGbMediaWorker();
+    virtual ~SrsGbMediaWorker();
+public:
+    // Create and attach channel to worker, by ST thread. Return NULL if queue is full.
+    SrsGbMediaChannel* create_channel();
+    // Demux all channels once, return the number of consumed packets.
+    int consume();
+    // Start the worker thread.
+    srs_error_t start();
+    // Stop and join the worker thread, the channels still used by ST thread are failed.
+    void stop();
+    static srs_error_t start(void* arg);
+private:
+    srs_error_t cycle();
+};
+
+// The workers to demux PS stream of cameras in multiple threads. The worker is selected by SSRC, so packets of a
+// camera are always demuxed by the same thread.
+class SrsGbMediaWorkers
+{
+private:
+    bool started_;
+    std::vector<SrsGbMediaWorker*> workers_;
+public:
+    SrsGbMediaWorkers();
+    virtual ~SrsGbMediaWorkers();
+public:
+    // Create a channel in worker selected by ssrc, return NULL if no worker threads. Note that the worker threads are
+    // started for the first time.
+    SrsGbMediaChannel* create_channel(uint32_t ssrc);
+    // Stop all worker threads, and never start again.
+    void stop();
+};
+
+extern SrsGbMediaWorkers* _srs_gb_workers;
+
 // Find the pack header which starts with bytes (00 00 01 ba).
 extern bool srs_skip_util_pack(SrsBuffer* stream);
 
@@ -34,6 +34,7 @@ using namespace std;
 #include <srs_app_utility.hpp>
 #include <srs_app_http_hooks.hpp>
 #include <srs_protocol_format.hpp>
+#include <srs_protocol_utility.hpp>
 #include <openssl/rand.h>
 
 // drop the segment when duration of ts too small.
@@ -204,6 +205,7 @@ SrsHlsMuxer::SrsHlsMuxer()
     segments = new SrsFragmentWindow();
     latest_acodec_ = SrsAudioCodecIdForbidden;
     latest_vcodec_ = SrsVideoCodecIdForbidden;
+    bandwidth_ = 0;
     
     memset(key, 0, 16);
     memset(iv, 0, 16);
@@ -265,6 +267,16 @@ int SrsHlsMuxer::deviation()
     return deviation_ts;
 }
 
+string SrsHlsMuxer::m3u8_path()
+{
+    return m3u8;
+}
+
+int SrsHlsMuxer::bandwidth()
+{
+    return bandwidth_;
+}
+
 SrsAudioCodecId SrsHlsMuxer::latest_acodec()
 {
     // If current context writer exists, we query from it.
@@ -347,7 +359,8 @@ srs_error_t SrsHlsMuxer::update_config(SrsRequest* r, string entry_prefix,
     deviation_ts = 0;
 
     hls_keys = keys;
-    hls_fragments_per_key = fragments_per_key;
+    // Rotate the key for each segment at most.
+    hls_fragments_per_key = srs_max(1, fragments_per_key);
     hls_key_file = key_file;
     hls_key_file_path = key_file_path;
     hls_key_url = key_url;
@@ -555,6 +568,14 @@ bool SrsHlsMuxer::wait_keyframe()
     return hls_wait_keyframe;
 }
 
+bool SrsHlsMuxer::is_segment_reapable()
+{
+    srs_assert(current);
+
+    // to prevent very small segment.
+    return current->duration() >= 2 * SRS_HLS_SEGMENT_MIN_DURATION;
+}
+
 bool SrsHlsMuxer::is_segment_absolutely_overflow()
 {
     srs_assert(current);
@@ -658,7 +679,9 @@ srs_error_t SrsHlsMuxer::do_segment_close()
     srs_assert(current);
 
     // We should always close the underlayer writer.
+    int64_t nb_bytes = 0;
     if (current && current->writer) {
+        nb_bytes = current->writer->tellg();
         current->writer->close();
     }
     
@@ -685,6 +708,12 @@ srs_error_t SrsHlsMuxer::do_segment_close()
             return srs_error_wrap(err, "segment close");
         }
         
+        // Update the peak bitrate, for the BANDWIDTH of master playlist.
+        if (current->duration() > 0) {
+            int bps = (int)(nb_bytes * 8 * SRS_UTIME_SECONDS / current->duration());
+            bandwidth_ = srs_max(bandwidth_, bps);
+        }
+
         // close the muxer of finished segment.
         srs_freep(current->tscw);
 
@@ -725,11 +754,11 @@ srs_error_t SrsHlsMuxer::write_hls_key()
     srs_error_t err = srs_success;
     
     if (hls_keys && current->sequence_no % hls_fragments_per_key == 0) {
-        if (RAND_bytes(key, 16) < 0) {
-            return srs_error_wrap(err, "rand key failed.");
+        if (RAND_bytes(key, 16) != 1) {
+            return srs_error_new(ERROR_HLS_WRITE_FAILED, "rand key failed.");
         }
-        if (RAND_bytes(iv, 16) < 0) {
-            return srs_error_wrap(err, "rand iv failed.");
+        if (RAND_bytes(iv, 16) != 1) {
+            return srs_error_new(ERROR_HLS_WRITE_FAILED, "rand iv failed.");
         }
         
         string key_file = srs_path_build_stream(hls_key_file, req->vhost, req->app, req->stream);
@@ -833,13 +862,16 @@ srs_error_t SrsHlsMuxer::_refresh_m3u8(string m3u8_file)
             ss << "#EXT-X-DISCONTINUITY" << SRS_CONSTS_LF;
         }
         
-        if(hls_keys && ((segment->sequence_no % hls_fragments_per_key) == 0)) {
+        // The key is rotated every hls_fragments_per_key segments, and the first segment in the playlist also
+        // needs the key, which is generated by the segment of key sequence.
+        if (hls_keys && (i == 0 || (segment->sequence_no % hls_fragments_per_key) == 0)) {
             char hexiv[33];
             srs_data_to_hex(hexiv, segment->iv, 16);
             hexiv[32] = '\0';
-            
+
+            int key_seq = segment->sequence_no - (segment->sequence_no % hls_fragments_per_key);
             string key_file = srs_path_build_stream(hls_key_file, req->vhost, req->app, req->stream);
-            key_file = srs_string_replace(key_file, "[seq]", srs_int2str(segment->sequence_no));
+            key_file = srs_string_replace(key_file, "[seq]", srs_int2str(key_seq));
             
             string key_path = key_file;
             //if key_url is not set,only use the file name
@@ -875,14 +907,184 @@ srs_error_t SrsHlsMuxer::_refresh_m3u8(string m3u8_file)
     return err;
 }
 
+SrsHlsVariant::SrsHlsVariant()
+{
+    bandwidth = 0;
+    width = 0;
+    height = 0;
+}
+
+// The HLS groups, key is the path of master playlist.
+static std::map<std::string, SrsHlsGroup*> _srs_hls_groups;
+
+SrsHlsGroup::SrsHlsGroup(string master)
+{
+    master_ = master;
+    nn_refs_ = 0;
+    reap_dts_ = -1;
+}
+
+SrsHlsGroup::~SrsHlsGroup()
+{
+}
+
+SrsHlsGroup* SrsHlsGroup::acquire(string master)
+{
+    SrsHlsGroup* group = NULL;
+
+    std::map<std::string, SrsHlsGroup*>::iterator it = _srs_hls_groups.find(master);
+    if (it != _srs_hls_groups.end()) {
+        group = it->second;
+    } else {
+        group = new SrsHlsGroup(master);
+        _srs_hls_groups[master] = group;
+    }
+
+    group->nn_refs_++;
+    return group;
+}
+
+void SrsHlsGroup::release(SrsHlsGroup* group)
+{
+    if (!group || --group->nn_refs_ > 0) {
+        return;
+    }
+
+    // Remove the master playlist, because there is no rendition.
+    if (srs_path_exists(group->master_) && unlink(group->master_.c_str()) < 0) {
+        srs_warn("ignore remove master playlist failed, %s", group->master_.c_str());
+    }
+
+    _srs_hls_groups.erase(group->master_);
+    srs_freep(group);
+}
+
+bool SrsHlsGroup::is_valid_name(string name)
+{
+    if (name.empty()) {
+        return false;
+    }
+
+    for (int i = 0; i < (int)name.length(); i++) {
+        char ch = name.at(i);
+        if ((ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9') || ch == '_' || ch == '-') {
+            continue;
+        }
+        return false;
+    }
+
+    return true;
+}
+
+string SrsHlsGroup::master()
+{
+    return master_;
+}
+
+bool SrsHlsGroup::should_reap(int64_t dts, int64_t last_reap_dts)
+{
+    // Some rendition has reaped a segment after ours, and we got the keyframe at the same or later
+    // timestamp, so we should reap to align the segment.
+    return reap_dts_ > last_reap_dts && dts >= reap_dts_;
+}
+
+void SrsHlsGroup::on_reap(int64_t dts)
+{
+    reap_dts_ = srs_max(reap_dts_, dts);
+}
+
+srs_error_t SrsHlsGroup::update(string uri, const SrsHlsVariant& variant)
+{
+    std::map<std::string, SrsHlsVariant>::iterator it = variants_.find(uri);
+    if (it != variants_.end()) {
+        SrsHlsVariant& v = it->second;
+        if (v.bandwidth == variant.bandwidth && v.width == variant.width && v.height == variant.height) {
+            return srs_success;
+        }
+    }
+
+    variants_[uri] = variant;
+    return refresh_master();
+}
+
+srs_error_t SrsHlsGroup::remove(string uri)
+{
+    if (variants_.erase(uri) == 0) {
+        return srs_success;
+    }
+
+    return refresh_master();
+}
+
+srs_error_t SrsHlsGroup::refresh_master()
+{
+    srs_error_t err = srs_success;
+
+    // #EXTM3U\n
+    // #EXT-X-VERSION:3\n
+    // #EXT-X-STREAM-INF:BANDWIDTH=800000,RESOLUTION=640x360\n
+    // livestream_360p.m3u8\n
+    std::stringstream ss;
+    ss << "#EXTM3U" << SRS_CONSTS_LF;
+    ss << "#EXT-X-VERSION:3" << SRS_CONSTS_LF;
+
+    int nn_variants = 0;
+    for (std::map<std::string, SrsHlsVariant>::iterator it = variants_.begin(); it != variants_.end(); ++it) {
+        const SrsHlsVariant& v = it->second;
+
+        // Ignore the variant without any segment, for player requires the BANDWIDTH.
+        if (v.bandwidth <= 0) {
+            continue;
+        }
+
+        ss << "#EXT-X-STREAM-INF:BANDWIDTH=" << v.bandwidth;
+        if (v.width > 0 && v.height > 0) {
+            ss << ",RESOLUTION=" << v.width << "x" << v.height;
+        }
+        ss << SRS_CONSTS_LF << it->first << SRS_CONSTS_LF;
+        nn_variants++;
+    }
+
+    // No variant, also no master playlist.
+    if (!nn_variants) {
+        return err;
+    }
+
+    std::string temp_master = master_ + ".temp";
+    SrsFileWriter writer;
+    if ((err = writer.open(temp_master)) != srs_success) {
+        return srs_error_wrap(err, "hls: open master file %s", temp_master.c_str());
+    }
+
+    std::string master = ss.str();
+    err = writer.write((char*)master.c_str(), (int)master.length(), NULL);
+    writer.close();
+
+    if (err == srs_success && rename(temp_master.c_str(), master_.c_str()) < 0) {
+        err = srs_error_new(ERROR_HLS_WRITE_FAILED, "hls: rename master file failed. %s => %s", temp_master.c_str(), master_.c_str());
+    }
+
+    // remove the temp file.
+    if (srs_path_exists(temp_master)) {
+        if (unlink(temp_master.c_str()) < 0) {
+            srs_warn("ignore remove master failed, %s", temp_master.c_str());
+        }
+    }
+
+    return err;
+}
+
 SrsHlsController::SrsHlsController()
 {
     tsmc = new SrsTsMessageCache();
     muxer = new SrsHlsMuxer();
+    group_ = NULL;
+    last_reap_dts_ = -1;
 }
 
 SrsHlsController::~SrsHlsController()
 {
+    leave_group();
     srs_freep(muxer);
     srs_freep(tsmc);
 }
@@ -971,6 +1173,10 @@ srs_error_t SrsHlsController::on_publish(SrsRequest* req)
         return srs_error_wrap(err, "hls: segment open");
     }
 
+    if ((err = join_group(req)) != srs_success) {
+        return srs_error_wrap(err, "hls: join group");
+    }
+
     // This config item is used in SrsHls, we just log its value here.
     bool hls_dts_directly = _srs_config->get_vhost_hls_dts_directly(req->vhost);
 
@@ -996,6 +1202,8 @@ srs_error_t SrsHlsController::on_unpublish()
     if ((err = muxer->on_unpublish()) != srs_success) {
         return srs_error_wrap(err, "muxer unpublish");
     }
+
+    leave_group();
     
     return err;
 }
@@ -1082,16 +1290,34 @@ srs_error_t SrsHlsController::write_video(SrsVideoFrame* frame, int64_t dts)
     // cover from the first frame to the last frame.
     muxer->update_duration(tsmc->video->dts);
     
+    bool keyframe = frame->frame_type == SrsVideoAvcFrameTypeKeyFrame;
+    if (keyframe && group_) {
+        variant_.width = frame->vcodec()->width;
+        variant_.height = frame->vcodec()->height;
+    }
+
+    // For rendition of HLS group, reap at the keyframe where other rendition reaped, to align segments.
+    bool follow = keyframe && group_ && group_->should_reap(dts, last_reap_dts_) && muxer->is_segment_reapable();
+
     // when segment overflow, reap if possible.
-    if (muxer->is_segment_overflow()) {
-        // do reap ts if any of:
-        //      a. wait keyframe and got keyframe.
-        //      b. always reap when not wait keyframe.
-        if (!muxer->wait_keyframe() || frame->frame_type == SrsVideoAvcFrameTypeKeyFrame) {
-            // reap the segment, which will also flush the video.
-            if ((err = reap_segment()) != srs_success) {
-                return srs_error_wrap(err, "hls: reap segment");
-            }
+    // do reap ts if any of:
+    //      a. wait keyframe and got keyframe.
+    //      b. always reap when not wait keyframe.
+    //      c. follow other renditions of HLS group.
+    if (follow || (muxer->is_segment_overflow() && (!muxer->wait_keyframe() || keyframe))) {
+        // reap the segment, which will also flush the video.
+        if ((err = reap_segment()) != srs_success) {
+            return srs_error_wrap(err, "hls: reap segment");
+        }
+
+        // Notify other renditions to reap at the same keyframe.
+        if (group_ && keyframe) {
+            last_reap_dts_ = dts;
+            group_->on_reap(dts);
+        }
+
+        if ((err = update_group()) != srs_success) {
+            return srs_error_wrap(err, "hls: update group");
         }
     }
     
@@ -1142,6 +1368,71 @@ srs_error_t SrsHlsController::reap_segment()
     return err;
 }
 
+srs_error_t SrsHlsController::join_group(SrsRequest* req)
+{
+    srs_error_t err = srs_success;
+
+    leave_group();
+
+    std::map<std::string, std::string> query;
+    srs_parse_query_string(srs_string_trim_start(req->param, "?"), query);
+
+    // Only the stream tagged by hls_group, for example, livestream_720p?hls_group=livestream
+    std::string name = query["hls_group"];
+    if (name.empty()) {
+        return err;
+    }
+
+    // The name is part of the path of master playlist, so never allow the path traversal, such as ../
+    if (!SrsHlsGroup::is_valid_name(name)) {
+        srs_warn("hls: ignore group of %s, invalid name %s", req->get_stream_url().c_str(), name.c_str());
+        return err;
+    }
+
+    // The master playlist is in the same directory of renditions, so the uri is relative.
+    std::string m3u8 = muxer->m3u8_path();
+    group_ = SrsHlsGroup::acquire(srs_path_dirname(m3u8) + "/" + name + "_master.m3u8");
+    variant_uri_ = srs_path_basename(m3u8);
+    variant_ = SrsHlsVariant();
+    variant_.bandwidth = ::atoi(query["hls_bandwidth"].c_str());
+    last_reap_dts_ = -1;
+
+    srs_trace("hls: join group %s, variant=%s, bandwidth=%d", group_->master().c_str(), variant_uri_.c_str(), variant_.bandwidth);
+
+    return update_group();
+}
+
+void SrsHlsController::leave_group()
+{
+    if (!group_) {
+        return;
+    }
+
+    srs_error_t err = group_->remove(variant_uri_);
+    if (err != srs_success) {
+        srs_warn("ignore hls group err %s", srs_error_desc(err).c_str());
+        srs_freep(err);
+    }
+
+    SrsHlsGroup::release(group_);
+    group_ = NULL;
+}
+
+srs_error_t SrsHlsController::update_group()
+{
+    if (!group_) {
+        return srs_success;
+    }
+
+    // Use the bandwidth in stream param if specified, or the measured peak bitrate.
+    SrsHlsVariant variant = variant_;
+    if (variant.bandwidth <= 0) {
+        variant.bandwidth = muxer->bandwidth();
+    }
+
+    return group_->update(variant_uri_, variant);
+}
+
 SrsHls::SrsHls()
 {
     req = NULL;
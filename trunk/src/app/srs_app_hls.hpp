@@ -11,6 +11,7 @@
 
 #include <string>
 #include <vector>
+#include <map>
 
 #include <srs_kernel_codec.hpp>
 #include <srs_kernel_file.hpp>
@@ -161,6 +162,8 @@ private:
     SrsAudioCodecId latest_acodec_;
     // Latest audio codec, parsed from stream.
     SrsVideoCodecId latest_vcodec_;
+    // The peak bitrate in bps of segments, for master playlist.
+    int bandwidth_;
 public:
     SrsHlsMuxer();
     virtual ~SrsHlsMuxer();
@@ -171,6 +174,8 @@ public:
     virtual std::string ts_url();
     virtual srs_utime_t duration();
     virtual int deviation();
+    virtual std::string m3u8_path();
+    virtual int bandwidth();
 public:
     SrsAudioCodecId latest_acodec();
     void set_latest_acodec(SrsAudioCodecId v);
@@ -196,6 +201,8 @@ public:
     virtual bool is_segment_overflow();
     // Whether wait keyframe to reap the ts.
     virtual bool wait_keyframe();
+    // Whether segment is long enough to reap, to follow the renditions of HLS group.
+    virtual bool is_segment_reapable();
     // Whether segment absolutely overflow, for pure audio to reap segment,
     // that is whether the current segment duration>=2*(the segment in config)
     virtual bool is_segment_absolutely_overflow();
@@ -217,6 +224,51 @@ private:
     virtual srs_error_t _refresh_m3u8(std::string m3u8_file);
 };
 
+// The variant of HLS group, which is a rendition of the logical stream.
+class SrsHlsVariant
+{
+public:
+    // The peak bitrate in bps, and the resolution of video.
+    int bandwidth;
+    int width;
+    int height;
+public:
+    SrsHlsVariant();
+};
+
+// The group of HLS streams, which are renditions of a logical stream, for example, transcoded by
+// the ladder of transcode. It generates the master playlist of the renditions, and aligns the
+// segments by reaping on the same keyframe timestamp, so player is able to switch between them.
+class SrsHlsGroup
+{
+private:
+    std::string master_;
+    int nn_refs_;
+    // The variants, key is the uri of m3u8 relative to master.
+    std::map<std::string, SrsHlsVariant> variants_;
+    // The keyframe timestamp in 90kHz, on which the latest segment is reaped by any rendition.
+    int64_t reap_dts_;
+public:
+    SrsHlsGroup(std::string master);
+    virtual ~SrsHlsGroup();
+public:
+    // Fetch or create the group for master playlist, and release it when unpublish.
+    static SrsHlsGroup* acquire(std::string master);
+    static void release(SrsHlsGroup* group);
+    // Whether the name of group is valid, which is part of file path, so only [A-Za-z0-9_-] is allowed.
+    static bool is_valid_name(std::string name);
+public:
+    std::string master();
+    // Whether the rendition should reap segment at keyframe, to follow other renditions.
+    bool should_reap(int64_t dts, int64_t last_reap_dts);
+    void on_reap(int64_t dts);
+    // Update the variant, and refresh the master playlist if changed.
+    srs_error_t update(std::string uri, const SrsHlsVariant& variant);
+    srs_error_t remove(std::string uri);
+private:
+    srs_error_t refresh_master();
+};
+
 // The hls stream cache,
 // use to cache hls stream and flush to hls muxer.
 //
@@ -240,6 +292,12 @@ private:
     SrsHlsMuxer* muxer;
     // The TS cache
     SrsTsMessageCache* tsmc;
+private:
+    // The HLS group if the stream is a rendition, tagged by hls_group in stream param.
+    SrsHlsGroup* group_;
+    std::string variant_uri_;
+    SrsHlsVariant variant_;
+    int64_t last_reap_dts_;
 public:
     SrsHlsController();
     virtual ~SrsHlsController();
@@ -269,6 +327,10 @@ private:
     // then write the key frame to the new segment.
     // so, user must reap_segment then flush_video to hls muxer.
     virtual srs_error_t reap_segment();
+    // Join or leave the HLS group, and update the variant of group.
+    virtual srs_error_t join_group(SrsRequest* req);
+    virtual void leave_group();
+    virtual srs_error_t update_group();
 };
 
 // Transmux RTMP stream to HLS(m3u8 and ts).
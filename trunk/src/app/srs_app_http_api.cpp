@@ -30,6 +30,8 @@ using namespace std;
 #include <srs_protocol_amf0.hpp>
 #include <srs_protocol_utility.hpp>
 #include <srs_app_coworkers.hpp>
+#include <srs_app_edge.hpp>
+#include <srs_kernel_balance.hpp>
 
 #ifdef SRS_VALGRIND
 #include <valgrind/valgrind.h>
@@ -257,6 +259,7 @@ srs_error_t SrsGoApiV1::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r
     obj->set("urls", urls);
     
     urls->set("versions", SrsJsonAny::str("the version of SRS"));
+    urls->set("utc", SrsJsonAny::str("the UTC time of SRS in ISO 8601, for UTCTiming of LL-DASH"));
     urls->set("summaries", SrsJsonAny::str("the summary(pid, argv, pwd, cpu, mem) of SRS"));
     urls->set("rusages", SrsJsonAny::str("the rusage of SRS"));
     urls->set("self_proc_stats", SrsJsonAny::str("the self process stats"));
@@ -320,6 +323,43 @@ srs_error_t SrsGoApiVersion::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessa
     return srs_api_response(w, r, obj->dumps());
 }
 
+SrsGoApiUtcTiming::SrsGoApiUtcTiming()
+{
+}
+
+SrsGoApiUtcTiming::~SrsGoApiUtcTiming()
+{
+}
+
+srs_error_t SrsGoApiUtcTiming::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
+{
+    srs_error_t err = srs_success;
+
+    // Use the realtime clock, not the cached time of ST.
+    srs_utime_t now = srs_update_system_time();
+    time_t s = srsu2s(now);
+    struct tm t;
+    if (gmtime_r(&s, &t) == NULL) {
+        return srs_error_new(ERROR_SYSTEM_TIME, "gmtime");
+    }
+
+    // For urn:mpeg:dash:utc:http-iso:2014, for example, 2024-01-01T08:00:00.123Z
+    char buf[64];
+    int nb = (int)strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &t);
+    nb += snprintf(buf + nb, sizeof(buf) - nb, ".%03dZ", (int)(srsu2ms(now) % 1000));
+
+    SrsHttpHeader* h = w->header();
+    h->set_content_length(nb);
+    h->set_content_type("text/plain");
+    h->set("Cache-Control", "no-cache");
+
+    if ((err = w->write(buf, nb)) != srs_success) {
+        return srs_error_wrap(err, "write utc");
+    }
+
+    return err;
+}
+
 SrsGoApiSummaries::SrsGoApiSummaries()
 {
 }
@@ -771,42 +811,46 @@ srs_error_t SrsGoApiStreams::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessa
         return srs_api_response_code(w, r, ERROR_RTMP_STREAM_NOT_FOUND);
     }
 
-    SrsUniquePtr<SrsJsonObject> obj(SrsJsonAny::object());
+    // Write JSON directly to buffer, never build the JSON tree for streams.
+    std::string buf;
+    SrsJsonWriter obj(&buf);
     
-    obj->set("code", SrsJsonAny::integer(ERROR_SUCCESS));
-    obj->set("server", SrsJsonAny::str(stat->server_id().c_str()));
-    obj->set("service", SrsJsonAny::str(stat->service_id().c_str()));
-    obj->set("pid", SrsJsonAny::str(stat->service_pid().c_str()));
+    obj.object_start();
+    obj.integer("code", ERROR_SUCCESS);
+    obj.str("server", stat->server_id());
+    obj.str("service", stat->service_id());
+    obj.str("pid", stat->service_pid());
     
     if (r->is_http_get()) {
         if (!stream) {
-            SrsJsonArray* data = SrsJsonAny::array();
-            obj->set("streams", data);
-
             std::string rstart = r->query_get("start");
             std::string rcount = r->query_get("count");
             int start = srs_max(0, atoi(rstart.c_str()));
             int count = srs_max(10, atoi(rcount.c_str()));
-            if ((err = stat->dumps_streams(data, start, count)) != srs_success) {
+
+            obj.array_start("streams");
+            if ((err = stat->dumps_streams(&obj, start, count)) != srs_success) {
                 int code = srs_error_code(err);
                 srs_error_reset(err);
                 return srs_api_response_code(w, r, code);
             }
+            obj.array_end();
         } else {
-            SrsJsonObject* data = SrsJsonAny::object();
-            obj->set("stream", data);;
-            
-            if ((err = stream->dumps(data)) != srs_success) {
+            obj.object_start("stream");
+            if ((err = stream->dumps(&obj)) != srs_success) {
                 int code = srs_error_code(err);
                 srs_error_reset(err);
                 return srs_api_response_code(w, r, code);
             }
+            obj.object_end();
         }
     } else {
         return srs_go_http_error(w, SRS_CONSTS_HTTP_MethodNotAllowed);
     }
     
-    return srs_api_response(w, r, obj->dumps());
+    obj.object_end();
+    
+    return srs_api_response(w, r, buf);
 }
 
 SrsGoApiClients::SrsGoApiClients()
@@ -832,36 +876,38 @@ srs_error_t SrsGoApiClients::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessa
         return srs_api_response_code(w, r, ERROR_RTMP_CLIENT_NOT_FOUND);
     }
 
-    SrsUniquePtr<SrsJsonObject> obj(SrsJsonAny::object());
+    // Write JSON directly to buffer, never build the JSON tree for clients.
+    std::string buf;
+    SrsJsonWriter obj(&buf);
     
-    obj->set("code", SrsJsonAny::integer(ERROR_SUCCESS));
-    obj->set("server", SrsJsonAny::str(stat->server_id().c_str()));
-    obj->set("service", SrsJsonAny::str(stat->service_id().c_str()));
-    obj->set("pid", SrsJsonAny::str(stat->service_pid().c_str()));
+    obj.object_start();
+    obj.integer("code", ERROR_SUCCESS);
+    obj.str("server", stat->server_id());
+    obj.str("service", stat->service_id());
+    obj.str("pid", stat->service_pid());
     
     if (r->is_http_get()) {
         if (!client) {
-            SrsJsonArray* data = SrsJsonAny::array();
-            obj->set("clients", data);
-            
             std::string rstart = r->query_get("start");
             std::string rcount = r->query_get("count");
             int start = srs_max(0, atoi(rstart.c_str()));
             int count = srs_max(10, atoi(rcount.c_str()));
-            if ((err = stat->dumps_clients(data, start, count)) != srs_success) {
+
+            obj.array_start("clients");
+            if ((err = stat->dumps_clients(&obj, start, count)) != srs_success) {
                 int code = srs_error_code(err);
                 srs_error_reset(err);
                 return srs_api_response_code(w, r, code);
             }
+            obj.array_end();
         } else {
-            SrsJsonObject* data = SrsJsonAny::object();
-            obj->set("client", data);
-            
-            if ((err = client->dumps(data)) != srs_success) {
+            obj.object_start("client");
+            if ((err = client->dumps(&obj)) != srs_success) {
                 int code = srs_error_code(err);
                 srs_error_reset(err);
                 return srs_api_response_code(w, r, code);
             }
+            obj.object_end();
         }
     } else if (r->is_http_delete()) {
         if (!client) {
@@ -879,7 +925,9 @@ srs_error_t SrsGoApiClients::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessa
         return srs_go_http_error(w, SRS_CONSTS_HTTP_MethodNotAllowed);
     }
     
-    return srs_api_response(w, r, obj->dumps());
+    obj.object_end();
+    
+    return srs_api_response(w, r, buf);
 }
 
 SrsGoApiRaw::SrsGoApiRaw(SrsServer* svr)
@@ -999,6 +1047,26 @@ srs_error_t SrsGoApiClusters::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMess
     
     SrsCoWorkers* coworkers = SrsCoWorkers::instance();
     data->set("origin", coworkers->dumps(vhost, coworker, app, stream));
+
+    // The health of origin servers, for edge to select origin.
+    SrsJsonArray* origins = SrsJsonAny::array();
+    data->set("balancer", origins);
+
+    srs_utime_t now = srs_get_system_time();
+    map<string, SrsLbServerHealth*>& servers = _srs_edge_origins->servers();
+    for (map<string, SrsLbServerHealth*>::iterator it = servers.begin(); it != servers.end(); ++it) {
+        SrsLbServerHealth* h = it->second;
+        origins->append(SrsJsonAny::object()
+            ->set("server", SrsJsonAny::str(h->server.c_str()))
+            ->set("srtt", SrsJsonAny::integer(srsu2msi(h->srtt)))
+            ->set("rtt", SrsJsonAny::integer(srsu2msi(h->rtt)))
+            ->set("ejected", SrsJsonAny::boolean(h->is_ejected(now)))
+            ->set("eject_left", SrsJsonAny::integer(h->is_ejected(now) ? srsu2msi(h->ejected_until - now) : 0))
+            ->set("failures", SrsJsonAny::integer(h->failures))
+            ->set("nn_selected", SrsJsonAny::integer(h->nn_selected))
+            ->set("nn_success", SrsJsonAny::integer(h->nn_success))
+            ->set("nn_failures", SrsJsonAny::integer(h->nn_failures)));
+    }
     
     return srs_api_response(w, r, obj->dumps());
 }
@@ -69,6 +69,16 @@ public:
     virtual srs_error_t serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
 };
 
+// The UTC time of server in ISO 8601 with milliseconds, for UTCTiming of LL-DASH.
+class SrsGoApiUtcTiming : public ISrsHttpHandler
+{
+public:
+    SrsGoApiUtcTiming();
+    virtual ~SrsGoApiUtcTiming();
+public:
+    virtual srs_error_t serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
+};
+
 class SrsGoApiSummaries : public ISrsHttpHandler
 {
 public:
@@ -366,6 +366,26 @@ srs_error_t SrsHttpxConn::pop_message(ISrsHttpMessage** preq)
     return err;
 }
 
+srs_error_t SrsHttpxConn::enable_zerocopy(int min_bytes)
+{
+    SrsTcpConnection* tcp = dynamic_cast<SrsTcpConnection*>(io_);
+    if (ssl || !tcp) {
+        return srs_error_new(ERROR_SOCKET_ZEROCOPY, "not tcp, ssl=%d", (ssl != NULL));
+    }
+
+    return tcp->enable_zerocopy(min_bytes);
+}
+
+SrsZerocopySender* SrsHttpxConn::zerocopy()
+{
+    SrsTcpConnection* tcp = dynamic_cast<SrsTcpConnection*>(io_);
+    if (ssl || !tcp) {
+        return NULL;
+    }
+
+    return tcp->zerocopy();
+}
+
 srs_error_t SrsHttpxConn::on_start()
 {
     srs_error_t err = srs_success;
@@ -495,6 +515,11 @@ srs_error_t SrsHttpServer::initialize()
     if ((err = http_static->mux.handle("/api/v1/versions", new SrsGoApiVersion())) != srs_success) {
         return srs_error_wrap(err, "handle versions");
     }
+
+    // For the UTCTiming of LL-DASH, which is relative to the MPD served by HTTP server.
+    if ((err = http_static->mux.handle("/api/v1/utc", new SrsGoApiUtcTiming())) != srs_success) {
+        return srs_error_wrap(err, "handle utc");
+    }
     
     if ((err = http_stream->initialize()) != srs_success) {
         return srs_error_wrap(err, "http stream");
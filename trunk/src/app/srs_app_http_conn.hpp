@@ -152,6 +152,10 @@ public:
     // @see https://github.com/ossrs/srs/issues/636#issuecomment-298208427
     // @remark Should only used in HTTP-FLV streaming connection.
     virtual srs_error_t pop_message(ISrsHttpMessage** preq);
+    // Enable MSG_ZEROCOPY for HTTP stream, not for HTTPS because the data is encrypted by SSL.
+    virtual srs_error_t enable_zerocopy(int min_bytes);
+    // Get the zero-copy sender, NULL if disabled.
+    virtual SrsZerocopySender* zerocopy();
 // Interface ISrsHttpConnOwner.
 public:
     virtual srs_error_t on_start();
@@ -33,6 +33,300 @@ using namespace std;
 // the timeout for hls notify, in srs_utime_t.
 #define SRS_HLS_NOTIFY_TIMEOUT (10 * SRS_UTIME_SECONDS)
 
+// The max requests in flight to each hook server.
+#define SRS_HTTP_HOOKS_MAX_INFLIGHT 64
+// The max idle keep-alive connections to each hook server.
+#define SRS_HTTP_HOOKS_MAX_IDLE 16
+// Drop the idle connection, which is very likely closed by the hook server.
+#define SRS_HTTP_HOOKS_IDLE_TIMEOUT (10 * SRS_UTIME_SECONDS)
+// The interval to cleanup the expired decisions.
+#define SRS_HTTP_HOOKS_CACHE_CLEANUP (3 * SRS_UTIME_SECONDS)
+
+SrsHttpHooksPool* _srs_hooks_pool = NULL;
+SrsHttpHooksCache* _srs_hooks_cache = NULL;
+SrsHttpHooksAsyncWorker* _srs_hooks_async = NULL;
+
+SrsHttpHooksEndpoint::SrsHttpHooksEndpoint()
+{
+    inflight = 0;
+    cond = srs_cond_new();
+}
+
+SrsHttpHooksEndpoint::~SrsHttpHooksEndpoint()
+{
+    for (int i = 0; i < (int)idle.size(); i++) {
+        SrsHttpClient* hc = idle.at(i);
+        srs_freep(hc);
+    }
+    idle.clear();
+
+    srs_cond_destroy(cond);
+}
+
+SrsHttpHooksPool::SrsHttpHooksPool()
+{
+}
+
+SrsHttpHooksPool::~SrsHttpHooksPool()
+{
+    std::map<std::string, SrsHttpHooksEndpoint*>::iterator it;
+    for (it = endpoints_.begin(); it != endpoints_.end(); ++it) {
+        SrsHttpHooksEndpoint* ep = it->second;
+        srs_freep(ep);
+    }
+    endpoints_.clear();
+}
+
+srs_error_t SrsHttpHooksPool::acquire(SrsHttpUri* uri, SrsHttpClient** pclient, bool* preused)
+{
+    srs_error_t err = srs_success;
+
+    SrsHttpHooksEndpoint* ep = fetch_or_create(uri);
+
+    // Wait for the requests in flight, to limit the concurrency to hook server.
+    srs_utime_t starttime = srs_update_system_time();
+    while (ep->inflight >= SRS_HTTP_HOOKS_MAX_INFLIGHT) {
+        srs_utime_t elapsed = srs_update_system_time() - starttime;
+        if (elapsed >= SRS_HTTP_CLIENT_TIMEOUT) {
+            return srs_error_new(ERROR_SOCKET_TIMEOUT, "http: %d requests in flight to %s:%d", ep->inflight,
+                uri->get_host().c_str(), uri->get_port());
+        }
+        srs_cond_timedwait(ep->cond, SRS_HTTP_CLIENT_TIMEOUT - elapsed);
+    }
+
+    // Drop the idle clients from the oldest, which are likely closed by peer.
+    srs_utime_t now = srs_get_system_time();
+    while (!ep->idle.empty() && now - ep->idle_at.front() > SRS_HTTP_HOOKS_IDLE_TIMEOUT) {
+        SrsHttpClient* hc = ep->idle.front();
+        srs_freep(hc);
+        ep->idle.erase(ep->idle.begin());
+        ep->idle_at.erase(ep->idle_at.begin());
+    }
+
+    // Use the latest idle client.
+    if (!ep->idle.empty()) {
+        *pclient = ep->idle.back();
+        *preused = true;
+        ep->idle.pop_back();
+        ep->idle_at.pop_back();
+        ep->inflight++;
+        return err;
+    }
+
+    SrsHttpClient* hc = new SrsHttpClient();
+    if ((err = hc->initialize(uri->get_schema(), uri->get_host(), uri->get_port())) != srs_success) {
+        srs_freep(hc);
+        return srs_error_wrap(err, "http: init client");
+    }
+
+    *pclient = hc;
+    *preused = false;
+    ep->inflight++;
+
+    return err;
+}
+
+void SrsHttpHooksPool::release(SrsHttpUri* uri, SrsHttpClient* client, bool reusable)
+{
+    SrsHttpHooksEndpoint* ep = fetch_or_create(uri);
+
+    ep->inflight--;
+    srs_cond_signal(ep->cond);
+
+    if (!reusable || (int)ep->idle.size() >= SRS_HTTP_HOOKS_MAX_IDLE) {
+        srs_freep(client);
+        return;
+    }
+
+    ep->idle.push_back(client);
+    ep->idle_at.push_back(srs_get_system_time());
+}
+
+SrsHttpHooksEndpoint* SrsHttpHooksPool::fetch_or_create(SrsHttpUri* uri)
+{
+    string key = srs_fmt("%s://%s:%d", uri->get_schema().c_str(), uri->get_host().c_str(), uri->get_port());
+
+    std::map<std::string, SrsHttpHooksEndpoint*>::iterator it = endpoints_.find(key);
+    if (it != endpoints_.end()) {
+        return it->second;
+    }
+
+    SrsHttpHooksEndpoint* ep = new SrsHttpHooksEndpoint();
+    endpoints_[key] = ep;
+    return ep;
+}
+
+SrsHttpHooksCache::SrsHttpHooksCache()
+{
+    last_cleanup_ = 0;
+}
+
+SrsHttpHooksCache::~SrsHttpHooksCache()
+{
+}
+
+bool SrsHttpHooksCache::get(std::string key, int* pcode)
+{
+    std::map<std::string, std::pair<int, srs_utime_t> >::iterator it = decisions_.find(key);
+    if (it == decisions_.end()) {
+        return false;
+    }
+
+    if (it->second.second <= srs_get_system_time()) {
+        decisions_.erase(it);
+        return false;
+    }
+
+    *pcode = it->second.first;
+    return true;
+}
+
+void SrsHttpHooksCache::set(std::string key, int code, srs_utime_t ttl)
+{
+    cleanup();
+    decisions_[key] = std::make_pair(code, srs_get_system_time() + ttl);
+}
+
+int SrsHttpHooksCache::size()
+{
+    return (int)decisions_.size();
+}
+
+void SrsHttpHooksCache::cleanup()
+{
+    srs_utime_t now = srs_get_system_time();
+    if (now - last_cleanup_ < SRS_HTTP_HOOKS_CACHE_CLEANUP) {
+        return;
+    }
+    last_cleanup_ = now;
+
+    std::map<std::string, std::pair<int, srs_utime_t> >::iterator it;
+    for (it = decisions_.begin(); it != decisions_.end();) {
+        if (it->second.second <= now) {
+            decisions_.erase(it++);
+        } else {
+            ++it;
+        }
+    }
+}
+
+SrsHttpHooksAsyncWorker::SrsHttpHooksAsyncWorker(int max_tasks, srs_utime_t timeout)
+{
+    max_tasks_ = max_tasks;
+    timeout_ = timeout;
+    done_ = srs_cond_new();
+}
+
+SrsHttpHooksAsyncWorker::~SrsHttpHooksAsyncWorker()
+{
+    srs_cond_destroy(done_);
+}
+
+srs_error_t SrsHttpHooksAsyncWorker::post(SrsHttpHooksAsyncCall* t)
+{
+    srs_error_t err = srs_success;
+
+    // Wait for the worker to consume the queue, to never queue too many notifications in memory.
+    srs_utime_t starttime = srs_update_system_time();
+    while (count() >= max_tasks_) {
+        srs_utime_t elapsed = srs_update_system_time() - starttime;
+        if (elapsed >= timeout_) {
+            srs_freep(t);
+            return srs_error_new(ERROR_HTTP_HOOKS_QUEUE_FULL, "queue full, tasks=%d, elapsed=%dms", count(), srsu2msi(elapsed));
+        }
+        srs_cond_timedwait(done_, timeout_ - elapsed);
+    }
+
+    if (!t->stream_url().empty()) {
+        pending_[t->stream_url()]++;
+    }
+
+    if ((err = execute(t)) != srs_success) {
+        return srs_error_wrap(err, "execute");
+    }
+
+    return err;
+}
+
+void SrsHttpHooksAsyncWorker::wait_stream(string stream_url, srs_utime_t timeout)
+{
+    srs_utime_t starttime = srs_update_system_time();
+    while (pending(stream_url) > 0) {
+        srs_utime_t elapsed = srs_update_system_time() - starttime;
+        if (elapsed >= timeout) {
+            break;
+        }
+        srs_cond_timedwait(done_, timeout - elapsed);
+    }
+}
+
+int SrsHttpHooksAsyncWorker::pending(string stream_url)
+{
+    std::map<std::string, int>::iterator it = pending_.find(stream_url);
+    return (it != pending_.end()) ? it->second : 0;
+}
+
+void SrsHttpHooksAsyncWorker::on_done(string stream_url)
+{
+    std::map<std::string, int>::iterator it = pending_.find(stream_url);
+    if (it != pending_.end() && --it->second <= 0) {
+        pending_.erase(it);
+    }
+
+    srs_cond_broadcast(done_);
+}
+
+SrsHttpHooksAsyncCall::SrsHttpHooksAsyncCall(SrsHttpHooksAsyncWorker* worker, string stream_url, SrsContextId cid,
+    string action, string url, string data)
+{
+    worker_ = worker;
+    stream_url_ = stream_url;
+    cid_ = cid;
+    action_ = action;
+    url_ = url;
+    data_ = data;
+}
+
+SrsHttpHooksAsyncCall::~SrsHttpHooksAsyncCall()
+{
+}
+
+string SrsHttpHooksAsyncCall::stream_url()
+{
+    return stream_url_;
+}
+
+srs_error_t SrsHttpHooksAsyncCall::call()
+{
+    srs_error_t err = srs_success;
+
+    std::string res;
+    int status_code = 0;
+
+    err = SrsHttpHooks::do_post(url_, data_, status_code, res);
+
+    // Done, no matter success or not, so the auth hooks of stream could go on.
+    worker_->on_done(stream_url_);
+
+    if (err != srs_success) {
+        int ret = srs_error_code(err);
+        srs_freep(err);
+        srs_warn("http: ignore %s failed, client_id=%s, url=%s, request=%s, response=%s, code=%d, ret=%d",
+            action_.c_str(), cid_.c_str(), url_.c_str(), data_.c_str(), res.c_str(), status_code, ret);
+        return err;
+    }
+
+    srs_trace("http: %s ok, client_id=%s, url=%s, request=%s, response=%s",
+        action_.c_str(), cid_.c_str(), url_.c_str(), data_.c_str(), res.c_str());
+
+    return err;
+}
+
+string SrsHttpHooksAsyncCall::to_string()
+{
+    return action_ + " " + url_;
+}
+
 SrsHttpHooks::SrsHttpHooks()
 {
 }
@@ -65,8 +359,7 @@ srs_error_t SrsHttpHooks::on_connect(string url, SrsRequest* req)
     std::string res;
     int status_code;
     
-    SrsHttpClient http;
-    if ((err = do_post(&http, url, data, status_code, res)) != srs_success) {
+    if ((err = do_auth("on_connect", url, req, data, status_code, res)) != srs_success) {
         return srs_error_wrap(err, "http: on_connect failed, client_id=%s, url=%s, request=%s, response=%s, code=%d",
             cid.c_str(), url.c_str(), data.c_str(), res.c_str(), status_code);
     }
@@ -79,8 +372,6 @@ srs_error_t SrsHttpHooks::on_connect(string url, SrsRequest* req)
 
 void SrsHttpHooks::on_close(string url, SrsRequest* req, int64_t send_bytes, int64_t recv_bytes)
 {
-    srs_error_t err = srs_success;
-    
     SrsContextId cid = _srs_context->get_id();
     SrsStatistic* stat = SrsStatistic::instance();
     SrsUniquePtr<SrsJsonObject> obj(SrsJsonAny::object());
@@ -96,22 +387,8 @@ void SrsHttpHooks::on_close(string url, SrsRequest* req, int64_t send_bytes, int
     obj->set("recv_bytes", SrsJsonAny::integer(recv_bytes));
     
     std::string data = obj->dumps();
-    std::string res;
-    int status_code;
-    
-    SrsHttpClient http;
-    if ((err = do_post(&http, url, data, status_code, res)) != srs_success) {
-        int ret = srs_error_code(err);
-        srs_freep(err);
-        srs_warn("http: ignore on_close failed, client_id=%s, url=%s, request=%s, response=%s, code=%d, ret=%d",
-            cid.c_str(), url.c_str(), data.c_str(), res.c_str(), status_code, ret);
-        return;
-    }
-    
-    srs_trace("http: on_close ok, client_id=%s, url=%s, request=%s, response=%s",
-        cid.c_str(), url.c_str(), data.c_str(), res.c_str());
-    
-    return;
+
+    do_notify("", cid, "on_close", url, data);
 }
 
 srs_error_t SrsHttpHooks::on_publish(string url, SrsRequest* req)
@@ -143,8 +420,7 @@ srs_error_t SrsHttpHooks::on_publish(string url, SrsRequest* req)
     std::string res;
     int status_code;
     
-    SrsHttpClient http;
-    if ((err = do_post(&http, url, data, status_code, res)) != srs_success) {
+    if ((err = do_auth("on_publish", url, req, data, status_code, res)) != srs_success) {
         return srs_error_wrap(err, "http: on_publish failed, client_id=%s, url=%s, request=%s, response=%s, code=%d",
             cid.c_str(), url.c_str(), data.c_str(), res.c_str(), status_code);
     }
@@ -157,8 +433,6 @@ srs_error_t SrsHttpHooks::on_publish(string url, SrsRequest* req)
 
 void SrsHttpHooks::on_unpublish(string url, SrsRequest* req)
 {
-    srs_error_t err = srs_success;
-    
     SrsContextId cid = _srs_context->get_id();
     SrsStatistic* stat = SrsStatistic::instance();
     SrsUniquePtr<SrsJsonObject> obj(SrsJsonAny::object());
@@ -181,22 +455,8 @@ void SrsHttpHooks::on_unpublish(string url, SrsRequest* req)
     }
     
     std::string data = obj->dumps();
-    std::string res;
-    int status_code;
-    
-    SrsHttpClient http;
-    if ((err = do_post(&http, url, data, status_code, res)) != srs_success) {
-        int ret = srs_error_code(err);
-        srs_freep(err);
-        srs_warn("http: ignore on_unpublish failed, client_id=%s, url=%s, request=%s, response=%s, status=%d, ret=%d",
-            cid.c_str(), url.c_str(), data.c_str(), res.c_str(), status_code, ret);
-        return;
-    }
-    
-    srs_trace("http: on_unpublish ok, client_id=%s, url=%s, request=%s, response=%s",
-        cid.c_str(), url.c_str(), data.c_str(), res.c_str());
-    
-    return;
+
+    do_notify(req->get_stream_url(), cid, "on_unpublish", url, data);
 }
 
 srs_error_t SrsHttpHooks::on_play(string url, SrsRequest* req)
@@ -229,8 +489,7 @@ srs_error_t SrsHttpHooks::on_play(string url, SrsRequest* req)
     std::string res;
     int status_code;
     
-    SrsHttpClient http;
-    if ((err = do_post(&http, url, data, status_code, res)) != srs_success) {
+    if ((err = do_auth("on_play", url, req, data, status_code, res)) != srs_success) {
         return srs_error_wrap(err, "http: on_play failed, client_id=%s, url=%s, request=%s, response=%s, status=%d",
             cid.c_str(), url.c_str(), data.c_str(), res.c_str(), status_code);
     }
@@ -243,8 +502,6 @@ srs_error_t SrsHttpHooks::on_play(string url, SrsRequest* req)
 
 void SrsHttpHooks::on_stop(string url, SrsRequest* req)
 {
-    srs_error_t err = srs_success;
-    
     SrsContextId cid = _srs_context->get_id();
     SrsStatistic* stat = SrsStatistic::instance();
     SrsUniquePtr<SrsJsonObject> obj(SrsJsonAny::object());
@@ -267,22 +524,9 @@ void SrsHttpHooks::on_stop(string url, SrsRequest* req)
     }
     
     std::string data = obj->dumps();
-    std::string res;
-    int status_code;
-    
-    SrsHttpClient http;
-    if ((err = do_post(&http, url, data, status_code, res)) != srs_success) {
-        int ret = srs_error_code(err);
-        srs_freep(err);
-        srs_warn("http: ignore on_stop failed, client_id=%s, url=%s, request=%s, response=%s, code=%d, ret=%d",
-            cid.c_str(), url.c_str(), data.c_str(), res.c_str(), status_code, ret);
-        return;
-    }
-    
-    srs_trace("http: on_stop ok, client_id=%s, url=%s, request=%s, response=%s",
-        cid.c_str(), url.c_str(), data.c_str(), res.c_str());
-    
-    return;
+
+    // Never track the on_stop of stream, because no auth hook waits for it.
+    do_notify("", cid, "on_stop", url, data);
 }
 
 srs_error_t SrsHttpHooks::on_dvr(SrsContextId c, string url, SrsRequest* req, string file)
@@ -318,8 +562,7 @@ srs_error_t SrsHttpHooks::on_dvr(SrsContextId c, string url, SrsRequest* req, st
     std::string res;
     int status_code;
     
-    SrsHttpClient http;
-    if ((err = do_post(&http, url, data, status_code, res)) != srs_success) {
+    if ((err = do_post(url, data, status_code, res)) != srs_success) {
         return srs_error_wrap(err, "http post on_dvr uri failed, client_id=%s, url=%s, request=%s, response=%s, code=%d",
             cid.c_str(), url.c_str(), data.c_str(), res.c_str(), status_code);
     }
@@ -374,8 +617,7 @@ srs_error_t SrsHttpHooks::on_hls(SrsContextId c, string url, SrsRequest* req, st
     std::string res;
     int status_code;
     
-    SrsHttpClient http;
-    if ((err = do_post(&http, url, data, status_code, res)) != srs_success) {
+    if ((err = do_post(url, data, status_code, res)) != srs_success) {
         return srs_error_wrap(err, "http: post %s with %s, status=%d, res=%s", url.c_str(), data.c_str(), status_code, res.c_str());
     }
     
@@ -455,15 +697,32 @@ srs_error_t SrsHttpHooks::on_hls_notify(SrsContextId c, std::string url, SrsRequ
     return srs_success;
 }
 
-srs_error_t SrsHttpHooks::discover_co_workers(string url, string& host, int& port)
+srs_error_t SrsHttpHooks::discover_co_workers(string url, string& host, int& port, int* http_port, srs_utime_t timeout)
 {
     srs_error_t err = srs_success;
     
     std::string res;
-    int status_code;
-    
-    SrsHttpClient http;
-    if ((err = do_post(&http, url, "", status_code, res)) != srs_success) {
+    int status_code = 0;
+
+    if (timeout > 0) {
+        // The pooled clients use the default timeout, so use a dedicated client for the specified timeout.
+        SrsHttpUri uri;
+        if ((err = uri.initialize(url)) != srs_success) {
+            return srs_error_wrap(err, "http: parse %s", url.c_str());
+        }
+
+        SrsHttpClient hc;
+        if ((err = hc.initialize(uri.get_schema(), uri.get_host(), uri.get_port(), timeout)) != srs_success) {
+            return srs_error_wrap(err, "http: init client");
+        }
+
+        bool reusable = false;
+        err = do_post(&hc, &uri, "", status_code, res, reusable);
+    } else {
+        err = do_post(url, "", status_code, res);
+    }
+
+    if (err != srs_success) {
         return srs_error_wrap(err, "http: post %s, status=%d, res=%s", url.c_str(), status_code, res.c_str());
     }
     
@@ -503,6 +762,14 @@ srs_error_t SrsHttpHooks::discover_co_workers(string url, string& host, int& por
         return srs_error_new(ERROR_OCLUSTER_DISCOVER, "parse data %s", res.c_str());
     }
     port = (int)prop->to_integer();
+
+    // The HTTP stream port is optional, for server which does not support it.
+    if (http_port) {
+        *http_port = 0;
+        if ((prop = p->ensure_property_integer("http")) != NULL) {
+            *http_port = (int)prop->to_integer();
+        }
+    }
     
     srs_trace("http: cluster redirect %s:%d ok, url=%s, response=%s", host.c_str(), port, url.c_str(), res.c_str());
     
@@ -533,8 +800,7 @@ srs_error_t SrsHttpHooks::on_forward_backend(string url, SrsRequest* req, std::v
     std::string res;
     int status_code;
 
-    SrsHttpClient http;
-    if ((err = do_post(&http, url, data, status_code, res)) != srs_success) {
+    if ((err = do_post(url, data, status_code, res)) != srs_success) {
         return srs_error_wrap(err, "http: on_forward_backend failed, client_id=%s, url=%s, request=%s, response=%s, code=%d",
             cid.c_str(), url.c_str(), data.c_str(), res.c_str(), status_code);
     }
@@ -577,22 +843,98 @@ srs_error_t SrsHttpHooks::on_forward_backend(string url, SrsRequest* req, std::v
     return err;
 }
 
-srs_error_t SrsHttpHooks::do_post(SrsHttpClient* hc, std::string url, std::string req, int& code, string& res)
+srs_error_t SrsHttpHooks::do_auth(string action, string url, SrsRequest* req, string data, int& code, string& res)
 {
     srs_error_t err = srs_success;
-    
+
+    // Keep the order of hooks for stream, the on_unpublish of previous publisher should be sent before the on_publish
+    // of the new publisher. Other hooks, such as on_connect and on_play, never wait for the async queue.
+    if (action == "on_publish") {
+        _srs_hooks_async->wait_stream(req->get_stream_url(), SRS_HTTP_CLIENT_TIMEOUT);
+    }
+
+    srs_utime_t ttl = _srs_config->get_vhost_http_hooks_cache_ttl(req->vhost);
+    if (ttl <= 0) {
+        return do_post(url, data, code, res);
+    }
+
+    // Use the cached decision for the same stream and param, because the client id always changes.
+    string key = action + " " + url + " " + req->get_stream_url() + req->param;
+
+    int decision = ERROR_SUCCESS;
+    if (_srs_hooks_cache->get(key, &decision)) {
+        code = SRS_CONSTS_HTTP_OK;
+        res = "cached";
+        if (decision != ERROR_SUCCESS) {
+            return srs_error_new(decision, "http: cached %s of %s", action.c_str(), key.c_str());
+        }
+        return err;
+    }
+
+    err = do_post(url, data, code, res);
+
+    // Only cache the decision of hook server, never cache the network error.
+    decision = srs_error_code(err);
+    if (decision == ERROR_SUCCESS || decision == ERROR_HTTP_STATUS_INVALID || decision == ERROR_HTTP_DATA_INVALID
+        || decision == ERROR_RESPONSE_CODE) {
+        _srs_hooks_cache->set(key, decision, ttl);
+    }
+
+    return err;
+}
+
+void SrsHttpHooks::do_notify(string stream_url, SrsContextId cid, string action, string url, string data)
+{
+    srs_error_t err = srs_success;
+
+    SrsHttpHooksAsyncCall* t = new SrsHttpHooksAsyncCall(_srs_hooks_async, stream_url, cid, action, url, data);
+    if ((err = _srs_hooks_async->post(t)) != srs_success) {
+        srs_warn("http: ignore %s failed, client_id=%s, url=%s, request=%s, err=%s",
+            action.c_str(), cid.c_str(), url.c_str(), data.c_str(), srs_error_desc(err).c_str());
+        srs_freep(err);
+    }
+}
+
+srs_error_t SrsHttpHooks::do_post(std::string url, std::string req, int& code, string& res)
+{
+    srs_error_t err = srs_success;
+
     SrsHttpUri uri;
     if ((err = uri.initialize(url)) != srs_success) {
         return srs_error_wrap(err, "http: post failed. url=%s", url.c_str());
     }
-    
-    if ((err = hc->initialize(uri.get_schema(), uri.get_host(), uri.get_port())) != srs_success) {
-        return srs_error_wrap(err, "http: init client");
+
+    // Retry once by a new connection, if the idle connection is closed by the peer.
+    for (int i = 0; i < 2; i++) {
+        SrsHttpClient* hc = NULL;
+        bool reused = false;
+        if ((err = _srs_hooks_pool->acquire(&uri, &hc, &reused)) != srs_success) {
+            return srs_error_wrap(err, "http: acquire client");
+        }
+
+        // Never reuse the client when transport error.
+        code = 0;
+        bool reusable = false;
+        err = do_post(hc, &uri, req, code, res, reusable);
+        _srs_hooks_pool->release(&uri, hc, reusable);
+
+        // Retry only when got no response from the idle connection.
+        if (err == srs_success || code > 0 || !reused) {
+            break;
+        }
+        srs_freep(err);
     }
+
+    return err;
+}
+
+srs_error_t SrsHttpHooks::do_post(SrsHttpClient* hc, SrsHttpUri* uri, std::string req, int& code, string& res, bool& reusable)
+{
+    srs_error_t err = srs_success;
     
-    string path = uri.get_path();
-    if (!uri.get_query().empty()) {
-        path += "?" + uri.get_query();
+    string path = uri->get_path();
+    if (!uri->get_query().empty()) {
+        path += "?" + uri->get_query();
     }
     
     ISrsHttpMessage* msg_raw = NULL;
@@ -601,10 +943,13 @@ srs_error_t SrsHttpHooks::do_post(SrsHttpClient* hc, std::string url, std::strin
     }
     SrsUniquePtr<ISrsHttpMessage> msg(msg_raw);
 
-    code = msg->status_code();
     if ((err = msg->body_read_all(res)) != srs_success) {
         return srs_error_wrap(err, "http: body read");
     }
+
+    code = msg->status_code();
+    // The whole response is read, so we could reuse the connection if not closed by peer.
+    reusable = msg->is_keep_alive();
     
     // ensure the http status is ok.
     if (code != SRS_CONSTS_HTTP_OK && code != SRS_CONSTS_HTTP_Created) {
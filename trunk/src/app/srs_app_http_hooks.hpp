@@ -11,6 +11,10 @@
 
 #include <string>
 #include <vector>
+#include <map>
+
+#include <srs_app_st.hpp>
+#include <srs_app_async_call.hpp>
 
 class SrsHttpUri;
 class SrsStSocket;
@@ -18,6 +22,124 @@ class SrsRequest;
 class SrsHttpParser;
 class SrsHttpClient;
 
+// The max notifications in queue of async worker for http hooks.
+#define SRS_HTTP_HOOKS_MAX_QUEUE 4096
+// The max time to wait for the async worker, when queue is full.
+#define SRS_HTTP_HOOKS_QUEUE_TIMEOUT (10 * SRS_UTIME_SECONDS)
+
+// The idle keep-alive connections to a hook server.
+class SrsHttpHooksEndpoint
+{
+public:
+    // The idle clients, the latest used client is at the back.
+    std::vector<SrsHttpClient*> idle;
+    // When the client was put back to the idle list, in the same order.
+    std::vector<srs_utime_t> idle_at;
+    // The number of requests in flight.
+    int inflight;
+    // To wait for the inflight requests, when exceed the concurrency limit.
+    srs_cond_t cond;
+public:
+    SrsHttpHooksEndpoint();
+    virtual ~SrsHttpHooksEndpoint();
+};
+
+// The pool of keep-alive HTTP clients for hooks, so that we don't need to connect to the hook server for each event.
+// It also limits the requests in flight to each hook server, to avoid the reconnect storm flooding the hook server.
+class SrsHttpHooksPool
+{
+private:
+    // The key is the schema://host:port of hook server.
+    std::map<std::string, SrsHttpHooksEndpoint*> endpoints_;
+public:
+    SrsHttpHooksPool();
+    virtual ~SrsHttpHooksPool();
+public:
+    // Get an idle client or create a new one for the url, wait if exceed the concurrency limit.
+    // @param preused Output whether the client is an idle client, which maybe closed by the peer.
+    // @remark User must release the client by release().
+    virtual srs_error_t acquire(SrsHttpUri* uri, SrsHttpClient** pclient, bool* preused);
+    // Put back the client to the idle list if reusable, or free it.
+    virtual void release(SrsHttpUri* uri, SrsHttpClient* client, bool reusable);
+private:
+    virtual SrsHttpHooksEndpoint* fetch_or_create(SrsHttpUri* uri);
+};
+
+// The cache for decisions of the auth hooks, such as on_connect, on_publish and on_play.
+class SrsHttpHooksCache
+{
+private:
+    // The key is the action, hook url, stream url and param, the value is the error code and expire time.
+    std::map<std::string, std::pair<int, srs_utime_t> > decisions_;
+    srs_utime_t last_cleanup_;
+public:
+    SrsHttpHooksCache();
+    virtual ~SrsHttpHooksCache();
+public:
+    // Find the decision which is not expired.
+    // @param pcode Output the error code of decision, ERROR_SUCCESS if allowed.
+    virtual bool get(std::string key, int* pcode);
+    virtual void set(std::string key, int code, srs_utime_t ttl);
+    virtual int size();
+private:
+    virtual void cleanup();
+};
+
+class SrsHttpHooksAsyncCall;
+
+// The async worker for notification hooks. The queue is bounded, and the pending on_unpublish of each stream is
+// tracked, so that the on_publish is never sent before the previous on_unpublish of stream.
+class SrsHttpHooksAsyncWorker : public SrsAsyncCallWorker
+{
+private:
+    // The max number of tasks in queue.
+    int max_tasks_;
+    // The max time to wait when the queue is full.
+    srs_utime_t timeout_;
+    // The key is the stream url, the value is the number of pending on_unpublish notifications.
+    std::map<std::string, int> pending_;
+    // To wait for the notifications to be done.
+    srs_cond_t done_;
+public:
+    SrsHttpHooksAsyncWorker(int max_tasks, srs_utime_t timeout);
+    virtual ~SrsHttpHooksAsyncWorker();
+public:
+    // Post the notification of stream, wait if the queue is full, or drop it if timeout.
+    virtual srs_error_t post(SrsHttpHooksAsyncCall* t);
+    // Wait for the pending on_unpublish of stream, or timeout. Only for on_publish.
+    virtual void wait_stream(std::string stream_url, srs_utime_t timeout);
+    // Get the number of pending on_unpublish of stream.
+    virtual int pending(std::string stream_url);
+    // When the notification of stream is done.
+    virtual void on_done(std::string stream_url);
+};
+
+// The async call for notification hooks, such as on_close, on_unpublish and on_stop, so that the connection never
+// waits for the hook server. The tasks are executed by the worker in batch.
+class SrsHttpHooksAsyncCall : public ISrsAsyncCallTask
+{
+private:
+    SrsHttpHooksAsyncWorker* worker_;
+    std::string stream_url_;
+    SrsContextId cid_;
+    std::string action_;
+    std::string url_;
+    std::string data_;
+public:
+    // @param stream_url The stream to order with on_publish, only for on_unpublish, empty for others such as on_stop.
+    SrsHttpHooksAsyncCall(SrsHttpHooksAsyncWorker* worker, std::string stream_url, SrsContextId cid,
+        std::string action, std::string url, std::string data);
+    virtual ~SrsHttpHooksAsyncCall();
+public:
+    virtual std::string stream_url();
+    virtual srs_error_t call();
+    virtual std::string to_string();
+};
+
+extern SrsHttpHooksPool* _srs_hooks_pool;
+extern SrsHttpHooksCache* _srs_hooks_cache;
+extern SrsHttpHooksAsyncWorker* _srs_hooks_async;
+
 // the http hooks, http callback api,
 // for some event, such as on_connect, call
 // a http api(hooks).
@@ -79,13 +201,22 @@ public:
     // @param cid the source connection cid, for the on_dvr is async call.
     static srs_error_t on_hls_notify(SrsContextId cid, std::string url, SrsRequest* req, std::string ts_url, int nb_notify);
     // Discover co-workers for origin cluster.
-    static srs_error_t discover_co_workers(std::string url, std::string& host, int& port);
+    // @param http_port Output the HTTP stream port of coworker if not NULL, zero if disabled.
+    // @param timeout The timeout in srs_utime_t for a dedicated client, 0 to use the pooled client.
+    static srs_error_t discover_co_workers(std::string url, std::string& host, int& port, int* http_port = NULL,
+        srs_utime_t timeout = 0);
     // The on_forward_backend hook, when publish stream start to forward
     // @param url the api server url, to valid the client.
     //         ignore if empty.
     static srs_error_t on_forward_backend(std::string url, SrsRequest* req, std::vector<std::string>& rtmp_urls);
 private:
-    static srs_error_t do_post(SrsHttpClient* hc, std::string url, std::string req, int& code, std::string& res);
+    // Post the auth hook, use the cached decision if hit.
+    static srs_error_t do_auth(std::string action, std::string url, SrsRequest* req, std::string data, int& code, std::string& res);
+    // Post the notification hook in async.
+    static void do_notify(std::string stream_url, SrsContextId cid, std::string action, std::string url, std::string data);
+    static srs_error_t do_post(std::string url, std::string req, int& code, std::string& res);
+    static srs_error_t do_post(SrsHttpClient* hc, SrsHttpUri* uri, std::string req, int& code, std::string& res, bool& reusable);
+    friend class SrsHttpHooksAsyncCall;
 };
 
 #endif
@@ -786,10 +786,22 @@ srs_error_t SrsLiveStream::do_serve_http(SrsLiveSource* source, SrsLiveConsumer*
         return srs_error_wrap(err, "start recv thread");
     }
 
+    // Send the payload of messages by MSG_ZEROCOPY, only for the fast FLV encoder which writes the payload directly,
+    // while other encoders copy the payload to their own buffers.
+    SrsZerocopySender* zc = NULL;
+    if (ffe && _srs_config->get_zerocopy(req->vhost)) {
+        if ((err = hxc->enable_zerocopy(SRS_PERF_ZEROCOPY_MIN_BYTES)) != srs_success) {
+            srs_warn("ignore zerocopy err %s", srs_error_desc(err).c_str());
+            srs_freep(err);
+        } else {
+            zc = hxc->zerocopy();
+        }
+    }
+
     srs_utime_t mw_sleep = _srs_config->get_mw_sleep(req->vhost);
-    srs_trace("FLV %s, encoder=%s, mw_sleep=%dms, cache=%d, msgs=%d, dinm=%d, guess_av=%d/%d/%d",
+    srs_trace("FLV %s, encoder=%s, mw_sleep=%dms, cache=%d, msgs=%d, dinm=%d, guess_av=%d/%d/%d, zerocopy=%d",
         entry->pattern.c_str(), enc_desc.c_str(), srsu2msi(mw_sleep), enc->has_cache(), msgs.max, drop_if_not_match,
-        has_audio, has_video, guess_has_av);
+        has_audio, has_video, guess_has_av, (zc != NULL));
 
     // TODO: free and erase the disabled entry after all related connections is closed.
     // TODO: FXIME: Support timeout for player, quit infinite-loop.
@@ -819,11 +831,22 @@ srs_error_t SrsLiveStream::do_serve_http(SrsLiveSource* source, SrsLiveConsumer*
         if (pprint->can_print()) {
             srs_trace("-> " SRS_CONSTS_LOG_HTTP_STREAM " http: got %d msgs, age=%d, min=%d, mw=%d",
                 count, pprint->age(), SRS_PERF_MW_MIN_MSGS, srsu2msi(mw_sleep));
+
+            if (zc) {
+                SrsStatistic* stat = SrsStatistic::instance();
+                stat->on_client_zerocopy(_srs_context->get_id().c_str(), zc->pinned_bytes(), zc->zerocopy_bytes());
+            }
         }
         
         // sendout all messages.
         if (ffe) {
+            if (zc) {
+                zc->pin(msgs.msgs, count);
+            }
             err = ffe->write_tags(msgs.msgs, count);
+            if (zc) {
+                zc->unpin();
+            }
         } else {
             err = streaming_send_messages(enc.get(), msgs.msgs, count);
         }
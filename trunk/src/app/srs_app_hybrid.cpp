@@ -12,7 +12,15 @@
 #include <srs_protocol_st.hpp>
 #include <srs_app_utility.hpp>
 #include <srs_app_dvr.hpp>
+#include <srs_app_http_hooks.hpp>
 #include <srs_app_tencentcloud.hpp>
+#include <srs_app_rtmp_conn.hpp>
+#ifdef SRS_FFMPEG_FIT
+#include <srs_app_rtc_codec.hpp>
+#endif
+#ifdef SRS_GB28181
+#include <srs_app_gb28181.hpp>
+#endif
 
 using namespace std;
 
@@ -183,6 +191,11 @@ srs_error_t SrsHybridServer::initialize()
         return srs_error_wrap(err, "dvr async");
     }
 
+    // Start the async call for http hooks.
+    if ((err = _srs_hooks_async->start()) != srs_success) {
+        return srs_error_wrap(err, "hooks async");
+    }
+
 #ifdef SRS_APM
     // Initialize TencentCloud CLS object.
     if ((err = _srs_cls->initialize()) != srs_success) {
@@ -239,6 +252,22 @@ void SrsHybridServer::stop()
         ISrsHybridServer* server = *it;
         server->stop();
     }
+
+#ifdef SRS_FFMPEG_FIT
+    // Stop the worker threads for audio transcoding.
+    _srs_audio_transcode_pool->stop();
+#endif
+
+    // Stop the worker threads for RTMP handshake, after the left tasks are done.
+    _srs_rtmp_handshake_workers->stop();
+
+    // Stop the finalizer thread for DVR, after all fMP4 files are finalized.
+    _srs_dvr_mp4_finalizer->stop();
+
+#ifdef SRS_GB28181
+    // Stop the worker threads for GB28181 media.
+    _srs_gb_workers->stop();
+#endif
 }
 
 SrsServerAdapter* SrsHybridServer::srs()
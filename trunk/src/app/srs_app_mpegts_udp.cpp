@@ -32,6 +32,7 @@ using namespace std;
 #include <srs_protocol_raw_avc.hpp>
 #include <srs_app_pithy_print.hpp>
 #include <srs_app_rtmp_conn.hpp>
+#include <srs_app_stream_bridge.hpp>
 #include <srs_protocol_utility.hpp>
 
 SrsUdpCasterListener::SrsUdpCasterListener()
@@ -267,10 +268,10 @@ srs_error_t SrsMpegtsOverUdp::on_udp_bytes(string host, int port, char* buf, int
     int nb_packet = buffer->length() / SRS_TS_PACKET_SIZE;
     for (int i = 0; i < nb_packet; i++) {
         char* p = buffer->bytes() + (i * SRS_TS_PACKET_SIZE);
-        SrsUniquePtr<SrsBuffer> stream(new SrsBuffer(p, SRS_TS_PACKET_SIZE));
+        SrsBuffer stream(p, SRS_TS_PACKET_SIZE);
 
         // process each ts packet
-        if ((err = context->decode(stream.get(), this)) != srs_success) {
+        if ((err = context->decode(&stream, this)) != srs_success) {
             srs_info("parse ts packet err=%s", srs_error_desc(err).c_str());
             srs_error_reset(err);
             continue;
@@ -647,14 +648,9 @@ srs_error_t SrsMpegtsOverUdp::connect()
     
     srs_utime_t cto = SRS_CONSTS_RTMP_TIMEOUT;
     srs_utime_t sto = SRS_CONSTS_RTMP_PULSE;
-    sdk = new SrsSimpleRtmpClient(output, cto, sto);
+    sdk = new SrsCasterPublisher(output, cto, sto);
     
-    if ((err = sdk->connect()) != srs_success) {
-        close();
-        return srs_error_wrap(err, "connect %s failed, cto=%dms, sto=%dms.", output.c_str(), srsu2msi(cto), srsu2msi(sto));
-    }
-    
-    if ((err = sdk->publish(SRS_CONSTS_RTMP_PROTOCOL_CHUNK_SIZE)) != srs_success) {
+    if ((err = sdk->publish()) != srs_success) {
         close();
         return srs_error_wrap(err, "publish");
     }
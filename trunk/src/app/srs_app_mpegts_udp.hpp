@@ -25,7 +25,7 @@ class SrsSharedPtrMessage;
 class SrsRawAacStream;
 struct SrsRawAacStreamCodec;
 class SrsPithyPrint;
-class SrsSimpleRtmpClient;
+class SrsCasterPublisher;
 class SrsMpegtsOverUdp;
 
 #include <srs_app_st.hpp>
@@ -73,7 +73,7 @@ private:
     SrsSimpleStream* buffer;
     std::string output;
 private:
-    SrsSimpleRtmpClient* sdk;
+    SrsCasterPublisher* sdk;
 private:
     SrsRawH264Stream* avc;
     std::string h264_sps;
@@ -109,9 +109,9 @@ private:
 private:
     virtual srs_error_t rtmp_write_packet(char type, uint32_t timestamp, char* data, int size);
 private:
-    // Connect to RTMP server.
+    // Start to publish the stream, to the source in process or the RTMP server.
     virtual srs_error_t connect();
-    // Close the connection to RTMP server.
+    // Stop publishing the stream.
     virtual void close();
 };
 
@@ -18,12 +18,91 @@
 #include <srs_core_autofree.hpp>
 #include <srs_app_statistic.hpp>
 
+#include <stdlib.h>
 #include <sys/socket.h>
 using namespace std;
 
 // the max small bytes to group
 #define SRS_MR_SMALL_BYTES 4096
 
+// The bytes to merge for each read or write, larger window is useless for high bitrate stream.
+#define SRS_MIO_MERGE_BYTES 65536
+// The min window to merge, to avoid too many syscalls.
+#define SRS_MIO_MIN_SLEEP (10 * SRS_UTIME_MILLISECONDS)
+// The min and max socket buffer in bytes.
+#define SRS_MIO_MIN_BUFFER 16384
+#define SRS_MIO_MAX_BUFFER 1048576
+
+SrsMergedIOTuner::SrsMergedIOTuner(srs_utime_t max_sleep, int msgs)
+{
+    max_sleep_ = max_sleep;
+    kbps_ = 0;
+    msgs_rate_ = 0;
+
+    sleep_ = max_sleep;
+    buffer_ = 0;
+    msgs_ = msgs;
+}
+
+SrsMergedIOTuner::~SrsMergedIOTuner()
+{
+}
+
+bool SrsMergedIOTuner::update(int kbps, int msgs_rate)
+{
+    if (kbps <= 0 || max_sleep_ <= 0) {
+        return false;
+    }
+
+    kbps_ = kbps;
+    msgs_rate_ = msgs_rate;
+
+    // The window to merge enough bytes, in ms it's bytes*8/kbps, never exceed the latency target.
+    srs_utime_t sleep = (srs_utime_t)SRS_MIO_MERGE_BYTES * 8 * SRS_UTIME_MILLISECONDS / kbps;
+    sleep = srs_min(max_sleep_, srs_max(SRS_MIO_MIN_SLEEP, sleep));
+
+    // The buffer for data of 2 windows, to absorb the jitter.
+    int buffer = (int)(srsu2ms(sleep) * kbps / 8 * 2);
+    buffer = srs_min(SRS_MIO_MAX_BUFFER, srs_max(SRS_MIO_MIN_BUFFER, buffer));
+
+    // The messages in a window.
+    int msgs = (int)(msgs_rate * sleep / SRS_UTIME_SECONDS);
+    msgs = srs_min(SRS_PERF_MW_MSGS, srs_max(1, msgs));
+
+    // Ignore the small changes, to avoid setting the socket options frequently.
+    bool changed = !buffer_ || msgs != msgs_ || ::abs(buffer - buffer_) * 4 > buffer_
+        || ::llabs(sleep - sleep_) * 4 > sleep_;
+    if (!changed) {
+        return false;
+    }
+
+    sleep_ = sleep;
+    buffer_ = buffer;
+    msgs_ = msgs;
+
+    return true;
+}
+
+srs_utime_t SrsMergedIOTuner::sleep()
+{
+    return sleep_;
+}
+
+int SrsMergedIOTuner::buffer()
+{
+    return buffer_;
+}
+
+int SrsMergedIOTuner::msgs()
+{
+    return msgs_;
+}
+
+int SrsMergedIOTuner::kbps()
+{
+    return kbps_;
+}
+
 ISrsMessageConsumer::ISrsMessageConsumer()
 {
 }
@@ -279,6 +358,10 @@ SrsPublishRecvThread::SrsPublishRecvThread(SrsRtmpServer* rtmp_sdk, SrsRequest*
     // the mr settings,
     mr = _srs_config->get_mr_enabled(req->vhost);
     mr_sleep = _srs_config->get_mr_sleep(req->vhost);
+    mr_adaptive_ = _srs_config->get_mr_adaptive(req->vhost);
+    tuner_ = new SrsMergedIOTuner(mr_sleep, 0);
+    tuned_msgs_ = 0;
+    tuned_at_ = 0;
     
     realtime = _srs_config->get_realtime_enabled(req->vhost);
     
@@ -292,6 +375,7 @@ SrsPublishRecvThread::~SrsPublishRecvThread()
     trd.stop();
     srs_cond_destroy(error);
     srs_freep(recv_error);
+    srs_freep(tuner_);
 }
 
 srs_error_t SrsPublishRecvThread::wait(srs_utime_t tm)
@@ -331,6 +415,32 @@ SrsContextId SrsPublishRecvThread::get_cid()
     return ncid;
 }
 
+void SrsPublishRecvThread::update_merged_read(int kbps)
+{
+    // The messages rate since last update.
+    srs_utime_t now = srs_get_system_time();
+    int msgs_rate = 0;
+    if (tuned_at_ > 0 && now > tuned_at_) {
+        msgs_rate = (int)((_nb_msgs - tuned_msgs_) * SRS_UTIME_SECONDS / (now - tuned_at_));
+    }
+    tuned_msgs_ = _nb_msgs;
+    tuned_at_ = now;
+
+    if (!mr || !mr_adaptive_ || realtime) {
+        return;
+    }
+
+    if (!tuner_->update(kbps, msgs_rate)) {
+        return;
+    }
+
+    set_socket_buffer_size(tuner_->sleep(), tuner_->buffer());
+    mr_sleep = tuner_->sleep();
+
+    SrsStatistic* stat = SrsStatistic::instance();
+    stat->on_client_merged_io(_conn->get_id().c_str(), mr_sleep, tuner_->buffer(), 0);
+}
+
 srs_error_t SrsPublishRecvThread::start()
 {
     srs_error_t err = srs_success;
@@ -471,6 +581,11 @@ srs_error_t SrsPublishRecvThread::on_reload_vhost_publish(string vhost)
     bool mr_enabled = _srs_config->get_mr_enabled(req->vhost);
     srs_utime_t sleep_v = _srs_config->get_mr_sleep(req->vhost);
     
+    // Reset the tuner for the new latency target.
+    mr_adaptive_ = _srs_config->get_mr_adaptive(req->vhost);
+    srs_freep(tuner_);
+    tuner_ = new SrsMergedIOTuner(sleep_v, 0);
+    
     // update buffer when sleep ms changed.
     if (mr_sleep != sleep_v) {
         set_socket_buffer(sleep_v);
@@ -525,7 +640,12 @@ void SrsPublishRecvThread::set_socket_buffer(srs_utime_t sleep_v)
     //      2000*5000/8=1250000B(about 1220KB).
     int kbps = 5000;
     int socket_buffer_size = srsu2msi(sleep_v) * kbps / 8;
-    
+
+    set_socket_buffer_size(sleep_v, socket_buffer_size);
+}
+
+void SrsPublishRecvThread::set_socket_buffer_size(srs_utime_t sleep_v, int socket_buffer_size)
+{
     int fd = mr_fd;
     int onb_rbuf = 0;
     socklen_t sock_buf_size = sizeof(int);
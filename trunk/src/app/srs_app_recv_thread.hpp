@@ -27,6 +27,37 @@ class SrsLiveConsumer;
 class SrsHttpConn;
 class SrsHttpxConn;
 
+// The tuner for MR(merged-read) and MW(merged-write) of a connection, to size the merge window, socket buffer and
+// messages by the live bitrate, instead of the same configuration for all streams. The configured latency is the
+// target, which is never exceeded, and a high bitrate stream uses a smaller window because it's enough to fill a
+// large read or write, while a low bitrate stream uses a smaller buffer.
+class SrsMergedIOTuner
+{
+private:
+    // The latency target, which is the max window to merge.
+    srs_utime_t max_sleep_;
+    // The measured bitrate and messages rate.
+    int kbps_;
+    int msgs_rate_;
+    // The chosen values.
+    srs_utime_t sleep_;
+    int buffer_;
+    int msgs_;
+public:
+    SrsMergedIOTuner(srs_utime_t max_sleep, int msgs);
+    virtual ~SrsMergedIOTuner();
+public:
+    // Update by the measured kbps and messages per second, return whether the chosen values changed.
+    virtual bool update(int kbps, int msgs_rate);
+    // The merge window, for mr_sleep or mw_sleep.
+    virtual srs_utime_t sleep();
+    // The socket buffer in bytes, 0 if not measured yet.
+    virtual int buffer();
+    // The min messages to merge, for mw_msgs.
+    virtual int msgs();
+    virtual int kbps();
+};
+
 // The message consumer which consume a message.
 class ISrsMessageConsumer
 {
@@ -140,6 +171,12 @@ private:
     bool mr;
     int mr_fd;
     srs_utime_t mr_sleep;
+    // Whether tune mr by the live bitrate.
+    bool mr_adaptive_;
+    SrsMergedIOTuner* tuner_;
+    // The msgs and time of last update, to calculate the messages rate.
+    int64_t tuned_msgs_;
+    srs_utime_t tuned_at_;
     // For realtime
     // @see https://github.com/ossrs/srs/issues/257
     bool realtime;
@@ -165,6 +202,8 @@ public:
     virtual srs_error_t error_code();
     virtual void set_cid(SrsContextId v);
     virtual SrsContextId get_cid();
+    // Tune the mr by the measured recv kbps, only when mr_adaptive enabled.
+    virtual void update_merged_read(int kbps);
 public:
     virtual srs_error_t start();
     virtual void stop();
@@ -186,6 +225,7 @@ public:
     virtual srs_error_t on_reload_vhost_realtime(std::string vhost);
 private:
     virtual void set_socket_buffer(srs_utime_t sleep_v);
+    virtual void set_socket_buffer_size(srs_utime_t sleep_v, int socket_buffer_size);
 };
 
 // The HTTP receive thread, try to read messages util EOF.
@@ -0,0 +1,458 @@
+//
+// Copyright (c) 2013-2024 The SRS Authors
+//
+// SPDX-License-Identifier: MIT
+//
+
+#include <srs_app_rtc_bwe.hpp>
+
+#include <math.h>
+#include <string.h>
+
+using namespace std;
+
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_log.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_kernel_rtc_rtp.hpp>
+
+// The size of history for sent packets, should be larger than the packets in flight.
+#define SRS_RTC_BWE_HISTORY 4096
+// The packets sent in this duration are in the same group, to filter the burst of sending.
+#define SRS_RTC_BWE_GROUP_DURATION (5 * SRS_UTIME_MILLISECONDS)
+// The window size of trendline filter.
+#define SRS_RTC_BWE_TRENDLINE_WINDOW 20
+
+// The pacing rate is larger than the target bitrate, to drain the queue quickly.
+#define SRS_RTC_PACER_FACTOR 2.5
+// The max duration of budget, larger than the interval of timer to flush.
+#define SRS_RTC_PACER_MAX_BURST (30 * SRS_UTIME_MILLISECONDS)
+// The max delay of packet in queue, send it even there is no budget.
+#define SRS_RTC_PACER_MAX_DELAY (250 * SRS_UTIME_MILLISECONDS)
+// The max number of free buffers to reuse.
+#define SRS_RTC_PACER_POOL 256
+
+SrsRtcBandwidthEstimator::SrsRtcBandwidthEstimator()
+{
+    history_ = new SrsRtcSentPacket[SRS_RTC_BWE_HISTORY];
+    memset(history_, 0, sizeof(SrsRtcSentPacket) * SRS_RTC_BWE_HISTORY);
+
+    has_group_ = has_prev_group_ = false;
+    group_first_send_ = group_last_send_ = prev_group_send_ = 0;
+    group_last_arrival_ = prev_group_arrival_ = 0;
+
+    accumulated_delay_ = smoothed_delay_ = 0;
+    first_arrival_ = 0;
+    nn_deltas_ = 0;
+    prev_trend_ = 0;
+    threshold_ = 12.5;
+    last_threshold_at_ = 0;
+    overusing_time_ = -1;
+    nn_overusing_ = 0;
+    state_ = SrsRtcBweStateNormal;
+
+    acked_bytes_ = 0;
+    acked_window_ = 0;
+    acked_kbps_ = 0;
+    nn_lost_ = nn_total_ = 0;
+    loss_window_ = 0;
+    lost_rate_ = 0;
+
+    delay_kbps_ = loss_kbps_ = SRS_RTC_BWE_START_KBPS;
+    last_update_ = last_decrease_ = 0;
+}
+
+SrsRtcBandwidthEstimator::~SrsRtcBandwidthEstimator()
+{
+    srs_freepa(history_);
+}
+
+void SrsRtcBandwidthEstimator::on_packet_sent(uint16_t sn, int size, srs_utime_t now)
+{
+    SrsRtcSentPacket& pkt = history_[sn % SRS_RTC_BWE_HISTORY];
+    pkt.sn = sn;
+    pkt.size = size;
+    pkt.send_at = now;
+    pkt.valid = true;
+}
+
+void SrsRtcBandwidthEstimator::on_feedback(const vector<SrsRtcpTWCCStatus>& statuses, srs_utime_t now)
+{
+    uint64_t acked = 0;
+    int nn_lost = 0, nn_total = 0;
+
+    for (int i = 0; i < (int)statuses.size(); i++) {
+        const SrsRtcpTWCCStatus& status = statuses.at(i);
+
+        // Ignore the packet not sent by us, or already acked.
+        SrsRtcSentPacket& pkt = history_[status.sn % SRS_RTC_BWE_HISTORY];
+        if (!pkt.valid || pkt.sn != status.sn) {
+            continue;
+        }
+
+        nn_total++;
+        if (!status.received) {
+            nn_lost++;
+            continue;
+        }
+
+        pkt.valid = false;
+        acked += pkt.size;
+        on_packet_group(pkt.send_at, status.arrival);
+    }
+
+    update_acked(acked, now);
+    update_loss(nn_lost, nn_total, now);
+    update_delay_based(now);
+}
+
+int SrsRtcBandwidthEstimator::target_kbps()
+{
+    int kbps = srs_min(delay_kbps_, loss_kbps_);
+    return srs_max(SRS_RTC_BWE_MIN_KBPS, srs_min(SRS_RTC_BWE_MAX_KBPS, kbps));
+}
+
+int SrsRtcBandwidthEstimator::acked_kbps()
+{
+    return acked_kbps_;
+}
+
+float SrsRtcBandwidthEstimator::lost_rate()
+{
+    return lost_rate_;
+}
+
+SrsRtcBweState SrsRtcBandwidthEstimator::state()
+{
+    return state_;
+}
+
+void SrsRtcBandwidthEstimator::on_packet_group(srs_utime_t send_at, int64_t arrival)
+{
+    if (!has_group_) {
+        has_group_ = true;
+        group_first_send_ = group_last_send_ = send_at;
+        group_last_arrival_ = arrival;
+        return;
+    }
+
+    // Ignore the reordered packet, for example, the retransmitted packet sent before.
+    if (send_at < group_first_send_) {
+        return;
+    }
+
+    // The packets sent in a burst are in the same group.
+    if (send_at - group_first_send_ <= SRS_RTC_BWE_GROUP_DURATION) {
+        group_last_send_ = srs_max(group_last_send_, send_at);
+        group_last_arrival_ = srs_max(group_last_arrival_, arrival);
+        return;
+    }
+
+    // The group is complete, calculate the delay gradient with the previous group.
+    if (has_prev_group_) {
+        double send_delta_ms = (group_last_send_ - prev_group_send_) / 1000.0;
+        double arrival_delta_ms = (group_last_arrival_ - prev_group_arrival_) / 1000.0;
+        update_trendline(arrival_delta_ms - send_delta_ms, send_delta_ms, group_last_arrival_);
+    }
+
+    has_prev_group_ = true;
+    prev_group_send_ = group_last_send_;
+    prev_group_arrival_ = group_last_arrival_;
+
+    group_first_send_ = group_last_send_ = send_at;
+    group_last_arrival_ = arrival;
+}
+
+void SrsRtcBandwidthEstimator::update_trendline(double delay_ms, double send_delta_ms, int64_t arrival)
+{
+    if (samples_.empty()) {
+        first_arrival_ = last_threshold_at_ = arrival;
+    }
+    nn_deltas_ = srs_min(nn_deltas_ + 1, 1000);
+
+    // Smooth the accumulated delay, to filter the jitter.
+    accumulated_delay_ += delay_ms;
+    smoothed_delay_ = 0.9 * smoothed_delay_ + 0.1 * accumulated_delay_;
+
+    samples_.push_back(make_pair((arrival - first_arrival_) / 1000.0, smoothed_delay_));
+    if ((int)samples_.size() > SRS_RTC_BWE_TRENDLINE_WINDOW) {
+        samples_.pop_front();
+    }
+
+    // The slope of linear regression, which is the trend of queue delay.
+    double trend = prev_trend_;
+    if ((int)samples_.size() == SRS_RTC_BWE_TRENDLINE_WINDOW) {
+        double sum_x = 0, sum_y = 0;
+        for (int i = 0; i < (int)samples_.size(); i++) {
+            sum_x += samples_[i].first;
+            sum_y += samples_[i].second;
+        }
+
+        double avg_x = sum_x / samples_.size(), avg_y = sum_y / samples_.size();
+        double numerator = 0, denominator = 0;
+        for (int i = 0; i < (int)samples_.size(); i++) {
+            double x = samples_[i].first - avg_x;
+            numerator += x * (samples_[i].second - avg_y);
+            denominator += x * x;
+        }
+
+        if (denominator != 0) {
+            trend = numerator / denominator;
+        }
+    }
+
+    detect(trend, send_delta_ms, arrival);
+}
+
+void SrsRtcBandwidthEstimator::detect(double trend, double ts_delta_ms, int64_t arrival)
+{
+    if (nn_deltas_ < 2) {
+        state_ = SrsRtcBweStateNormal;
+        return;
+    }
+
+    double modified = srs_min(nn_deltas_, 60) * trend * 4.0;
+
+    if (modified > threshold_) {
+        // Overuse only if it lasts for a while and the trend is increasing.
+        overusing_time_ = (overusing_time_ < 0) ? ts_delta_ms / 2 : overusing_time_ + ts_delta_ms;
+        nn_overusing_++;
+        if (overusing_time_ > 10 && nn_overusing_ > 1 && trend >= prev_trend_) {
+            overusing_time_ = 0;
+            nn_overusing_ = 0;
+            state_ = SrsRtcBweStateOverusing;
+        }
+    } else if (modified < -threshold_) {
+        overusing_time_ = -1;
+        nn_overusing_ = 0;
+        state_ = SrsRtcBweStateUnderusing;
+    } else {
+        overusing_time_ = -1;
+        nn_overusing_ = 0;
+        state_ = SrsRtcBweStateNormal;
+    }
+    prev_trend_ = trend;
+
+    // Adapt the threshold, to avoid starving by concurrent TCP flows, but ignore the spikes.
+    double abs_modified = fabs(modified);
+    if (abs_modified > threshold_ + 15) {
+        last_threshold_at_ = arrival;
+        return;
+    }
+
+    double k = abs_modified < threshold_ ? 0.039 : 0.0087;
+    double dt_ms = srs_min((arrival - last_threshold_at_) / 1000.0, 100.0);
+    threshold_ += k * (abs_modified - threshold_) * dt_ms;
+    threshold_ = srs_max(6.0, srs_min(600.0, threshold_));
+    last_threshold_at_ = arrival;
+}
+
+void SrsRtcBandwidthEstimator::update_acked(uint64_t bytes, srs_utime_t now)
+{
+    acked_bytes_ += bytes;
+
+    if (!acked_window_) {
+        acked_window_ = now;
+        return;
+    }
+
+    srs_utime_t elapsed = now - acked_window_;
+    if (elapsed < 500 * SRS_UTIME_MILLISECONDS) {
+        return;
+    }
+
+    int kbps = (int)(acked_bytes_ * 8 * 1000 / elapsed);
+    acked_kbps_ = acked_kbps_ ? (acked_kbps_ * 7 + kbps * 3) / 10 : kbps;
+
+    acked_bytes_ = 0;
+    acked_window_ = now;
+}
+
+void SrsRtcBandwidthEstimator::update_loss(int nn_lost, int nn_total, srs_utime_t now)
+{
+    nn_lost_ += nn_lost;
+    nn_total_ += nn_total;
+
+    if (!loss_window_) {
+        loss_window_ = now;
+    }
+
+    if (now - loss_window_ < 1 * SRS_UTIME_SECONDS || nn_total_ < 20) {
+        return;
+    }
+
+    lost_rate_ = (float)nn_lost_ / nn_total_;
+    if (lost_rate_ < 0.02) {
+        loss_kbps_ = srs_min(SRS_RTC_BWE_MAX_KBPS, (int)(loss_kbps_ * 1.08) + 1);
+    } else if (lost_rate_ > 0.1) {
+        loss_kbps_ = srs_max(SRS_RTC_BWE_MIN_KBPS, (int)(target_kbps() * (1 - 0.5 * lost_rate_)));
+    }
+
+    nn_lost_ = nn_total_ = 0;
+    loss_window_ = now;
+}
+
+void SrsRtcBandwidthEstimator::update_delay_based(srs_utime_t now)
+{
+    if (!last_update_) {
+        last_update_ = now;
+    }
+
+    srs_utime_t elapsed = srs_min(now - last_update_, 1 * SRS_UTIME_SECONDS);
+    last_update_ = now;
+
+    if (state_ == SrsRtcBweStateOverusing) {
+        // Decrease to the acked bitrate, at most once for a RTT.
+        if (now - last_decrease_ < 200 * SRS_UTIME_MILLISECONDS) {
+            return;
+        }
+
+        int base = acked_kbps_ ? acked_kbps_ : delay_kbps_;
+        delay_kbps_ = srs_max(SRS_RTC_BWE_MIN_KBPS, srs_min(delay_kbps_, (int)(base * 0.85)));
+        last_decrease_ = now;
+    } else if (state_ == SrsRtcBweStateNormal) {
+        // Increase 8% per second, but never much larger than the acked bitrate, because the stream
+        // might be limited by the publisher, not the network.
+        int increase = srs_max(1, (int)(delay_kbps_ * 0.08 * elapsed / SRS_UTIME_SECONDS));
+        if (acked_kbps_) {
+            int limit = (int)(acked_kbps_ * 1.5) + 10;
+            increase = srs_max(0, srs_min(increase, limit - delay_kbps_));
+        }
+        delay_kbps_ = srs_min(SRS_RTC_BWE_MAX_KBPS, delay_kbps_ + increase);
+    }
+}
+
+ISrsRtcPacerHandler::ISrsRtcPacerHandler()
+{
+}
+
+ISrsRtcPacerHandler::~ISrsRtcPacerHandler()
+{
+}
+
+SrsRtcPacer::SrsRtcPacer(ISrsRtcPacerHandler* h)
+{
+    handler_ = h;
+    rate_kbps_ = (int)(SRS_RTC_BWE_MAX_KBPS * SRS_RTC_PACER_FACTOR);
+    budget_ = 0;
+    last_refill_ = 0;
+}
+
+SrsRtcPacer::~SrsRtcPacer()
+{
+    for (int i = 0; i < (int)queue_.size(); i++) {
+        char* data = queue_[i].data;
+        srs_freepa(data);
+    }
+    queue_.clear();
+
+    for (int i = 0; i < (int)pool_.size(); i++) {
+        char* data = pool_.at(i);
+        srs_freepa(data);
+    }
+    pool_.clear();
+}
+
+void SrsRtcPacer::set_target_kbps(int kbps)
+{
+    rate_kbps_ = (int)(kbps * SRS_RTC_PACER_FACTOR);
+}
+
+int SrsRtcPacer::rate_kbps()
+{
+    return rate_kbps_;
+}
+
+int SrsRtcPacer::size()
+{
+    return (int)queue_.size();
+}
+
+srs_error_t SrsRtcPacer::send(char* data, int size, int twcc_sn, bool priority, srs_utime_t now)
+{
+    srs_error_t err = srs_success;
+
+    refill(now);
+
+    // Directly send the prior packet, or there is budget and no packet is waiting.
+    if (priority || (queue_.empty() && budget_ > 0)) {
+        budget_ -= size;
+        return handler_->on_pacer_send(data, size, twcc_sn);
+    }
+
+    if (size > kRtpPacketSize) {
+        return srs_error_new(ERROR_RTC_RTP_MUXER, "pacer packet %d exceeds %d", size, kRtpPacketSize);
+    }
+
+    SrsRtcPacedPacket pkt;
+    if (pool_.empty()) {
+        pkt.data = new char[kRtpPacketSize];
+    } else {
+        pkt.data = pool_.back();
+        pool_.pop_back();
+    }
+
+    memcpy(pkt.data, data, size);
+    pkt.size = size;
+    pkt.twcc_sn = twcc_sn;
+    pkt.enqueue_at = now;
+    queue_.push_back(pkt);
+
+    return err;
+}
+
+srs_error_t SrsRtcPacer::flush(srs_utime_t now)
+{
+    srs_error_t err = srs_success;
+
+    refill(now);
+
+    while (!queue_.empty()) {
+        SrsRtcPacedPacket pkt = queue_.front();
+
+        // Send the packet which waits too long, even there is no budget.
+        if (budget_ <= 0 && now - pkt.enqueue_at < SRS_RTC_PACER_MAX_DELAY) {
+            break;
+        }
+
+        queue_.pop_front();
+        budget_ -= pkt.size;
+
+        err = handler_->on_pacer_send(pkt.data, pkt.size, pkt.twcc_sn);
+
+        if ((int)pool_.size() < SRS_RTC_PACER_POOL) {
+            pool_.push_back(pkt.data);
+        } else {
+            srs_freepa(pkt.data);
+        }
+
+        if (err != srs_success) {
+            return srs_error_wrap(err, "pacer send");
+        }
+    }
+
+    return err;
+}
+
+void SrsRtcPacer::refill(srs_utime_t now)
+{
+    if (!last_refill_) {
+        budget_ = max_budget();
+        last_refill_ = now;
+        return;
+    }
+
+    srs_utime_t elapsed = now - last_refill_;
+    if (elapsed <= 0) {
+        return;
+    }
+
+    budget_ = srs_min(max_budget(), budget_ + (int64_t)rate_kbps_ * elapsed / 8000);
+    last_refill_ = now;
+}
+
+int64_t SrsRtcPacer::max_budget()
+{
+    return (int64_t)rate_kbps_ * SRS_RTC_PACER_MAX_BURST / 8000;
+}
+
@@ -0,0 +1,166 @@
+//
+// Copyright (c) 2013-2024 The SRS Authors
+//
+// SPDX-License-Identifier: MIT
+//
+
+#ifndef SRS_APP_RTC_BWE_HPP
+#define SRS_APP_RTC_BWE_HPP
+
+#include <srs_core.hpp>
+
+#include <deque>
+#include <vector>
+
+#include <srs_core_time.hpp>
+#include <srs_kernel_rtc_rtcp.hpp>
+
+// The range of estimated bandwidth in kbps.
+#define SRS_RTC_BWE_MIN_KBPS 64
+#define SRS_RTC_BWE_START_KBPS 1500
+#define SRS_RTC_BWE_MAX_KBPS 20000
+
+// The state of network, detected by the delay gradient of packets.
+enum SrsRtcBweState
+{
+    SrsRtcBweStateNormal = 0,
+    SrsRtcBweStateOverusing,
+    SrsRtcBweStateUnderusing,
+};
+
+// The send-side bandwidth estimator for player, by the TWCC feedback, which is
+// a simplified GCC, see https://datatracker.ietf.org/doc/html/draft-ietf-rmcat-gcc-02
+//      1. The delay-based controller, detects the queue delay by trendline filter of
+//         the delay gradient of packet groups, then AIMD the bitrate.
+//      2. The loss-based controller, decrease the bitrate if loss is heavy.
+// The estimated bitrate is the minimum of them.
+class SrsRtcBandwidthEstimator
+{
+private:
+    // The sent packet, to match the TWCC feedback by transport-wide sequence number.
+    struct SrsRtcSentPacket
+    {
+        uint16_t sn;
+        int size;
+        srs_utime_t send_at;
+        bool valid;
+    };
+    SrsRtcSentPacket* history_;
+private:
+    // The first and last send time of current packet group, and the arrival time of last packet.
+    bool has_group_;
+    srs_utime_t group_first_send_;
+    srs_utime_t group_last_send_;
+    int64_t group_last_arrival_;
+    // The previous complete packet group.
+    bool has_prev_group_;
+    srs_utime_t prev_group_send_;
+    int64_t prev_group_arrival_;
+private:
+    // The trendline filter of delay gradient, in ms.
+    double accumulated_delay_;
+    double smoothed_delay_;
+    int64_t first_arrival_;
+    int nn_deltas_;
+    std::deque<std::pair<double, double> > samples_;
+    double prev_trend_;
+    // The adaptive threshold to detect overuse.
+    double threshold_;
+    int64_t last_threshold_at_;
+    // The time and count of overusing, to avoid detecting overuse by jitter.
+    double overusing_time_;
+    int nn_overusing_;
+    SrsRtcBweState state_;
+private:
+    // The bitrate of packets acked by peer.
+    uint64_t acked_bytes_;
+    srs_utime_t acked_window_;
+    int acked_kbps_;
+    // The packets lost in the window of loss-based controller.
+    int nn_lost_;
+    int nn_total_;
+    srs_utime_t loss_window_;
+    float lost_rate_;
+private:
+    int delay_kbps_;
+    int loss_kbps_;
+    srs_utime_t last_update_;
+    srs_utime_t last_decrease_;
+public:
+    SrsRtcBandwidthEstimator();
+    virtual ~SrsRtcBandwidthEstimator();
+public:
+    // When sent packet with transport-wide sequence number.
+    void on_packet_sent(uint16_t sn, int size, srs_utime_t now);
+    // When got the TWCC feedback from peer.
+    void on_feedback(const std::vector<SrsRtcpTWCCStatus>& statuses, srs_utime_t now);
+    // Get the estimated bitrate in kbps.
+    int target_kbps();
+    // Get the bitrate of packets acked by peer.
+    int acked_kbps();
+    float lost_rate();
+    SrsRtcBweState state();
+private:
+    void on_packet_group(srs_utime_t send_at, int64_t arrival);
+    void update_trendline(double delay_ms, double send_delta_ms, int64_t arrival);
+    void detect(double trend, double ts_delta_ms, int64_t arrival);
+    void update_acked(uint64_t bytes, srs_utime_t now);
+    void update_loss(int nn_lost, int nn_total, srs_utime_t now);
+    void update_delay_based(srs_utime_t now);
+};
+
+// The handler for pacer to send packet.
+class ISrsRtcPacerHandler
+{
+public:
+    ISrsRtcPacerHandler();
+    virtual ~ISrsRtcPacerHandler();
+public:
+    // Send the packet, the twcc_sn is -1 if no transport-wide sequence number.
+    virtual srs_error_t on_pacer_send(char* data, int size, int twcc_sn) = 0;
+};
+
+// The leaky-bucket pacer, to smooth the bursts of keyframe. The audio and retransmission
+// packets are prior, which are sent immediately and only consume the budget. The video
+// packets wait for budget, but never wait for more than the max queue delay.
+class SrsRtcPacer
+{
+private:
+    // The packet in queue, the data is a buffer from pool.
+    struct SrsRtcPacedPacket
+    {
+        char* data;
+        int size;
+        int twcc_sn;
+        srs_utime_t enqueue_at;
+    };
+    ISrsRtcPacerHandler* handler_;
+    std::deque<SrsRtcPacedPacket> queue_;
+    // The free buffers to reuse.
+    std::vector<char*> pool_;
+private:
+    // The pacing rate in kbps.
+    int rate_kbps_;
+    // The budget in bytes, might be negative for debt.
+    int64_t budget_;
+    srs_utime_t last_refill_;
+public:
+    SrsRtcPacer(ISrsRtcPacerHandler* h);
+    virtual ~SrsRtcPacer();
+public:
+    // Set the pacing rate by the estimated bitrate.
+    void set_target_kbps(int kbps);
+    int rate_kbps();
+    // Get the number of packets in queue.
+    int size();
+    // Send the packet, or queue it if no budget.
+    srs_error_t send(char* data, int size, int twcc_sn, bool priority, srs_utime_t now);
+    // Send packets in queue, for the budget is refilled.
+    srs_error_t flush(srs_utime_t now);
+private:
+    void refill(srs_utime_t now);
+    int64_t max_budget();
+};
+
+#endif
+
@@ -6,9 +6,29 @@
 
 #include <srs_app_rtc_codec.hpp>
 
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+
 #include <srs_kernel_codec.hpp>
 #include <srs_kernel_error.hpp>
 #include <srs_kernel_log.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_protocol_utility.hpp>
+#include <srs_protocol_rtmp_stack.hpp>
+#include <srs_app_config.hpp>
+#include <srs_app_statistic.hpp>
+
+// The max number of frames in queue of transcoding task.
+#define SRS_AUDIO_TRANSCODE_QUEUE 256
+// The max time to wait for input frames, to free the disposed tasks if idle.
+#define SRS_AUDIO_TRANSCODE_WAIT (100 * SRS_UTIME_MILLISECONDS)
+
+// Whether current thread is a transcode worker thread, which should never write log.
+static __thread bool _srs_transcode_worker = false;
+// The number of FFmpeg warnings and errors in worker threads, reported by ST thread.
+static int64_t _srs_transcode_ffmpeg_errors = 0;
 
 static const AVCodec* srs_find_decoder_by_id(SrsAudioCodecId id)
 {
@@ -51,7 +71,15 @@ public:
 
     static void ffmpeg_log_callback(void*, int level, const char* fmt, va_list vl) 
     {
-        static char buf[4096] = {0};
+        // The log is not thread-safe, so we only count the warnings and errors in worker thread.
+        if (_srs_transcode_worker) {
+            if (level <= AV_LOG_WARNING) {
+                __atomic_add_fetch(&_srs_transcode_ffmpeg_errors, 1, __ATOMIC_RELAXED);
+            }
+            return;
+        }
+
+        static __thread char buf[4096];
         int nbytes = vsnprintf(buf, sizeof(buf), fmt, vl);
         if (nbytes > 0 && nbytes < (int)sizeof(buf)) {
             // Srs log is always start with new line, replcae '\n' to '\0', make log easy to read.
@@ -172,17 +200,22 @@ srs_error_t SrsAudioTranscoder::transcode(SrsAudioFrame *in_pkt, std::vector<Srs
     return err;
 }
 
+// Free the audio frame and its samples, which is allocated by transcoder.
+static void srs_free_audio_frame(SrsAudioFrame* p)
+{
+    for (int i = 0; i < p->nb_samples; i++) {
+        char* pa = p->samples[i].bytes;
+        srs_freepa(pa);
+    }
+
+    srs_freep(p);
+}
+
 void SrsAudioTranscoder::free_frames(std::vector<SrsAudioFrame*>& frames)
 {
     for (std::vector<SrsAudioFrame*>::iterator it = frames.begin(); it != frames.end(); ++it) {
         SrsAudioFrame* p = *it;
-
-        for (int i = 0; i < p->nb_samples; i++) {
-            char* pa = p->samples[i].bytes;
-            srs_freepa(pa);
-        }
-
-        srs_freep(p);
+        srs_free_audio_frame(p);
     }
 }
 
@@ -381,12 +414,15 @@ srs_error_t SrsAudioTranscoder::encode(std::vector<SrsAudioFrame*> &pkts)
     char err_buf[AV_ERROR_MAX_STRING_SIZE] = {0};
 
     if (next_out_pts_ == AV_NOPTS_VALUE) {
-        next_out_pts_ = new_pkt_pts_;
+        next_out_pts_ = av_rescale(new_pkt_pts_, enc_->time_base.den, 1000);
     } else {
         int64_t diff = llabs(new_pkt_pts_ - av_rescale(next_out_pts_, 1000, enc_->time_base.den));
         if (diff > 1000) {
-            srs_trace("time diff to large=%lld, next out=%lld, new pkt=%lld, set to new pkt",
-                diff, next_out_pts_, new_pkt_pts_);
+            // Never write log in worker thread, for the log is not thread-safe.
+            if (!_srs_transcode_worker) {
+                srs_trace("time diff to large=%lld, next out=%lld, new pkt=%lld, set to new pkt",
+                    diff, next_out_pts_, new_pkt_pts_);
+            }
             next_out_pts_ = av_rescale(new_pkt_pts_, enc_->time_base.den, 1000);
         }
     }
@@ -475,3 +511,473 @@ void SrsAudioTranscoder::free_swr_samples()
     }
 }
 
+
+// Get the CPU time of current thread, in microseconds.
+static int64_t srs_thread_cputime()
+{
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) {
+        return 0;
+    }
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+SrsAudioTranscodeTask::SrsAudioTranscodeTask(SrsAudioTranscoder* codec)
+{
+    codec_ = codec;
+    inputs_ = new SrsThreadQueue<SrsAudioFrame*>(SRS_AUDIO_TRANSCODE_QUEUE);
+    outputs_ = new SrsThreadQueue<SrsAudioFrame*>(SRS_AUDIO_TRANSCODE_QUEUE);
+    disposed_ = 0;
+    worker_ = NULL;
+
+    cpu_ = 0;
+    nn_frames_ = 0;
+    nn_errors_ = 0;
+    last_error_ = 0;
+}
+
+SrsAudioTranscodeTask::~SrsAudioTranscodeTask()
+{
+    SrsAudioFrame* frame = NULL;
+    while (inputs_->pop(frame)) {
+        srs_free_audio_frame(frame);
+    }
+    while (outputs_->pop(frame)) {
+        srs_free_audio_frame(frame);
+    }
+
+    srs_freep(inputs_);
+    srs_freep(outputs_);
+    srs_freep(codec_);
+}
+
+bool SrsAudioTranscodeTask::consume()
+{
+    SrsAudioFrame* in = NULL;
+    if (!inputs_->pop(in)) {
+        return false;
+    }
+
+    int64_t starttime = srs_thread_cputime();
+
+    std::vector<SrsAudioFrame*> outs;
+    srs_error_t err = codec_->transcode(in, outs);
+    srs_free_audio_frame(in);
+
+    __atomic_add_fetch(&cpu_, srs_thread_cputime() - starttime, __ATOMIC_RELAXED);
+
+    if (err != srs_success) {
+        __atomic_store_n(&last_error_, srs_error_code(err), __ATOMIC_RELAXED);
+        __atomic_add_fetch(&nn_errors_, 1, __ATOMIC_RELAXED);
+        srs_freep(err);
+    }
+
+    // Drop the output frames if ST thread is too slow to consume them.
+    for (int i = 0; i < (int)outs.size(); i++) {
+        SrsAudioFrame* out = outs.at(i);
+        if (!outputs_->push(out)) {
+            srs_free_audio_frame(out);
+            __atomic_add_fetch(&nn_errors_, 1, __ATOMIC_RELAXED);
+        }
+    }
+    __atomic_add_fetch(&nn_frames_, (int64_t)outs.size(), __ATOMIC_RELAXED);
+
+    return true;
+}
+
+SrsAudioTranscodeWorker::SrsAudioTranscodeWorker()
+{
+    lock_ = new SrsThreadMutex();
+    version_ = 0;
+    nn_tasks_ = 0;
+    cond_ = new SrsThreadCond();
+    quit_ = 0;
+    entry_ = NULL;
+}
+
+SrsAudioTranscodeWorker::~SrsAudioTranscodeWorker()
+{
+    stop();
+
+    srs_freep(cond_);
+    srs_freep(lock_);
+}
+
+void SrsAudioTranscodeWorker::attach(SrsAudioTranscodeTask* task)
+{
+    SrsThreadLocker(lock_);
+
+    task->worker_ = this;
+    tasks_.push_back(task);
+    __atomic_store_n(&nn_tasks_, (int)tasks_.size(), __ATOMIC_RELAXED);
+    __atomic_add_fetch(&version_, 1, __ATOMIC_RELEASE);
+}
+
+int SrsAudioTranscodeWorker::nn_tasks()
+{
+    return __atomic_load_n(&nn_tasks_, __ATOMIC_RELAXED);
+}
+
+void SrsAudioTranscodeWorker::wakeup()
+{
+    cond_->signal();
+}
+
+srs_error_t SrsAudioTranscodeWorker::start()
+{
+    return _srs_thread_pool->execute("transcode", SrsAudioTranscodeWorker::start, this, &entry_);
+}
+
+void SrsAudioTranscodeWorker::stop()
+{
+    if (!entry_) {
+        return;
+    }
+
+    __atomic_store_n(&quit_, 1, __ATOMIC_RELEASE);
+    cond_->signal();
+
+    srs_error_t err = _srs_thread_pool->join(entry_);
+    if (err != srs_success) {
+        srs_warn("Transcode: ignore stop worker err %s", srs_error_desc(err).c_str());
+        srs_freep(err);
+    }
+    entry_ = NULL;
+}
+
+srs_error_t SrsAudioTranscodeWorker::start(void* arg)
+{
+    SrsAudioTranscodeWorker* worker = (SrsAudioTranscodeWorker*)arg;
+    return worker->cycle();
+}
+
+srs_error_t SrsAudioTranscodeWorker::cycle()
+{
+    srs_error_t err = srs_success;
+
+    // Never write log in worker thread, including the FFmpeg logs.
+    _srs_transcode_worker = true;
+
+    uint32_t version = 0;
+    std::vector<SrsAudioTranscodeTask*> tasks;
+    std::vector<SrsAudioTranscodeTask*> disposed;
+
+    // Note that the tasks which are not disposed are still used by ST thread, so never free them when quit.
+    while (!__atomic_load_n(&quit_, __ATOMIC_ACQUIRE)) {
+        // Refresh the tasks only when changed by ST thread, to avoid lock for each loop.
+        if (version != __atomic_load_n(&version_, __ATOMIC_ACQUIRE)) {
+            SrsThreadLocker(lock_);
+            tasks = tasks_;
+            version = version_;
+        }
+
+        bool busy = false;
+        for (int i = 0; i < (int)tasks.size(); i++) {
+            SrsAudioTranscodeTask* task = tasks.at(i);
+
+            if (__atomic_load_n(&task->disposed_, __ATOMIC_ACQUIRE)) {
+                disposed.push_back(task);
+                continue;
+            }
+
+            while (task->consume()) {
+                busy = true;
+            }
+        }
+
+        // Free the tasks closed by ST thread, which never access the task after disposed.
+        if (!disposed.empty()) {
+            if (true) {
+                SrsThreadLocker(lock_);
+                for (int i = 0; i < (int)disposed.size(); i++) {
+                    std::vector<SrsAudioTranscodeTask*>::iterator it = std::find(tasks_.begin(), tasks_.end(), disposed.at(i));
+                    if (it != tasks_.end()) {
+                        tasks_.erase(it);
+                    }
+                }
+                __atomic_store_n(&nn_tasks_, (int)tasks_.size(), __ATOMIC_RELAXED);
+                __atomic_add_fetch(&version_, 1, __ATOMIC_RELEASE);
+            }
+
+            for (int i = 0; i < (int)disposed.size(); i++) {
+                SrsAudioTranscodeTask* task = disposed.at(i);
+                srs_freep(task);
+            }
+            disposed.clear();
+        }
+
+        // Wait for the input frames, which signaled by ST thread.
+        if (!busy) {
+            cond_->wait(SRS_AUDIO_TRANSCODE_WAIT);
+        }
+    }
+
+    return err;
+}
+
+SrsAudioTranscodePool::SrsAudioTranscodePool()
+{
+    started_ = false;
+    nn_streams_ = 0;
+}
+
+SrsAudioTranscodePool::~SrsAudioTranscodePool()
+{
+    stop();
+}
+
+bool SrsAudioTranscodePool::acquire()
+{
+    int max_transcoders = _srs_config->get_threads_max_transcoders();
+    if (max_transcoders > 0 && nn_streams_ >= max_transcoders) {
+        return false;
+    }
+
+    // Never start new transcoding when CPU is critical, because it's CPU-intensive.
+    if (_srs_circuit_breaker && _srs_circuit_breaker->hybrid_critical_water_level()) {
+        return false;
+    }
+
+    nn_streams_++;
+    return true;
+}
+
+void SrsAudioTranscodePool::release()
+{
+    nn_streams_--;
+}
+
+bool SrsAudioTranscodePool::attach(SrsAudioTranscodeTask* task)
+{
+    if (!started_) {
+        started_ = true;
+
+        int nn_workers = _srs_config->get_threads_transcode();
+        for (int i = 0; i < nn_workers; i++) {
+            SrsAudioTranscodeWorker* worker = new SrsAudioTranscodeWorker();
+
+            srs_error_t err = worker->start();
+            if (err != srs_success) {
+                srs_warn("Transcode: ignore start worker err %s", srs_error_desc(err).c_str());
+                srs_freep(err);
+                srs_freep(worker);
+                break;
+            }
+
+            workers_.push_back(worker);
+        }
+
+        srs_trace("Transcode: start %d workers, max_transcoders=%d", (int)workers_.size(),
+            _srs_config->get_threads_max_transcoders());
+    }
+
+    if (workers_.empty()) {
+        return false;
+    }
+
+    // Attach to the worker with least tasks.
+    SrsAudioTranscodeWorker* worker = workers_.at(0);
+    for (int i = 1; i < (int)workers_.size(); i++) {
+        if (workers_.at(i)->nn_tasks() < worker->nn_tasks()) {
+            worker = workers_.at(i);
+        }
+    }
+
+    worker->attach(task);
+    return true;
+}
+
+void SrsAudioTranscodePool::stop()
+{
+    // Never start the workers again, the new streams transcode in ST thread.
+    started_ = true;
+
+    // Note that the workers are never freed, because the tasks of streams still refer to them.
+    for (int i = 0; i < (int)workers_.size(); i++) {
+        SrsAudioTranscodeWorker* worker = workers_.at(i);
+        worker->stop();
+    }
+    workers_.clear();
+}
+
+SrsAudioTranscodePool* _srs_audio_transcode_pool = new SrsAudioTranscodePool();
+
+SrsAsyncAudioTranscoder::SrsAsyncAudioTranscoder()
+{
+    req_ = NULL;
+    codec_ = NULL;
+    task_ = NULL;
+    admitted_ = false;
+    nn_drops_ = 0;
+
+    last_report_ = 0;
+    last_cpu_ = 0;
+    last_errors_ = 0;
+    cpu_ = 0;
+    nn_frames_ = 0;
+}
+
+SrsAsyncAudioTranscoder::~SrsAsyncAudioTranscoder()
+{
+    // The task is freed by worker thread, and the codec is owned by task.
+    if (task_) {
+        __atomic_store_n(&task_->disposed_, 1, __ATOMIC_RELEASE);
+        task_ = NULL;
+        codec_ = NULL;
+    }
+    srs_freep(codec_);
+
+    if (admitted_) {
+        _srs_audio_transcode_pool->release();
+    }
+
+    srs_freep(req_);
+}
+
+srs_error_t SrsAsyncAudioTranscoder::initialize(SrsRequest* req, SrsAudioCodecId from, SrsAudioCodecId to, int channels, int sample_rate, int bit_rate)
+{
+    srs_error_t err = srs_success;
+
+    srs_freep(req_);
+    req_ = req->copy();
+
+    codec_ = new SrsAudioTranscoder();
+    if ((err = codec_->initialize(from, to, channels, sample_rate, bit_rate)) != srs_success) {
+        return srs_error_wrap(err, "init codec");
+    }
+
+    if (!admit()) {
+        srs_warn("Transcode: drop audio of %s, exceed max transcoders or CPU critical", req_->get_stream_url().c_str());
+    }
+
+    return err;
+}
+
+srs_error_t SrsAsyncAudioTranscoder::transcode(SrsAudioFrame* in, std::vector<SrsAudioFrame*>& outs)
+{
+    srs_error_t err = srs_success;
+
+    // Try to admit again, because the transcoders or CPU might be available now.
+    if (!admitted_ && !admit()) {
+        nn_drops_++;
+        report();
+        return err;
+    }
+
+    // Transcode in ST thread, if no worker thread.
+    if (!task_) {
+        int64_t starttime = srs_thread_cputime();
+        err = codec_->transcode(in, outs);
+        cpu_ += srs_thread_cputime() - starttime;
+        nn_frames_ += outs.size();
+
+        report();
+        return err;
+    }
+
+    // Drop the input frame when CPU is dying, or worker thread is too slow.
+    if (_srs_circuit_breaker && _srs_circuit_breaker->hybrid_dying_water_level()) {
+        nn_drops_++;
+    } else if (in->nb_samples > 0 && in->samples[0].size > 0) {
+        SrsAudioFrame* frame = new SrsAudioFrame();
+        char* buf = new char[in->samples[0].size];
+        memcpy(buf, in->samples[0].bytes, in->samples[0].size);
+        frame->add_sample(buf, in->samples[0].size);
+        frame->dts = in->dts;
+        frame->cts = in->cts;
+
+        if (!task_->inputs_->push(frame)) {
+            srs_free_audio_frame(frame);
+            nn_drops_++;
+        } else {
+            task_->worker_->wakeup();
+        }
+    }
+
+    // Consume the output frames transcoded by worker thread.
+    SrsAudioFrame* out = NULL;
+    while (task_->outputs_->pop(out)) {
+        outs.push_back(out);
+    }
+
+    report();
+
+    return err;
+}
+
+void SrsAsyncAudioTranscoder::free_frames(std::vector<SrsAudioFrame*>& frames)
+{
+    for (std::vector<SrsAudioFrame*>::iterator it = frames.begin(); it != frames.end(); ++it) {
+        SrsAudioFrame* p = *it;
+        srs_free_audio_frame(p);
+    }
+}
+
+void SrsAsyncAudioTranscoder::aac_codec_header(uint8_t** data, int* len)
+{
+    // The extradata of codec is never changed after initialized, so it's safe to read in ST thread.
+    codec_->aac_codec_header(data, len);
+}
+
+int64_t SrsAsyncAudioTranscoder::cpu()
+{
+    return task_ ? __atomic_load_n(&task_->cpu_, __ATOMIC_RELAXED) : cpu_;
+}
+
+int64_t SrsAsyncAudioTranscoder::nn_frames()
+{
+    return task_ ? __atomic_load_n(&task_->nn_frames_, __ATOMIC_RELAXED) : nn_frames_;
+}
+
+bool SrsAsyncAudioTranscoder::admit()
+{
+    if (!_srs_audio_transcode_pool->acquire()) {
+        return false;
+    }
+    admitted_ = true;
+
+    // Move the codec to task, if attached to worker.
+    SrsAudioTranscodeTask* task = new SrsAudioTranscodeTask(codec_);
+    if (_srs_audio_transcode_pool->attach(task)) {
+        task_ = task;
+    } else {
+        task->codec_ = NULL;
+        srs_freep(task);
+    }
+
+    return true;
+}
+
+void SrsAsyncAudioTranscoder::report()
+{
+    srs_utime_t now = srs_get_system_time();
+    if (now - last_report_ < SRS_UTIME_SECONDS) {
+        return;
+    }
+
+    // The CPU percent of a core, in the duration from last report.
+    int64_t cpu = this->cpu();
+    float percent = 0;
+    if (last_report_ > 0) {
+        percent = (cpu - last_cpu_) * 100.0 / (now - last_report_);
+    }
+    last_report_ = now;
+    last_cpu_ = cpu;
+
+    // Report the errors of worker thread, which never writes log.
+    if (task_) {
+        int64_t nn_errors = __atomic_load_n(&task_->nn_errors_, __ATOMIC_RELAXED);
+        if (nn_errors > last_errors_) {
+            srs_warn("Transcode: ignore %" PRId64 " errors of %s, total=%" PRId64 ", last code=%d", nn_errors - last_errors_,
+                req_->get_stream_url().c_str(), nn_errors, __atomic_load_n(&task_->last_error_, __ATOMIC_RELAXED));
+            last_errors_ = nn_errors;
+        }
+    }
+
+    int64_t nn_ffmpeg_errors = __atomic_exchange_n(&_srs_transcode_ffmpeg_errors, 0, __ATOMIC_RELAXED);
+    if (nn_ffmpeg_errors > 0) {
+        srs_warn("Transcode: ignore %" PRId64 " FFmpeg warnings or errors in worker threads", nn_ffmpeg_errors);
+    }
+
+    SrsStatistic::instance()->on_stream_transcode(req_, percent, nn_frames(), nn_drops_);
+}
@@ -12,6 +12,12 @@
 #include <srs_kernel_codec.hpp>
 
 #include <string>
+#include <vector>
+
+#include <srs_app_threads.hpp>
+
+class SrsRequest;
+class SrsAudioTranscodeWorker;
 
 #ifdef __cplusplus
 extern "C" {
@@ -78,5 +84,132 @@ private:
     void free_swr_samples();
 };
 
+// The transcoding task of a stream, shared by the ST thread and the worker thread. The ST thread
+// pushes the input frames and pops the output frames, while the worker thread transcodes them, so
+// the frames of a stream are always transcoded in order.
+class SrsAudioTranscodeTask
+{
+public:
+    // The codec is owned by task, and only used by worker thread.
+    SrsAudioTranscoder* codec_;
+    // The input frames from ST thread, and the output frames from worker thread.
+    SrsThreadQueue<SrsAudioFrame*>* inputs_;
+    SrsThreadQueue<SrsAudioFrame*>* outputs_;
+    // Whether the stream is closed by ST thread, then the worker thread frees the task.
+    int disposed_;
+    // The worker thread of task, to wakeup it when push input frames.
+    SrsAudioTranscodeWorker* worker_;
+public:
+    // The CPU time in microseconds used by worker thread, and the number of transcoded frames,
+    // written by worker thread and read by ST thread.
+    int64_t cpu_;
+    int64_t nn_frames_;
+    // The number of errors and the code of last error, reported by ST thread, because the log is not thread-safe.
+    int64_t nn_errors_;
+    int last_error_;
+public:
+    SrsAudioTranscodeTask(SrsAudioTranscoder* codec);
+    virtual ~SrsAudioTranscodeTask();
+public:
+    // Transcode the input frames in worker thread, return false if no input.
+    bool consume();
+};
+
+// The worker thread to transcode the audio of streams.
+class SrsAudioTranscodeWorker
+{
+private:
+    SrsThreadMutex* lock_;
+    // The tasks attached by ST thread, protected by lock.
+    std::vector<SrsAudioTranscodeTask*> tasks_;
+    uint32_t version_;
+    int nn_tasks_;
+    // To wait for input frames, or signaled to quit.
+    SrsThreadCond* cond_;
+    int quit_;
+    SrsThreadEntry* entry_;
+public:
+    SrsAudioTranscodeWorker();
+    virtual ~SrsAudioTranscodeWorker();
+public:
+    void attach(SrsAudioTranscodeTask* task);
+    int nn_tasks();
+    // Wakeup the worker thread to consume the frames.
+    void wakeup();
+public:
+    // Start the worker thread, and stop it then wait for it to quit.
+    srs_error_t start();
+    void stop();
+private:
+    static srs_error_t start(void* arg);
+private:
+    srs_error_t cycle();
+};
+
+// The pool of worker threads for audio transcoding, to offload the CPU-intensive codec from ST
+// thread, which may add jitter to all other connections. It also limits the number of transcoding
+// streams, and rejects new streams if the circuit breaker is critical.
+class SrsAudioTranscodePool
+{
+private:
+    bool started_;
+    std::vector<SrsAudioTranscodeWorker*> workers_;
+    // The number of admitted streams, only used by ST thread.
+    int nn_streams_;
+public:
+    SrsAudioTranscodePool();
+    virtual ~SrsAudioTranscodePool();
+public:
+    // Admit a new transcoding stream, return false if exceed the max transcoders.
+    bool acquire();
+    void release();
+    // Attach the task to the worker with least tasks, start the workers if not started. Return
+    // false if there is no worker, then the stream should transcode in ST thread.
+    bool attach(SrsAudioTranscodeTask* task);
+    // Stop all worker threads, then the new streams transcode in ST thread.
+    void stop();
+};
+
+// It MUST be thread-safe, global and shared object.
+extern SrsAudioTranscodePool* _srs_audio_transcode_pool;
+
+// The audio transcoder for stream, which transcodes frames in worker thread. The transcoded frames
+// are returned by the following transcode calls, in the same order of input frames.
+// @remark The stream transcodes in ST thread, if there is no worker thread.
+class SrsAsyncAudioTranscoder
+{
+private:
+    SrsRequest* req_;
+    // The codec is owned by task if async, or by this object.
+    SrsAudioTranscoder* codec_;
+    SrsAudioTranscodeTask* task_;
+    // Whether admitted by pool, or the audio frames are dropped.
+    bool admitted_;
+    int64_t nn_drops_;
+    // The CPU time in microseconds and transcoded frames, if transcode in ST thread.
+    int64_t cpu_;
+    int64_t nn_frames_;
+private:
+    srs_utime_t last_report_;
+    int64_t last_cpu_;
+    int64_t last_errors_;
+public:
+    SrsAsyncAudioTranscoder();
+    virtual ~SrsAsyncAudioTranscoder();
+public:
+    // Initialize the transcoder, see SrsAudioTranscoder::initialize for detail.
+    srs_error_t initialize(SrsRequest* req, SrsAudioCodecId from, SrsAudioCodecId to, int channels, int sample_rate, int bit_rate);
+    // Transcode the input audio frame in, and get the transcoded output audio frames outs.
+    srs_error_t transcode(SrsAudioFrame* in, std::vector<SrsAudioFrame*>& outs);
+    void free_frames(std::vector<SrsAudioFrame*>& frames);
+    void aac_codec_header(uint8_t** data, int* len);
+    // The CPU time in microseconds used to transcode the stream, and the transcoded frames.
+    int64_t cpu();
+    int64_t nn_frames();
+private:
+    bool admit();
+    void report();
+};
+
 #endif /* SRS_APP_AUDIO_RECODE_HPP */
 
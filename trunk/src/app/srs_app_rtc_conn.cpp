@@ -564,6 +564,9 @@ void SrsRtcPlayStream::on_stream_change(SrsRtcSourceDescription* desc)
                 track->track_desc_->red_->pt_of_publisher_ = vdesc->red_->pt_;
             }
 
+            // For simulcast, the SSRC of layers might be learned from RID, or changed by republish.
+            track->set_encodings(vdesc->encodings_);
+
             video_tracks_.clear();
             video_tracks_.insert(make_pair(ssrc, track));
         }
@@ -727,6 +730,14 @@ srs_error_t SrsRtcPlayStream::send_packet(SrsRtpPacket*& pkt)
             if (it != video_tracks_.end()) {
                 track = it->second;
             }
+
+            // For simulcast, the track is identified by the SSRC of the first layer, so we should check
+            // the other layers.
+            for (it = video_tracks_.begin(); !track && it != video_tracks_.end(); ++it) {
+                if (it->second->has_layer(ssrc)) {
+                    track = it->second;
+                }
+            }
         }
 
         if (track && !cache_ssrc2_) {
@@ -754,6 +765,14 @@ srs_error_t SrsRtcPlayStream::send_packet(SrsRtpPacket*& pkt)
         return srs_error_wrap(err, "audio track, SSRC=%u, SEQ=%u", ssrc, pkt->header.get_sequence());
     }
 
+    // For simulcast, request keyframe of the layer to switch to.
+    if (!pkt->is_audio()) {
+        uint32_t layer_ssrc = ((SrsRtcVideoSendTrack*)track)->fetch_keyframe_request();
+        if (layer_ssrc) {
+            pli_worker_->request_keyframe(layer_ssrc, cid_);
+        }
+    }
+
     // For NACK to handle packet.
     // @remark Note that the pkt might be set to NULL.
     if (nack_enabled_) {
@@ -821,6 +840,16 @@ srs_error_t SrsRtcPlayStream::on_rtcp_rr(SrsRtcpRR* rtcp)
 {
     srs_error_t err = srs_success;
 
+    // For simulcast, select the layer by the fraction lost of player.
+    uint32_t ssrc = rtcp->get_rb_ssrc();
+    for (map<uint32_t, SrsRtcVideoSendTrack*>::iterator it = video_tracks_.begin(); it != video_tracks_.end(); ++it) {
+        SrsRtcVideoSendTrack* track = it->second;
+        if (track->has_ssrc(ssrc)) {
+            track->on_feedback(rtcp->get_lost_rate());
+            break;
+        }
+    }
+
     // TODO: FIXME: Implements it.
 
     return err;
@@ -868,6 +897,11 @@ srs_error_t SrsRtcPlayStream::on_rtcp_nack(SrsRtcpNack* rtcp)
             continue;
         }
 
+        // Ignore NACK for FEC packets, which are not cached for retransmission.
+        if (ssrc == track->track_desc_->fec_ssrc_) {
+            return err;
+        }
+
         target = track;
         break;
     }
@@ -922,13 +956,23 @@ uint32_t SrsRtcPlayStream::get_video_publish_ssrc(uint32_t play_ssrc)
     std::map<uint32_t, SrsRtcVideoSendTrack*>::iterator it;
     for (it = video_tracks_.begin(); it != video_tracks_.end(); ++it) {
         if (it->second->has_ssrc(play_ssrc)) {
-            return it->first;
+            // For simulcast, request keyframe of the forwarding layer.
+            uint32_t layer_ssrc = it->second->get_layer_ssrc();
+            return layer_ssrc ? layer_ssrc : it->first;
         }
     }
 
     return 0;
 }
 
+void SrsRtcPlayStream::on_bandwidth(int kbps)
+{
+    for (map<uint32_t, SrsRtcVideoSendTrack*>::iterator it = video_tracks_.begin(); it != video_tracks_.end(); ++it) {
+        SrsRtcVideoSendTrack* track = it->second;
+        track->on_bandwidth(kbps);
+    }
+}
+
 srs_error_t SrsRtcPlayStream::do_request_keyframe(uint32_t ssrc, SrsContextId cid)
 {
     srs_error_t err = srs_success;
@@ -1091,6 +1135,7 @@ SrsRtcPublishStream::SrsRtcPublishStream(SrsRtcConnection* session, const SrsCon
     nn_audio_frames = 0;
     twcc_enabled_ = false;
     twcc_id_ = 0;
+    rid_id_ = repaired_rid_id_ = 0;
     twcc_fb_count_ = 0;
     
     pli_worker_ = new SrsRtcPLIWorker(this);
@@ -1153,7 +1198,25 @@ srs_error_t SrsRtcPublishStream::initialize(SrsRequest* r, SrsRtcSourceDescripti
 
     for (int i = 0; i < (int)stream_desc->video_track_descs_.size(); ++i) {
         SrsRtcTrackDescription* desc = stream_desc->video_track_descs_.at(i);
-        video_tracks_.push_back(new SrsRtcVideoRecvTrack(session_, desc));
+        if (desc->encodings_.empty()) {
+            video_tracks_.push_back(new SrsRtcVideoRecvTrack(session_, desc));
+            continue;
+        }
+
+        // For simulcast, each layer is a track, which has its own sequence for NACK.
+        for (int j = 0; j < (int)desc->encodings_.size(); ++j) {
+            const SrsRtcTrackEncoding& encoding = desc->encodings_.at(j);
+
+            SrsUniquePtr<SrsRtcTrackDescription> layer(desc->copy());
+            layer->ssrc_ = encoding.ssrc_;
+            layer->rtx_ssrc_ = encoding.rtx_ssrc_;
+            layer->rid_ = encoding.rid_;
+            layer->encodings_.clear();
+            video_tracks_.push_back(new SrsRtcVideoRecvTrack(session_, layer.get()));
+        }
+
+        rid_id_ = desc->get_rtp_extension_id(kRidExt);
+        repaired_rid_id_ = desc->get_rtp_extension_id(kRepairedRidExt);
     }
 
     int twcc_id = -1;
@@ -1395,6 +1458,42 @@ srs_error_t SrsRtcPublishStream::on_rtp_cipher(char* data, int nb_data)
     return err;
 }
 
+bool SrsRtcPublishStream::on_simulcast_ssrc(char* buf, int nb_buf, uint32_t ssrc)
+{
+    if (!rid_id_ && !repaired_rid_id_) {
+        return false;
+    }
+
+    // Parse the RID, or repaired RID for RTX.
+    bool rtx = false;
+    std::string rid;
+    srs_error_t err = srs_rtp_fast_parse_rid(buf, nb_buf, rid_id_, rid);
+    if (err != srs_success && repaired_rid_id_) {
+        srs_freep(err);
+        rtx = true;
+        err = srs_rtp_fast_parse_rid(buf, nb_buf, repaired_rid_id_, rid);
+    }
+    if (err != srs_success) {
+        srs_freep(err);
+        return false;
+    }
+
+    for (int i = 0; i < (int)video_tracks_.size(); ++i) {
+        SrsRtcVideoRecvTrack* track = video_tracks_.at(i);
+        if (track->get_rid() != rid) {
+            continue;
+        }
+
+        track->set_simulcast_ssrc(ssrc, rtx);
+        source_->on_simulcast_ssrc(track->get_track_id(), rid, ssrc, rtx);
+
+        srs_trace("RTC: Simulcast bind rid=%s, ssrc=%u, rtx=%d, track=%s", rid.c_str(), ssrc, rtx, track->get_track_id().c_str());
+        return true;
+    }
+
+    return false;
+}
+
 srs_error_t SrsRtcPublishStream::on_rtp_plaintext(char* plaintext, int nb_plaintext)
 {
     srs_error_t err = srs_success;
@@ -1776,6 +1875,32 @@ srs_error_t SrsRtcConnectionNackTimer::on_timer(srs_utime_t interval)
     return err;
 }
 
+SrsRtcConnectionPacerTimer::SrsRtcConnectionPacerTimer(SrsRtcConnection* p) : p_(p)
+{
+    _srs_hybrid->timer20ms()->subscribe(this);
+}
+
+SrsRtcConnectionPacerTimer::~SrsRtcConnectionPacerTimer()
+{
+    _srs_hybrid->timer20ms()->unsubscribe(this);
+}
+
+srs_error_t SrsRtcConnectionPacerTimer::on_timer(srs_utime_t interval)
+{
+    srs_error_t err = srs_success;
+
+    if (!p_->pacer_ || !p_->pacer_->size()) {
+        return err;
+    }
+
+    if ((err = p_->pacer_->flush(srs_get_system_time())) != srs_success) {
+        srs_warn("ignore pacer err %s", srs_error_desc(err).c_str());
+        srs_freep(err);
+    }
+
+    return err;
+}
+
 SrsRtcConnection::SrsRtcConnection(SrsRtcServer* s, const SrsContextId& cid)
 {
     req_ = NULL;
@@ -1794,6 +1919,11 @@ SrsRtcConnection::SrsRtcConnection(SrsRtcServer* s, const SrsContextId& cid)
     disposing_ = false;
 
     twcc_id_ = 0;
+    twcc_sn_ = 0;
+    bwe_ = NULL;
+    pacer_ = NULL;
+    timer_pacer_ = NULL;
+    last_bwe_report_ = 0;
     nn_simulate_player_nack_drop = 0;
     pli_epp = new SrsErrorPithyPrint();
 
@@ -1808,6 +1938,7 @@ SrsRtcConnection::~SrsRtcConnection()
     _srs_rtc_manager->unsubscribe(this);
 
     srs_freep(timer_nack_);
+    srs_freep(timer_pacer_);
 
     // Cleanup publishers.
     for(map<string, SrsRtcPublishStream*>::iterator it = publishers_.begin(); it != publishers_.end(); ++it) {
@@ -1837,6 +1968,8 @@ SrsRtcConnection::~SrsRtcConnection()
 
     srs_freep(req_);
     srs_freep(pli_epp);
+    srs_freep(pacer_);
+    srs_freep(bwe_);
 }
 
 void SrsRtcConnection::on_before_dispose(ISrsResource* c)
@@ -2073,7 +2206,7 @@ srs_error_t SrsRtcConnection::dispatch_rtcp(SrsRtcpCommon* rtcp)
 
     // For TWCC packet.
     if (SrsRtcpType_rtpfb == rtcp->type() && 15 == rtcp->get_rc()) {
-        return on_rtcp_feedback_twcc(rtcp->data(), rtcp->size());
+        return on_rtcp_feedback_twcc(dynamic_cast<SrsRtcpTWCC*>(rtcp));
     }
 
     // For REMB packet.
@@ -2150,9 +2283,39 @@ srs_error_t SrsRtcConnection::dispatch_rtcp(SrsRtcpCommon* rtcp)
     return err;
 }
 
-srs_error_t SrsRtcConnection::on_rtcp_feedback_twcc(char* data, int nb_data)
+srs_error_t SrsRtcConnection::on_rtcp_feedback_twcc(SrsRtcpTWCC* rtcp)
 {
-    return srs_success;
+    srs_error_t err = srs_success;
+
+    if (!bwe_ || !rtcp) {
+        return err;
+    }
+
+    srs_utime_t now = srs_get_system_time();
+    bwe_->on_feedback(rtcp->get_packet_status(), now);
+
+    int kbps = bwe_->target_kbps();
+    if (pacer_) {
+        pacer_->set_target_kbps(kbps);
+    }
+
+    // Report the estimated bandwidth to players and stat, not for each feedback.
+    if (now - last_bwe_report_ < 1 * SRS_UTIME_SECONDS) {
+        return err;
+    }
+    last_bwe_report_ = now;
+
+    SrsStatistic* stat = SrsStatistic::instance();
+    for (map<string, SrsRtcPlayStream*>::iterator it = players_.begin(); it != players_.end(); ++it) {
+        SrsRtcPlayStream* player = it->second;
+        player->on_bandwidth(kbps);
+        stat->on_client_bandwidth(player->context_id().c_str(), kbps);
+    }
+
+    srs_info("RTC: BWE kbps=%d, acked=%d, loss=%.2f, state=%d, pacer=%d/%d", kbps, bwe_->acked_kbps(),
+        bwe_->lost_rate(), bwe_->state(), pacer_ ? pacer_->rate_kbps() : 0, pacer_ ? pacer_->size() : 0);
+
+    return err;
 }
 
 srs_error_t SrsRtcConnection::on_rtcp_feedback_remb(SrsRtcpFbCommon *rtcp)
@@ -2201,13 +2364,22 @@ srs_error_t SrsRtcConnection::find_publisher(char* buf, int size, SrsRtcPublishS
     }
 
     map<uint32_t, SrsRtcPublishStream*>::iterator it = publishers_ssrc_map_.find(ssrc);
-    if(it == publishers_ssrc_map_.end()) {
-        return srs_error_new(ERROR_RTC_NO_PUBLISHER, "no publisher for ssrc:%u", ssrc);
+    if(it != publishers_ssrc_map_.end()) {
+        *ppublisher = it->second;
+        return err;
     }
 
-    *ppublisher = it->second;
+    // For simulcast, the SSRC of layer might be unknown in SDP, so we learn it from RID.
+    for (map<string, SrsRtcPublishStream*>::iterator it = publishers_.begin(); it != publishers_.end(); ++it) {
+        SrsRtcPublishStream* publisher = it->second;
+        if (publisher->on_simulcast_ssrc(buf, size, ssrc)) {
+            publishers_ssrc_map_[ssrc] = publisher;
+            *ppublisher = publisher;
+            return err;
+        }
+    }
 
-    return err;
+    return srs_error_new(ERROR_RTC_NO_PUBLISHER, "no publisher for ssrc:%u", ssrc);
 }
 
 srs_error_t SrsRtcConnection::on_dtls_handshake_done()
@@ -2461,7 +2633,7 @@ void SrsRtcConnection::simulate_player_drop_packet(SrsRtpHeader* h, int nn_bytes
     nn_simulate_player_nack_drop--;
 }
 
-srs_error_t SrsRtcConnection::do_send_packet(SrsRtpPacket* pkt)
+srs_error_t SrsRtcConnection::do_send_packet(SrsRtpPacket* pkt, bool retransmit)
 {
     srs_error_t err = srs_success;
 
@@ -2470,6 +2642,15 @@ srs_error_t SrsRtcConnection::do_send_packet(SrsRtpPacket* pkt)
     iov->iov_len = kRtpPacketSize;
     cache_buffer_->skip(-1 * cache_buffer_->pos());
 
+    // Set the transport-wide sequence number for each packet, including the retransmitted one.
+    int twcc_sn = -1;
+    if (bwe_) {
+        twcc_sn = twcc_sn_++;
+        if ((err = pkt->header.set_twcc_sequence_number(twcc_id_, twcc_sn)) != srs_success) {
+            return srs_error_wrap(err, "set twcc sn");
+        }
+    }
+
     // Marshal packet to bytes in iovec.
     if (true) {
         if ((err = pkt->encode(cache_buffer_)) != srs_success) {
@@ -2496,15 +2677,32 @@ srs_error_t SrsRtcConnection::do_send_packet(SrsRtpPacket* pkt)
 
     ++_srs_pps_srtps->sugar;
 
-    if ((err = networks_->available()->write(iov->iov_base, iov->iov_len, NULL)) != srs_success) {
-        srs_warn("RTC: Write %d bytes err %s", iov->iov_len, srs_error_desc(err).c_str());
+    // Detail log, should disable it in release version.
+    srs_info("RTC: SEND PT=%u, SSRC=%#x, SEQ=%u, Time=%u, %u/%u bytes", pkt->header.get_payload_type(), pkt->header.get_ssrc(),
+        pkt->header.get_sequence(), pkt->header.get_timestamp(), pkt->nb_bytes(), iov->iov_len);
+
+    // Pace the video packets, while the audio and retransmitted packets are prior.
+    if (pacer_) {
+        bool priority = retransmit || pkt->is_audio();
+        return pacer_->send((char*)iov->iov_base, (int)iov->iov_len, twcc_sn, priority, srs_get_system_time());
+    }
+
+    return on_pacer_send((char*)iov->iov_base, (int)iov->iov_len, twcc_sn);
+}
+
+srs_error_t SrsRtcConnection::on_pacer_send(char* data, int size, int twcc_sn)
+{
+    srs_error_t err = srs_success;
+
+    if ((err = networks_->available()->write(data, size, NULL)) != srs_success) {
+        srs_warn("RTC: Write %d bytes err %s", size, srs_error_desc(err).c_str());
         srs_freep(err);
         return err;
     }
 
-    // Detail log, should disable it in release version.
-    srs_info("RTC: SEND PT=%u, SSRC=%#x, SEQ=%u, Time=%u, %u/%u bytes", pkt->header.get_payload_type(), pkt->header.get_ssrc(),
-        pkt->header.get_sequence(), pkt->header.get_timestamp(), pkt->nb_bytes(), iov->iov_len);
+    if (bwe_ && twcc_sn >= 0) {
+        bwe_->on_packet_sent((uint16_t)twcc_sn, size, srs_get_system_time());
+    }
 
     return err;
 }
@@ -2642,6 +2840,22 @@ srs_error_t SrsRtcConnection::negotiate_publish_capability(SrsRtcUserConfig* ruc
             track_desc->add_rtp_extension_desc(remote_twcc_id, kTWCCExt);
         }
 
+        // For simulcast, the RID extension is required to identify the layers, and the MID extension is required
+        // by RID, see https://www.rfc-editor.org/rfc/rfc8853#section-5.4
+        // Note that the player switches layer at keyframe, which is only detected for H.264, so we disable simulcast
+        // for HEVC, and the publisher falls back to the base layer.
+        bool simulcast_codec = ruc->codec_ != "hevc";
+        bool simulcast = simulcast_codec && remote_media_desc.is_video() && remote_media_desc.simulcast_direction_ == "send"
+            && !remote_media_desc.simulcast_rids_.empty();
+        if (simulcast) {
+            map<int, string> extmaps = remote_media_desc.get_extmaps();
+            for (map<int, string>::iterator it = extmaps.begin(); it != extmaps.end(); ++it) {
+                if (it->second == kMidExt || it->second == kRidExt || it->second == kRepairedRidExt) {
+                    track_desc->add_rtp_extension_desc(it->first, it->second);
+                }
+            }
+        }
+
         if (remote_media_desc.is_audio()) {
             // Update the ruc, which is about user specified configuration.
             ruc->audio_before_video_ = !nn_any_video_parsed;
@@ -2856,6 +3070,7 @@ srs_error_t SrsRtcConnection::negotiate_publish_capability(SrsRtcUserConfig* ruc
         track_desc->create_auxiliary_payload(remote_media_desc.find_media_with_encoding_name("ulpfec"));
 
         std::string track_id;
+        int nn_video_descs = (int)stream_desc->video_track_descs_.size();
         for (int j = 0; j < (int)remote_media_desc.ssrc_infos_.size(); ++j) {
             const SrsSSRCInfo& ssrc_info = remote_media_desc.ssrc_infos_.at(j);
 
@@ -2877,10 +3092,71 @@ srs_error_t SrsRtcConnection::negotiate_publish_capability(SrsRtcUserConfig* ruc
             track_id = ssrc_info.msid_tracker_;
         }
 
+        // For simulcast by RID, there might be no SSRC in SDP, which is learned from RTP header extension.
+        if (simulcast) {
+            SrsRtcTrackDescription* layers = NULL;
+            if ((int)stream_desc->video_track_descs_.size() > nn_video_descs) {
+                layers = stream_desc->video_track_descs_.at(nn_video_descs);
+            } else {
+                layers = track_desc->copy();
+                layers->id_ = remote_media_desc.msid_tracker_.empty() ? "video-" + srs_random_str(8) : remote_media_desc.msid_tracker_;
+                layers->msid_ = remote_media_desc.msid_;
+                stream_desc->video_track_descs_.push_back(layers);
+            }
+
+            for (int j = 0; j < (int)remote_media_desc.simulcast_rids_.size(); ++j) {
+                const string& rid = remote_media_desc.simulcast_rids_.at(j);
+                layers->encodings_.push_back(SrsRtcTrackEncoding(rid, 0));
+            }
+        }
+
+        // For simulcast by SSRC, the first SSRC of SIM group is the track, and others are layers. Note that
+        // we should apply it before FID, which might be applied to the layers.
+        for (int j = 0; j < (int)remote_media_desc.ssrc_groups_.size(); ++j) {
+            const SrsSSRCGroup& ssrc_group = remote_media_desc.ssrc_groups_.at(j);
+            if (ssrc_group.semantic_ != "SIM" || !remote_media_desc.is_video() || !simulcast_codec) {
+                continue;
+            }
+
+            for (int k = 0; k < (int)stream_desc->video_track_descs_.size(); ++k) {
+                SrsRtcTrackDescription* layers = stream_desc->video_track_descs_.at(k);
+                if (layers->ssrc_ != ssrc_group.ssrcs_[0]) {
+                    continue;
+                }
+
+                // If RID exists, the SSRC is in the same order of RID.
+                for (int m = 0; m < (int)ssrc_group.ssrcs_.size(); ++m) {
+                    if (m < (int)layers->encodings_.size()) {
+                        layers->encodings_.at(m).ssrc_ = ssrc_group.ssrcs_.at(m);
+                    } else {
+                        layers->encodings_.push_back(SrsRtcTrackEncoding("", ssrc_group.ssrcs_.at(m)));
+                    }
+                }
+            }
+        }
+
+        // For simulcast, the SSRC of track is the first layer, which might be learned from RID later.
+        for (int j = nn_video_descs; j < (int)stream_desc->video_track_descs_.size(); ++j) {
+            SrsRtcTrackDescription* layers = stream_desc->video_track_descs_.at(j);
+            if (!layers->encodings_.empty()) {
+                layers->ssrc_ = layers->encodings_.at(0).ssrc_;
+            }
+        }
+
         // set track fec_ssrc and rtx_ssrc
         for (int j = 0; j < (int)remote_media_desc.ssrc_groups_.size(); ++j) {
             const SrsSSRCGroup& ssrc_group = remote_media_desc.ssrc_groups_.at(j);
 
+            // For simulcast, the RTX of layer.
+            if (ssrc_group.semantic_ == "FID" && ssrc_group.ssrcs_.size() > 1) {
+                for (int k = 0; k < (int)stream_desc->video_track_descs_.size(); ++k) {
+                    SrsRtcTrackEncoding* encoding = stream_desc->video_track_descs_.at(k)->find_encoding(ssrc_group.ssrcs_[0]);
+                    if (encoding) {
+                        encoding->rtx_ssrc_ = ssrc_group.ssrcs_[1];
+                    }
+                }
+            }
+
             SrsRtcTrackDescription* track_desc = stream_desc->find_track_description_by_ssrc(ssrc_group.ssrcs_[0]);
             if (!track_desc) {
                 continue;
@@ -3023,6 +3299,18 @@ srs_error_t SrsRtcConnection::generate_publish_local_sdp_for_video(SrsSdp& local
             local_media_desc.payload_types_.push_back(payload->generate_media_payload_type());
         }
 
+        // For simulcast by RID, answer to receive the layers, see https://www.rfc-editor.org/rfc/rfc8853#section-5.3
+        for (int j = 0; j < (int)video_track->encodings_.size(); ++j) {
+            const string& rid = video_track->encodings_.at(j).rid_;
+            if (!rid.empty()) {
+                local_media_desc.rids_.push_back(SrsRidInfo(rid, "recv"));
+                local_media_desc.simulcast_rids_.push_back(rid);
+            }
+        }
+        if (!local_media_desc.simulcast_rids_.empty()) {
+            local_media_desc.simulcast_direction_ = "recv";
+        }
+
         if(!unified_plan) {
             // For PlanB, only need media desc info, not ssrc info;
             break;
@@ -3041,6 +3329,7 @@ srs_error_t SrsRtcConnection::negotiate_play_capability(SrsRtcUserConfig* ruc, s
 
     bool nack_enabled = _srs_config->get_rtc_nack_enabled(req->vhost);
     bool twcc_enabled = _srs_config->get_rtc_twcc_enabled(req->vhost);
+    bool fec_enabled = _srs_config->get_rtc_fec_enabled(req->vhost);
     // TODO: FIME: Should check packetization-mode=1 also.
     bool has_42e01f = srs_sdp_has_h264_profile(remote_sdp, "42e01f");
 
@@ -3188,6 +3477,18 @@ srs_error_t SrsRtcConnection::negotiate_play_capability(SrsRtcUserConfig* ruc, s
                 track->rtx_ssrc_ = 0;
             }
 
+            // Use FlexFEC for player, if enabled and player supports it, never use the FEC of publisher.
+            srs_freep(track->ulpfec_);
+            srs_freep(track->flexfec_);
+            track->fec_ssrc_ = 0;
+            if (fec_enabled && remote_media_desc.is_video()) {
+                track->create_auxiliary_payload(remote_media_desc.find_media_with_encoding_name("flexfec-03"));
+                if (track->flexfec_) {
+                    track->fec_ssrc_ = SrsRtcSSRCGenerator::instance()->generate_ssrc();
+                    srs_trace("RTC: Player flexfec pt=%d, ssrc=%u, fec ssrc=%u", track->flexfec_->pt_, track->ssrc_, track->fec_ssrc_);
+                }
+            }
+
             track->set_direction("sendonly");
             sub_relations.insert(make_pair(publish_ssrc, track));
         }
@@ -3244,6 +3545,12 @@ void video_track_generate_play_offer(SrsRtcTrackDescription* track, string mid,
         SrsRedPayload* red_payload = (SrsRedPayload*)track->red_;
         local_media_desc.payload_types_.push_back(red_payload->generate_media_payload_type());
     }
+
+    if (track->flexfec_) {
+        SrsMediaPayloadType flexfec = track->flexfec_->generate_media_payload_type();
+        flexfec.format_specific_param_ = "repair-window=10000000";
+        local_media_desc.payload_types_.push_back(flexfec);
+    }
 }
 
 srs_error_t SrsRtcConnection::generate_play_local_sdp(SrsRequest* req, SrsSdp& local_sdp, SrsRtcSourceDescription* stream_desc, bool unified_plan, bool audio_before_video)
@@ -3395,6 +3702,15 @@ srs_error_t SrsRtcConnection::generate_play_local_sdp_for_video(SrsSdp& local_sd
 
             local_media_desc.ssrc_infos_.push_back(SrsSSRCInfo(track->fec_ssrc_, cname, track->msid_, track->id_));
         }
+
+        if (track->flexfec_ && track->fec_ssrc_) {
+            std::vector<uint32_t> group_ssrcs;
+            group_ssrcs.push_back(track->ssrc_);
+            group_ssrcs.push_back(track->fec_ssrc_);
+            local_media_desc.ssrc_groups_.push_back(SrsSSRCGroup("FEC-FR", group_ssrcs));
+
+            local_media_desc.ssrc_infos_.push_back(SrsSSRCInfo(track->fec_ssrc_, cname, track->msid_, track->id_));
+        }
     }
 
     return err;
@@ -3457,7 +3773,21 @@ srs_error_t SrsRtcConnection::create_player(SrsRequest* req, std::map<uint32_t,
             ++it;
         }
     }
-    srs_trace("RTC connection player gcc=%d", twcc_id);
+    // Estimate the bandwidth by TWCC feedback, so TWCC must be enabled.
+    if (twcc_id > 0 && !bwe_ && _srs_config->get_rtc_bwe_enabled(req->vhost)) {
+        twcc_id_ = twcc_id;
+        bwe_ = new SrsRtcBandwidthEstimator();
+    }
+
+    if (!pacer_ && _srs_config->get_rtc_pacer_enabled(req->vhost)) {
+        pacer_ = new SrsRtcPacer(this);
+        timer_pacer_ = new SrsRtcConnectionPacerTimer(this);
+        if (bwe_) {
+            pacer_->set_target_kbps(bwe_->target_kbps());
+        }
+    }
+
+    srs_trace("RTC connection player gcc=%d, bwe=%d, pacer=%d", twcc_id, bwe_ != NULL, pacer_ != NULL);
 
     // TODO: Start player when DTLS done. Removed it because we don't support single PC now.
     // If DTLS done, start the player. Because maybe create some players after DTLS done.
@@ -3516,7 +3846,10 @@ srs_error_t SrsRtcConnection::create_publisher(SrsRequest* req, SrsRtcSourceDesc
             return srs_error_new(ERROR_RTC_DUPLICATED_SSRC, " duplicate ssrc %d, track id: %s",
                 track_desc->ssrc_, track_desc->id_.c_str());
         }
-        publishers_ssrc_map_[track_desc->ssrc_] = publisher;
+        // For simulcast, the SSRC is learned from RID later, see find_publisher.
+        if (track_desc->ssrc_) {
+            publishers_ssrc_map_[track_desc->ssrc_] = publisher;
+        }
 
         if(0 != track_desc->fec_ssrc_ && track_desc->ssrc_ != track_desc->fec_ssrc_) {
             if(publishers_ssrc_map_.end() != publishers_ssrc_map_.find(track_desc->fec_ssrc_)) {
@@ -3533,6 +3866,20 @@ srs_error_t SrsRtcConnection::create_publisher(SrsRequest* req, SrsRtcSourceDesc
             }
             publishers_ssrc_map_[track_desc->rtx_ssrc_] = publisher;
         }
+
+        // For simulcast, the other layers, while the SSRC of first layer is the track.
+        for (int j = 1; j < (int)track_desc->encodings_.size(); ++j) {
+            const SrsRtcTrackEncoding& encoding = track_desc->encodings_.at(j);
+            if (encoding.ssrc_) {
+                publishers_ssrc_map_[encoding.ssrc_] = publisher;
+            }
+            if (encoding.rtx_ssrc_) {
+                publishers_ssrc_map_[encoding.rtx_ssrc_] = publisher;
+            }
+        }
+        if (!track_desc->encodings_.empty() && track_desc->encodings_.at(0).rtx_ssrc_) {
+            publishers_ssrc_map_[track_desc->encodings_.at(0).rtx_ssrc_] = publisher;
+        }
     }
 
     // TODO: Start player when DTLS done. Removed it because we don't support single PC now.
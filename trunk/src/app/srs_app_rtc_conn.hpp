@@ -19,6 +19,7 @@
 #include <srs_kernel_rtc_rtp.hpp>
 #include <srs_kernel_rtc_rtcp.hpp>
 #include <srs_app_rtc_queue.hpp>
+#include <srs_app_rtc_bwe.hpp>
 #include <srs_app_rtc_source.hpp>
 #include <srs_app_rtc_dtls.hpp>
 #include <srs_protocol_conn.hpp>
@@ -273,6 +274,9 @@ private:
     srs_error_t on_rtcp_ps_feedback(SrsRtcpFbCommon* rtcp);
     srs_error_t on_rtcp_rr(SrsRtcpRR* rtcp);
     uint32_t get_video_publish_ssrc(uint32_t play_ssrc);
+public:
+    // When got the estimated bandwidth of player, to select the layer.
+    void on_bandwidth(int kbps);
 // Interface ISrsRtcPLIWorkerHandler
 public:
     virtual srs_error_t do_request_keyframe(uint32_t ssrc, SrsContextId cid);
@@ -353,6 +357,9 @@ private:
     std::vector<SrsRtcVideoRecvTrack*> video_tracks_;
 private:
     int twcc_id_;
+    // For simulcast, the id of RID and repaired RID extension, to learn the SSRC of layers.
+    int rid_id_;
+    int repaired_rid_id_;
     uint8_t twcc_fb_count_;
     SrsRtcpTWCC rtcp_twcc_;
     SrsRtpExtensionTypes extension_types_;
@@ -373,6 +380,9 @@ private:
 public:
     srs_error_t on_rtp_cipher(char* buf, int nb_buf);
     srs_error_t on_rtp_plaintext(char* buf, int nb_buf);
+    // For simulcast, bind the unknown SSRC to layer by the RID extension in RTP header, which is not
+    // encrypted by SRTP. Return true if bound.
+    bool on_simulcast_ssrc(char* buf, int nb_buf, uint32_t ssrc);
 private:
     srs_error_t do_on_rtp_plaintext(SrsRtpPacket*& pkt, SrsBuffer* buf);
 public:
@@ -414,11 +424,24 @@ private:
     srs_error_t on_timer(srs_utime_t interval);
 };
 
+// A fast timer for conntion, to flush the packets in pacer.
+class SrsRtcConnectionPacerTimer : public ISrsFastTimer
+{
+private:
+    SrsRtcConnection* p_;
+public:
+    SrsRtcConnectionPacerTimer(SrsRtcConnection* p);
+    virtual ~SrsRtcConnectionPacerTimer();
+// interface ISrsFastTimer
+private:
+    srs_error_t on_timer(srs_utime_t interval);
+};
+
 // A RTC Peer Connection, SDP level object.
 //
 // For performance, we use non-public from resource,
 // see https://stackoverflow.com/questions/3747066/c-cannot-convert-from-base-a-to-derived-type-b-via-virtual-base-a
-class SrsRtcConnection : public ISrsResource, public ISrsDisposingHandler, public ISrsExpire
+class SrsRtcConnection : public ISrsResource, public ISrsDisposingHandler, public ISrsExpire, public ISrsRtcPacerHandler
 {
     friend class SrsSecurityTransport;
     friend class SrsRtcPlayStream;
@@ -426,6 +449,8 @@ class SrsRtcConnection : public ISrsResource, public ISrsDisposingHandler, publi
 private:
     friend class SrsRtcConnectionNackTimer;
     SrsRtcConnectionNackTimer* timer_nack_;
+    friend class SrsRtcConnectionPacerTimer;
+    SrsRtcConnectionPacerTimer* timer_pacer_;
 public:
     bool disposing_;
 private:
@@ -464,6 +489,12 @@ private:
 private:
     // twcc handler
     int twcc_id_;
+    // The transport-wide sequence number for packets to player.
+    uint16_t twcc_sn_;
+    // The send-side bandwidth estimator and pacer for player.
+    SrsRtcBandwidthEstimator* bwe_;
+    SrsRtcPacer* pacer_;
+    srs_utime_t last_bwe_report_;
     // Simulators.
     int nn_simulate_player_nack_drop;
     // Pithy print for PLI request.
@@ -517,7 +548,7 @@ public:
 private:
     srs_error_t dispatch_rtcp(SrsRtcpCommon* rtcp);
 public:
-    srs_error_t on_rtcp_feedback_twcc(char* buf, int nb_buf);
+    srs_error_t on_rtcp_feedback_twcc(SrsRtcpTWCC* rtcp);
     srs_error_t on_rtcp_feedback_remb(SrsRtcpFbCommon *rtcp);
 public:
     srs_error_t on_dtls_handshake_done();
@@ -538,7 +569,12 @@ public:
     // Simulate the NACK to drop nn packets.
     void simulate_nack_drop(int nn);
     void simulate_player_drop_packet(SrsRtpHeader* h, int nn_bytes);
-    srs_error_t do_send_packet(SrsRtpPacket* pkt);
+    // Send packet to player, the retransmitted packet is prior in pacer.
+    srs_error_t do_send_packet(SrsRtpPacket* pkt, bool retransmit);
+// Interface ISrsRtcPacerHandler
+public:
+    virtual srs_error_t on_pacer_send(char* data, int size, int twcc_sn);
+public:
     // Directly set the status of play track, generally for init to set the default value.
     void set_all_tracks_status(std::string stream_uri, bool is_publish, bool status);
 public:
@@ -0,0 +1,192 @@
+//
+// Copyright (c) 2013-2024 The SRS Authors
+//
+// SPDX-License-Identifier: MIT
+//
+
+#include <srs_app_rtc_fec.hpp>
+
+#include <math.h>
+#include <string.h>
+#include <stdlib.h>
+
+using namespace std;
+
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_log.hpp>
+#include <srs_kernel_buffer.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_kernel_rtc_rtp.hpp>
+#include <srs_core_autofree.hpp>
+
+// No FEC if the lost rate is less than it.
+#define SRS_RTC_FEC_MIN_LOSS 0.01
+// The range of protection ratio, which is about 3x of lost rate.
+#define SRS_RTC_FEC_MIN_RATIO 0.1
+#define SRS_RTC_FEC_MAX_RATIO 0.5
+
+SrsRtcFecEncoder::SrsRtcFecEncoder(uint32_t media_ssrc, uint32_t fec_ssrc, uint8_t pt)
+{
+    media_ssrc_ = media_ssrc;
+    fec_ssrc_ = fec_ssrc;
+    pt_ = pt;
+    sn_ = (uint16_t)(::random() & 0x7fff);
+
+    for (int i = 0; i < SRS_RTC_FEC_MAX_PACKETS; i++) {
+        packets_[i] = new char[kRtpPacketSize];
+        sizes_[i] = 0;
+    }
+    nn_packets_ = 0;
+    base_sn_ = 0;
+    last_ts_ = 0;
+
+    lost_rate_ = 0;
+    ratio_ = 0;
+    credit_ = 0;
+}
+
+SrsRtcFecEncoder::~SrsRtcFecEncoder()
+{
+    for (int i = 0; i < SRS_RTC_FEC_MAX_PACKETS; i++) {
+        srs_freepa(packets_[i]);
+    }
+}
+
+void SrsRtcFecEncoder::on_feedback(float lost_rate)
+{
+    lost_rate_ = 0.6 * lost_rate_ + 0.4 * lost_rate;
+
+    if (lost_rate_ < SRS_RTC_FEC_MIN_LOSS) {
+        ratio_ = 0;
+        credit_ = 0;
+    } else {
+        ratio_ = srs_max(SRS_RTC_FEC_MIN_RATIO, srs_min(SRS_RTC_FEC_MAX_RATIO, 3 * lost_rate_));
+    }
+}
+
+float SrsRtcFecEncoder::ratio()
+{
+    return ratio_;
+}
+
+srs_error_t SrsRtcFecEncoder::on_packet(SrsRtpPacket* pkt, std::vector<SrsRtpPacket*>& fecs)
+{
+    srs_error_t err = srs_success;
+
+    // Ignore if no loss, or the packet is too large to protect.
+    if (ratio_ <= 0 || pkt->nb_bytes() > kRtpPacketSize) {
+        nn_packets_ = 0;
+        return err;
+    }
+
+    // Start a new window if the sequence is not continuous, for example, the packets are dropped.
+    uint16_t sn = pkt->header.get_sequence();
+    if (nn_packets_ > 0 && (uint16_t)(base_sn_ + nn_packets_) != sn) {
+        nn_packets_ = 0;
+    }
+    if (nn_packets_ == 0) {
+        base_sn_ = sn;
+    }
+
+    SrsBuffer buf(packets_[nn_packets_], kRtpPacketSize);
+    if ((err = pkt->encode(&buf)) != srs_success) {
+        return srs_error_wrap(err, "encode packet");
+    }
+    sizes_[nn_packets_++] = buf.pos();
+    last_ts_ = pkt->header.get_timestamp();
+
+    // Generate FEC packets, when got the last packet of frame, or the window is full.
+    if (!pkt->header.get_marker() && nn_packets_ < SRS_RTC_FEC_MAX_PACKETS) {
+        return err;
+    }
+
+    err = generate(fecs);
+    nn_packets_ = 0;
+
+    return err;
+}
+
+srs_error_t SrsRtcFecEncoder::generate(std::vector<SrsRtpPacket*>& fecs)
+{
+    srs_error_t err = srs_success;
+
+    // The fractional part is carried to next window, so the overhead is about the ratio.
+    credit_ += nn_packets_ * ratio_;
+    int nn_fecs = srs_min(nn_packets_, (int)credit_);
+    if (nn_fecs <= 0) {
+        return err;
+    }
+    credit_ -= nn_fecs;
+
+    // The FEC packet at index protects the media packets interleaved, which is better for random loss.
+    for (int i = 0; i < nn_fecs; i++) {
+        fecs.push_back(generate_packet(nn_fecs, i));
+    }
+
+    return err;
+}
+
+SrsRtpPacket* SrsRtcFecEncoder::generate_packet(int nn_fecs, int index)
+{
+    // The size of repair payload is the max size of protected packets, without RTP fixed header.
+    int nn_repair = 0;
+    uint16_t mask = 0x8000;
+    for (int i = index; i < nn_packets_; i += nn_fecs) {
+        nn_repair = srs_max(nn_repair, sizes_[i] - kRtpHeaderFixedSize);
+        // The K bit is set, then the mask of packets in 15 bits.
+        mask |= (uint16_t)(1 << (14 - i));
+    }
+
+    SrsRtpPacket* pkt = new SrsRtpPacket();
+    pkt->frame_type = SrsFrameTypeVideo;
+    pkt->header.set_payload_type(pt_);
+    pkt->header.set_ssrc(fec_ssrc_);
+    pkt->header.set_sequence(sn_++);
+    pkt->header.set_timestamp(last_ts_);
+
+    int size = SRS_RTC_FLEXFEC_HEADER_SIZE + nn_repair;
+    char* p = pkt->wrap(size);
+    memset(p, 0, size);
+
+    // XOR the header fields and payload of protected packets, see XorHeaders and XorPayloads of libwebrtc.
+    for (int i = index; i < nn_packets_; i += nn_fecs) {
+        char* src = packets_[i];
+        int nn_payload = sizes_[i] - kRtpHeaderFixedSize;
+
+        // The P, X, CC, M and PT.
+        p[0] ^= src[0];
+        p[1] ^= src[1];
+        // The length recovery.
+        p[2] ^= (char)(nn_payload >> 8);
+        p[3] ^= (char)(nn_payload);
+        // The TS recovery.
+        p[4] ^= src[4];
+        p[5] ^= src[5];
+        p[6] ^= src[6];
+        p[7] ^= src[7];
+
+        char* dst = p + SRS_RTC_FLEXFEC_HEADER_SIZE;
+        src += kRtpHeaderFixedSize;
+        for (int j = 0; j < nn_payload; j++) {
+            dst[j] ^= src[j];
+        }
+    }
+
+    // Clear the R and F bits, then write the SSRC, SN base and mask.
+    SrsBuffer buf(p, SRS_RTC_FLEXFEC_HEADER_SIZE);
+    p[0] &= 0x3f;
+    buf.skip(8);
+    buf.write_1bytes(1);
+    buf.write_3bytes(0);
+    buf.write_4bytes(media_ssrc_);
+    buf.write_2bytes(base_sn_);
+    buf.write_2bytes(mask);
+
+    SrsRtpRawPayload* raw = new SrsRtpRawPayload();
+    raw->payload = p;
+    raw->nn_payload = size;
+    pkt->set_payload(raw, SrsRtspPacketPayloadTypeRaw);
+
+    return pkt;
+}
+
@@ -0,0 +1,65 @@
+//
+// Copyright (c) 2013-2024 The SRS Authors
+//
+// SPDX-License-Identifier: MIT
+//
+
+#ifndef SRS_APP_RTC_FEC_HPP
+#define SRS_APP_RTC_FEC_HPP
+
+#include <srs_core.hpp>
+
+#include <vector>
+
+class SrsRtpPacket;
+
+// The max number of media packets protected by a FEC packet, to use the 15 bits mask of FlexFEC.
+#define SRS_RTC_FEC_MAX_PACKETS 15
+// The size of FlexFEC header, with one SSRC and 15 bits mask.
+#define SRS_RTC_FLEXFEC_HEADER_SIZE 20
+
+// The FlexFEC encoder for player, to generate the parity packets for a window of media packets,
+// which is the packets of a frame, or at most SRS_RTC_FEC_MAX_PACKETS packets. The FEC packets
+// are sent in a dedicated SSRC, so the sequence of media packets is not changed.
+// @see https://datatracker.ietf.org/doc/html/draft-ietf-payload-flexible-fec-scheme-03
+//
+// The protection ratio is adaptive to the fraction lost in RR of player, and there is no FEC
+// packet if no loss, so there is no overhead for good network.
+class SrsRtcFecEncoder
+{
+private:
+    uint32_t media_ssrc_;
+    uint32_t fec_ssrc_;
+    uint8_t pt_;
+    uint16_t sn_;
+private:
+    // The media packets in window, in bytes of RTP packet.
+    char* packets_[SRS_RTC_FEC_MAX_PACKETS];
+    int sizes_[SRS_RTC_FEC_MAX_PACKETS];
+    int nn_packets_;
+    uint16_t base_sn_;
+    uint32_t last_ts_;
+private:
+    // The smoothed lost rate of player.
+    float lost_rate_;
+    // The ratio of FEC packets to media packets.
+    float ratio_;
+    // The fractional number of FEC packets, carried to next window.
+    float credit_;
+public:
+    SrsRtcFecEncoder(uint32_t media_ssrc, uint32_t fec_ssrc, uint8_t pt);
+    virtual ~SrsRtcFecEncoder();
+public:
+    // When got the lost rate in RR from player, to adapt the protection ratio.
+    void on_feedback(float lost_rate);
+    float ratio();
+    // When sent media packet, add it to window, and generate FEC packets if window is done. The
+    // FEC packets are owned by caller.
+    srs_error_t on_packet(SrsRtpPacket* pkt, std::vector<SrsRtpPacket*>& fecs);
+private:
+    srs_error_t generate(std::vector<SrsRtpPacket*>& fecs);
+    SrsRtpPacket* generate_packet(int nn_fecs, int index);
+};
+
+#endif
+
@@ -16,6 +16,7 @@ using namespace std;
 
 #include <srs_kernel_error.hpp>
 #include <srs_kernel_log.hpp>
+#include <srs_protocol_utility.hpp>
 
 // TODO: FIXME: Maybe we should use json.encode to escape it?
 const std::string kCRLF = "\r\n";
@@ -262,6 +263,37 @@ srs_error_t SrsSSRCGroup::encode(std::ostringstream& os)
     return err;
 }
 
+SrsRidInfo::SrsRidInfo()
+{
+}
+
+SrsRidInfo::SrsRidInfo(const std::string& rid, const std::string& direction)
+{
+    rid_ = rid;
+    direction_ = direction;
+}
+
+SrsRidInfo::~SrsRidInfo()
+{
+}
+
+srs_error_t SrsRidInfo::encode(std::ostringstream& os)
+{
+    srs_error_t err = srs_success;
+
+    if (rid_.empty() || direction_.empty()) {
+        return srs_error_new(ERROR_RTC_SDP_DECODE, "invalid rid=%s, direction=%s", rid_.c_str(), direction_.c_str());
+    }
+
+    os << "a=rid:" << rid_ << " " << direction_;
+    if (!params_.empty()) {
+        os << " " << params_;
+    }
+    os << kCRLF;
+
+    return err;
+}
+
 SrsMediaPayloadType::SrsMediaPayloadType(int payload_type)
 {
     payload_type_ = payload_type;
@@ -426,6 +458,16 @@ srs_error_t SrsMediaDesc::encode(std::ostringstream& os)
         os << "a=inactive" << kCRLF;
     }
 
+    for (std::vector<SrsRidInfo>::iterator iter = rids_.begin(); iter != rids_.end(); ++iter) {
+        if ((err = iter->encode(os)) != srs_success) {
+            return srs_error_wrap(err, "encode rid failed");
+        }
+    }
+
+    if (!simulcast_direction_.empty() && !simulcast_rids_.empty()) {
+        os << "a=simulcast:" << simulcast_direction_ << " " << srs_join_vector_string(simulcast_rids_, ";") << kCRLF;
+    }
+
     if (rtcp_mux_) {
         os << "a=rtcp-mux" << kCRLF;
     }
@@ -510,6 +552,10 @@ srs_error_t SrsMediaDesc::parse_attribute(const std::string& content)
         return parse_attr_ssrc(value);
     } else if (attribute == "ssrc-group") {
         return parse_attr_ssrc_group(value);
+    } else if (attribute == "rid") {
+        return parse_attr_rid(value);
+    } else if (attribute == "simulcast") {
+        return parse_attr_simulcast(value);
     } else if (attribute == "rtcp-mux") {
         rtcp_mux_ = true;
     } else if (attribute == "rtcp-rsize") {
@@ -730,6 +776,68 @@ srs_error_t SrsMediaDesc::parse_attr_ssrc_group(const std::string& value)
     return err;
 }
 
+srs_error_t SrsMediaDesc::parse_attr_rid(const std::string& value)
+{
+    srs_error_t err = srs_success;
+    // @see: https://www.rfc-editor.org/rfc/rfc8851#section-4
+    // a=rid:<rid-id> <direction> [pt=<fmt-list>;<restriction>=<value>...]
+
+    std::istringstream is(value);
+
+    SrsRidInfo rid;
+    FETCH(is, rid.rid_);
+    FETCH(is, rid.direction_);
+    is >> rid.params_;
+
+    if (rid.direction_ != "send" && rid.direction_ != "recv") {
+        return srs_error_new(ERROR_RTC_SDP_DECODE, "invalid rid line=%s", value.c_str());
+    }
+
+    rids_.push_back(rid);
+
+    return err;
+}
+
+srs_error_t SrsMediaDesc::parse_attr_simulcast(const std::string& value)
+{
+    srs_error_t err = srs_success;
+    // @see: https://www.rfc-editor.org/rfc/rfc8853#section-5.1
+    // a=simulcast:<send|recv> <rid>[,<alt-rid>];<rid>... [<recv|send> ...]
+    // We only use the first stream list, and the first alternative of each stream.
+
+    std::istringstream is(value);
+    FETCH(is, simulcast_direction_);
+
+    std::string streams;
+    FETCH(is, streams);
+
+    simulcast_rids_.clear();
+    std::vector<std::string> vec = split_str(streams, ";");
+    for (int i = 0; i < (int)vec.size(); ++i) {
+        std::string rid = vec.at(i);
+
+        size_t pos = rid.find(",");
+        if (pos != std::string::npos) {
+            rid = rid.substr(0, pos);
+        }
+
+        // The paused stream is prefixed with "~".
+        if (!rid.empty() && rid.at(0) == '~') {
+            rid = rid.substr(1);
+        }
+
+        if (!rid.empty()) {
+            simulcast_rids_.push_back(rid);
+        }
+    }
+
+    if (simulcast_direction_ != "send" && simulcast_direction_ != "recv") {
+        return srs_error_new(ERROR_RTC_SDP_DECODE, "invalid simulcast line=%s", value.c_str());
+    }
+
+    return err;
+}
+
 SrsSSRCInfo& SrsMediaDesc::fetch_or_create_ssrc_info(uint32_t ssrc)
 {
     for (size_t i = 0; i < ssrc_infos_.size(); ++i) {
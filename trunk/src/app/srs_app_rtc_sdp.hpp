@@ -16,6 +16,10 @@
 #include <vector>
 #include <map>
 const std::string kTWCCExt = "http://www.ietf.org/id/draft-holmer-rmcat-transport-wide-cc-extensions-01";
+// The RTP header extensions for simulcast, see https://www.rfc-editor.org/rfc/rfc8852
+const std::string kMidExt = "urn:ietf:params:rtp-hdrext:sdes:mid";
+const std::string kRidExt = "urn:ietf:params:rtp-hdrext:sdes:rtp-stream-id";
+const std::string kRepairedRidExt = "urn:ietf:params:rtp-hdrext:sdes:repaired-rtp-stream-id";
 
 // TDOO: FIXME: Rename it, and add utest.
 extern std::vector<std::string> split_str(const std::string& str, const std::string& delim);
@@ -90,6 +94,25 @@ public:
     std::vector<uint32_t> ssrcs_;
 };
 
+// The restriction identifier of encoding, see https://www.rfc-editor.org/rfc/rfc8851
+// a=rid:<rid-id> <direction> [restrictions]
+class SrsRidInfo
+{
+public:
+    SrsRidInfo();
+    SrsRidInfo(const std::string& rid, const std::string& direction);
+    virtual ~SrsRidInfo();
+public:
+    srs_error_t encode(std::ostringstream& os);
+public:
+    // e.g. h, m, l
+    std::string rid_;
+    // send or recv.
+    std::string direction_;
+    // The restrictions, for example, pt=96;max-width=1280
+    std::string params_;
+};
+
 struct H264SpecificParam
 {
     std::string profile_level_id;
@@ -151,6 +174,8 @@ private:
     srs_error_t parse_attr_ssrc(const std::string& value);
     srs_error_t parse_attr_ssrc_group(const std::string& value);
     srs_error_t parse_attr_extmap(const std::string& value);
+    srs_error_t parse_attr_rid(const std::string& value);
+    srs_error_t parse_attr_simulcast(const std::string& value);
 private:
     SrsSSRCInfo& fetch_or_create_ssrc_info(uint32_t ssrc);
 
@@ -178,6 +203,12 @@ public:
     std::vector<SrsSSRCGroup> ssrc_groups_;
     std::vector<SrsSSRCInfo>  ssrc_infos_;
     std::map<int, std::string> extmaps_;
+
+    // For simulcast, see https://www.rfc-editor.org/rfc/rfc8853
+    // a=simulcast:send h;m;l
+    std::vector<SrsRidInfo> rids_;
+    std::string simulcast_direction_;
+    std::vector<std::string> simulcast_rids_;
 };
 
 class SrsSdp
@@ -8,6 +8,7 @@
 
 #include <math.h>
 #include <unistd.h>
+#include <set>
 
 #include <srs_app_conn.hpp>
 #include <srs_protocol_rtmp_stack.hpp>
@@ -23,6 +24,7 @@
 #include <srs_core_autofree.hpp>
 #include <srs_app_rtc_queue.hpp>
 #include <srs_app_rtc_conn.hpp>
+#include <srs_app_rtc_fec.hpp>
 #include <srs_protocol_utility.hpp>
 #include <srs_protocol_json.hpp>
 #include <srs_app_pithy_print.hpp>
@@ -379,6 +381,7 @@ SrsRtcSource::SrsRtcSource()
 
     publish_stream_ = NULL;
     stream_desc_ = NULL;
+    simulcast_ssrc_ = 0;
 
     req = NULL;
     bridge_ = NULL;
@@ -741,7 +744,9 @@ srs_error_t SrsRtcSource::on_rtp(SrsRtpPacket* pkt)
     }
 
 #ifdef SRS_FFMPEG_FIT
-    if (frame_builder_ && (err = frame_builder_->on_rtp(pkt)) != srs_success) {
+    // For simulcast, only bridge the first layer, because frame builder expects only one stream.
+    bool bridged = !simulcast_ssrc_ || pkt->is_audio() || pkt->header.get_ssrc() == simulcast_ssrc_;
+    if (frame_builder_ && bridged && (err = frame_builder_->on_rtp(pkt)) != srs_success) {
         return srs_error_wrap(err, "frame builder consume packet");
     }
 #endif
@@ -761,6 +766,8 @@ void SrsRtcSource::set_stream_desc(SrsRtcSourceDescription* stream_desc)
     if (stream_desc) {
         stream_desc_ = stream_desc->copy();
     }
+
+    update_simulcast_ssrc();
 }
 
 std::vector<SrsRtcTrackDescription*> SrsRtcSource::get_track_desc(std::string type, std::string media_name)
@@ -793,6 +800,67 @@ std::vector<SrsRtcTrackDescription*> SrsRtcSource::get_track_desc(std::string ty
     return track_descs;
 }
 
+void SrsRtcSource::on_simulcast_ssrc(std::string track_id, std::string rid, uint32_t ssrc, bool rtx)
+{
+    if (!stream_desc_) {
+        return;
+    }
+
+    for (int i = 0; i < (int)stream_desc_->video_track_descs_.size(); i++) {
+        SrsRtcTrackDescription* desc = stream_desc_->video_track_descs_.at(i);
+        if (desc->id_ != track_id) {
+            continue;
+        }
+
+        for (int j = 0; j < (int)desc->encodings_.size(); j++) {
+            SrsRtcTrackEncoding& encoding = desc->encodings_.at(j);
+            if (encoding.rid_ != rid) {
+                continue;
+            }
+
+            if (rtx) {
+                encoding.rtx_ssrc_ = ssrc;
+            } else {
+                encoding.ssrc_ = ssrc;
+            }
+
+            // The primary SSRC of track is the first encoding.
+            if (!rtx && j == 0) {
+                desc->ssrc_ = ssrc;
+            }
+        }
+    }
+
+    update_simulcast_ssrc();
+
+    // The RTX is not used by players, so we only notify for media SSRC.
+    if (rtx) {
+        return;
+    }
+
+    for (int i = 0; i < (int)consumers.size(); i++) {
+        SrsRtcConsumer* consumer = consumers.at(i);
+        consumer->on_stream_change(stream_desc_);
+    }
+}
+
+void SrsRtcSource::update_simulcast_ssrc()
+{
+    simulcast_ssrc_ = 0;
+
+    if (!stream_desc_) {
+        return;
+    }
+
+    for (int i = 0; i < (int)stream_desc_->video_track_descs_.size(); i++) {
+        SrsRtcTrackDescription* desc = stream_desc_->video_track_descs_.at(i);
+        if (!desc->encodings_.empty()) {
+            simulcast_ssrc_ = desc->encodings_.at(0).ssrc_;
+            return;
+        }
+    }
+}
+
 srs_error_t SrsRtcSource::on_timer(srs_utime_t interval)
 {
     srs_error_t err = srs_success;
@@ -801,6 +869,13 @@ srs_error_t SrsRtcSource::on_timer(srs_utime_t interval)
         return err;
     }
 
+#ifdef SRS_FFMPEG_FIT
+    // Request PLI immediately, if jitter buffer skip to keyframe.
+    if (frame_builder_ && frame_builder_->fetch_keyframe_request()) {
+        pli_elapsed_ = pli_for_rtmp_;
+    }
+#endif
+
     // Request PLI and reset the timer.
     if (true) {
         pli_elapsed_ += interval;
@@ -826,7 +901,7 @@ SrsRtcRtpBuilder::SrsRtcRtpBuilder(SrsFrameToRtcBridge* bridge, uint32_t assrc,
     req = NULL;
     bridge_ = bridge;
     format = new SrsRtmpFormat();
-    codec_ = new SrsAudioTranscoder();
+    codec_ = new SrsAsyncAudioTranscoder();
     latest_codec_ = SrsAudioCodecIdForbidden;
     keep_bframe = false;
     keep_avc_nalu_sei = true;
@@ -970,11 +1045,11 @@ srs_error_t SrsRtcRtpBuilder::init_codec(SrsAudioCodecId codec)
 
     // Create a new codec.
     srs_freep(codec_);
-    codec_ = new SrsAudioTranscoder();
+    codec_ = new SrsAsyncAudioTranscoder();
 
     // Initialize the codec according to the codec in stream.
     int bitrate = _srs_config->get_rtc_opus_bitrate(req->vhost);// The output bitrate in bps.
-    if ((err = codec_->initialize(codec, SrsAudioCodecIdOpus, kAudioChannel, kAudioSamplerate, bitrate)) != srs_success) {
+    if ((err = codec_->initialize(req, codec, SrsAudioCodecIdOpus, kAudioChannel, kAudioSamplerate, bitrate)) != srs_success) {
         return srs_error_wrap(err, "init codec=%d", codec);
     }
 
@@ -1401,14 +1476,274 @@ srs_error_t SrsRtcRtpBuilder::consume_packets(vector<SrsRtpPacket*>& pkts)
     return err;
 }
 
+// The min and initial delay to wait for the lost packet, for jitter buffer.
+#define SRS_RTC_JITTER_MIN_DELAY (20 * SRS_UTIME_MILLISECONDS)
+#define SRS_RTC_JITTER_INIT_DELAY (200 * SRS_UTIME_MILLISECONDS)
+
+SrsRtcJitterBuffer::SrsRtcJitterBuffer()
+{
+    memset(cache_pkts_, 0, sizeof(cache_pkts_));
+
+    has_highest_ = false;
+    highest_sn_ = 0;
+    last_transit_ = 0;
+    jitter_ = 0;
+    nn_expected_ = nn_lost_ = 0;
+    loss_rate_ = 0;
+
+    wait_at_ = 0;
+    recover_delay_ = SRS_RTC_JITTER_INIT_DELAY;
+    recover_dev_ = 0;
+    max_delay_ = SRS_UTIME_SECONDS;
+
+    nn_late_ = nn_discard_ = nn_timeout_ = 0;
+    discard_ts_ = -1;
+}
+
+SrsRtcJitterBuffer::~SrsRtcJitterBuffer()
+{
+    for (size_t i = 0; i < s_cache_size; i++) {
+        srs_freep(cache_pkts_[i].pkt);
+    }
+}
+
+void SrsRtcJitterBuffer::set_max_delay(srs_utime_t v)
+{
+    max_delay_ = v;
+}
+
+void SrsRtcJitterBuffer::store(SrsRtpPacket* pkt)
+{
+    uint16_t index = cache_index(pkt->header.get_sequence());
+    cache_pkts_[index].in_use = true;
+    srs_freep(cache_pkts_[index].pkt);
+    cache_pkts_[index].pkt = pkt;
+    cache_pkts_[index].sn = pkt->header.get_sequence();
+    cache_pkts_[index].ts = pkt->get_avsync_time();
+    cache_pkts_[index].rtp_ts = pkt->header.get_timestamp();
+}
+
+SrsRtpPacket* SrsRtcJitterBuffer::at(uint16_t sn)
+{
+    return cache_pkts_[cache_index(sn)].pkt;
+}
+
+SrsRtpPacket* SrsRtcJitterBuffer::take(uint16_t sn)
+{
+    uint16_t index = cache_index(sn);
+    SrsRtpPacket* pkt = cache_pkts_[index].pkt;
+
+    cache_pkts_[index].in_use = false;
+    cache_pkts_[index].pkt = NULL;
+    cache_pkts_[index].ts = 0;
+    cache_pkts_[index].rtp_ts = 0;
+    cache_pkts_[index].sn = 0;
+
+    return pkt;
+}
+
+void SrsRtcJitterBuffer::clear()
+{
+    // Count the discarded frames, by different timestamp.
+    std::set<uint32_t> frames;
+
+    for (size_t i = 0; i < s_cache_size; i++)
+    {
+        if (cache_pkts_[i].in_use) {
+            frames.insert(cache_pkts_[i].rtp_ts);
+            srs_freep(cache_pkts_[i].pkt);
+            cache_pkts_[i].sn = 0;
+            cache_pkts_[i].ts = 0;
+            cache_pkts_[i].rtp_ts = 0;
+            cache_pkts_[i].in_use = false;
+        }
+    }
+
+    nn_discard_ += (int64_t)frames.size();
+    wait_at_ = 0;
+}
+
+int32_t SrsRtcJitterBuffer::find_next_lost_sn(uint16_t header_sn, uint16_t current_sn, uint16_t& end_sn)
+{
+    uint32_t last_rtp_ts = cache_pkts_[cache_index(header_sn)].rtp_ts;
+    for (int i = 0; i < s_cache_size; ++i) {
+        uint16_t lost_sn = current_sn + i;
+        int index = cache_index(lost_sn);
+
+        if (!cache_pkts_[index].in_use) {
+            return lost_sn;
+        }
+        //check time first, avoid two small frame mixed case decode fail
+        if (last_rtp_ts != cache_pkts_[index].rtp_ts) {
+            end_sn = lost_sn - 1;
+            return -1;
+        }
+
+        if (cache_pkts_[index].pkt->header.get_marker()) {
+            end_sn = lost_sn;
+            return -1;
+        }
+    }
+
+    srs_error("cache overflow. the packet count of video frame is more than %u", s_cache_size);
+    return -2;
+}
+
+bool SrsRtcJitterBuffer::check_frame_complete(const uint16_t start, const uint16_t end)
+{
+    int16_t cnt = srs_rtp_seq_distance(start, end) + 1;
+    srs_assert(cnt >= 1);
+
+    uint16_t fu_s_c = 0;
+    uint16_t fu_e_c = 0;
+    for (uint16_t i = 0; i < (uint16_t)cnt; ++i) {
+        int index = cache_index((start + i));
+        SrsRtpPacket* pkt = cache_pkts_[index].pkt;
+
+        // fix crash when pkt->payload() if pkt is nullptr;
+        if (!pkt) continue;
+
+        SrsRtpFUAPayload2* fua_payload = dynamic_cast<SrsRtpFUAPayload2*>(pkt->payload());
+        if (!fua_payload) continue;
+
+        if (fua_payload->start) {
+            ++fu_s_c;
+        }
+
+        if (fua_payload->end) {
+            ++fu_e_c;
+        }
+    }
+
+    return fu_s_c == fu_e_c;
+}
+
+void SrsRtcJitterBuffer::on_packet(SrsRtpPacket* pkt, srs_utime_t now)
+{
+    uint16_t sn = pkt->header.get_sequence();
+
+    // The interarrival jitter, in the 90kHz clock of video.
+    int64_t transit = now - (int64_t)pkt->header.get_timestamp() * 1000 / 90;
+    if (last_transit_) {
+        int64_t d = transit - last_transit_;
+        jitter_ += (::fabs((double)d) - jitter_) / 16;
+    }
+    last_transit_ = transit;
+
+    // The loss rate by the gap of sequence, the recovered packets are old ones.
+    if (!has_highest_) {
+        has_highest_ = true;
+        highest_sn_ = sn;
+        nn_expected_++;
+    } else if (srs_rtp_seq_distance(highest_sn_, sn) > 0) {
+        int distance = srs_rtp_seq_distance(highest_sn_, sn);
+        nn_expected_ += distance;
+        nn_lost_ += distance - 1;
+        highest_sn_ = sn;
+    }
+
+    if (nn_expected_ >= 128) {
+        loss_rate_ = 0.5 * loss_rate_ + 0.5 * nn_lost_ / nn_expected_;
+        nn_expected_ = nn_lost_ = 0;
+    }
+}
+
+void SrsRtcJitterBuffer::on_late()
+{
+    nn_late_++;
+}
+
+void SrsRtcJitterBuffer::on_discard(uint32_t rtp_ts)
+{
+    if (discard_ts_ != rtp_ts) {
+        discard_ts_ = rtp_ts;
+        nn_discard_++;
+    }
+}
+
+bool SrsRtcJitterBuffer::update(uint16_t lost_sn, srs_utime_t now)
+{
+    // Waiting for the lost packet, only when the packets after it have arrived, to avoid
+    // mistaking the interval of frames as loss.
+    bool waiting = has_highest_ && srs_rtp_seq_distance(lost_sn, highest_sn_) > 0;
+
+    if (!waiting) {
+        if (wait_at_) {
+            on_recovered(now - wait_at_);
+            wait_at_ = 0;
+        }
+        return false;
+    }
+
+    if (!wait_at_) {
+        wait_at_ = now;
+        return false;
+    }
+
+    srs_utime_t elapsed = now - wait_at_;
+    if (elapsed <= target_delay()) {
+        return false;
+    }
+
+    // Wait more time next time, because the packet is probably recovered later.
+    on_recovered(2 * elapsed);
+    wait_at_ = 0;
+    nn_timeout_++;
+
+    return true;
+}
+
+srs_utime_t SrsRtcJitterBuffer::target_delay()
+{
+    double v = recover_delay_ + 4 * recover_dev_ + 2 * jitter_ + loss_rate_ * max_delay_;
+    return srs_max(SRS_RTC_JITTER_MIN_DELAY, srs_min(max_delay_, (srs_utime_t)v));
+}
+
+int64_t SrsRtcJitterBuffer::nn_late()
+{
+    return nn_late_;
+}
+
+int64_t SrsRtcJitterBuffer::nn_discard()
+{
+    return nn_discard_;
+}
+
+int64_t SrsRtcJitterBuffer::nn_timeout()
+{
+    return nn_timeout_;
+}
+
+float SrsRtcJitterBuffer::loss_rate()
+{
+    return loss_rate_;
+}
+
+srs_utime_t SrsRtcJitterBuffer::jitter()
+{
+    return (srs_utime_t)jitter_;
+}
+
+void SrsRtcJitterBuffer::on_recovered(srs_utime_t delay)
+{
+    double v = srs_min(delay, max_delay_);
+    recover_dev_ += (::fabs(v - recover_delay_) - recover_dev_) / 8;
+    recover_delay_ += (v - recover_delay_) / 8;
+}
+
 SrsRtcFrameBuilder::SrsRtcFrameBuilder(ISrsStreamBridge* bridge)
 {
     bridge_ = bridge;
+    req_ = NULL;
     is_first_audio_ = true;
     codec_ = NULL;
+    jitter_ = new SrsRtcJitterBuffer();
     header_sn_ = 0;
-    memset(cache_video_pkts_, 0, sizeof(cache_video_pkts_));
+    lost_sn_ = 0;
     rtp_key_frame_ts_ = -1;
+    wait_keyframe_ = true;
+    keyframe_request_ = false;
+    last_report_ = 0;
     sync_state_ = -1;
     obs_whip_sps_ = obs_whip_pps_ = NULL;
 }
@@ -1416,7 +1751,8 @@ SrsRtcFrameBuilder::SrsRtcFrameBuilder(ISrsStreamBridge* bridge)
 SrsRtcFrameBuilder::~SrsRtcFrameBuilder()
 {
     srs_freep(codec_);
-    clear_cached_video();
+    srs_freep(jitter_);
+    srs_freep(req_);
     srs_freep(obs_whip_sps_);
     srs_freep(obs_whip_pps_);
 }
@@ -1425,15 +1761,20 @@ srs_error_t SrsRtcFrameBuilder::initialize(SrsRequest* r)
 {
     srs_error_t err = srs_success;
 
+    srs_freep(req_);
+    req_ = r->copy();
+
+    jitter_->set_max_delay(_srs_config->get_rtc_jitter_for_rtmp(r->vhost));
+
     srs_freep(codec_);
-    codec_ = new SrsAudioTranscoder();
+    codec_ = new SrsAsyncAudioTranscoder();
 
     SrsAudioCodecId from = SrsAudioCodecIdOpus; // TODO: From SDP?
     SrsAudioCodecId to = SrsAudioCodecIdAAC; // The output audio codec.
     int channels = 2; // The output audio channels.
     int sample_rate = 48000; // The output audio sample rate in HZ.
     int bitrate = _srs_config->get_rtc_aac_bitrate(r->vhost); // The output audio bitrate in bps.
-    if ((err = codec_->initialize(from, to, channels, sample_rate, bitrate)) != srs_success) {
+    if ((err = codec_->initialize(r, from, to, channels, sample_rate, bitrate)) != srs_success) {
         return srs_error_wrap(err, "bridge initialize");
     }
 
@@ -1451,6 +1792,13 @@ void SrsRtcFrameBuilder::on_unpublish()
 {
 }
 
+bool SrsRtcFrameBuilder::fetch_keyframe_request()
+{
+    bool v = keyframe_request_;
+    keyframe_request_ = false;
+    return v;
+}
+
 srs_error_t SrsRtcFrameBuilder::on_rtp(SrsRtpPacket *pkt)
 {
     srs_error_t err = srs_success;
@@ -1524,9 +1872,10 @@ srs_error_t SrsRtcFrameBuilder::transcode_audio(SrsRtpPacket *pkt)
     }
 
     for (std::vector<SrsAudioFrame*>::iterator it = out_pkts.begin(); it != out_pkts.end(); ++it) {
+        // The output frames might be transcoded from previous packets by worker thread, so use the
+        // timestamp of output frame.
         SrsCommonMessage out_rtmp;
-        out_rtmp.header.timestamp = (*it)->dts;
-        packet_aac(&out_rtmp, (*it)->samples[0].bytes, (*it)->samples[0].size, ts, is_first_audio_);
+        packet_aac(&out_rtmp, (*it)->samples[0].bytes, (*it)->samples[0].size, (uint32_t)(*it)->dts, is_first_audio_);
 
         SrsSharedPtrMessage msg;
         if ((err = msg.create(&out_rtmp)) != srs_success) {
@@ -1564,28 +1913,62 @@ srs_error_t SrsRtcFrameBuilder::packet_video(SrsRtpPacket* src)
 {
     srs_error_t err = srs_success;
 
+    srs_utime_t now = srs_get_system_time();
+    jitter_->on_packet(src, now);
+
     // TODO: Only copy when need
-    SrsRtpPacket* pkt = src->copy();
+    if (src->is_keyframe()) {
+        err = packet_video_key_frame(src->copy());
+    } else if (wait_keyframe_) {
+        // The inter frame is not decodable without the keyframe.
+        jitter_->on_discard(src->header.get_timestamp());
+    } else if (srs_rtp_seq_distance(header_sn_, src->header.get_sequence()) < 0) {
+        // The frame of packet is already built or discarded.
+        jitter_->on_late();
+    } else {
+        err = packet_video_inter_frame(src->copy());
+    }
 
-    if (pkt->is_keyframe()) {
-        return packet_video_key_frame(pkt);
+    if (err != srs_success) {
+        return err;
+    }
+
+    // If wait too long for the lost packet, the frames after it are also not decodable.
+    if (!wait_keyframe_ && jitter_->update(lost_sn_, now)) {
+        srs_warn("RTC: jitter buffer timeout, header=%hu, lost=%hu, delay=%dms, jitter=%dms, loss=%.2f, skip to keyframe",
+            header_sn_, lost_sn_, srsu2msi(jitter_->target_delay()), srsu2msi(jitter_->jitter()), jitter_->loss_rate());
+        skip_to_keyframe();
     }
 
+    if (req_ && now - last_report_ >= SRS_UTIME_SECONDS) {
+        last_report_ = now;
+        SrsStatistic::instance()->on_stream_jitter(req_, srsu2msi(jitter_->target_delay()), jitter_->nn_late(), jitter_->nn_discard());
+    }
+
+    return err;
+}
+
+void SrsRtcFrameBuilder::skip_to_keyframe()
+{
+    jitter_->clear();
+    rtp_key_frame_ts_ = -1;
+    wait_keyframe_ = true;
+    keyframe_request_ = true;
+}
+
+srs_error_t SrsRtcFrameBuilder::packet_video_inter_frame(SrsRtpPacket* pkt)
+{
+    srs_error_t err = srs_success;
+
     // store in cache
-    int index = cache_index(pkt->header.get_sequence());
-    cache_video_pkts_[index].in_use = true;
-    srs_freep(cache_video_pkts_[index].pkt);
-    cache_video_pkts_[index].pkt = pkt;
-    cache_video_pkts_[index].sn = pkt->header.get_sequence();
-    cache_video_pkts_[index].ts = pkt->get_avsync_time();
-    cache_video_pkts_[index].rtp_ts = pkt->header.get_timestamp();
+    jitter_->store(pkt);
 
     // check whether to recovery lost packet and can construct a video frame
     if (lost_sn_ == pkt->header.get_sequence()) {
         uint16_t tail_sn = 0;
-        int sn = find_next_lost_sn(lost_sn_, tail_sn);
+        int sn = jitter_->find_next_lost_sn(header_sn_, lost_sn_, tail_sn);
         if (-1 == sn ) {
-            if (check_frame_complete(header_sn_, tail_sn)) {
+            if (jitter_->check_frame_complete(header_sn_, tail_sn)) {
                 if ((err = packet_video_rtmp(header_sn_, tail_sn)) != srs_success) {
                     err = srs_error_wrap(err, "fail to pack video frame");
                 }
@@ -1680,8 +2063,9 @@ srs_error_t SrsRtcFrameBuilder::packet_video_key_frame(SrsRtpPacket* pkt)
         rtp_key_frame_ts_ = pkt->header.get_timestamp();
         header_sn_ = pkt->header.get_sequence();
         lost_sn_ = header_sn_ + 1;
+        wait_keyframe_ = false;
         // Received key frame and clean cache of old p frame pkts
-        clear_cached_video();
+        jitter_->clear();
         srs_trace("set ts=%u, header=%hu, lost=%hu", (uint32_t)rtp_key_frame_ts_, header_sn_, lost_sn_);
     } else if (rtp_key_frame_ts_ != pkt->header.get_timestamp()) {
         //new key frame, clean cache
@@ -1691,31 +2075,26 @@ srs_error_t SrsRtcFrameBuilder::packet_video_key_frame(SrsRtpPacket* pkt)
         rtp_key_frame_ts_ = pkt->header.get_timestamp();
         header_sn_ = pkt->header.get_sequence();
         lost_sn_ = header_sn_ + 1;
-        clear_cached_video();
+        wait_keyframe_ = false;
+        jitter_->clear();
         srs_warn("drop old ts=%u, header=%hu, lost=%hu, set new ts=%u, header=%hu, lost=%hu",
                  (uint32_t)old_ts, old_header_sn, old_lost_sn, (uint32_t)rtp_key_frame_ts_, header_sn_, lost_sn_);
     }
 
-    uint16_t index = cache_index(pkt->header.get_sequence());
-    cache_video_pkts_[index].in_use = true;
-    srs_freep(cache_video_pkts_[index].pkt);
-    cache_video_pkts_[index].pkt = pkt;
-    cache_video_pkts_[index].sn = pkt->header.get_sequence();
-    cache_video_pkts_[index].ts = pkt->get_avsync_time();
-    cache_video_pkts_[index].rtp_ts = pkt->header.get_timestamp();
+    jitter_->store(pkt);
 
     int32_t sn = lost_sn_;
     uint16_t tail_sn = 0;
     if (srs_rtp_seq_distance(header_sn_, pkt->header.get_sequence()) < 0){
         // When receive previous pkt in the same frame, update header sn;
         header_sn_ = pkt->header.get_sequence();
-        sn = find_next_lost_sn(header_sn_, tail_sn);
+        sn = jitter_->find_next_lost_sn(header_sn_, header_sn_, tail_sn);
     } else if (lost_sn_ == pkt->header.get_sequence()) {
-        sn = find_next_lost_sn(lost_sn_, tail_sn);
+        sn = jitter_->find_next_lost_sn(header_sn_, lost_sn_, tail_sn);
     }
 
     if (-1 == sn) {
-        if (check_frame_complete(header_sn_, tail_sn)) {
+        if (jitter_->check_frame_complete(header_sn_, tail_sn)) {
             if ((err = packet_video_rtmp(header_sn_, tail_sn)) != srs_success) {
                 err = srs_error_wrap(err, "fail to packet frame");
             }
@@ -1739,8 +2118,7 @@ srs_error_t SrsRtcFrameBuilder::packet_video_rtmp(const uint16_t start, const ui
 
     for (uint16_t i = 0; i < (uint16_t)cnt; ++i) {
         uint16_t sn = start + i;
-        uint16_t index = cache_index(sn);
-        SrsRtpPacket* pkt = cache_video_pkts_[index].pkt;
+        SrsRtpPacket* pkt = jitter_->at(sn);
 
         // fix crash when pkt->payload() if pkt is nullptr;
         if (!pkt) continue;
@@ -1781,9 +2159,9 @@ srs_error_t SrsRtcFrameBuilder::packet_video_rtmp(const uint16_t start, const ui
         // otherwise, all the cached RTP packets are dropped before next key frame arrive.
         header_sn_ = end + 1;
         uint16_t tail_sn = 0;
-        int sn = find_next_lost_sn(header_sn_, tail_sn);
+        int sn = jitter_->find_next_lost_sn(header_sn_, header_sn_, tail_sn);
         if (-1 == sn) {
-            if (check_frame_complete(header_sn_, tail_sn)) {
+            if (jitter_->check_frame_complete(header_sn_, tail_sn)) {
                 err = packet_video_rtmp(header_sn_, tail_sn);
             }
         } else if (-2 == sn) {
@@ -1799,7 +2177,7 @@ srs_error_t SrsRtcFrameBuilder::packet_video_rtmp(const uint16_t start, const ui
     nb_payload += 1 + 1 + 3;
 
     SrsCommonMessage rtmp;
-    SrsRtpPacket* pkt = cache_video_pkts_[cache_index(start)].pkt;
+    SrsRtpPacket* pkt = jitter_->at(start);
     rtmp.header.initialize_video(nb_payload, pkt->get_avsync_time(), 1);
     rtmp.create_payload(nb_payload);
     rtmp.size = nb_payload;
@@ -1817,18 +2195,11 @@ srs_error_t SrsRtcFrameBuilder::packet_video_rtmp(const uint16_t start, const ui
 
     int nalu_len = 0;
     for (uint16_t i = 0; i < (uint16_t)cnt; ++i) {
-        uint16_t index = cache_index((start + i));
-        SrsRtpPacket* pkt = cache_video_pkts_[index].pkt;
+        SrsRtpPacket* pkt = jitter_->take(start + i);
 
         // fix crash when pkt->payload() if pkt is nullptr;
         if (!pkt) continue;
 
-        cache_video_pkts_[index].in_use = false;
-        cache_video_pkts_[index].pkt = NULL;
-        cache_video_pkts_[index].ts = 0;
-        cache_video_pkts_[index].rtp_ts = 0;
-        cache_video_pkts_[index].sn = 0;
-
         SrsRtpFUAPayload2* fua_payload = dynamic_cast<SrsRtpFUAPayload2*>(pkt->payload());
         if (fua_payload && fua_payload->size > 0) {
             if (fua_payload->start) {
@@ -1886,9 +2257,9 @@ srs_error_t SrsRtcFrameBuilder::packet_video_rtmp(const uint16_t start, const ui
 
     header_sn_ = end + 1;
     uint16_t tail_sn = 0;
-    int sn = find_next_lost_sn(header_sn_, tail_sn);
+    int sn = jitter_->find_next_lost_sn(header_sn_, header_sn_, tail_sn);
     if (-1 == sn) {
-        if (check_frame_complete(header_sn_, tail_sn)) {
+        if (jitter_->check_frame_complete(header_sn_, tail_sn)) {
             err = packet_video_rtmp(header_sn_, tail_sn);
         }
     } else if (-2 == sn) {
@@ -1900,75 +2271,6 @@ srs_error_t SrsRtcFrameBuilder::packet_video_rtmp(const uint16_t start, const ui
     return err;
 }
 
-int32_t SrsRtcFrameBuilder::find_next_lost_sn(uint16_t current_sn, uint16_t& end_sn)
-{
-    uint32_t last_rtp_ts = cache_video_pkts_[cache_index(header_sn_)].rtp_ts;
-    for (int i = 0; i < s_cache_size; ++i) {
-        uint16_t lost_sn = current_sn + i;
-        int index = cache_index(lost_sn);
-
-        if (!cache_video_pkts_[index].in_use) {
-            return lost_sn;
-        }
-        //check time first, avoid two small frame mixed case decode fail
-        if (last_rtp_ts != cache_video_pkts_[index].rtp_ts) {
-            end_sn = lost_sn - 1;
-            return -1;
-        }
-
-        if (cache_video_pkts_[index].pkt->header.get_marker()) {
-            end_sn = lost_sn;
-            return -1;
-        }
-    }
-
-    srs_error("cache overflow. the packet count of video frame is more than %u", s_cache_size);
-    return -2;
-}
-
-void SrsRtcFrameBuilder::clear_cached_video()
-{
-    for (size_t i = 0; i < s_cache_size; i++)
-    {
-        if (cache_video_pkts_[i].in_use) {
-            srs_freep(cache_video_pkts_[i].pkt);
-            cache_video_pkts_[i].sn = 0;
-            cache_video_pkts_[i].ts = 0;
-            cache_video_pkts_[i].rtp_ts = 0;
-            cache_video_pkts_[i].in_use = false;
-        }
-    }
-}
-
-bool SrsRtcFrameBuilder::check_frame_complete(const uint16_t start, const uint16_t end)
-{
-    int16_t cnt = srs_rtp_seq_distance(start, end) + 1;
-    srs_assert(cnt >= 1);
-
-    uint16_t fu_s_c = 0;
-    uint16_t fu_e_c = 0;
-    for (uint16_t i = 0; i < (uint16_t)cnt; ++i) {
-        int index = cache_index((start + i));
-        SrsRtpPacket* pkt = cache_video_pkts_[index].pkt;
-
-        // fix crash when pkt->payload() if pkt is nullptr;
-        if (!pkt) continue;
-
-        SrsRtpFUAPayload2* fua_payload = dynamic_cast<SrsRtpFUAPayload2*>(pkt->payload());
-        if (!fua_payload) continue;
-
-        if (fua_payload->start) {
-            ++fu_s_c;
-        }
-
-        if (fua_payload->end) {
-            ++fu_e_c;
-        }
-    }
-
-    return fu_s_c == fu_e_c;
-}
-
 #endif
 
 SrsCodecPayload::SrsCodecPayload()
@@ -2281,6 +2583,23 @@ SrsMediaPayloadType SrsRtxPayloadDes::generate_media_payload_type()
     return media_payload_type;
 }
 
+SrsRtcTrackEncoding::SrsRtcTrackEncoding()
+{
+    ssrc_ = 0;
+    rtx_ssrc_ = 0;
+}
+
+SrsRtcTrackEncoding::SrsRtcTrackEncoding(std::string rid, uint32_t ssrc)
+{
+    rid_ = rid;
+    ssrc_ = ssrc;
+    rtx_ssrc_ = 0;
+}
+
+SrsRtcTrackEncoding::~SrsRtcTrackEncoding()
+{
+}
+
 SrsRtcTrackDescription::SrsRtcTrackDescription()
 {
     ssrc_ = 0;
@@ -2292,6 +2611,7 @@ SrsRtcTrackDescription::SrsRtcTrackDescription()
     red_ = NULL;
     rtx_ = NULL;
     ulpfec_ = NULL;
+    flexfec_ = NULL;
 }
 
 SrsRtcTrackDescription::~SrsRtcTrackDescription()
@@ -2300,6 +2620,7 @@ SrsRtcTrackDescription::~SrsRtcTrackDescription()
     srs_freep(red_);
     srs_freep(rtx_);
     srs_freep(ulpfec_);
+    srs_freep(flexfec_);
 }
 
 bool SrsRtcTrackDescription::has_ssrc(uint32_t ssrc)
@@ -2357,6 +2678,9 @@ void SrsRtcTrackDescription::create_auxiliary_payload(const std::vector<SrsMedia
     } else if (payload.encoding_name_ == "ulpfec") {
         srs_freep(ulpfec_);
         ulpfec_ = new SrsCodecPayload(payload.payload_type_, "ulpfec", payload.clock_rate_);
+    } else if (payload.encoding_name_ == "flexfec-03") {
+        srs_freep(flexfec_);
+        flexfec_ = new SrsCodecPayload(payload.payload_type_, "flexfec-03", payload.clock_rate_);
     }
 }
 
@@ -2386,6 +2710,22 @@ int SrsRtcTrackDescription::get_rtp_extension_id(std::string uri)
     return 0;
 }
 
+SrsRtcTrackEncoding* SrsRtcTrackDescription::find_encoding(uint32_t ssrc)
+{
+    if (!ssrc) {
+        return NULL;
+    }
+
+    for (int i = 0; i < (int)encodings_.size(); ++i) {
+        SrsRtcTrackEncoding* encoding = &encodings_.at(i);
+        if (encoding->ssrc_ == ssrc || encoding->rtx_ssrc_ == ssrc) {
+            return encoding;
+        }
+    }
+
+    return NULL;
+}
+
 SrsRtcTrackDescription* SrsRtcTrackDescription::copy()
 {
     SrsRtcTrackDescription* cp = new SrsRtcTrackDescription();
@@ -2399,11 +2739,14 @@ SrsRtcTrackDescription* SrsRtcTrackDescription::copy()
     cp->direction_ = direction_;
     cp->mid_ = mid_;
     cp->msid_ = msid_;
+    cp->rid_ = rid_;
+    cp->encodings_ = encodings_;
     cp->is_active_ = is_active_;
     cp->media_ = media_ ? media_->copy():NULL;
     cp->red_ = red_ ? red_->copy():NULL;
     cp->rtx_ = rtx_ ? rtx_->copy():NULL;
     cp->ulpfec_ = ulpfec_ ? ulpfec_->copy():NULL;
+    cp->flexfec_ = flexfec_ ? flexfec_->copy():NULL;
 
     return cp;
 }
@@ -2553,6 +2896,12 @@ srs_error_t SrsRtcRecvTrack::send_rtcp_rr()
 
     uint32_t ssrc = track_desc_->ssrc_;
     const uint64_t& last_time = last_sender_report_sys_time_;
+
+    // Ignore the simulcast layer, which SSRC is not learned from RID yet.
+    if (!ssrc) {
+        return err;
+    }
+
     if ((err = session_->send_rtcp_rr(ssrc, rtp_queue_, last_time, last_sender_report_ntp_)) != srs_success) {
         return srs_error_wrap(err, "ssrc=%u, last_time=%" PRId64, ssrc, last_time);
     }
@@ -2564,6 +2913,11 @@ srs_error_t SrsRtcRecvTrack::send_rtcp_xr_rrtr()
 {
     srs_error_t err = srs_success;
 
+    // Ignore the simulcast layer, which SSRC is not learned from RID yet.
+    if (!track_desc_->ssrc_) {
+        return err;
+    }
+
     if ((err = session_->send_rtcp_xr_rrtr(track_desc_->ssrc_)) != srs_success) {
         return srs_error_wrap(err, "ssrc=%u", track_desc_->ssrc_);
     }
@@ -2588,6 +2942,20 @@ std::string SrsRtcRecvTrack::get_track_id()
     return track_desc_->id_;
 }
 
+std::string SrsRtcRecvTrack::get_rid()
+{
+    return track_desc_->rid_;
+}
+
+void SrsRtcRecvTrack::set_simulcast_ssrc(uint32_t ssrc, bool rtx)
+{
+    if (rtx) {
+        track_desc_->rtx_ssrc_ = ssrc;
+    } else {
+        track_desc_->ssrc_ = ssrc;
+    }
+}
+
 srs_error_t SrsRtcRecvTrack::on_nack(SrsRtpPacket** ppkt)
 {
     srs_error_t err = srs_success;
@@ -2765,6 +3133,11 @@ uint32_t SrsRtcTsJitter::correct(uint32_t value)
     return jitter_->correct(value);
 }
 
+void SrsRtcTsJitter::rebase(uint32_t delta)
+{
+    jitter_->rebase(delta);
+}
+
 SrsRtcSeqJitter::SrsRtcSeqJitter(uint16_t base)
 {
     jitter_ = new SrsRtcJitter<uint16_t, int16_t>(base, 128, srs_rtp_seq_distance);
@@ -2780,6 +3153,244 @@ uint16_t SrsRtcSeqJitter::correct(uint16_t value)
     return jitter_->correct(value);
 }
 
+void SrsRtcSeqJitter::rebase(uint16_t delta)
+{
+    jitter_->rebase(delta);
+}
+
+SrsRtcLayerSelector::SrsRtcLayerSelector()
+{
+    window_ = 0;
+    current_ = target_ = -1;
+    nn_good_ = 0;
+    switch_at_ = pli_at_ = 0;
+    pli_ = false;
+}
+
+SrsRtcLayerSelector::~SrsRtcLayerSelector()
+{
+}
+
+void SrsRtcLayerSelector::set_encodings(const std::vector<SrsRtcTrackEncoding>& encodings)
+{
+    uint32_t current = current_ssrc();
+    uint32_t target = target_ssrc();
+
+    ssrcs_.clear();
+    for (int i = 0; i < (int)encodings.size(); i++) {
+        ssrcs_.push_back(encodings.at(i).ssrc_);
+    }
+
+    bytes_.assign(ssrcs_.size(), 0);
+    kbps_.assign(ssrcs_.size(), 0);
+    last_packet_.assign(ssrcs_.size(), 0);
+    window_ = 0;
+
+    // Keep the layer if SSRC not changed, for example, only learned SSRC of other layers.
+    current_ = index_of(current);
+    target_ = index_of(target);
+
+    // Start from the first layer in offer, or any layer if it's not available.
+    if (current_ < 0 && target_ < 0 && !ssrcs_.empty()) {
+        start_switch(0, srs_get_system_time());
+    }
+}
+
+bool SrsRtcLayerSelector::has_layer(uint32_t ssrc)
+{
+    return index_of(ssrc) >= 0;
+}
+
+uint32_t SrsRtcLayerSelector::current_ssrc()
+{
+    return current_ >= 0 ? ssrcs_.at(current_) : 0;
+}
+
+uint32_t SrsRtcLayerSelector::target_ssrc()
+{
+    return target_ >= 0 ? ssrcs_.at(target_) : 0;
+}
+
+uint32_t SrsRtcLayerSelector::fetch_keyframe_request()
+{
+    if (!pli_ || target_ < 0) {
+        return 0;
+    }
+
+    pli_ = false;
+    return ssrcs_.at(target_);
+}
+
+bool SrsRtcLayerSelector::on_packet(uint32_t ssrc, int nb_bytes, bool keyframe, bool& switched)
+{
+    switched = false;
+
+    int index = index_of(ssrc);
+    if (index < 0) {
+        return false;
+    }
+
+    srs_utime_t now = srs_get_system_time();
+    bytes_.at(index) += nb_bytes;
+    last_packet_.at(index) = now;
+    update_bitrate(now);
+
+    // If the forwarding layer is gone, for example, publisher stops it for bandwidth, switch to this layer.
+    if (current_ >= 0 && index != current_ && target_ < 0 && now - last_packet_.at(current_) > 1 * SRS_UTIME_SECONDS) {
+        start_switch(index, now);
+    }
+
+    // If the target layer is not available, switch to this layer.
+    if (target_ >= 0 && index != target_ && now - switch_at_ > 1 * SRS_UTIME_SECONDS
+        && now - last_packet_.at(target_) > 1 * SRS_UTIME_SECONDS) {
+        start_switch(index, now);
+    }
+
+    // Request keyframe again, if the target layer still waits for it.
+    if (target_ >= 0 && now - pli_at_ > 1 * SRS_UTIME_SECONDS) {
+        pli_ = true;
+        pli_at_ = now;
+    }
+
+    // Switch to the target layer at keyframe, so the decoder of player never breaks.
+    if (index == target_ && keyframe) {
+        srs_trace("RTC: Simulcast switch layer ssrc=%u to %u, kbps=%d to %d", current_ssrc(), ssrc,
+            current_ >= 0 ? kbps_.at(current_) : 0, kbps_.at(index));
+        current_ = target_;
+        target_ = -1;
+        pli_ = false;
+        switched = true;
+    }
+
+    return index == current_;
+}
+
+void SrsRtcLayerSelector::on_feedback(float lost_rate)
+{
+    // Ignore if switching, or nothing is forwarding.
+    if (current_ < 0 || target_ >= 0) {
+        return;
+    }
+
+    srs_utime_t now = srs_get_system_time();
+
+    // Step down if loss is 10% or more, quickly to resolve the congestion.
+    if (lost_rate >= 0.1) {
+        nn_good_ = 0;
+        int index = pick(false);
+        if (index >= 0 && now - switch_at_ > 2 * SRS_UTIME_SECONDS) {
+            start_switch(index, now);
+        }
+        return;
+    }
+
+    // Step up if loss is 2% or less for some RR, slowly to avoid jitter.
+    if (lost_rate > 0.02) {
+        nn_good_ = 0;
+        return;
+    }
+
+    if (++nn_good_ < 5) {
+        return;
+    }
+    nn_good_ = 0;
+
+    int index = pick(true);
+    if (index >= 0 && now - switch_at_ > 10 * SRS_UTIME_SECONDS) {
+        start_switch(index, now);
+    }
+}
+
+void SrsRtcLayerSelector::on_bandwidth(int kbps)
+{
+    // Ignore if switching, or nothing is forwarding.
+    if (current_ < 0 || target_ >= 0 || kbps <= 0) {
+        return;
+    }
+
+    srs_utime_t now = srs_get_system_time();
+
+    // Step down if the layer exceeds the bandwidth, quickly to resolve the congestion.
+    if (kbps_.at(current_) > kbps) {
+        int index = pick(false);
+        if (index >= 0 && now - switch_at_ > 2 * SRS_UTIME_SECONDS) {
+            start_switch(index, now);
+        }
+        return;
+    }
+
+    // Step up if the higher layer is much lower than the bandwidth, slowly to avoid jitter.
+    int index = pick(true);
+    if (index >= 0 && kbps_.at(index) < kbps * 0.85 && now - switch_at_ > 10 * SRS_UTIME_SECONDS) {
+        start_switch(index, now);
+    }
+}
+
+int SrsRtcLayerSelector::index_of(uint32_t ssrc)
+{
+    if (!ssrc) {
+        return -1;
+    }
+
+    for (int i = 0; i < (int)ssrcs_.size(); i++) {
+        if (ssrcs_.at(i) == ssrc) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+void SrsRtcLayerSelector::start_switch(int index, srs_utime_t now)
+{
+    target_ = index;
+    switch_at_ = pli_at_ = now;
+    pli_ = true;
+}
+
+void SrsRtcLayerSelector::update_bitrate(srs_utime_t now)
+{
+    if (!window_) {
+        window_ = now;
+        return;
+    }
+
+    srs_utime_t elapsed = now - window_;
+    if (elapsed < 1 * SRS_UTIME_SECONDS) {
+        return;
+    }
+
+    for (int i = 0; i < (int)bytes_.size(); i++) {
+        kbps_.at(i) = (int)(bytes_.at(i) * 8 * 1000 / elapsed);
+        bytes_.at(i) = 0;
+    }
+    window_ = now;
+}
+
+int SrsRtcLayerSelector::pick(bool higher)
+{
+    int best = -1;
+    int base = kbps_.at(current_);
+
+    for (int i = 0; i < (int)kbps_.size(); i++) {
+        int kbps = kbps_.at(i);
+
+        // Ignore the current or inactive layer.
+        if (i == current_ || kbps <= 0) {
+            continue;
+        }
+
+        if (higher && kbps > base && (best < 0 || kbps < kbps_.at(best))) {
+            best = i;
+        }
+        if (!higher && kbps < base && (best < 0 || kbps > kbps_.at(best))) {
+            best = i;
+        }
+    }
+
+    return best;
+}
+
 SrsRtcSendTrack::SrsRtcSendTrack(SrsRtcConnection* session, SrsRtcTrackDescription* track_desc, bool is_audio)
 {
     session_ = session;
@@ -2908,7 +3519,7 @@ srs_error_t SrsRtcSendTrack::on_recv_nack(const vector<uint16_t>& lost_seqs)
         }
 
         // By default, we send packets by sendmmsg.
-        if ((err = session_->do_send_packet(pkt)) != srs_success) {
+        if ((err = session_->do_send_packet(pkt, true)) != srs_success) {
             return srs_error_wrap(err, "raw send");
         }
     }
@@ -2949,7 +3560,7 @@ srs_error_t SrsRtcAudioSendTrack::on_rtp(SrsRtpPacket* pkt)
     // Rebuild the sequence number and timestamp of packet, see https://github.com/ossrs/srs/issues/3167
     rebuild_packet(pkt);
 
-    if ((err = session_->do_send_packet(pkt)) != srs_success) {
+    if ((err = session_->do_send_packet(pkt, false)) != srs_success) {
         return srs_error_wrap(err, "raw send");
     }
 
@@ -2966,13 +3577,94 @@ srs_error_t SrsRtcAudioSendTrack::on_rtcp(SrsRtpPacket* pkt)
     return err;
 }
 
+// Whether the packet is the start of keyframe, where player is able to switch to another layer.
+bool srs_rtp_is_keyframe_start(SrsRtpPacket* pkt)
+{
+    if (!pkt->is_keyframe()) {
+        return false;
+    }
+
+    // For FU-A, only the first fragment of IDR.
+    if (pkt->nalu_type == kFuA) {
+        SrsRtpFUAPayload2* fua = dynamic_cast<SrsRtpFUAPayload2*>(pkt->payload());
+        return fua && fua->start;
+    }
+
+    return true;
+}
+
 SrsRtcVideoSendTrack::SrsRtcVideoSendTrack(SrsRtcConnection* session, SrsRtcTrackDescription* track_desc)
     : SrsRtcSendTrack(session, track_desc, false)
 {
+    selector_ = NULL;
+    last_sent_ = 0;
+    fec_ = NULL;
+
+    if (!track_desc_->encodings_.empty()) {
+        selector_ = new SrsRtcLayerSelector();
+        selector_->set_encodings(track_desc_->encodings_);
+    }
+
+    if (track_desc_->flexfec_ && track_desc_->fec_ssrc_) {
+        fec_ = new SrsRtcFecEncoder(track_desc_->ssrc_, track_desc_->fec_ssrc_, track_desc_->flexfec_->pt_);
+    }
 }
 
 SrsRtcVideoSendTrack::~SrsRtcVideoSendTrack()
 {
+    srs_freep(selector_);
+    srs_freep(fec_);
+}
+
+bool SrsRtcVideoSendTrack::has_layer(uint32_t ssrc)
+{
+    return selector_ && selector_->has_layer(ssrc);
+}
+
+uint32_t SrsRtcVideoSendTrack::get_layer_ssrc()
+{
+    if (!selector_) {
+        return 0;
+    }
+
+    uint32_t ssrc = selector_->target_ssrc();
+    return ssrc ? ssrc : selector_->current_ssrc();
+}
+
+void SrsRtcVideoSendTrack::set_encodings(const std::vector<SrsRtcTrackEncoding>& encodings)
+{
+    track_desc_->encodings_ = encodings;
+
+    if (!selector_ && !encodings.empty()) {
+        selector_ = new SrsRtcLayerSelector();
+    }
+
+    if (selector_) {
+        selector_->set_encodings(encodings);
+    }
+}
+
+void SrsRtcVideoSendTrack::on_feedback(float lost_rate)
+{
+    if (selector_) {
+        selector_->on_feedback(lost_rate);
+    }
+
+    if (fec_) {
+        fec_->on_feedback(lost_rate);
+    }
+}
+
+void SrsRtcVideoSendTrack::on_bandwidth(int kbps)
+{
+    if (selector_) {
+        selector_->on_bandwidth(kbps);
+    }
+}
+
+uint32_t SrsRtcVideoSendTrack::fetch_keyframe_request()
+{
+    return selector_ ? selector_->fetch_keyframe_request() : 0;
 }
 
 srs_error_t SrsRtcVideoSendTrack::on_rtp(SrsRtpPacket* pkt)
@@ -2982,7 +3674,22 @@ srs_error_t SrsRtcVideoSendTrack::on_rtp(SrsRtpPacket* pkt)
     if (!track_desc_->is_active_) {
         return err;
     }
-    
+
+    // For simulcast, only forward the selected layer, and continue the sequence and timestamp when switching.
+    if (selector_) {
+        bool switched = false;
+        if (!selector_->on_packet(pkt->header.get_ssrc(), pkt->nb_bytes(), srs_rtp_is_keyframe_start(pkt), switched)) {
+            return err;
+        }
+
+        srs_utime_t now = srs_get_system_time();
+        if (switched && last_sent_) {
+            jitter_seq_->rebase(1);
+            jitter_ts_->rebase((uint32_t)srs_max(1, srsu2ms(now - last_sent_)) * 90);
+        }
+        last_sent_ = now;
+    }
+
     pkt->header.set_ssrc(track_desc_->ssrc_);
 
     // Should update PT, because subscriber may use different PT to publisher.
@@ -2999,13 +3706,31 @@ srs_error_t SrsRtcVideoSendTrack::on_rtp(SrsRtpPacket* pkt)
     // Rebuild the sequence number and timestamp of packet, see https://github.com/ossrs/srs/issues/3167
     rebuild_packet(pkt);
 
-    if ((err = session_->do_send_packet(pkt)) != srs_success) {
+    if ((err = session_->do_send_packet(pkt, false)) != srs_success) {
         return srs_error_wrap(err, "raw send");
     }
 
     srs_info("RTC: Send video ssrc=%d, seqno=%d, keyframe=%d, ts=%u", pkt->header.get_ssrc(),
         pkt->header.get_sequence(), pkt->is_keyframe(), pkt->header.get_timestamp());
 
+    // Protect the packet as it is sent, with the TWCC extension, by FEC.
+    if (fec_) {
+        std::vector<SrsRtpPacket*> fecs;
+        err = fec_->on_packet(pkt, fecs);
+
+        for (int i = 0; i < (int)fecs.size(); i++) {
+            SrsRtpPacket* fec = fecs.at(i);
+            if (err == srs_success && (err = session_->do_send_packet(fec, false)) != srs_success) {
+                err = srs_error_wrap(err, "send fec");
+            }
+            srs_freep(fec);
+        }
+
+        if (err != srs_success) {
+            return srs_error_wrap(err, "fec");
+        }
+    }
+
     return err;
 }
 
@@ -31,7 +31,7 @@ class SrsCommonMessage;
 class SrsMessageArray;
 class SrsRtcSource;
 class SrsFrameToRtcBridge;
-class SrsAudioTranscoder;
+class SrsAsyncAudioTranscoder;
 class SrsRtpPacket;
 class SrsSample;
 class SrsRtcSourceDescription;
@@ -43,6 +43,7 @@ class SrsJsonObject;
 class SrsErrorPithyPrint;
 class SrsRtcFrameBuilder;
 class SrsLiveSource;
+class SrsRtcFecEncoder;
 
 // Firefox defaults as 109, Chrome is 111.
 const int kAudioPayloadType     = 111;
@@ -179,6 +180,8 @@ private:
     ISrsRtcPublishStream* publish_stream_;
     // Steam description for this steam.
     SrsRtcSourceDescription* stream_desc_;
+    // For simulcast, the SSRC of the first encoding, the only layer to bridge. Zero if not simulcast.
+    uint32_t simulcast_ssrc_;
 private:
 #ifdef SRS_FFMPEG_FIT
     // Collect and build WebRTC RTP packets to AV frames.
@@ -257,6 +260,11 @@ public:
     bool has_stream_desc();
     void set_stream_desc(SrsRtcSourceDescription* stream_desc);
     std::vector<SrsRtcTrackDescription*> get_track_desc(std::string type, std::string media_type);
+    // For simulcast, bind the SSRC of encoding learned from RID, and notify the consumers.
+    void on_simulcast_ssrc(std::string track_id, std::string rid, uint32_t ssrc, bool rtx);
+private:
+    void update_simulcast_ssrc();
+public:
 // interface ISrsFastTimer
 private:
     srs_error_t on_timer(srs_utime_t interval);
@@ -276,7 +284,7 @@ private:
     SrsMetaCache* meta;
 private:
     SrsAudioCodecId latest_codec_;
-    SrsAudioTranscoder* codec_;
+    SrsAsyncAudioTranscoder* codec_;
     bool keep_bframe;
     bool keep_avc_nalu_sei;
     bool merge_nalus;
@@ -312,18 +320,14 @@ private:
     srs_error_t consume_packets(std::vector<SrsRtpPacket*>& pkts);
 };
 
-// Collect and build WebRTC RTP packets to AV frames.
-class SrsRtcFrameBuilder
+// The jitter buffer for RTC to RTMP, which caches the video RTP packets by sequence number
+// to detect the complete frame. When there is a gap of sequence, it waits for the lost packet
+// recovered by NACK, but no longer than the target delay, which is adaptive to the jitter and
+// the loss of network, and is limited to the max delay.
+class SrsRtcJitterBuffer
 {
-private:
-    ISrsStreamBridge* bridge_;
-private:
-    bool is_first_audio_;
-    SrsAudioTranscoder *codec_;
 private:
     const static uint16_t s_cache_size = 512;
-    //TODO:use SrsRtpRingBuffer
-    //TODO:jitter buffer class
     struct RtcPacketCache {
         bool in_use;
         uint16_t sn;
@@ -331,10 +335,90 @@ private:
         uint32_t rtp_ts;
         SrsRtpPacket* pkt;
     };
-    RtcPacketCache cache_video_pkts_[s_cache_size];
+    RtcPacketCache cache_pkts_[s_cache_size];
+private:
+    // The highest sequence number received.
+    bool has_highest_;
+    uint16_t highest_sn_;
+    // The interarrival jitter in us, see https://datatracker.ietf.org/doc/html/rfc3550#appendix-A.8
+    int64_t last_transit_;
+    double jitter_;
+    // The loss rate of packets, before recovered by NACK.
+    int nn_expected_;
+    int nn_lost_;
+    float loss_rate_;
+private:
+    // The time when waiting for the lost packet, while the packets after it have arrived.
+    srs_utime_t wait_at_;
+    // The delay to recover the lost packet, and its mean deviation.
+    double recover_delay_;
+    double recover_dev_;
+    srs_utime_t max_delay_;
+private:
+    int64_t nn_late_;
+    int64_t nn_discard_;
+    int64_t nn_timeout_;
+    // The timestamp of last discarded frame.
+    int64_t discard_ts_;
+public:
+    SrsRtcJitterBuffer();
+    virtual ~SrsRtcJitterBuffer();
+public:
+    void set_max_delay(srs_utime_t v);
+    // Store the packet, which is owned by jitter buffer.
+    void store(SrsRtpPacket* pkt);
+    // Get the packet in cache, NULL if not exists.
+    SrsRtpPacket* at(uint16_t sn);
+    // Remove the packet from cache, and the packet is owned by caller.
+    SrsRtpPacket* take(uint16_t sn);
+    // Free all the cached packets, which are discarded.
+    void clear();
+    // Find the lost sequence from current, or -1 if the frame from header to end is ready,
+    // or -2 if the cache is overflow.
+    int32_t find_next_lost_sn(uint16_t header_sn, uint16_t current_sn, uint16_t& end_sn);
+    bool check_frame_complete(const uint16_t start, const uint16_t end);
+public:
+    // When got video packet, to estimate the jitter and loss.
+    void on_packet(SrsRtpPacket* pkt, srs_utime_t now);
+    // When got a late packet, which is before the frame in building.
+    void on_late();
+    // When discard a packet which is not keyframe, while waiting for keyframe.
+    void on_discard(uint32_t rtp_ts);
+    // Update the state of waiting for the lost packet, return true if wait too long.
+    bool update(uint16_t lost_sn, srs_utime_t now);
+    // Get the max time to wait for the lost packet.
+    srs_utime_t target_delay();
+    int64_t nn_late();
+    int64_t nn_discard();
+    int64_t nn_timeout();
+    float loss_rate();
+    srs_utime_t jitter();
+private:
+    void on_recovered(srs_utime_t delay);
+    inline uint16_t cache_index(uint16_t current_sn) {
+        return current_sn % s_cache_size;
+    }
+};
+
+// Collect and build WebRTC RTP packets to AV frames.
+class SrsRtcFrameBuilder
+{
+private:
+    ISrsStreamBridge* bridge_;
+    SrsRequest* req_;
+private:
+    bool is_first_audio_;
+    SrsAsyncAudioTranscoder* codec_;
+private:
+    SrsRtcJitterBuffer* jitter_;
     uint16_t header_sn_;
     uint16_t lost_sn_;
     int64_t rtp_key_frame_ts_;
+    // Whether discard the video packets until got keyframe.
+    bool wait_keyframe_;
+    // Whether should request keyframe from publisher, for jitter buffer timeout.
+    bool keyframe_request_;
+    srs_utime_t last_report_;
 private:
     // The state for timestamp sync state. -1 for init. 0 not sync. 1 sync.
     int sync_state_;
@@ -350,19 +434,17 @@ public:
     virtual srs_error_t on_publish();
     virtual void on_unpublish();
     virtual srs_error_t on_rtp(SrsRtpPacket *pkt);
+    // Whether should request keyframe, for the lost packet is not recovered in time.
+    bool fetch_keyframe_request();
 private:
     srs_error_t transcode_audio(SrsRtpPacket *pkt);
     void packet_aac(SrsCommonMessage* audio, char* data, int len, uint32_t pts, bool is_header);
 private:
     srs_error_t packet_video(SrsRtpPacket* pkt);
+    srs_error_t packet_video_inter_frame(SrsRtpPacket* pkt);
     srs_error_t packet_video_key_frame(SrsRtpPacket* pkt);
-    inline uint16_t cache_index(uint16_t current_sn) {
-        return current_sn % s_cache_size;
-    }
-    int32_t find_next_lost_sn(uint16_t current_sn, uint16_t& end_sn);
-    bool check_frame_complete(const uint16_t start, const uint16_t end);
     srs_error_t packet_video_rtmp(const uint16_t start, const uint16_t end);
-    void clear_cached_video();
+    void skip_to_keyframe();
 };
 
 #endif
@@ -466,6 +548,21 @@ public:
     virtual SrsMediaPayloadType generate_media_payload_type();
 };
 
+// The encoding(layer) of simulcast track, see https://www.rfc-editor.org/rfc/rfc8853
+class SrsRtcTrackEncoding
+{
+public:
+    // The RID of encoding, empty if simulcast is signaled by ssrc-group SIM.
+    std::string rid_;
+    // The SSRC of encoding, zero if not learned from RID extension yet.
+    uint32_t ssrc_;
+    uint32_t rtx_ssrc_;
+public:
+    SrsRtcTrackEncoding();
+    SrsRtcTrackEncoding(std::string rid, uint32_t ssrc);
+    virtual ~SrsRtcTrackEncoding();
+};
+
 class SrsRtcTrackDescription
 {
 public:
@@ -492,12 +589,18 @@ public:
     std::string mid_;
     // msid_: track stream id
     std::string msid_;
+    // For simulcast, the RID of this layer, set for the track of publisher layer.
+    std::string rid_;
+    // For simulcast, the encodings of publisher, in the order of offer.
+    std::vector<SrsRtcTrackEncoding> encodings_;
 
     // meida payload, such as opus, h264.
     SrsCodecPayload* media_;
     SrsCodecPayload* red_;
     SrsCodecPayload* rtx_;
     SrsCodecPayload* ulpfec_;
+    // The FlexFEC for player, sent in the fec_ssrc_.
+    SrsCodecPayload* flexfec_;
 public:
     SrsRtcTrackDescription();
     virtual ~SrsRtcTrackDescription();
@@ -511,12 +614,14 @@ public:
     void del_rtp_extension_desc(std::string uri);
     void set_direction(std::string direction);
     void set_codec_payload(SrsCodecPayload* payload);
-    // auxiliary paylod include red, rtx, ulpfec.
+    // auxiliary paylod include red, rtx, ulpfec, flexfec.
     void create_auxiliary_payload(const std::vector<SrsMediaPayloadType> payload_types);
     void set_rtx_ssrc(uint32_t ssrc);
     void set_fec_ssrc(uint32_t ssrc);
     void set_mid(std::string mid);
     int get_rtp_extension_id(std::string uri);
+    // For simulcast, find the encoding by SSRC or RTX SSRC, NULL if not found.
+    SrsRtcTrackEncoding* find_encoding(uint32_t ssrc);
 public:
     SrsRtcTrackDescription* copy();
 };
@@ -576,6 +681,9 @@ public:
     bool set_track_status(bool active);
     bool get_track_status();
     std::string get_track_id();
+    // For simulcast, the RID of layer, and the SSRC learned from RID extension.
+    std::string get_rid();
+    void set_simulcast_ssrc(uint32_t ssrc, bool rtx);
 public:
     // Note that we can set the pkt to NULL to avoid copy, for example, if the NACK cache the pkt and
     // set to NULL, nack nerver copy it but set the pkt to NULL.
@@ -630,6 +738,9 @@ private:
     T base_;
     // Whether initialized. Note that we should not use correct_base_(0) as init state, because it might flip back.
     bool init_;
+    // Whether rebase at next value, continue from the last corrected value plus delta.
+    bool rebase_;
+    T delta_;
 public:
     SrsRtcJitter(T base, ST threshold, PFN distance) {
         threshold_ = threshold;
@@ -639,19 +750,31 @@ public:
         pkt_base_ = pkt_last_ = 0;
         correct_last_ = correct_base_ = 0;
         init_ = false;
+        rebase_ = false;
+        delta_ = 0;
     }
     virtual ~SrsRtcJitter() {
     }
 public:
+    // Rebase at next value, for example, the source is switched to another stream.
+    void rebase(T delta) {
+        rebase_ = true;
+        delta_ = delta;
+    }
     T correct(T value) {
         if (!init_) {
             init_ = true;
+            rebase_ = false;
             correct_base_ = base_;
-            pkt_base_ = value;
+            pkt_base_ = pkt_last_ = value;
             srs_trace("RTC: Jitter init base=%u, value=%u", base_, value);
         }
 
-        if (true) {
+        if (rebase_) {
+            rebase_ = false;
+            pkt_base_ = value;
+            correct_base_ = correct_last_ + delta_;
+        } else {
             ST distance = distance_(value, pkt_last_);
             if (distance > threshold_ || distance < -1 * threshold_) {
                 srs_trace("RTC: Jitter rebase value=%u, last=%u, distance=%d, pkt-base=%u/%u, correct-base=%u/%u",
@@ -678,6 +801,7 @@ public:
     virtual ~SrsRtcTsJitter();
 public:
     uint32_t correct(uint32_t value);
+    void rebase(uint32_t delta);
 };
 
 // For RTC sequence jitter.
@@ -690,6 +814,55 @@ public:
     virtual ~SrsRtcSeqJitter();
 public:
     uint16_t correct(uint16_t value);
+    void rebase(uint16_t delta);
+};
+
+// For simulcast player, select the layer by receiver feedback, and switch layer only at keyframe.
+class SrsRtcLayerSelector
+{
+private:
+    // The SSRC of layers from publisher, in the order of offer.
+    std::vector<uint32_t> ssrcs_;
+    // The bytes in current window and the bitrate of each layer, to rank the layers.
+    std::vector<uint64_t> bytes_;
+    std::vector<int> kbps_;
+    std::vector<srs_utime_t> last_packet_;
+    srs_utime_t window_;
+private:
+    // The index of layer which is forwarding, -1 if none.
+    int current_;
+    // The index of layer to switch to, which waits for keyframe, -1 if none.
+    int target_;
+    // The number of continuous RR without loss, to step up.
+    int nn_good_;
+    srs_utime_t switch_at_;
+    // Whether request keyframe for target layer.
+    bool pli_;
+    srs_utime_t pli_at_;
+public:
+    SrsRtcLayerSelector();
+    virtual ~SrsRtcLayerSelector();
+public:
+    void set_encodings(const std::vector<SrsRtcTrackEncoding>& encodings);
+    bool has_layer(uint32_t ssrc);
+    // The SSRC of forwarding layer, or the target layer if switching.
+    uint32_t current_ssrc();
+    uint32_t target_ssrc();
+    // Whether forward the packet of layer ssrc. Set the switched to true if starts a new layer, so
+    // the sequence and timestamp should be rebased.
+    bool on_packet(uint32_t ssrc, int nb_bytes, bool keyframe, bool& switched);
+    // When got the lost rate in RR from player, step down or up the layer.
+    void on_feedback(float lost_rate);
+    // When got the estimated bandwidth of player, step down if exceeded, or up if enough.
+    void on_bandwidth(int kbps);
+    // Fetch the SSRC of target layer to request keyframe, zero if not required.
+    uint32_t fetch_keyframe_request();
+private:
+    int index_of(uint32_t ssrc);
+    void start_switch(int index, srs_utime_t now);
+    void update_bitrate(srs_utime_t now);
+    // Pick the active layer with next lower or higher bitrate of current, -1 if none.
+    int pick(bool higher);
 };
 
 class SrsRtcSendTrack
@@ -746,9 +919,28 @@ public:
 
 class SrsRtcVideoSendTrack : public SrsRtcSendTrack
 {
+private:
+    // For simulcast, the layer selector, NULL if not simulcast.
+    SrsRtcLayerSelector* selector_;
+    // The time of last sent packet, to rebase the timestamp when switching layer.
+    srs_utime_t last_sent_;
+    // The FlexFEC encoder, NULL if player does not support it.
+    SrsRtcFecEncoder* fec_;
 public:
     SrsRtcVideoSendTrack(SrsRtcConnection* session, SrsRtcTrackDescription* track_desc);
     virtual ~SrsRtcVideoSendTrack();
+public:
+    // For simulcast, whether the ssrc is a layer of publisher.
+    bool has_layer(uint32_t ssrc);
+    // For simulcast, the SSRC of publisher layer to request keyframe, zero if not simulcast.
+    uint32_t get_layer_ssrc();
+    void set_encodings(const std::vector<SrsRtcTrackEncoding>& encodings);
+    // When got the lost rate in RR from player, for simulcast and FEC.
+    void on_feedback(float lost_rate);
+    // For simulcast, when got the estimated bandwidth of player.
+    void on_bandwidth(int kbps);
+    // For simulcast, fetch the SSRC of publisher layer to request keyframe, zero if not required.
+    uint32_t fetch_keyframe_request();
 public:
     virtual srs_error_t on_rtp(SrsRtpPacket* pkt);
     virtual srs_error_t on_rtcp(SrsRtpPacket* pkt);
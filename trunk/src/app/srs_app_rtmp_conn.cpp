@@ -40,6 +40,7 @@ using namespace std;
 #include <srs_app_rtc_source.hpp>
 #include <srs_app_tencentcloud.hpp>
 #include <srs_app_srt_source.hpp>
+#include <srs_app_threads.hpp>
 
 // the timeout in srs_utime_t to wait encoder to republish
 // if timeout, close the connection.
@@ -56,6 +57,13 @@ using namespace std;
 // when edge timeout, retry next.
 #define SRS_EDGE_TOKEN_TRAVERSE_TIMEOUT (3 * SRS_UTIME_SECONDS)
 
+// The max number of pending handshake tasks for each worker.
+#define SRS_RTMP_HANDSHAKE_TASKS 1024
+// The max time for handshake worker to wait for tasks, signaled by ST thread.
+#define SRS_RTMP_HANDSHAKE_WORKER_WAIT (100 * SRS_UTIME_MILLISECONDS)
+// The interval for the reaper coroutine to check the done tasks, only when some tasks in flight.
+#define SRS_RTMP_HANDSHAKE_WAIT (1 * SRS_UTIME_MILLISECONDS)
+
 SrsSimpleRtmpClient::SrsSimpleRtmpClient(string u, srs_utime_t ctm, srs_utime_t stm) : SrsBasicRtmpClient(u, ctm, stm)
 {
 }
@@ -89,6 +97,259 @@ SrsClientInfo::~SrsClientInfo()
     srs_freep(res);
 }
 
+SrsRtmpHandshakeTask::SrsRtmpHandshakeTask(SrsHandshakeBytes* hs_bytes)
+{
+    hs_bytes_ = hs_bytes;
+    err_ = srs_success;
+    done_ = false;
+    cond_ = srs_cond_new();
+}
+
+SrsRtmpHandshakeTask::~SrsRtmpHandshakeTask()
+{
+    srs_cond_destroy(cond_);
+}
+
+SrsRtmpHandshakeWorker::SrsRtmpHandshakeWorker()
+{
+    tasks_ = new SrsThreadQueue<SrsRtmpHandshakeTask*>(SRS_RTMP_HANDSHAKE_TASKS);
+    done_ = new SrsThreadQueue<SrsRtmpHandshakeTask*>(SRS_RTMP_HANDSHAKE_TASKS);
+    nn_inflight_ = 0;
+    cond_ = new SrsThreadCond();
+    quit_ = 0;
+    entry_ = NULL;
+}
+
+SrsRtmpHandshakeWorker::~SrsRtmpHandshakeWorker()
+{
+    stop();
+    reap();
+
+    srs_freep(cond_);
+    srs_freep(tasks_);
+    srs_freep(done_);
+}
+
+bool SrsRtmpHandshakeWorker::post(SrsRtmpHandshakeTask* task)
+{
+    // Limit the tasks in flight, so the done queue is never full.
+    if (nn_inflight_ >= SRS_RTMP_HANDSHAKE_TASKS || !tasks_->push(task)) {
+        return false;
+    }
+
+    nn_inflight_++;
+    cond_->signal();
+    return true;
+}
+
+int SrsRtmpHandshakeWorker::consume()
+{
+    int nn = 0;
+
+    SrsRtmpHandshakeTask* task = NULL;
+    while (tasks_->pop(task)) {
+        task->err_ = SrsComplexHandshake::create_s0s1s2(task->hs_bytes_);
+
+        // Never fail, because the tasks in flight are limited by the capacity of queue.
+        done_->push(task);
+        nn++;
+    }
+
+    return nn;
+}
+
+int SrsRtmpHandshakeWorker::reap()
+{
+    int nn = 0;
+
+    SrsRtmpHandshakeTask* task = NULL;
+    while (done_->pop(task)) {
+        nn_inflight_--;
+        nn++;
+
+        task->done_ = true;
+        srs_cond_signal(task->cond_);
+    }
+
+    return nn;
+}
+
+srs_error_t SrsRtmpHandshakeWorker::start()
+{
+    return _srs_thread_pool->execute("handshake", SrsRtmpHandshakeWorker::start, this, &entry_);
+}
+
+void SrsRtmpHandshakeWorker::stop()
+{
+    if (!entry_) {
+        return;
+    }
+
+    __atomic_store_n(&quit_, 1, __ATOMIC_RELEASE);
+    cond_->signal();
+
+    srs_error_t err = _srs_thread_pool->join(entry_);
+    if (err != srs_success) {
+        srs_warn("RTMP: ignore stop handshake worker err %s", srs_error_desc(err).c_str());
+        srs_freep(err);
+    }
+    entry_ = NULL;
+}
+
+srs_error_t SrsRtmpHandshakeWorker::start(void* arg)
+{
+    SrsRtmpHandshakeWorker* worker = (SrsRtmpHandshakeWorker*)arg;
+    return worker->cycle();
+}
+
+srs_error_t SrsRtmpHandshakeWorker::cycle()
+{
+    srs_error_t err = srs_success;
+
+    while (!__atomic_load_n(&quit_, __ATOMIC_ACQUIRE)) {
+        // Wait for the tasks, which signaled by ST thread.
+        if (!consume()) {
+            cond_->wait(SRS_RTMP_HANDSHAKE_WORKER_WAIT);
+        }
+    }
+
+    // Always done the left tasks, because the ST coroutines wait for them.
+    consume();
+
+    return err;
+}
+
+SrsRtmpHandshakeWorkers::SrsRtmpHandshakeWorkers()
+{
+    started_ = false;
+    next_ = 0;
+    trd_ = new SrsDummyCoroutine();
+    wait_ = srs_cond_new();
+    nn_inflight_ = 0;
+}
+
+SrsRtmpHandshakeWorkers::~SrsRtmpHandshakeWorkers()
+{
+    stop();
+
+    srs_freep(trd_);
+    srs_cond_destroy(wait_);
+}
+
+void SrsRtmpHandshakeWorkers::stop()
+{
+    // Never start the workers again, the new clients handshake in ST thread.
+    started_ = true;
+
+    trd_->stop();
+
+    std::vector<SrsRtmpHandshakeWorker*> workers;
+    workers.swap(workers_);
+
+    // The workers done all tasks before quit, so we wakeup the waiting coroutines.
+    for (int i = 0; i < (int)workers.size(); i++) {
+        SrsRtmpHandshakeWorker* worker = workers.at(i);
+        worker->stop();
+        worker->reap();
+        srs_freep(worker);
+    }
+}
+
+void SrsRtmpHandshakeWorkers::start_workers()
+{
+    srs_error_t err = srs_success;
+
+    srs_utime_t rotation = _srs_config->get_handshake_key_rotation();
+    srs_internal::srs_dh_set_rotation(rotation);
+
+    // Never offload the tasks if no reaper, or the coroutines wait for ever.
+    srs_freep(trd_);
+    trd_ = new SrsSTCoroutine("handshake", this);
+    if ((err = trd_->start()) != srs_success) {
+        srs_warn("RTMP: ignore start handshake reaper err %s", srs_error_desc(err).c_str());
+        srs_freep(err);
+        return;
+    }
+
+    int nn_workers = _srs_config->get_threads_handshake();
+    for (int i = 0; i < nn_workers; i++) {
+        SrsRtmpHandshakeWorker* worker = new SrsRtmpHandshakeWorker();
+
+        if ((err = worker->start()) != srs_success) {
+            srs_warn("RTMP: ignore start handshake worker err %s", srs_error_desc(err).c_str());
+            srs_freep(err);
+            srs_freep(worker);
+            break;
+        }
+
+        workers_.push_back(worker);
+    }
+
+    srs_trace("RTMP: start %d handshake workers, key rotation=%dms", (int)workers_.size(), srsu2msi(rotation));
+}
+
+srs_error_t SrsRtmpHandshakeWorkers::execute(SrsHandshakeBytes* hs_bytes)
+{
+    if (!started_) {
+        started_ = true;
+        start_workers();
+    }
+
+    // Handshake in ST thread, if no workers or not busy.
+    if (workers_.empty() || !_srs_circuit_breaker->hybrid_high_water_level()) {
+        return SrsComplexHandshake::create_s0s1s2(hs_bytes);
+    }
+
+    SrsRtmpHandshakeTask task(hs_bytes);
+    SrsRtmpHandshakeWorker* worker = workers_.at(next_++ % workers_.size());
+    if (!worker->post(&task)) {
+        return SrsComplexHandshake::create_s0s1s2(hs_bytes);
+    }
+
+    nn_inflight_++;
+    srs_cond_signal(wait_);
+
+    // Always wait for the task done even if coroutine is interrupted, because the task is on stack. It's fast
+    // because it's only about some milliseconds of CPU.
+    while (!task.done_) {
+        srs_cond_wait(task.cond_);
+    }
+
+    nn_inflight_--;
+    return task.err_;
+}
+
+srs_error_t SrsRtmpHandshakeWorkers::cycle()
+{
+    srs_error_t err = srs_success;
+
+    while (true) {
+        if ((err = trd_->pull()) != srs_success) {
+            return srs_error_wrap(err, "handshake reaper");
+        }
+
+        // Wait for the tasks in flight, signaled by the coroutine which posts the task.
+        if (!nn_inflight_) {
+            srs_cond_wait(wait_);
+            continue;
+        }
+
+        int nn = 0;
+        for (int i = 0; i < (int)workers_.size(); i++) {
+            SrsRtmpHandshakeWorker* worker = workers_.at(i);
+            nn += worker->reap();
+        }
+
+        if (!nn) {
+            srs_usleep(SRS_RTMP_HANDSHAKE_WAIT);
+        }
+    }
+
+    return err;
+}
+
+SrsRtmpHandshakeWorkers* _srs_rtmp_handshake_workers = new SrsRtmpHandshakeWorkers();
+
 SrsRtmpConn::SrsRtmpConn(SrsServer* svr, srs_netfd_t c, string cip, int cport)
 {
     // Create a identify for this client.
@@ -193,6 +454,7 @@ srs_error_t SrsRtmpConn::do_cycle()
 
     rtmp->set_recv_timeout(SRS_CONSTS_RTMP_TIMEOUT);
     rtmp->set_send_timeout(SRS_CONSTS_RTMP_TIMEOUT);
+    rtmp->set_handshake_executor(_srs_rtmp_handshake_workers);
 
     if ((err = rtmp->handshake()) != srs_success) {
         return srs_error_wrap(err, "rtmp handshake");
@@ -811,9 +1073,25 @@ srs_error_t SrsRtmpConn::do_playing(SrsSharedPtr<SrsLiveSource> source, SrsLiveC
     skt->set_socket_buffer(mw_sleep);
     // initialize the send_min_interval
     send_min_interval = _srs_config->get_send_min_interval(req->vhost);
+    // Tune the mw by the live bitrate, the configured mw_sleep is the latency target.
+    bool mw_adaptive = _srs_config->get_mw_adaptive(req->vhost);
+    SrsUniquePtr<SrsMergedIOTuner> tuner(new SrsMergedIOTuner(mw_sleep, mw_msgs));
+    int64_t nn_msgs = 0, tuned_msgs = 0;
+    srs_utime_t tuned_at = srs_get_system_time();
+
+    // Send the payload of messages by MSG_ZEROCOPY, which pins the messages until kernel notifies.
+    SrsZerocopySender* zc = NULL;
+    if (_srs_config->get_zerocopy(req->vhost)) {
+        if ((err = skt->enable_zerocopy(SRS_PERF_ZEROCOPY_MIN_BYTES)) != srs_success) {
+            srs_warn("ignore zerocopy err %s", srs_error_desc(err).c_str());
+            srs_freep(err);
+        } else {
+            zc = skt->zerocopy();
+        }
+    }
     
-    srs_trace("start play smi=%dms, mw_sleep=%d, mw_msgs=%d, realtime=%d, tcp_nodelay=%d",
-        srsu2msi(send_min_interval), srsu2msi(mw_sleep), mw_msgs, realtime, tcp_nodelay);
+    srs_trace("start play smi=%dms, mw_sleep=%d, mw_msgs=%d, realtime=%d, tcp_nodelay=%d, mw_adaptive=%d, zerocopy=%d",
+        srsu2msi(send_min_interval), srsu2msi(mw_sleep), mw_msgs, realtime, tcp_nodelay, mw_adaptive, (zc != NULL));
 
 #ifdef SRS_APM
     SrsUniquePtr<ISrsApmSpan> span(_srs_apm->span("play-cycle")->set_kind(SrsApmKindProducer)->as_child(span_client_)
@@ -863,6 +1141,31 @@ srs_error_t SrsRtmpConn::do_playing(SrsSharedPtr<SrsLiveSource> source, SrsLiveC
                 (int)pprint->age(), count, kbps->get_send_kbps(), kbps->get_send_kbps_30s(), kbps->get_send_kbps_5m(),
                 kbps->get_recv_kbps(), kbps->get_recv_kbps_30s(), kbps->get_recv_kbps_5m(), srsu2msi(mw_sleep), mw_msgs);
 
+            // Tune the mw by the send kbps and messages rate.
+            srs_utime_t now = srs_get_system_time();
+            int msgs_rate = now > tuned_at ? (int)((nn_msgs - tuned_msgs) * SRS_UTIME_SECONDS / (now - tuned_at)) : 0;
+            tuned_msgs = nn_msgs;
+            tuned_at = now;
+            if (mw_adaptive && !realtime && tuner->update(kbps->get_send_kbps_30s(), msgs_rate)) {
+                srs_trace("mw change sleep %d=>%d, msgs %d=>%d, sndbuf=%d, kbps=%d, msgs_rate=%d", srsu2msi(mw_sleep),
+                    srsu2msi(tuner->sleep()), mw_msgs, tuner->msgs(), tuner->buffer(), tuner->kbps(), msgs_rate);
+
+                mw_sleep = tuner->sleep();
+                mw_msgs = tuner->msgs();
+                if ((err = skt->set_socket_buffer_size(tuner->buffer())) != srs_success) {
+                    srs_warn("ignore set sndbuf err %s", srs_error_desc(err).c_str());
+                    srs_freep(err);
+                }
+
+                SrsStatistic* stat = SrsStatistic::instance();
+                stat->on_client_merged_io(get_id().c_str(), mw_sleep, tuner->buffer(), mw_msgs);
+            }
+
+            if (zc) {
+                SrsStatistic* stat = SrsStatistic::instance();
+                stat->on_client_zerocopy(get_id().c_str(), zc->pinned_bytes(), zc->zerocopy_bytes());
+            }
+
 #ifdef SRS_APM
             // TODO: Do not use pithy print for frame span.
             ISrsApmSpan* sample = _srs_apm->span("play-frame")->set_kind(SrsApmKindConsumer)->as_child(span.get())
@@ -897,9 +1200,18 @@ srs_error_t SrsRtmpConn::do_playing(SrsSharedPtr<SrsLiveSource> source, SrsLiveC
         
         // sendout messages, all messages are freed by send_and_free_messages().
         // no need to assert msg, for the rtmp will assert it.
-        if (count > 0 && (err = rtmp->send_and_free_messages(msgs.msgs, count, info->res->stream_id)) != srs_success) {
+        // @remark The messages are pinned for zero-copy, before they are freed.
+        if (zc) {
+            zc->pin(msgs.msgs, count);
+        }
+        err = rtmp->send_and_free_messages(msgs.msgs, count, info->res->stream_id);
+        if (zc) {
+            zc->unpin();
+        }
+        if (err != srs_success) {
             return srs_error_wrap(err, "rtmp: send %d messages", count);
         }
+        nn_msgs += count;
         
         // if duration specified, and exceed it, stop play live.
         // @see: https://github.com/ossrs/srs/issues/45
@@ -1047,6 +1359,8 @@ srs_error_t SrsRtmpConn::do_publishing(SrsSharedPtr<SrsLiveSource> source, SrsPu
         // reportable
         if (pprint->can_print()) {
             kbps->sample();
+            rtrd->update_merged_read(kbps->get_recv_kbps_30s());
+
             bool mr = _srs_config->get_mr_enabled(req->vhost);
             srs_utime_t mr_sleep = _srs_config->get_mr_sleep(req->vhost);
             srs_trace("<- " SRS_CONSTS_LOG_CLIENT_PUBLISH " time=%d, okbps=%d,%d,%d, ikbps=%d,%d,%d, mr=%d/%d, p1stpt=%d, pnt=%d",
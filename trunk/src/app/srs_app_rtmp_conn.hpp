@@ -10,12 +10,14 @@
 #include <srs_core.hpp>
 
 #include <string>
+#include <vector>
 
 #include <srs_app_st.hpp>
 #include <srs_app_conn.hpp>
 #include <srs_app_reload.hpp>
 #include <srs_protocol_rtmp_stack.hpp>
 #include <srs_protocol_rtmp_conn.hpp>
+#include <srs_protocol_rtmp_handshake.hpp>
 #include <srs_core_autofree.hpp>
 
 class SrsServer;
@@ -40,6 +42,11 @@ class SrsCommonMessage;
 class SrsPacket;
 class SrsNetworkDelta;
 class ISrsApmSpan;
+class SrsHandshakeBytes;
+class SrsThreadCond;
+class SrsThreadEntry;
+template<typename T>
+class SrsThreadQueue;
 
 // The simple rtmp client for SRS.
 class SrsSimpleRtmpClient : public SrsBasicRtmpClient
@@ -68,6 +75,90 @@ public:
     virtual ~SrsClientInfo();
 };
 
+// The task to create s0s1s2 of complex handshake in worker thread.
+class SrsRtmpHandshakeTask
+{
+public:
+    SrsHandshakeBytes* hs_bytes_;
+    // The result of task, set by worker thread.
+    srs_error_t err_;
+    // Whether task is done, set by ST thread when reaped from the done queue of worker.
+    bool done_;
+    // The ST coroutine waits on the condition, signaled when task is done.
+    srs_cond_t cond_;
+public:
+    SrsRtmpHandshakeTask(SrsHandshakeBytes* hs_bytes);
+    virtual ~SrsRtmpHandshakeTask();
+};
+
+// The worker thread to create s0s1s2 of complex handshake.
+class SrsRtmpHandshakeWorker
+{
+private:
+    // The tasks from ST thread to worker, which are owned by the ST coroutine.
+    SrsThreadQueue<SrsRtmpHandshakeTask*>* tasks_;
+    // The done tasks from worker to ST thread.
+    SrsThreadQueue<SrsRtmpHandshakeTask*>* done_;
+    // The number of tasks posted and not reaped, by ST thread.
+    int nn_inflight_;
+    // The worker waits on the condition when idle, signaled by ST thread.
+    SrsThreadCond* cond_;
+    int quit_;
+    SrsThreadEntry* entry_;
+public:
+    SrsRtmpHandshakeWorker();
+    virtual ~SrsRtmpHandshakeWorker();
+public:
+    // Post task to worker, by ST thread. Return false if queue is full.
+    bool post(SrsRtmpHandshakeTask* task);
+    // Execute all tasks once in worker thread, return the number of done tasks.
+    int consume();
+    // Reap the done tasks and wakeup the waiting coroutines, by ST thread. Return the number of reaped tasks.
+    int reap();
+    // Start the worker thread.
+    srs_error_t start();
+    // Stop and join the worker thread, after the left tasks are done.
+    void stop();
+    static srs_error_t start(void* arg);
+private:
+    srs_error_t cycle();
+};
+
+// The workers to create s0s1s2 of complex handshake, because the DH key and HMAC digests are CPU intensive, which
+// blocks the ST thread when lots of clients connect. The handshake is only offloaded when the ST thread is busy,
+// that is the circuit breaker is high water-level, to avoid the latency of thread switching. A coroutine reaps the
+// done tasks of all workers and wakes up the waiting coroutines, so the waiters never poll.
+class SrsRtmpHandshakeWorkers : public ISrsHandshakeExecutor, public ISrsCoroutineHandler
+{
+private:
+    bool started_;
+    std::vector<SrsRtmpHandshakeWorker*> workers_;
+    // The index of worker for next task, round robin.
+    uint32_t next_;
+    // The coroutine to reap the done tasks.
+    SrsCoroutine* trd_;
+    // The reaper waits on the condition when no task in flight.
+    srs_cond_t wait_;
+    // The number of coroutines waiting for tasks.
+    int nn_inflight_;
+public:
+    SrsRtmpHandshakeWorkers();
+    virtual ~SrsRtmpHandshakeWorkers();
+public:
+    // Stop all worker threads, and never start again.
+    void stop();
+private:
+    void start_workers();
+// Interface ISrsHandshakeExecutor
+public:
+    virtual srs_error_t execute(SrsHandshakeBytes* hs_bytes);
+// Interface ISrsCoroutineHandler
+public:
+    virtual srs_error_t cycle();
+};
+
+extern SrsRtmpHandshakeWorkers* _srs_rtmp_handshake_workers;
+
 // The client provides the main logic control for RTMP clients.
 class SrsRtmpConn : public ISrsConnection, public ISrsStartable, public ISrsReloadHandler
     , public ISrsCoroutineHandler, public ISrsExpire
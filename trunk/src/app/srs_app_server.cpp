@@ -699,7 +699,7 @@ srs_error_t SrsServer::http_handle()
 {
     srs_error_t err = srs_success;
 
-    // Ignore / and /api/v1/versions for already handled by HTTP server.
+    // Ignore /, /api/v1/versions and /api/v1/utc for already handled by HTTP server.
     if (!reuse_api_over_server_) {
         if ((err = http_api_mux->handle("/", new SrsGoApiRoot())) != srs_success) {
             return srs_error_wrap(err, "handle /");
@@ -707,6 +707,9 @@ srs_error_t SrsServer::http_handle()
         if ((err = http_api_mux->handle("/api/v1/versions", new SrsGoApiVersion())) != srs_success) {
             return srs_error_wrap(err, "handle versions");
         }
+        if ((err = http_api_mux->handle("/api/v1/utc", new SrsGoApiUtcTiming())) != srs_success) {
+            return srs_error_wrap(err, "handle utc");
+        }
     }
 
     if ((err = http_api_mux->handle("/api/", new SrsGoApiApi())) != srs_success) {
@@ -397,6 +397,383 @@ void SrsMessageQueue::clear()
     av_start_time = av_end_time = -1;
 }
 
+// The max delta of timestamp to increase the ring time, larger or negative delta is treat as a jump.
+#define SRS_RING_MAX_DELTA (3 * SRS_UTIME_SECONDS)
+
+SrsMessageRing::SrsMessageRing()
+{
+    head_ = 0;
+    max_duration_ = 0;
+    last_av_time_ = 0;
+    last_timestamp_ = -1;
+    meta_ = vsh_ = ash_ = NULL;
+}
+
+SrsMessageRing::~SrsMessageRing()
+{
+    clear();
+
+    // The cursors must be freed before ring.
+    srs_assert(cursors_.empty());
+}
+
+void SrsMessageRing::set_queue_size(srs_utime_t queue_size)
+{
+    max_duration_ = queue_size;
+}
+
+void SrsMessageRing::push(SrsSharedPtrMessage* msg)
+{
+    // Cache the metadata and sequence headers, for cursor to restart.
+    if (msg->is_video() && SrsFlvVideo::sh(msg->payload, msg->size)) {
+        srs_freep(vsh_);
+        vsh_ = msg->copy();
+    } else if (msg->is_audio() && SrsFlvAudio::sh(msg->payload, msg->size)) {
+        srs_freep(ash_);
+        ash_ = msg->copy();
+    } else if (!msg->is_av()) {
+        // Only the metadata is not audio or video message.
+        srs_freep(meta_);
+        meta_ = msg->copy();
+    }
+
+    // Whether stream time jumps backward, for example, republish or ATC.
+    bool jump_backward = false;
+    if (msg->is_av()) {
+        srs_utime_t msg_time = srs_utime_t(msg->timestamp * SRS_UTIME_MILLISECONDS);
+        srs_utime_t delta = msg_time - last_timestamp_;
+        jump_backward = last_timestamp_ >= 0 && delta < 0;
+
+        // Like the jitter correction, use the default frame time if the timestamp jumps.
+        if (last_timestamp_ < 0) {
+            delta = 0;
+        } else if (delta < 0 || delta > SRS_RING_MAX_DELTA) {
+            delta = DEFAULT_FRAME_TIME_MS * SRS_UTIME_MILLISECONDS;
+        }
+        last_timestamp_ = msg_time;
+        last_av_time_ += delta;
+    }
+
+    // Never keep the message if no cursor.
+    if (cursors_.empty()) {
+        head_++;
+        return;
+    }
+
+    // Free the messages consumed by all cursors, once for each message, so the cost of cursor to dump packets is
+    // not about the number of cursors.
+    gc();
+
+    msgs_.push_back(msg->copy());
+    times_.push_back(last_av_time_);
+
+    // If some cursor is too slow to consume the ring, drop it by GOP, to keep the ring in bound. Note that the
+    // cursor drops itself when dumping packets, so we only drop it when it lags behind twice of max duration.
+    if (max_duration_ > 0) {
+        if (msgs_.front()->is_av() && last_av_time_ - times_.front() > 2 * max_duration_) {
+            shrink(max_duration_);
+        }
+    }
+
+    if (!waiters_.empty() && msg->is_av()) {
+        notify(jump_backward);
+    }
+}
+
+uint64_t SrsMessageRing::tail()
+{
+    return head_ + msgs_.size();
+}
+
+int SrsMessageRing::size()
+{
+    return (int)msgs_.size();
+}
+
+SrsSharedPtrMessage* SrsMessageRing::meta()
+{
+    return meta_;
+}
+
+SrsSharedPtrMessage* SrsMessageRing::vsh()
+{
+    return vsh_;
+}
+
+SrsSharedPtrMessage* SrsMessageRing::ash()
+{
+    return ash_;
+}
+
+void SrsMessageRing::clear()
+{
+    std::deque<SrsSharedPtrMessage*>::iterator it;
+    for (it = msgs_.begin(); it != msgs_.end(); ++it) {
+        SrsSharedPtrMessage* msg = *it;
+        srs_freep(msg);
+    }
+
+    head_ += msgs_.size();
+    msgs_.clear();
+    times_.clear();
+    last_timestamp_ = -1;
+
+    srs_freep(meta_);
+    srs_freep(vsh_);
+    srs_freep(ash_);
+
+    for (int i = 0; i < (int)cursors_.size(); i++) {
+        SrsMessageRingCursor* cursor = cursors_.at(i);
+        cursor->seq_ = head_;
+    }
+}
+
+void SrsMessageRing::on_cursor_create(SrsMessageRingCursor* cursor)
+{
+    cursors_.push_back(cursor);
+}
+
+void SrsMessageRing::on_cursor_destroy(SrsMessageRingCursor* cursor)
+{
+    std::vector<SrsMessageRingCursor*>::iterator it = std::find(cursors_.begin(), cursors_.end(), cursor);
+    if (it != cursors_.end()) {
+        cursors_.erase(it);
+    }
+
+    gc();
+}
+
+void SrsMessageRing::notify(bool all)
+{
+    while (!waiters_.empty()) {
+        std::multimap<srs_utime_t, SrsMessageRingCursor*>::iterator it = waiters_.begin();
+        if (!all && it->first > last_av_time_) {
+            break;
+        }
+
+        SrsMessageRingCursor* cursor = it->second;
+        waiters_.erase(it);
+
+        ISrsWakable* waiter = cursor->waiter_;
+        cursor->waiter_ = NULL;
+        waiter->wakeup();
+    }
+}
+
+SrsSharedPtrMessage* SrsMessageRing::at(uint64_t seq)
+{
+    if (seq < head_ || seq >= tail()) {
+        return NULL;
+    }
+    return msgs_.at(seq - head_);
+}
+
+srs_utime_t SrsMessageRing::time_at(uint64_t seq)
+{
+    return times_.at(seq - head_);
+}
+
+uint64_t SrsMessageRing::seek_keyframe(uint64_t seq, srs_utime_t duration)
+{
+    uint64_t first_av = tail();
+
+    for (seq = srs_max(seq, head_); seq < tail(); seq++) {
+        SrsSharedPtrMessage* msg = msgs_.at(seq - head_);
+        if (!msg->is_av()) {
+            continue;
+        }
+
+        if (last_av_time_ - time_at(seq) > duration) {
+            continue;
+        }
+
+        if (first_av == tail()) {
+            first_av = seq;
+        }
+
+        if (msg->is_video() && SrsFlvVideo::keyframe(msg->payload, msg->size) && !SrsFlvVideo::sh(msg->payload, msg->size)) {
+            return seq;
+        }
+    }
+
+    // For pure audio stream, start from the first audio in duration. Otherwise, wait for the next keyframe.
+    return vsh_ ? tail() : first_av;
+}
+
+void SrsMessageRing::shrink(srs_utime_t duration)
+{
+    for (int i = 0; i < (int)cursors_.size(); i++) {
+        SrsMessageRingCursor* cursor = cursors_.at(i);
+
+        SrsSharedPtrMessage* msg = at(cursor->seq_);
+        if (!msg || !msg->is_av()) {
+            continue;
+        }
+
+        if (last_av_time_ - time_at(cursor->seq_) <= duration) {
+            continue;
+        }
+
+        uint64_t seq = seek_keyframe(cursor->seq_, duration);
+        cursor->nn_dropped_ += seq - cursor->seq_;
+        cursor->seq_ = seq;
+        cursor->sh_required_ = true;
+    }
+
+    gc();
+}
+
+void SrsMessageRing::gc()
+{
+    uint64_t min_seq = tail();
+    for (int i = 0; i < (int)cursors_.size(); i++) {
+        SrsMessageRingCursor* cursor = cursors_.at(i);
+        min_seq = srs_min(min_seq, cursor->seq_);
+    }
+
+    while (head_ < min_seq && !msgs_.empty()) {
+        SrsSharedPtrMessage* msg = msgs_.front();
+        srs_freep(msg);
+
+        msgs_.pop_front();
+        times_.pop_front();
+        head_++;
+    }
+}
+
+SrsMessageRingCursor::SrsMessageRingCursor(SrsMessageRing* ring)
+{
+    ring_ = ring;
+    seq_ = ring->tail();
+    sh_required_ = false;
+    nn_dropped_ = 0;
+    waiter_ = NULL;
+    wait_until_ = 0;
+
+    ring_->on_cursor_create(this);
+}
+
+SrsMessageRingCursor::~SrsMessageRingCursor()
+{
+    cancel_wait();
+    ring_->on_cursor_destroy(this);
+}
+
+int SrsMessageRingCursor::size()
+{
+    return (int)(ring_->tail() - srs_max(seq_, ring_->head_));
+}
+
+srs_utime_t SrsMessageRingCursor::duration()
+{
+    for (uint64_t seq = srs_max(seq_, ring_->head_); seq < ring_->tail(); seq++) {
+        SrsSharedPtrMessage* msg = ring_->at(seq);
+        if (msg->is_av()) {
+            return ring_->last_av_time_ - ring_->time_at(seq);
+        }
+    }
+    return 0;
+}
+
+uint64_t SrsMessageRingCursor::nn_dropped()
+{
+    return nn_dropped_;
+}
+
+void SrsMessageRingCursor::request_sh()
+{
+    sh_required_ = true;
+}
+
+srs_error_t SrsMessageRingCursor::dump_packets(int max_count, SrsSharedPtrMessage** pmsgs, int& count)
+{
+    srs_error_t err = srs_success;
+
+    srs_assert(max_count > 0);
+    count = 0;
+
+    // The ring is cleared or shrinked, restart from the head.
+    if (seq_ < ring_->head_) {
+        nn_dropped_ += ring_->head_ - seq_;
+        seq_ = ring_->head_;
+    }
+
+    // Drop the whole GOP if lag behind.
+    SrsSharedPtrMessage* first = ring_->at(seq_);
+    if (ring_->max_duration_ > 0 && first && first->is_av()) {
+        srs_utime_t first_time = ring_->time_at(seq_);
+        if (ring_->last_av_time_ - first_time > ring_->max_duration_) {
+            uint64_t seq = ring_->seek_keyframe(seq_, ring_->max_duration_);
+            srs_trace("ring cursor drop %d msgs, lag=%dms, max=%dms", (int)(seq - seq_),
+                srsu2msi(ring_->last_av_time_ - first_time), srsu2msi(ring_->max_duration_));
+
+            nn_dropped_ += seq - seq_;
+            seq_ = seq;
+            sh_required_ = true;
+        }
+    }
+
+    // Resend the metadata and sequence headers, with the timestamp of next message.
+    if (sh_required_ && max_count >= 3) {
+        SrsSharedPtrMessage* next = ring_->at(seq_);
+        SrsSharedPtrMessage* cached[] = {ring_->meta_, ring_->vsh_, ring_->ash_};
+        for (int i = 0; i < 3; i++) {
+            if (!cached[i]) {
+                continue;
+            }
+
+            SrsSharedPtrMessage* msg = cached[i]->copy();
+            if (next) {
+                msg->timestamp = next->timestamp;
+            }
+            pmsgs[count++] = msg;
+        }
+        sh_required_ = false;
+    }
+
+    while (count < max_count && seq_ < ring_->tail()) {
+        SrsSharedPtrMessage* msg = ring_->at(seq_++);
+        pmsgs[count++] = msg->copy();
+    }
+
+    return err;
+}
+
+void SrsMessageRingCursor::wait(ISrsWakable* waiter, srs_utime_t duration)
+{
+    cancel_wait();
+
+    // Start from the first message to read, or the latest message if no message.
+    srs_utime_t start = ring_->last_av_time_;
+    for (uint64_t seq = srs_max(seq_, ring_->head_); seq < ring_->tail(); seq++) {
+        SrsSharedPtrMessage* msg = ring_->at(seq);
+        if (msg->is_av()) {
+            start = ring_->time_at(seq);
+            break;
+        }
+    }
+
+    waiter_ = waiter;
+    wait_until_ = start + duration;
+    ring_->waiters_.insert(std::make_pair(wait_until_, this));
+}
+
+void SrsMessageRingCursor::cancel_wait()
+{
+    if (!waiter_) {
+        return;
+    }
+    waiter_ = NULL;
+
+    std::multimap<srs_utime_t, SrsMessageRingCursor*>::iterator it = ring_->waiters_.lower_bound(wait_until_);
+    for (; it != ring_->waiters_.end() && it->first == wait_until_; ++it) {
+        if (it->second == this) {
+            ring_->waiters_.erase(it);
+            break;
+        }
+    }
+}
+
 ISrsWakable::ISrsWakable()
 {
 }
@@ -411,6 +788,7 @@ SrsLiveConsumer::SrsLiveConsumer(SrsLiveSource* s)
     paused = false;
     jitter = new SrsRtmpJitter();
     queue = new SrsMessageQueue();
+    cursor = new SrsMessageRingCursor(s->ring);
     should_update_source_id = false;
     
 #ifdef SRS_PERF_QUEUE_COND_WAIT
@@ -426,6 +804,7 @@ SrsLiveConsumer::~SrsLiveConsumer()
     source_->on_consumer_destroy(this);
     srs_freep(jitter);
     srs_freep(queue);
+    srs_freep(cursor);
     
 #ifdef SRS_PERF_QUEUE_COND_WAIT
     srs_cond_destroy(mw_wait);
@@ -464,28 +843,8 @@ srs_error_t SrsLiveConsumer::enqueue(SrsSharedPtrMessage* shared_msg, bool atc,
     }
     
 #ifdef SRS_PERF_QUEUE_COND_WAIT
-    // fire the mw when msgs is enough.
-    if (mw_waiting) {
-        // For RTMP, we wait for messages and duration.
-        srs_utime_t duration = queue->duration();
-        bool match_min_msgs = queue->size() > mw_min_msgs;
-        
-        // For ATC, maybe the SH timestamp bigger than A/V packet,
-        // when encoder republish or overflow.
-        // @see https://github.com/ossrs/srs/pull/749
-        if (atc && duration < 0) {
-            srs_cond_signal(mw_wait);
-            mw_waiting = false;
-            return err;
-        }
-        
-        // when duration ok, signal to flush.
-        if (match_min_msgs && duration > mw_duration) {
-            srs_cond_signal(mw_wait);
-            mw_waiting = false;
-            return err;
-        }
-    }
+    // fire the mw, because never wait when there are messages in queue.
+    wakeup();
 #endif
     
     return err;
@@ -520,6 +879,28 @@ srs_error_t SrsLiveConsumer::dump_packets(SrsMessageArray* msgs, int& count)
         return srs_error_wrap(err, "dump packets");
     }
     
+    if (count >= max) {
+        return err;
+    }
+    
+    // pump msgs from ring, then correct the timestamp for this consumer.
+    int nn = 0;
+    SrsSharedPtrMessage** pmsgs = msgs->msgs + count;
+    if ((err = cursor->dump_packets(max - count, pmsgs, nn)) != srs_success) {
+        return srs_error_wrap(err, "dump ring");
+    }
+    count += nn;
+    
+    if (source_->atc) {
+        return err;
+    }
+    
+    for (int i = 0; i < nn; i++) {
+        if ((err = jitter->correct(pmsgs[i], source_->jitter_algorithm)) != srs_success) {
+            return srs_error_wrap(err, "consume message");
+        }
+    }
+    
     return err;
 }
 
@@ -534,19 +915,28 @@ void SrsLiveConsumer::wait(int nb_msgs, srs_utime_t msgs_duration)
     mw_min_msgs = nb_msgs;
     mw_duration = msgs_duration;
     
-    srs_utime_t duration = queue->duration();
-    bool match_min_msgs = queue->size() > mw_min_msgs;
+    // Never wait if there are messages dumped by source, such as the gop cache.
+    if (queue->size() > 0) {
+        return;
+    }
+    
+    srs_utime_t duration = cursor->duration();
+    bool match_min_msgs = cursor->size() > mw_min_msgs;
     
     // when duration ok, signal to flush.
     if (match_min_msgs && duration > mw_duration) {
         return;
     }
     
-    // the enqueue will notify this cond.
+    // the ring will notify this cond, when got enough messages in duration.
     mw_waiting = true;
+    cursor->wait(this, mw_duration);
     
     // use cond block wait for high performance mode.
     srs_cond_wait(mw_wait);
+    
+    // We might be waked up by others, such as the recv thread.
+    cursor->cancel_wait();
 }
 #endif
 
@@ -834,6 +1224,7 @@ SrsOriginHub::SrsOriginHub()
     hds = new SrsHds();
 #endif
     ng_exec = new SrsNgExec();
+    forward_ring = new SrsMessageRing();
     
     _srs_config->subscribe(this);
 }
@@ -850,6 +1241,8 @@ SrsOriginHub::~SrsOriginHub()
         }
         forwarders.clear();
     }
+    // Free the ring after forwarders, which hold the cursors of ring.
+    srs_freep(forward_ring);
     srs_freep(ng_exec);
 
     srs_freep(hls);
@@ -921,16 +1314,8 @@ srs_error_t SrsOriginHub::on_meta_data(SrsSharedPtrMessage* shared_metadata, Srs
 {
     srs_error_t err = srs_success;
     
-    // copy to all forwarders
-    if (true) {
-        std::vector<SrsForwarder*>::iterator it;
-        for (it = forwarders.begin(); it != forwarders.end(); ++it) {
-            SrsForwarder* forwarder = *it;
-            if ((err = forwarder->on_meta_data(shared_metadata)) != srs_success) {
-                return srs_error_wrap(err, "Forwarder consume metadata");
-            }
-        }
-    }
+    // Push to ring once for all forwarders.
+    forward_ring->push(shared_metadata);
     
     if ((err = dvr->on_meta_data(shared_metadata)) != srs_success) {
         return srs_error_wrap(err, "DVR consume metadata");
@@ -1011,16 +1396,8 @@ srs_error_t SrsOriginHub::on_audio(SrsSharedPtrMessage* shared_audio)
     }
 #endif
     
-    // copy to all forwarders.
-    if (true) {
-        std::vector<SrsForwarder*>::iterator it;
-        for (it = forwarders.begin(); it != forwarders.end(); ++it) {
-            SrsForwarder* forwarder = *it;
-            if ((err = forwarder->on_audio(msg)) != srs_success) {
-                return srs_error_wrap(err, "forward: audio");
-            }
-        }
-    }
+    // Push to ring once for all forwarders.
+    forward_ring->push(msg);
     
     return err;
 }
@@ -1104,16 +1481,8 @@ srs_error_t SrsOriginHub::on_video(SrsSharedPtrMessage* shared_video, bool is_se
     }
 #endif
     
-    // copy to all forwarders.
-    if (!forwarders.empty()) {
-        std::vector<SrsForwarder*>::iterator it;
-        for (it = forwarders.begin(); it != forwarders.end(); ++it) {
-            SrsForwarder* forwarder = *it;
-            if ((err = forwarder->on_video(msg)) != srs_success) {
-                return srs_error_wrap(err, "forward video");
-            }
-        }
-    }
+    // Push to ring once for all forwarders.
+    forward_ring->push(msg);
     
     return err;
 }
@@ -1168,6 +1537,7 @@ void SrsOriginHub::on_unpublish()
     
     // destroy all forwarders
     destroy_forwarders();
+    forward_ring->clear();
     
     encoder->on_unpublish();
     hls->on_unpublish();
@@ -1181,29 +1551,6 @@ void SrsOriginHub::on_unpublish()
     ng_exec->on_unpublish();
 }
 
-srs_error_t SrsOriginHub::on_forwarder_start(SrsForwarder* forwarder)
-{
-    srs_error_t err = srs_success;
-    
-    SrsSharedPtrMessage* cache_metadata = source_->meta->data();
-    SrsSharedPtrMessage* cache_sh_video = source_->meta->vsh();
-    SrsSharedPtrMessage* cache_sh_audio = source_->meta->ash();
-    
-    // feed the forwarder the metadata/sequence header,
-    // when reload to enable the forwarder.
-    if (cache_metadata && (err = forwarder->on_meta_data(cache_metadata)) != srs_success) {
-        return srs_error_wrap(err, "forward metadata");
-    }
-    if (cache_sh_video && (err = forwarder->on_video(cache_sh_video)) != srs_success) {
-        return srs_error_wrap(err, "forward video sh");
-    }
-    if (cache_sh_audio && (err = forwarder->on_audio(cache_sh_audio)) != srs_success) {
-        return srs_error_wrap(err, "forward audio sh");
-    }
-    
-    return err;
-}
-
 srs_error_t SrsOriginHub::on_dvr_request_sh()
 {
     srs_error_t err = srs_success;
@@ -1463,6 +1810,9 @@ srs_error_t SrsOriginHub::create_forwarders()
         return err;
     }
 
+    // All forwarders read the same ring, drop by GOP if lag behind.
+    forward_ring->set_queue_size(_srs_config->get_queue_length(req_->vhost));
+
     // For backend config
     // If backend is enabled and applied, ignore destination.
     bool applied_backend_server = false;
@@ -1480,16 +1830,13 @@ srs_error_t SrsOriginHub::create_forwarders()
     for (int i = 0; conf && i < (int)conf->args.size(); i++) {
         std::string forward_server = conf->args.at(i);
         
-        SrsForwarder* forwarder = new SrsForwarder(this);
+        SrsForwarder* forwarder = new SrsForwarder(forward_ring);
         forwarders.push_back(forwarder);
         
         // initialize the forwarder with request.
         if ((err = forwarder->initialize(req_, forward_server)) != srs_success) {
             return srs_error_wrap(err, "init forwarder");
         }
-
-        srs_utime_t queue_size = _srs_config->get_queue_length(req_->vhost);
-        forwarder->set_queue_size(queue_size);
         
         if ((err = forwarder->on_publish()) != srs_success) {
             return srs_error_wrap(err, "start forwarder failed, vhost=%s, app=%s, stream=%s, forward-to=%s",
@@ -1535,7 +1882,7 @@ srs_error_t SrsOriginHub::create_backend_forwarders(bool& applied)
         srs_discovery_tc_url(req->tcUrl, req->schema, req->host, req->vhost, req->app, req->stream, req->port, req->param);
 
         // create forwarder
-        SrsForwarder* forwarder = new SrsForwarder(this);
+        SrsForwarder* forwarder = new SrsForwarder(forward_ring);
         forwarders.push_back(forwarder);
 
         std::stringstream forward_server;
@@ -1546,9 +1893,6 @@ srs_error_t SrsOriginHub::create_backend_forwarders(bool& applied)
             return srs_error_wrap(err, "init backend forwarder failed, forward-to=%s", forward_server.str().c_str());
         }
 
-        srs_utime_t queue_size = _srs_config->get_queue_length(req_->vhost);
-        forwarder->set_queue_size(queue_size);
-
         if ((err = forwarder->on_publish()) != srs_success) {
             return srs_error_wrap(err, "start backend forwarder failed, vhost=%s, app=%s, stream=%s, forward-to=%s",
                 req_->vhost.c_str(), req_->app.c_str(), req_->stream.c_str(), forward_server.str().c_str());
@@ -1896,6 +2240,7 @@ SrsLiveSource::SrsLiveSource()
     play_edge = new SrsPlayEdge();
     publish_edge = new SrsPublishEdge();
     gop_cache = new SrsGopCache();
+    ring = new SrsMessageRing();
     hub = new SrsOriginHub();
     meta = new SrsMetaCache();
     format_ = new SrsRtmpFormat();
@@ -1923,6 +2268,7 @@ SrsLiveSource::~SrsLiveSource()
     srs_freep(play_edge);
     srs_freep(publish_edge);
     srs_freep(gop_cache);
+    srs_freep(ring);
     
     srs_freep(req);
     srs_freep(bridge_);
@@ -2019,6 +2365,7 @@ srs_error_t SrsLiveSource::initialize(SrsSharedPtr<SrsLiveSource> wrapper, SrsRe
     
     srs_utime_t queue_size = _srs_config->get_queue_length(req->vhost);
     publish_edge->set_queue_size(queue_size);
+    ring->set_queue_size(queue_size);
     
     jitter_algorithm = (SrsRtmpJitterAlgorithm)_srs_config->get_time_jitter(req->vhost);
     mix_correct = _srs_config->get_mix_correct(req->vhost);
@@ -2088,6 +2435,7 @@ srs_error_t SrsLiveSource::on_reload_vhost_play(string vhost)
                 SrsLiveConsumer* consumer = *it;
                 consumer->set_queue_size(v);
             }
+            ring->set_queue_size(v);
             
             srs_trace("consumers reload queue size success.");
         }
@@ -2205,15 +2553,9 @@ srs_error_t SrsLiveSource::on_meta_data(SrsCommonMessage* msg, SrsOnMetaDataPack
         srs_warn("drop for reduce sh metadata, size=%d", msg->size);
     }
     
-    // copy to all consumer
+    // Push to ring once for all consumers.
     if (!drop_for_reduce) {
-        std::vector<SrsLiveConsumer*>::iterator it;
-        for (it = consumers.begin(); it != consumers.end(); ++it) {
-            SrsLiveConsumer* consumer = *it;
-            if ((err = consumer->enqueue(meta->data(), atc, jitter_algorithm)) != srs_success) {
-                return srs_error_wrap(err, "consume metadata");
-            }
-        }
+        ring->push(meta->data());
     }
     
     // Copy to hub to all utilities.
@@ -2314,14 +2656,9 @@ srs_error_t SrsLiveSource::on_audio_imp(SrsSharedPtrMessage* msg)
         return srs_error_wrap(err, "bridge consume audio");
     }
 
-    // copy to all consumer
+    // Push to ring once for all consumers.
     if (!drop_for_reduce) {
-        for (int i = 0; i < (int)consumers.size(); i++) {
-            SrsLiveConsumer* consumer = consumers.at(i);
-            if ((err = consumer->enqueue(msg, atc, jitter_algorithm)) != srs_success) {
-                return srs_error_wrap(err, "consume message");
-            }
-        }
+        ring->push(msg);
     }
     
     // Refresh the sequence header in metadata.
@@ -2437,14 +2774,9 @@ srs_error_t SrsLiveSource::on_video_imp(SrsSharedPtrMessage* msg)
         return srs_error_wrap(err, "bridge consume video");
     }
 
-    // copy to all consumer
+    // Push to ring once for all consumers.
     if (!drop_for_reduce) {
-        for (int i = 0; i < (int)consumers.size(); i++) {
-            SrsLiveConsumer* consumer = consumers.at(i);
-            if ((err = consumer->enqueue(msg, atc, jitter_algorithm)) != srs_success) {
-                return srs_error_wrap(err, "consume video");
-            }
-        }
+        ring->push(msg);
     }
     
     // when sequence header, donot push to gop cache and adjust the timestamp.
@@ -2625,6 +2957,8 @@ void SrsLiveSource::on_unpublish()
     // donot clear the sequence header, for it maybe not changed,
     // when drop dup sequence header, drop the metadata also.
     gop_cache->clear();
+    // Clear the ring, to drop the messages of previous stream, and the cursors restart from the new stream.
+    ring->clear();
 
     // Reset the metadata cache, to make VLC happy when disable/enable stream.
     // @see https://github.com/ossrs/srs/issues/1630#issuecomment-597979448
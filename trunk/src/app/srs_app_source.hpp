@@ -11,6 +11,7 @@
 
 #include <map>
 #include <vector>
+#include <deque>
 #include <string>
 
 #include <srs_app_st.hpp>
@@ -152,6 +153,110 @@ public:
     virtual void clear();
 };
 
+class SrsMessageRingCursor;
+class ISrsWakable;
+
+// The shared ring of messages for a source, the readers such as consumers read it by cursor,
+// so the publisher only push a message once whatever the number of readers, and the message
+// is freed when all cursors consumed it. A lagging cursor is dropped by GOP.
+class SrsMessageRing
+{
+    friend class SrsMessageRingCursor;
+private:
+    // The messages in ring, the sequence of front is head_.
+    std::deque<SrsSharedPtrMessage*> msgs_;
+    // The ring time of each message, to calculate the lag of cursor.
+    std::deque<srs_utime_t> times_;
+    uint64_t head_;
+    // The cursors reading the ring, not owned by ring.
+    std::vector<SrsMessageRingCursor*> cursors_;
+    // The cursors waiting for messages, sorted by the time to wakeup.
+    std::multimap<srs_utime_t, SrsMessageRingCursor*> waiters_;
+    // The max duration of a cursor lags behind, drop the whole gop if exceed it.
+    srs_utime_t max_duration_;
+    // The ring time of the last av message, in srs_utime_t. It's monotonic, increased by the delta of timestamp,
+    // so the lag never goes negative when the timestamp jumps, for example, republish or timestamp reset.
+    srs_utime_t last_av_time_;
+    // The timestamp of the last av message, in srs_utime_t.
+    srs_utime_t last_timestamp_;
+private:
+    // The latest metadata and sequence headers, for cursor to resend when dropped.
+    SrsSharedPtrMessage* meta_;
+    SrsSharedPtrMessage* vsh_;
+    SrsSharedPtrMessage* ash_;
+public:
+    SrsMessageRing();
+    virtual ~SrsMessageRing();
+public:
+    // Set the max duration of a cursor lags behind.
+    virtual void set_queue_size(srs_utime_t queue_size);
+    // Push the message, copy it if any cursor and never free it. The messages consumed by all cursors are freed
+    // before pushing.
+    virtual void push(SrsSharedPtrMessage* msg);
+    // The sequence of next message to push.
+    virtual uint64_t tail();
+    // Get the number of messages in ring.
+    virtual int size();
+    // Get the latest metadata and sequence headers, NULL if not exists.
+    virtual SrsSharedPtrMessage* meta();
+    virtual SrsSharedPtrMessage* vsh();
+    virtual SrsSharedPtrMessage* ash();
+    // Free all messages and sequence headers, all cursors restart from tail.
+    virtual void clear();
+private:
+    void on_cursor_create(SrsMessageRingCursor* cursor);
+    void on_cursor_destroy(SrsMessageRingCursor* cursor);
+    // Wakeup the waiting cursors, all if stream time jumps backward.
+    void notify(bool all);
+    // Get the message by sequence, NULL if out of ring.
+    SrsSharedPtrMessage* at(uint64_t seq);
+    // Get the ring time of message by sequence, the seq must be in ring.
+    srs_utime_t time_at(uint64_t seq);
+    // Find the sequence of first keyframe from seq, the whole gop is in duration, tail() if not found.
+    uint64_t seek_keyframe(uint64_t seq, srs_utime_t duration);
+    // Drop the cursors lagging behind, and free the messages consumed by all cursors.
+    void shrink(srs_utime_t duration);
+    void gc();
+};
+
+// The cursor to read the shared ring, each reader holds a cursor.
+class SrsMessageRingCursor
+{
+    friend class SrsMessageRing;
+private:
+    SrsMessageRing* ring_;
+    // The sequence of next message to read.
+    uint64_t seq_;
+    // Whether should resend the metadata and sequence headers, for example, dropped by GOP.
+    bool sh_required_;
+    // The number of dropped messages.
+    uint64_t nn_dropped_;
+    // The waiter to wakeup when ring got enough messages, NULL if not waiting.
+    ISrsWakable* waiter_;
+    srs_utime_t wait_until_;
+public:
+    // Create the cursor at the tail of ring, the ring must outlive the cursor.
+    SrsMessageRingCursor(SrsMessageRing* ring);
+    virtual ~SrsMessageRingCursor();
+public:
+    // Get the number of messages to read.
+    virtual int size();
+    // Get the duration of messages to read.
+    virtual srs_utime_t duration();
+    // Get the number of dropped messages.
+    virtual uint64_t nn_dropped();
+    // Resend the metadata and sequence headers before next message, for example, when reconnected.
+    virtual void request_sh();
+    // Get packets from ring, the message is copied, user must free it.
+    // @max_count the max count to dequeue, must be positive.
+    virtual srs_error_t dump_packets(int max_count, SrsSharedPtrMessage** pmsgs, int& count);
+    // Wakeup the waiter when the duration of messages to read exceed the duration.
+    // @remark The ring only compares the time, so the cost of publisher is not about the number of waiters.
+    virtual void wait(ISrsWakable* waiter, srs_utime_t duration);
+    // Stop waiting, for example, the waiter is waked up by others.
+    virtual void cancel_wait();
+};
+
 // The wakable used for some object
 // which is waiting on cond.
 class ISrsWakable
@@ -174,7 +279,10 @@ private:
     SrsLiveSource* source_;
 private:
     SrsRtmpJitter* jitter;
+    // The messages dumped when consumer created, such as the sequence headers and gop cache.
     SrsMessageQueue* queue;
+    // The cursor to read the shared ring of source, the jitter is corrected when dumping.
+    SrsMessageRingCursor* cursor;
     bool paused;
     // when source id changed, notice all consumers
     bool should_update_source_id;
@@ -196,7 +304,7 @@ public:
 public:
     // Get current client time, the last packet time.
     virtual int64_t get_time();
-    // Enqueue an shared ptr message.
+    // Enqueue an shared ptr message, which is sent before the messages in ring.
     // @param shared_msg, directly ptr, copy it if need to save it.
     // @param whether atc, donot use jitter correct if true.
     // @param ag the algorithm of time jitter.
@@ -340,6 +448,8 @@ private:
     SrsNgExec* ng_exec;
     // To forward stream to other servers
     std::vector<SrsForwarder*> forwarders;
+    // The shared messages for all forwarders, each forwarder reads it by cursor.
+    SrsMessageRing* forward_ring;
 public:
     SrsOriginHub();
     virtual ~SrsOriginHub();
@@ -371,8 +481,6 @@ public:
     virtual void on_unpublish();
 // Internal callback.
 public:
-    // For the SrsForwarder to callback to request the sequence headers.
-    virtual srs_error_t on_forwarder_start(SrsForwarder* forwarder);
     // For the SrsDvr to callback to request the sequence headers.
     virtual srs_error_t on_dvr_request_sh();
     // For the SrsHls to callback to request the sequence headers.
@@ -485,6 +593,7 @@ extern SrsLiveSourceManager* _srs_sources;
 class SrsLiveSource : public ISrsReloadHandler
 {
     friend class SrsOriginHub;
+    friend class SrsLiveConsumer;
 private:
     // For publish, it's the publish client id.
     // For edge, it's the edge ingest id.
@@ -497,6 +606,8 @@ private:
     SrsRequest* req;
     // To delivery stream to clients.
     std::vector<SrsLiveConsumer*> consumers;
+    // The shared messages for all consumers, each consumer reads it by cursor.
+    SrsMessageRing* ring;
     // The time jitter algorithm for vhost.
     SrsRtmpJitterAlgorithm jitter_algorithm;
     // For play, whether use interlaced/mixed algorithm to correct timestamp.
@@ -7,6 +7,7 @@
 #include <srs_app_statistic.hpp>
 
 #include <unistd.h>
+#include <string.h>
 #include <sstream>
 using namespace std;
 
@@ -93,6 +94,13 @@ SrsStatisticStream::SrsStatisticStream()
     aac_object = SrsAacObjectTypeReserved;
     width = 0;
     height = 0;
+
+    has_jitter = false;
+    jitter_delay = 0;
+    jitter_late = jitter_discard = 0;
+    has_transcode = false;
+    transcode_cpu = 0;
+    transcode_frames = transcode_drops = 0;
     
     kbps = new SrsKbps();
 
@@ -106,71 +114,84 @@ SrsStatisticStream::~SrsStatisticStream()
     srs_freep(frames);
 }
 
-srs_error_t SrsStatisticStream::dumps(SrsJsonObject* obj)
+srs_error_t SrsStatisticStream::dumps(SrsJsonWriter* w)
 {
     srs_error_t err = srs_success;
     
-    obj->set("id", SrsJsonAny::str(id.c_str()));
-    obj->set("name", SrsJsonAny::str(stream.c_str()));
-    obj->set("vhost", SrsJsonAny::str(vhost->id.c_str()));
-    obj->set("app", SrsJsonAny::str(app.c_str()));
-    obj->set("tcUrl", SrsJsonAny::str(tcUrl.c_str()));
-    obj->set("url", SrsJsonAny::str(url.c_str()));
-    obj->set("live_ms", SrsJsonAny::integer(srsu2ms(srs_get_system_time())));
-    obj->set("clients", SrsJsonAny::integer(nb_clients));
-    obj->set("frames", SrsJsonAny::integer(frames->sugar));
-    obj->set("send_bytes", SrsJsonAny::integer(kbps->get_send_bytes()));
-    obj->set("recv_bytes", SrsJsonAny::integer(kbps->get_recv_bytes()));
-    
-    SrsJsonObject* okbps = SrsJsonAny::object();
-    obj->set("kbps", okbps);
-    
-    okbps->set("recv_30s", SrsJsonAny::integer(kbps->get_recv_kbps_30s()));
-    okbps->set("send_30s", SrsJsonAny::integer(kbps->get_send_kbps_30s()));
-    
-    SrsJsonObject* publish = SrsJsonAny::object();
-    obj->set("publish", publish);
-    
-    publish->set("active", SrsJsonAny::boolean(active));
+    w->str("id", id);
+    w->str("name", stream);
+    w->str("vhost", vhost->id);
+    w->str("app", app);
+    w->str("tcUrl", tcUrl);
+    w->str("url", url);
+    w->integer("live_ms", srsu2ms(srs_get_system_time()));
+    w->integer("clients", nb_clients);
+    w->integer("frames", frames->sugar);
+    w->integer("send_bytes", kbps->get_send_bytes());
+    w->integer("recv_bytes", kbps->get_recv_bytes());
+    
+    w->object_start("kbps");
+    w->integer("recv_30s", kbps->get_recv_kbps_30s());
+    w->integer("send_30s", kbps->get_send_kbps_30s());
+    w->object_end();
+    
+    w->object_start("publish");
+    w->boolean("active", active);
     if (!publisher_id.empty()) {
-        publish->set("cid", SrsJsonAny::str(publisher_id.c_str()));
+        w->str("cid", publisher_id);
     }
+    w->object_end();
     
     if (!has_video) {
-        obj->set("video", SrsJsonAny::null());
+        w->null("video");
     } else {
-        SrsJsonObject* video = SrsJsonAny::object();
-        obj->set("video", video);
+        w->object_start("video");
         
-        video->set("codec", SrsJsonAny::str(srs_video_codec_id2str(vcodec).c_str()));
+        w->str("codec", srs_video_codec_id2str(vcodec));
 
         if (vcodec == SrsVideoCodecIdAVC) {
-            video->set("profile", SrsJsonAny::str(srs_avc_profile2str(avc_profile).c_str()));
-            video->set("level", SrsJsonAny::str(srs_avc_level2str(avc_level).c_str()));
+            w->str("profile", srs_avc_profile2str(avc_profile));
+            w->str("level", srs_avc_level2str(avc_level));
 #ifdef SRS_H265
         } else if (vcodec == SrsVideoCodecIdHEVC) {
-            video->set("profile", SrsJsonAny::str(srs_hevc_profile2str(hevc_profile).c_str()));
-            video->set("level", SrsJsonAny::str(srs_hevc_level2str(hevc_level).c_str()));
+            w->str("profile", srs_hevc_profile2str(hevc_profile));
+            w->str("level", srs_hevc_level2str(hevc_level));
 #endif
         } else {
-            video->set("profile", SrsJsonAny::str("Other"));
-            video->set("level", SrsJsonAny::str("Other"));
+            w->str("profile", "Other");
+            w->str("level", "Other");
         }
 
-        video->set("width", SrsJsonAny::integer(width));
-        video->set("height", SrsJsonAny::integer(height));
+        w->integer("width", width);
+        w->integer("height", height);
+        w->object_end();
     }
     
     if (!has_audio) {
-        obj->set("audio", SrsJsonAny::null());
+        w->null("audio");
     } else {
-        SrsJsonObject* audio = SrsJsonAny::object();
-        obj->set("audio", audio);
-        
-        audio->set("codec", SrsJsonAny::str(srs_audio_codec_id2str(acodec).c_str()));
-        audio->set("sample_rate", SrsJsonAny::integer(srs_flv_srates[asample_rate]));
-        audio->set("channel", SrsJsonAny::integer(asound_type + 1));
-        audio->set("profile", SrsJsonAny::str(srs_aac_object2str(aac_object).c_str()));
+        w->object_start("audio");
+        w->str("codec", srs_audio_codec_id2str(acodec));
+        w->integer("sample_rate", srs_flv_srates[asample_rate]);
+        w->integer("channel", asound_type + 1);
+        w->str("profile", srs_aac_object2str(aac_object));
+        w->object_end();
+    }
+
+    if (has_jitter) {
+        w->object_start("jitter");
+        w->integer("delay", jitter_delay);
+        w->integer("late", jitter_late);
+        w->integer("discard", jitter_discard);
+        w->object_end();
+    }
+
+    if (has_transcode) {
+        w->object_start("transcode");
+        w->number("cpu", transcode_cpu);
+        w->integer("frames", transcode_frames);
+        w->integer("drops", transcode_drops);
+        w->object_end();
     }
     
     return err;
@@ -198,6 +219,8 @@ void SrsStatisticStream::close()
 
     has_video = false;
     has_audio = false;
+    has_jitter = false;
+    has_transcode = false;
     active = false;
     
     vhost->nb_streams--;
@@ -210,8 +233,15 @@ SrsStatisticClient::SrsStatisticClient()
     req = NULL;
     type = SrsRtmpConnUnknown;
     create = srs_get_system_time();
+    slot = -1;
 
     kbps = new SrsKbps();
+    bwe_kbps = 0;
+    mio_sleep = 0;
+    mio_buffer = 0;
+    mio_msgs = 0;
+    zc_pinned_bytes = 0;
+    zc_bytes = 0;
 }
 
 SrsStatisticClient::~SrsStatisticClient()
@@ -220,40 +250,65 @@ SrsStatisticClient::~SrsStatisticClient()
 	srs_freep(req);
 }
 
-srs_error_t SrsStatisticClient::dumps(SrsJsonObject* obj)
+srs_error_t SrsStatisticClient::dumps(SrsJsonWriter* w)
 {
     srs_error_t err = srs_success;
     
-    obj->set("id", SrsJsonAny::str(id.c_str()));
-    obj->set("vhost", SrsJsonAny::str(stream->vhost->id.c_str()));
-    obj->set("stream", SrsJsonAny::str(stream->id.c_str()));
-    obj->set("ip", SrsJsonAny::str(req->ip.c_str()));
-    obj->set("pageUrl", SrsJsonAny::str(req->pageUrl.c_str()));
-    obj->set("swfUrl", SrsJsonAny::str(req->swfUrl.c_str()));
-    obj->set("tcUrl", SrsJsonAny::str(req->tcUrl.c_str()));
-    obj->set("url", SrsJsonAny::str(req->get_stream_url().c_str()));
-    obj->set("name", SrsJsonAny::str(req->stream.c_str()));
-    obj->set("type", SrsJsonAny::str(srs_client_type_string(type).c_str()));
-    obj->set("publish", SrsJsonAny::boolean(srs_client_type_is_publish(type)));
-    obj->set("alive", SrsJsonAny::number(srsu2ms(srs_get_system_time() - create) / 1000.0));
-    obj->set("send_bytes", SrsJsonAny::integer(kbps->get_send_bytes()));
-    obj->set("recv_bytes", SrsJsonAny::integer(kbps->get_recv_bytes()));
-
-    SrsJsonObject* okbps = SrsJsonAny::object();
-    obj->set("kbps", okbps);
-
-    okbps->set("recv_30s", SrsJsonAny::integer(kbps->get_recv_kbps_30s()));
-    okbps->set("send_30s", SrsJsonAny::integer(kbps->get_send_kbps_30s()));
+    w->str("id", id);
+    w->str("vhost", stream->vhost->id);
+    w->str("stream", stream->id);
+    w->str("ip", req->ip);
+    w->str("pageUrl", req->pageUrl);
+    w->str("swfUrl", req->swfUrl);
+    w->str("tcUrl", req->tcUrl);
+    w->str("url", req->get_stream_url());
+    w->str("name", req->stream);
+    w->str("type", srs_client_type_string(type));
+    w->boolean("publish", srs_client_type_is_publish(type));
+    w->number("alive", srsu2ms(srs_get_system_time() - create) / 1000.0);
+    w->integer("send_bytes", kbps->get_send_bytes());
+    w->integer("recv_bytes", kbps->get_recv_bytes());
+
+    w->object_start("kbps");
+    w->integer("recv_30s", kbps->get_recv_kbps_30s());
+    w->integer("send_30s", kbps->get_send_kbps_30s());
+    if (bwe_kbps) {
+        w->integer("bwe", bwe_kbps);
+    }
+    w->object_end();
+
+    if (mio_buffer) {
+        w->object_start("mio");
+        w->integer("sleep_ms", srsu2ms(mio_sleep));
+        w->integer("buffer", mio_buffer);
+        w->integer("msgs", mio_msgs);
+        w->object_end();
+    }
+
+    if (zc_bytes) {
+        w->object_start("zerocopy");
+        w->integer("pinned_bytes", zc_pinned_bytes);
+        w->integer("send_bytes", zc_bytes);
+        w->object_end();
+    }
     
     return err;
 }
 
 SrsStatistic* SrsStatistic::_instance = NULL;
 
+// The size of level0 cache for clients, about 128KB.
+#define SRS_STAT_CLIENTS_LEVEL0_CACHE 16384
+
 SrsStatistic::SrsStatistic()
 {
     kbps = new SrsKbps();
 
+    nn_level0_cache_ = SRS_STAT_CLIENTS_LEVEL0_CACHE;
+    clients_level0_cache_ = new SrsStatisticClient*[nn_level0_cache_];
+    memset(clients_level0_cache_, 0, sizeof(SrsStatisticClient*) * nn_level0_cache_);
+    nn_client_holes_ = 0;
+
     nb_clients_ = 0;
     nb_errs_ = 0;
 }
@@ -276,15 +331,15 @@ SrsStatistic::~SrsStatistic()
             srs_freep(stream);
         }
     }
-    if (true) {
-        std::map<std::string, SrsStatisticClient*>::iterator it;
-        for (it = clients.begin(); it != clients.end(); it++) {
-            SrsStatisticClient* client = it->second;
-            srs_freep(client);
-        }
+    for (int i = 0; i < (int)client_slots.size(); i++) {
+        SrsStatisticClient* client = client_slots.at(i);
+        srs_freep(client);
     }
+    srs_freepa(clients_level0_cache_);
     
     vhosts.clear();
+    clients.clear();
+    client_slots.clear();
     rvhosts.clear();
     streams.clear();
     rstreams.clear();
@@ -340,13 +395,30 @@ SrsStatisticStream* SrsStatistic::find_stream_by_url(string url)
 
 SrsStatisticClient* SrsStatistic::find_client(string client_id)
 {
+    SrsStatisticClient** item = level0_cache_at(client_id);
+    if (*item && (*item)->id == client_id) {
+        return *item;
+    }
+
     std::map<std::string, SrsStatisticClient*>::iterator it;
     if ((it = clients.find(client_id)) != clients.end()) {
+        // Replace the item, the recent used client is more likely to be found again.
+        *item = it->second;
         return it->second;
     }
     return NULL;
 }
 
+SrsStatisticClient** SrsStatistic::level0_cache_at(const std::string& id)
+{
+    // The FNV-1a hash of client id.
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < (int)id.length(); i++) {
+        hash = (hash ^ (uint8_t)id.at(i)) * 16777619u;
+    }
+    return &clients_level0_cache_[hash % nn_level0_cache_];
+}
+
 srs_error_t SrsStatistic::on_video_info(SrsRequest* req, SrsVideoCodecId vcodec, int profile, int level, int width, int height)
 {
     srs_error_t err = srs_success;
@@ -419,6 +491,28 @@ void SrsStatistic::on_stream_close(SrsRequest* req)
     stream->close();
 }
 
+void SrsStatistic::on_stream_jitter(SrsRequest* req, int delay, int64_t nn_late, int64_t nn_discard)
+{
+    SrsStatisticVhost* vhost = create_vhost(req);
+    SrsStatisticStream* stream = create_stream(vhost, req);
+
+    stream->has_jitter = true;
+    stream->jitter_delay = delay;
+    stream->jitter_late = nn_late;
+    stream->jitter_discard = nn_discard;
+}
+
+void SrsStatistic::on_stream_transcode(SrsRequest* req, float cpu, int64_t nn_frames, int64_t nn_drops)
+{
+    SrsStatisticVhost* vhost = create_vhost(req);
+    SrsStatisticStream* stream = create_stream(vhost, req);
+
+    stream->has_transcode = true;
+    stream->transcode_cpu = cpu;
+    stream->transcode_frames = nn_frames;
+    stream->transcode_drops = nn_drops;
+}
+
 srs_error_t SrsStatistic::on_client(std::string id, SrsRequest* req, ISrsExpire* conn, SrsRtmpConnType type)
 {
     srs_error_t err = srs_success;
@@ -428,13 +522,13 @@ srs_error_t SrsStatistic::on_client(std::string id, SrsRequest* req, ISrsExpire*
     
     // create client if not exists
     SrsStatisticClient* client = NULL;
-    if (clients.find(id) == clients.end()) {
+    if ((client = find_client(id)) == NULL) {
         client = new SrsStatisticClient();
         client->id = id;
         client->stream = stream;
+        client->slot = (int)client_slots.size();
+        client_slots.push_back(client);
         clients[id] = client;
-    } else {
-        client = clients[id];
     }
     
     // got client.
@@ -461,6 +555,16 @@ void SrsStatistic::on_disconnect(std::string id, srs_error_t err)
     SrsStatisticClient* client = it->second;
     SrsStatisticStream* stream = client->stream;
     SrsStatisticVhost* vhost = stream->vhost;
+
+    // Leave a hole in the slot, to keep the order of clients.
+    client_slots[client->slot] = NULL;
+    nn_client_holes_++;
+    compact_client_slots();
+
+    SrsStatisticClient** item = level0_cache_at(id);
+    if (*item == client) {
+        *item = NULL;
+    }
     
     srs_freep(client);
     clients.erase(it);
@@ -475,6 +579,26 @@ void SrsStatistic::on_disconnect(std::string id, srs_error_t err)
     cleanup_stream(stream);
 }
 
+void SrsStatistic::compact_client_slots()
+{
+    // Compact when half of slots are holes, so the cost is amortized O(1) for each disconnect.
+    if (nn_client_holes_ < 16 || nn_client_holes_ * 2 < (int)client_slots.size()) {
+        return;
+    }
+
+    int j = 0;
+    for (int i = 0; i < (int)client_slots.size(); i++) {
+        SrsStatisticClient* client = client_slots.at(i);
+        if (!client) continue;
+
+        client->slot = j;
+        client_slots[j++] = client;
+    }
+
+    client_slots.resize(j);
+    nn_client_holes_ = 0;
+}
+
 void SrsStatistic::cleanup_stream(SrsStatisticStream* stream)
 {
     // If stream has publisher(not active) or player(clients), never cleanup it.
@@ -483,9 +607,9 @@ void SrsStatistic::cleanup_stream(SrsStatisticStream* stream)
     }
 
     // There should not be any clients referring to the stream.
-    for (std::map<std::string, SrsStatisticClient*>::iterator it = clients.begin(); it != clients.end(); ++it) {
-        SrsStatisticClient* client = it->second;
-        srs_assert(client->stream != stream);
+    for (int i = 0; i < (int)client_slots.size(); i++) {
+        SrsStatisticClient* client = client_slots.at(i);
+        srs_assert(!client || client->stream != stream);
     }
 
     // Do cleanup streams.
@@ -511,10 +635,8 @@ void SrsStatistic::kbps_add_delta(std::string id, ISrsKbpsDelta* delta)
 {
     if (!delta) return;
 
-    map<string, SrsStatisticClient*>::iterator it = clients.find(id);
-    if (it == clients.end()) return;
-
-    SrsStatisticClient* client = it->second;
+    SrsStatisticClient* client = find_client(id);
+    if (!client) return;
     
     // resample the kbps to collect the delta.
     int64_t in, out;
@@ -528,6 +650,33 @@ void SrsStatistic::kbps_add_delta(std::string id, ISrsKbpsDelta* delta)
     client->stream->vhost->kbps->add_delta(in, out);
 }
 
+void SrsStatistic::on_client_bandwidth(std::string id, int kbps)
+{
+    SrsStatisticClient* client = find_client(id);
+    if (!client) return;
+
+    client->bwe_kbps = kbps;
+}
+
+void SrsStatistic::on_client_merged_io(std::string id, srs_utime_t sleep, int buffer, int msgs)
+{
+    SrsStatisticClient* client = find_client(id);
+    if (!client) return;
+
+    client->mio_sleep = sleep;
+    client->mio_buffer = buffer;
+    client->mio_msgs = msgs;
+}
+
+void SrsStatistic::on_client_zerocopy(std::string id, int64_t pinned_bytes, int64_t zerocopy_bytes)
+{
+    SrsStatisticClient* client = find_client(id);
+    if (!client) return;
+
+    client->zc_pinned_bytes = pinned_bytes;
+    client->zc_bytes = zerocopy_bytes;
+}
+
 void SrsStatistic::kbps_sample()
 {
     kbps->sample();
@@ -546,10 +695,9 @@ void SrsStatistic::kbps_sample()
             stream->frames->update();
         }
     }
-    if (true) {
-        std::map<std::string, SrsStatisticClient*>::iterator it;
-        for (it = clients.begin(); it != clients.end(); it++) {
-            SrsStatisticClient* client = it->second;
+    for (int i = 0; i < (int)client_slots.size(); i++) {
+        SrsStatisticClient* client = client_slots.at(i);
+        if (client) {
             client->kbps->sample();
         }
     }
@@ -603,7 +751,7 @@ srs_error_t SrsStatistic::dumps_vhosts(SrsJsonArray* arr)
     return err;
 }
 
-srs_error_t SrsStatistic::dumps_streams(SrsJsonArray* arr, int start, int count)
+srs_error_t SrsStatistic::dumps_streams(SrsJsonWriter* w, int start, int count)
 {
     srs_error_t err = srs_success;
 
@@ -615,35 +763,41 @@ srs_error_t SrsStatistic::dumps_streams(SrsJsonArray* arr, int start, int count)
 
         SrsStatisticStream* stream = it->second;
         
-        SrsJsonObject* obj = SrsJsonAny::object();
-        arr->append(obj);
-        
-        if ((err = stream->dumps(obj)) != srs_success) {
+        w->object_start();
+        if ((err = stream->dumps(w)) != srs_success) {
             return srs_error_wrap(err, "dump stream");
         }
+        w->object_end();
     }
     
     return err;
 }
 
-srs_error_t SrsStatistic::dumps_clients(SrsJsonArray* arr, int start, int count)
+srs_error_t SrsStatistic::dumps_clients(SrsJsonWriter* w, int start, int count)
 {
     srs_error_t err = srs_success;
-    
-    std::map<std::string, SrsStatisticClient*>::iterator it = clients.begin();
-    for (int i = 0; i < start + count && it != clients.end(); it++, i++) {
-        if (i < start) {
+
+    // Use 64-bits to avoid overflow, and clamp the range to the clients.
+    int64_t first = srs_max((int64_t)0, (int64_t)start);
+    int64_t last = srs_min((int64_t)clients.size(), first + srs_max((int64_t)0, (int64_t)count));
+
+    // Seek directly if no hole, or skip the holes to the start.
+    int64_t index = 0, i = 0;
+    if (!nn_client_holes_) {
+        index = i = first;
+    }
+
+    for (; index < last && i < (int64_t)client_slots.size(); i++) {
+        SrsStatisticClient* client = client_slots.at(i);
+        if (!client || index++ < first) {
             continue;
         }
         
-        SrsStatisticClient* client = it->second;
-        
-        SrsJsonObject* obj = SrsJsonAny::object();
-        arr->append(obj);
-        
-        if ((err = client->dumps(obj)) != srs_success) {
+        w->object_start();
+        if ((err = client->dumps(w)) != srs_success) {
             return srs_error_wrap(err, "dump client");
         }
+        w->object_end();
     }
     
     return err;
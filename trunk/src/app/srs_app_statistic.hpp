@@ -22,6 +22,7 @@ class SrsWallClock;
 class SrsRequest;
 class ISrsExpire;
 class SrsJsonObject;
+class SrsJsonWriter;
 class SrsJsonArray;
 class ISrsKbpsDelta;
 class SrsClsSugar;
@@ -89,11 +90,24 @@ public:
     // 1.5.1.1 Audio object type definition, page 23,
     //           in ISO_IEC_14496-3-AAC-2001.pdf.
     SrsAacObjectType aac_object;
+public:
+    // The jitter buffer for RTC to RTMP, the target delay in ms, the late packets and discarded frames.
+    bool has_jitter;
+    int jitter_delay;
+    int64_t jitter_late;
+    int64_t jitter_discard;
+public:
+    // The audio transcoding of stream, the CPU percent of a core, the transcoded and dropped frames.
+    bool has_transcode;
+    float transcode_cpu;
+    int64_t transcode_frames;
+    int64_t transcode_drops;
 public:
     SrsStatisticStream();
     virtual ~SrsStatisticStream();
 public:
-    virtual srs_error_t dumps(SrsJsonObject* obj);
+    // Dumps the fields of stream, without the object start and end.
+    virtual srs_error_t dumps(SrsJsonWriter* w);
 public:
     // Publish the stream, id is the publisher.
     virtual void publish(std::string id);
@@ -112,14 +126,26 @@ public:
     SrsRtmpConnType type;
     std::string id;
     srs_utime_t create;
+    // The index in the contiguous clients of statistic.
+    int slot;
 public:
     // The stream total kbps.
     SrsKbps* kbps;
+    // The estimated bandwidth in kbps, for RTC player.
+    int bwe_kbps;
+    // The merged-read or merged-write chosen by the live bitrate, 0 if not tuned.
+    srs_utime_t mio_sleep;
+    int mio_buffer;
+    int mio_msgs;
+    // The bytes pinned by MSG_ZEROCOPY now, and the total bytes sent by it, 0 if disabled.
+    int64_t zc_pinned_bytes;
+    int64_t zc_bytes;
 public:
     SrsStatisticClient();
     virtual ~SrsStatisticClient();
 public:
-    virtual srs_error_t dumps(SrsJsonObject* obj);
+    // Dumps the fields of client, without the object start and end.
+    virtual srs_error_t dumps(SrsJsonWriter* w);
 };
 
 class SrsStatistic
@@ -145,8 +171,18 @@ private:
     // @remark a fast index for streams.
     std::map<std::string, SrsStatisticStream*> rstreams;
 private:
-    // The key: client id, value: stream object.
+    // The key: client id, value: client object.
+    // @remark an index for client_slots.
     std::map<std::string, SrsStatisticClient*> clients;
+    // All clients in array by the order of connecting, the slot of client is the index. The slot of disconnected
+    // client is set to NULL, and compacted in order when there are too many holes, so the clients are always in
+    // stable order for pagination.
+    std::vector<SrsStatisticClient*> client_slots;
+    // The number of NULL slots in client_slots.
+    int nn_client_holes_;
+    // The direct-mapped cache by hash of client id, to find client without the string-keyed lookup.
+    SrsStatisticClient** clients_level0_cache_;
+    int nn_level0_cache_;
     // The server total kbps.
     SrsKbps* kbps;
 private:
@@ -180,6 +216,10 @@ public:
     virtual void on_stream_publish(SrsRequest* req, std::string publisher_id);
     // When close stream.
     virtual void on_stream_close(SrsRequest* req);
+    // When update the jitter buffer of stream, for RTC to RTMP.
+    virtual void on_stream_jitter(SrsRequest* req, int delay, int64_t nn_late, int64_t nn_discard);
+    // When update the audio transcoding of stream, between RTMP and RTC.
+    virtual void on_stream_transcode(SrsRequest* req, float cpu, int64_t nn_frames, int64_t nn_drops);
 public:
     // When got a client to publish/play stream,
     // @param id, the client srs id.
@@ -195,10 +235,20 @@ public:
 private:
     // Cleanup the stream if stream is not active and for the last client.
     void cleanup_stream(SrsStatisticStream* stream);
+    // Compact the holes of client slots, keep the order of clients.
+    void compact_client_slots();
+    // Get the item of level0 cache for client id.
+    SrsStatisticClient** level0_cache_at(const std::string& id);
 public:
     // Sample the kbps, add delta bytes of conn.
     // Use kbps_sample() to get all result of kbps stat.
     virtual void kbps_add_delta(std::string id, ISrsKbpsDelta* delta);
+    // When got the estimated bandwidth of client, for RTC player.
+    virtual void on_client_bandwidth(std::string id, int kbps);
+    // When the merged-read or merged-write of client is tuned by the live bitrate.
+    virtual void on_client_merged_io(std::string id, srs_utime_t sleep, int buffer, int msgs);
+    // When the client sends data by MSG_ZEROCOPY.
+    virtual void on_client_zerocopy(std::string id, int64_t pinned_bytes, int64_t zerocopy_bytes);
     // Calc the result for all kbps.
     virtual void kbps_sample();
 public:
@@ -211,14 +261,14 @@ public:
     virtual std::string service_pid();
     // Dumps the vhosts to amf0 array.
     virtual srs_error_t dumps_vhosts(SrsJsonArray* arr);
-    // Dumps the streams to amf0 array.
+    // Dumps the streams as objects to the writer of array.
     // @param start the start index, from 0.
     // @param count the max count of streams to dump.
-    virtual srs_error_t dumps_streams(SrsJsonArray* arr, int start, int count);
-    // Dumps the clients to amf0 array
+    virtual srs_error_t dumps_streams(SrsJsonWriter* w, int start, int count);
+    // Dumps the clients as objects to the writer of array, without building the JSON tree.
     // @param start the start index, from 0.
     // @param count the max count of clients to dump.
-    virtual srs_error_t dumps_clients(SrsJsonArray* arr, int start, int count);
+    virtual srs_error_t dumps_clients(SrsJsonWriter* w, int start, int count);
     // Dumps the hints about SRS server.
     void dumps_hints_kv(std::stringstream & ss);
 #ifdef SRS_APM
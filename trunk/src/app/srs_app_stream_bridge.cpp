@@ -13,7 +13,15 @@
 #include <srs_protocol_rtmp_stack.hpp>
 #include <srs_kernel_rtc_rtp.hpp>
 #include <srs_core_autofree.hpp>
-
+#include <srs_kernel_buffer.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_protocol_utility.hpp>
+#include <srs_app_rtmp_conn.hpp>
+#include <srs_app_server.hpp>
+#include <srs_app_statistic.hpp>
+#include <srs_app_http_hooks.hpp>
+
+#include <string.h>
 #include <vector>
 using namespace std;
 
@@ -225,3 +233,319 @@ SrsCompositeBridge* SrsCompositeBridge::append(ISrsStreamBridge* bridge)
     return this;
 }
 
+
+SrsCasterPublisher::SrsCasterPublisher(std::string url, srs_utime_t cto, srs_utime_t sto)
+{
+    url_ = url;
+    cto_ = cto;
+    sto_ = sto;
+    cid_ = _srs_context->generate_id().c_str();
+
+    req_ = new SrsRequest();
+    srs_parse_rtmp_url(url_, req_->tcUrl, req_->stream);
+    srs_discovery_tc_url(req_->tcUrl, req_->schema, req_->host, req_->vhost, req_->app, req_->stream, req_->port, req_->param);
+    req_->strip();
+
+    sdk_ = NULL;
+    publishing_ = false;
+}
+
+SrsCasterPublisher::~SrsCasterPublisher()
+{
+    close();
+    srs_freep(req_);
+}
+
+srs_error_t SrsCasterPublisher::publish()
+{
+    srs_error_t err = srs_success;
+
+    close();
+
+    // Publish to the live source in process, if the output is this server.
+    if (is_local()) {
+        if ((err = acquire_publish()) != srs_success) {
+            close();
+            return srs_error_wrap(err, "publish %s", url_.c_str());
+        }
+        return err;
+    }
+
+    sdk_ = new SrsSimpleRtmpClient(url_, cto_, sto_);
+
+    if ((err = sdk_->connect()) != srs_success) {
+        close();
+        return srs_error_wrap(err, "connect %s failed, cto=%dms, sto=%dms.", url_.c_str(), srsu2msi(cto_), srsu2msi(sto_));
+    }
+
+    if ((err = sdk_->publish(SRS_CONSTS_RTMP_PROTOCOL_CHUNK_SIZE)) != srs_success) {
+        close();
+        return srs_error_wrap(err, "publish");
+    }
+
+    return err;
+}
+
+void SrsCasterPublisher::close()
+{
+    srs_freep(sdk_);
+
+    if (source_.get()) {
+        if (publishing_) {
+            source_->on_unpublish();
+            http_hooks_on_unpublish();
+        }
+
+        SrsStatistic::instance()->on_disconnect(cid_, srs_success);
+        source_ = SrsSharedPtr<SrsLiveSource>(NULL);
+    }
+
+    publishing_ = false;
+}
+
+int SrsCasterPublisher::sid()
+{
+    return sdk_ ? sdk_->sid() : 1;
+}
+
+srs_error_t SrsCasterPublisher::send_and_free_message(SrsSharedPtrMessage* msg)
+{
+    if (sdk_) {
+        return sdk_->send_and_free_message(msg);
+    }
+
+    SrsUniquePtr<SrsSharedPtrMessage> m(msg);
+    if (!publishing_) {
+        return srs_error_new(ERROR_RTMP_STREAM_NOT_FOUND, "not publishing %s", url_.c_str());
+    }
+
+    if (!m->is_av()) {
+        return on_meta_data(m.get());
+    }
+
+    return source_->on_frame(m.get());
+}
+
+bool SrsCasterPublisher::is_local()
+{
+    if (req_->schema != "rtmp") {
+        return false;
+    }
+
+    // The edge should proxy the stream to origin by RTMP, so never publish to the edge source directly.
+    SrsConfDirective* vhost = _srs_config->get_vhost(req_->vhost);
+    if (!vhost || !_srs_config->get_vhost_enabled(vhost) || _srs_config->get_vhost_is_edge(vhost)) {
+        return false;
+    }
+
+    bool port_matched = false;
+    vector<string> listens = _srs_config->get_listens();
+    for (int i = 0; i < (int)listens.size(); i++) {
+        string ip;
+        int port = 0;
+        srs_parse_endpoint(listens.at(i), ip, port);
+        if (port == req_->port) {
+            port_matched = true;
+            break;
+        }
+    }
+    if (!port_matched) {
+        return false;
+    }
+
+    if (req_->host == "localhost" || req_->host == "127.0.0.1" || req_->host == "::1") {
+        return true;
+    }
+
+    vector<SrsIPAddress*>& ips = srs_get_local_ips();
+    for (int i = 0; i < (int)ips.size(); i++) {
+        if (ips.at(i)->ip == req_->host) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+srs_error_t SrsCasterPublisher::acquire_publish()
+{
+    srs_error_t err = srs_success;
+
+    // Use the name of vhost in config, as RTMP connection does.
+    SrsConfDirective* vhost = _srs_config->get_vhost(req_->vhost);
+    srs_assert(vhost);
+    req_->vhost = vhost->arg0();
+
+    SrsSharedPtr<SrsLiveSource> source;
+    if ((err = _srs_sources->fetch_or_create(req_, _srs_hybrid->srs()->instance(), source)) != srs_success) {
+        return srs_error_wrap(err, "create source");
+    }
+    source_ = source;
+
+    SrsStatistic* stat = SrsStatistic::instance();
+    if ((err = stat->on_client(cid_, req_, NULL, SrsCasterPublish)) != srs_success) {
+        return srs_error_wrap(err, "stat client");
+    }
+
+    // We must do hook after stat, because depends on it.
+    if ((err = http_hooks_on_publish()) != srs_success) {
+        return srs_error_wrap(err, "http hook");
+    }
+
+    // Callback on_unpublish if failed to acquire, because on_publish is done, so the hook backend always gets a pair.
+    if ((err = do_acquire_publish(source)) != srs_success) {
+        http_hooks_on_unpublish();
+        return srs_error_wrap(err, "acquire publish");
+    }
+    publishing_ = true;
+
+    srs_trace("caster: publish %s to source in process, vhost=%s, app=%s, stream=%s", url_.c_str(),
+        req_->vhost.c_str(), req_->app.c_str(), req_->stream.c_str());
+
+    return err;
+}
+
+srs_error_t SrsCasterPublisher::do_acquire_publish(SrsSharedPtr<SrsLiveSource> source)
+{
+    srs_error_t err = srs_success;
+
+    // Check whether RTMP stream is busy.
+    if (!source->can_publish(false)) {
+        return srs_error_new(ERROR_SYSTEM_STREAM_BUSY, "rtmp stream %s busy", req_->get_stream_url().c_str());
+    }
+
+    bool enabled_cache = _srs_config->get_gop_cache(req_->vhost);
+    int gcmf = _srs_config->get_gop_cache_max_frames(req_->vhost);
+    source->set_cache(enabled_cache);
+    source->set_gop_cache_max_frames(gcmf);
+
+    // Bridge to RTC streaming, like the RTMP publisher.
+#ifdef SRS_RTC
+    bool rtc_server_enabled = _srs_config->get_rtc_server_enabled();
+    bool rtc_enabled = _srs_config->get_rtc_enabled(req_->vhost);
+    if (rtc_server_enabled && rtc_enabled) {
+        SrsSharedPtr<SrsRtcSource> rtc;
+        if ((err = _srs_rtc_sources->fetch_or_create(req_, rtc)) != srs_success) {
+            return srs_error_wrap(err, "create source");
+        }
+
+        if (!rtc->can_publish()) {
+            return srs_error_new(ERROR_SYSTEM_STREAM_BUSY, "rtc stream %s busy", req_->get_stream_url().c_str());
+        }
+
+#ifdef SRS_FFMPEG_FIT
+        if (_srs_config->get_rtc_from_rtmp(req_->vhost)) {
+            SrsCompositeBridge* bridge = new SrsCompositeBridge();
+            bridge->append(new SrsFrameToRtcBridge(rtc));
+
+            if ((err = bridge->initialize(req_)) != srs_success) {
+                srs_freep(bridge);
+                return srs_error_wrap(err, "bridge init");
+            }
+
+            source->set_bridge(bridge);
+        }
+#endif
+    }
+#endif
+
+    if ((err = source->on_publish()) != srs_success) {
+        return srs_error_wrap(err, "source publish");
+    }
+
+    return err;
+}
+
+srs_error_t SrsCasterPublisher::on_meta_data(SrsSharedPtrMessage* msg)
+{
+    srs_error_t err = srs_success;
+
+    // The metadata is rare, so it's ok to copy the payload to decode it.
+    char* payload = new char[msg->size];
+    memcpy(payload, msg->payload, msg->size);
+
+    SrsMessageHeader header;
+    header.initialize_amf0_script(msg->size, sid());
+    header.timestamp = msg->timestamp;
+
+    SrsCommonMessage cm;
+    cm.create(&header, payload, msg->size);
+
+    SrsOnMetaDataPacket metadata;
+    SrsBuffer stream(cm.payload, cm.size);
+    if ((err = metadata.decode(&stream)) != srs_success) {
+        srs_warn("caster: ignore data message, size=%d, err=%s", cm.size, srs_error_desc(err).c_str());
+        srs_freep(err);
+        return srs_success;
+    }
+
+    if (metadata.name != SRS_CONSTS_RTMP_ON_METADATA) {
+        return err;
+    }
+
+    if ((err = source_->on_meta_data(&cm, &metadata)) != srs_success) {
+        return srs_error_wrap(err, "source metadata");
+    }
+
+    return err;
+}
+
+srs_error_t SrsCasterPublisher::http_hooks_on_publish()
+{
+    srs_error_t err = srs_success;
+
+    if (!_srs_config->get_vhost_http_hooks_enabled(req_->vhost)) {
+        return err;
+    }
+
+    // the http hooks will cause context switch,
+    // so we must copy all hooks for the on_connect may freed.
+    // @see https://github.com/ossrs/srs/issues/475
+    vector<string> hooks;
+
+    if (true) {
+        SrsConfDirective* conf = _srs_config->get_vhost_on_publish(req_->vhost);
+
+        if (!conf) {
+            return err;
+        }
+
+        hooks = conf->args;
+    }
+
+    for (int i = 0; i < (int)hooks.size(); i++) {
+        std::string url = hooks.at(i);
+        if ((err = SrsHttpHooks::on_publish(url, req_)) != srs_success) {
+            return srs_error_wrap(err, "caster on_publish %s", url.c_str());
+        }
+    }
+
+    return err;
+}
+
+void SrsCasterPublisher::http_hooks_on_unpublish()
+{
+    if (!_srs_config->get_vhost_http_hooks_enabled(req_->vhost)) {
+        return;
+    }
+
+    // the http hooks will cause context switch,
+    // so we must copy all hooks for the on_connect may freed.
+    // @see https://github.com/ossrs/srs/issues/475
+    vector<string> hooks;
+
+    if (true) {
+        SrsConfDirective* conf = _srs_config->get_vhost_on_unpublish(req_->vhost);
+
+        if (!conf) {
+            return;
+        }
+
+        hooks = conf->args;
+    }
+
+    for (int i = 0; i < (int)hooks.size(); i++) {
+        std::string url = hooks.at(i);
+        SrsHttpHooks::on_unpublish(url, req_);
+    }
+}
@@ -12,6 +12,7 @@
 #include <srs_kernel_codec.hpp>
 #include <srs_core_autofree.hpp>
 
+#include <string>
 #include <vector>
 
 class SrsRequest;
@@ -22,6 +23,7 @@ class SrsRtmpFormat;
 class SrsMetaCache;
 class SrsRtpPacket;
 class SrsRtcRtpBuilder;
+class SrsSimpleRtmpClient;
 
 // A stream bridge is used to convert stream via different protocols, such as bridge for RTMP and RTC. Generally, we use
 // frame as message for bridge. A frame is a audio or video frame, such as an I/B/P frame, a general frame for decoder.
@@ -96,5 +98,48 @@ private:
     std::vector<ISrsStreamBridge*> bridges_;
 };
 
+// The publisher for stream casters, such as GB28181, MPEG-TS over UDP and HTTP-FLV, to publish the demuxed frames to
+// the output RTMP url. If the output is served by this server, we feed the frames to the live source and bridge to RTC
+// in process, without the RTMP loopback connection. Otherwise, publish to the remote server by RTMP client.
+class SrsCasterPublisher
+{
+private:
+    std::string url_;
+    srs_utime_t cto_;
+    srs_utime_t sto_;
+    SrsRequest* req_;
+    // The client id for statistic and hooks, as the caster has no connection for the stream.
+    std::string cid_;
+private:
+    // For remote server, publish by RTMP client.
+    SrsSimpleRtmpClient* sdk_;
+    // For this server, publish to the live source directly.
+    SrsSharedPtr<SrsLiveSource> source_;
+    bool publishing_;
+public:
+    // @param url The output RTMP url, for example, rtmp://127.0.0.1/live/livestream
+    // @param cto The timeout to connect to the remote server.
+    // @param sto The timeout to delivery stream to the remote server.
+    SrsCasterPublisher(std::string url, srs_utime_t cto, srs_utime_t sto);
+    virtual ~SrsCasterPublisher();
+public:
+    // Start to publish the stream, by source or RTMP client.
+    virtual srs_error_t publish();
+    // Stop publishing, and close the RTMP client if remote.
+    virtual void close();
+    // The stream id to create message for.
+    virtual int sid();
+    // Send out the message and free it.
+    virtual srs_error_t send_and_free_message(SrsSharedPtrMessage* msg);
+private:
+    // Whether the output url is served by this server.
+    virtual bool is_local();
+    virtual srs_error_t acquire_publish();
+    virtual srs_error_t do_acquire_publish(SrsSharedPtr<SrsLiveSource> source);
+    virtual srs_error_t on_meta_data(SrsSharedPtrMessage* msg);
+    virtual srs_error_t http_hooks_on_publish();
+    virtual void http_hooks_on_unpublish();
+};
+
 #endif
 
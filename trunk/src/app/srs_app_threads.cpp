@@ -18,6 +18,9 @@
 #include <srs_app_async_call.hpp>
 #include <srs_app_tencentcloud.hpp>
 #include <srs_app_conn.hpp>
+#include <srs_app_edge.hpp>
+#include <srs_app_http_hooks.hpp>
+#include <srs_kernel_balance.hpp>
 #ifdef SRS_RTC
 #include <srs_app_rtc_dtls.hpp>
 #include <srs_app_rtc_conn.hpp>
@@ -35,6 +38,8 @@ using namespace std;
 
 #include <unistd.h>
 #include <fcntl.h>
+#include <errno.h>
+#include <time.h>
 
 #if defined(SRS_OSX) || defined(SRS_CYGWIN64)
     pid_t gettid() {
@@ -442,6 +447,14 @@ srs_error_t srs_global_initialize()
     // Create global async worker for DVR.
     _srs_dvr_async = new SrsAsyncCallWorker();
 
+    // The health of origin servers for edge.
+    _srs_edge_origins = new SrsLbHealth();
+
+    // The keep-alive clients, cached decisions and async worker for http hooks.
+    _srs_hooks_pool = new SrsHttpHooksPool();
+    _srs_hooks_cache = new SrsHttpHooksCache();
+    _srs_hooks_async = new SrsHttpHooksAsyncWorker(SRS_HTTP_HOOKS_MAX_QUEUE, SRS_HTTP_HOOKS_QUEUE_TIMEOUT);
+
 #ifdef SRS_APM
     // Initialize global TencentCloud CLS object.
     _srs_cls = new SrsClsClient();
@@ -495,6 +508,53 @@ void SrsThreadMutex::unlock()
     srs_assert(!r0);
 }
 
+SrsThreadCond::SrsThreadCond()
+{
+    int r0 = pthread_mutex_init(&lock_, NULL);
+    srs_assert(!r0);
+
+    r0 = pthread_cond_init(&cond_, NULL);
+    srs_assert(!r0);
+
+    signaled_ = false;
+}
+
+SrsThreadCond::~SrsThreadCond()
+{
+    pthread_cond_destroy(&cond_);
+    pthread_mutex_destroy(&lock_);
+}
+
+void SrsThreadCond::signal()
+{
+    pthread_mutex_lock(&lock_);
+    signaled_ = true;
+    pthread_cond_signal(&cond_);
+    pthread_mutex_unlock(&lock_);
+}
+
+bool SrsThreadCond::wait(srs_utime_t timeout)
+{
+    // https://man7.org/linux/man-pages/man3/pthread_cond_timedwait.3p.html
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    int64_t nsec = ts.tv_nsec + (timeout % SRS_UTIME_SECONDS) * 1000;
+    ts.tv_sec += timeout / SRS_UTIME_SECONDS + nsec / 1000000000;
+    ts.tv_nsec = nsec % 1000000000;
+
+    pthread_mutex_lock(&lock_);
+    while (!signaled_) {
+        if (pthread_cond_timedwait(&cond_, &lock_, &ts) == ETIMEDOUT) {
+            break;
+        }
+    }
+    bool signaled = signaled_;
+    signaled_ = false;
+    pthread_mutex_unlock(&lock_);
+
+    return signaled;
+}
+
 SrsThreadEntry::SrsThreadEntry()
 {
     pool = NULL;
@@ -504,6 +564,7 @@ SrsThreadEntry::SrsThreadEntry()
     tid = 0;
 
     err = srs_success;
+    joinable = false;
 }
 
 SrsThreadEntry::~SrsThreadEntry()
@@ -639,11 +700,12 @@ srs_error_t SrsThreadPool::acquire_pid_file()
     return srs_success;
 }
 
-srs_error_t SrsThreadPool::execute(string label, srs_error_t (*start)(void* arg), void* arg)
+srs_error_t SrsThreadPool::execute(string label, srs_error_t (*start)(void* arg), void* arg, SrsThreadEntry** pentry)
 {
     srs_error_t err = srs_success;
 
     SrsThreadEntry* entry = new SrsThreadEntry();
+    entry->joinable = (pentry != NULL);
 
     // Update the hybrid thread entry for circuit breaker.
     if (label == "hybrid") {
@@ -681,10 +743,26 @@ srs_error_t SrsThreadPool::execute(string label, srs_error_t (*start)(void* arg)
     }
 
     entry->trd = trd;
+    if (pentry) {
+        *pentry = entry;
+    }
 
     return err;
 }
 
+srs_error_t SrsThreadPool::join(SrsThreadEntry* entry)
+{
+    srs_assert(entry->joinable);
+
+    // https://man7.org/linux/man-pages/man3/pthread_join.3.html
+    int r0 = pthread_join(entry->trd, NULL);
+    if (r0 != 0) {
+        return srs_error_new(ERROR_THREAD_JOIN, "join thread %s, r0=%d", entry->name.c_str(), r0);
+    }
+
+    return srs_error_copy(entry->err);
+}
+
 srs_error_t SrsThreadPool::run()
 {
     srs_error_t err = srs_success;
@@ -792,8 +870,8 @@ void* SrsThreadPool::start(void* arg)
         entry->err = err;
     }
 
-    // We use a special error to indicates the normally done.
-    if (entry->err == srs_success) {
+    // We use a special error to indicates the normally done, except the joinable thread, which is stopped by owner.
+    if (entry->err == srs_success && !entry->joinable) {
         entry->err = srs_error_new(ERROR_THREAD_FINISHED, "finished normally");
     }
 
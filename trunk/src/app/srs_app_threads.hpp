@@ -87,6 +87,77 @@ public:
     }
 };
 
+// The thread condition variable, to block the worker thread util signaled or timeout.
+// @remark The signal is never lost, that is, the next wait returns immediately if signaled before wait.
+class SrsThreadCond
+{
+private:
+    pthread_mutex_t lock_;
+    pthread_cond_t cond_;
+    bool signaled_;
+public:
+    SrsThreadCond();
+    virtual ~SrsThreadCond();
+public:
+    // Wakeup the waiting thread.
+    void signal();
+    // Wait util signaled or timeout, return true if signaled.
+    bool wait(srs_utime_t timeout);
+};
+
+// The lock-free queue for single producer and single consumer, to exchange objects between threads.
+// @remark The capacity is rounded up to power of 2.
+template<typename T>
+class SrsThreadQueue
+{
+private:
+    T* items_;
+    uint32_t mask_;
+    // The head is only written by consumer, and tail only by producer, in different cache lines.
+    char pad0_[64];
+    uint32_t head_;
+    char pad1_[64];
+    uint32_t tail_;
+    char pad2_[64];
+public:
+    SrsThreadQueue(int capacity) {
+        uint32_t size = 1;
+        while ((int)size < capacity) {
+            size <<= 1;
+        }
+        items_ = new T[size];
+        mask_ = size - 1;
+        head_ = tail_ = 0;
+    }
+    virtual ~SrsThreadQueue() {
+        srs_freepa(items_);
+    }
+public:
+    // Push object by producer thread, return false if full.
+    bool push(T v) {
+        uint32_t tail = __atomic_load_n(&tail_, __ATOMIC_RELAXED);
+        if (tail - __atomic_load_n(&head_, __ATOMIC_ACQUIRE) > mask_) {
+            return false;
+        }
+        items_[tail & mask_] = v;
+        __atomic_store_n(&tail_, tail + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+    // Pop object by consumer thread, return false if empty.
+    bool pop(T& v) {
+        uint32_t head = __atomic_load_n(&head_, __ATOMIC_RELAXED);
+        if (head == __atomic_load_n(&tail_, __ATOMIC_ACQUIRE)) {
+            return false;
+        }
+        v = items_[head & mask_];
+        __atomic_store_n(&head_, head + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+    int size() {
+        return (int)(__atomic_load_n(&tail_, __ATOMIC_ACQUIRE) - __atomic_load_n(&head_, __ATOMIC_ACQUIRE));
+    }
+};
+
 // The information for a thread.
 class SrsThreadEntry
 {
@@ -104,6 +175,8 @@ public:
     pthread_t trd;
     // The exit error of thread.
     srs_error_t err;
+    // Whether the thread is joined by its owner, so the pool never quits when it finished normally.
+    bool joinable;
 public:
     SrsThreadEntry();
     virtual ~SrsThreadEntry();
@@ -142,7 +215,10 @@ private:
     virtual srs_error_t acquire_pid_file();
 public:
     // Execute start function with label in thread.
-    srs_error_t execute(std::string label, srs_error_t (*start)(void* arg), void* arg);
+    // @param pentry Output the joinable thread entry if not NULL, which should be joined by the caller.
+    srs_error_t execute(std::string label, srs_error_t (*start)(void* arg), void* arg, SrsThreadEntry** pentry = NULL);
+    // Wait for the joinable thread to quit, and return its error.
+    srs_error_t join(SrsThreadEntry* entry);
     // Run in the primordial thread, util stop or quit.
     srs_error_t run();
     // Stop the thread pool and quit the primordial thread.
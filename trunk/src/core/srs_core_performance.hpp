@@ -163,6 +163,13 @@
     #undef SRS_PERF_SO_SNDBUF_SIZE
 #endif
 
+/**
+ * The min bytes of a write to use MSG_ZEROCOPY, for the page pinning and notification are more expensive
+ * than copying small data, see https://www.kernel.org/doc/html/latest/networking/msg_zerocopy.html
+ * @remark only apply it when zerocopy of vhost play is on.
+ */
+#define SRS_PERF_ZEROCOPY_MIN_BYTES 10240
+
 /**
  * whether ensure glibc memory check.
  */
@@ -6,10 +6,25 @@
 
 #include <srs_kernel_balance.hpp>
 
+#include <stdlib.h>
+
 #include <srs_kernel_error.hpp>
+#include <srs_kernel_utility.hpp>
 
 using namespace std;
 
+// The default duration to eject a failed server.
+#define SRS_LB_EJECT_BASE (3 * SRS_UTIME_SECONDS)
+#define SRS_LB_EJECT_MAX (60 * SRS_UTIME_SECONDS)
+
+ISrsLbBalancer::ISrsLbBalancer()
+{
+}
+
+ISrsLbBalancer::~ISrsLbBalancer()
+{
+}
+
 SrsLbRoundRobin::SrsLbRoundRobin()
 {
     index = -1;
@@ -40,3 +55,223 @@ string SrsLbRoundRobin::select(const vector<string>& servers)
     return elem;
 }
 
+void SrsLbRoundRobin::on_success(const string& /*server*/, srs_utime_t /*rtt*/)
+{
+}
+
+void SrsLbRoundRobin::on_failure(const string& /*server*/)
+{
+}
+
+SrsLbServerHealth::SrsLbServerHealth(const string& s)
+{
+    server = s;
+    srtt = rtt = 0;
+    failures = 0;
+    ejected_until = 0;
+    nn_selected = nn_success = nn_failures = 0;
+}
+
+SrsLbServerHealth::~SrsLbServerHealth()
+{
+}
+
+bool SrsLbServerHealth::is_ejected(srs_utime_t now)
+{
+    return ejected_until > now;
+}
+
+SrsLbHealth::SrsLbHealth()
+{
+    eject_base_ = SRS_LB_EJECT_BASE;
+    eject_max_ = SRS_LB_EJECT_MAX;
+}
+
+SrsLbHealth::~SrsLbHealth()
+{
+    map<string, SrsLbServerHealth*>::iterator it;
+    for (it = servers_.begin(); it != servers_.end(); ++it) {
+        SrsLbServerHealth* h = it->second;
+        srs_freep(h);
+    }
+    servers_.clear();
+}
+
+void SrsLbHealth::set_eject(srs_utime_t base, srs_utime_t max)
+{
+    eject_base_ = base;
+    eject_max_ = srs_max(base, max);
+}
+
+SrsLbServerHealth* SrsLbHealth::fetch_or_create(const string& server)
+{
+    map<string, SrsLbServerHealth*>::iterator it = servers_.find(server);
+    if (it != servers_.end()) {
+        return it->second;
+    }
+
+    SrsLbServerHealth* h = new SrsLbServerHealth(server);
+    servers_[server] = h;
+    return h;
+}
+
+void SrsLbHealth::on_success(const string& server, srs_utime_t rtt)
+{
+    SrsLbServerHealth* h = fetch_or_create(server);
+
+    h->nn_success++;
+    h->failures = 0;
+    h->ejected_until = 0;
+
+    // The EWMA of rtt, alpha is 1/8, see RFC6298.
+    h->rtt = rtt;
+    h->srtt = h->srtt ? (7 * h->srtt + rtt) / 8 : rtt;
+}
+
+void SrsLbHealth::on_failure(const string& server, srs_utime_t now)
+{
+    SrsLbServerHealth* h = fetch_or_create(server);
+
+    h->nn_failures++;
+    h->failures++;
+
+    // Eject the server, the duration is doubled for each consecutive failure.
+    srs_utime_t duration = eject_base_;
+    for (int i = 1; i < h->failures && duration < eject_max_; i++) {
+        duration *= 2;
+    }
+    h->ejected_until = now + srs_min(duration, eject_max_);
+}
+
+map<string, SrsLbServerHealth*>& SrsLbHealth::servers()
+{
+    return servers_;
+}
+
+SrsLbHealthAware::SrsLbHealthAware(SrsLbHealth* health)
+{
+    health_ = health;
+    index_ = -1;
+}
+
+SrsLbHealthAware::~SrsLbHealthAware()
+{
+}
+
+uint32_t SrsLbHealthAware::current()
+{
+    return index_;
+}
+
+string SrsLbHealthAware::selected()
+{
+    return elem_;
+}
+
+string SrsLbHealthAware::select(const vector<string>& servers)
+{
+    srs_assert(!servers.empty());
+
+    srs_utime_t now = srs_get_system_time();
+
+    // Filter the ejected servers, and find the one to fallback.
+    vector<int> candidates;
+    int fallback = 0;
+    srs_utime_t fallback_until = -1;
+    for (int i = 0; i < (int)servers.size(); i++) {
+        SrsLbServerHealth* h = health_->fetch_or_create(servers.at(i));
+        if (!h->is_ejected(now)) {
+            candidates.push_back(i);
+        } else if (fallback_until < 0 || h->ejected_until < fallback_until) {
+            fallback = i;
+            fallback_until = h->ejected_until;
+        }
+    }
+
+    // All servers are ejected, use the one which will recover first.
+    if (candidates.empty()) {
+        candidates.push_back(fallback);
+    }
+
+    index_ = (candidates.size() == 1) ? candidates.at(0) : do_select(servers, candidates);
+    elem_ = servers.at(index_);
+
+    health_->fetch_or_create(elem_)->nn_selected++;
+
+    return elem_;
+}
+
+void SrsLbHealthAware::on_success(const string& server, srs_utime_t rtt)
+{
+    health_->on_success(server, rtt);
+}
+
+void SrsLbHealthAware::on_failure(const string& server)
+{
+    health_->on_failure(server, srs_get_system_time());
+}
+
+SrsLbPowerOfTwo::SrsLbPowerOfTwo(SrsLbHealth* health) : SrsLbHealthAware(health)
+{
+}
+
+SrsLbPowerOfTwo::~SrsLbPowerOfTwo()
+{
+}
+
+int SrsLbPowerOfTwo::do_select(const vector<string>& servers, const vector<int>& candidates)
+{
+    int nn = (int)candidates.size();
+
+    // Randomly pick two different candidates.
+    int a = (int)(::random() % nn);
+    int b = (int)(::random() % (nn - 1));
+    if (b >= a) {
+        b++;
+    }
+
+    SrsLbServerHealth* ha = health_->fetch_or_create(servers.at(candidates.at(a)));
+    SrsLbServerHealth* hb = health_->fetch_or_create(servers.at(candidates.at(b)));
+
+    // Prefer the server never connected, to probe its rtt.
+    if (!ha->srtt || !hb->srtt) {
+        return candidates.at(!ha->srtt ? a : b);
+    }
+
+    return candidates.at(ha->srtt <= hb->srtt ? a : b);
+}
+
+SrsLbConsistentHash::SrsLbConsistentHash(SrsLbHealth* health, string key) : SrsLbHealthAware(health)
+{
+    key_ = key;
+}
+
+SrsLbConsistentHash::~SrsLbConsistentHash()
+{
+}
+
+int SrsLbConsistentHash::do_select(const vector<string>& servers, const vector<int>& candidates)
+{
+    int best = candidates.at(0);
+    uint32_t best_weight = 0;
+
+    for (int i = 0; i < (int)candidates.size(); i++) {
+        const string& server = servers.at(candidates.at(i));
+
+        // The weight is the hash of server and key, mixed by the finalizer of murmur3,
+        // because crc32 is linear and not uniform enough to compare.
+        uint32_t weight = srs_crc32_ieee(server.data(), (int)server.length());
+        weight = srs_crc32_ieee(key_.data(), (int)key_.length(), weight);
+        weight ^= weight >> 16; weight *= 0x85ebca6b;
+        weight ^= weight >> 13; weight *= 0xc2b2ae35;
+        weight ^= weight >> 16;
+
+        if (i == 0 || weight > best_weight) {
+            best = candidates.at(i);
+            best_weight = weight;
+        }
+    }
+
+    return best;
+}
+
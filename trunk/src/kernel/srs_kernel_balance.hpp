@@ -11,12 +11,37 @@
 
 #include <vector>
 #include <string>
+#include <map>
+
+/**
+ * The load balance algorithm, used for edge pull and other multiple server feature.
+ * The user should feedback the result of the selected server, for some algorithms
+ * are aware of the server health, such as connect time and failures.
+ */
+class ISrsLbBalancer
+{
+public:
+    ISrsLbBalancer();
+    virtual ~ISrsLbBalancer();
+public:
+    // Get the index of the selected server.
+    virtual uint32_t current() = 0;
+    // Get the selected server.
+    virtual std::string selected() = 0;
+    // Select a server from the servers, which must not be empty.
+    virtual std::string select(const std::vector<std::string>& servers) = 0;
+public:
+    // When connected to the server, the rtt is the time to connect to it.
+    virtual void on_success(const std::string& server, srs_utime_t rtt) = 0;
+    // When failed to connect to the server.
+    virtual void on_failure(const std::string& server) = 0;
+};
 
 /**
  * the round-robin load balance algorithm,
  * used for edge pull and other multiple server feature.
  */
-class SrsLbRoundRobin
+class SrsLbRoundRobin : public ISrsLbBalancer
 {
 private:
     // current selected index.
@@ -32,6 +57,112 @@ public:
     virtual uint32_t current();
     virtual std::string selected();
     virtual std::string select(const std::vector<std::string>& servers);
+public:
+    virtual void on_success(const std::string& server, srs_utime_t rtt);
+    virtual void on_failure(const std::string& server);
+};
+
+// The health of a server, shared by all balancers which use the same servers.
+class SrsLbServerHealth
+{
+public:
+    std::string server;
+    // The smoothed rtt(connect time) by EWMA, zero if never connected.
+    srs_utime_t srtt;
+    // The last rtt(connect time).
+    srs_utime_t rtt;
+    // The number of consecutive failures, reset when success.
+    int failures;
+    // The server is ejected until this time, zero if not ejected.
+    srs_utime_t ejected_until;
+public:
+    // The number of selected, success and failures.
+    uint64_t nn_selected;
+    uint64_t nn_success;
+    uint64_t nn_failures;
+public:
+    SrsLbServerHealth(const std::string& s);
+    virtual ~SrsLbServerHealth();
+public:
+    virtual bool is_ejected(srs_utime_t now);
+};
+
+// The health table of servers, to passively eject the failed servers.
+class SrsLbHealth
+{
+private:
+    std::map<std::string, SrsLbServerHealth*> servers_;
+    // The base duration to eject a failed server, doubled by consecutive failures.
+    srs_utime_t eject_base_;
+    // The max duration to eject a failed server.
+    srs_utime_t eject_max_;
+public:
+    SrsLbHealth();
+    virtual ~SrsLbHealth();
+public:
+    virtual void set_eject(srs_utime_t base, srs_utime_t max);
+    // Fetch the health of server, create one if not exists.
+    virtual SrsLbServerHealth* fetch_or_create(const std::string& server);
+    virtual void on_success(const std::string& server, srs_utime_t rtt);
+    virtual void on_failure(const std::string& server, srs_utime_t now);
+    // Get all the server healthes, for api to dumps.
+    virtual std::map<std::string, SrsLbServerHealth*>& servers();
+};
+
+/**
+ * The health-aware load balance algorithm, never select the ejected server if
+ * there is any healthy one, and fallback to the server which ejects first.
+ */
+class SrsLbHealthAware : public ISrsLbBalancer
+{
+protected:
+    // The shared health table, not owned by us.
+    SrsLbHealth* health_;
+private:
+    int index_;
+    std::string elem_;
+public:
+    SrsLbHealthAware(SrsLbHealth* health);
+    virtual ~SrsLbHealthAware();
+public:
+    virtual uint32_t current();
+    virtual std::string selected();
+    virtual std::string select(const std::vector<std::string>& servers);
+public:
+    virtual void on_success(const std::string& server, srs_utime_t rtt);
+    virtual void on_failure(const std::string& server);
+protected:
+    // Select one from the healthy candidates, which is indexes of servers and never empty.
+    virtual int do_select(const std::vector<std::string>& servers, const std::vector<int>& candidates) = 0;
+};
+
+/**
+ * The power-of-two-choices algorithm, randomly pick two healthy servers,
+ * then select the one with smaller smoothed rtt.
+ */
+class SrsLbPowerOfTwo : public SrsLbHealthAware
+{
+public:
+    SrsLbPowerOfTwo(SrsLbHealth* health);
+    virtual ~SrsLbPowerOfTwo();
+protected:
+    virtual int do_select(const std::vector<std::string>& servers, const std::vector<int>& candidates);
+};
+
+/**
+ * The consistent hashing algorithm, by rendezvous(highest random weight) hashing of
+ * key, for example, the stream url. So all edges pull a stream from the same origin,
+ * and only the streams on a failed server are moved to others.
+ */
+class SrsLbConsistentHash : public SrsLbHealthAware
+{
+private:
+    std::string key_;
+public:
+    SrsLbConsistentHash(SrsLbHealth* health, std::string key);
+    virtual ~SrsLbConsistentHash();
+protected:
+    virtual int do_select(const std::vector<std::string>& servers, const std::vector<int>& candidates);
 };
 
 #endif
@@ -108,7 +108,9 @@
     XX(ERROR_SYSTEM_FILE_NOT_OPEN          , 1095, "FileNotOpen", "File is not opened") \
     XX(ERROR_SYSTEM_FILE_SETVBUF           , 1096, "FileSetVBuf", "Failed to set file vbuf") \
     XX(ERROR_NO_SOURCE                     , 1097, "NoSource", "No source found") \
-    XX(ERROR_STREAM_DISPOSING              , 1098, "StreamDisposing", "Stream is disposing")
+    XX(ERROR_STREAM_DISPOSING              , 1098, "StreamDisposing", "Stream is disposing") \
+    XX(ERROR_SOCKET_ZEROCOPY               , 1099, "SocketZeroCopy", "Failed to set socket option SO_ZEROCOPY") \
+    XX(ERROR_THREAD_JOIN                   , 1100, "ThreadJoin", "Failed to join the worker thread")
 
 /**************************************************/
 /* RTMP protocol error. */
@@ -336,7 +338,8 @@
     XX(ERROR_STREAM_CASTER_HEVC_FORMAT     , 4057, "CasterTsHevcFormat", "Invalid ts HEVC Format for stream caster") \
     XX(ERROR_HTTP_JSONP                    , 4058, "HttpJsonp", "Invalid callback for JSONP")   \
     XX(ERROR_HEVC_NALU_UEV                 , 4059, "HevcNaluUev", "Failed to read UEV for HEVC NALU") \
-    XX(ERROR_HEVC_NALU_SEV                 , 4060, "HevcNaluSev", "Failed to read SEV for HEVC NALU")
+    XX(ERROR_HEVC_NALU_SEV                 , 4060, "HevcNaluSev", "Failed to read SEV for HEVC NALU") \
+    XX(ERROR_HTTP_HOOKS_QUEUE_FULL         , 4061, "HttpHooksQueueFull", "The queue of async HTTP hooks is full")
 
 
 /**************************************************/
@@ -132,6 +132,19 @@ int64_t SrsFileWriter::tellg()
     return _srs_ftell_fn(fp_);
 }
 
+srs_error_t SrsFileWriter::flush()
+{
+    if (fp_ == NULL) {
+        return srs_error_new(ERROR_SYSTEM_FILE_NOT_OPEN, "file %s is not opened", path_.c_str());
+    }
+
+    if (::fflush(fp_) != 0) {
+        return srs_error_new(ERROR_SYSTEM_FILE_WRITE, "flush file %s failed", path_.c_str());
+    }
+
+    return srs_success;
+}
+
 srs_error_t SrsFileWriter::write(void* buf, size_t count, ssize_t* pnwrite)
 {
     srs_error_t err = srs_success;
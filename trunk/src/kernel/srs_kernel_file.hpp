@@ -57,6 +57,8 @@ public:
     virtual bool is_open();
     virtual void seek2(int64_t offset);
     virtual int64_t tellg();
+    // Flush the buffered data to file, so that readers see it immediately.
+    virtual srs_error_t flush();
 // Interface ISrsWriteSeeker
 public:
     virtual srs_error_t write(void* buf, size_t count, ssize_t* pnwrite);
@@ -18,6 +18,7 @@
 #include <string.h>
 #include <sstream>
 #include <iomanip>
+#include <algorithm>
 using namespace std;
 
 // For CentOS 6 or C++98, @see https://github.com/ossrs/srs/issues/2815
@@ -1659,6 +1660,11 @@ void SrsMp4MovieExtendsBox::set_trex(SrsMp4TrackExtendsBox* v)
     boxes.push_back(v);
 }
 
+void SrsMp4MovieExtendsBox::add_trex(SrsMp4TrackExtendsBox* v)
+{
+    boxes.push_back(v);
+}
+
 SrsMp4TrackExtendsBox::SrsMp4TrackExtendsBox()
 {
     type = SrsMp4BoxTypeTREX;
@@ -5006,12 +5012,13 @@ srs_error_t SrsMp4SampleManager::write(SrsMp4MovieFragmentBox* moof, uint64_t dt
         SrsMp4Sample* sample = *it;
         SrsMp4TrunEntry* entry = new SrsMp4TrunEntry(trun);
         
-        if (!previous) {
-            previous = sample;
+        // For CMAF chunk, the first video sample might not be a keyframe.
+        if (!previous && (sample->type != SrsFrameTypeVideo || sample->frame_type == SrsVideoAvcFrameTypeKeyFrame)) {
             entry->sample_flags = 0x02000000;
         } else {
             entry->sample_flags = 0x01000000;
         }
+        previous = sample;
         
         vector<SrsMp4Sample*>::iterator iter = (it + 1);
         if (iter == samples.end()) {
@@ -5086,6 +5093,8 @@ srs_error_t SrsMp4SampleManager::write_track(SrsFrameType track,
                 ctts->version = 0x01;
             }
             if (ctts_entry.sample_count == 0 || ctts_entry.sample_offset == offset) {
+                // The first sample also defines the offset of the first CTTS entry.
+                ctts_entry.sample_offset = offset;
                 ctts_entry.sample_count++;
             } else {
                 ctts_entries.push_back(ctts_entry);
@@ -5718,6 +5727,12 @@ SrsMp4Encoder::SrsMp4Encoder()
     samples = new SrsMp4SampleManager();
     aduration = vduration = 0;
     width = height = 0;
+    fragment = 0;
+    index = NULL;
+    moov_written = false;
+    sequence_number = 1;
+    fragment_dts = 0;
+    vtrack_id = atrack_id = 0;
     
     acodec = SrsAudioCodecIdForbidden;
     sample_rate = SrsAudioSampleRateForbidden;
@@ -5807,6 +5822,33 @@ srs_error_t SrsMp4Encoder::initialize(ISrsWriteSeeker* ws)
     return err;
 }
 
+srs_error_t SrsMp4Encoder::initialize(ISrsWriteSeeker* ws, srs_utime_t fragment, ISrsWriter* idx)
+{
+    srs_error_t err = srs_success;
+
+    // Use classic MP4 if no fragment.
+    if (!fragment) {
+        return initialize(ws);
+    }
+
+    wsio = ws;
+    index = idx;
+    this->fragment = fragment;
+
+    // Write ftyp box, the moov is written with the first fragment, when got sequence headers.
+    SrsUniquePtr<SrsMp4FileTypeBox> ftyp(new SrsMp4FileTypeBox());
+
+    ftyp->major_brand = SrsMp4BoxBrandISO5;
+    ftyp->minor_version = 512;
+    ftyp->set_compatible_brands(SrsMp4BoxBrandISO6, SrsMp4BoxBrandMP41);
+
+    if ((err = srs_mp4_write_box(wsio, ftyp.get())) != srs_success) {
+        return srs_error_wrap(err, "write ftyp");
+    }
+
+    return err;
+}
+
 srs_error_t SrsMp4Encoder::write_sample(
     SrsFormat* format, SrsMp4HandlerType ht, uint16_t ft, uint16_t ct, uint32_t dts, uint32_t pts,
     uint8_t* sample, uint32_t nb_sample
@@ -5840,6 +5882,31 @@ srs_error_t SrsMp4Encoder::write_sample(
     ps->tbn = 1000;
     ps->dts = dts;
     ps->pts = pts;
+
+    // For fMP4, cache the samples of fragment, because the moof should be written before mdat.
+    if (fragment) {
+        // Reap the fragment at keyframe, or any sample for pure audio.
+        bool keyframe = (ps->type == SrsFrameTypeVideo && ps->frame_type == SrsVideoAvcFrameTypeKeyFrame);
+        bool pure_audio = (!nb_videos && pavcc.empty() && phvcc.empty());
+        if (!samples->samples.empty() && (keyframe || pure_audio) && dts >= fragment_dts + srsu2ms(fragment)) {
+            if ((err = flush_fragment(dts)) != srs_success) {
+                srs_freep(ps);
+                return srs_error_wrap(err, "flush fragment");
+            }
+        }
+
+        if (samples->samples.empty()) {
+            fragment_dts = dts;
+        }
+
+        // We should copy the sample data, which is shared ptr from video/audio message.
+        ps->data = new uint8_t[nb_sample];
+        memcpy(ps->data, sample, nb_sample);
+        ps->nb_data = nb_sample;
+
+        samples->append(ps);
+        return err;
+    }
     
     if ((err = do_write_sample(ps, sample, nb_sample)) != srs_success) {
         srs_freep(ps);
@@ -5859,191 +5926,18 @@ srs_error_t SrsMp4Encoder::flush()
     if (!nb_audios && !nb_videos) {
         return srs_error_new(ERROR_MP4_ILLEGAL_MOOV, "Missing audio and video track");
     }
+
+    // For fMP4, flush the last fragment, and there is no moov at the end.
+    if (fragment) {
+        return flush_fragment(srs_max(vduration, aduration));
+    }
     
     // Write moov.
     if (true) {
         SrsUniquePtr<SrsMp4MovieBox> moov(new SrsMp4MovieBox());
 
-        SrsMp4MovieHeaderBox* mvhd = new SrsMp4MovieHeaderBox();
-        moov->set_mvhd(mvhd);
-        
-        mvhd->timescale = 1000; // Use tbn ms.
-        mvhd->duration_in_tbn = srs_max(vduration, aduration);
-        mvhd->next_track_ID = 1; // Starts from 1, increase when use it.
-        
-        if (nb_videos || !pavcc.empty() || !phvcc.empty()) {
-            SrsMp4TrackBox* trak = new SrsMp4TrackBox();
-            moov->add_trak(trak);
-
-            SrsMp4EditBox* edts = new SrsMp4EditBox();
-            trak->set_edts(edts);
-
-            SrsMp4EditListBox* elst = new SrsMp4EditListBox();
-            edts->set_elst(elst);
-            elst->version = 0;
-
-            SrsMp4ElstEntry entry;
-            entry.segment_duration = mvhd->duration_in_tbn;
-            entry.media_rate_integer = 1;
-            elst->entries.push_back(entry);
-            
-            SrsMp4TrackHeaderBox* tkhd = new SrsMp4TrackHeaderBox();
-            trak->set_tkhd(tkhd);
-            
-            tkhd->track_ID = mvhd->next_track_ID++;
-            tkhd->duration = vduration;
-            tkhd->width = (width << 16);
-            tkhd->height = (height << 16);
-            
-            SrsMp4MediaBox* mdia = new SrsMp4MediaBox();
-            trak->set_mdia(mdia);
-            
-            SrsMp4MediaHeaderBox* mdhd = new SrsMp4MediaHeaderBox();
-            mdia->set_mdhd(mdhd);
-            
-            mdhd->timescale = 1000;
-            mdhd->duration = vduration;
-            mdhd->set_language0('u');
-            mdhd->set_language1('n');
-            mdhd->set_language2('d');
-            
-            SrsMp4HandlerReferenceBox* hdlr = new SrsMp4HandlerReferenceBox();
-            mdia->set_hdlr(hdlr);
-            
-            hdlr->handler_type = SrsMp4HandlerTypeVIDE;
-            hdlr->name = "VideoHandler";
-            
-            SrsMp4MediaInformationBox* minf = new SrsMp4MediaInformationBox();
-            mdia->set_minf(minf);
-            
-            SrsMp4VideoMeidaHeaderBox* vmhd = new SrsMp4VideoMeidaHeaderBox();
-            minf->set_vmhd(vmhd);
-            
-            SrsMp4DataInformationBox* dinf = new SrsMp4DataInformationBox();
-            minf->set_dinf(dinf);
-            
-            SrsMp4DataReferenceBox* dref = new SrsMp4DataReferenceBox();
-            dinf->set_dref(dref);
-            
-            SrsMp4DataEntryBox* url = new SrsMp4DataEntryUrlBox();
-            dref->append(url);
-            
-            SrsMp4SampleTableBox* stbl = new SrsMp4SampleTableBox();
-            minf->set_stbl(stbl);
-            
-            SrsMp4SampleDescriptionBox* stsd = new SrsMp4SampleDescriptionBox();
-            stbl->set_stsd(stsd);
-
-            if (vcodec == SrsVideoCodecIdAVC) {
-                SrsMp4VisualSampleEntry* avc1 = new SrsMp4VisualSampleEntry(SrsMp4BoxTypeAVC1);
-                stsd->append(avc1);
-
-                avc1->width = width;
-                avc1->height = height;
-                avc1->data_reference_index = 1;
-
-                SrsMp4AvccBox* avcC = new SrsMp4AvccBox();
-                avc1->set_avcC(avcC);
-
-                avcC->avc_config = pavcc;
-            } else {
-                SrsMp4VisualSampleEntry* hev1 = new SrsMp4VisualSampleEntry(SrsMp4BoxTypeHEV1);
-                stsd->append(hev1);
-
-                hev1->width = width;
-                hev1->height = height;
-                hev1->data_reference_index = 1;
-
-                SrsMp4HvcCBox* hvcC = new SrsMp4HvcCBox();
-                hev1->set_hvcC(hvcC);
+        build_moov(moov.get());
 
-                hvcC->hevc_config = phvcc;
-            }
-        }
-        
-        if (nb_audios || !pasc.empty()) {
-            SrsMp4TrackBox* trak = new SrsMp4TrackBox();
-            moov->add_trak(trak);
-            
-            SrsMp4TrackHeaderBox* tkhd = new SrsMp4TrackHeaderBox();
-            tkhd->volume = 0x0100;
-            trak->set_tkhd(tkhd);
-            
-            tkhd->track_ID = mvhd->next_track_ID++;
-            tkhd->duration = aduration;
-            
-            SrsMp4MediaBox* mdia = new SrsMp4MediaBox();
-            trak->set_mdia(mdia);
-            
-            SrsMp4MediaHeaderBox* mdhd = new SrsMp4MediaHeaderBox();
-            mdia->set_mdhd(mdhd);
-            
-            mdhd->timescale = 1000;
-            mdhd->duration = aduration;
-            mdhd->set_language0('u');
-            mdhd->set_language1('n');
-            mdhd->set_language2('d');
-            
-            SrsMp4HandlerReferenceBox* hdlr = new SrsMp4HandlerReferenceBox();
-            mdia->set_hdlr(hdlr);
-            
-            hdlr->handler_type = SrsMp4HandlerTypeSOUN;
-            hdlr->name = "SoundHandler";
-            
-            SrsMp4MediaInformationBox* minf = new SrsMp4MediaInformationBox();
-            mdia->set_minf(minf);
-            
-            SrsMp4SoundMeidaHeaderBox* smhd = new SrsMp4SoundMeidaHeaderBox();
-            minf->set_smhd(smhd);
-            
-            SrsMp4DataInformationBox* dinf = new SrsMp4DataInformationBox();
-            minf->set_dinf(dinf);
-            
-            SrsMp4DataReferenceBox* dref = new SrsMp4DataReferenceBox();
-            dinf->set_dref(dref);
-            
-            SrsMp4DataEntryBox* url = new SrsMp4DataEntryUrlBox();
-            dref->append(url);
-            
-            SrsMp4SampleTableBox* stbl = new SrsMp4SampleTableBox();
-            minf->set_stbl(stbl);
-            
-            SrsMp4SampleDescriptionBox* stsd = new SrsMp4SampleDescriptionBox();
-            stbl->set_stsd(stsd);
-            
-            SrsMp4AudioSampleEntry* mp4a = new SrsMp4AudioSampleEntry();
-            mp4a->data_reference_index = 1;
-            mp4a->samplerate = srs_audio_sample_rate2number(sample_rate);
-            if (sound_bits == SrsAudioSampleBits16bit) {
-                mp4a->samplesize = 16;
-            } else {
-                mp4a->samplesize = 8;
-            }
-            if (channels == SrsAudioChannelsStereo) {
-                mp4a->channelcount = 2;
-            } else {
-                mp4a->channelcount = 1;
-            }
-            stsd->append(mp4a);
-            
-            SrsMp4EsdsBox* esds = new SrsMp4EsdsBox();
-            mp4a->set_esds(esds);
-            
-            SrsMp4ES_Descriptor* es = esds->es;
-            es->ES_ID = 0x02;
-            
-            SrsMp4DecoderConfigDescriptor& desc = es->decConfigDescr;
-            desc.objectTypeIndication = get_audio_object_type();
-            desc.streamType = SrsMp4StreamTypeAudioStream;
-            srs_freep(desc.decSpecificInfo);
-            
-            if (SrsMp4ObjectTypeAac == desc.objectTypeIndication) {
-                SrsMp4DecoderSpecificInfo* asc = new SrsMp4DecoderSpecificInfo();
-                desc.decSpecificInfo = asc;
-                asc->asc = pasc;
-            }
-        }
-        
         if ((err = samples->write(moov.get())) != srs_success) {
             return srs_error_wrap(err, "write samples");
         }
@@ -6105,54 +5999,263 @@ srs_error_t SrsMp4Encoder::flush()
     return err;
 }
 
-srs_error_t SrsMp4Encoder::copy_sequence_header(SrsFormat* format, bool vsh, uint8_t* sample, uint32_t nb_sample)
+void SrsMp4Encoder::build_moov(SrsMp4MovieBox* moov)
 {
-    srs_error_t err = srs_success;
+    // For fMP4, the duration is unknown when writing moov.
+    uint64_t vduration = fragment? 0 : this->vduration;
+    uint64_t aduration = fragment? 0 : this->aduration;
 
-    if (vsh) {
-        // AVC
-        if (format->vcodec->id == SrsVideoCodecIdAVC && !pavcc.empty()) {
-            if (nb_sample == (uint32_t)pavcc.size() && srs_bytes_equals(sample, &pavcc[0], (int)pavcc.size())) {
-                return err;
-            }
+    SrsMp4MovieHeaderBox* mvhd = new SrsMp4MovieHeaderBox();
+    moov->set_mvhd(mvhd);
+    
+    mvhd->timescale = 1000; // Use tbn ms.
+    mvhd->duration_in_tbn = srs_max(vduration, aduration);
+    mvhd->next_track_ID = 1; // Starts from 1, increase when use it.
+    
+    if (nb_videos || !pavcc.empty() || !phvcc.empty()) {
+        SrsMp4TrackBox* trak = new SrsMp4TrackBox();
+        moov->add_trak(trak);
 
-            return srs_error_new(ERROR_MP4_AVCC_CHANGE, "doesn't support avcc change");
-        }
-        // HEVC
-        if (format->vcodec->id == SrsVideoCodecIdHEVC && !phvcc.empty()) {
-            if (nb_sample == (uint32_t)phvcc.size() && srs_bytes_equals(sample, &phvcc[0], (int)phvcc.size())) {
-                return err;
-            }
+        // For fMP4, the duration is unknown, so there is no edit list.
+        if (!fragment) {
+            SrsMp4EditBox* edts = new SrsMp4EditBox();
+            trak->set_edts(edts);
 
-            return srs_error_new(ERROR_MP4_HVCC_CHANGE, "doesn't support hvcC change");
-        }
-    }
-    
-    if (!vsh && !pasc.empty()) {
-        if (nb_sample == (uint32_t)pasc.size() && srs_bytes_equals(sample, &pasc[0], (int)pasc.size())) {
-            return err;
+            SrsMp4EditListBox* elst = new SrsMp4EditListBox();
+            edts->set_elst(elst);
+            elst->version = 0;
+
+            SrsMp4ElstEntry entry;
+            entry.segment_duration = mvhd->duration_in_tbn;
+            entry.media_rate_integer = 1;
+            elst->entries.push_back(entry);
         }
         
-        return srs_error_new(ERROR_MP4_ASC_CHANGE, "doesn't support asc change");
-    }
-    
-    if (vsh) {
-        if (format->vcodec->id == SrsVideoCodecIdHEVC) {
-            phvcc = std::vector<char>(sample, sample + nb_sample);
+        SrsMp4TrackHeaderBox* tkhd = new SrsMp4TrackHeaderBox();
+        trak->set_tkhd(tkhd);
+        
+        tkhd->track_ID = vtrack_id = mvhd->next_track_ID++;
+        tkhd->duration = vduration;
+        tkhd->width = (width << 16);
+        tkhd->height = (height << 16);
+        
+        SrsMp4MediaBox* mdia = new SrsMp4MediaBox();
+        trak->set_mdia(mdia);
+        
+        SrsMp4MediaHeaderBox* mdhd = new SrsMp4MediaHeaderBox();
+        mdia->set_mdhd(mdhd);
+        
+        mdhd->timescale = 1000;
+        mdhd->duration = vduration;
+        mdhd->set_language0('u');
+        mdhd->set_language1('n');
+        mdhd->set_language2('d');
+        
+        SrsMp4HandlerReferenceBox* hdlr = new SrsMp4HandlerReferenceBox();
+        mdia->set_hdlr(hdlr);
+        
+        hdlr->handler_type = SrsMp4HandlerTypeVIDE;
+        hdlr->name = "VideoHandler";
+        
+        SrsMp4MediaInformationBox* minf = new SrsMp4MediaInformationBox();
+        mdia->set_minf(minf);
+        
+        SrsMp4VideoMeidaHeaderBox* vmhd = new SrsMp4VideoMeidaHeaderBox();
+        minf->set_vmhd(vmhd);
+        
+        SrsMp4DataInformationBox* dinf = new SrsMp4DataInformationBox();
+        minf->set_dinf(dinf);
+        
+        SrsMp4DataReferenceBox* dref = new SrsMp4DataReferenceBox();
+        dinf->set_dref(dref);
+        
+        SrsMp4DataEntryBox* url = new SrsMp4DataEntryUrlBox();
+        dref->append(url);
+        
+        SrsMp4SampleTableBox* stbl = new SrsMp4SampleTableBox();
+        minf->set_stbl(stbl);
+        
+        SrsMp4SampleDescriptionBox* stsd = new SrsMp4SampleDescriptionBox();
+        stbl->set_stsd(stsd);
+
+        if (vcodec == SrsVideoCodecIdAVC) {
+            SrsMp4VisualSampleEntry* avc1 = new SrsMp4VisualSampleEntry(SrsMp4BoxTypeAVC1);
+            stsd->append(avc1);
+
+            avc1->width = width;
+            avc1->height = height;
+            avc1->data_reference_index = 1;
+
+            SrsMp4AvccBox* avcC = new SrsMp4AvccBox();
+            avc1->set_avcC(avcC);
+
+            avcC->avc_config = pavcc;
         } else {
-            pavcc = std::vector<char>(sample, sample + nb_sample);
-        }
-        if (format && format->vcodec) {
-            width = format->vcodec->width;
-            height = format->vcodec->height;
+            SrsMp4VisualSampleEntry* hev1 = new SrsMp4VisualSampleEntry(SrsMp4BoxTypeHEV1);
+            stsd->append(hev1);
+
+            hev1->width = width;
+            hev1->height = height;
+            hev1->data_reference_index = 1;
+
+            SrsMp4HvcCBox* hvcC = new SrsMp4HvcCBox();
+            hev1->set_hvcC(hvcC);
+
+            hvcC->hevc_config = phvcc;
         }
     }
     
-    if (!vsh) {
-        pasc = std::vector<char>(sample, sample + nb_sample);
-    }
-    
-    return err;
+    if (nb_audios || !pasc.empty()) {
+        SrsMp4TrackBox* trak = new SrsMp4TrackBox();
+        moov->add_trak(trak);
+        
+        SrsMp4TrackHeaderBox* tkhd = new SrsMp4TrackHeaderBox();
+        tkhd->volume = 0x0100;
+        trak->set_tkhd(tkhd);
+        
+        tkhd->track_ID = atrack_id = mvhd->next_track_ID++;
+        tkhd->duration = aduration;
+        
+        SrsMp4MediaBox* mdia = new SrsMp4MediaBox();
+        trak->set_mdia(mdia);
+        
+        SrsMp4MediaHeaderBox* mdhd = new SrsMp4MediaHeaderBox();
+        mdia->set_mdhd(mdhd);
+        
+        mdhd->timescale = 1000;
+        mdhd->duration = aduration;
+        mdhd->set_language0('u');
+        mdhd->set_language1('n');
+        mdhd->set_language2('d');
+        
+        SrsMp4HandlerReferenceBox* hdlr = new SrsMp4HandlerReferenceBox();
+        mdia->set_hdlr(hdlr);
+        
+        hdlr->handler_type = SrsMp4HandlerTypeSOUN;
+        hdlr->name = "SoundHandler";
+        
+        SrsMp4MediaInformationBox* minf = new SrsMp4MediaInformationBox();
+        mdia->set_minf(minf);
+        
+        SrsMp4SoundMeidaHeaderBox* smhd = new SrsMp4SoundMeidaHeaderBox();
+        minf->set_smhd(smhd);
+        
+        SrsMp4DataInformationBox* dinf = new SrsMp4DataInformationBox();
+        minf->set_dinf(dinf);
+        
+        SrsMp4DataReferenceBox* dref = new SrsMp4DataReferenceBox();
+        dinf->set_dref(dref);
+        
+        SrsMp4DataEntryBox* url = new SrsMp4DataEntryUrlBox();
+        dref->append(url);
+        
+        SrsMp4SampleTableBox* stbl = new SrsMp4SampleTableBox();
+        minf->set_stbl(stbl);
+        
+        SrsMp4SampleDescriptionBox* stsd = new SrsMp4SampleDescriptionBox();
+        stbl->set_stsd(stsd);
+        
+        SrsMp4AudioSampleEntry* mp4a = new SrsMp4AudioSampleEntry();
+        mp4a->data_reference_index = 1;
+        mp4a->samplerate = srs_audio_sample_rate2number(sample_rate);
+        if (sound_bits == SrsAudioSampleBits16bit) {
+            mp4a->samplesize = 16;
+        } else {
+            mp4a->samplesize = 8;
+        }
+        if (channels == SrsAudioChannelsStereo) {
+            mp4a->channelcount = 2;
+        } else {
+            mp4a->channelcount = 1;
+        }
+        stsd->append(mp4a);
+        
+        SrsMp4EsdsBox* esds = new SrsMp4EsdsBox();
+        mp4a->set_esds(esds);
+        
+        SrsMp4ES_Descriptor* es = esds->es;
+        es->ES_ID = 0x02;
+        
+        SrsMp4DecoderConfigDescriptor& desc = es->decConfigDescr;
+        desc.objectTypeIndication = get_audio_object_type();
+        desc.streamType = SrsMp4StreamTypeAudioStream;
+        srs_freep(desc.decSpecificInfo);
+        
+        if (SrsMp4ObjectTypeAac == desc.objectTypeIndication) {
+            SrsMp4DecoderSpecificInfo* asc = new SrsMp4DecoderSpecificInfo();
+            desc.decSpecificInfo = asc;
+            asc->asc = pasc;
+        }
+    }
+
+    // For fMP4, the samples are described by moof.
+    if (fragment) {
+        SrsMp4MovieExtendsBox* mvex = new SrsMp4MovieExtendsBox();
+        moov->set_mvex(mvex);
+
+        uint32_t tids[] = {vtrack_id, atrack_id};
+        for (int i = 0; i < 2; i++) {
+            if (!tids[i]) {
+                continue;
+            }
+
+            SrsMp4TrackExtendsBox* trex = new SrsMp4TrackExtendsBox();
+            mvex->add_trex(trex);
+
+            trex->track_ID = tids[i];
+            trex->default_sample_description_index = 1;
+        }
+    }
+}
+
+srs_error_t SrsMp4Encoder::copy_sequence_header(SrsFormat* format, bool vsh, uint8_t* sample, uint32_t nb_sample)
+{
+    srs_error_t err = srs_success;
+
+    if (vsh) {
+        // AVC
+        if (format->vcodec->id == SrsVideoCodecIdAVC && !pavcc.empty()) {
+            if (nb_sample == (uint32_t)pavcc.size() && srs_bytes_equals(sample, &pavcc[0], (int)pavcc.size())) {
+                return err;
+            }
+
+            return srs_error_new(ERROR_MP4_AVCC_CHANGE, "doesn't support avcc change");
+        }
+        // HEVC
+        if (format->vcodec->id == SrsVideoCodecIdHEVC && !phvcc.empty()) {
+            if (nb_sample == (uint32_t)phvcc.size() && srs_bytes_equals(sample, &phvcc[0], (int)phvcc.size())) {
+                return err;
+            }
+
+            return srs_error_new(ERROR_MP4_HVCC_CHANGE, "doesn't support hvcC change");
+        }
+    }
+    
+    if (!vsh && !pasc.empty()) {
+        if (nb_sample == (uint32_t)pasc.size() && srs_bytes_equals(sample, &pasc[0], (int)pasc.size())) {
+            return err;
+        }
+        
+        return srs_error_new(ERROR_MP4_ASC_CHANGE, "doesn't support asc change");
+    }
+    
+    if (vsh) {
+        if (format->vcodec->id == SrsVideoCodecIdHEVC) {
+            phvcc = std::vector<char>(sample, sample + nb_sample);
+        } else {
+            pavcc = std::vector<char>(sample, sample + nb_sample);
+        }
+        if (format && format->vcodec) {
+            width = format->vcodec->width;
+            height = format->vcodec->height;
+        }
+    }
+    
+    if (!vsh) {
+        pasc = std::vector<char>(sample, sample + nb_sample);
+    }
+    
+    return err;
 }
 
 srs_error_t SrsMp4Encoder::do_write_sample(SrsMp4Sample* ps, uint8_t* sample, uint32_t nb_sample)
@@ -6190,6 +6293,483 @@ SrsMp4ObjectType SrsMp4Encoder::get_audio_object_type()
     }
 }
 
+srs_error_t SrsMp4Encoder::flush_fragment(uint64_t dts)
+{
+    srs_error_t err = srs_success;
+
+    if (samples->samples.empty()) {
+        return err;
+    }
+
+    // Write the moov with the tracks by sequence headers, before the first moof.
+    if (!moov_written) {
+        SrsUniquePtr<SrsMp4MovieBox> moov(new SrsMp4MovieBox());
+        build_moov(moov.get());
+
+        // Write the empty sample tables, which are required by stbl.
+        SrsMp4SampleManager empty;
+        if ((err = empty.write(moov.get())) != srs_success) {
+            return srs_error_wrap(err, "write samples");
+        }
+
+        if ((err = srs_mp4_write_box(wsio, moov.get())) != srs_success) {
+            return srs_error_wrap(err, "write moov");
+        }
+        moov_written = true;
+    }
+
+    // Write a moof and mdat for each track, and the samples are freed after written.
+    std::vector<SrsMp4Sample*> videos, audios;
+    for (int i = 0; i < (int)samples->samples.size(); i++) {
+        SrsMp4Sample* sample = samples->samples.at(i);
+        if (sample->type == SrsFrameTypeVideo) {
+            videos.push_back(sample);
+        } else {
+            audios.push_back(sample);
+        }
+    }
+
+    if (vtrack_id && (err = write_moof(vtrack_id, videos, dts)) != srs_success) {
+        return srs_error_wrap(err, "write video");
+    }
+
+    if (atrack_id && (err = write_moof(atrack_id, audios, dts)) != srs_success) {
+        return srs_error_wrap(err, "write audio");
+    }
+
+    srs_freep(samples);
+    samples = new SrsMp4SampleManager();
+
+    return err;
+}
+
+srs_error_t SrsMp4Encoder::write_moof(uint32_t tid, std::vector<SrsMp4Sample*>& track, uint64_t dts)
+{
+    srs_error_t err = srs_success;
+
+    if (track.empty()) {
+        return err;
+    }
+
+    // The offset of moof, to build the index of samples.
+    off_t offset = 0;
+    if ((err = wsio->lseek(0, SEEK_CUR, &offset)) != srs_success) {
+        return srs_error_wrap(err, "seek to moof");
+    }
+
+    uint64_t mdat_bytes = 0;
+    for (int i = 0; i < (int)track.size(); i++) {
+        mdat_bytes += track.at(i)->nb_data;
+    }
+
+    SrsUniquePtr<SrsMp4MediaDataBox> mdat(new SrsMp4MediaDataBox());
+    mdat->nb_data = mdat_bytes;
+
+    SrsUniquePtr<SrsMp4MovieFragmentBox> moof(new SrsMp4MovieFragmentBox());
+
+    SrsMp4MovieFragmentHeaderBox* mfhd = new SrsMp4MovieFragmentHeaderBox();
+    moof->set_mfhd(mfhd);
+    mfhd->sequence_number = sequence_number++;
+
+    SrsMp4TrackFragmentBox* traf = new SrsMp4TrackFragmentBox();
+    moof->set_traf(traf);
+
+    SrsMp4TrackFragmentHeaderBox* tfhd = new SrsMp4TrackFragmentHeaderBox();
+    traf->set_tfhd(tfhd);
+    tfhd->track_id = tid;
+    tfhd->flags = SrsMp4TfhdFlagsDefaultBaseIsMoof;
+
+    SrsMp4TrackFragmentDecodeTimeBox* tfdt = new SrsMp4TrackFragmentDecodeTimeBox();
+    traf->set_tfdt(tfdt);
+    tfdt->version = 1;
+    tfdt->base_media_decode_time = track.at(0)->dts;
+
+    SrsMp4TrackFragmentRunBox* trun = new SrsMp4TrackFragmentRunBox();
+    traf->set_trun(trun);
+
+    // Borrow the samples to build the trun, the end dts is never less than the last sample.
+    if (true) {
+        SrsMp4SampleManager manager;
+        manager.samples = track;
+        err = manager.write(moof.get(), srs_max(dts, track.back()->dts));
+        manager.samples.clear();
+
+        if (err != srs_success) {
+            return srs_error_wrap(err, "write samples");
+        }
+    }
+
+    // @remark The data_offset of trun is size(moof)+header(mdat).
+    trun->data_offset = (int32_t)(moof->nb_bytes() + mdat->sz_header());
+
+    if ((err = srs_mp4_write_box(wsio, moof.get())) != srs_success) {
+        return srs_error_wrap(err, "write moof");
+    }
+
+    if (true) {
+        int nb_data = mdat->sz_header();
+        SrsUniquePtr<uint8_t[]> data(new uint8_t[nb_data]);
+
+        SrsUniquePtr<SrsBuffer> buffer(new SrsBuffer((char*)data.get(), nb_data));
+        if ((err = mdat->encode(buffer.get())) != srs_success) {
+            return srs_error_wrap(err, "encode mdat");
+        }
+
+        if ((err = wsio->write(data.get(), nb_data, NULL)) != srs_success) {
+            return srs_error_wrap(err, "write mdat");
+        }
+    }
+
+    for (int i = 0; i < (int)track.size(); i++) {
+        SrsMp4Sample* sample = track.at(i);
+        if ((err = wsio->write(sample->data, sample->nb_data, NULL)) != srs_success) {
+            return srs_error_wrap(err, "write sample");
+        }
+    }
+
+    // Write the index of samples of fragment, by one write.
+    if (index) {
+        int nb_index = SRS_MP4_INDEX_ENTRY_SIZE * (int)track.size();
+        std::vector<char> data(nb_index);
+        SrsBuffer buffer(&data[0], nb_index);
+
+        off_t pos = offset + trun->data_offset;
+        for (int i = 0; i < (int)track.size(); i++) {
+            SrsMp4Sample* sample = track.at(i);
+
+            buffer.write_1bytes((int8_t)sample->type);
+            buffer.write_1bytes((int8_t)sample->frame_type);
+            buffer.write_2bytes(0);
+            buffer.write_4bytes((int32_t)sample->nb_data);
+            buffer.write_8bytes((int64_t)pos);
+            buffer.write_4bytes((int32_t)sample->dts);
+            buffer.write_4bytes((int32_t)(sample->pts - sample->dts));
+
+            pos += sample->nb_data;
+        }
+
+        if ((err = index->write(&data[0], nb_index, NULL)) != srs_success) {
+            return srs_error_wrap(err, "write index");
+        }
+    }
+
+    return err;
+}
+
+// Read exactly size bytes from reader.
+srs_error_t srs_mp4_read_fully(ISrsReader* r, void* buf, size_t size)
+{
+    srs_error_t err = srs_success;
+
+    size_t nb_read = 0;
+    while (nb_read < size) {
+        ssize_t nn = 0;
+        if ((err = r->read((char*)buf + nb_read, size - nb_read, &nn)) != srs_success) {
+            return srs_error_wrap(err, "read %d/%d bytes", (int)nb_read, (int)size);
+        }
+        nb_read += nn;
+    }
+
+    return err;
+}
+
+SrsMp4Finalizer::SrsMp4Finalizer()
+{
+}
+
+SrsMp4Finalizer::~SrsMp4Finalizer()
+{
+}
+
+srs_error_t SrsMp4Finalizer::finalize(ISrsReadSeeker* fmp4, ISrsReader* idx, ISrsWriter* out)
+{
+    srs_error_t err = srs_success;
+
+    std::vector<char> raw;
+    if ((err = read_moov(fmp4, raw)) != srs_success) {
+        return srs_error_wrap(err, "read moov");
+    }
+
+    // The offset of samples in fMP4, and the samples for new offsets in classic MP4.
+    std::vector<off_t> offsets;
+    SrsUniquePtr<SrsMp4SampleManager> samples(new SrsMp4SampleManager());
+    if ((err = load_index(idx, samples.get(), offsets)) != srs_success) {
+        return srs_error_wrap(err, "load index");
+    }
+
+    if (samples->samples.empty()) {
+        return srs_error_new(ERROR_MP4_ILLEGAL_SAMPLES, "no samples");
+    }
+
+    SrsUniquePtr<SrsMp4FileTypeBox> ftyp(new SrsMp4FileTypeBox());
+    ftyp->major_brand = SrsMp4BoxBrandISOM;
+    ftyp->minor_version = 512;
+    ftyp->set_compatible_brands(SrsMp4BoxBrandISOM, SrsMp4BoxBrandISO2, SrsMp4BoxBrandMP41);
+
+    uint64_t mdat_bytes = 0;
+    for (int i = 0; i < (int)samples->samples.size(); i++) {
+        mdat_bytes += samples->samples.at(i)->nb_data;
+    }
+
+    SrsUniquePtr<SrsMp4MediaDataBox> mdat(new SrsMp4MediaDataBox());
+    mdat->nb_data = mdat_bytes;
+    mdat->update_size();
+
+    // The offsets of samples depends on the size of moov, which depends on whether use co64 for
+    // large offsets, so we build the moov util its size is stable.
+    SrsMp4MovieBox* moov = NULL;
+    uint64_t moov_bytes = 0;
+    for (int i = 0; i < 4; i++) {
+        off_t offset = ftyp->nb_bytes() + moov_bytes + mdat->sz_header();
+        for (int j = 0; j < (int)samples->samples.size(); j++) {
+            SrsMp4Sample* sample = samples->samples.at(j);
+            sample->offset = offset;
+            offset += sample->nb_data;
+        }
+
+        srs_freep(moov);
+        if ((err = build_moov(raw, samples.get(), &moov)) != srs_success) {
+            return srs_error_wrap(err, "build moov");
+        }
+
+        if (moov->nb_bytes() == moov_bytes) {
+            break;
+        }
+        moov_bytes = moov->nb_bytes();
+    }
+    SrsUniquePtr<SrsMp4MovieBox> moov_uptr(moov);
+
+    if (moov->nb_bytes() != moov_bytes) {
+        return srs_error_new(ERROR_MP4_ILLEGAL_MOOV, "moov size unstable");
+    }
+
+    if ((err = srs_mp4_write_box(out, ftyp.get())) != srs_success) {
+        return srs_error_wrap(err, "write ftyp");
+    }
+
+    if ((err = srs_mp4_write_box(out, moov)) != srs_success) {
+        return srs_error_wrap(err, "write moov");
+    }
+
+    if (true) {
+        int nb_data = mdat->sz_header();
+        SrsUniquePtr<uint8_t[]> data(new uint8_t[nb_data]);
+
+        SrsUniquePtr<SrsBuffer> buffer(new SrsBuffer((char*)data.get(), nb_data));
+        if ((err = mdat->encode(buffer.get())) != srs_success) {
+            return srs_error_wrap(err, "encode mdat");
+        }
+
+        if ((err = out->write(data.get(), nb_data, NULL)) != srs_success) {
+            return srs_error_wrap(err, "write mdat");
+        }
+    }
+
+    if ((err = copy_samples(fmp4, samples.get(), offsets, out)) != srs_success) {
+        return srs_error_wrap(err, "copy samples");
+    }
+
+    return err;
+}
+
+srs_error_t SrsMp4Finalizer::read_moov(ISrsReadSeeker* fmp4, std::vector<char>& moov)
+{
+    srs_error_t err = srs_success;
+
+    if ((err = fmp4->lseek(0, SEEK_SET, NULL)) != srs_success) {
+        return srs_error_wrap(err, "seek to start");
+    }
+
+    // The moov is written before any moof and mdat, so we never parse the large size.
+    while (true) {
+        char header[8];
+        if ((err = srs_mp4_read_fully(fmp4, header, sizeof(header))) != srs_success) {
+            return srs_error_wrap(err, "read box header");
+        }
+
+        SrsBuffer buf(header, sizeof(header));
+        uint32_t size = (uint32_t)buf.read_4bytes();
+        SrsMp4BoxType type = (SrsMp4BoxType)buf.read_4bytes();
+        if (size < 8) {
+            return srs_error_new(ERROR_MP4_ILLEGAL_MOOV, "invalid box size=%u", size);
+        }
+
+        if (type != SrsMp4BoxTypeMOOV) {
+            if (type == SrsMp4BoxTypeMOOF || type == SrsMp4BoxTypeMDAT) {
+                return srs_error_new(ERROR_MP4_ILLEGAL_MOOV, "no moov");
+            }
+            if ((err = fmp4->lseek(size - 8, SEEK_CUR, NULL)) != srs_success) {
+                return srs_error_wrap(err, "skip box");
+            }
+            continue;
+        }
+
+        moov.resize(size);
+        memcpy(&moov[0], header, sizeof(header));
+        if ((err = srs_mp4_read_fully(fmp4, &moov[8], size - 8)) != srs_success) {
+            return srs_error_wrap(err, "read moov");
+        }
+        break;
+    }
+
+    return err;
+}
+
+static bool srs_mp4_sample_dts_less(const std::pair<SrsMp4Sample*, off_t>& a, const std::pair<SrsMp4Sample*, off_t>& b)
+{
+    return a.first->dts < b.first->dts;
+}
+
+srs_error_t SrsMp4Finalizer::load_index(ISrsReader* idx, SrsMp4SampleManager* samples, std::vector<off_t>& offsets)
+{
+    srs_error_t err = srs_success;
+
+    uint32_t nb_videos = 0, nb_audios = 0;
+    char entry[SRS_MP4_INDEX_ENTRY_SIZE];
+    while (true) {
+        if ((err = srs_mp4_read_fully(idx, entry, sizeof(entry))) != srs_success) {
+            if (srs_error_code(err) == ERROR_SYSTEM_FILE_EOF) {
+                srs_freep(err);
+                break;
+            }
+            return srs_error_wrap(err, "read index");
+        }
+
+        SrsBuffer buf(entry, sizeof(entry));
+
+        SrsMp4Sample* sample = new SrsMp4Sample();
+        sample->type = (SrsFrameType)buf.read_1bytes();
+        sample->frame_type = (SrsVideoAvcFrameType)buf.read_1bytes();
+        buf.skip(2);
+        sample->nb_data = (uint32_t)buf.read_4bytes();
+        offsets.push_back((off_t)buf.read_8bytes());
+        sample->tbn = 1000;
+        sample->dts = (uint32_t)buf.read_4bytes();
+        sample->pts = sample->dts + buf.read_4bytes();
+        sample->index = (sample->type == SrsFrameTypeVideo)? nb_videos++ : nb_audios++;
+
+        samples->append(sample);
+    }
+
+    // The fragment writes all video then all audio, so we interleave the samples by dts, to make
+    // the classic MP4 friendly for progressive download.
+    std::vector<std::pair<SrsMp4Sample*, off_t> > items;
+    for (int i = 0; i < (int)samples->samples.size(); i++) {
+        items.push_back(std::make_pair(samples->samples.at(i), offsets.at(i)));
+    }
+    std::stable_sort(items.begin(), items.end(), srs_mp4_sample_dts_less);
+
+    for (int i = 0; i < (int)items.size(); i++) {
+        samples->samples[i] = items[i].first;
+        offsets[i] = items[i].second;
+    }
+
+    return err;
+}
+
+srs_error_t SrsMp4Finalizer::build_moov(std::vector<char>& raw, SrsMp4SampleManager* samples, SrsMp4MovieBox** pmoov)
+{
+    srs_error_t err = srs_success;
+
+    SrsBuffer buf(&raw[0], (int)raw.size());
+
+    SrsMp4Box* box = NULL;
+    if ((err = SrsMp4Box::discovery(&buf, &box)) != srs_success) {
+        return srs_error_wrap(err, "discovery moov");
+    }
+
+    SrsMp4MovieBox* moov = dynamic_cast<SrsMp4MovieBox*>(box);
+    if (!moov) {
+        srs_freep(box);
+        return srs_error_new(ERROR_MP4_ILLEGAL_MOOV, "not moov");
+    }
+
+    // Note that we should use SrsAutoFree to free the ptr which is set later.
+    SrsAutoFree(SrsMp4MovieBox, moov);
+
+    if ((err = moov->decode(&buf)) != srs_success) {
+        return srs_error_wrap(err, "decode moov");
+    }
+
+    // The samples are described by stbl in classic MP4, so remove the mvex and empty tables.
+    moov->remove(SrsMp4BoxTypeMVEX);
+
+    // The duration of tracks, in ms.
+    uint64_t durations[2] = {0, 0};
+    uint64_t starts[2] = {0, 0};
+    bool has_sample[2] = {false, false};
+    for (int i = 0; i < (int)samples->samples.size(); i++) {
+        SrsMp4Sample* sample = samples->samples.at(i);
+        int t = (sample->type == SrsFrameTypeVideo)? 0 : 1;
+        if (!has_sample[t]) {
+            has_sample[t] = true;
+            starts[t] = sample->dts;
+        }
+        durations[t] = srs_max(durations[t], sample->dts - starts[t]);
+    }
+
+    SrsMp4TrackBox* traks[2] = {moov->video(), moov->audio()};
+    for (int i = 0; i < 2; i++) {
+        SrsMp4TrackBox* trak = traks[i];
+        if (!trak) {
+            continue;
+        }
+
+        SrsMp4SampleTableBox* stbl = trak->stbl();
+        SrsMp4BoxType tables[] = {SrsMp4BoxTypeSTTS, SrsMp4BoxTypeSTSS, SrsMp4BoxTypeCTTS,
+            SrsMp4BoxTypeSTSC, SrsMp4BoxTypeSTSZ, SrsMp4BoxTypeSTCO, SrsMp4BoxTypeCO64};
+        for (int j = 0; j < (int)(sizeof(tables) / sizeof(SrsMp4BoxType)); j++) {
+            stbl->remove(tables[j]);
+        }
+
+        trak->tkhd()->duration = durations[i];
+        trak->mdhd()->duration = durations[i];
+    }
+    moov->mvhd()->duration_in_tbn = srs_max(durations[0], durations[1]);
+
+    if ((err = samples->write(moov)) != srs_success) {
+        return srs_error_wrap(err, "write samples");
+    }
+
+    *pmoov = moov;
+    moov = NULL;
+
+    return err;
+}
+
+srs_error_t SrsMp4Finalizer::copy_samples(ISrsReadSeeker* fmp4, SrsMp4SampleManager* samples, std::vector<off_t>& offsets, ISrsWriter* out)
+{
+    srs_error_t err = srs_success;
+
+    std::vector<char> data;
+    off_t pos = -1;
+    for (int i = 0; i < (int)samples->samples.size(); i++) {
+        SrsMp4Sample* sample = samples->samples.at(i);
+
+        // The samples of a track in fragment are continuous, so seek only for next fragment.
+        off_t offset = offsets.at(i);
+        if (offset != pos && (err = fmp4->lseek(offset, SEEK_SET, NULL)) != srs_success) {
+            return srs_error_wrap(err, "seek to sample");
+        }
+
+        if (data.size() < sample->nb_data) {
+            data.resize(sample->nb_data);
+        }
+
+        if (sample->nb_data && (err = srs_mp4_read_fully(fmp4, &data[0], sample->nb_data)) != srs_success) {
+            return srs_error_wrap(err, "read sample");
+        }
+
+        if (sample->nb_data && (err = out->write(&data[0], sample->nb_data, NULL)) != srs_success) {
+            return srs_error_wrap(err, "write sample");
+        }
+
+        pos = offset + sample->nb_data;
+    }
+
+    return err;
+}
+
 SrsMp4M2tsInitEncoder::SrsMp4M2tsInitEncoder()
 {
     writer = NULL;
@@ -6452,6 +7032,7 @@ SrsMp4M2tsSegmentEncoder::SrsMp4M2tsSegmentEncoder()
     styp_bytes = 0;
     mdat_bytes = 0;
     track_id = 0;
+    nb_chunks = 0;
 }
 
 SrsMp4M2tsSegmentEncoder::~SrsMp4M2tsSegmentEncoder()
@@ -6532,6 +7113,12 @@ srs_error_t SrsMp4M2tsSegmentEncoder::flush(uint64_t& dts)
         return srs_error_new(ERROR_MP4_ILLEGAL_MOOF, "Missing audio and video track");
     }
 
+    // For CMAF chunks, the sidx is not available because the chunks are already written, so we
+    // write the left samples as the last chunk.
+    if (nb_chunks) {
+        return write_chunk(dts);
+    }
+
     // Although the sidx is not required to start play DASH, but it's required for AV sync.
     SrsUniquePtr<SrsMp4SegmentIndexBox> sidx(new SrsMp4SegmentIndexBox());
     if (true) {
@@ -6553,6 +7140,41 @@ srs_error_t SrsMp4M2tsSegmentEncoder::flush(uint64_t& dts)
         sidx->entries.push_back(entry);
     }
 
+    if ((err = do_flush(dts, srsu2ms(decode_basetime), sidx.get())) != srs_success) {
+        return srs_error_wrap(err, "flush");
+    }
+
+    return err;
+}
+
+srs_error_t SrsMp4M2tsSegmentEncoder::write_chunk(uint64_t dts)
+{
+    srs_error_t err = srs_success;
+
+    if (samples->samples.empty()) {
+        return err;
+    }
+
+    // The decode time of chunk is the dts of its first sample.
+    uint64_t basetime = samples->samples[0]->dts;
+    if ((err = do_flush(dts, basetime, NULL)) != srs_success) {
+        return srs_error_wrap(err, "flush chunk %d", nb_chunks);
+    }
+
+    // Reset the samples for next chunk, the sequence number of moof should be increased.
+    srs_freep(samples);
+    samples = new SrsMp4SampleManager();
+    mdat_bytes = 0;
+    sequence_number++;
+    nb_chunks++;
+
+    return err;
+}
+
+srs_error_t SrsMp4M2tsSegmentEncoder::do_flush(uint64_t dts, uint64_t basetime, SrsMp4SegmentIndexBox* sidx)
+{
+    srs_error_t err = srs_success;
+
     // Create a mdat box.
     // its payload will be writen by samples,
     // and we will update its header(size) when flush.
@@ -6580,7 +7202,7 @@ srs_error_t SrsMp4M2tsSegmentEncoder::flush(uint64_t& dts)
         traf->set_tfdt(tfdt);
         
         tfdt->version = 1;
-        tfdt->base_media_decode_time = srsu2ms(decode_basetime);
+        tfdt->base_media_decode_time = basetime;
         
         SrsMp4TrackFragmentRunBox* trun = new SrsMp4TrackFragmentRunBox();
         traf->set_trun(trun);
@@ -6595,10 +7217,12 @@ srs_error_t SrsMp4M2tsSegmentEncoder::flush(uint64_t& dts)
         mdat->nb_data = mdat_bytes;
 
         // Update the size of sidx.
-        SrsMp4SegmentIndexEntry* entry = &sidx->entries[0];
-        entry->referenced_size = moof_bytes + mdat->nb_bytes();
-        if ((err = srs_mp4_write_box(writer, sidx.get())) != srs_success) {
-            return srs_error_wrap(err, "write sidx");
+        if (sidx) {
+            SrsMp4SegmentIndexEntry* entry = &sidx->entries[0];
+            entry->referenced_size = moof_bytes + mdat->nb_bytes();
+            if ((err = srs_mp4_write_box(writer, sidx)) != srs_success) {
+                return srs_error_wrap(err, "write sidx");
+            }
         }
 
         if ((err = srs_mp4_write_box(writer, moof.get())) != srs_success) {
@@ -21,6 +21,7 @@
 class ISrsWriter;
 class ISrsWriteSeeker;
 class ISrsReadSeeker;
+class ISrsReader;
 class SrsMp4TrackBox;
 class SrsMp4MediaBox;
 class SrsSimpleStream;
@@ -712,6 +713,8 @@ public:
     // Get the track extends box.
     virtual SrsMp4TrackExtendsBox* trex();
     virtual void set_trex(SrsMp4TrackExtendsBox* v);
+    // Add a track extends box, for fMP4 with both audio and video track.
+    virtual void add_trex(SrsMp4TrackExtendsBox* v);
 };
 
 // 8.8.3 Track Extends Box(trex)
@@ -2085,6 +2088,18 @@ private:
     // The size width/height of video.
     uint32_t width;
     uint32_t height;
+private:
+    // For fMP4, the duration of fragment, zero for classic MP4 with moov at the end.
+    srs_utime_t fragment;
+    // For fMP4, the writer for sample index, to build the moov by SrsMp4Finalizer.
+    ISrsWriter* index;
+    // For fMP4, whether the moov with mvex is written.
+    bool moov_written;
+    uint32_t sequence_number;
+    // For fMP4, the dts in ms of the first sample of current fragment.
+    uint64_t fragment_dts;
+    uint32_t vtrack_id;
+    uint32_t atrack_id;
 public:
     SrsMp4Encoder();
     virtual ~SrsMp4Encoder();
@@ -2092,6 +2107,11 @@ public:
     // Initialize the encoder with a writer and seeker ws.
     // @param ws The underlayer io writer and seeker, user must manage it.
     virtual srs_error_t initialize(ISrsWriteSeeker* ws);
+    // Initialize the encoder to write fMP4, which flush a moof and mdat for each fragment, so the
+    // memory is constant no matter how long the file is.
+    // @param fragment The duration of fragment, which is reaped at keyframe.
+    // @param idx The writer for sample index, NULL to ignore. User must manage it.
+    virtual srs_error_t initialize(ISrsWriteSeeker* ws, srs_utime_t fragment, ISrsWriter* idx);
     // Write a sample to mp4.
     // @param ht, The sample handler type, audio/soun or video/vide.
     // @param ft, The frame type. For video, it's SrsVideoAvcFrameType.
@@ -2108,6 +2128,36 @@ private:
     virtual srs_error_t copy_sequence_header(SrsFormat* format, bool vsh, uint8_t* sample, uint32_t nb_sample);
     virtual srs_error_t do_write_sample(SrsMp4Sample* ps, uint8_t* sample, uint32_t nb_sample);
     virtual SrsMp4ObjectType get_audio_object_type();
+    // Build the tracks of moov, without samples.
+    virtual void build_moov(SrsMp4MovieBox* moov);
+private:
+    // Write the cached samples as a fragment, the dts is the end of fragment.
+    virtual srs_error_t flush_fragment(uint64_t dts);
+    virtual srs_error_t write_moof(uint32_t tid, std::vector<SrsMp4Sample*>& track, uint64_t dts);
+};
+
+// The size in bytes of each sample in index, written by SrsMp4Encoder for fMP4.
+#define SRS_MP4_INDEX_ENTRY_SIZE 24
+
+// Remux the fMP4 written by SrsMp4Encoder to classic MP4, with moov before mdat, also known as
+// faststart, by building the moov from the sample index. It's slow for long file, so it should
+// run in background thread, never in the ST thread.
+class SrsMp4Finalizer
+{
+public:
+    SrsMp4Finalizer();
+    virtual ~SrsMp4Finalizer();
+public:
+    // Finalize the fMP4 and the index to classic MP4.
+    // @param fmp4 The fMP4 file to read moov and samples from.
+    // @param idx The sample index of fMP4.
+    // @param out The writer for classic MP4.
+    virtual srs_error_t finalize(ISrsReadSeeker* fmp4, ISrsReader* idx, ISrsWriter* out);
+private:
+    virtual srs_error_t read_moov(ISrsReadSeeker* fmp4, std::vector<char>& moov);
+    virtual srs_error_t load_index(ISrsReader* idx, SrsMp4SampleManager* samples, std::vector<off_t>& offsets);
+    virtual srs_error_t build_moov(std::vector<char>& raw, SrsMp4SampleManager* samples, SrsMp4MovieBox** pmoov);
+    virtual srs_error_t copy_samples(ISrsReadSeeker* fmp4, SrsMp4SampleManager* samples, std::vector<off_t>& offsets, ISrsWriter* out);
 };
 
 // A fMP4 encoder, to write the init.mp4 with sequence header.
@@ -2140,6 +2190,8 @@ private:
     uint32_t styp_bytes;
     uint64_t mdat_bytes;
     SrsMp4SampleManager* samples;
+    // The number of CMAF chunks written.
+    int nb_chunks;
 public:
     SrsMp4M2tsSegmentEncoder();
     virtual ~SrsMp4M2tsSegmentEncoder();
@@ -2157,7 +2209,13 @@ public:
     virtual srs_error_t write_sample(SrsMp4HandlerType ht, uint16_t ft,
         uint32_t dts, uint32_t pts, uint8_t* sample, uint32_t nb_sample);
     // Flush the encoder, to write the moof and mdat.
+    // @remark If any chunk is written, the left samples are written as the last chunk, without sidx.
     virtual srs_error_t flush(uint64_t& dts);
+    // Write the cached samples as a CMAF chunk, a moof and mdat without sidx, for LL-DASH.
+    // @param dts The dts of next sample in milliseconds, to calculate the duration of last sample.
+    virtual srs_error_t write_chunk(uint64_t dts);
+private:
+    virtual srs_error_t do_flush(uint64_t dts, uint64_t basetime, SrsMp4SegmentIndexBox* sidx);
 };
 
 // LCOV_EXCL_START
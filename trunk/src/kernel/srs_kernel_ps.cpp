@@ -20,6 +20,9 @@ using namespace std;
 // The minimum required bytes to parse a PS packet.
 #define SRS_PS_MIN_REQUIRED 32
 
+// The max number of freed messages to reuse, a pack might contain some audio and video messages.
+#define SRS_PS_FREE_MESSAGES 16
+
 SrsPsDecodeHelper::SrsPsDecodeHelper()
 {;
     rtp_seq_ = 0;
@@ -48,6 +51,7 @@ SrsPsContext::SrsPsContext()
     current_ = NULL;
     helper_.ctx_ = this;
     detect_ps_integrity_ = false;
+    quiet_ = false;
     video_stream_type_ = SrsTsStreamReserved;
     audio_stream_type_ = SrsTsStreamReserved;
 }
@@ -56,6 +60,11 @@ SrsPsContext::~SrsPsContext()
 {
     srs_freep(last_);
     srs_freep(current_);
+
+    for (vector<SrsTsMessage*>::iterator it = free_msgs_.begin(); it != free_msgs_.end(); ++it) {
+        SrsTsMessage* msg = *it;
+        srs_freep(msg);
+    }
 }
 
 void SrsPsContext::set_detect_ps_integrity(bool v)
@@ -63,11 +72,15 @@ void SrsPsContext::set_detect_ps_integrity(bool v)
     detect_ps_integrity_ = v;
 }
 
+void SrsPsContext::set_quiet(bool v)
+{
+    quiet_ = v;
+}
+
 SrsTsMessage* SrsPsContext::last()
 {
     if (!last_) {
-        last_ = new SrsTsMessage();
-        last_->ps_helper_ = &helper_;
+        last_ = acquire_message();
     }
     return last_;
 }
@@ -75,11 +88,45 @@ SrsTsMessage* SrsPsContext::last()
 SrsTsMessage* SrsPsContext::reap()
 {
     SrsTsMessage* msg = last_;
-    last_ = new SrsTsMessage();
-    last_->ps_helper_ = &helper_;
+    last_ = acquire_message();
+    return msg;
+}
+
+SrsTsMessage* SrsPsContext::acquire_message()
+{
+    if (free_msgs_.empty()) {
+        SrsTsMessage* msg = new SrsTsMessage();
+        msg->ps_helper_ = &helper_;
+        return msg;
+    }
+
+    SrsTsMessage* msg = free_msgs_.back();
+    free_msgs_.pop_back();
+
+    msg->ps_helper_ = &helper_;
+    msg->dts = msg->pts = 0;
+    msg->sid = (SrsTsPESStreamId)0x00;
+    msg->continuity_counter = 0;
+    msg->PES_packet_length = 0;
+    msg->is_discontinuity = false;
+    msg->start_pts = 0;
+    msg->write_pcr = false;
+
     return msg;
 }
 
+void SrsPsContext::release_message(SrsTsMessage* msg)
+{
+    // The payload might be detached by handler.
+    if (!msg->payload || free_msgs_.size() >= SRS_PS_FREE_MESSAGES) {
+        srs_freep(msg);
+        return;
+    }
+
+    msg->payload->erase(msg->payload->length());
+    free_msgs_.push_back(msg);
+}
+
 srs_error_t SrsPsContext::decode(SrsBuffer* stream, ISrsPsMessageHandler* handler)
 {
     srs_error_t err = srs_success;
@@ -106,41 +153,57 @@ srs_error_t SrsPsContext::decode(SrsBuffer* stream, ISrsPsMessageHandler* handle
             continue; // Ignore if message not completed.
         }
 
-        // Reap the last completed PS message.
-        SrsUniquePtr<SrsTsMessage> msg(reap());
+        // Reap the last completed PS message, which is reused after handled.
+        SrsTsMessage* msg = reap();
+        err = on_message(msg, handler);
+        release_message(msg);
 
-        if (msg->sid == SrsTsPESStreamIdProgramStreamMap) {
-            if (!msg->payload || !msg->payload->length()) {
-                return srs_error_new(ERROR_GB_PS_HEADER, "empty PSM payload");
-            }
+        if (err != srs_success) {
+            return srs_error_wrap(err, "handle message");
+        }
+    }
 
-            // Decode PSM(Program Stream map) from PES packet payload.
-            SrsBuffer buf(msg->payload->bytes(), msg->payload->length());
+    return err;
+}
 
-            SrsPsPsmPacket psm;
-            if ((err = psm.decode(&buf)) != srs_success) {
-                return srs_error_wrap(err, "decode psm");
-            }
+srs_error_t SrsPsContext::on_message(SrsTsMessage* msg, ISrsPsMessageHandler* handler)
+{
+    srs_error_t err = srs_success;
 
-            if (video_stream_type_ == SrsTsStreamReserved || audio_stream_type_ == SrsTsStreamReserved) {
-                srs_trace("PS: Got PSM for video=%#x, audio=%#x", psm.video_elementary_stream_id_, psm.audio_elementary_stream_id_);
-            } else {
-                srs_info("PS: Got PSM for video=%#x, audio=%#x", psm.video_elementary_stream_id_, psm.audio_elementary_stream_id_);
-            }
-            video_stream_type_ = (SrsTsStream)psm.video_stream_type_;
-            audio_stream_type_ = (SrsTsStream)psm.audio_stream_type_;
-        } else if (msg->is_video() || msg->is_audio()) {
-            // Update the total messages in pack.
-            helper_.pack_pre_msg_last_seq_ = helper_.rtp_seq_;
-            helper_.pack_nn_msgs_++;
-
-            //srs_error("PS: Got message %s, dts=%" PRId64 ", payload=%dB", msg->is_video() ? "Video" : "Audio", msg->dts/9000, msg->PES_packet_length);
-            if (handler && (err = handler->on_ts_message(msg.get())) != srs_success) {
-                return srs_error_wrap(err, "handle PS message");
-            }
+    if (msg->sid == SrsTsPESStreamIdProgramStreamMap) {
+        if (!msg->payload || !msg->payload->length()) {
+            return srs_error_new(ERROR_GB_PS_HEADER, "empty PSM payload");
+        }
+
+        // Decode PSM(Program Stream map) from PES packet payload.
+        SrsBuffer buf(msg->payload->bytes(), msg->payload->length());
+
+        SrsPsPsmPacket psm;
+        psm.quiet_ = quiet_;
+        if ((err = psm.decode(&buf)) != srs_success) {
+            return srs_error_wrap(err, "decode psm");
+        }
+
+        if (quiet_) {
+            // Never write log, the PSM is reported by the user of context.
+        } else if (video_stream_type_ == SrsTsStreamReserved || audio_stream_type_ == SrsTsStreamReserved) {
+            srs_trace("PS: Got PSM for video=%#x, audio=%#x", psm.video_elementary_stream_id_, psm.audio_elementary_stream_id_);
         } else {
-            srs_info("PS: Ignore message sid=%#x", msg->sid);
+            srs_info("PS: Got PSM for video=%#x, audio=%#x", psm.video_elementary_stream_id_, psm.audio_elementary_stream_id_);
+        }
+        video_stream_type_ = (SrsTsStream)psm.video_stream_type_;
+        audio_stream_type_ = (SrsTsStream)psm.audio_stream_type_;
+    } else if (msg->is_video() || msg->is_audio()) {
+        // Update the total messages in pack.
+        helper_.pack_pre_msg_last_seq_ = helper_.rtp_seq_;
+        helper_.pack_nn_msgs_++;
+
+        //srs_error("PS: Got message %s, dts=%" PRId64 ", payload=%dB", msg->is_video() ? "Video" : "Audio", msg->dts/9000, msg->PES_packet_length);
+        if (handler && (err = handler->on_ts_message(msg)) != srs_success) {
+            return srs_error_wrap(err, "handle PS message");
         }
+    } else {
+        srs_info("PS: Ignore message sid=%#x", msg->sid);
     }
 
     return err;
@@ -170,12 +233,13 @@ srs_error_t SrsPsContext::do_decode(SrsBuffer* stream, ISrsPsMessageHandler* han
         return srs_error_new(ERROR_GB_PS_HEADER, "Invalid PS stream %#x %#x %#x", p[0], p[1], p[2]);
     }
 
-    // If pack start code, it's a net PS pack stream.
-    if (p[0] == 0x00 && p[1] == 0x00 && p[2] == 0x01 && p[3] == 0xba) {
-        srs_freep(current_);
-    }
-    if (!current_) {
-        current_ = new SrsPsPacket(this);
+    // If pack start code, it's a net PS pack stream, reuse the packet with a new ID.
+    if (!current_ || p[3] == 0xba) {
+        if (!current_) {
+            current_ = new SrsPsPacket(this);
+        } else {
+            current_->reset();
+        }
         current_->id_ |= helper_.rtp_seq_; // The low 16 bits is reserved for RTP seq.
         helper_.pack_id_ = current_->id_;
         helper_.pack_first_seq_ = helper_.rtp_seq_;
@@ -198,10 +262,20 @@ srs_error_t SrsPsContext::do_decode(SrsBuffer* stream, ISrsPsMessageHandler* han
 SrsPsPacket::SrsPsPacket(SrsPsContext* context)
 {
     context_ = context;
+    reset();
+}
+
+SrsPsPacket::~SrsPsPacket()
+{
+}
+
+void SrsPsPacket::reset()
+{
     has_pack_header_ = has_system_header_ = false;
 
+    // Generate the id atomically, because PS might be decoded in multiple threads.
     static uint32_t gid = 0;
-    id_ = ((gid++) << 16) & 0xffff0000;
+    id_ = (__atomic_fetch_add(&gid, 1, __ATOMIC_RELAXED) << 16) & 0xffff0000;
 
     pack_start_code_ = 0;
     system_clock_reference_base_ = 0;
@@ -226,10 +300,6 @@ SrsPsPacket::SrsPsPacket(SrsPsContext* context)
     video_buffer_size_bound_ = 0;
 }
 
-SrsPsPacket::~SrsPsPacket()
-{
-}
-
 srs_error_t SrsPsPacket::decode(SrsBuffer* stream)
 {
     srs_error_t err = srs_success;
@@ -282,6 +352,8 @@ srs_error_t SrsPsPacket::decode(SrsBuffer* stream)
         if (pes.has_payload_) {
             // The size of PS message, should be always a positive value.
             lm->PES_packet_length = pes.nb_payload_;
+            // Reserve the whole PES, which might span many RTP packets, to avoid growing the buffer.
+            lm->payload->reserve(pes.nb_payload_);
             if ((err = lm->dump(stream, &pes.nb_bytes)) != srs_success) {
                 return srs_error_wrap(err, "dump pes");
             }
@@ -411,6 +483,7 @@ SrsPsPsmPacket::SrsPsPsmPacket()
     audio_elementary_stream_id_ = 0;
     audio_elementary_stream_info_length_ = 0;
     CRC_32_ = 0;
+    quiet_ = false;
 }
 
 SrsPsPsmPacket::~SrsPsPsmPacket()
@@ -481,7 +554,7 @@ srs_error_t SrsPsPsmPacket::decode(SrsBuffer* stream)
             audio_stream_type_ = stream_type;
             audio_elementary_stream_id_ = elementary_stream_id;
             audio_elementary_stream_info_length_ = elementary_stream_info_length;
-        } else {
+        } else if (!quiet_) {
             srs_trace("PS: Ignore stream_type=%#x, es_id=%d, es_info=%d", stream_type, elementary_stream_id, elementary_stream_info_length);
         }
     }
@@ -11,6 +11,8 @@
 
 #include <srs_kernel_ts.hpp>
 
+#include <vector>
+
 class SrsPsPacket;
 class SrsPsContext;
 
@@ -66,6 +68,10 @@ private:
     SrsPsPacket* current_;
     // Whether detect PS packet header integrity.
     bool detect_ps_integrity_;
+    // Whether never write log, for example, when decoding in worker thread.
+    bool quiet_;
+    // The messages to reuse, with the payload buffer which keeps its capacity.
+    std::vector<SrsTsMessage*> free_msgs_;
 public:
     // The stream type parsed from latest PSM packet.
     SrsTsStream video_stream_type_;
@@ -76,10 +82,16 @@ public:
 public:
     // Set whether detecting PS header integrity.
     void set_detect_ps_integrity(bool v);
+    // Set whether never write log, because log is not thread-safe for worker thread.
+    void set_quiet(bool v);
     // Get the last PS(TS) message. Create one if not exists.
     SrsTsMessage* last();
     // Reap the last message and create a fresh one.
     SrsTsMessage* reap();
+    // Get a message to decode PES, reuse the freed one if possible.
+    SrsTsMessage* acquire_message();
+    // Free the message, which is reused by next PES.
+    void release_message(SrsTsMessage* msg);
 public:
     // Feed with ts packets, decode as ts message, callback handler if got one ts message.
     //      A ts video message can be decoded to NALUs by SrsRawH264Stream::annexb_demux.
@@ -89,6 +101,7 @@ public:
     virtual srs_error_t decode(SrsBuffer* stream, ISrsPsMessageHandler* handler);
 private:
     srs_error_t do_decode(SrsBuffer* stream, ISrsPsMessageHandler* handler);
+    srs_error_t on_message(SrsTsMessage* msg, ISrsPsMessageHandler* handler);
 };
 
 // The packet in ps stream.
@@ -244,6 +257,8 @@ public:
     SrsPsPacket(SrsPsContext* context);
     virtual ~SrsPsPacket();
 public:
+    // Reset the packet for a new pack, and generate a new global ID.
+    virtual void reset();
     virtual srs_error_t decode(SrsBuffer* stream);
 private:
     virtual srs_error_t decode_pack(SrsBuffer* stream);
@@ -307,6 +322,9 @@ public:
     // This is a 32-bit field that contains the CRC value that gives a zero output of the registers in the decoder
     // defined in Annex A after processing the entire program stream map.
     uint32_t CRC_32_;
+public:
+    // Whether never write log, for example, when decoding in worker thread.
+    bool quiet_;
 public:
     SrsPsPsmPacket();
     virtual ~SrsPsPsmPacket();
@@ -8,6 +8,7 @@
 
 #include <srs_kernel_error.hpp>
 #include <srs_kernel_log.hpp>
+#include <srs_kernel_utility.hpp>
 
 #include <arpa/inet.h>
 using namespace std;
@@ -493,7 +494,7 @@ uint32_t SrsRtcpRR::get_rb_ssrc() const
 
 float SrsRtcpRR::get_lost_rate() const
 {
-    return rb_.fraction_lost / 256;
+    return rb_.fraction_lost / 256.0;
 }
 
 uint32_t SrsRtcpRR::get_lost_packets() const
@@ -742,6 +743,11 @@ vector<uint16_t> SrsRtcpTWCC::get_recv_deltas() const
     return pkt_deltas_;
 }
 
+const vector<SrsRtcpTWCCStatus>& SrsRtcpTWCC::get_packet_status() const
+{
+    return statuses_;
+}
+
 void SrsRtcpTWCC::set_base_sn(uint16_t sn)
 {
     base_sn_ = sn;
@@ -826,6 +832,90 @@ srs_error_t SrsRtcpTWCC::decode(SrsBuffer *buffer)
     payload_len_ = (header_.length + 1) * 4 - sizeof(SrsRtcpHeader) - 4;
     buffer->read_bytes((char *)payload_, payload_len_);
 
+    SrsBuffer b((char*)payload_, payload_len_);
+    if ((err = decode_feedback(&b)) != srs_success) {
+        return srs_error_wrap(err, "decode feedback");
+    }
+
+    return err;
+}
+
+srs_error_t SrsRtcpTWCC::decode_feedback(SrsBuffer* buffer)
+{
+    srs_error_t err = srs_success;
+
+    statuses_.clear();
+
+    if (!buffer->require(12)) {
+        return srs_error_new(ERROR_RTC_RTCP, "requires 12 only %d bytes", buffer->left());
+    }
+
+    media_ssrc_ = buffer->read_4bytes();
+    base_sn_ = buffer->read_2bytes();
+    uint16_t status_count = buffer->read_2bytes();
+
+    // The reference time is a signed integer in multiples of 64ms.
+    reference_time_ = buffer->read_3bytes();
+    fb_pkt_count_ = buffer->read_1bytes();
+    int32_t reference_time = (reference_time_ & 0x800000) ? (int32_t)(reference_time_ | 0xff000000) : (int32_t)reference_time_;
+
+    // Decode the symbols of packet chunks, 0 is not received, 1 is small delta, 2 is large delta.
+    vector<uint8_t> symbols;
+    symbols.reserve(status_count);
+    while ((int)symbols.size() < status_count) {
+        if (!buffer->require(kTwccFbChunkBytes)) {
+            return srs_error_new(ERROR_RTC_RTCP, "requires chunk, status=%d/%d", (int)symbols.size(), status_count);
+        }
+
+        uint16_t chunk = buffer->read_2bytes();
+        int left = status_count - (int)symbols.size();
+
+        if ((chunk & 0x8000) == 0) {
+            // Run length chunk, the symbol repeats for run length.
+            uint8_t symbol = (chunk >> 13) & 0x03;
+            int run = srs_min(chunk & kTwccFbMaxRunLength, left);
+            symbols.insert(symbols.end(), run, symbol);
+        } else if ((chunk & 0x4000) == 0) {
+            // Status vector chunk, with 14 one-bit symbols.
+            for (int i = 0; i < kTwccFbOneBitElements && i < left; i++) {
+                symbols.push_back((chunk >> (kTwccFbOneBitElements - 1 - i)) & 0x01);
+            }
+        } else {
+            // Status vector chunk, with 7 two-bit symbols.
+            for (int i = 0; i < kTwccFbTwoBitElements && i < left; i++) {
+                symbols.push_back((chunk >> (2 * (kTwccFbTwoBitElements - 1 - i))) & 0x03);
+            }
+        }
+    }
+
+    // Decode the recv deltas for received packets.
+    int64_t arrival = (int64_t)reference_time * kTwccFbTimeMultiplier;
+    statuses_.resize(symbols.size());
+    for (int i = 0; i < (int)symbols.size(); i++) {
+        SrsRtcpTWCCStatus& status = statuses_[i];
+        status.sn = base_sn_ + i;
+        status.received = false;
+        status.arrival = 0;
+
+        uint8_t symbol = symbols.at(i);
+        if (symbol == 1) {
+            if (!buffer->require(1)) {
+                return srs_error_new(ERROR_RTC_RTCP, "requires small delta, sn=%u", status.sn);
+            }
+            arrival += (int64_t)buffer->read_1bytes() * kTwccFbDeltaUnit;
+        } else if (symbol == 2) {
+            if (!buffer->require(2)) {
+                return srs_error_new(ERROR_RTC_RTCP, "requires large delta, sn=%u", status.sn);
+            }
+            arrival += (int64_t)(int16_t)buffer->read_2bytes() * kTwccFbDeltaUnit;
+        } else {
+            continue;
+        }
+
+        status.received = true;
+        status.arrival = arrival;
+    }
+
     return err;
 }
 
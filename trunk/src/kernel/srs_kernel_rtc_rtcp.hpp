@@ -269,6 +269,17 @@ public:
 #define kTwccFbLargeRecvDeltaBytes	2
 #define kTwccFbMaxBitElements 		kTwccFbOneBitElements
 
+// The status of packet in TWCC feedback, decoded from the packet chunks and recv deltas.
+struct SrsRtcpTWCCStatus
+{
+    // The transport-wide sequence number.
+    uint16_t sn;
+    // Whether the packet is received, the arrival is ignored if not.
+    bool received;
+    // The arrival time in us, based on the reference time, only used to calculate the delta.
+    int64_t arrival;
+};
+
 class SrsRtcpTWCC : public SrsRtcpFbCommon
 {
 private:
@@ -291,6 +302,8 @@ private:
 
     int pkt_len;
     uint16_t next_base_sn_;
+    // The packet status of feedback from peer, by decode.
+    std::vector<SrsRtcpTWCCStatus> statuses_;
 private:
     void clear();
     srs_utime_t calculate_delta_us(srs_utime_t ts, srs_utime_t last);
@@ -312,6 +325,8 @@ public:
     uint8_t get_feedback_count() const;
     std::vector<uint16_t> get_packet_chucks() const;
     std::vector<uint16_t> get_recv_deltas() const;
+    // Get the packet status of feedback, which is decoded from peer.
+    const std::vector<SrsRtcpTWCCStatus>& get_packet_status() const;
 
     void set_base_sn(uint16_t sn);
     void set_reference_time(uint32_t time);
@@ -329,6 +344,7 @@ public:
     virtual srs_error_t encode(SrsBuffer *buffer);   
 private:
     srs_error_t do_encode(SrsBuffer *buffer);
+    srs_error_t decode_feedback(SrsBuffer* buffer);
 };
 
 class SrsRtcpNack : public SrsRtcpFbCommon
@@ -124,6 +124,70 @@ srs_error_t srs_rtp_fast_parse_twcc(char* buf, int size, uint8_t twcc_id, uint16
     return err;
 }
 
+srs_error_t srs_rtp_fast_parse_rid(char* buf, int size, uint8_t rid_id, std::string& rid)
+{
+    srs_error_t err = srs_success;
+
+    int need_size = 12 /*rtp head fix len*/ + 4 /* extension header len*/;
+    if (size < need_size) {
+        return srs_error_new(ERROR_RTC_RTP_MUXER, "required %d bytes, actual %d", need_size, size);
+    }
+
+    uint8_t first = buf[0];
+    bool extension = (first & 0x10);
+    uint8_t cc = (first & 0x0F);
+
+    if (!extension) {
+        return srs_error_new(ERROR_RTC_RTP, "no extension in rtp");
+    }
+
+    need_size += cc * 4; // csrc size
+    if (size < need_size) {
+        return srs_error_new(ERROR_RTC_RTP_MUXER, "required %d bytes, actual %d", need_size, size);
+    }
+    buf += 12 + 4*cc;
+
+    uint16_t value = ntohs(*((uint16_t*)buf));
+    if (0xBEDE != value) {
+        return srs_error_new(ERROR_RTC_RTP_MUXER, "no support this type(0x%02x) extension", value);
+    }
+    buf += 2;
+
+    int extension_length = ntohs(*((uint16_t*)buf)) * 4;
+    buf += 2;
+    need_size += extension_length;
+    if (size < need_size) {
+        return srs_error_new(ERROR_RTC_RTP_MUXER, "required %d bytes, actual %d", need_size, size);
+    }
+
+    // The RID is a string of one-byte header extension, for example, "h" or "q".
+    // @see https://www.rfc-editor.org/rfc/rfc8852#section-3.1
+    while (extension_length > 0) {
+        uint8_t v = buf[0];
+        buf++;
+        extension_length--;
+        if (0 == v) {
+            continue;
+        }
+
+        uint8_t id = (v & 0xF0) >> 4;
+        int len = (v & 0x0F) + 1;
+        if (id == 15 || len > extension_length) {
+            break;
+        }
+
+        if (id == rid_id) {
+            rid.assign(buf, len);
+            return err;
+        }
+
+        buf += len;
+        extension_length -= len;
+    }
+
+    return srs_error_new(ERROR_RTC_RTP, "no rid id=%d", rid_id);
+}
+
 // If value is newer than pre_value，return true; otherwise false
 bool srs_seq_is_newer(uint16_t value, uint16_t pre_value)
 {
@@ -56,3 +56,10 @@ void SrsSimpleStream::append(SrsSimpleStream* src)
 {
     append(src->bytes(), src->length());
 }
+
+void SrsSimpleStream::reserve(int size)
+{
+    if (size > 0) {
+        data.reserve(size);
+    }
+}
@@ -47,6 +47,10 @@ public:
      */
     virtual void append(const char* bytes, int size);
     virtual void append(SrsSimpleStream* src);
+    /**
+     * reserve the capacity of buffer, to avoid reallocation when append.
+     */
+    virtual void reserve(int size);
 };
 
 #endif
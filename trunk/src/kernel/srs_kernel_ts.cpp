@@ -15,7 +15,7 @@
 #include <sstream>
 using namespace std;
 
-#include <openssl/aes.h>
+#include <openssl/evp.h>
 #include <cstring>
 #include <srs_kernel_log.hpp>
 #include <srs_kernel_error.hpp>
@@ -25,7 +25,11 @@ using namespace std;
 #include <srs_kernel_buffer.hpp>
 #include <srs_core_autofree.hpp>
 
-#define HLS_AES_ENCRYPT_BLOCK_LENGTH SRS_TS_PACKET_SIZE * 4
+#define HLS_AES_ENCRYPT_BLOCK_LENGTH (SRS_TS_PACKET_SIZE * 4)
+#define HLS_AES_BLOCK_SIZE 16
+
+// The max number of freed messages to reuse, for decoder.
+#define SRS_TS_FREE_MESSAGES 8
 
 // the mpegts header specifed the video/audio pid.
 #define TS_PMT_NUMBER 1
@@ -173,6 +177,25 @@ SrsTsMessage* SrsTsMessage::detach()
     return cp;
 }
 
+void SrsTsMessage::detach_to(SrsTsMessage* cp)
+{
+    cp->channel = channel;
+    cp->packet = NULL;
+    cp->ps_helper_ = ps_helper_;
+    cp->start_pts = start_pts;
+    cp->write_pcr = write_pcr;
+    cp->is_discontinuity = is_discontinuity;
+    cp->dts = dts;
+    cp->pts = pts;
+    cp->sid = sid;
+    cp->PES_packet_length = PES_packet_length;
+    cp->continuity_counter = continuity_counter;
+
+    SrsSimpleStream* p = cp->payload;
+    cp->payload = payload;
+    payload = p;
+}
+
 ISrsTsHandler::ISrsTsHandler()
 {
 }
@@ -188,10 +211,21 @@ SrsTsContext::SrsTsContext()
     sync_byte = 0x47; // ts default sync byte.
     vcodec = SrsVideoCodecIdReserved;
     acodec = SrsAudioCodecIdReserved1;
+    pes_buf = NULL;
+    nb_pes_buf = 0;
+    packet = new SrsTsPacket(this);
 }
 
 SrsTsContext::~SrsTsContext()
 {
+    srs_freepa(pes_buf);
+    srs_freep(packet);
+
+    for (int i = 0; i < (int)free_msgs.size(); i++) {
+        SrsTsMessage* msg = free_msgs.at(i);
+        srs_freep(msg);
+    }
+
     std::map<int, SrsTsChannel*>::iterator it;
     for (it = pids.begin(); it != pids.end(); ++it) {
         SrsTsChannel* channel = it->second;
@@ -227,10 +261,15 @@ void SrsTsContext::reset()
 
 SrsTsChannel* SrsTsContext::get(int pid)
 {
-    if (pids.find(pid) == pids.end()) {
+    if (pid >= 0 && pid < (int)flat_pids.size()) {
+        return flat_pids[pid];
+    }
+
+    std::map<int, SrsTsChannel*>::iterator it = pids.find(pid);
+    if (it == pids.end()) {
         return NULL;
     }
-    return pids[pid];
+    return it->second;
 }
 
 void SrsTsContext::set(int pid, SrsTsPidApply apply_pid, SrsTsStream stream)
@@ -248,6 +287,13 @@ void SrsTsContext::set(int pid, SrsTsPidApply apply_pid, SrsTsStream stream)
     channel->pid = pid;
     channel->apply = apply_pid;
     channel->stream = stream;
+
+    if (pid >= 0 && pid <= SrsTsPidNULL) {
+        if (flat_pids.empty()) {
+            flat_pids.resize(SrsTsPidNULL + 1, NULL);
+        }
+        flat_pids[pid] = channel;
+    }
 }
 
 srs_error_t SrsTsContext::decode(SrsBuffer* stream, ISrsTsHandler* handler)
@@ -257,20 +303,19 @@ srs_error_t SrsTsContext::decode(SrsBuffer* stream, ISrsTsHandler* handler)
     // parse util EOF of stream.
     // for example, parse multiple times for the PES_packet_length(0) packet.
     while (!stream->empty()) {
-        SrsUniquePtr<SrsTsPacket> packet(new SrsTsPacket(this));
-
-        SrsTsMessage* msg_raw = NULL;
-        if ((err = packet->decode(stream, &msg_raw)) != srs_success) {
+        SrsTsMessage* msg = NULL;
+        if (!decode_pes_fast(stream, &msg) && (err = packet->decode(stream, &msg)) != srs_success) {
             return srs_error_wrap(err, "ts: ts packet decode");
         }
         
-        if (!msg_raw) {
+        if (!msg) {
             continue;
         }
 
-        SrsUniquePtr<SrsTsMessage> msg(msg_raw);
-        
-        if ((err = handler->on_ts_message(msg.get())) != srs_success) {
+        err = handler->on_ts_message(msg);
+        release_message(msg);
+
+        if (err != srs_success) {
             return srs_error_wrap(err, "ts: handle ts message");
         }
     }
@@ -278,6 +323,100 @@ srs_error_t SrsTsContext::decode(SrsBuffer* stream, ISrsTsHandler* handler)
     return err;
 }
 
+SrsTsMessage* SrsTsContext::acquire_message(SrsTsChannel* channel, SrsTsPacket* pkt)
+{
+    if (free_msgs.empty()) {
+        return new SrsTsMessage(channel, pkt);
+    }
+
+    SrsTsMessage* msg = free_msgs.back();
+    free_msgs.pop_back();
+
+    msg->channel = channel;
+    msg->packet = pkt;
+    msg->ps_helper_ = NULL;
+    msg->dts = msg->pts = 0;
+    msg->sid = (SrsTsPESStreamId)0x00;
+    msg->continuity_counter = 0;
+    msg->PES_packet_length = 0;
+    msg->is_discontinuity = false;
+    msg->start_pts = 0;
+    msg->write_pcr = false;
+
+    return msg;
+}
+
+void SrsTsContext::release_message(SrsTsMessage* msg)
+{
+    // The payload might be detached by handler.
+    if (!msg->payload || free_msgs.size() >= SRS_TS_FREE_MESSAGES) {
+        srs_freep(msg);
+        return;
+    }
+
+    msg->payload->erase(msg->payload->length());
+    free_msgs.push_back(msg);
+}
+
+bool SrsTsContext::decode_pes_fast(SrsBuffer* stream, SrsTsMessage** ppmsg)
+{
+    if (!stream->require(SRS_TS_PACKET_SIZE)) {
+        return false;
+    }
+
+    // Only the continuous packet without payload_unit_start_indicator.
+    uint8_t* p = (uint8_t*)stream->head();
+    if (p[0] != 0x47 || (p[1] & 0x40) != 0) {
+        return false;
+    }
+
+    int pid = ((p[1] & 0x1F) << 8) | p[2];
+    SrsTsChannel* channel = get(pid);
+    if (!channel || (channel->apply != SrsTsPidApplyVideo && channel->apply != SrsTsPidApplyAudio)) {
+        return false;
+    }
+
+    // Only for the continuous packet of a message, and the continuity_counter should be continuous.
+    SrsTsMessage* msg = channel->msg;
+    uint8_t continuity_counter = p[3] & 0x0F;
+    if (!msg || msg->fresh() || ((msg->continuity_counter + 1) & 0x0f) != continuity_counter) {
+        return false;
+    }
+
+    // Skip the adaptation field, which should not be too large.
+    int nb_header = 4;
+    int adaption_field_control = (p[3] >> 4) & 0x03;
+    if (adaption_field_control == SrsTsAdaptationFieldTypeBoth) {
+        int adaption_field_length = p[4];
+        if (adaption_field_length > 182) {
+            return false;
+        }
+        nb_header += 1 + adaption_field_length;
+    } else if (adaption_field_control != SrsTsAdaptationFieldTypePayloadOnly) {
+        return false;
+    }
+
+    msg->continuity_counter = continuity_counter;
+
+    int nb_bytes = SRS_TS_PACKET_SIZE - nb_header;
+    if (msg->PES_packet_length > 0) {
+        nb_bytes = srs_min(nb_bytes, msg->PES_packet_length - msg->payload->length());
+    }
+
+    if (nb_bytes > 0) {
+        msg->payload->append((char*)p + nb_header, nb_bytes);
+    }
+    stream->skip(nb_header + srs_max(0, nb_bytes));
+
+    // check msg, reap when completed.
+    if (msg->completed(0)) {
+        *ppmsg = msg;
+        channel->msg = NULL;
+    }
+
+    return true;
+}
+
 srs_error_t SrsTsContext::encode(ISrsStreamWriter* writer, SrsTsMessage* msg, SrsVideoCodecId vc, SrsAudioCodecId ac)
 {
     srs_error_t err = srs_success;
@@ -385,18 +524,18 @@ srs_error_t SrsTsContext::encode_pat_pmt(ISrsStreamWriter* writer, int16_t vpid,
 
         pkt->sync_byte = sync_byte;
 
-        SrsUniquePtr<char[]> buf(new char[SRS_TS_PACKET_SIZE]);
+        char buf[SRS_TS_PACKET_SIZE];
 
         // set the left bytes with 0xFF.
         int nb_buf = pkt->size();
         srs_assert(nb_buf < SRS_TS_PACKET_SIZE);
-        memset(buf.get() + nb_buf, 0xFF, SRS_TS_PACKET_SIZE - nb_buf);
+        memset(buf + nb_buf, 0xFF, SRS_TS_PACKET_SIZE - nb_buf);
         
-        SrsBuffer stream(buf.get(), nb_buf);
+        SrsBuffer stream(buf, nb_buf);
         if ((err = pkt->encode(&stream)) != srs_success) {
             return srs_error_wrap(err, "ts: encode packet");
         }
-        if ((err = writer->write(buf.get(), SRS_TS_PACKET_SIZE, NULL)) != srs_success) {
+        if ((err = writer->write(buf, SRS_TS_PACKET_SIZE, NULL)) != srs_success) {
             return srs_error_wrap(err, "ts: write packet");
         }
     }
@@ -405,18 +544,18 @@ srs_error_t SrsTsContext::encode_pat_pmt(ISrsStreamWriter* writer, int16_t vpid,
 
         pkt->sync_byte = sync_byte;
 
-        SrsUniquePtr<char[]> buf(new char[SRS_TS_PACKET_SIZE]);
+        char buf[SRS_TS_PACKET_SIZE];
 
         // set the left bytes with 0xFF.
         int nb_buf = pkt->size();
         srs_assert(nb_buf < SRS_TS_PACKET_SIZE);
-        memset(buf.get() + nb_buf, 0xFF, SRS_TS_PACKET_SIZE - nb_buf);
+        memset(buf + nb_buf, 0xFF, SRS_TS_PACKET_SIZE - nb_buf);
         
-        SrsBuffer stream(buf.get(), nb_buf);
+        SrsBuffer stream(buf, nb_buf);
         if ((err = pkt->encode(&stream)) != srs_success) {
             return srs_error_wrap(err, "ts: encode packet");
         }
-        if ((err = writer->write(buf.get(), SRS_TS_PACKET_SIZE, NULL)) != srs_success) {
+        if ((err = writer->write(buf, SRS_TS_PACKET_SIZE, NULL)) != srs_success) {
             return srs_error_wrap(err, "ts: write packet");
         }
     }
@@ -427,6 +566,23 @@ srs_error_t SrsTsContext::encode_pat_pmt(ISrsStreamWriter* writer, int16_t vpid,
     return err;
 }
 
+// Encode the 33bits timestamp in 5B, with the 4bits flag in the first byte.
+static inline char* srs_ts_encode_33bits(char* p, uint8_t fb, int64_t v)
+{
+    int32_t val = int32_t(fb << 4 | (((v >> 30) & 0x07) << 1) | 1);
+    *p++ = val;
+
+    val = int32_t((((v >> 15) & 0x7fff) << 1) | 1);
+    *p++ = (val >> 8);
+    *p++ = val;
+
+    val = int32_t((((v) & 0x7fff) << 1) | 1);
+    *p++ = (val >> 8);
+    *p++ = val;
+
+    return p;
+}
+
 srs_error_t SrsTsContext::encode_pes(ISrsStreamWriter* writer, SrsTsMessage* msg, int16_t pid, SrsTsStream sid, bool pure_audio)
 {
     srs_error_t err = srs_success;
@@ -455,76 +611,122 @@ srs_error_t SrsTsContext::encode_pes(ISrsStreamWriter* writer, SrsTsMessage* msg
     char* start = msg->payload->bytes();
     char* end = start + msg->payload->length();
     char* p = start;
-    
-    while (p < end) {
-        SrsTsPacket* pkt_raw = NULL;
-        if (p == start) {
-            // write pcr according to message.
-            bool write_pcr = msg->write_pcr;
-            
-            // for pure audio, always write pcr.
-            // TODO: FIXME: maybe only need to write at begin and end of ts.
-            if (pure_audio && msg->is_audio()) {
-                write_pcr = true;
-            }
-            
-            // it's ok to set pcr equals to dts,
-            // @see https://github.com/ossrs/srs/issues/311
-            // Fig. 3.18. Program Clock Reference of Digital-Video-and-Audio-Broadcasting-Technology, page 65
-            // In MPEG-2, these are the "Program Clock Refer- ence" (PCR) values which are
-            // nothing else than an up-to-date copy of the STC counter fed into the transport
-            // stream at a certain time. The data stream thus carries an accurate internal
-            // "clock time". All coding and de- coding processes are controlled by this clock
-            // time. To do this, the receiver, i.e. the MPEG decoder, must read out the
-            // "clock time", namely the PCR values, and compare them with its own internal
-            // system clock, that is to say its own 42 bit counter.
-            int64_t pcr = write_pcr? msg->dts : -1;
-            
-            // TODO: FIXME: finger it why use discontinuity of msg.
-            pkt_raw = SrsTsPacket::create_pes_first(this,
-                pid, msg->sid, channel->continuity_counter++, msg->is_discontinuity,
-                pcr, msg->dts, msg->pts, msg->payload->length()
-            );
-        } else {
-            pkt_raw = SrsTsPacket::create_pes_continue(this, pid, msg->sid, channel->continuity_counter++);
-        }
-        SrsUniquePtr<SrsTsPacket> pkt(pkt_raw);
 
-        pkt->sync_byte = sync_byte;
+    // write pcr according to message.
+    bool write_pcr = msg->write_pcr;
 
-        SrsUniquePtr<char[]> buf(new char[SRS_TS_PACKET_SIZE]);
+    // for pure audio, always write pcr.
+    // TODO: FIXME: maybe only need to write at begin and end of ts.
+    if (pure_audio && msg->is_audio()) {
+        write_pcr = true;
+    }
 
-        // set the left bytes with 0xFF.
-        int nb_buf = pkt->size();
-        srs_assert(nb_buf < SRS_TS_PACKET_SIZE);
-        
-        int left = (int)srs_min(end - p, SRS_TS_PACKET_SIZE - nb_buf);
-        int nb_stuffings = SRS_TS_PACKET_SIZE - nb_buf - left;
+    // The size of PES header, 9B fixed header plus 5B pts or 10B pts and dts.
+    bool has_dts = (msg->dts != msg->pts);
+    int nb_pes_header = 9 + (has_dts ? 10 : 5);
+
+    // The PES_packet_length is the payload plus the optional header, 0 for large video frame.
+    int nb_payload = msg->payload->length();
+    int pplv = (nb_payload > 0xFFFF) ? 0 : nb_payload + 3 + (nb_pes_header - 9);
+    pplv = (pplv > 0xFFFF) ? 0 : pplv;
+
+    // check sync, the diff of dts and pts should never greater than 1s.
+    if (has_dts && (msg->dts - msg->pts > 90000 || msg->pts - msg->dts > 90000)) {
+        srs_warn("ts: sync dts=%" PRId64 ", pts=%" PRId64, msg->dts, msg->pts);
+    }
+
+    // The first packet carries at most 8B adaptation field and the PES header, and a packet might defer one
+    // byte to the next packet for stuffing, so it's safe to reserve two more packets.
+    int nb_packets = (nb_payload + 8 + nb_pes_header) / (SRS_TS_PACKET_SIZE - 4) + 2;
+    if (nb_pes_buf < nb_packets * SRS_TS_PACKET_SIZE) {
+        srs_freepa(pes_buf);
+        nb_pes_buf = srs_max(nb_packets * SRS_TS_PACKET_SIZE, SRS_TS_PACKET_SIZE * 64);
+        pes_buf = new char[nb_pes_buf];
+    }
+
+    // The template of TS header, only the payload_unit_start_indicator, adaption_field_control and
+    // continuity_counter changes for packets of the same PID.
+    uint8_t pid0 = (uint8_t)((pid >> 8) & 0x1F);
+    uint8_t pid1 = (uint8_t)(pid & 0xFF);
+
+    char* pkt = pes_buf;
+    while (p < end) {
+        bool first = (p == start);
+
+        // it's ok to set pcr equals to dts,
+        // @see https://github.com/ossrs/srs/issues/311
+        bool has_pcr = first && write_pcr;
+        int nb_af = has_pcr ? 8 : 0;
+        int nb_header = 4 + nb_af + (first ? nb_pes_header : 0);
+
+        int left = (int)srs_min(end - p, SRS_TS_PACKET_SIZE - nb_header);
+        int nb_stuffings = SRS_TS_PACKET_SIZE - nb_header - left;
         if (nb_stuffings > 0) {
-            // set all bytes to stuffings.
-            memset(buf.get(), 0xFF, SRS_TS_PACKET_SIZE);
-            
-            // padding with stuffings.
-            pkt->padding(nb_stuffings);
-            
-            // size changed, recalc it.
-            nb_buf = pkt->size();
-            srs_assert(nb_buf < SRS_TS_PACKET_SIZE);
-            
-            left = (int)srs_min(end - p, SRS_TS_PACKET_SIZE - nb_buf);
-            nb_stuffings = SRS_TS_PACKET_SIZE - nb_buf - left;
-            srs_assert(nb_stuffings == 0);
+            // Create an empty adaptation field of 2B for stuffings, or extend the existing one. Note that for
+            // only one stuffing byte, the 2B empty adaptation field defers one payload byte to next packet.
+            if (!nb_af) {
+                nb_af = 2;
+                nb_header += 2;
+                nb_stuffings = srs_max(0, nb_stuffings - 2);
+            }
+            nb_af += nb_stuffings;
+            nb_header += nb_stuffings;
+            left = (int)srs_min(end - p, SRS_TS_PACKET_SIZE - nb_header);
+            srs_assert(nb_header + left == SRS_TS_PACKET_SIZE);
+        }
+
+        // 4B ts packet header.
+        char* q = pkt;
+        *q++ = sync_byte;
+        *q++ = (char)(pid0 | (first ? 0x40 : 0x00));
+        *q++ = (char)pid1;
+        *q++ = (char)((channel->continuity_counter++ & 0x0F) | (nb_af ? 0x30 : 0x10));
+
+        // optional: adaptation field, with pcr and stuffings.
+        if (nb_af) {
+            *q++ = (char)(nb_af - 1);
+            *q++ = (char)(has_pcr ? ((msg->is_discontinuity ? 0x80 : 0x00) | 0x10) : 0x00);
+
+            if (has_pcr) {
+                // @remark, use pcr base and ignore the extension
+                // @see https://github.com/ossrs/srs/issues/250#issuecomment-71349370
+                int64_t pcrv = ((int64_t)0x3F << 9) & 0x7E00;
+                pcrv |= (msg->dts << 15) & 0xFFFFFFFF8000LL;
+                *q++ = (char)(pcrv >> 40);
+                *q++ = (char)(pcrv >> 32);
+                *q++ = (char)(pcrv >> 24);
+                *q++ = (char)(pcrv >> 16);
+                *q++ = (char)(pcrv >> 8);
+                *q++ = (char)pcrv;
+            }
+
+            int nb_reserved = nb_af - (has_pcr ? 8 : 2);
+            memset(q, 0xFF, nb_reserved);
+            q += nb_reserved;
+        }
+
+        // optional: PES header, for the first packet.
+        if (first) {
+            *q++ = 0x00; *q++ = 0x00; *q++ = 0x01;
+            *q++ = (char)msg->sid;
+            *q++ = (char)(pplv >> 8);
+            *q++ = (char)pplv;
+            *q++ = (char)0x80;
+            *q++ = (char)(has_dts ? 0xC0 : 0x80);
+            *q++ = (char)(nb_pes_header - 9);
+            q = srs_ts_encode_33bits(q, has_dts ? 0x03 : 0x02, msg->pts);
+            if (has_dts) {
+                q = srs_ts_encode_33bits(q, 0x01, msg->dts);
+            }
         }
-        memcpy(buf.get() + nb_buf, p, left);
+
+        memcpy(q, p, left);
         p += left;
-        
-        SrsBuffer stream(buf.get(), nb_buf);
-        if ((err = pkt->encode(&stream)) != srs_success) {
-            return srs_error_wrap(err, "ts: encode packet");
-        }
-        if ((err = writer->write(buf.get(), SRS_TS_PACKET_SIZE, NULL)) != srs_success) {
-            return srs_error_wrap(err, "ts: write packet");
-        }
+        pkt += SRS_TS_PACKET_SIZE;
+    }
+
+    if ((err = writer->write(pes_buf, pkt - pes_buf, NULL)) != srs_success) {
+        return srs_error_wrap(err, "ts: write packets");
     }
     
     return err;
@@ -557,6 +759,10 @@ srs_error_t SrsTsPacket::decode(SrsBuffer* stream, SrsTsMessage** ppmsg)
     srs_error_t err = srs_success;
     
     int pos = stream->pos();
+
+    // The packet might be reused by context, so reset the fields.
+    srs_freep(adaptation_field);
+    srs_freep(payload);
     
     // 4B ts packet header.
     if (!stream->require(4)) {
@@ -1935,7 +2141,7 @@ srs_error_t SrsTsPayloadPES::decode(SrsBuffer* stream, SrsTsMessage** ppmsg)
     // init msg.
     SrsTsMessage* msg = channel->msg;
     if (!msg) {
-        msg = new SrsTsMessage(channel, packet);
+        msg = packet->context->acquire_message(channel, packet);
         channel->msg = msg;
     }
 
@@ -1951,7 +2157,7 @@ srs_error_t SrsTsPayloadPES::decode(SrsBuffer* stream, SrsTsMessage** ppmsg)
             msg->PES_packet_length, packet->payload_unit_start_indicator, packet->continuity_counter);
 
         stream->skip(stream->size() - stream->pos());
-        srs_freep(msg);
+        packet->context->release_message(msg);
         channel->msg = NULL;
         return err;
     }
@@ -1964,7 +2170,7 @@ srs_error_t SrsTsPayloadPES::decode(SrsBuffer* stream, SrsTsMessage** ppmsg)
 
         // reparse current msg.
         stream->skip(stream->pos() * -1);
-        srs_freep(msg);
+        packet->context->release_message(msg);
         channel->msg = NULL;
         return err;
     }
@@ -1985,7 +2191,7 @@ srs_error_t SrsTsPayloadPES::decode(SrsBuffer* stream, SrsTsMessage** ppmsg)
 
             // reparse current msg.
             stream->skip(stream->pos() * -1);
-            srs_freep(msg);
+            packet->context->release_message(msg);
             channel->msg = NULL;
             return err;
         }
@@ -2025,6 +2231,7 @@ srs_error_t SrsTsPayloadPES::decode(SrsBuffer* stream, SrsTsMessage** ppmsg)
         if (pes.has_payload_) {
             // The size of message, might be 0 or a positive value.
             msg->PES_packet_length = pes.nb_payload_;
+            msg->payload->reserve(pes.nb_payload_);
 
             // xB
             if ((err = msg->dump(stream, &pes.nb_bytes)) != srs_success) {
@@ -2738,45 +2945,49 @@ void SrsTsContextWriter::set_acodec(SrsAudioCodecId v)
 
 SrsEncFileWriter::SrsEncFileWriter()
 {
-    memset(iv,0,16);
-    
-    buf = new char[HLS_AES_ENCRYPT_BLOCK_LENGTH];
-    memset(buf, 0, HLS_AES_ENCRYPT_BLOCK_LENGTH);
-    
-    nb_buf = 0;
-    key = (unsigned char*)new AES_KEY();
+    ctx = EVP_CIPHER_CTX_new();
+    configured = false;
+
+    cipher = NULL;
+    nb_cipher = 0;
 }
 
 SrsEncFileWriter::~SrsEncFileWriter()
 {
-    srs_freepa(buf);
-    
-    AES_KEY* k = (AES_KEY*)key;
-    srs_freep(k);
+    srs_freepa(cipher);
+
+    EVP_CIPHER_CTX_free((EVP_CIPHER_CTX*)ctx);
 }
 
 srs_error_t SrsEncFileWriter::write(void* data, size_t count, ssize_t* pnwrite)
 {
     srs_error_t err = srs_success;
     
-    srs_assert(count == SRS_TS_PACKET_SIZE);
+    srs_assert((count % SRS_TS_PACKET_SIZE) == 0);
 
-    if (nb_buf < HLS_AES_ENCRYPT_BLOCK_LENGTH) {
-        memcpy(buf + nb_buf, (char*)data, SRS_TS_PACKET_SIZE);
-        nb_buf += SRS_TS_PACKET_SIZE;
+    if (!configured) {
+        return srs_error_new(ERROR_SYSTEM_FILE_WRITE, "no cipher");
     }
-    
-    if (nb_buf == HLS_AES_ENCRYPT_BLOCK_LENGTH) {
-        nb_buf = 0;
 
-        SrsUniquePtr<char[]> cipher(new char[HLS_AES_ENCRYPT_BLOCK_LENGTH]);
+    // The EVP caches the partial block, so the output is at most one block more than input.
+    int size = (int)count + HLS_AES_BLOCK_SIZE;
+    if (nb_cipher < size) {
+        srs_freepa(cipher);
+        nb_cipher = srs_max(size, HLS_AES_ENCRYPT_BLOCK_LENGTH * 16);
+        cipher = new unsigned char[nb_cipher];
+    }
 
-        AES_KEY* k = (AES_KEY*)key;
-        AES_cbc_encrypt((unsigned char *)buf, (unsigned char *)cipher.get(), HLS_AES_ENCRYPT_BLOCK_LENGTH, k, iv, AES_ENCRYPT);
-        
-        if ((err = SrsFileWriter::write(cipher.get(), HLS_AES_ENCRYPT_BLOCK_LENGTH, pnwrite)) != srs_success) {
-            return srs_error_wrap(err, "write cipher");
-        }
+    int nb_out = 0;
+    if (!EVP_EncryptUpdate((EVP_CIPHER_CTX*)ctx, cipher, &nb_out, (unsigned char*)data, (int)count)) {
+        return srs_error_new(ERROR_SYSTEM_FILE_WRITE, "encrypt %d bytes", (int)count);
+    }
+
+    if (nb_out > 0 && (err = SrsFileWriter::write(cipher, nb_out, NULL)) != srs_success) {
+        return srs_error_wrap(err, "write cipher");
+    }
+
+    if (pnwrite) {
+        *pnwrite = count;
     }
     
     return err;
@@ -2785,37 +2996,35 @@ srs_error_t SrsEncFileWriter::write(void* data, size_t count, ssize_t* pnwrite)
 srs_error_t SrsEncFileWriter::config_cipher(unsigned char* key, unsigned char* iv)
 {
     srs_error_t err = srs_success;
-    
-    memcpy(this->iv, iv, 16);
-  
-    AES_KEY* k = (AES_KEY*)this->key;
-    if (AES_set_encrypt_key(key, 16 * 8, k)) {
+
+    // Use the AES-128-CBC with PKCS7 padding, which is accelerated by AES-NI if available.
+    EVP_CIPHER_CTX* c = (EVP_CIPHER_CTX*)ctx;
+    if (!EVP_EncryptInit_ex(c, EVP_aes_128_cbc(), NULL, key, iv)) {
         return srs_error_new(ERROR_SYSTEM_FILE_WRITE, "set aes key failed");
     }
+    EVP_CIPHER_CTX_set_padding(c, 1);
+    configured = true;
     
     return err;
 }
 
 void SrsEncFileWriter::close()
 {
-    if(nb_buf > 0) {
-        int nb_padding = 16 - (nb_buf % 16);
-        if (nb_padding > 0) {
-            memset(buf + nb_buf, nb_padding, nb_padding);
-        }
-
-        SrsUniquePtr<char[]> cipher(new char[nb_buf + nb_padding]);
-
-        AES_KEY* k = (AES_KEY*)key;
-        AES_cbc_encrypt((unsigned char *)buf, (unsigned char *)cipher.get(), nb_buf + nb_padding, k, iv, AES_ENCRYPT);
-        
-        srs_error_t err = srs_success;
-        if ((err = SrsFileWriter::write(cipher.get(), nb_buf + nb_padding, NULL)) != srs_success) {
-            srs_warn("ignore err %s", srs_error_desc(err).c_str());
-            srs_error_reset(err);
+    if (configured) {
+        configured = false;
+
+        // Write the left bytes with padding.
+        unsigned char padding[HLS_AES_BLOCK_SIZE];
+        int nb_padding = 0;
+        if (!EVP_EncryptFinal_ex((EVP_CIPHER_CTX*)ctx, padding, &nb_padding)) {
+            srs_warn("ignore encrypt final failed");
+        } else if (nb_padding > 0) {
+            srs_error_t err = srs_success;
+            if ((err = SrsFileWriter::write(padding, nb_padding, NULL)) != srs_success) {
+                srs_warn("ignore err %s", srs_error_desc(err).c_str());
+                srs_error_reset(err);
+            }
         }
-
-        nb_buf = 0;
     }
     
     SrsFileWriter::close();
@@ -275,6 +275,9 @@ public:
     // for user maybe need to parse the message by queue.
     // @remark we always use the payload of original message.
     virtual SrsTsMessage* detach();
+    // Detach the ts message to cp, which is reused by user to avoid allocating.
+    // @remark The payload is swapped, so this message takes the payload of cp, which should be empty.
+    virtual void detach_to(SrsTsMessage* cp);
 };
 
 // The ts message handler.
@@ -286,6 +289,8 @@ public:
 public:
     // When ts context got message, use handler to process it.
     // @param msg the ts msg, user should never free it.
+    // @remark The message and its payload is reused by context after callback, so user should copy the payload
+    //      or detach the message to keep it.
     // @return an int error code.
     virtual srs_error_t on_ts_message(SrsTsMessage* msg) = 0;
 };
@@ -300,12 +305,23 @@ private:
     bool ready;
 private:
     std::map<int, SrsTsChannel*> pids;
+    // The flat table of pids, to get the channel without map lookup.
+    std::vector<SrsTsChannel*> flat_pids;
     bool pure_audio;
     int8_t sync_byte;
 private:
     // when any codec changed, write the PAT/PMT.
     SrsVideoCodecId vcodec;
     SrsAudioCodecId acodec;
+private:
+    // The buffer to mux a whole PES to TS packets, reused for all messages and only grows.
+    char* pes_buf;
+    int nb_pes_buf;
+private:
+    // For decoder, the packet reused for all TS packets.
+    SrsTsPacket* packet;
+    // For decoder, the messages to reuse, with the payload buffer which keeps its capacity.
+    std::vector<SrsTsMessage*> free_msgs;
 public:
     SrsTsContext();
     virtual ~SrsTsContext();
@@ -330,6 +346,14 @@ public:
     // @param handler The ts message handler to process the msg.
     // @remark We will consume all bytes in stream.
     virtual srs_error_t decode(SrsBuffer* stream, ISrsTsHandler* handler);
+    // Get a message to decode PES, reuse the freed one if possible.
+    virtual SrsTsMessage* acquire_message(SrsTsChannel* channel, SrsTsPacket* pkt);
+    // Free the message, which is reused by next PES.
+    virtual void release_message(SrsTsMessage* msg);
+private:
+    // Decode the continuous PES packet in place, without parsing the packet by SrsTsPacket. Return false to
+    // fallback to SrsTsPacket, for example, PSI packet, PES start packet or discontinuous packet.
+    virtual bool decode_pes_fast(SrsBuffer* stream, SrsTsMessage** ppmsg);
 public:
     // Encode ts video/audio messages to the PES packets, as PES stream.
     // @param msg The video/audio msg to write to ts.
@@ -340,6 +364,7 @@ public:
     virtual srs_error_t encode(ISrsStreamWriter* writer, SrsTsMessage* msg, SrsVideoCodecId vc, SrsAudioCodecId ac);
 private:
     virtual srs_error_t encode_pat_pmt(ISrsStreamWriter* writer, int16_t vpid, SrsTsStream vs, int16_t apid, SrsTsStream as);
+    // Mux the PES to TS packets in the reused buffer, without creating SrsTsPacket, then write all packets at once.
     virtual srs_error_t encode_pes(ISrsStreamWriter* writer, SrsTsMessage* msg, int16_t pid, SrsTsStream sid, bool pure_audio);
 };
 
@@ -1289,16 +1314,20 @@ public:
     SrsEncFileWriter();
     virtual ~SrsEncFileWriter();
 public:
+    // Encrypt the TS packets to file, the data is not changed.
     virtual srs_error_t write(void* data, size_t count, ssize_t* pnwrite);
+    // Write the last block with padding and close the file.
     virtual void close();
 public:
+    // Set the key and iv, should be called after open and before write.
     srs_error_t config_cipher(unsigned char* key, unsigned char* iv);
 private:
-    unsigned char* key;
-    unsigned char iv[16];
-private:
-    char* buf;
-    int nb_buf;
+    // The EVP cipher context, which caches the partial block.
+    void* ctx;
+    bool configured;
+    // The reused buffer for cipher.
+    unsigned char* cipher;
+    int nb_cipher;
 };
 
 // TS messages cache, to group frames to TS message,
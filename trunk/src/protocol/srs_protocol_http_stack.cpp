@@ -18,12 +18,18 @@ using namespace std;
 #include <srs_protocol_json.hpp>
 #include <srs_core_autofree.hpp>
 #include <srs_protocol_utility.hpp>
+#include <srs_protocol_st.hpp>
 
 #define SRS_HTTP_DEFAULT_PAGE "index.html"
 
 // @see ISrsHttpMessage._http_ts_send_buffer
 #define SRS_HTTP_TS_SEND_BUFFER_SIZE 4096
 
+// For LL-DASH, the interval to check the growth of in-progress segment.
+#define SRS_HTTP_M4S_CHUNKED_INTERVAL (10 * SRS_UTIME_MILLISECONDS)
+// For LL-DASH, stop serving the in-progress segment when no growth in this timeout.
+#define SRS_HTTP_M4S_CHUNKED_TIMEOUT (30 * SRS_UTIME_SECONDS)
+
 #define SRS_HTTP_AUTH_SCHEME_BASIC "Basic"
 #define SRS_HTTP_AUTH_PREFIX_BASIC SRS_HTTP_AUTH_SCHEME_BASIC " "
 
@@ -392,6 +398,13 @@ srs_error_t SrsHttpFileServer::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMes
     string upath = r->path();
     string fullpath = srs_http_fs_fullpath(dir, entry->pattern, upath);
 
+    // For LL-DASH, the in-progress segment is written to the tmp file, serve it by chunked transfer.
+    if (!_srs_path_exists(fullpath) && srs_string_ends_with(fullpath, ".m4s") && _srs_path_exists(fullpath + ".tmp")) {
+        srs_trace("http match in-progress file=%s.tmp, pattern=%s, upath=%s",
+              fullpath.c_str(), entry->pattern.c_str(), upath.c_str());
+        return serve_m4s_chunked(w, r, fullpath);
+    }
+
     // stat current dir, if exists, return error.
     if (!_srs_path_exists(fullpath)) {
         srs_warn("http miss file=%s, pattern=%s, upath=%s",
@@ -563,6 +576,67 @@ srs_error_t SrsHttpFileServer::serve_ts_file(ISrsHttpResponseWriter * w, ISrsHtt
     return serve_ts_ctx(w, r, fullpath);
 }
 
+srs_error_t SrsHttpFileServer::serve_m4s_chunked(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, string fullpath)
+{
+    srs_error_t err = srs_success;
+
+    string tmppath = fullpath + ".tmp";
+    SrsUniquePtr<SrsFileReader> fs(fs_factory->create_file_reader());
+
+    if ((err = fs->open(tmppath)) != srs_success) {
+        // The segment might be reaped right now, serve the whole file.
+        if (_srs_path_exists(fullpath)) {
+            srs_freep(err);
+            return serve_file(w, r, fullpath);
+        }
+        return srs_error_wrap(err, "open file %s", tmppath.c_str());
+    }
+
+    w->header()->set_content_type("video/iso.segment");
+
+    // Enter chunked mode, because we didn't set the content-length.
+    w->write_header(SRS_CONSTS_HTTP_OK);
+
+    // We keep the fd of tmp file, which is still valid after renamed to fullpath when reaped.
+    int64_t offset = 0;
+    srs_utime_t last_growth = srs_update_system_time();
+    while (true) {
+        // Check before reading, so that all data is read if the segment is reaped.
+        bool reaped = _srs_path_exists(fullpath);
+
+        int64_t size = fs->filesize();
+        if (size > offset) {
+            if ((err = copy(w, fs.get(), r, size - offset)) != srs_success) {
+                return srs_error_wrap(err, "copy file=%s offset=%" PRId64 " size=%" PRId64, tmppath.c_str(), offset, size);
+            }
+            offset = size;
+            last_growth = srs_update_system_time();
+        }
+
+        if (reaped) {
+            break;
+        }
+
+        // The segment is disposed, for example, the stream is unpublished.
+        if (!_srs_path_exists(tmppath) && !_srs_path_exists(fullpath)) {
+            break;
+        }
+
+        if (srs_update_system_time() - last_growth > SRS_HTTP_M4S_CHUNKED_TIMEOUT) {
+            srs_warn("http in-progress file=%s timeout, offset=%" PRId64, tmppath.c_str(), offset);
+            break;
+        }
+
+        srs_usleep(SRS_HTTP_M4S_CHUNKED_INTERVAL);
+    }
+
+    if ((err = w->final_request()) != srs_success) {
+        return srs_error_wrap(err, "final request");
+    }
+
+    return err;
+}
+
 srs_error_t SrsHttpFileServer::serve_flv_stream(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, string fullpath, int64_t offset)
 {
     // @remark For common http file server, we don't support stream request, please use SrsVodStream instead.
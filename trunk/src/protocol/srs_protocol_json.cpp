@@ -2031,4 +2031,134 @@ SrsAmf0Any* SrsJsonArray::to_amf0()
 ////////////////////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////////////////////
 
+SrsJsonWriter::SrsJsonWriter(std::string* buf)
+{
+    buf_ = buf;
+}
+
+SrsJsonWriter::~SrsJsonWriter()
+{
+}
+
+void SrsJsonWriter::object_start()
+{
+    object_start(NULL);
+}
+
+void SrsJsonWriter::array_start()
+{
+    array_start(NULL);
+}
+
+void SrsJsonWriter::str(const std::string& v)
+{
+    prefix(NULL);
+    escape(v.data(), (int)v.length());
+}
+
+void SrsJsonWriter::integer(int64_t v)
+{
+    integer(NULL, v);
+}
+
+void SrsJsonWriter::object_start(const char* k)
+{
+    prefix(k);
+    buf_->append(SRS_JOBJECT_START);
+    empty_.push_back(true);
+}
+
+void SrsJsonWriter::array_start(const char* k)
+{
+    prefix(k);
+    buf_->append(SRS_JARRAY_START);
+    empty_.push_back(true);
+}
+
+void SrsJsonWriter::str(const char* k, const std::string& v)
+{
+    prefix(k);
+    escape(v.data(), (int)v.length());
+}
+
+void SrsJsonWriter::integer(const char* k, int64_t v)
+{
+    prefix(k);
+
+    char tmp[22];
+    int nn = snprintf(tmp, sizeof(tmp), "%" PRId64, v);
+    buf_->append(tmp, nn);
+}
 
+void SrsJsonWriter::number(const char* k, double v)
+{
+    prefix(k);
+
+    // Same to SrsJsonAny::dumps of number.
+    char tmp[21 + 1];
+    int nn = snprintf(tmp, sizeof(tmp), "%.2f", v);
+    buf_->append(tmp, nn < (int)sizeof(tmp) ? nn : (int)sizeof(tmp) - 1);
+}
+
+void SrsJsonWriter::boolean(const char* k, bool v)
+{
+    prefix(k);
+    buf_->append(v ? "true" : "false");
+}
+
+void SrsJsonWriter::null(const char* k)
+{
+    prefix(k);
+    buf_->append("null");
+}
+
+void SrsJsonWriter::object_end()
+{
+    srs_assert(!empty_.empty());
+    empty_.pop_back();
+    buf_->append(SRS_JOBJECT_END);
+}
+
+void SrsJsonWriter::array_end()
+{
+    srs_assert(!empty_.empty());
+    empty_.pop_back();
+    buf_->append(SRS_JARRAY_END);
+}
+
+void SrsJsonWriter::prefix(const char* k)
+{
+    if (!empty_.empty()) {
+        if (!empty_.back()) {
+            buf_->append(SRS_JFIELD_CONT);
+        }
+        empty_.back() = false;
+    }
+
+    if (k) {
+        escape(k, (int)strlen(k));
+        buf_->append(":");
+    }
+}
+
+void SrsJsonWriter::escape(const char* v, int size)
+{
+    // Same to json_serialize_string, but append to buffer directly.
+    buf_->append("\"");
+
+    const char* end = v + size;
+    for (const char* p = v; p < end; ++p) {
+        switch (*p) {
+            case '"': buf_->append("\\\""); break;
+            case '\\': buf_->append("\\\\"); break;
+            case '\b': buf_->append("\\b"); break;
+            case '\f': buf_->append("\\f"); break;
+            case '\n': buf_->append("\\n"); break;
+            case '\r': buf_->append("\\r"); break;
+            case '\t': buf_->append("\\t"); break;
+            default: buf_->push_back(*p);
+        }
+    }
+
+    buf_->append("\"");
+}
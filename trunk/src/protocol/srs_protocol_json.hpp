@@ -147,6 +147,51 @@ public:
     virtual SrsAmf0Any* to_amf0();
 };
 
+// The writer to encode JSON directly to string, without building the SrsJsonAny tree, which is
+// used to dumps a large number of objects, such as the clients of HTTP API. For example:
+//        std::string buf;
+//        SrsJsonWriter w(&buf);
+//        w.object_start();
+//        w.integer("code", 0);
+//        w.array_start("clients");
+//        w.object_start();
+//        w.str("id", "7f8e9a");
+//        w.object_end();
+//        w.array_end();
+//        w.object_end();
+class SrsJsonWriter
+{
+private:
+    std::string* buf_;
+    // Whether the current object or array is empty, to write the separator.
+    std::vector<bool> empty_;
+public:
+    // @param buf The buffer to append to, user should reserve it.
+    SrsJsonWriter(std::string* buf);
+    virtual ~SrsJsonWriter();
+public:
+    // Write the value in array.
+    virtual void object_start();
+    virtual void array_start();
+    virtual void str(const std::string& v);
+    virtual void integer(int64_t v);
+    // Write the field of object.
+    virtual void object_start(const char* k);
+    virtual void array_start(const char* k);
+    virtual void str(const char* k, const std::string& v);
+    virtual void integer(const char* k, int64_t v);
+    virtual void number(const char* k, double v);
+    virtual void boolean(const char* k, bool v);
+    virtual void null(const char* k);
+    // End the current object or array.
+    virtual void object_end();
+    virtual void array_end();
+private:
+    // Write the separator and the name of field, ignore name if NULL.
+    void prefix(const char* k);
+    void escape(const char* v, int size);
+};
+
 ////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////
@@ -160,21 +160,19 @@ namespace srs_internal
             }
         } else {
             // use key-data to digest.
-            HMAC_CTX *ctx = HMAC_CTX_new();
-            if (ctx == NULL) {
+            // @remark The HMAC context is reused by thread, because it's reset by HMAC_Init_ex, to avoid
+            //      allocating it for each digest.
+            static __thread HMAC_CTX* ctx = NULL;
+            if (!ctx && (ctx = HMAC_CTX_new()) == NULL) {
                 return srs_error_new(ERROR_OpenSslCreateHMAC, "hmac new");
             }
             // @remark, if no key, use EVP_Digest to digest,
             // for instance, in python, hashlib.sha256(data).digest().
             if (HMAC_Init_ex(ctx, temp_key, key_size, EVP_sha256(), NULL) < 0) {
-                HMAC_CTX_free(ctx);
                 return srs_error_new(ERROR_OpenSslSha256Init, "hmac init");
             }
             
-            err = do_openssl_HMACsha256(ctx, data, data_size, temp_digest, &digest_size);
-            HMAC_CTX_free(ctx);
-            
-            if (err != srs_success) {
+            if ((err = do_openssl_HMACsha256(ctx, data, data_size, temp_digest, &digest_size)) != srs_success) {
                 return srs_error_wrap(err, "hmac sha256");
             }
         }
@@ -194,6 +192,45 @@ namespace srs_internal
         "EE386BFB5A899FA5AE9F24117C4B1FE649286651ECE65381" \
         "FFFFFFFFFFFFFFFF"
 
+    // The period to rotate the cached DH key pair.
+    srs_utime_t _srs_dh_rotation = 0;
+    // The cached DH key pair and the time it's generated, of current thread.
+    static __thread SrsDH* _srs_dh = NULL;
+    static __thread srs_utime_t _srs_dh_create_at = 0;
+
+    void srs_dh_set_rotation(srs_utime_t v)
+    {
+        _srs_dh_rotation = v;
+    }
+
+    srs_utime_t srs_dh_rotation()
+    {
+        return _srs_dh_rotation;
+    }
+
+    srs_error_t srs_dh_fetch(SrsDH** pdh)
+    {
+        srs_error_t err = srs_success;
+
+        if (!_srs_dh) {
+            _srs_dh = new SrsDH();
+        }
+
+        // Regenerate the key pair if expired, or never generated.
+        srs_utime_t now = srs_get_system_time();
+        if (!_srs_dh_create_at || _srs_dh_rotation <= 0 || now - _srs_dh_create_at >= _srs_dh_rotation) {
+            // ensure generate 128bytes public key.
+            if ((err = _srs_dh->initialize(true)) != srs_success) {
+                _srs_dh_create_at = 0;
+                return srs_error_wrap(err, "dh init");
+            }
+            _srs_dh_create_at = now;
+        }
+
+        *pdh = _srs_dh;
+        return err;
+    }
+
     SrsDH::SrsDH()
     {
         pdh = NULL;
@@ -345,7 +382,7 @@ namespace srs_internal
         
         random0_size = valid_offset;
         if (random0_size > 0) {
-            random0 = new char[random0_size];
+            random0 = random_;
             srs_random_generate(random0, random0_size);
             snprintf(random0, random0_size, "%s", RTMP_SIG_SRS_HANDSHAKE);
         }
@@ -354,7 +391,7 @@ namespace srs_internal
         
         random1_size = 764 - valid_offset - 128 - 4;
         if (random1_size > 0) {
-            random1 = new char[random1_size];
+            random1 = random_ + random0_size;
             srs_random_generate(random1, random1_size);
             snprintf(random1, random1_size, "%s", RTMP_SIG_SRS_HANDSHAKE);
         }
@@ -362,8 +399,6 @@ namespace srs_internal
     
     key_block::~key_block()
     {
-        srs_freepa(random0);
-        srs_freepa(random1);
     }
     
     srs_error_t key_block::parse(SrsBuffer* stream)
@@ -384,18 +419,16 @@ namespace srs_internal
         srs_assert(valid_offset >= 0);
         
         random0_size = valid_offset;
+        random0 = random0_size > 0 ? random_ : NULL;
         if (random0_size > 0) {
-            srs_freepa(random0);
-            random0 = new char[random0_size];
             stream->read_bytes(random0, random0_size);
         }
         
         stream->read_bytes(key, 128);
         
         random1_size = 764 - valid_offset - 128 - 4;
+        random1 = random1_size > 0 ? random_ + random0_size : NULL;
         if (random1_size > 0) {
-            srs_freepa(random1);
-            random1 = new char[random1_size];
             stream->read_bytes(random1, random1_size);
         }
         
@@ -427,7 +460,7 @@ namespace srs_internal
         
         random0_size = valid_offset;
         if (random0_size > 0) {
-            random0 = new char[random0_size];
+            random0 = random_;
             srs_random_generate(random0, random0_size);
             snprintf(random0, random0_size, "%s", RTMP_SIG_SRS_HANDSHAKE);
         }
@@ -436,7 +469,7 @@ namespace srs_internal
         
         random1_size = 764 - 4 - valid_offset - 32;
         if (random1_size > 0) {
-            random1 = new char[random1_size];
+            random1 = random_ + random0_size;
             srs_random_generate(random1, random1_size);
             snprintf(random1, random1_size, "%s", RTMP_SIG_SRS_HANDSHAKE);
         }
@@ -444,8 +477,6 @@ namespace srs_internal
     
     digest_block::~digest_block()
     {
-        srs_freepa(random0);
-        srs_freepa(random1);
     }
     
     srs_error_t digest_block::parse(SrsBuffer* stream)
@@ -461,18 +492,16 @@ namespace srs_internal
         srs_assert(valid_offset >= 0);
         
         random0_size = valid_offset;
+        random0 = random0_size > 0 ? random_ : NULL;
         if (random0_size > 0) {
-            srs_freepa(random0);
-            random0 = new char[random0_size];
             stream->read_bytes(random0, random0_size);
         }
         
         stream->read_bytes(digest, 32);
         
         random1_size = 764 - 4 - valid_offset - 32;
+        random1 = random1_size > 0 ? random_ + random0_size : NULL;
         if (random1_size > 0) {
-            srs_freepa(random1);
-            random1 = new char[random1_size];
             stream->read_bytes(random1, random1_size);
         }
         
@@ -522,16 +551,13 @@ namespace srs_internal
         srs_error_t err = srs_success;
         
         // generate digest
-        char* c1_digest_raw = NULL;
+        char c1_digest[SRS_OpensslHashSize];
         
-        if ((err = calc_c1_digest(owner, c1_digest_raw)) != srs_success) {
+        if ((err = calc_c1_digest(owner, c1_digest)) != srs_success) {
             return srs_error_wrap(err, "sign c1");
         }
-        
-        srs_assert(c1_digest_raw != NULL);
-        SrsUniquePtr<char[]> c1_digest(c1_digest_raw);
 
-        memcpy(digest.digest, c1_digest.get(), 32);
+        memcpy(digest.digest, c1_digest, 32);
         
         return err;
     }
@@ -540,16 +566,13 @@ namespace srs_internal
     {
         srs_error_t err = srs_success;
         
-        char* c1_digest_raw = NULL;
+        char c1_digest[SRS_OpensslHashSize];
         
-        if ((err = calc_c1_digest(owner, c1_digest_raw)) != srs_success) {
+        if ((err = calc_c1_digest(owner, c1_digest)) != srs_success) {
             return srs_error_wrap(err, "validate c1");
         }
         
-        srs_assert(c1_digest_raw != NULL);
-        SrsUniquePtr<char[]> c1_digest(c1_digest_raw);
-        
-        is_valid = srs_bytes_equals(digest.digest, c1_digest.get(), 32);
+        is_valid = srs_bytes_equals(digest.digest, c1_digest, 32);
         
         return err;
     }
@@ -558,16 +581,15 @@ namespace srs_internal
     {
         srs_error_t err = srs_success;
         
-        SrsDH dh;
-        
-        // ensure generate 128bytes public key.
-        if ((err = dh.initialize(true)) != srs_success) {
-            return srs_error_wrap(err, "dh init");
+        // Use the cached key pair, which is rotated by period.
+        SrsDH* dh = NULL;
+        if ((err = srs_dh_fetch(&dh)) != srs_success) {
+            return srs_error_wrap(err, "dh fetch");
         }
         
         // directly generate the public key.
         int pkey_size = 128;
-        if ((err = dh.copy_shared_key(c1->get_key(), 128, key.key, pkey_size)) != srs_success) {
+        if ((err = dh->copy_shared_key(c1->get_key(), 128, key.key, pkey_size)) != srs_success) {
             return srs_error_wrap(err, "copy shared key");
         }
         
@@ -576,15 +598,12 @@ namespace srs_internal
         // TODO: FIXME: use the actual key size.
         //srs_assert(pkey_size == 128);
         
-        char* s1_digest_raw = NULL;
-        if ((err = calc_s1_digest(owner, s1_digest_raw))  != srs_success) {
+        char s1_digest[SRS_OpensslHashSize];
+        if ((err = calc_s1_digest(owner, s1_digest))  != srs_success) {
             return srs_error_wrap(err, "calc s1 digest");
         }
-        
-        srs_assert(s1_digest_raw != NULL);
-        SrsUniquePtr<char[]> s1_digest(s1_digest_raw);
 
-        memcpy(digest.digest, s1_digest.get(), 32);
+        memcpy(digest.digest, s1_digest, 32);
         
         return err;
     }
@@ -593,21 +612,18 @@ namespace srs_internal
     {
         srs_error_t err = srs_success;
         
-        char* s1_digest_raw = NULL;
+        char s1_digest[SRS_OpensslHashSize];
         
-        if ((err = calc_s1_digest(owner, s1_digest_raw)) != srs_success) {
+        if ((err = calc_s1_digest(owner, s1_digest)) != srs_success) {
             return srs_error_wrap(err, "validate s1");
         }
         
-        srs_assert(s1_digest_raw != NULL);
-        SrsUniquePtr<char[]> s1_digest(s1_digest_raw);
-        
-        is_valid = srs_bytes_equals(digest.digest, s1_digest.get(), 32);
+        is_valid = srs_bytes_equals(digest.digest, s1_digest, 32);
         
         return err;
     }
     
-    srs_error_t c1s1_strategy::calc_c1_digest(c1s1* owner, char*& c1_digest)
+    srs_error_t c1s1_strategy::calc_c1_digest(c1s1* owner, char* c1_digest)
     {
         srs_error_t err = srs_success;
         
@@ -615,22 +631,20 @@ namespace srs_internal
         //     c1s1-part1: n bytes (time, version, key and digest-part1).
         //     digest-data: 32bytes
         //     c1s1-part2: (1536-n-32)bytes (digest-part2)
-        // @return a new allocated bytes, user must free it.
-        SrsUniquePtr<char[]> c1s1_joined_bytes(new char[1536 -32]);
-        if ((err = copy_to(owner, c1s1_joined_bytes.get(), 1536 - 32, false)) != srs_success) {
+        // @remark Use the stack bytes, to avoid allocating for each handshake.
+        char c1s1_joined_bytes[1536 - 32];
+        if ((err = copy_to(owner, c1s1_joined_bytes, 1536 - 32, false)) != srs_success) {
             return srs_error_wrap(err, "copy bytes");
         }
         
-        c1_digest = new char[SRS_OpensslHashSize];
-        if ((err = openssl_HMACsha256(SrsGenuineFPKey, 30, c1s1_joined_bytes.get(), 1536 - 32, c1_digest)) != srs_success) {
-            srs_freepa(c1_digest);
+        if ((err = openssl_HMACsha256(SrsGenuineFPKey, 30, c1s1_joined_bytes, 1536 - 32, c1_digest)) != srs_success) {
             return srs_error_wrap(err, "calc c1 digest");
         }
         
         return err;
     }
     
-    srs_error_t c1s1_strategy::calc_s1_digest(c1s1* owner, char*& s1_digest)
+    srs_error_t c1s1_strategy::calc_s1_digest(c1s1* owner, char* s1_digest)
     {
         srs_error_t err = srs_success;
         
@@ -638,15 +652,13 @@ namespace srs_internal
         //     c1s1-part1: n bytes (time, version, key and digest-part1).
         //     digest-data: 32bytes
         //     c1s1-part2: (1536-n-32)bytes (digest-part2)
-        // @return a new allocated bytes, user must free it.
-        SrsUniquePtr<char[]> c1s1_joined_bytes(new char[1536 -32]);
-        if ((err = copy_to(owner, c1s1_joined_bytes.get(), 1536 - 32, false)) != srs_success) {
+        // @remark Use the stack bytes, to avoid allocating for each handshake.
+        char c1s1_joined_bytes[1536 - 32];
+        if ((err = copy_to(owner, c1s1_joined_bytes, 1536 - 32, false)) != srs_success) {
             return srs_error_wrap(err, "copy bytes");
         }
         
-        s1_digest = new char[SRS_OpensslHashSize];
-        if ((err = openssl_HMACsha256(SrsGenuineFMSKey, 36, c1s1_joined_bytes.get(), 1536 - 32, s1_digest)) != srs_success) {
-            srs_freepa(s1_digest);
+        if ((err = openssl_HMACsha256(SrsGenuineFMSKey, 36, c1s1_joined_bytes, 1536 - 32, s1_digest)) != srs_success) {
             return srs_error_wrap(err, "calc s1 digest");
         }
         
@@ -1141,24 +1153,32 @@ srs_error_t SrsSimpleHandshake::handshake_with_server(SrsHandshakeBytes* hs_byte
     return err;
 }
 
+ISrsHandshakeExecutor::ISrsHandshakeExecutor()
+{
+}
+
+ISrsHandshakeExecutor::~ISrsHandshakeExecutor()
+{
+}
+
 SrsComplexHandshake::SrsComplexHandshake()
 {
+    executor_ = NULL;
 }
 
 SrsComplexHandshake::~SrsComplexHandshake()
 {
 }
 
-srs_error_t SrsComplexHandshake::handshake_with_client(SrsHandshakeBytes* hs_bytes, ISrsProtocolReadWriter* io)
+void SrsComplexHandshake::set_executor(ISrsHandshakeExecutor* v)
+{
+    executor_ = v;
+}
+
+srs_error_t SrsComplexHandshake::create_s0s1s2(SrsHandshakeBytes* hs_bytes)
 {
     srs_error_t err = srs_success;
     
-    ssize_t nsize;
-    
-    if ((err = hs_bytes->read_c0c1(io)) != srs_success) {
-        return srs_error_wrap(err, "read c0c1");
-    }
-    
     // decode c1
     c1s1 c1;
     // try schema0.
@@ -1202,7 +1222,6 @@ srs_error_t SrsComplexHandshake::handshake_with_client(SrsHandshakeBytes* hs_byt
         return srs_error_new(ERROR_RTMP_TRY_SIMPLE_HS, "verify s2 failed, try simple handshake");
     }
     
-    // sendout s0s1s2
     if ((err = hs_bytes->create_s0s1s2()) != srs_success) {
         return srs_error_wrap(err, "create s0s1s2");
     }
@@ -1212,6 +1231,31 @@ srs_error_t SrsComplexHandshake::handshake_with_client(SrsHandshakeBytes* hs_byt
     if ((err = s2.dump(hs_bytes->s0s1s2 + 1537, 1536)) != srs_success) {
         return srs_error_wrap(err, "dump s2");
     }
+    
+    return err;
+}
+
+srs_error_t SrsComplexHandshake::handshake_with_client(SrsHandshakeBytes* hs_bytes, ISrsProtocolReadWriter* io)
+{
+    srs_error_t err = srs_success;
+    
+    ssize_t nsize;
+    
+    if ((err = hs_bytes->read_c0c1(io)) != srs_success) {
+        return srs_error_wrap(err, "read c0c1");
+    }
+    
+    // The DH key and digests are CPU intensive, so we might create s0s1s2 by executor.
+    if (executor_) {
+        err = executor_->execute(hs_bytes);
+    } else {
+        err = create_s0s1s2(hs_bytes);
+    }
+    if (err != srs_success) {
+        return srs_error_wrap(err, "create s0s1s2");
+    }
+    
+    // sendout s0s1s2
     if ((err = io->write(hs_bytes->s0s1s2, 3073, &nsize)) != srs_success) {
         return srs_error_wrap(err, "write s0s1s2");
     }
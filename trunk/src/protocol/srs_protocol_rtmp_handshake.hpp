@@ -31,6 +31,15 @@ namespace srs_internal
     extern uint8_t SrsGenuineFPKey[];
     srs_error_t openssl_HMACsha256(const void* key, int key_size, const void* data, int data_size, void* digest);
     srs_error_t openssl_generate_key(char* public_key, int32_t size);
+
+    class SrsDH;
+
+    // Set the period to rotate the cached DH key pair, 0 to generate key pair for each handshake.
+    extern void srs_dh_set_rotation(srs_utime_t v);
+    extern srs_utime_t srs_dh_rotation();
+    // Fetch the DH key pair of current thread, which is regenerated when exceed the rotation period,
+    // because generating the key pair is the most expensive part of complex handshake.
+    extern srs_error_t srs_dh_fetch(SrsDH** pdh);
     
     // The DH wrapper.
     class SrsDH
@@ -101,6 +110,9 @@ namespace srs_internal
         
         // 4bytes
         int32_t offset;
+    private:
+        // The bytes of random0 and random1, to avoid allocating.
+        char random_[764 - 128 - 4];
     public:
         key_block();
         virtual ~key_block();
@@ -137,6 +149,9 @@ namespace srs_internal
         // (764-4-offset-32)bytes
         char* random1;
         int random1_size;
+    private:
+        // The bytes of random0 and random1, to avoid allocating.
+        char random_[764 - 4 - 32];
     public:
         digest_block();
         virtual ~digest_block();
@@ -223,10 +238,10 @@ namespace srs_internal
         // For server:  validate the parsed s1 schema
         virtual srs_error_t s1_validate_digest(c1s1* owner, bool& is_valid);
     public:
-        // Calculate the digest for c1
-        virtual srs_error_t calc_c1_digest(c1s1* owner, char*& c1_digest);
-        // Calculate the digest for s1
-        virtual srs_error_t calc_s1_digest(c1s1* owner, char*& s1_digest);
+        // Calculate the digest for c1, the c1_digest must be SRS_OpensslHashSize bytes.
+        virtual srs_error_t calc_c1_digest(c1s1* owner, char* c1_digest);
+        // Calculate the digest for s1, the s1_digest must be SRS_OpensslHashSize bytes.
+        virtual srs_error_t calc_s1_digest(c1s1* owner, char* s1_digest);
         // Copy whole c1s1 to bytes.
         // @param size must always be 1536 with digest, and 1504 without digest.
         virtual srs_error_t copy_to(c1s1* owner, char* bytes, int size, bool with_digest) = 0;
@@ -412,14 +427,33 @@ public:
     virtual srs_error_t handshake_with_server(SrsHandshakeBytes* hs_bytes, ISrsProtocolReadWriter* io);
 };
 
+// The executor to create s0s1s2 of complex handshake, for example, in a worker thread.
+class ISrsHandshakeExecutor
+{
+public:
+    ISrsHandshakeExecutor();
+    virtual ~ISrsHandshakeExecutor();
+public:
+    // Create s0s1s2 by c0c1, see SrsComplexHandshake::create_s0s1s2.
+    virtual srs_error_t execute(SrsHandshakeBytes* hs_bytes) = 0;
+};
+
 // Complex handshake,
 // @see also crtmp(crtmpserver) or librtmp,
 // @see also: http://blog.csdn.net/win_lin/article/details/13006803
 class SrsComplexHandshake
 {
+private:
+    // The executor to create s0s1s2, NULL to create in current thread.
+    ISrsHandshakeExecutor* executor_;
 public:
     SrsComplexHandshake();
     virtual ~SrsComplexHandshake();
+public:
+    // Set the executor to create s0s1s2.
+    void set_executor(ISrsHandshakeExecutor* v);
+    // Validate c1 and create s0s1s2 to hs_bytes. It's CPU intensive without any IO, so it's able to run in any thread.
+    static srs_error_t create_s0s1s2(SrsHandshakeBytes* hs_bytes);
 public:
     // Complex hanshake.
     // @return user must:
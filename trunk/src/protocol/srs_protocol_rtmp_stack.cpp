@@ -1212,6 +1212,31 @@ srs_error_t SrsProtocol::read_message_payload(SrsChunkStream* chunk, SrsCommonMe
     memcpy(chunk->msg->payload + chunk->msg->size, in_buffer->read_slice(payload_size), payload_size);
     chunk->msg->size += payload_size;
     
+    // Fast path for large message, such as 4K video frame in small chunks, which is sent in a run of fmt=3 chunks
+    // of the same cid, so we copy all chunks in buffer to the message at once, without parsing the header of each
+    // chunk. It's the same as the normal path, because the fmt=3 chunk never changes the header of message.
+    // @remark Only for 1B basic header, and no extended timestamp which is optional for fmt=3 chunks.
+    if (chunk->header.payload_length > chunk->msg->size && chunk->cid > 1 && chunk->cid < 64 && !chunk->extended_timestamp) {
+        char fmt3 = (char)((RTMP_FMT_TYPE3 << 6) | chunk->cid);
+        char* start = in_buffer->bytes();
+        char* p = start;
+        char* end = p + in_buffer->size();
+        
+        while (chunk->header.payload_length > chunk->msg->size && p < end && *p == fmt3) {
+            int size = srs_min(chunk->header.payload_length - chunk->msg->size, in_chunk_size);
+            if (end - p < 1 + size) {
+                break;
+            }
+            
+            memcpy(chunk->msg->payload + chunk->msg->size, p + 1, size);
+            chunk->msg->size += size;
+            chunk->msg_count++;
+            p += 1 + size;
+        }
+        
+        in_buffer->read_slice((int)(p - start));
+    }
+    
     // got entire RTMP message?
     if (chunk->header.payload_length == chunk->msg->size) {
         *pmsg = chunk->msg;
@@ -1570,6 +1595,7 @@ string srs_client_type_string(SrsRtmpConnType type)
         case SrsRtcConnPublish: return "rtc-publish";
         case SrsSrtConnPlay: return "srt-play";
         case SrsSrtConnPublish: return "srt-publish";
+        case SrsCasterPublish: return "caster-publish";
         default: return "Unknown";
     }
 }
@@ -2125,6 +2151,7 @@ SrsRtmpServer::SrsRtmpServer(ISrsProtocolReadWriter* skt)
     io = skt;
     protocol = new SrsProtocol(skt);
     hs_bytes = new SrsHandshakeBytes();
+    hs_executor_ = NULL;
 }
 
 SrsRtmpServer::~SrsRtmpServer()
@@ -2138,6 +2165,11 @@ uint32_t SrsRtmpServer::proxy_real_ip()
     return hs_bytes->proxy_real_ip;
 }
 
+void SrsRtmpServer::set_handshake_executor(ISrsHandshakeExecutor* v)
+{
+    hs_executor_ = v;
+}
+
 void SrsRtmpServer::set_auto_response(bool v)
 {
     protocol->set_auto_response(v);
@@ -2217,6 +2249,7 @@ srs_error_t SrsRtmpServer::handshake()
     srs_assert(hs_bytes);
     
     SrsComplexHandshake complex_hs;
+    complex_hs.set_executor(hs_executor_);
     if ((err = complex_hs.handshake_with_client(hs_bytes, io)) != srs_success) {
         if (srs_error_code(err) == ERROR_RTMP_TRY_SIMPLE_HS) {
             srs_freep(err);
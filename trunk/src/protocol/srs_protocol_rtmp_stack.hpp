@@ -42,6 +42,7 @@ class SrsCommonMessage;
 class SrsPacket;
 class SrsAmf0Object;
 class IMergeReadHandler;
+class ISrsHandshakeExecutor;
 class SrsCallPacket;
 
 // The amf0 command message, command name macros
@@ -490,6 +491,7 @@ enum SrsRtmpConnType
     SrsRtmpConnHaivisionPublish = 0x0202,
     SrsRtcConnPublish = 0x0210,
     SrsSrtConnPublish = 0x0220,
+    SrsCasterPublish = 0x0230,
 };
 std::string srs_client_type_string(SrsRtmpConnType type);
 bool srs_client_type_is_publish(SrsRtmpConnType type);
@@ -615,6 +617,8 @@ private:
     SrsHandshakeBytes* hs_bytes;
     SrsProtocol* protocol;
     ISrsProtocolReadWriter* io;
+    // The executor for complex handshake, NULL to handshake in current thread.
+    ISrsHandshakeExecutor* hs_executor_;
 public:
     SrsRtmpServer(ISrsProtocolReadWriter* skt);
     virtual ~SrsRtmpServer();
@@ -622,6 +626,8 @@ public:
     // For RTMP proxy, the real IP. 0 if no proxy.
     // @doc https://github.com/ossrs/go-oryx/wiki/RtmpProxy
     virtual uint32_t proxy_real_ip();
+    // Set the executor to create s0s1s2 for complex handshake.
+    virtual void set_handshake_executor(ISrsHandshakeExecutor* v);
 // Protocol methods proxy
 public:
     // Set the auto response message when recv for protocol stack.
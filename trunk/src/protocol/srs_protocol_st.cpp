@@ -11,6 +11,8 @@
 #include <sys/socket.h>
 #include <sys/resource.h>
 #include <netdb.h>
+#include <poll.h>
+#include <string.h>
 using namespace std;
 
 #include <srs_core_autofree.hpp>
@@ -19,10 +21,33 @@ using namespace std;
 #include <srs_protocol_utility.hpp>
 #include <srs_kernel_utility.hpp>
 #include <srs_core_deprecated.hpp>
+#include <srs_kernel_flv.hpp>
 
 // nginx also set to 512
 #define SERVER_LISTEN_BACKLOG 512
 
+// The iov smaller than this is copied, because it's not worth to pin pages for zero-copy.
+#define SRS_ZEROCOPY_COPY_BYTES 1024
+
+#ifdef __linux__
+#include <netinet/in.h>
+#include <linux/errqueue.h>
+#endif
+
+// For old system headers without MSG_ZEROCOPY, see linux 4.14.
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+#ifndef SO_EE_ORIGIN_ZEROCOPY
+#define SO_EE_ORIGIN_ZEROCOPY 5
+#endif
+#ifndef SO_EE_CODE_ZEROCOPY_COPIED
+#define SO_EE_CODE_ZEROCOPY_COPIED 1
+#endif
+
 #ifdef __linux__
 #include <sys/epoll.h>
 
@@ -502,6 +527,380 @@ bool srs_is_never_timeout(srs_utime_t tm)
     return tm == SRS_UTIME_NO_TIMEOUT;
 }
 
+SrsZerocopyPins::SrsZerocopyPins()
+{
+    size = 0;
+    first_seq = 0;
+    nn_sends = 0;
+    nn_done = 0;
+}
+
+SrsZerocopyPins::~SrsZerocopyPins()
+{
+    for (int i = 0; i < (int)msgs.size(); i++) {
+        SrsSharedPtrMessage* msg = msgs.at(i);
+        srs_freep(msg);
+    }
+
+    for (int i = 0; i < (int)buffers.size(); i++) {
+        char* buf = buffers.at(i);
+        srs_freepa(buf);
+    }
+}
+
+SrsZerocopySender::SrsZerocopySender(srs_netfd_t stfd, int min_bytes)
+{
+    stfd_ = stfd;
+    min_bytes_ = min_bytes;
+    enabled_ = false;
+    next_seq_ = 0;
+    pins_ = NULL;
+    pinned_bytes_ = 0;
+    zerocopy_bytes_ = 0;
+}
+
+SrsZerocopySender::~SrsZerocopySender()
+{
+    // Free the messages which kernel already completed.
+    unpin();
+    reap();
+
+    // Kernel still sends the data from the pages of pending messages, which might be reused by others once freed, so
+    // we reset the connection by SO_LINGER to discard the unsent data when the fd is closed by owner.
+#ifdef __linux__
+    if (!pending_.empty()) {
+        struct linger lg;
+        lg.l_onoff = 1;
+        lg.l_linger = 0;
+        setsockopt(srs_netfd_fileno(stfd_), SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+    }
+#endif
+
+    std::list<SrsZerocopyPins*>::iterator it;
+    for (it = pending_.begin(); it != pending_.end(); ++it) {
+        SrsZerocopyPins* pins = *it;
+        srs_freep(pins);
+    }
+}
+
+srs_error_t SrsZerocopySender::initialize()
+{
+    srs_error_t err = srs_success;
+
+#ifdef __linux__
+    int fd = srs_netfd_fileno(stfd_);
+
+    int v = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &v, sizeof(v)) < 0) {
+        return srs_error_new(ERROR_SOCKET_ZEROCOPY, "setsockopt fd=%d", fd);
+    }
+
+    enabled_ = true;
+    return err;
+#else
+    return srs_error_new(ERROR_SOCKET_ZEROCOPY, "not supported");
+#endif
+}
+
+void SrsZerocopySender::pin(SrsSharedPtrMessage** msgs, int nb_msgs)
+{
+    srs_freep(pins_);
+    pins_ = new SrsZerocopyPins();
+
+    for (int i = 0; i < nb_msgs; i++) {
+        SrsSharedPtrMessage* msg = msgs[i];
+        if (!msg || !msg->payload || msg->size <= 0) {
+            continue;
+        }
+
+        pins_->msgs.push_back(msg->copy());
+        pins_->size += msg->size;
+    }
+}
+
+void SrsZerocopySender::unpin()
+{
+    if (!pins_) {
+        return;
+    }
+
+    // Free the messages if never sent by zero-copy or all completed, or wait for kernel notification.
+    if (pins_->nn_done >= pins_->nn_sends) {
+        srs_freep(pins_);
+        return;
+    }
+
+    pinned_bytes_ += pins_->size;
+    pending_.push_back(pins_);
+    pins_ = NULL;
+}
+
+bool SrsZerocopySender::match(const iovec* iov, int iov_size)
+{
+    if (!enabled_ || !pins_ || pins_->msgs.empty()) {
+        return false;
+    }
+
+    int64_t size = 0;
+    for (int i = 0; i < iov_size && size < min_bytes_; i++) {
+        size += iov[i].iov_len;
+    }
+
+    return size >= min_bytes_;
+}
+
+ssize_t SrsZerocopySender::writev(const iovec* iov, int iov_size, srs_utime_t timeout)
+{
+    srs_assert(pins_);
+
+    // Release the completed messages, before pinning more.
+    reap();
+
+    // Copy the small iovs and the iovs out of messages, because the caller might reuse them after writing, for
+    // example, the chunk header of RTMP and the tag header of FLV.
+    iovs_.assign(iov, iov + iov_size);
+
+    int nn_copy = 0;
+    size_t cursor = 0;
+    for (int i = 0; i < iov_size; i++) {
+        if (!is_pinned(iovs_[i], cursor)) {
+            nn_copy += iovs_[i].iov_len;
+        }
+    }
+
+    if (nn_copy > 0) {
+        char* buf = new char[nn_copy];
+        pins_->buffers.push_back(buf);
+        pins_->size += nn_copy;
+
+        char* p = buf;
+        cursor = 0;
+        for (int i = 0; i < iov_size; i++) {
+            iovec& v = iovs_[i];
+            if (!is_pinned(v, cursor)) {
+                memcpy(p, v.iov_base, v.iov_len);
+                v.iov_base = p;
+                p += v.iov_len;
+            }
+        }
+    }
+
+    int fd = srs_netfd_fileno(stfd_);
+    int flags = MSG_ZEROCOPY;
+
+    // Send all iovs like st_writev, and wait for the socket to be writable.
+    ssize_t nn = 0;
+    int index = 0;
+    while (index < iov_size) {
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iovs_[index];
+        msg.msg_iovlen = iov_size - index;
+
+        ssize_t r0 = ::sendmsg(fd, &msg, flags);
+        if (r0 < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            // Exceed the limit of locked memory, fall back to copy for this write.
+            if (errno == ENOBUFS && flags) {
+                flags = 0;
+                continue;
+            }
+
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                return -1;
+            }
+
+            // The notifications also make the fd ready, so reap them before waiting.
+            reap();
+
+            if (st_netfd_poll((st_netfd_t)stfd_, POLLOUT, (st_utime_t)timeout) < 0) {
+                return -1;
+            }
+            continue;
+        }
+
+        // Kernel increases the sequence for each successful zero-copy send.
+        if (flags) {
+            if (!pins_->nn_sends) {
+                pins_->first_seq = next_seq_;
+            }
+            pins_->nn_sends++;
+            next_seq_++;
+            zerocopy_bytes_ += r0;
+        }
+        nn += r0;
+
+        // Skip the sent iovs.
+        while (r0 > 0 && index < iov_size) {
+            iovec& v = iovs_[index];
+            if (r0 < (ssize_t)v.iov_len) {
+                v.iov_base = (char*)v.iov_base + r0;
+                v.iov_len -= r0;
+                break;
+            }
+
+            r0 -= v.iov_len;
+            index++;
+        }
+
+        // Skip the empty iovs.
+        while (index < iov_size && iovs_[index].iov_len == 0) {
+            index++;
+        }
+    }
+
+    return nn;
+}
+
+ssize_t SrsZerocopySender::read(void* buf, size_t size, srs_utime_t timeout)
+{
+    int fd = srs_netfd_fileno(stfd_);
+
+    while (true) {
+        ssize_t nn = ::read(fd, buf, size);
+        if (nn >= 0) {
+            return nn;
+        }
+
+        if (errno == EINTR) {
+            continue;
+        }
+
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            return -1;
+        }
+
+        // Reap the notifications, or the reader is waked up by the POLLERR again and again.
+        reap();
+
+        if (st_netfd_poll((st_netfd_t)stfd_, POLLIN, (st_utime_t)timeout) < 0) {
+            return -1;
+        }
+    }
+}
+
+void SrsZerocopySender::reap()
+{
+#ifdef __linux__
+    if (pending_.empty() && (!pins_ || !pins_->nn_sends)) {
+        return;
+    }
+
+    int fd = srs_netfd_fileno(stfd_);
+
+    while (true) {
+        char control[128];
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        // No more notifications if EAGAIN.
+        if (::recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+            break;
+        }
+
+        for (struct cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+            bool ipv4 = cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR;
+            bool ipv6 = cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR;
+            if (!ipv4 && !ipv6) {
+                continue;
+            }
+
+            struct sock_extended_err* serr = (struct sock_extended_err*)CMSG_DATA(cm);
+            if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+                continue;
+            }
+
+            // Kernel copied the data, for example, over loopback, so zero-copy is useless for this socket.
+            if ((serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) && enabled_) {
+                enabled_ = false;
+                srs_trace("zerocopy disabled for kernel copied, fd=%d, seq=%u-%u", fd, serr->ee_info, serr->ee_data);
+            }
+
+            on_completed(serr->ee_info, serr->ee_data);
+        }
+    }
+#endif
+}
+
+bool SrsZerocopySender::is_pinned(const iovec& iov, size_t& cursor)
+{
+    if (iov.iov_len < SRS_ZEROCOPY_COPY_BYTES) {
+        return false;
+    }
+
+    // The iovs are in the order of messages, so search from the last matched message.
+    char* p = (char*)iov.iov_base;
+    for (size_t i = cursor; i < pins_->msgs.size(); i++) {
+        SrsSharedPtrMessage* msg = pins_->msgs.at(i);
+        if (p >= msg->payload && p + iov.iov_len <= msg->payload + msg->size) {
+            cursor = i;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Count the sends of pins in the completed range [lo, hi].
+static int srs_zerocopy_completed(SrsZerocopyPins* pins, uint32_t lo, uint32_t hi)
+{
+    int nn = 0;
+
+    // The sequence might wrap, so compare by the distance to lo.
+    for (int i = 0; i < pins->nn_sends; i++) {
+        uint32_t seq = pins->first_seq + i;
+        if ((uint32_t)(seq - lo) <= (uint32_t)(hi - lo)) {
+            nn++;
+        }
+    }
+
+    return nn;
+}
+
+void SrsZerocopySender::on_completed(uint32_t lo, uint32_t hi)
+{
+    // The current messages might be completed while pinned, for example, reap before the next write.
+    if (pins_) {
+        pins_->nn_done += srs_zerocopy_completed(pins_, lo, hi);
+    }
+
+    std::list<SrsZerocopyPins*>::iterator it;
+    for (it = pending_.begin(); it != pending_.end();) {
+        SrsZerocopyPins* pins = *it;
+
+        pins->nn_done += srs_zerocopy_completed(pins, lo, hi);
+
+        if (pins->nn_done < pins->nn_sends) {
+            ++it;
+            continue;
+        }
+
+        pinned_bytes_ -= pins->size;
+        it = pending_.erase(it);
+        srs_freep(pins);
+    }
+}
+
+bool SrsZerocopySender::enabled()
+{
+    return enabled_;
+}
+
+int64_t SrsZerocopySender::pinned_bytes()
+{
+    return pinned_bytes_;
+}
+
+int64_t SrsZerocopySender::zerocopy_bytes()
+{
+    return zerocopy_bytes_;
+}
+
 SrsStSocket::SrsStSocket()
 {
     init(NULL);
@@ -514,6 +913,7 @@ SrsStSocket::SrsStSocket(srs_netfd_t fd)
 
 SrsStSocket::~SrsStSocket()
 {
+    srs_freep(zerocopy_);
 }
 
 void SrsStSocket::init(srs_netfd_t fd)
@@ -521,6 +921,32 @@ void SrsStSocket::init(srs_netfd_t fd)
     stfd_ = fd;
     stm = rtm = SRS_UTIME_NO_TIMEOUT;
     rbytes = sbytes = 0;
+    zerocopy_ = NULL;
+}
+
+srs_error_t SrsStSocket::enable_zerocopy(int min_bytes)
+{
+    srs_error_t err = srs_success;
+
+    srs_assert(stfd_);
+
+    if (zerocopy_) {
+        return err;
+    }
+
+    SrsZerocopySender* zc = new SrsZerocopySender(stfd_, min_bytes);
+    if ((err = zc->initialize()) != srs_success) {
+        srs_freep(zc);
+        return srs_error_wrap(err, "init zerocopy");
+    }
+
+    zerocopy_ = zc;
+    return err;
+}
+
+SrsZerocopySender* SrsStSocket::zerocopy()
+{
+    return zerocopy_;
 }
 
 void SrsStSocket::set_recv_timeout(srs_utime_t tm)
@@ -560,7 +986,9 @@ srs_error_t SrsStSocket::read(void* buf, size_t size, ssize_t* nread)
     srs_assert(stfd_);
 
     ssize_t nb_read;
-    if (rtm == SRS_UTIME_NO_TIMEOUT) {
+    if (zerocopy_) {
+        nb_read = zerocopy_->read(buf, size, rtm);
+    } else if (rtm == SRS_UTIME_NO_TIMEOUT) {
         nb_read = st_read((st_netfd_t)stfd_, buf, size, ST_UTIME_NO_TIMEOUT);
     } else {
         nb_read = st_read((st_netfd_t)stfd_, buf, size, rtm);
@@ -666,7 +1094,9 @@ srs_error_t SrsStSocket::writev(const iovec *iov, int iov_size, ssize_t* nwrite)
     srs_assert(stfd_);
     
     ssize_t nb_write;
-    if (stm == SRS_UTIME_NO_TIMEOUT) {
+    if (zerocopy_ && zerocopy_->match(iov, iov_size)) {
+        nb_write = zerocopy_->writev(iov, iov_size, stm);
+    } else if (stm == SRS_UTIME_NO_TIMEOUT) {
         nb_write = st_writev((st_netfd_t)stfd_, iov, iov_size, ST_UTIME_NO_TIMEOUT);
     } else {
         nb_write = st_writev((st_netfd_t)stfd_, iov, iov_size, stm);
@@ -775,4 +1205,3 @@ srs_error_t SrsTcpClient::writev(const iovec *iov, int iov_size, ssize_t* nwrite
 {
     return io->writev(iov, iov_size, nwrite);
 }
-
@@ -10,10 +10,14 @@
 #include <srs_core.hpp>
 
 #include <string>
+#include <vector>
+#include <list>
 
 #include <srs_protocol_io.hpp>
 #include <srs_kernel_error.hpp>
 
+class SrsSharedPtrMessage;
+
 // Wrap for coroutine.
 typedef void* srs_netfd_t;
 typedef void* srs_thread_t;
@@ -124,6 +128,79 @@ public:
     }
 };
 
+// The messages pinned for zero-copy sends, which are freed when kernel notifies that all sends are completed.
+class SrsZerocopyPins
+{
+public:
+    // The copies of messages, which hold the payload.
+    std::vector<SrsSharedPtrMessage*> msgs;
+    // The buffers of small iovs, which are copied because they are reused by caller, such as the chunk header.
+    std::vector<char*> buffers;
+    // The bytes of payload and buffers.
+    int64_t size;
+public:
+    // The sequence of the first zero-copy send.
+    uint32_t first_seq;
+    // The number of zero-copy sends, and the number of completed sends.
+    int nn_sends;
+    int nn_done;
+public:
+    SrsZerocopyPins();
+    virtual ~SrsZerocopyPins();
+};
+
+// The MSG_ZEROCOPY sender for TCP socket, to send the large payload of messages without copying to kernel. The
+// messages are pinned until kernel notifies the completion by the error queue, and small writes fall back to copy.
+// @see https://www.kernel.org/doc/html/latest/networking/msg_zerocopy.html
+// @remark Only for linux 4.14+, and kernel might still copy the data, for example, over loopback.
+class SrsZerocopySender
+{
+private:
+    srs_netfd_t stfd_;
+    // The min bytes of writev to use zero-copy.
+    int min_bytes_;
+    // Whether zero-copy is enabled, disabled when kernel falls back to copy.
+    bool enabled_;
+    // The sequence of next zero-copy send, kernel increases it for each send.
+    uint32_t next_seq_;
+    // The messages pinned for current writing, NULL if not pinned.
+    SrsZerocopyPins* pins_;
+    // The pinned messages waiting for kernel notification.
+    std::list<SrsZerocopyPins*> pending_;
+    // The iovs to send, with small iovs copied.
+    std::vector<iovec> iovs_;
+private:
+    // The bytes pinned by kernel now.
+    int64_t pinned_bytes_;
+    // The total bytes sent by zero-copy.
+    int64_t zerocopy_bytes_;
+public:
+    SrsZerocopySender(srs_netfd_t stfd, int min_bytes);
+    virtual ~SrsZerocopySender();
+public:
+    // Set the SO_ZEROCOPY of socket.
+    virtual srs_error_t initialize();
+    // Pin the messages, whose payload might be sent by zero-copy until unpin. Note that the messages are copied, so
+    // it's ok to free them after writing.
+    virtual void pin(SrsSharedPtrMessage** msgs, int nb_msgs);
+    virtual void unpin();
+    // Whether use zero-copy to write the iovs, only for large writes of pinned messages.
+    virtual bool match(const iovec* iov, int iov_size);
+    // Write the iovs by zero-copy, return the bytes like st_writev, or -1 and set the errno.
+    virtual ssize_t writev(const iovec* iov, int iov_size, srs_utime_t timeout);
+    // Read like st_read, but reap the notifications before waiting, because the error queue wakes up the reader.
+    virtual ssize_t read(void* buf, size_t size, srs_utime_t timeout);
+    // Reap the notifications from error queue, free the completed messages.
+    virtual void reap();
+private:
+    bool is_pinned(const iovec& iov, size_t& cursor);
+    void on_completed(uint32_t lo, uint32_t hi);
+public:
+    virtual bool enabled();
+    virtual int64_t pinned_bytes();
+    virtual int64_t zerocopy_bytes();
+};
+
 // the socket provides TCP socket over st,
 // that is, the sync socket mechanism.
 class SrsStSocket : public ISrsProtocolReadWriter
@@ -138,6 +215,8 @@ private:
     int64_t sbytes;
     // The underlayer st fd.
     srs_netfd_t stfd_;
+    // The zero-copy sender, NULL if disabled.
+    SrsZerocopySender* zerocopy_;
 public:
     SrsStSocket();
     SrsStSocket(srs_netfd_t fd);
@@ -151,6 +230,11 @@ public:
     virtual srs_utime_t get_send_timeout();
     virtual int64_t get_recv_bytes();
     virtual int64_t get_send_bytes();
+public:
+    // Enable MSG_ZEROCOPY for writev of pinned messages, larger than min_bytes.
+    virtual srs_error_t enable_zerocopy(int min_bytes);
+    // Get the zero-copy sender, NULL if disabled.
+    virtual SrsZerocopySender* zerocopy();
 public:
     // @param nread, the actual read bytes, ignore if NULL.
     virtual srs_error_t read(void* buf, size_t size, ssize_t* nread);
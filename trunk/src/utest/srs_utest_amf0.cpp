@@ -2850,3 +2850,56 @@ VOID TEST(ProtocolJSONTest, ParseSpecial)
     }
 }
 
+
+VOID TEST(ProtocolJSONTest, Writer)
+{
+    if (true) {
+        std::string buf;
+        SrsJsonWriter w(&buf);
+        w.object_start();
+        w.object_end();
+        EXPECT_STREQ("{}", buf.c_str());
+    }
+
+    if (true) {
+        std::string buf;
+        SrsJsonWriter w(&buf);
+        w.object_start();
+        w.integer("code", 0);
+        w.str("name", "he\"llo");
+        w.number("alive", 1.5);
+        w.boolean("publish", true);
+        w.null("video");
+        w.object_start("kbps");
+        w.integer("recv_30s", -1);
+        w.object_end();
+        w.array_start("clients");
+        w.object_start();
+        w.str("id", "a");
+        w.object_end();
+        w.object_start();
+        w.object_end();
+        w.array_end();
+        w.object_end();
+        EXPECT_STREQ("{\"code\":0,\"name\":\"he\\\"llo\",\"alive\":1.50,\"publish\":true,\"video\":null,"
+            "\"kbps\":{\"recv_30s\":-1},\"clients\":[{\"id\":\"a\"},{}]}", buf.c_str());
+
+        // Should be same to the JSON parsed and dumps.
+        SrsJsonAny* p = SrsJsonAny::loads(buf);
+        EXPECT_TRUE(p && p->is_object());
+        EXPECT_STREQ(buf.c_str(), p->dumps().c_str());
+        srs_freep(p);
+    }
+
+    if (true) {
+        std::string buf;
+        SrsJsonWriter w(&buf);
+        w.array_start();
+        w.integer(1);
+        w.str("s");
+        w.array_start();
+        w.array_end();
+        w.array_end();
+        EXPECT_STREQ("[1,\"s\",[]]", buf.c_str());
+    }
+}
@@ -15,6 +15,23 @@ using namespace std;
 #include <srs_app_st.hpp>
 #include <srs_protocol_conn.hpp>
 #include <srs_app_conn.hpp>
+#include <srs_app_source.hpp>
+#include <srs_kernel_flv.hpp>
+#include <srs_app_statistic.hpp>
+#include <srs_protocol_json.hpp>
+#include <srs_app_stream_bridge.hpp>
+#include <srs_app_http_hooks.hpp>
+#include <srs_app_http_client.hpp>
+#include <srs_app_threads.hpp>
+#include <srs_app_hls.hpp>
+#include <srs_app_recv_thread.hpp>
+#include <srs_app_edge.hpp>
+#include <srs_app_dvr.hpp>
+#include <srs_app_rtmp_conn.hpp>
+#include <srs_protocol_rtmp_stack.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_kernel_file.hpp>
+#include <srs_utest_config.hpp>
 
 class MockIDResource : public ISrsResource
 {
@@ -783,3 +800,882 @@ VOID TEST(AppSecurity, CheckSecurity)
     //       4. deny if matches deny strategy.
 }
 
+
+SrsSharedPtrMessage* mock_ring_message(char type, uint32_t ts, char b0, char b1)
+{
+    SrsMessageHeader h;
+    if (type == RTMP_MSG_VideoMessage) {
+        h.initialize_video(2, ts, 1);
+    } else if (type == RTMP_MSG_AudioMessage) {
+        h.initialize_audio(2, ts, 1);
+    } else {
+        h.initialize_amf0_script(2, 1);
+        h.timestamp = ts;
+    }
+
+    char* payload = new char[2];
+    payload[0] = b0;
+    payload[1] = b1;
+
+    SrsSharedPtrMessage* msg = new SrsSharedPtrMessage();
+    srs_error_t err = msg->create(&h, payload, 2);
+    srs_assert(err == srs_success);
+    return msg;
+}
+
+VOID TEST(AppMessageRingTest, PushAndDump)
+{
+    srs_error_t err;
+
+    // Never keep the message if no cursor.
+    if (true) {
+        SrsMessageRing ring;
+        SrsUniquePtr<SrsSharedPtrMessage> msg(mock_ring_message(RTMP_MSG_VideoMessage, 10, 0x27, 0x01));
+        ring.push(msg.get());
+        EXPECT_EQ(0, ring.size());
+        EXPECT_EQ(1, (int)ring.tail());
+    }
+
+    // The message is shared by all cursors, and freed when all consumed.
+    if (true) {
+        SrsMessageRing ring;
+        SrsMessageRingCursor c0(&ring), c1(&ring);
+
+        SrsUniquePtr<SrsSharedPtrMessage> msg(mock_ring_message(RTMP_MSG_VideoMessage, 10, 0x27, 0x01));
+        ring.push(msg.get());
+        ring.push(msg.get());
+        EXPECT_EQ(2, ring.size());
+        EXPECT_EQ(2, c0.size());
+        EXPECT_EQ(2, msg->count());
+
+        SrsSharedPtrMessage* msgs[8];
+        int count = 0;
+        HELPER_EXPECT_SUCCESS(c0.dump_packets(8, msgs, count));
+        EXPECT_EQ(2, count);
+        EXPECT_EQ(0, c0.size());
+        EXPECT_EQ(2, c1.size());
+        EXPECT_EQ(2, ring.size());
+        for (int i = 0; i < count; i++) {
+            srs_freep(msgs[i]);
+        }
+
+        HELPER_EXPECT_SUCCESS(c1.dump_packets(1, msgs, count));
+        EXPECT_EQ(1, count);
+        srs_freep(msgs[0]);
+
+        HELPER_EXPECT_SUCCESS(c1.dump_packets(8, msgs, count));
+        EXPECT_EQ(1, count);
+        srs_freep(msgs[0]);
+
+        // The consumed messages are freed when pushing the next message.
+        EXPECT_EQ(2, ring.size());
+        ring.push(msg.get());
+        EXPECT_EQ(1, ring.size());
+        EXPECT_EQ(3, (int)ring.tail());
+        EXPECT_EQ(1, msg->count());
+    }
+
+    // Free the messages when cursor is destroyed.
+    if (true) {
+        SrsMessageRing ring;
+        SrsUniquePtr<SrsSharedPtrMessage> msg(mock_ring_message(RTMP_MSG_AudioMessage, 10, 0xaf, 0x01));
+
+        SrsMessageRingCursor* c0 = new SrsMessageRingCursor(&ring);
+        ring.push(msg.get());
+        EXPECT_EQ(1, ring.size());
+
+        srs_freep(c0);
+        EXPECT_EQ(0, ring.size());
+        EXPECT_EQ(0, msg->count());
+    }
+}
+
+VOID TEST(AppMessageRingTest, SequenceHeader)
+{
+    srs_error_t err;
+
+    SrsMessageRing ring;
+    SrsUniquePtr<SrsSharedPtrMessage> meta(mock_ring_message(RTMP_MSG_AMF0DataMessage, 0, 0x02, 0x00));
+    SrsUniquePtr<SrsSharedPtrMessage> vsh(mock_ring_message(RTMP_MSG_VideoMessage, 0, 0x17, 0x00));
+    SrsUniquePtr<SrsSharedPtrMessage> ash(mock_ring_message(RTMP_MSG_AudioMessage, 0, 0xaf, 0x00));
+    ring.push(meta.get());
+    ring.push(vsh.get());
+    ring.push(ash.get());
+    EXPECT_TRUE(ring.meta() && ring.vsh() && ring.ash());
+
+    // The cursor created after sequence header, should request it.
+    SrsMessageRingCursor cursor(&ring);
+    SrsUniquePtr<SrsSharedPtrMessage> video(mock_ring_message(RTMP_MSG_VideoMessage, 40, 0x17, 0x01));
+    ring.push(video.get());
+
+    cursor.request_sh();
+
+    SrsSharedPtrMessage* msgs[8];
+    int count = 0;
+    HELPER_EXPECT_SUCCESS(cursor.dump_packets(8, msgs, count));
+    EXPECT_EQ(4, count);
+    EXPECT_TRUE(!msgs[0]->is_av());
+    EXPECT_TRUE(msgs[1]->is_video());
+    EXPECT_TRUE(msgs[2]->is_audio());
+    EXPECT_EQ(40, msgs[1]->timestamp);
+    EXPECT_EQ(40, msgs[3]->timestamp);
+    for (int i = 0; i < count; i++) {
+        srs_freep(msgs[i]);
+    }
+
+    // Free all sequence headers when clear.
+    ring.clear();
+    EXPECT_TRUE(!ring.meta() && !ring.vsh() && !ring.ash());
+    EXPECT_EQ(0, vsh->count());
+}
+
+VOID TEST(AppMessageRingTest, DropByGop)
+{
+    srs_error_t err;
+
+    // The slow cursor is dropped to the keyframe, and the fast cursor is not affected.
+    if (true) {
+        SrsMessageRing ring;
+        ring.set_queue_size(1 * SRS_UTIME_SECONDS);
+
+        SrsUniquePtr<SrsSharedPtrMessage> vsh(mock_ring_message(RTMP_MSG_VideoMessage, 0, 0x17, 0x00));
+        ring.push(vsh.get());
+
+        SrsMessageRingCursor fast(&ring), slow(&ring);
+        SrsSharedPtrMessage* msgs[128];
+        int count = 0;
+
+        // Keyframe every 1000ms, 100ms per frame, total 1500ms.
+        for (int i = 0; i <= 15; i++) {
+            char b0 = (i % 10) ? 0x27 : 0x17;
+            SrsUniquePtr<SrsSharedPtrMessage> msg(mock_ring_message(RTMP_MSG_VideoMessage, i * 100, b0, 0x01));
+            ring.push(msg.get());
+
+            HELPER_EXPECT_SUCCESS(fast.dump_packets(128, msgs, count));
+            EXPECT_EQ(1, count);
+            srs_freep(msgs[0]);
+        }
+        EXPECT_EQ(16, slow.size());
+
+        // Slow cursor lags 1500ms, drop to the keyframe at 1000ms, and resend the sequence header.
+        HELPER_EXPECT_SUCCESS(slow.dump_packets(128, msgs, count));
+        EXPECT_EQ(7, count);
+        EXPECT_EQ(10, (int)slow.nn_dropped());
+        EXPECT_EQ(0, (int)fast.nn_dropped());
+        EXPECT_TRUE(msgs[0]->is_video());
+        EXPECT_EQ(1000, msgs[0]->timestamp);
+        EXPECT_EQ(1000, msgs[1]->timestamp);
+        EXPECT_EQ(1500, msgs[6]->timestamp);
+        for (int i = 0; i < count; i++) {
+            srs_freep(msgs[i]);
+        }
+
+        // All messages are consumed, and freed when pushing the next message.
+        SrsUniquePtr<SrsSharedPtrMessage> msg(mock_ring_message(RTMP_MSG_VideoMessage, 1600, 0x27, 0x01));
+        ring.push(msg.get());
+        EXPECT_EQ(1, ring.size());
+    }
+
+    // The ring is bounded even if cursor never consumes it.
+    if (true) {
+        SrsMessageRing ring;
+        ring.set_queue_size(1 * SRS_UTIME_SECONDS);
+        SrsMessageRingCursor cursor(&ring);
+
+        for (int i = 0; i <= 100; i++) {
+            char b0 = (i % 10) ? 0x27 : 0x17;
+            SrsUniquePtr<SrsSharedPtrMessage> msg(mock_ring_message(RTMP_MSG_VideoMessage, i * 100, b0, 0x01));
+            ring.push(msg.get());
+        }
+        EXPECT_LE(ring.size(), 21);
+        EXPECT_GT((int)cursor.nn_dropped(), 0);
+    }
+
+    // The ring is bounded even if timestamp resets, for the lag is measured by the ring time.
+    if (true) {
+        SrsMessageRing ring;
+        ring.set_queue_size(1 * SRS_UTIME_SECONDS);
+        SrsMessageRingCursor cursor(&ring);
+
+        for (int i = 0; i <= 15; i++) {
+            char b0 = (i % 10) ? 0x27 : 0x17;
+            SrsUniquePtr<SrsSharedPtrMessage> msg(mock_ring_message(RTMP_MSG_VideoMessage, 100000 + i * 100, b0, 0x01));
+            ring.push(msg.get());
+        }
+
+        for (int i = 0; i <= 100; i++) {
+            char b0 = (i % 10) ? 0x27 : 0x17;
+            SrsUniquePtr<SrsSharedPtrMessage> msg(mock_ring_message(RTMP_MSG_VideoMessage, i * 100, b0, 0x01));
+            ring.push(msg.get());
+            EXPECT_GE(cursor.duration(), 0);
+        }
+        EXPECT_LE(ring.size(), 21);
+        EXPECT_GT((int)cursor.nn_dropped(), 0);
+    }
+
+    // For pure audio stream, drop to the first audio in duration.
+    if (true) {
+        SrsMessageRing ring;
+        ring.set_queue_size(1 * SRS_UTIME_SECONDS);
+        SrsMessageRingCursor cursor(&ring);
+
+        for (int i = 0; i <= 15; i++) {
+            SrsUniquePtr<SrsSharedPtrMessage> msg(mock_ring_message(RTMP_MSG_AudioMessage, i * 100, 0xaf, 0x01));
+            ring.push(msg.get());
+        }
+
+        SrsSharedPtrMessage* msgs[128];
+        int count = 0;
+        HELPER_EXPECT_SUCCESS(cursor.dump_packets(128, msgs, count));
+        EXPECT_EQ(11, count);
+        EXPECT_EQ(500, msgs[0]->timestamp);
+        for (int i = 0; i < count; i++) {
+            srs_freep(msgs[i]);
+        }
+    }
+}
+
+class MockRingWakable : public ISrsWakable
+{
+public:
+    int nn_wakeup;
+public:
+    MockRingWakable() {
+        nn_wakeup = 0;
+    }
+    virtual ~MockRingWakable() {
+    }
+    virtual void wakeup() {
+        nn_wakeup++;
+    }
+};
+
+VOID TEST(AppMessageRingTest, WaitForDuration)
+{
+    // Wakeup when got enough messages in duration.
+    if (true) {
+        SrsMessageRing ring;
+        SrsMessageRingCursor c0(&ring), c1(&ring);
+        MockRingWakable w0, w1;
+
+        SrsUniquePtr<SrsSharedPtrMessage> msg(mock_ring_message(RTMP_MSG_AudioMessage, 100, 0xaf, 0x01));
+        ring.push(msg.get());
+
+        c0.wait(&w0, 300 * SRS_UTIME_MILLISECONDS);
+        c1.wait(&w1, 500 * SRS_UTIME_MILLISECONDS);
+        EXPECT_EQ(2, (int)ring.waiters_.size());
+
+        for (int i = 2; i <= 6; i++) {
+            SrsUniquePtr<SrsSharedPtrMessage> msg(mock_ring_message(RTMP_MSG_AudioMessage, i * 100, 0xaf, 0x01));
+            ring.push(msg.get());
+
+            EXPECT_EQ(i >= 4 ? 1 : 0, w0.nn_wakeup);
+            EXPECT_EQ(i >= 6 ? 1 : 0, w1.nn_wakeup);
+        }
+        EXPECT_EQ(500 * SRS_UTIME_MILLISECONDS, c0.duration());
+        EXPECT_TRUE(ring.waiters_.empty());
+    }
+
+    // Wakeup all when stream time jumps backward, for example, republish.
+    if (true) {
+        SrsMessageRing ring;
+        SrsMessageRingCursor c0(&ring);
+        MockRingWakable w0;
+
+        SrsUniquePtr<SrsSharedPtrMessage> msg(mock_ring_message(RTMP_MSG_AudioMessage, 1000, 0xaf, 0x01));
+        ring.push(msg.get());
+        c0.wait(&w0, 300 * SRS_UTIME_MILLISECONDS);
+
+        SrsUniquePtr<SrsSharedPtrMessage> msg2(mock_ring_message(RTMP_MSG_AudioMessage, 0, 0xaf, 0x01));
+        ring.push(msg2.get());
+        EXPECT_EQ(1, w0.nn_wakeup);
+    }
+
+    // Never wakeup if cancel or destroyed.
+    if (true) {
+        SrsMessageRing ring;
+        SrsMessageRingCursor c0(&ring);
+        SrsMessageRingCursor* c1 = new SrsMessageRingCursor(&ring);
+        MockRingWakable w0, w1;
+
+        c0.wait(&w0, 100 * SRS_UTIME_MILLISECONDS);
+        c1->wait(&w1, 100 * SRS_UTIME_MILLISECONDS);
+        c0.cancel_wait();
+        srs_freep(c1);
+        EXPECT_TRUE(ring.waiters_.empty());
+
+        SrsUniquePtr<SrsSharedPtrMessage> msg(mock_ring_message(RTMP_MSG_AudioMessage, 1000, 0xaf, 0x01));
+        ring.push(msg.get());
+        EXPECT_EQ(0, w0.nn_wakeup);
+        EXPECT_EQ(0, w1.nn_wakeup);
+    }
+}
+
+VOID TEST(AppStatisticTest, ClientSlots)
+{
+    srs_error_t err;
+
+    SrsStatistic stat;
+    SrsRequest req;
+    req.vhost = "__defaultVhost__";
+    req.app = "live";
+    req.stream = "livestream";
+
+    HELPER_EXPECT_SUCCESS(stat.on_client("c0", &req, NULL, SrsRtmpConnPlay));
+    HELPER_EXPECT_SUCCESS(stat.on_client("c1", &req, NULL, SrsRtmpConnPlay));
+    HELPER_EXPECT_SUCCESS(stat.on_client("c2", &req, NULL, SrsRtmpConnPlay));
+    EXPECT_EQ(3, (int)stat.client_slots.size());
+    EXPECT_EQ(1, stat.find_client("c1")->slot);
+
+    // The slot of disconnected client is a hole, the order of clients is not changed.
+    stat.on_disconnect("c0", srs_success);
+    EXPECT_EQ(3, (int)stat.client_slots.size());
+    EXPECT_TRUE(stat.client_slots.at(0) == NULL);
+    EXPECT_TRUE(stat.find_client("c0") == NULL);
+    EXPECT_EQ(1, stat.find_client("c1")->slot);
+    EXPECT_EQ(2, stat.find_client("c2")->slot);
+    EXPECT_EQ(2, stat.find_stream_by_url(req.get_stream_url())->nb_clients);
+
+    // Dumps the clients by page.
+    if (true) {
+        std::string buf;
+        SrsJsonWriter w(&buf);
+        w.array_start();
+        HELPER_EXPECT_SUCCESS(stat.dumps_clients(&w, 1, 10));
+        w.array_end();
+
+        SrsJsonAny* p = SrsJsonAny::loads(buf);
+        EXPECT_TRUE(p && p->is_array());
+        EXPECT_EQ(1, p->to_array()->count());
+        EXPECT_STREQ("c2", p->to_array()->at(0)->to_object()->get_property("id")->to_str().c_str());
+        srs_freep(p);
+    }
+
+    // Never overflow for large count.
+    if (true) {
+        std::string buf;
+        SrsJsonWriter w(&buf);
+        w.array_start();
+        HELPER_EXPECT_SUCCESS(stat.dumps_clients(&w, 1, 0x7fffffff));
+        w.array_end();
+
+        SrsJsonAny* p = SrsJsonAny::loads(buf);
+        EXPECT_TRUE(p && p->is_array());
+        EXPECT_EQ(1, p->to_array()->count());
+        srs_freep(p);
+    }
+
+    stat.on_disconnect("c1", srs_success);
+    stat.on_disconnect("c2", srs_success);
+    EXPECT_TRUE(stat.clients.empty());
+    EXPECT_TRUE(stat.find_stream_by_url(req.get_stream_url()) == NULL);
+}
+
+VOID TEST(AppStatisticTest, ClientSlotsInOrder)
+{
+    srs_error_t err;
+
+    SrsStatistic stat;
+    SrsRequest req;
+    req.vhost = "__defaultVhost__";
+    req.app = "live";
+    req.stream = "livestream";
+
+    for (int i = 0; i < 100; i++) {
+        HELPER_EXPECT_SUCCESS(stat.on_client(srs_fmt("c%d", i), &req, NULL, SrsRtmpConnPlay));
+    }
+
+    // Disconnect the even clients, the slots are compacted in order.
+    for (int i = 0; i < 100; i += 2) {
+        stat.on_disconnect(srs_fmt("c%d", i), srs_success);
+    }
+    EXPECT_EQ(50, (int)stat.clients.size());
+    EXPECT_LT((int)stat.client_slots.size(), 100);
+
+    // The page is in order of connecting.
+    std::string buf;
+    SrsJsonWriter w(&buf);
+    w.array_start();
+    HELPER_EXPECT_SUCCESS(stat.dumps_clients(&w, 10, 5));
+    w.array_end();
+
+    SrsJsonAny* p = SrsJsonAny::loads(buf);
+    EXPECT_TRUE(p && p->is_array());
+    EXPECT_EQ(5, p->to_array()->count());
+    for (int i = 0; i < 5; i++) {
+        std::string id = p->to_array()->at(i)->to_object()->get_property("id")->to_str();
+        EXPECT_STREQ(srs_fmt("c%d", 21 + i * 2).c_str(), id.c_str());
+    }
+    srs_freep(p);
+}
+
+VOID TEST(AppCasterPublisherTest, IsLocal)
+{
+    srs_error_t err;
+
+    MockSrsConfig conf;
+    HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost __defaultVhost__{} vhost edge.ossrs.net{cluster{mode remote;}}"));
+
+    SrsConfig* saved = _srs_config;
+    _srs_config = &conf;
+
+    if (true) {
+        SrsCasterPublisher p("rtmp://127.0.0.1/live/livestream", 0, 0);
+        EXPECT_TRUE(p.is_local());
+    }
+
+    if (true) {
+        SrsCasterPublisher p("rtmp://localhost:1935/live/livestream", 0, 0);
+        EXPECT_TRUE(p.is_local());
+    }
+
+    // Not the port we listen at.
+    if (true) {
+        SrsCasterPublisher p("rtmp://127.0.0.1:19350/live/livestream", 0, 0);
+        EXPECT_FALSE(p.is_local());
+    }
+
+    // Not the address of this server.
+    if (true) {
+        SrsCasterPublisher p("rtmp://1.2.3.4/live/livestream", 0, 0);
+        EXPECT_FALSE(p.is_local());
+    }
+
+    // Edge should publish to origin by RTMP.
+    if (true) {
+        SrsCasterPublisher p("rtmp://127.0.0.1/live/livestream?vhost=edge.ossrs.net", 0, 0);
+        EXPECT_FALSE(p.is_local());
+    }
+
+    _srs_config = saved;
+}
+
+VOID TEST(AppHttpHooksTest, CacheDecision)
+{
+    SrsHttpHooksCache cache;
+
+    int code = ERROR_SUCCESS;
+    EXPECT_FALSE(cache.get("on_play http://server/play ossrs.net/live/livestream", &code));
+
+    cache.set("on_play http://server/play ossrs.net/live/livestream", ERROR_SUCCESS, 10 * SRS_UTIME_SECONDS);
+    cache.set("on_play http://server/play ossrs.net/live/livestream?token=xxx", ERROR_RESPONSE_CODE, 10 * SRS_UTIME_SECONDS);
+    EXPECT_EQ(2, cache.size());
+
+    code = -1;
+    EXPECT_TRUE(cache.get("on_play http://server/play ossrs.net/live/livestream", &code));
+    EXPECT_EQ(ERROR_SUCCESS, code);
+
+    EXPECT_TRUE(cache.get("on_play http://server/play ossrs.net/live/livestream?token=xxx", &code));
+    EXPECT_EQ(ERROR_RESPONSE_CODE, code);
+
+    // The expired decision is removed.
+    cache.set("on_play http://server/play ossrs.net/live/livestream", ERROR_SUCCESS, 0);
+    EXPECT_FALSE(cache.get("on_play http://server/play ossrs.net/live/livestream", &code));
+    EXPECT_EQ(1, cache.size());
+}
+
+VOID TEST(AppHttpHooksTest, PoolRelease)
+{
+    srs_error_t err;
+
+    SrsHttpUri uri;
+    HELPER_EXPECT_SUCCESS(uri.initialize("http://127.0.0.1:8085/api/v1/streams"));
+
+    SrsHttpHooksPool pool;
+
+    SrsHttpClient* hc = NULL;
+    bool reused = true;
+    HELPER_EXPECT_SUCCESS(pool.acquire(&uri, &hc, &reused));
+    EXPECT_TRUE(hc != NULL);
+    EXPECT_FALSE(reused);
+    EXPECT_EQ(1, pool.fetch_or_create(&uri)->inflight);
+
+    // The reusable client is put back to idle list.
+    pool.release(&uri, hc, true);
+    EXPECT_EQ(0, pool.fetch_or_create(&uri)->inflight);
+    EXPECT_EQ(1, (int)pool.fetch_or_create(&uri)->idle.size());
+
+    SrsHttpClient* hc2 = NULL;
+    HELPER_EXPECT_SUCCESS(pool.acquire(&uri, &hc2, &reused));
+    EXPECT_TRUE(hc == hc2);
+    EXPECT_TRUE(reused);
+
+    // The client is freed if not reusable.
+    pool.release(&uri, hc2, false);
+    EXPECT_EQ(0, (int)pool.fetch_or_create(&uri)->idle.size());
+}
+
+VOID TEST(AppHttpHooksTest, AsyncOrderAndBound)
+{
+    srs_error_t err;
+
+    // The worker is not started, so the tasks are kept in queue.
+    SrsHttpHooksAsyncWorker worker(2, 10 * SRS_UTIME_MILLISECONDS);
+    SrsContextId cid;
+
+    HELPER_EXPECT_SUCCESS(worker.post(new SrsHttpHooksAsyncCall(&worker, "/live/livestream", cid, "on_unpublish", "", "")));
+    HELPER_EXPECT_SUCCESS(worker.post(new SrsHttpHooksAsyncCall(&worker, "", cid, "on_close", "", "")));
+    EXPECT_EQ(1, worker.pending("/live/livestream"));
+    EXPECT_EQ(0, worker.pending(""));
+    EXPECT_EQ(2, worker.count());
+
+    // Drop the notification if queue is full.
+    HELPER_EXPECT_FAILED(worker.post(new SrsHttpHooksAsyncCall(&worker, "", cid, "on_stop", "", "")));
+    EXPECT_EQ(1, worker.pending("/live/livestream"));
+    EXPECT_EQ(2, worker.count());
+
+    // Timeout if the notification of stream is pending.
+    srs_utime_t starttime = srs_update_system_time();
+    worker.wait_stream("/live/livestream", 10 * SRS_UTIME_MILLISECONDS);
+    EXPECT_GE(srs_update_system_time() - starttime, 10 * SRS_UTIME_MILLISECONDS);
+
+    // Never wait for other streams.
+    starttime = srs_update_system_time();
+    worker.wait_stream("/live/other", 100 * SRS_UTIME_MILLISECONDS);
+    EXPECT_LT(srs_update_system_time() - starttime, 100 * SRS_UTIME_MILLISECONDS);
+
+    // The stream is not pending after notification is done.
+    worker.on_done("/live/livestream");
+    EXPECT_EQ(0, worker.pending("/live/livestream"));
+}
+
+VOID TEST(AppThreadQueueTest, PushPop)
+{
+    SrsThreadQueue<int> queue(3);
+    EXPECT_EQ(0, queue.size());
+
+    // The capacity is rounded up to 4.
+    for (int i = 0; i < 4; i++) {
+        EXPECT_TRUE(queue.push(i));
+    }
+    EXPECT_FALSE(queue.push(4));
+    EXPECT_EQ(4, queue.size());
+
+    int v = -1;
+    EXPECT_TRUE(queue.pop(v));
+    EXPECT_EQ(0, v);
+    EXPECT_TRUE(queue.push(4));
+
+    for (int i = 1; i <= 4; i++) {
+        EXPECT_TRUE(queue.pop(v));
+        EXPECT_EQ(i, v);
+    }
+    EXPECT_FALSE(queue.pop(v));
+    EXPECT_EQ(0, queue.size());
+}
+
+static srs_error_t mock_thread_cond_worker(void* arg)
+{
+    SrsThreadCond* cond = (SrsThreadCond*)arg;
+    if (!cond->wait(10 * SRS_UTIME_SECONDS)) {
+        return srs_error_new(ERROR_THREAD_JOIN, "timeout");
+    }
+    return srs_success;
+}
+
+VOID TEST(AppThreadCondTest, SignalAndJoin)
+{
+    srs_error_t err;
+
+    // The signal is never lost, even if signaled before wait.
+    if (true) {
+        SrsThreadCond cond;
+        cond.signal();
+        EXPECT_TRUE(cond.wait(1 * SRS_UTIME_SECONDS));
+        EXPECT_FALSE(cond.wait(1 * SRS_UTIME_MILLISECONDS));
+    }
+
+    // Wakeup the worker thread, then join it, and the pool never quits for it.
+    if (true) {
+        SrsThreadCond cond;
+        SrsThreadEntry* entry = NULL;
+        HELPER_EXPECT_SUCCESS(_srs_thread_pool->execute("utest", mock_thread_cond_worker, &cond, &entry));
+        EXPECT_TRUE(entry && entry->joinable);
+
+        cond.signal();
+        HELPER_EXPECT_SUCCESS(_srs_thread_pool->join(entry));
+        EXPECT_TRUE(entry->err == srs_success);
+    }
+}
+
+VOID TEST(AppRtmpHandshakeWorkerTest, DoneTasksWhenStop)
+{
+    srs_error_t err;
+
+    SrsHandshakeBytes hs_bytes;
+    HELPER_ASSERT_SUCCESS(hs_bytes.create_c0c1());
+
+    // The task is posted before worker starts, and it's done before worker quits.
+    SrsRtmpHandshakeWorker worker;
+    SrsRtmpHandshakeTask task(&hs_bytes);
+    EXPECT_TRUE(worker.post(&task));
+
+    HELPER_ASSERT_SUCCESS(worker.start());
+    worker.stop();
+
+    // The done task is reaped by ST thread, which wakes up the waiting coroutine.
+    EXPECT_FALSE(task.done_);
+    EXPECT_EQ(1, worker.reap());
+    EXPECT_TRUE(task.done_);
+    EXPECT_EQ(0, worker.reap());
+
+    // The c0c1 of simple handshake is not able to create s0s1s2 of complex handshake.
+    err = task.err_;
+    EXPECT_EQ(ERROR_RTMP_TRY_SIMPLE_HS, srs_error_code(err));
+    srs_freep(err);
+}
+
+class MockDvrOnDvrTask : public ISrsAsyncCallTask
+{
+public:
+    MockDvrOnDvrTask() {
+    }
+    virtual ~MockDvrOnDvrTask() {
+    }
+    virtual srs_error_t call() {
+        return srs_success;
+    }
+    virtual std::string to_string() {
+        return "on_dvr";
+    }
+};
+
+class MockDvrMp4Finalizer : public SrsDvrMp4Finalizer
+{
+public:
+    int nn_notified;
+public:
+    MockDvrMp4Finalizer() {
+        nn_notified = 0;
+    }
+    virtual ~MockDvrMp4Finalizer() {
+    }
+protected:
+    virtual srs_error_t notify(ISrsAsyncCallTask* on_dvr) {
+        nn_notified++;
+        srs_freep(on_dvr);
+        return srs_success;
+    }
+};
+
+VOID TEST(AppDvrTest, FinalizeThenNotify)
+{
+    string path = _srs_tmp_file_prefix + "dvr_finalize.mp4";
+    string index = path + ".idx";
+
+    // Fire the on_dvr event after finalized by thread, even if failed, and never leave the index.
+    if (true) {
+        MockDvrMp4Finalizer finalizer;
+        SrsFileWriter fw;
+        EXPECT_TRUE(fw.open(index) == srs_success);
+        fw.close();
+
+        finalizer.finalize(path, new MockDvrOnDvrTask());
+        EXPECT_EQ(0, finalizer.nn_notified);
+
+        for (int i = 0; i < 100 && !finalizer.nn_notified; i++) {
+            srs_usleep(10 * SRS_UTIME_MILLISECONDS);
+        }
+        EXPECT_EQ(1, finalizer.nn_notified);
+        EXPECT_FALSE(srs_path_exists(index));
+
+        // Finalize in current thread, after the finalizer thread is stopped.
+        finalizer.stop();
+        finalizer.finalize(path, new MockDvrOnDvrTask());
+        EXPECT_EQ(2, finalizer.nn_notified);
+    }
+}
+
+VOID TEST(AppHlsGroupTest, ValidName)
+{
+    EXPECT_TRUE(SrsHlsGroup::is_valid_name("livestream"));
+    EXPECT_TRUE(SrsHlsGroup::is_valid_name("live-stream_720P"));
+
+    // Never allow path traversal or other special chars.
+    EXPECT_FALSE(SrsHlsGroup::is_valid_name(""));
+    EXPECT_FALSE(SrsHlsGroup::is_valid_name("../livestream"));
+    EXPECT_FALSE(SrsHlsGroup::is_valid_name("../../etc/passwd"));
+    EXPECT_FALSE(SrsHlsGroup::is_valid_name("live/stream"));
+    EXPECT_FALSE(SrsHlsGroup::is_valid_name(".."));
+    EXPECT_FALSE(SrsHlsGroup::is_valid_name("live stream"));
+    EXPECT_FALSE(SrsHlsGroup::is_valid_name(std::string("live\0stream", 11)));
+}
+
+VOID TEST(AppHlsGroupTest, AlignAndMaster)
+{
+    srs_error_t err;
+
+    string master = _srs_tmp_file_prefix + "hls_master.m3u8";
+    SrsHlsGroup* group = SrsHlsGroup::acquire(master);
+    EXPECT_TRUE(group == SrsHlsGroup::acquire(master));
+    SrsHlsGroup::release(group);
+
+    if (true) {
+        // No rendition reaped, should not reap.
+        EXPECT_FALSE(group->should_reap(90000, -1));
+
+        // Another rendition reaped at 9000, follow it at the same or later keyframe.
+        group->on_reap(9000);
+        EXPECT_FALSE(group->should_reap(8000, -1));
+        EXPECT_TRUE(group->should_reap(9000, -1));
+        EXPECT_TRUE(group->should_reap(9900, 3000));
+
+        // We already reaped at 9000.
+        EXPECT_FALSE(group->should_reap(9900, 9000));
+
+        // Never go back.
+        group->on_reap(3000);
+        EXPECT_EQ(9000, group->reap_dts_);
+    }
+
+    if (true) {
+        // The variant without bandwidth is ignored, no master playlist.
+        HELPER_EXPECT_SUCCESS(group->update("live_360p.m3u8", SrsHlsVariant()));
+        EXPECT_FALSE(srs_path_exists(master));
+
+        SrsHlsVariant v;
+        v.bandwidth = 800000; v.width = 640; v.height = 360;
+        HELPER_EXPECT_SUCCESS(group->update("live_360p.m3u8", v));
+
+        SrsFileReader fr;
+        HELPER_EXPECT_SUCCESS(fr.open(master));
+        char buf[256] = {0};
+        ssize_t nn = 0;
+        HELPER_EXPECT_SUCCESS(fr.read(buf, sizeof(buf), &nn));
+        fr.close();
+        EXPECT_STREQ("#EXTM3U\n#EXT-X-VERSION:3\n#EXT-X-STREAM-INF:BANDWIDTH=800000,RESOLUTION=640x360\nlive_360p.m3u8\n", buf);
+    }
+
+    // Remove the master playlist when all renditions released.
+    HELPER_EXPECT_SUCCESS(group->remove("live_360p.m3u8"));
+    SrsHlsGroup::release(group);
+    EXPECT_FALSE(srs_path_exists(master));
+}
+
+VOID TEST(AppMergedIOTest, TuneByBitrate)
+{
+    SrsMergedIOTuner tuner(350 * SRS_UTIME_MILLISECONDS, 8);
+    EXPECT_EQ(350 * SRS_UTIME_MILLISECONDS, tuner.sleep());
+    EXPECT_EQ(8, tuner.msgs());
+
+    // Ignore the empty bitrate.
+    EXPECT_FALSE(tuner.update(0, 30));
+    EXPECT_EQ(0, tuner.buffer());
+
+    // Low bitrate, use the max latency and the min buffer.
+    EXPECT_TRUE(tuner.update(100, 30));
+    EXPECT_EQ(350 * SRS_UTIME_MILLISECONDS, tuner.sleep());
+    EXPECT_EQ(16384, tuner.buffer());
+    EXPECT_EQ(10, tuner.msgs());
+
+    // High bitrate, the latency is enough to merge 64KB.
+    EXPECT_TRUE(tuner.update(8000, 300));
+    EXPECT_EQ(65536, tuner.sleep());
+    EXPECT_EQ(130000, tuner.buffer());
+    EXPECT_EQ(19, tuner.msgs());
+
+    // Ignore the small changes.
+    EXPECT_FALSE(tuner.update(8100, 300));
+    EXPECT_EQ(65536, tuner.sleep());
+    EXPECT_EQ(8100, tuner.kbps());
+
+    // Very high bitrate, limit by the min latency and the max buffer.
+    EXPECT_TRUE(tuner.update(1000000, 3000));
+    EXPECT_EQ(10 * SRS_UTIME_MILLISECONDS, tuner.sleep());
+    EXPECT_EQ(1048576, tuner.buffer());
+    EXPECT_EQ(30, tuner.msgs());
+}
+
+class MockEdgeParentDiscovery : public SrsEdgeParentDiscovery
+{
+public:
+    // The apis asked by discovery.
+    std::vector<std::string> asked;
+    // The parents delivering the stream, by api.
+    std::map<std::string, std::string> delivering;
+    // The time to response.
+    srs_utime_t delay;
+public:
+    MockEdgeParentDiscovery(srs_utime_t ttl, srs_utime_t timeout) : SrsEdgeParentDiscovery(ttl, timeout) {
+        delay = 0;
+    }
+    virtual ~MockEdgeParentDiscovery() {
+    }
+protected:
+    virtual srs_error_t query(SrsRequest* /*req*/, std::string api, srs_utime_t timeout, std::string& parent) {
+        asked.push_back(api);
+        if (delay) {
+            srs_usleep(srs_min(delay, timeout));
+        }
+
+        std::map<std::string, std::string>::iterator it = delivering.find(api);
+        if (it == delivering.end()) {
+            return srs_error_new(ERROR_OCLUSTER_DISCOVER, "not delivering");
+        }
+
+        parent = it->second;
+        return srs_success;
+    }
+};
+
+VOID TEST(AppEdgeTest, DiscoverParent)
+{
+    SrsRequest req;
+    req.vhost = "__defaultVhost__"; req.app = "live"; req.stream = "livestream";
+
+    std::vector<std::string> parents;
+    parents.push_back("10.0.0.1:1985");
+    parents.push_back("10.0.0.2:1985");
+    parents.push_back("10.0.0.3:1985");
+
+    // No parents, never ask.
+    if (true) {
+        MockEdgeParentDiscovery d(10 * SRS_UTIME_SECONDS, 3 * SRS_UTIME_SECONDS);
+        EXPECT_STREQ("", d.discover(&req, std::vector<std::string>()).c_str());
+        EXPECT_EQ(0, (int)d.asked.size());
+    }
+
+    // Select the first parent delivering the stream, and cache it.
+    if (true) {
+        MockEdgeParentDiscovery d(10 * SRS_UTIME_SECONDS, 3 * SRS_UTIME_SECONDS);
+        d.delivering["10.0.0.2:1985"] = "10.0.0.2:8080";
+        d.delivering["10.0.0.3:1985"] = "10.0.0.3:8080";
+
+        EXPECT_STREQ("10.0.0.2:8080", d.discover(&req, parents).c_str());
+        EXPECT_EQ(2, (int)d.asked.size());
+
+        EXPECT_STREQ("10.0.0.2:8080", d.discover(&req, parents).c_str());
+        EXPECT_EQ(2, (int)d.asked.size());
+
+        // Ask again after reset, for example, failed to pull from the parent.
+        d.delivering.erase("10.0.0.2:1985");
+        d.reset();
+        EXPECT_STREQ("10.0.0.3:8080", d.discover(&req, parents).c_str());
+        EXPECT_EQ(5, (int)d.asked.size());
+    }
+
+    // Cache the result when not found, until expired.
+    if (true) {
+        MockEdgeParentDiscovery d(10 * SRS_UTIME_MILLISECONDS, 3 * SRS_UTIME_SECONDS);
+        EXPECT_STREQ("", d.discover(&req, parents).c_str());
+        EXPECT_EQ(3, (int)d.asked.size());
+
+        EXPECT_STREQ("", d.discover(&req, parents).c_str());
+        EXPECT_EQ(3, (int)d.asked.size());
+
+        srs_usleep(20 * SRS_UTIME_MILLISECONDS);
+        d.delivering["10.0.0.1:1985"] = "10.0.0.1:8080";
+        EXPECT_STREQ("10.0.0.1:8080", d.discover(&req, parents).c_str());
+        EXPECT_EQ(4, (int)d.asked.size());
+    }
+
+    // Stop asking when exceed the total timeout, even there are parents left.
+    if (true) {
+        MockEdgeParentDiscovery d(10 * SRS_UTIME_SECONDS, 50 * SRS_UTIME_MILLISECONDS);
+        d.delay = 30 * SRS_UTIME_MILLISECONDS;
+        d.delivering["10.0.0.3:1985"] = "10.0.0.3:8080";
+
+        EXPECT_STREQ("", d.discover(&req, parents).c_str());
+        EXPECT_EQ(2, (int)d.asked.size());
+    }
+}
@@ -1820,6 +1820,18 @@ VOID TEST(ConfigMainTest, CheckConf_transcode)
         HELPER_ASSERT_FAILED(conf.parse(_MIN_OK_CONF "vhost v{transcode{ffmpegs ./objs/ffmpeg/bin/ffmpeg;}}"));
     }
 
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost v{transcode{ladder on;}}"));
+        EXPECT_TRUE(conf.get_transcode_ladder(conf.get_transcode("v", "")));
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost v{transcode{}}"));
+        EXPECT_FALSE(conf.get_transcode_ladder(conf.get_transcode("v", "")));
+    }
+
     if (true) {
         MockSrsConfig conf;
         HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost v{transcode{engine {}}}"));
@@ -3260,10 +3272,13 @@ VOID TEST(ConfigMainTest, CheckVhostConfig3)
         EXPECT_TRUE(conf.get_vhost_on_dvr("ossrs.net") == NULL);
         EXPECT_TRUE(conf.get_vhost_on_hls("ossrs.net") == NULL);
         EXPECT_TRUE(conf.get_vhost_on_hls_notify("ossrs.net") == NULL);
+        EXPECT_EQ(0, conf.get_vhost_http_hooks_cache_ttl("ossrs.net"));
         EXPECT_FALSE(conf.get_vhost_is_edge("ossrs.net"));
         EXPECT_TRUE(conf.get_vhost_edge_origin("ossrs.net") == NULL);
         EXPECT_FALSE(conf.get_vhost_edge_token_traverse("ossrs.net"));
         EXPECT_STREQ("[vhost]", conf.get_vhost_edge_transform_vhost("ossrs.net").c_str());
+        EXPECT_STREQ("round_robin", conf.get_vhost_edge_load_balance("ossrs.net").c_str());
+        EXPECT_EQ(0, (int)conf.get_vhost_edge_parents("ossrs.net").size());
         EXPECT_FALSE(conf.get_vhost_origin_cluster("ossrs.net"));
         EXPECT_EQ(0, (int)conf.get_vhost_coworkers("ossrs.net").size());
         EXPECT_FALSE(conf.get_security_enabled("ossrs.net"));
@@ -3300,6 +3315,18 @@ VOID TEST(ConfigMainTest, CheckVhostConfig3)
         EXPECT_FALSE(conf.get_vhost_edge_transform_vhost("ossrs.net").empty());
     }
 
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{cluster{load_balance hash;}}"));
+        EXPECT_STREQ("hash", conf.get_vhost_edge_load_balance("ossrs.net").c_str());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{cluster{parents 127.0.0.1:1985 127.0.0.1:1986;}}"));
+        EXPECT_EQ(2, (int)conf.get_vhost_edge_parents("ossrs.net").size());
+    }
+
     if (true) {
         MockSrsConfig conf;
         HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{cluster{token_traverse on;}}"));
@@ -3324,6 +3351,12 @@ VOID TEST(ConfigMainTest, CheckVhostConfig3)
         EXPECT_TRUE(conf.get_vhost_on_hls_notify("ossrs.net") != NULL);
     }
 
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{http_hooks{cache_ttl 5;}}"));
+        EXPECT_EQ(5 * SRS_UTIME_SECONDS, conf.get_vhost_http_hooks_cache_ttl("ossrs.net"));
+    }
+
     if (true) {
         MockSrsConfig conf;
         HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{http_hooks{on_hls xxx;}}"));
@@ -4181,6 +4214,14 @@ VOID TEST(ConfigEnvTest, CheckEnvValuesGlobal)
         SrsSetEnvConfig(first_wait_for_qlv, "SRS_FIRST_WAIT_FOR_QLV", "200");
         EXPECT_EQ(200 * SRS_UTIME_SECONDS, conf.first_wait_for_qlv());
     }
+
+    if (true) {
+        MockSrsConfig conf;
+        EXPECT_EQ(60 * SRS_UTIME_SECONDS, conf.get_handshake_key_rotation());
+
+        SrsSetEnvConfig(handshake_key_rotation, "SRS_HANDSHAKE_KEY_ROTATION", "0");
+        EXPECT_EQ(0, conf.get_handshake_key_rotation());
+    }
 }
 
 VOID TEST(ConfigEnvTest, CheckEnvValuesthreads)
@@ -4191,6 +4232,34 @@ VOID TEST(ConfigEnvTest, CheckEnvValuesthreads)
         SrsSetEnvConfig(threads_interval, "SRS_THREADS_INTERVAL", "10");
         EXPECT_EQ(10 * SRS_UTIME_SECONDS, conf.get_threads_interval());
     }
+
+    if (true) {
+        MockSrsConfig conf;
+        EXPECT_EQ(2, conf.get_threads_transcode());
+        EXPECT_EQ(64, conf.get_threads_max_transcoders());
+
+        SrsSetEnvConfig(threads_transcode, "SRS_THREADS_TRANSCODE", "0");
+        EXPECT_EQ(0, conf.get_threads_transcode());
+
+        SrsSetEnvConfig(threads_max_transcoders, "SRS_THREADS_MAX_TRANSCODERS", "8");
+        EXPECT_EQ(8, conf.get_threads_max_transcoders());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        EXPECT_EQ(0, conf.get_threads_gb28181());
+
+        SrsSetEnvConfig(threads_gb28181, "SRS_THREADS_GB28181", "4");
+        EXPECT_EQ(4, conf.get_threads_gb28181());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        EXPECT_EQ(0, conf.get_threads_handshake());
+
+        SrsSetEnvConfig(threads_handshake, "SRS_THREADS_HANDSHAKE", "2");
+        EXPECT_EQ(2, conf.get_threads_handshake());
+    }
 }
 
 VOID TEST(ConfigEnvTest, CheckEnvValuesRtmp)
@@ -4483,6 +4552,15 @@ VOID TEST(ConfigEnvTest, CheckEnvValuesVhostRtc)
         SrsSetEnvConfig(rtc_twcc_enabled, "SRS_VHOST_RTC_TWCC", "off");
         EXPECT_FALSE(conf.get_rtc_twcc_enabled("__defaultVhost__"));
 
+        SrsSetEnvConfig(rtc_bwe_enabled, "SRS_VHOST_RTC_BWE", "off");
+        EXPECT_FALSE(conf.get_rtc_bwe_enabled("__defaultVhost__"));
+
+        SrsSetEnvConfig(rtc_pacer_enabled, "SRS_VHOST_RTC_PACER", "off");
+        EXPECT_FALSE(conf.get_rtc_pacer_enabled("__defaultVhost__"));
+
+        SrsSetEnvConfig(rtc_fec_enabled, "SRS_VHOST_RTC_FEC", "on");
+        EXPECT_TRUE(conf.get_rtc_fec_enabled("__defaultVhost__"));
+
         SrsSetEnvConfig(rtc_stun_timeout, "SRS_VHOST_RTC_STUN_TIMEOUT", "15");
         EXPECT_EQ(15 * SRS_UTIME_SECONDS, conf.get_rtc_stun_timeout("__defaultVhost__"));
 
@@ -4544,6 +4622,20 @@ VOID TEST(ConfigEnvTest, CheckEnvValuesVhostRtc)
         SrsSetEnvConfig(rtc_pli_for_rtmp, "SRS_VHOST_RTC_PLI_FOR_RTMP", "60");
         EXPECT_EQ(6 * SRS_UTIME_SECONDS, conf.get_rtc_pli_for_rtmp("__defaultVhost__"));
     }
+
+    if (true) {
+        MockSrsConfig conf;
+
+        SrsSetEnvConfig(rtc_jitter_for_rtmp, "SRS_VHOST_RTC_JITTER_FOR_RTMP", "0.3");
+        EXPECT_EQ(300 * SRS_UTIME_MILLISECONDS, conf.get_rtc_jitter_for_rtmp("__defaultVhost__"));
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+
+        SrsSetEnvConfig(rtc_jitter_for_rtmp, "SRS_VHOST_RTC_JITTER_FOR_RTMP", "0.01");
+        EXPECT_EQ(1 * SRS_UTIME_SECONDS, conf.get_rtc_jitter_for_rtmp("__defaultVhost__"));
+    }
 }
 
 VOID TEST(ConfigEnvTest, CheckEnvValuesVhostPlay)
@@ -4612,6 +4704,12 @@ VOID TEST(ConfigEnvTest, CheckEnvValuesVhostPlay)
 
         SrsSetEnvConfig(reduce_sequence_header, "SRS_VHOST_PLAY_REDUCE_SEQUENCE_HEADER", "on");
         EXPECT_TRUE(conf.get_reduce_sequence_header("__defaultVhost__"));
+
+        SrsSetEnvConfig(mw_adaptive, "SRS_VHOST_PLAY_MW_ADAPTIVE", "on");
+        EXPECT_TRUE(conf.get_mw_adaptive("__defaultVhost__"));
+
+        SrsSetEnvConfig(zerocopy, "SRS_VHOST_PLAY_ZEROCOPY", "on");
+        EXPECT_TRUE(conf.get_zerocopy("__defaultVhost__"));
     }
 }
 
@@ -4626,6 +4724,9 @@ VOID TEST(ConfigEnvTest, CheckEnvValuesVhostPublish)
         SrsSetEnvConfig(mr_sleep, "SRS_VHOST_PUBLISH_MR_LATENCY", "10");
         EXPECT_EQ(10 * SRS_UTIME_MILLISECONDS, conf.get_mr_sleep("__defaultVhost__"));
 
+        SrsSetEnvConfig(mr_adaptive, "SRS_VHOST_PUBLISH_MR_ADAPTIVE", "on");
+        EXPECT_TRUE(conf.get_mr_adaptive("__defaultVhost__"));
+
         SrsSetEnvConfig(publish_normal_timeout, "SRS_VHOST_PUBLISH_NORMAL_TIMEOUT", "10");
         EXPECT_EQ(10 * SRS_UTIME_MILLISECONDS, conf.get_publish_normal_timeout("__defaultVhost__"));
 
@@ -4911,6 +5012,12 @@ VOID TEST(ConfigEnvTest, CheckEnvValuesDash)
 
         SrsSetEnvConfig(dash_mpd_file, "SRS_VHOST_DASH_DASH_MPD_FILE", "xxx2");
         EXPECT_STREQ("xxx2", conf.get_dash_mpd_file("__defaultVhost__").c_str());
+
+        SrsSetEnvConfig(dash_low_latency, "SRS_VHOST_DASH_DASH_LOW_LATENCY", "on");
+        EXPECT_TRUE(conf.get_dash_low_latency("__defaultVhost__"));
+
+        SrsSetEnvConfig(dash_chunk_duration, "SRS_VHOST_DASH_DASH_CHUNK_DURATION", "0.2");
+        EXPECT_EQ(200 * SRS_UTIME_MILLISECONDS, conf.get_dash_chunk_duration("__defaultVhost__"));
     }
 }
 
@@ -4959,6 +5066,12 @@ VOID TEST(ConfigEnvTest, CheckEnvValuesDvr)
         SrsSetEnvConfig(dvr_wait_keyframe, "SRS_VHOST_DVR_DVR_WAIT_KEYFRAME", "off");
         EXPECT_FALSE(conf.get_dvr_wait_keyframe("__defaultVhost__"));
 
+        SrsSetEnvConfig(dvr_mp4_fragment, "SRS_VHOST_DVR_DVR_MP4_FRAGMENT", "2.5");
+        EXPECT_EQ(2500 * SRS_UTIME_MILLISECONDS, conf.get_dvr_mp4_fragment("__defaultVhost__"));
+
+        SrsSetEnvConfig(dvr_mp4_faststart, "SRS_VHOST_DVR_DVR_MP4_FASTSTART", "off");
+        EXPECT_FALSE(conf.get_dvr_mp4_faststart("__defaultVhost__"));
+
         SrsSetEnvConfig(dvr_time_jitter_full, "SRS_VHOST_DVR_TIME_JITTER", "full");
         EXPECT_EQ(0x1, conf.get_dvr_time_jitter("__defaultVhost__"));
 
@@ -16,6 +16,7 @@ using namespace std;
 #include <srs_kernel_file.hpp>
 #include <srs_utest_kernel.hpp>
 #include <srs_app_http_static.hpp>
+#include <srs_app_threads.hpp>
 #include <srs_protocol_utility.hpp>
 #include <srs_core_autofree.hpp>
 #include <srs_app_gb28181.hpp>
@@ -1620,6 +1621,212 @@ VOID TEST(KernelPSTest, PsSkipUtilPack)
     }
 }
 
+VOID TEST(KernelPSTest, PsSkipUtilPackFast)
+{
+    // The 0xba in payload, which is not pack header, should be skipped.
+    if (true) {
+        string raw = string(1000, '\xba') + string("\x00\x01\xba\x00\x00\xba\x00\x00\x01\xba\x44", 11);
+        SrsBuffer b((char*) raw.data(), raw.length());
+        EXPECT_TRUE(srs_skip_util_pack(&b));
+        EXPECT_EQ(1006, b.pos());
+    }
+
+    // Keep the last 3 bytes if not found.
+    if (true) {
+        string raw = string(1000, '\xba') + string("\x00\x00\x01", 3);
+        SrsBuffer b((char*) raw.data(), raw.length());
+        EXPECT_FALSE(srs_skip_util_pack(&b));
+        EXPECT_EQ(3, b.left());
+    }
+}
+
+class MockPsReuseHandler : public ISrsPsMessageHandler
+{
+public:
+    std::vector<SrsTsMessage*> msgs_;
+    std::vector<int> sizes_;
+public:
+    MockPsReuseHandler() {
+    }
+    virtual ~MockPsReuseHandler() {
+    }
+public:
+    virtual srs_error_t on_ts_message(SrsTsMessage* m) {
+        msgs_.push_back(m);
+        sizes_.push_back(m->payload->length());
+        return srs_success;
+    }
+    virtual void on_recover_mode(int nn_recover) {
+    }
+};
+
+VOID TEST(KernelPSTest, PsContextReuseMessages)
+{
+    srs_error_t err = srs_success;
+
+    // The pack is reused with a new ID.
+    if (true) {
+        SrsPsPacket ps(NULL);
+        uint32_t id = ps.id_;
+        ps.has_pack_header_ = true;
+        ps.reset();
+        EXPECT_NE(id, ps.id_);
+        EXPECT_FALSE(ps.has_pack_header_);
+    }
+
+    // The messages is reused after handled.
+    if (true) {
+        string pes = string(
+            "\x00\x00\x01\xc0" \
+            "\x00\x6e\x8c\x80\x07\x25\x8a\x6d\xa9\xfd\xff\xf8\xff\xf9\x50\x40" \
+            "\x0c\x9f\xfc\x01\x3a\x2e\x98\x28\x18\x0a\x09\x84\x81\x60\xc0\x50" \
+            "\x2a\x12\x13\x05\x02\x22\x00\x88\x4c\x40\x11\x09\x85\x02\x61\x10" \
+            "\xa8\x40\x00\x00\x00\x1f\xa6\x8d\xef\x03\xca\xf0\x63\x7f\x02\xe2" \
+            "\x1d\x7f\xbf\x3e\x22\xbe\x3d\xf7\xa2\x7c\xba\xe6\xc8\xfb\x35\x9f" \
+            "\xd1\xa2\xc4\xaa\xc5\x3d\xf6\x67\xfd\xc6\x39\x06\x9f\x9e\xdf\x9b" \
+            "\x10\xd7\x4f\x59\xfd\xef\xea\xee\xc8\x4c\x40\xe5\xd9\xed\x00\x1c", 116);
+        string raw = pes + pes + pes;
+
+        MockPsReuseHandler handler;
+        SrsPsContext context;
+        SrsBuffer b((char*) raw.data(), raw.length());
+        HELPER_ASSERT_SUCCESS(context.decode(&b, &handler));
+
+        ASSERT_EQ((size_t)3, handler.msgs_.size());
+        EXPECT_EQ(handler.msgs_[0], handler.msgs_[2]);
+        EXPECT_NE(handler.msgs_[0], handler.msgs_[1]);
+        EXPECT_EQ(100, handler.sizes_[0]);
+        EXPECT_EQ(100, handler.sizes_[1]);
+        EXPECT_EQ(100, handler.sizes_[2]);
+    }
+}
+
+VOID TEST(KernelPSTest, PsMediaWorkerDemux)
+{
+    // The RTP packet with a pack header and an audio PES.
+    string raw = string("\x80\x60\x7c\xac\x05\xb3\x88\xa0\x0b\xeb\xd1\x35", 12)
+        + string("\x00\x00\x01\xba\x44\x68\x6e\x4c\x94\x01\x01\x30\x13\xfe\xff\xff\x00\x00\xa0\x05", 20)
+        + string("\x00\x00\x01\xc0\x00\x82\x8c\x80\x09\x21\x1a\x1b\xa3\x51\xff\xff\xff\xf8", 18) + string(118, 'x');
+
+    SrsGbMediaWorker worker;
+    SrsGbMediaChannel* channel = worker.create_channel();
+    ASSERT_TRUE(channel != NULL);
+
+    // The pack is done when got the next pack.
+    for (int i = 0; i < 2; i++) {
+        SrsGbMediaPacket* pkt = new SrsGbMediaPacket((int)raw.length());
+        memcpy(pkt->payload(), raw.data(), raw.length());
+        EXPECT_TRUE(channel->packets_->push(pkt));
+    }
+    EXPECT_EQ(2, worker.consume());
+    EXPECT_FALSE(channel->failed());
+
+    SrsGbMediaPack* pack = NULL;
+    ASSERT_TRUE(channel->packs_->pop(pack));
+    ASSERT_EQ((size_t)1, pack->msgs_.size());
+
+    // The message refers to the copy of PS context in pack.
+    SrsTsMessage* msg = pack->msgs_.front();
+    EXPECT_EQ(SrsTsPESStreamIdAudioCommon, msg->sid);
+    EXPECT_EQ(118, msg->payload->length());
+    EXPECT_TRUE(msg->ps_helper_ == &pack->helper_);
+    EXPECT_TRUE(pack->helper_.ctx_ == pack->ctx_);
+    EXPECT_TRUE(pack->helper_.ps_ == pack->ps_);
+    EXPECT_TRUE(pack->ps_->has_pack_header_);
+
+    // The pack and messages are reused by worker.
+    pack->clear();
+    EXPECT_TRUE(channel->free_packs_->push(pack));
+
+    SrsGbMediaPacket* pkt = new SrsGbMediaPacket((int)raw.length());
+    memcpy(pkt->payload(), raw.data(), raw.length());
+    EXPECT_TRUE(channel->packets_->push(pkt));
+    EXPECT_EQ(1, worker.consume());
+
+    SrsGbMediaPack* pack2 = NULL;
+    ASSERT_TRUE(channel->packs_->pop(pack2));
+    EXPECT_TRUE(pack == pack2);
+    ASSERT_EQ((size_t)1, pack2->msgs_.size());
+    EXPECT_TRUE(msg == pack2->msgs_.front());
+    EXPECT_EQ(118, msg->payload->length());
+    srs_freep(pack2);
+
+    // The closed channel is freed by worker.
+    channel->close();
+    EXPECT_EQ(0, worker.consume());
+}
+
+VOID TEST(KernelPSTest, PsMediaWorkerPendingPacks)
+{
+    srs_error_t err;
+
+    SrsGbMediaWorker worker;
+    SrsGbMediaChannel* channel = worker.create_channel();
+    ASSERT_TRUE(channel != NULL);
+
+    // Make the packs queue full, as ST thread is too slow to consume packs.
+    int nn_packs = 0;
+    while (channel->packs_->push(new SrsGbMediaPack())) {
+        nn_packs++;
+    }
+    EXPECT_EQ(nn_packs, (int)channel->packs_->size());
+
+    // The pack is kept as pending, never dropped when queue is full.
+    SrsPsContext ctx;
+    SrsPsPacket ps(&ctx);
+    SrsTsMessage msg;
+    msg.ps_helper_ = &ctx.helper_;
+    msg.sid = SrsTsPESStreamIdAudioCommon;
+    std::vector<SrsTsMessage*> msgs;
+    msgs.push_back(&msg);
+    HELPER_ASSERT_SUCCESS(channel->on_ps_pack(&ps, msgs));
+    EXPECT_EQ(0, worker.consume());
+
+    // The pending pack is pushed when ST thread consumes a pack.
+    SrsGbMediaPack* pack = NULL;
+    ASSERT_TRUE(channel->packs_->pop(pack));
+    srs_freep(pack);
+    EXPECT_EQ(1, worker.consume());
+    EXPECT_EQ(nn_packs, (int)channel->packs_->size());
+
+    // The pending pack is the last one in queue.
+    for (int i = 0; i < nn_packs; i++) {
+        ASSERT_TRUE(channel->packs_->pop(pack));
+        if (i < nn_packs - 1) {
+            srs_freep(pack);
+        }
+    }
+    ASSERT_EQ((size_t)1, pack->msgs_.size());
+    EXPECT_EQ(SrsTsPESStreamIdAudioCommon, pack->msgs_.front()->sid);
+    srs_freep(pack);
+
+    channel->close();
+    EXPECT_EQ(0, worker.consume());
+}
+
+VOID TEST(KernelPSTest, PsMediaWorkerStop)
+{
+    srs_error_t err;
+
+    SrsGbMediaWorker worker;
+    HELPER_ASSERT_SUCCESS(worker.start());
+
+    SrsGbMediaChannel* channel = worker.create_channel();
+    ASSERT_TRUE(channel != NULL);
+    EXPECT_FALSE(channel->failed());
+    EXPECT_TRUE(channel->error() == srs_success);
+
+    // The channel still used by ST thread is failed when worker stopped, so the camera never waits for the packs.
+    worker.stop();
+    EXPECT_TRUE(channel->failed());
+
+    err = channel->error();
+    EXPECT_EQ(ERROR_GB_PS_MEDIA, srs_error_code(err));
+    srs_freep(err);
+
+    channel->close();
+}
+
 VOID TEST(KernelPSTest, PsPacketDecodeRegularMessage)
 {
     srs_error_t err = srs_success;
@@ -205,6 +205,16 @@ bool _mock_srs_path_not_exists(std::string /*path*/)
     return false;
 }
 
+// The in-progress m4s is reaped when checked the second time.
+int _mock_m4s_checks = 0;
+bool _mock_srs_path_m4s_reaped(std::string path)
+{
+    if (srs_string_ends_with(path, ".tmp")) {
+        return true;
+    }
+    return ++_mock_m4s_checks > 1;
+}
+
 VOID TEST(ProtocolHTTPTest, StatusCode2Text)
 {
     EXPECT_STREQ(SRS_CONSTS_HTTP_OK_str, srs_generate_http_status_text(SRS_CONSTS_HTTP_OK).c_str());
@@ -1711,6 +1721,29 @@ VOID TEST(ProtocolHTTPTest, BasicHandlers)
         __MOCK_HTTP_EXPECT_STREQ(404, "Not Found", w);
     }
 
+    // For LL-DASH, serve the in-progress m4s by chunked transfer.
+    if (true) {
+        SrsHttpMuxEntry e;
+        e.pattern = "/";
+
+        SrsHttpFileServer h("/tmp");
+        h.set_fs_factory(new MockFileReaderFactory("Hello, world!"));
+        h.set_path_check(_mock_srs_path_m4s_reaped);
+        h.entry = &e;
+        _mock_m4s_checks = 0;
+
+        MockResponseWriter w;
+        SrsHttpMessage r(NULL, NULL);
+        HELPER_ASSERT_SUCCESS(r.set_url("/video-3.m4s", false));
+
+        HELPER_ASSERT_SUCCESS(h.serve_http(&w, &r));
+        string res = HELPER_BUFFER2STR(&w.io.out_buffer);
+        EXPECT_TRUE(is_string_contain("HTTP/1.1 200 OK", res));
+        EXPECT_TRUE(is_string_contain("Transfer-Encoding: chunked", res));
+        EXPECT_TRUE(is_string_contain("Hello, world!", res));
+        EXPECT_FALSE(is_string_contain("Content-Length", res));
+    }
+
     if (true) {
         EXPECT_STREQ("/tmp/index.html", srs_http_fs_fullpath("/tmp", "/", "/").c_str());
         EXPECT_STREQ("/tmp/index.html", srs_http_fs_fullpath("/tmp", "/", "/index.html").c_str());
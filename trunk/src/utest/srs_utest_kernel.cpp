@@ -22,6 +22,8 @@ using namespace std;
 #include <srs_kernel_mp4.hpp>
 #include <srs_core_autofree.hpp>
 
+#include <openssl/evp.h>
+
 #define MAX_MOCK_DATA_SIZE 1024 * 1024
 
 MockSrsFile::MockSrsFile()
@@ -3286,6 +3288,125 @@ VOID TEST(KernelLBRRTest, CoverAll)
     }
 }
 
+VOID TEST(KernelLBRRTest, HealthEject)
+{
+    srs_utime_t now = srs_update_system_time();
+
+    if (true) {
+        SrsLbHealth health;
+        health.set_eject(1 * SRS_UTIME_SECONDS, 4 * SRS_UTIME_SECONDS);
+
+        health.on_failure("s0", now);
+        SrsLbServerHealth* h = health.fetch_or_create("s0");
+        EXPECT_EQ(1, h->failures);
+        EXPECT_TRUE(h->is_ejected(now));
+        EXPECT_EQ(now + 1 * SRS_UTIME_SECONDS, h->ejected_until);
+
+        health.on_failure("s0", now);
+        EXPECT_EQ(now + 2 * SRS_UTIME_SECONDS, h->ejected_until);
+
+        // Never exceed the max eject duration.
+        health.on_failure("s0", now);
+        health.on_failure("s0", now);
+        EXPECT_EQ(now + 4 * SRS_UTIME_SECONDS, h->ejected_until);
+        EXPECT_EQ(4, (int)h->nn_failures);
+
+        // Recover when success.
+        health.on_success("s0", 80 * SRS_UTIME_MILLISECONDS);
+        EXPECT_EQ(0, h->failures);
+        EXPECT_FALSE(h->is_ejected(now));
+        EXPECT_EQ(80 * SRS_UTIME_MILLISECONDS, h->srtt);
+
+        // The srtt is EWMA of rtt.
+        health.on_success("s0", 160 * SRS_UTIME_MILLISECONDS);
+        EXPECT_EQ(90 * SRS_UTIME_MILLISECONDS, h->srtt);
+        EXPECT_EQ(160 * SRS_UTIME_MILLISECONDS, h->rtt);
+    }
+}
+
+VOID TEST(KernelLBRRTest, PowerOfTwo)
+{
+    vector<string> servers;
+    servers.push_back("s0");
+    servers.push_back("s1");
+
+    if (true) {
+        SrsLbHealth health;
+        SrsLbPowerOfTwo lb(&health);
+        EXPECT_TRUE("" == lb.selected());
+
+        // Always select the server with smaller srtt.
+        health.on_success("s0", 100 * SRS_UTIME_MILLISECONDS);
+        health.on_success("s1", 10 * SRS_UTIME_MILLISECONDS);
+        for (int i = 0; i < 10; i++) {
+            EXPECT_TRUE("s1" == lb.select(servers));
+            EXPECT_EQ(1, (int)lb.current());
+        }
+    }
+
+    if (true) {
+        SrsLbHealth health;
+        SrsLbPowerOfTwo lb(&health);
+
+        // Never select the ejected server.
+        health.on_success("s0", 100 * SRS_UTIME_MILLISECONDS);
+        health.on_success("s1", 10 * SRS_UTIME_MILLISECONDS);
+        lb.on_failure("s1");
+        for (int i = 0; i < 10; i++) {
+            EXPECT_TRUE("s0" == lb.select(servers));
+        }
+
+        // Fallback to the server which recover first, if all ejected.
+        lb.on_failure("s0");
+        lb.on_failure("s0");
+        EXPECT_TRUE("s1" == lb.select(servers));
+        EXPECT_EQ(11, (int)health.fetch_or_create("s0")->nn_selected + (int)health.fetch_or_create("s1")->nn_selected);
+    }
+}
+
+VOID TEST(KernelLBRRTest, ConsistentHash)
+{
+    vector<string> servers;
+    servers.push_back("s0");
+    servers.push_back("s1");
+    servers.push_back("s2");
+
+    if (true) {
+        SrsLbHealth health;
+        SrsLbConsistentHash lb0(&health, "/live/livestream");
+        SrsLbConsistentHash lb1(&health, "/live/livestream");
+
+        // The same key always select the same server.
+        string server = lb0.select(servers);
+        for (int i = 0; i < 10; i++) {
+            EXPECT_TRUE(server == lb0.select(servers));
+            EXPECT_TRUE(server == lb1.select(servers));
+        }
+
+        // Move to another server if ejected.
+        lb0.on_failure(server);
+        string server2 = lb0.select(servers);
+        EXPECT_TRUE(server != server2);
+        EXPECT_TRUE(server2 == lb1.select(servers));
+
+        // Move back when recovered.
+        lb0.on_success(server, 10 * SRS_UTIME_MILLISECONDS);
+        EXPECT_TRUE(server == lb0.select(servers));
+    }
+
+    if (true) {
+        SrsLbHealth health;
+
+        // The streams should be distributed to all servers.
+        map<string, int> hits;
+        for (int i = 0; i < 100; i++) {
+            SrsLbConsistentHash lb(&health, "/live/stream" + srs_int2str(i));
+            hits[lb.select(servers)]++;
+        }
+        EXPECT_EQ(3, (int)hits.size());
+    }
+}
+
 VOID TEST(KernelCodecTest, CoverAll)
 {
     if (true) {
@@ -5668,6 +5789,262 @@ VOID TEST(KernelTSTest, CoverTransmuxer)
     }
 }
 
+class MockTsCountWriter : public ISrsStreamWriter
+{
+public:
+    int nn_writes;
+    std::string data;
+public:
+    MockTsCountWriter() {
+        nn_writes = 0;
+    }
+    virtual ~MockTsCountWriter() {
+    }
+public:
+    virtual srs_error_t write(void* buf, size_t size, ssize_t* nwrite) {
+        nn_writes++;
+        data.append((char*)buf, size);
+        return srs_success;
+    }
+};
+
+VOID TEST(KernelTSTest, MuxPESInOneWrite)
+{
+    srs_error_t err;
+
+    SrsTsContext ctx;
+    MockTsCountWriter w;
+
+    // The PAT and PMT.
+    SrsTsMessage m0;
+    HELPER_EXPECT_SUCCESS(ctx.encode(&w, &m0, SrsVideoCodecIdAVC, SrsAudioCodecIdAAC));
+    EXPECT_EQ(2, w.nn_writes);
+
+    // The decoder consumes the stuffings to the end of buffer, so we feed it packet by packet.
+    SrsTsContext dec;
+    MockTsHandler h;
+    for (int i = 0; i < (int)w.data.length(); i += SRS_TS_PACKET_SIZE) {
+        SrsBuffer b((char*)w.data.data() + i, SRS_TS_PACKET_SIZE);
+        HELPER_EXPECT_SUCCESS(dec.decode(&b, &h));
+    }
+
+    // Each PES is written at once, and should be decoded as the same message, with stuffings,
+    // pcr and the large PES which PES_packet_length is 0.
+    int sizes[] = {1, 2, 150, 151, 152, 153, 170, 182, 183, 184, 185, 366, 367, 368, 1000, 70000};
+    for (int i = 0; i < (int)(sizeof(sizes) / sizeof(int)); i++) {
+        for (int video = 0; video < 2; video++) {
+            int size = sizes[i];
+
+            SrsTsMessage m;
+            m.write_pcr = (i % 2) == 0;
+            m.sid = video ? SrsTsPESStreamIdVideoCommon : SrsTsPESStreamIdAudioCommon;
+            m.dts = 90000 * 10 + i * 3600; m.pts = m.dts + (video ? 7200 : 0);
+            for (int j = 0; j < size; j++) {
+                char v = (char)(j + i);
+                m.payload->append(&v, 1);
+            }
+
+            w.nn_writes = 0; w.data.clear();
+            HELPER_EXPECT_SUCCESS(ctx.encode(&w, &m, SrsVideoCodecIdAVC, SrsAudioCodecIdAAC));
+            EXPECT_EQ(1, w.nn_writes);
+            EXPECT_EQ(0, (int)(w.data.length() % SRS_TS_PACKET_SIZE));
+
+            // For PES_packet_length is 0, the message is reaped by the next message.
+            for (int j = 0; j < (int)w.data.length(); j += SRS_TS_PACKET_SIZE) {
+                SrsBuffer b((char*)w.data.data() + j, SRS_TS_PACKET_SIZE);
+                HELPER_EXPECT_SUCCESS(dec.decode(&b, &h));
+            }
+            if (size > 0xFFFF) {
+                continue;
+            }
+
+            EXPECT_EQ(m.dts, h.msg->dts); EXPECT_EQ(m.pts, h.msg->pts);
+            ASSERT_EQ(size, h.msg->payload->length());
+            EXPECT_TRUE(0 == memcmp(m.payload->bytes(), h.msg->payload->bytes(), size));
+            srs_freep(h.msg);
+        }
+    }
+}
+
+class MockTsMessageHandler : public ISrsTsHandler
+{
+public:
+    std::vector<SrsTsMessage*> msgs;
+    std::vector<std::string> payloads;
+public:
+    MockTsMessageHandler() {
+    }
+    virtual ~MockTsMessageHandler() {
+    }
+public:
+    virtual srs_error_t on_ts_message(SrsTsMessage* m) {
+        msgs.push_back(m);
+        payloads.push_back(std::string(m->payload->bytes(), m->payload->length()));
+        return srs_success;
+    }
+};
+
+VOID TEST(KernelTSTest, DemuxPESInPlace)
+{
+    srs_error_t err;
+
+    SrsTsContext ctx;
+    MockTsCountWriter w;
+
+    SrsTsMessage m0;
+    HELPER_EXPECT_SUCCESS(ctx.encode(&w, &m0, SrsVideoCodecIdAVC, SrsAudioCodecIdAAC));
+
+    // Mux 10 frames, the 5th frame loses a packet.
+    std::vector<int> offsets;
+    for (int i = 0; i < 10; i++) {
+        SrsTsMessage m;
+        m.sid = SrsTsPESStreamIdVideoCommon;
+        m.dts = m.pts = i * 3600;
+        std::string frame(1000 + i, (char)i);
+        m.payload->append(frame.data(), (int)frame.length());
+
+        offsets.push_back((int)w.data.length());
+        HELPER_EXPECT_SUCCESS(ctx.encode(&w, &m, SrsVideoCodecIdAVC, SrsAudioCodecIdAAC));
+    }
+    w.data.erase(offsets[5] + SRS_TS_PACKET_SIZE * 2, SRS_TS_PACKET_SIZE);
+
+    SrsTsContext dec;
+    MockTsMessageHandler h;
+    for (int i = 0; i < (int)w.data.length(); i += SRS_TS_PACKET_SIZE) {
+        SrsBuffer b((char*)w.data.data() + i, SRS_TS_PACKET_SIZE);
+        HELPER_EXPECT_SUCCESS(dec.decode(&b, &h));
+    }
+
+    // The message with discontinuous packet is dropped.
+    ASSERT_EQ(9, (int)h.payloads.size());
+    for (int i = 0; i < 9; i++) {
+        int v = (i < 5) ? i : i + 1;
+        EXPECT_TRUE(std::string(1000 + v, (char)v) == h.payloads[i]);
+    }
+
+    // The messages are reused by context.
+    EXPECT_TRUE(h.msgs[0] == h.msgs[1]);
+    EXPECT_TRUE(h.msgs[1] == h.msgs[8]);
+}
+
+VOID TEST(KernelTSTest, EncFileWriterBatch)
+{
+    srs_error_t err;
+
+    unsigned char key[16], iv[16];
+    for (int i = 0; i < 16; i++) {
+        key[i] = (unsigned char)i; iv[i] = (unsigned char)(0xff - i);
+    }
+
+    std::string data;
+    for (int i = 0; i < SRS_TS_PACKET_SIZE * 37; i++) {
+        data.append(1, (char)(i * 7));
+    }
+
+    // Write packet by packet, or all packets at once, should get the same cipher.
+    std::string files[2];
+    for (int batch = 0; batch < 2; batch++) {
+        files[batch] = _srs_tmp_file_prefix + srs_fmt("enc-%d.ts", batch);
+
+        SrsEncFileWriter fw;
+        HELPER_ASSERT_SUCCESS(fw.open(files[batch]));
+        HELPER_ASSERT_SUCCESS(fw.config_cipher(key, iv));
+
+        if (batch) {
+            HELPER_EXPECT_SUCCESS(fw.write((void*)data.data(), data.length(), NULL));
+        } else {
+            for (int i = 0; i < (int)data.length(); i += SRS_TS_PACKET_SIZE) {
+                HELPER_EXPECT_SUCCESS(fw.write((void*)(data.data() + i), SRS_TS_PACKET_SIZE, NULL));
+            }
+        }
+        fw.close();
+    }
+
+    std::string ciphers[2];
+    for (int i = 0; i < 2; i++) {
+        SrsFileReader fr;
+        HELPER_ASSERT_SUCCESS(fr.open(files[i]));
+
+        int size = (int)fr.filesize();
+        EXPECT_EQ((int)data.length() / 16 * 16 + 16, size);
+
+        ciphers[i].resize(size);
+        HELPER_EXPECT_SUCCESS(fr.read(&ciphers[i][0], size, NULL));
+        ::unlink(files[i].c_str());
+    }
+    EXPECT_TRUE(ciphers[0] == ciphers[1]);
+
+    // Decrypt by AES-128-CBC with PKCS7 padding, should be the same as plaintext.
+    if (true) {
+        EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+        EXPECT_EQ(1, EVP_DecryptInit_ex(ctx, EVP_aes_128_cbc(), NULL, key, iv));
+
+        std::string plaintext(ciphers[0].length() + 16, 0);
+        int nn = 0, nn_final = 0;
+        EXPECT_EQ(1, EVP_DecryptUpdate(ctx, (unsigned char*)&plaintext[0], &nn, (unsigned char*)ciphers[0].data(), (int)ciphers[0].length()));
+        EXPECT_EQ(1, EVP_DecryptFinal_ex(ctx, (unsigned char*)&plaintext[nn], &nn_final));
+        EVP_CIPHER_CTX_free(ctx);
+
+        plaintext.resize(nn + nn_final);
+        EXPECT_TRUE(plaintext == data);
+    }
+}
+
+VOID TEST(KernelTSTest, BenchmarkEncrypt)
+{
+    srs_error_t err;
+
+    unsigned char key[16], iv[16];
+    memset(key, 0x10, sizeof(key)); memset(iv, 0x20, sizeof(iv));
+
+    SrsEncFileWriter fw;
+    HELPER_ASSERT_SUCCESS(fw.open("/dev/null"));
+    HELPER_ASSERT_SUCCESS(fw.config_cipher(key, iv));
+
+    // Encrypt 32MB TS packets on this core, about 20KB each write, like the muxer writes a frame.
+    std::string frame(SRS_TS_PACKET_SIZE * 109, 'x');
+    int64_t nn_bytes = 0;
+    srs_utime_t starttime = srs_update_system_time();
+    for (int i = 0; i < 1600; i++) {
+        HELPER_EXPECT_SUCCESS(fw.write((void*)frame.data(), frame.length(), NULL));
+        nn_bytes += frame.length();
+    }
+    srs_utime_t elapsed = srs_max(1, srs_update_system_time() - starttime);
+    fw.close();
+
+    printf("TS encrypt: %d MB in %dms, %.1f MB/s per core\n", (int)(nn_bytes / 1024 / 1024), srsu2msi(elapsed),
+        nn_bytes / 1024.0 / 1024 * SRS_UTIME_SECONDS / elapsed);
+}
+
+VOID TEST(KernelTSTest, BenchmarkMuxer)
+{
+    srs_error_t err;
+
+    SrsTsContext ctx;
+    MockTsCountWriter w;
+
+    SrsTsMessage m;
+    m.sid = SrsTsPESStreamIdVideoCommon;
+    std::string frame(20 * 1024, 'x');
+    m.payload->append(frame.data(), (int)frame.length());
+
+    // Mux 32MB frames on this core, to a writer without copy.
+    int64_t nn_bytes = 0;
+    srs_utime_t starttime = srs_update_system_time();
+    for (int i = 0; i < 1600; i++) {
+        m.dts = i * 3600; m.pts = m.dts + 3600;
+        HELPER_EXPECT_SUCCESS(ctx.encode(&w, &m, SrsVideoCodecIdAVC, SrsAudioCodecIdAAC));
+        nn_bytes += m.payload->length();
+        w.data.clear();
+    }
+    srs_utime_t elapsed = srs_max(1, srs_update_system_time() - starttime);
+
+    // The PAT and PMT, then one write for each frame.
+    EXPECT_EQ(2 + 1600, w.nn_writes);
+    printf("TS muxer: %d MB in %dms, %.1f MB/s per core\n", (int)(nn_bytes / 1024 / 1024), srsu2msi(elapsed),
+        nn_bytes / 1024.0 / 1024 * SRS_UTIME_SECONDS / elapsed);
+}
+
 VOID TEST(KernelMP4Test, CoverMP4All)
 {
 	if (true) {
@@ -6357,6 +6734,164 @@ VOID TEST(KernelMP4Test, CoverMP4M2tsSegmentEncoder)
     HELPER_EXPECT_SUCCESS(enc.flush(dts));
 }
 
+VOID TEST(KernelMP4Test, M2tsSegmentEncoderChunks)
+{
+    srs_error_t err;
+
+    SrsMp4M2tsSegmentEncoder enc;
+    MockSrsFileWriter f;
+    HELPER_EXPECT_SUCCESS(enc.initialize(&f, 0, 0, 1));
+
+    uint8_t sample[] = {0x00, 0x00, 0x00, 0x02, 0x09, 0xf0};
+    HELPER_EXPECT_SUCCESS(enc.write_sample(SrsMp4HandlerTypeVIDE, SrsVideoAvcFrameTypeKeyFrame, 0, 0, sample, sizeof(sample)));
+    HELPER_EXPECT_SUCCESS(enc.write_chunk(40));
+    HELPER_EXPECT_SUCCESS(enc.write_sample(SrsMp4HandlerTypeVIDE, SrsVideoAvcFrameTypeInterFrame, 40, 40, sample, sizeof(sample)));
+    HELPER_EXPECT_SUCCESS(enc.write_sample(SrsMp4HandlerTypeVIDE, SrsVideoAvcFrameTypeInterFrame, 80, 80, sample, sizeof(sample)));
+
+    uint64_t dts = 120;
+    HELPER_EXPECT_SUCCESS(enc.flush(dts));
+
+    // Each chunk is a moof and mdat, without sidx.
+    string boxes;
+    SrsBuffer b((char*)f.data(), (int)f.filesize());
+    while (b.require(8)) {
+        int size = b.read_4bytes();
+        boxes += b.read_string(4) + ",";
+        b.skip(size - 8);
+    }
+    EXPECT_STREQ("styp,moof,mdat,moof,mdat,", boxes.c_str());
+}
+
+VOID TEST(KernelMP4Test, CoverMP4FragmentAndFinalize)
+{
+    srs_error_t err;
+
+    MockSrsFileWriter f, idx;
+
+    // Encode fMP4 with 1s fragment, with 2s audio and video, keyframe every 1s.
+    if (true) {
+        SrsMp4Encoder enc; SrsFormat fmt;
+        HELPER_EXPECT_SUCCESS(enc.initialize(&f, 1 * SRS_UTIME_SECONDS, &idx));
+        HELPER_EXPECT_SUCCESS(fmt.initialize());
+
+        if (true) {
+            uint8_t raw[] = {
+                0x17, 0x00, 0x00, 0x00, 0x00, 0x01, 0x64, 0x00, 0x20, 0xff, 0xe1, 0x00, 0x19, 0x67, 0x64, 0x00, 0x20, 0xac, 0xd9, 0x40, 0xc0, 0x29, 0xb0, 0x11, 0x00, 0x00, 0x03, 0x00, 0x01, 0x00, 0x00, 0x03, 0x00, 0x32, 0x0f, 0x18, 0x31, 0x96, 0x01, 0x00, 0x05, 0x68, 0xeb, 0xec, 0xb2, 0x2c
+            };
+            HELPER_EXPECT_SUCCESS(fmt.on_video(0, (char*)raw, sizeof(raw)));
+            HELPER_EXPECT_SUCCESS(enc.write_sample(
+                &fmt, SrsMp4HandlerTypeVIDE, fmt.video->frame_type, fmt.video->avc_packet_type, 0, 0, (uint8_t*)fmt.raw, fmt.nb_raw
+            ));
+        }
+
+        if (true) {
+            uint8_t raw[] = {
+                0xaf, 0x00, 0x12, 0x10
+            };
+            HELPER_EXPECT_SUCCESS(fmt.on_audio(0, (char*)raw, sizeof(raw)));
+            HELPER_EXPECT_SUCCESS(enc.write_sample(
+                &fmt, SrsMp4HandlerTypeSOUN, 0x00, fmt.audio->aac_packet_type, 0, 0, (uint8_t*)fmt.raw, fmt.nb_raw
+            ));
+        }
+
+        enc.acodec = SrsAudioCodecIdAAC;
+        enc.vcodec = SrsVideoCodecIdAVC;
+
+        for (int i = 0; i < 50; i++) {
+            uint8_t data[8];
+            memset(data, i, sizeof(data));
+
+            uint16_t ft = (i % 25 == 0)? SrsVideoAvcFrameTypeKeyFrame : SrsVideoAvcFrameTypeInterFrame;
+            HELPER_EXPECT_SUCCESS(enc.write_sample(
+                &fmt, SrsMp4HandlerTypeVIDE, ft, SrsVideoAvcFrameTraitNALU, i * 40, i * 40 + 80, data, sizeof(data)
+            ));
+            HELPER_EXPECT_SUCCESS(enc.write_sample(
+                &fmt, SrsMp4HandlerTypeSOUN, 0x00, SrsAudioAacFrameTraitRawData, i * 40, i * 40, data, 4
+            ));
+
+            // The samples of fragment are cached in memory, never grow.
+            EXPECT_LE((int)enc.samples->samples.size(), 50);
+        }
+
+        HELPER_EXPECT_SUCCESS(enc.flush());
+    }
+
+    // The fMP4 is ftyp, moov, then moof and mdat for each track of each fragment.
+    if (true) {
+        SrsMp4BoxReader br; MockSrsFileReader fr((const char*)f.data(), f.filesize());
+        HELPER_EXPECT_SUCCESS(br.initialize(&fr));
+
+        SrsSimpleStream stream;
+        std::vector<SrsMp4BoxType> types;
+        for (;;) {
+            SrsMp4Box* box = NULL;
+            srs_error_t err = br.read(&stream, &box);
+            if (err != srs_success) {
+                srs_freep(err);
+                break;
+            }
+
+            types.push_back(box->type);
+            HELPER_EXPECT_SUCCESS(br.skip(box, &stream));
+            srs_freep(box);
+        }
+
+        ASSERT_EQ(10, (int)types.size());
+        EXPECT_EQ(SrsMp4BoxTypeFTYP, types[0]);
+        EXPECT_EQ(SrsMp4BoxTypeMOOV, types[1]);
+        EXPECT_EQ(SrsMp4BoxTypeMOOF, types[2]);
+        EXPECT_EQ(SrsMp4BoxTypeMDAT, types[3]);
+        EXPECT_EQ(SrsMp4BoxTypeMOOF, types[8]);
+        EXPECT_EQ(SrsMp4BoxTypeMDAT, types[9]);
+    }
+
+    // Finalize to classic MP4 by sample index.
+    EXPECT_EQ(100 * SRS_MP4_INDEX_ENTRY_SIZE, (int)idx.filesize());
+
+    MockSrsFileWriter out;
+    if (true) {
+        MockSrsFileReader fr((const char*)f.data(), f.filesize());
+        MockSrsFileReader ir((const char*)idx.data(), idx.filesize());
+
+        SrsMp4Finalizer finalizer;
+        HELPER_EXPECT_SUCCESS(finalizer.finalize(&fr, &ir, &out));
+    }
+
+    // The classic MP4 should contain all samples.
+    if (true) {
+        MockSrsFileReader fr((const char*)out.data(), out.filesize());
+        SrsMp4Decoder dec; HELPER_EXPECT_SUCCESS(dec.initialize(&fr));
+
+        SrsMp4HandlerType ht; uint16_t ft, ct; uint32_t dts, pts, nb_sample; uint8_t* sample = NULL;
+
+        // Sequence header.
+        HELPER_EXPECT_SUCCESS(dec.read_sample(&ht, &ft, &ct, &dts, &pts, &sample, &nb_sample));
+        EXPECT_EQ(SrsMp4HandlerTypeVIDE, ht); EXPECT_EQ(SrsVideoAvcFrameTraitSequenceHeader, ct);
+        srs_freepa(sample);
+
+        HELPER_EXPECT_SUCCESS(dec.read_sample(&ht, &ft, &ct, &dts, &pts, &sample, &nb_sample));
+        EXPECT_EQ(SrsMp4HandlerTypeSOUN, ht); EXPECT_EQ(SrsAudioAacFrameTraitSequenceHeader, ct);
+        srs_freepa(sample);
+
+        int nn_videos = 0, nn_audios = 0;
+        for (int i = 0; i < 100; i++) {
+            HELPER_ASSERT_SUCCESS(dec.read_sample(&ht, &ft, &ct, &dts, &pts, &sample, &nb_sample));
+            EXPECT_EQ((int)dts / 40, (int)sample[0]);
+
+            if (ht == SrsMp4HandlerTypeVIDE) {
+                nn_videos++;
+                EXPECT_EQ(8, (int)nb_sample); EXPECT_EQ(dts + 80, pts);
+                EXPECT_EQ((sample[0] % 25 == 0)? SrsVideoAvcFrameTypeKeyFrame : SrsVideoAvcFrameTypeInterFrame, ft);
+            } else {
+                nn_audios++;
+                EXPECT_EQ(4, (int)nb_sample);
+            }
+            srs_freepa(sample);
+        }
+        EXPECT_EQ(50, nn_videos); EXPECT_EQ(50, nn_audios);
+    }
+}
+
 VOID TEST(KernelUtilityTest, CoverStringAssign)
 {
     string sps = "SRS";
@@ -582,6 +582,172 @@ VOID TEST(ProtocolHandshakeTest, BytesEqual)
     EXPECT_FALSE(srs_bytes_equals(a1, b2, 1));
 }
 
+// Restore the global rotation of DH key pair, which is changed by test.
+class MockDHRotationRestorer
+{
+private:
+    srs_utime_t rotation_;
+public:
+    MockDHRotationRestorer() {
+        rotation_ = srs_internal::srs_dh_rotation();
+    }
+    virtual ~MockDHRotationRestorer() {
+        srs_internal::srs_dh_set_rotation(rotation_);
+    }
+};
+
+VOID TEST(ProtocolHandshakeTest, DHKeyRotation)
+{
+    srs_error_t err = srs_success;
+
+    MockDHRotationRestorer restorer;
+
+    char pub_key1[128], pub_key2[128];
+    int pkey_size = 128;
+
+    // Generate key pair for each handshake.
+    if (true) {
+        srs_internal::srs_dh_set_rotation(0);
+
+        srs_internal::SrsDH* dh = NULL;
+        HELPER_ASSERT_SUCCESS(srs_internal::srs_dh_fetch(&dh));
+        HELPER_EXPECT_SUCCESS(dh->copy_public_key(pub_key1, pkey_size));
+
+        HELPER_ASSERT_SUCCESS(srs_internal::srs_dh_fetch(&dh));
+        HELPER_EXPECT_SUCCESS(dh->copy_public_key(pub_key2, pkey_size));
+        EXPECT_FALSE(srs_bytes_equals(pub_key1, pub_key2, 128));
+    }
+
+    // Reuse the key pair in rotation period.
+    if (true) {
+        srs_internal::srs_dh_set_rotation(60 * SRS_UTIME_SECONDS);
+
+        srs_internal::SrsDH* dh = NULL;
+        HELPER_ASSERT_SUCCESS(srs_internal::srs_dh_fetch(&dh));
+        HELPER_EXPECT_SUCCESS(dh->copy_public_key(pub_key1, pkey_size));
+
+        srs_internal::SrsDH* dh2 = NULL;
+        HELPER_ASSERT_SUCCESS(srs_internal::srs_dh_fetch(&dh2));
+        HELPER_EXPECT_SUCCESS(dh2->copy_public_key(pub_key2, pkey_size));
+        EXPECT_TRUE(dh == dh2);
+        EXPECT_TRUE(srs_bytes_equals(pub_key1, pub_key2, 128));
+    }
+}
+
+// The executor which creates s0s1s2 in current thread, and counts the tasks.
+class MockHandshakeExecutor : public ISrsHandshakeExecutor
+{
+public:
+    int nn_tasks_;
+public:
+    MockHandshakeExecutor() {
+        nn_tasks_ = 0;
+    }
+    virtual ~MockHandshakeExecutor() {
+    }
+public:
+    virtual srs_error_t execute(SrsHandshakeBytes* hs_bytes) {
+        nn_tasks_++;
+        return SrsComplexHandshake::create_s0s1s2(hs_bytes);
+    }
+};
+
+// Create a c0c1 signed by client, which is able to do complex handshake.
+void mock_complex_c0c1(char* c0c1)
+{
+    srs_error_t err = srs_success;
+
+    c0c1[0] = 0x03;
+
+    c1s1 c1;
+    HELPER_EXPECT_SUCCESS(c1.c1_create(srs_schema1));
+    HELPER_EXPECT_SUCCESS(c1.dump(c0c1 + 1, 1536));
+}
+
+VOID TEST(ProtocolHandshakeTest, ComplexHandshakeExecutor)
+{
+    srs_error_t err = srs_success;
+
+    char c0c1[1537], c2[1536];
+    mock_complex_c0c1(c0c1);
+    memset(c2, 0x0f, sizeof(c2));
+
+    MockBufferIO io;
+    io.append((uint8_t*)c0c1, sizeof(c0c1));
+    io.append((uint8_t*)c2, sizeof(c2));
+
+    MockHandshakeExecutor executor;
+    SrsRtmpServer r(&io);
+    r.set_handshake_executor(&executor);
+    HELPER_EXPECT_SUCCESS(r.handshake());
+    EXPECT_EQ(1, executor.nn_tasks_);
+
+    // The s1 created by executor should be valid for client.
+    if (true) {
+        c1s1 c1;
+        HELPER_ASSERT_SUCCESS(c1.parse(c0c1 + 1, 1536, srs_schema1));
+
+        c1s1 s1;
+        HELPER_ASSERT_SUCCESS(s1.parse((char*)io.out_buffer.bytes() + 1, 1536, c1.schema()));
+
+        bool is_valid = false;
+        HELPER_EXPECT_SUCCESS(s1.s1_validate_digest(is_valid));
+        EXPECT_TRUE(is_valid);
+    }
+}
+
+VOID TEST(ProtocolHandshakeTest, BenchmarkHandshake)
+{
+    srs_error_t err = srs_success;
+
+    char c0c1[1537], c2[1536];
+    mock_complex_c0c1(c0c1);
+    memset(c2, 0x0f, sizeof(c2));
+
+    // The simple handshake, without any crypto.
+    if (true) {
+        int nn = 2000;
+        srs_utime_t starttime = srs_update_system_time();
+        for (int i = 0; i < nn; i++) {
+            MockBufferIO io;
+            io.append((uint8_t*)c0c1, sizeof(c0c1));
+            io.append((uint8_t*)c2, sizeof(c2));
+
+            SrsHandshakeBytes bytes;
+            SrsSimpleHandshake hs;
+            HELPER_EXPECT_SUCCESS(hs.handshake_with_client(&bytes, &io));
+        }
+        srs_utime_t elapsed = srs_max(1, srs_update_system_time() - starttime);
+
+        printf("Simple handshake: %d in %dms, %.0f handshakes/s per core\n", nn, srsu2msi(elapsed),
+            nn * 1.0 * SRS_UTIME_SECONDS / elapsed);
+    }
+
+    // The complex handshake, with DH key pair generated for each handshake, or cached in rotation period.
+    for (int k = 0; k < 2; k++) {
+        srs_utime_t rotation = k ? 60 * SRS_UTIME_SECONDS : 0;
+        srs_internal::srs_dh_set_rotation(rotation);
+
+        int nn = 200;
+        srs_utime_t starttime = srs_update_system_time();
+        for (int i = 0; i < nn; i++) {
+            MockBufferIO io;
+            io.append((uint8_t*)c0c1, sizeof(c0c1));
+            io.append((uint8_t*)c2, sizeof(c2));
+
+            SrsHandshakeBytes bytes;
+            SrsComplexHandshake hs;
+            HELPER_EXPECT_SUCCESS(hs.handshake_with_client(&bytes, &io));
+        }
+        srs_utime_t elapsed = srs_max(1, srs_update_system_time() - starttime);
+
+        printf("Complex handshake(key rotation=%ds): %d in %dms, %.0f handshakes/s per core\n", srsu2msi(rotation) / 1000,
+            nn, srsu2msi(elapsed), nn * 1.0 * SRS_UTIME_SECONDS / elapsed);
+    }
+
+    srs_internal::srs_dh_set_rotation(0);
+}
+
 /**
 * generate tcUrl from ip/vhost/app/port
 */
@@ -2048,6 +2214,161 @@ VOID TEST(ProtocolStackTest, ProtocolRecvVAVFmt3)
     }
 }
 
+/**
+* a video message in a run of fmt=3 chunks, interlaced by an audio message.
+*/
+VOID TEST(ProtocolStackTest, ProtocolRecvVChunksRun)
+{
+    srs_error_t err = srs_success;
+
+    MockBufferIO bio;
+    SrsProtocol proto(&bio);
+
+    // video message in 4 chunks, 128+128+128+16 bytes.
+    uint8_t vh[] = {
+        0x06, // fmt=0, cid=6
+        0x00, 0x00, 0x10, // timestamp
+        0x00, 0x01, 0x90, // length, 400
+        0x09, // message_type
+        0x01, 0x00, 0x00, 0x00, // stream_id
+    };
+    uint8_t ah[] = {
+        0x04, // fmt=0, cid=4
+        0x00, 0x00, 0x15, // timestamp
+        0x00, 0x00, 0x04, // length
+        0x08, // message_type
+        0x01, 0x00, 0x00, 0x00, // stream_id
+        0xaf, 0x01, 0x02, 0x03, // payload
+    };
+    uint8_t fmt3 = 0xc6;
+
+    string payload;
+    for (int i = 0; i < 400; i++) {
+        payload.append(1, (char)i);
+    }
+
+    // The first chunk and the run of 2 chunks, then audio interlaced, then the last chunk.
+    bio.in_buffer.append((char*)vh, sizeof(vh));
+    bio.in_buffer.append(payload.data(), 128);
+    bio.in_buffer.append((char*)&fmt3, 1);
+    bio.in_buffer.append(payload.data() + 128, 128);
+    bio.in_buffer.append((char*)&fmt3, 1);
+    bio.in_buffer.append(payload.data() + 256, 128);
+    bio.in_buffer.append((char*)ah, sizeof(ah));
+    bio.in_buffer.append((char*)&fmt3, 1);
+    bio.in_buffer.append(payload.data() + 384, 16);
+
+    if (true) {
+        SrsCommonMessage* msg = NULL;
+        HELPER_ASSERT_SUCCESS(proto.recv_message(&msg));
+        SrsUniquePtr<SrsCommonMessage> msg_uptr(msg);
+        EXPECT_TRUE(msg->header.is_audio());
+        EXPECT_EQ(0x15, msg->header.timestamp);
+        EXPECT_EQ(4, msg->size);
+    }
+
+    if (true) {
+        SrsCommonMessage* msg = NULL;
+        HELPER_ASSERT_SUCCESS(proto.recv_message(&msg));
+        SrsUniquePtr<SrsCommonMessage> msg_uptr(msg);
+        EXPECT_TRUE(msg->header.is_video());
+        EXPECT_EQ(0x10, msg->header.timestamp);
+        EXPECT_EQ(0x01, msg->header.stream_id);
+        ASSERT_EQ(400, msg->size);
+        EXPECT_TRUE(srs_bytes_equals(msg->payload, (void*)payload.data(), 400));
+    }
+}
+
+// The IO to replay the captured RTMP stream, without erasing the buffer.
+class MockRtmpReplayIO : public MockBufferIO
+{
+public:
+    string data_;
+    size_t pos_;
+public:
+    MockRtmpReplayIO() {
+        pos_ = 0;
+    }
+    virtual ~MockRtmpReplayIO() {
+    }
+public:
+    virtual srs_error_t read(void* buf, size_t size, ssize_t* nread) {
+        if (pos_ >= data_.length()) {
+            return srs_error_new(ERROR_SOCKET_READ, "read");
+        }
+
+        size_t available = srs_min(data_.length() - pos_, size);
+        memcpy(buf, data_.data() + pos_, available);
+        pos_ += available;
+
+        if (nread) {
+            *nread = available;
+        }
+        return srs_success;
+    }
+};
+
+/**
+* Replay a 4K HEVC stream in 128 bytes chunks, about 20Mbps.
+*/
+VOID TEST(ProtocolStackTest, BenchmarkRecvMessage)
+{
+    srs_error_t err = srs_success;
+
+    // Capture the stream of 1s, 30 video frames of 80KB and 50 audio frames.
+    int nn_frames = 30;
+    string stream;
+    if (true) {
+        MockBufferIO bio;
+        SrsProtocol proto(&bio);
+
+        for (int i = 0; i < nn_frames; i++) {
+            for (int j = 0; j < 2; j++) {
+                bool video = j == 0;
+                SrsCommonMessage* msg = new SrsCommonMessage();
+                int size = video ? 80 * 1024 : 400;
+                if (video) {
+                    msg->header.initialize_video(size, i * 33, 1);
+                } else {
+                    msg->header.initialize_audio(size, i * 33, 1);
+                }
+                msg->size = size;
+                msg->payload = new char[msg->size];
+                memset(msg->payload, i, msg->size);
+
+                SrsSharedPtrMessage* shared = new SrsSharedPtrMessage();
+                HELPER_EXPECT_SUCCESS(shared->create(msg));
+                srs_freep(msg);
+
+                HELPER_EXPECT_SUCCESS(proto.send_and_free_message(shared, 1));
+            }
+        }
+
+        stream.assign(bio.out_buffer.bytes(), bio.out_buffer.length());
+    }
+
+    // Replay the stream for 10s.
+    int nn_rounds = 10;
+    int64_t nn_bytes = 0;
+    srs_utime_t starttime = srs_update_system_time();
+    for (int k = 0; k < nn_rounds; k++) {
+        MockRtmpReplayIO io;
+        io.data_ = stream;
+        SrsProtocol proto(&io);
+
+        for (int i = 0; i < nn_frames * 2; i++) {
+            SrsCommonMessage* msg = NULL;
+            HELPER_ASSERT_SUCCESS(proto.recv_message(&msg));
+            nn_bytes += msg->size;
+            srs_freep(msg);
+        }
+    }
+    srs_utime_t elapsed = srs_max(1, srs_update_system_time() - starttime);
+
+    printf("RTMP recv: %d MB in %dms, %.1f MB/s per core\n", (int)(nn_bytes / 1024 / 1024), srsu2msi(elapsed),
+        nn_bytes / 1024.0 / 1024 * SRS_UTIME_SECONDS / elapsed);
+}
+
 /**
 * a video message, in 2 chunks packet.
 * use 1B chunk header, cid in 2-63
@@ -12,10 +12,17 @@
 #include <srs_kernel_rtc_rtp.hpp>
 #include <srs_app_rtc_source.hpp>
 #include <srs_app_rtc_conn.hpp>
+#include <srs_app_rtc_sdp.hpp>
+#include <srs_app_rtc_bwe.hpp>
+#include <srs_app_rtc_fec.hpp>
+#ifdef SRS_FFMPEG_FIT
+#include <srs_app_rtc_codec.hpp>
+#endif
 #include <srs_kernel_codec.hpp>
 #include <srs_app_conn.hpp>
 
 #include <srs_utest_service.hpp>
+#include <srs_utest_config.hpp>
 
 #include <vector>
 using namespace std;
@@ -1323,13 +1330,13 @@ VOID TEST(KernelRTCTest, JitterSequence)
     SrsRtcSeqJitter jitter(100);
 
     // Starts from the base.
-    EXPECT_EQ((uint32_t)100, jitter.correct(0));
+    EXPECT_EQ((uint16_t)100, jitter.correct(0));
 
     // Normal without jitter.
-    EXPECT_EQ((uint32_t)101, jitter.correct(1));
-    EXPECT_EQ((uint32_t)102, jitter.correct(2));
-    EXPECT_EQ((uint32_t)101, jitter.correct(1));
-    EXPECT_EQ((uint32_t)103, jitter.correct(3));
+    EXPECT_EQ((uint16_t)101, jitter.correct(1));
+    EXPECT_EQ((uint16_t)102, jitter.correct(2));
+    EXPECT_EQ((uint16_t)101, jitter.correct(1));
+    EXPECT_EQ((uint16_t)103, jitter.correct(3));
     EXPECT_EQ((uint32_t)110, jitter.correct(10));
 
     // Reset the base for jitter detected.
@@ -1365,3 +1372,689 @@ VOID TEST(KernelRTCTest, JitterSequence)
     EXPECT_EQ((uint32_t)11, jitter.correct(11));
 }
 
+VOID TEST(KernelRTCTest, SimulcastSdp)
+{
+    srs_error_t err;
+
+    if (true) {
+        SrsMediaDesc m("video");
+        HELPER_EXPECT_SUCCESS(m.parse_line("a=rid:h send pt=96;max-width=1280"));
+        HELPER_EXPECT_SUCCESS(m.parse_line("a=rid:l send"));
+        HELPER_EXPECT_SUCCESS(m.parse_line("a=simulcast:send h,hh;~l"));
+
+        ASSERT_EQ(2, (int)m.rids_.size());
+        EXPECT_STREQ("h", m.rids_.at(0).rid_.c_str());
+        EXPECT_STREQ("send", m.rids_.at(0).direction_.c_str());
+        EXPECT_STREQ("pt=96;max-width=1280", m.rids_.at(0).params_.c_str());
+        EXPECT_STREQ("l", m.rids_.at(1).rid_.c_str());
+
+        EXPECT_STREQ("send", m.simulcast_direction_.c_str());
+        ASSERT_EQ(2, (int)m.simulcast_rids_.size());
+        EXPECT_STREQ("h", m.simulcast_rids_.at(0).c_str());
+        EXPECT_STREQ("l", m.simulcast_rids_.at(1).c_str());
+    }
+
+    if (true) {
+        SrsMediaDesc m("video");
+        HELPER_EXPECT_FAILED(m.parse_line("a=rid:h sendrecv"));
+        HELPER_EXPECT_FAILED(m.parse_line("a=simulcast:inactive h;l"));
+    }
+
+    if (true) {
+        SrsMediaDesc m("video");
+        m.rids_.push_back(SrsRidInfo("h", "recv"));
+        m.rids_.push_back(SrsRidInfo("l", "recv"));
+        m.simulcast_direction_ = "recv";
+        m.simulcast_rids_.push_back("h");
+        m.simulcast_rids_.push_back("l");
+
+        std::ostringstream os;
+        HELPER_EXPECT_SUCCESS(m.encode(os));
+        EXPECT_TRUE(os.str().find("a=rid:h recv\r\na=rid:l recv\r\na=simulcast:recv h;l\r\n") != string::npos);
+    }
+}
+
+VOID TEST(KernelRTCTest, SimulcastRid)
+{
+    srs_error_t err;
+
+    // RTP header with one-byte extension, id=3, rid="hq".
+    uint8_t data[] = {
+        0x90, 0x60, 0x00, 0x01, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0x0a,
+        0xbe, 0xde, 0x00, 0x01, 0x31, 'h', 'q', 0x00,
+    };
+
+    if (true) {
+        string rid;
+        HELPER_EXPECT_SUCCESS(srs_rtp_fast_parse_rid((char*)data, sizeof(data), 3, rid));
+        EXPECT_STREQ("hq", rid.c_str());
+    }
+
+    if (true) {
+        string rid;
+        HELPER_EXPECT_FAILED(srs_rtp_fast_parse_rid((char*)data, sizeof(data), 4, rid));
+        HELPER_EXPECT_FAILED(srs_rtp_fast_parse_rid((char*)data, 18, 3, rid));
+    }
+
+    // The jitter continues from the last value when rebase, for switching layer.
+    if (true) {
+        SrsRtcSeqJitter jitter(100);
+        EXPECT_EQ((uint16_t)100, jitter.correct(1000));
+        EXPECT_EQ((uint16_t)101, jitter.correct(1001));
+
+        jitter.rebase(1);
+        EXPECT_EQ((uint16_t)102, jitter.correct(30000));
+        EXPECT_EQ((uint16_t)103, jitter.correct(30001));
+    }
+
+    if (true) {
+        SrsRtcTsJitter jitter(1000);
+        EXPECT_EQ((uint32_t)1000, jitter.correct(90000));
+        EXPECT_EQ((uint32_t)4000, jitter.correct(93000));
+
+        jitter.rebase(3000);
+        EXPECT_EQ((uint32_t)7000, jitter.correct(500));
+        EXPECT_EQ((uint32_t)10000, jitter.correct(3500));
+    }
+}
+
+VOID TEST(KernelRTCTest, SimulcastLayerSelector)
+{
+    std::vector<SrsRtcTrackEncoding> encodings;
+    encodings.push_back(SrsRtcTrackEncoding("h", 100));
+    encodings.push_back(SrsRtcTrackEncoding("m", 200));
+    encodings.push_back(SrsRtcTrackEncoding("l", 0));
+
+    SrsRtcLayerSelector s;
+    s.set_encodings(encodings);
+    EXPECT_TRUE(s.has_layer(100));
+    EXPECT_TRUE(s.has_layer(200));
+    EXPECT_FALSE(s.has_layer(0));
+    EXPECT_FALSE(s.has_layer(300));
+
+    // Start from the first layer, request keyframe once.
+    EXPECT_EQ((uint32_t)0, s.current_ssrc());
+    EXPECT_EQ((uint32_t)100, s.target_ssrc());
+    EXPECT_EQ((uint32_t)100, s.fetch_keyframe_request());
+    EXPECT_EQ((uint32_t)0, s.fetch_keyframe_request());
+
+    // Only switch at keyframe of target layer.
+    bool switched = false;
+    EXPECT_FALSE(s.on_packet(100, 1000, false, switched));
+    EXPECT_FALSE(switched);
+    EXPECT_FALSE(s.on_packet(200, 500, true, switched));
+    EXPECT_FALSE(switched);
+    EXPECT_TRUE(s.on_packet(100, 1000, true, switched));
+    EXPECT_TRUE(switched);
+    EXPECT_TRUE(s.on_packet(100, 1000, false, switched));
+    EXPECT_FALSE(switched);
+    EXPECT_FALSE(s.on_packet(200, 500, false, switched));
+    EXPECT_EQ((uint32_t)100, s.current_ssrc());
+
+    // Step down to the lower bitrate layer for loss.
+    s.kbps_.at(0) = 2000;
+    s.kbps_.at(1) = 500;
+    s.switch_at_ = 0;
+    s.on_feedback(0.3);
+    EXPECT_EQ((uint32_t)200, s.target_ssrc());
+    EXPECT_EQ((uint32_t)200, s.fetch_keyframe_request());
+    EXPECT_TRUE(s.on_packet(100, 1000, false, switched));
+    EXPECT_TRUE(s.on_packet(200, 500, true, switched));
+    EXPECT_TRUE(switched);
+    EXPECT_EQ((uint32_t)200, s.current_ssrc());
+
+    // Step up after some good feedback.
+    s.switch_at_ = 0;
+    for (int i = 0; i < 4; i++) {
+        s.on_feedback(0);
+    }
+    EXPECT_EQ((uint32_t)0, s.target_ssrc());
+    s.on_feedback(0);
+    EXPECT_EQ((uint32_t)100, s.target_ssrc());
+
+    // Keep the layer when SSRC of other layer learned.
+    encodings.at(2).ssrc_ = 300;
+    s.set_encodings(encodings);
+    EXPECT_EQ((uint32_t)200, s.current_ssrc());
+    EXPECT_EQ((uint32_t)100, s.target_ssrc());
+    EXPECT_TRUE(s.has_layer(300));
+}
+
+VOID TEST(KernelRTCTest, TWCCFeedbackDecode)
+{
+    srs_error_t err;
+
+    // Packet 102 is lost, and 104 arrives with large delta.
+    SrsRtcpTWCC twcc(0x1234);
+    twcc.set_media_ssrc(0x5678);
+    twcc.set_feedback_count(7);
+    srs_utime_t base = 10 * kTwccFbTimeMultiplier;
+    HELPER_EXPECT_SUCCESS(twcc.recv_packet(100, base + 500));
+    HELPER_EXPECT_SUCCESS(twcc.recv_packet(101, base + 1500));
+    HELPER_EXPECT_SUCCESS(twcc.recv_packet(103, base + 3500));
+    HELPER_EXPECT_SUCCESS(twcc.recv_packet(104, base + 103500));
+
+    char buf[kRtcpPacketSize];
+    SrsBuffer b(buf, sizeof(buf));
+    HELPER_EXPECT_SUCCESS(twcc.encode(&b));
+
+    SrsRtcpTWCC feedback;
+    SrsBuffer b2(buf, b.pos());
+    HELPER_EXPECT_SUCCESS(feedback.decode(&b2));
+    EXPECT_EQ(100, feedback.get_base_sn());
+    EXPECT_EQ(7, feedback.get_feedback_count());
+
+    const vector<SrsRtcpTWCCStatus>& statuses = feedback.get_packet_status();
+    ASSERT_EQ(5, (int)statuses.size());
+    EXPECT_EQ(100, statuses[0].sn);
+    EXPECT_TRUE(statuses[0].received);
+    EXPECT_EQ(base + 500, statuses[0].arrival);
+    EXPECT_TRUE(statuses[1].received);
+    EXPECT_EQ(1000, statuses[1].arrival - statuses[0].arrival);
+    EXPECT_EQ(102, statuses[2].sn);
+    EXPECT_FALSE(statuses[2].received);
+    EXPECT_TRUE(statuses[3].received);
+    EXPECT_EQ(2000, statuses[3].arrival - statuses[1].arrival);
+    EXPECT_EQ(104, statuses[4].sn);
+    EXPECT_TRUE(statuses[4].received);
+    EXPECT_EQ(100000, statuses[4].arrival - statuses[3].arrival);
+}
+
+// Simulate the feedback for packets, each packet arrives after the delay of network.
+void mock_bwe_feedback(SrsRtcBandwidthEstimator& bwe, uint16_t& sn, srs_utime_t& now, int nn, srs_utime_t interval, srs_utime_t& delay, srs_utime_t delay_inc)
+{
+    vector<SrsRtcpTWCCStatus> statuses;
+    for (int i = 0; i < nn; i++) {
+        bwe.on_packet_sent(sn, 1000, now);
+
+        SrsRtcpTWCCStatus status;
+        status.sn = sn++;
+        status.received = true;
+        status.arrival = now + delay;
+        statuses.push_back(status);
+
+        now += interval;
+        delay += delay_inc;
+    }
+    bwe.on_feedback(statuses, now);
+}
+
+VOID TEST(KernelRTCTest, BandwidthEstimator)
+{
+    // Stable delay, the bitrate increases to about the acked bitrate.
+    if (true) {
+        SrsRtcBandwidthEstimator bwe;
+        uint16_t sn = 65000;
+        srs_utime_t now = 1 * SRS_UTIME_SECONDS, delay = 20 * SRS_UTIME_MILLISECONDS;
+        for (int i = 0; i < 50; i++) {
+            mock_bwe_feedback(bwe, sn, now, 10, 10 * SRS_UTIME_MILLISECONDS, delay, 0);
+        }
+        EXPECT_EQ(SrsRtcBweStateNormal, bwe.state());
+        EXPECT_NEAR(800, bwe.acked_kbps(), 50);
+        EXPECT_EQ(0, bwe.lost_rate());
+        EXPECT_LT(bwe.target_kbps(), SRS_RTC_BWE_START_KBPS * 1.1);
+    }
+
+    // The delay increases, the bitrate decreases below the acked bitrate.
+    if (true) {
+        SrsRtcBandwidthEstimator bwe;
+        uint16_t sn = 0;
+        srs_utime_t now = 1 * SRS_UTIME_SECONDS, delay = 20 * SRS_UTIME_MILLISECONDS;
+        for (int i = 0; i < 10; i++) {
+            mock_bwe_feedback(bwe, sn, now, 10, 10 * SRS_UTIME_MILLISECONDS, delay, 0);
+        }
+        for (int i = 0; i < 20; i++) {
+            mock_bwe_feedback(bwe, sn, now, 10, 10 * SRS_UTIME_MILLISECONDS, delay, 2 * SRS_UTIME_MILLISECONDS);
+        }
+        EXPECT_EQ(SrsRtcBweStateOverusing, bwe.state());
+        EXPECT_LT(bwe.target_kbps(), bwe.acked_kbps());
+    }
+
+    // Heavy loss, the bitrate decreases.
+    if (true) {
+        SrsRtcBandwidthEstimator bwe;
+        srs_utime_t now = 1 * SRS_UTIME_SECONDS;
+        for (int i = 0; i < 8; i++) {
+            vector<SrsRtcpTWCCStatus> statuses;
+            for (int j = 0; j < 100; j++) {
+                uint16_t sn = i * 100 + j;
+                bwe.on_packet_sent(sn, 1000, now);
+
+                SrsRtcpTWCCStatus status;
+                status.sn = sn;
+                status.received = (j % 2) == 0;
+                status.arrival = now + 20 * SRS_UTIME_MILLISECONDS;
+                statuses.push_back(status);
+                now += 5 * SRS_UTIME_MILLISECONDS;
+            }
+            bwe.on_feedback(statuses, now);
+        }
+        EXPECT_NEAR(0.5, bwe.lost_rate(), 0.01);
+        EXPECT_LT(bwe.target_kbps(), SRS_RTC_BWE_START_KBPS / 2);
+    }
+}
+
+class MockRtcPacerHandler : public ISrsRtcPacerHandler
+{
+public:
+    vector<int> sent_;
+public:
+    MockRtcPacerHandler() {
+    }
+    virtual ~MockRtcPacerHandler() {
+    }
+public:
+    virtual srs_error_t on_pacer_send(char* data, int size, int twcc_sn) {
+        sent_.push_back(twcc_sn);
+        return srs_success;
+    }
+};
+
+VOID TEST(KernelRTCTest, RtcPacer)
+{
+    srs_error_t err;
+
+    char data[1000];
+    memset(data, 0, sizeof(data));
+
+    MockRtcPacerHandler h;
+    SrsRtcPacer pacer(&h);
+
+    // 400kbps, 50 bytes per ms, the budget is 1500 bytes for 30ms.
+    pacer.set_target_kbps(160);
+    EXPECT_EQ(400, pacer.rate_kbps());
+
+    // The first two packets consume the budget, the left packets are queued.
+    srs_utime_t now = 1 * SRS_UTIME_SECONDS;
+    for (int i = 0; i < 5; i++) {
+        HELPER_EXPECT_SUCCESS(pacer.send(data, sizeof(data), i, false, now));
+    }
+    EXPECT_EQ(2, (int)h.sent_.size());
+    EXPECT_EQ(3, pacer.size());
+
+    // The prior packet is sent immediately.
+    HELPER_EXPECT_SUCCESS(pacer.send(data, 100, 100, true, now));
+    EXPECT_EQ(3, (int)h.sent_.size());
+    EXPECT_EQ(100, h.sent_.back());
+
+    // Refill budget for 20ms, the debt is 600 bytes, so only one packet is sent.
+    now += 20 * SRS_UTIME_MILLISECONDS;
+    HELPER_EXPECT_SUCCESS(pacer.flush(now));
+    EXPECT_EQ(4, (int)h.sent_.size());
+    EXPECT_EQ(2, h.sent_.back());
+    EXPECT_EQ(2, pacer.size());
+
+    // The packet never waits too long.
+    now += 300 * SRS_UTIME_MILLISECONDS;
+    HELPER_EXPECT_SUCCESS(pacer.flush(now));
+    EXPECT_EQ(6, (int)h.sent_.size());
+    EXPECT_EQ(4, h.sent_.back());
+    EXPECT_EQ(0, pacer.size());
+}
+
+VOID TEST(KernelRTCTest, SimulcastLayerByBandwidth)
+{
+    std::vector<SrsRtcTrackEncoding> encodings;
+    encodings.push_back(SrsRtcTrackEncoding("h", 100));
+    encodings.push_back(SrsRtcTrackEncoding("l", 200));
+
+    SrsRtcLayerSelector s;
+    s.set_encodings(encodings);
+
+    bool switched = false;
+    EXPECT_TRUE(s.on_packet(100, 1000, true, switched));
+    EXPECT_EQ((uint32_t)100, s.current_ssrc());
+
+    // Step down if the layer exceeds the bandwidth.
+    s.kbps_.at(0) = 2000;
+    s.kbps_.at(1) = 300;
+    s.switch_at_ = 0;
+    s.on_bandwidth(2500);
+    EXPECT_EQ((uint32_t)0, s.target_ssrc());
+    s.on_bandwidth(1000);
+    EXPECT_EQ((uint32_t)200, s.target_ssrc());
+    EXPECT_TRUE(s.on_packet(200, 1000, true, switched));
+    EXPECT_TRUE(switched);
+
+    // Step up only if the bandwidth is enough.
+    s.switch_at_ = 0;
+    s.on_bandwidth(2200);
+    EXPECT_EQ((uint32_t)0, s.target_ssrc());
+    s.on_bandwidth(3000);
+    EXPECT_EQ((uint32_t)100, s.target_ssrc());
+}
+
+static SrsRtpPacket* mock_rtp_video_packet(uint16_t sn, uint32_t ts, bool marker, SrsAvcNaluType nalu_type)
+{
+    static char data[] = {0x01, 0x02, 0x03, 0x04};
+
+    SrsRtpPacket* pkt = new SrsRtpPacket();
+    pkt->frame_type = SrsFrameTypeVideo;
+    pkt->nalu_type = nalu_type;
+    pkt->header.set_sequence(sn);
+    pkt->header.set_timestamp(ts);
+    pkt->header.set_marker(marker);
+    pkt->set_avsync_time(ts / 90);
+
+    SrsRtpRawPayload* raw = new SrsRtpRawPayload();
+    raw->payload = data;
+    raw->nn_payload = sizeof(data);
+    pkt->set_payload(raw, SrsRtspPacketPayloadTypeRaw);
+
+    return pkt;
+}
+
+VOID TEST(KernelRTCTest, JitterBufferTimeout)
+{
+    // Wait for the lost packet until timeout.
+    if (true) {
+        SrsRtcJitterBuffer jb;
+        srs_utime_t now = 1 * SRS_UTIME_SECONDS;
+
+        // The packet 101 is lost.
+        uint16_t sns[] = {100, 102, 103};
+        uint32_t tss[] = {0, 3000, 3000};
+        for (int i = 0; i < 3; i++) {
+            SrsRtpPacket* pkt = mock_rtp_video_packet(sns[i], tss[i], i != 1, SrsAvcNaluTypeNonIDR);
+            jb.on_packet(pkt, now);
+            jb.store(pkt);
+        }
+
+        uint16_t end = 0;
+        EXPECT_EQ(-1, jb.find_next_lost_sn(100, 100, end));
+        EXPECT_EQ(100, end);
+        EXPECT_TRUE(jb.check_frame_complete(100, end));
+        EXPECT_EQ(101, jb.find_next_lost_sn(101, 101, end));
+
+        // Not timeout in the initial target delay, which also includes the jitter.
+        EXPECT_GT(jb.target_delay(), 200 * SRS_UTIME_MILLISECONDS);
+        EXPECT_LT(jb.target_delay(), 250 * SRS_UTIME_MILLISECONDS);
+        EXPECT_FALSE(jb.update(101, now));
+        EXPECT_FALSE(jb.update(101, now + 100 * SRS_UTIME_MILLISECONDS));
+        EXPECT_TRUE(jb.update(101, now + 250 * SRS_UTIME_MILLISECONDS));
+        EXPECT_EQ(1, jb.nn_timeout());
+
+        // Wait more for the next lost packet.
+        EXPECT_GT(jb.target_delay(), 250 * SRS_UTIME_MILLISECONDS);
+
+        // Discard the frames in cache.
+        jb.clear();
+        EXPECT_EQ(2, jb.nn_discard());
+        EXPECT_TRUE(jb.at(100) == NULL);
+    }
+
+    // The target delay is adaptive to the recovery delay.
+    if (true) {
+        SrsRtcJitterBuffer jb;
+        srs_utime_t now = 1 * SRS_UTIME_SECONDS;
+
+        uint16_t sn = 100;
+        for (int i = 0; i < 60; i++) {
+            // The frame is 10 packets, the first one is lost and recovered in 30ms.
+            uint32_t ts = i * 3000;
+            for (int j = 1; j < 10; j++) {
+                SrsUniquePtr<SrsRtpPacket> pkt(mock_rtp_video_packet(sn + j, ts, j == 9, SrsAvcNaluTypeNonIDR));
+                jb.on_packet(pkt.get(), now);
+            }
+            EXPECT_FALSE(jb.update(sn, now));
+
+            SrsUniquePtr<SrsRtpPacket> pkt(mock_rtp_video_packet(sn, ts, false, SrsAvcNaluTypeNonIDR));
+            jb.on_packet(pkt.get(), now + 30 * SRS_UTIME_MILLISECONDS);
+            EXPECT_FALSE(jb.update(sn + 10, now + 30 * SRS_UTIME_MILLISECONDS));
+
+            sn += 10;
+            now += 33 * SRS_UTIME_MILLISECONDS;
+        }
+        EXPECT_LT(jb.target_delay(), 200 * SRS_UTIME_MILLISECONDS);
+        EXPECT_GT(jb.target_delay(), 30 * SRS_UTIME_MILLISECONDS);
+        EXPECT_NEAR(0.1, jb.loss_rate(), 0.03);
+        EXPECT_EQ(0, jb.nn_timeout());
+    }
+
+    // Limited by the max delay.
+    if (true) {
+        SrsRtcJitterBuffer jb;
+        jb.set_max_delay(100 * SRS_UTIME_MILLISECONDS);
+        EXPECT_EQ(100 * SRS_UTIME_MILLISECONDS, jb.target_delay());
+    }
+}
+
+class MockRtcFrameBridge : public ISrsStreamBridge
+{
+public:
+    int nn_frames_;
+public:
+    MockRtcFrameBridge() {
+        nn_frames_ = 0;
+    }
+    virtual ~MockRtcFrameBridge() {
+    }
+public:
+    virtual srs_error_t initialize(SrsRequest* r) {
+        return srs_success;
+    }
+    virtual srs_error_t on_publish() {
+        return srs_success;
+    }
+    virtual srs_error_t on_frame(SrsSharedPtrMessage* frame) {
+        nn_frames_++;
+        return srs_success;
+    }
+    virtual void on_unpublish() {
+    }
+};
+
+VOID TEST(KernelRTCTest, FrameBuilderJitterBuffer)
+{
+    srs_error_t err;
+
+    MockRtcFrameBridge bridge;
+    SrsRtcFrameBuilder builder(&bridge);
+
+    // Discard the inter frame before keyframe.
+    if (true) {
+        SrsUniquePtr<SrsRtpPacket> pkt(mock_rtp_video_packet(9, 0, true, SrsAvcNaluTypeNonIDR));
+        HELPER_EXPECT_SUCCESS(builder.packet_video(pkt.get()));
+        EXPECT_EQ(0, bridge.nn_frames_);
+        EXPECT_EQ(1, builder.jitter_->nn_discard());
+    }
+
+    // The keyframe and inter frame.
+    if (true) {
+        SrsUniquePtr<SrsRtpPacket> pkt(mock_rtp_video_packet(10, 3000, true, SrsAvcNaluTypeIDR));
+        HELPER_EXPECT_SUCCESS(builder.packet_video(pkt.get()));
+
+        SrsUniquePtr<SrsRtpPacket> pkt2(mock_rtp_video_packet(11, 6000, true, SrsAvcNaluTypeNonIDR));
+        HELPER_EXPECT_SUCCESS(builder.packet_video(pkt2.get()));
+        EXPECT_EQ(2, bridge.nn_frames_);
+    }
+
+    // The frame is built when lost packet recovered.
+    if (true) {
+        SrsUniquePtr<SrsRtpPacket> pkt(mock_rtp_video_packet(13, 9000, true, SrsAvcNaluTypeNonIDR));
+        HELPER_EXPECT_SUCCESS(builder.packet_video(pkt.get()));
+        EXPECT_EQ(2, bridge.nn_frames_);
+
+        SrsUniquePtr<SrsRtpPacket> pkt2(mock_rtp_video_packet(12, 9000, false, SrsAvcNaluTypeNonIDR));
+        HELPER_EXPECT_SUCCESS(builder.packet_video(pkt2.get()));
+        EXPECT_EQ(3, bridge.nn_frames_);
+    }
+
+    // Ignore the late packet.
+    if (true) {
+        SrsUniquePtr<SrsRtpPacket> pkt(mock_rtp_video_packet(12, 9000, false, SrsAvcNaluTypeNonIDR));
+        HELPER_EXPECT_SUCCESS(builder.packet_video(pkt.get()));
+        EXPECT_EQ(3, bridge.nn_frames_);
+        EXPECT_EQ(1, builder.jitter_->nn_late());
+    }
+
+    // Discard the inter frames until keyframe, when skip for timeout.
+    if (true) {
+        SrsUniquePtr<SrsRtpPacket> pkt(mock_rtp_video_packet(16, 15000, true, SrsAvcNaluTypeNonIDR));
+        HELPER_EXPECT_SUCCESS(builder.packet_video(pkt.get()));
+
+        builder.skip_to_keyframe();
+        EXPECT_TRUE(builder.fetch_keyframe_request());
+        EXPECT_FALSE(builder.fetch_keyframe_request());
+        EXPECT_EQ(2, builder.jitter_->nn_discard());
+
+        SrsUniquePtr<SrsRtpPacket> pkt2(mock_rtp_video_packet(17, 18000, true, SrsAvcNaluTypeNonIDR));
+        HELPER_EXPECT_SUCCESS(builder.packet_video(pkt2.get()));
+        EXPECT_EQ(3, builder.jitter_->nn_discard());
+        EXPECT_EQ(3, bridge.nn_frames_);
+
+        SrsUniquePtr<SrsRtpPacket> pkt3(mock_rtp_video_packet(18, 21000, true, SrsAvcNaluTypeIDR));
+        HELPER_EXPECT_SUCCESS(builder.packet_video(pkt3.get()));
+        SrsUniquePtr<SrsRtpPacket> pkt4(mock_rtp_video_packet(19, 24000, true, SrsAvcNaluTypeNonIDR));
+        HELPER_EXPECT_SUCCESS(builder.packet_video(pkt4.get()));
+        EXPECT_EQ(5, bridge.nn_frames_);
+    }
+}
+
+VOID TEST(KernelRTCTest, FlexFecEncoder)
+{
+    srs_error_t err;
+
+    SrsRtcFecEncoder fec(0x1234, 0x5678, 118);
+
+    // No FEC if no loss.
+    if (true) {
+        fec.on_feedback(0);
+        EXPECT_EQ(0, fec.ratio());
+
+        std::vector<SrsRtpPacket*> fecs;
+        SrsUniquePtr<SrsRtpPacket> pkt(mock_rtp_video_packet(100, 9000, true, SrsAvcNaluTypeNonIDR));
+        HELPER_EXPECT_SUCCESS(fec.on_packet(pkt.get(), fecs));
+        EXPECT_TRUE(fecs.empty());
+    }
+
+    // The ratio is limited for heavy loss.
+    for (int i = 0; i < 10; i++) {
+        fec.on_feedback(0.2);
+    }
+    EXPECT_NEAR(0.5, fec.ratio(), 0.01);
+
+    // A frame of 10 packets, with different size of payload.
+    char payloads[10][64];
+    char packets[10][kRtpPacketSize];
+    int sizes[10];
+    std::vector<SrsRtpPacket*> fecs;
+    for (int i = 0; i < 10; i++) {
+        memset(payloads[i], 'a' + i, sizeof(payloads[i]));
+
+        SrsUniquePtr<SrsRtpPacket> pkt(mock_rtp_video_packet(200 + i, 9000, i == 9, SrsAvcNaluTypeNonIDR));
+        SrsRtpRawPayload* raw = dynamic_cast<SrsRtpRawPayload*>(pkt->payload());
+        raw->payload = payloads[i];
+        raw->nn_payload = 10 + i * 5;
+
+        SrsBuffer buf(packets[i], kRtpPacketSize);
+        HELPER_EXPECT_SUCCESS(pkt->encode(&buf));
+        sizes[i] = buf.pos();
+
+        HELPER_EXPECT_SUCCESS(fec.on_packet(pkt.get(), fecs));
+        EXPECT_EQ(i == 9 ? 5 : 0, (int)fecs.size());
+    }
+
+    // The first FEC packet protects the packet 0 and 5.
+    SrsRtpPacket* p = fecs.at(0);
+    EXPECT_EQ((uint32_t)0x5678, p->header.get_ssrc());
+    EXPECT_EQ(118, p->header.get_payload_type());
+    EXPECT_EQ((uint16_t)(p->header.get_sequence() + 1), fecs.at(1)->header.get_sequence());
+
+    SrsRtpRawPayload* raw = dynamic_cast<SrsRtpRawPayload*>(p->payload());
+    EXPECT_EQ(SRS_RTC_FLEXFEC_HEADER_SIZE + sizes[5] - kRtpHeaderFixedSize, raw->nn_payload);
+
+    SrsBuffer header(raw->payload, SRS_RTC_FLEXFEC_HEADER_SIZE);
+    EXPECT_EQ(0, header.read_1bytes() & 0xc0);
+    header.skip(7);
+    EXPECT_EQ(1, header.read_1bytes());
+    header.skip(3);
+    EXPECT_EQ((uint32_t)0x1234, (uint32_t)header.read_4bytes());
+    EXPECT_EQ(200, header.read_2bytes());
+    EXPECT_EQ(0x8000 | (1 << 14) | (1 << 9), (uint16_t)header.read_2bytes());
+
+    // Recover the packet 5 by packet 0.
+    char* r = raw->payload;
+    EXPECT_EQ(packets[5][1], (char)(r[1] ^ packets[0][1]));
+    int nn_payload = (((uint8_t)r[2] << 8) | (uint8_t)r[3]) ^ (sizes[0] - kRtpHeaderFixedSize);
+    EXPECT_EQ(sizes[5] - kRtpHeaderFixedSize, nn_payload);
+    for (int j = 0; j < nn_payload; j++) {
+        char v = r[SRS_RTC_FLEXFEC_HEADER_SIZE + j];
+        if (j < sizes[0] - kRtpHeaderFixedSize) {
+            v ^= packets[0][kRtpHeaderFixedSize + j];
+        }
+        EXPECT_EQ(packets[5][kRtpHeaderFixedSize + j], v);
+    }
+
+    for (int i = 0; i < (int)fecs.size(); i++) {
+        srs_freep(fecs[i]);
+    }
+}
+
+#ifdef SRS_FFMPEG_FIT
+VOID TEST(KernelRTCTest, AsyncAudioTranscoder)
+{
+    srs_error_t err;
+
+    SrsRequest req;
+    req.vhost = "__defaultVhost__";
+    req.app = "live";
+    req.stream = "transcode";
+
+    // The Opus packet with only TOC, CELT FB 20ms stereo, decoded as 20ms silence.
+    char opus[] = {(char)0xfc};
+
+    // Transcode in worker thread, the output frames are got by following calls.
+    if (true) {
+        SrsAsyncAudioTranscoder codec;
+        HELPER_EXPECT_SUCCESS(codec.initialize(&req, SrsAudioCodecIdOpus, SrsAudioCodecIdAAC, 2, 48000, 48000));
+        EXPECT_TRUE(codec.admitted_);
+        EXPECT_TRUE(codec.task_ != NULL);
+
+        std::vector<SrsAudioFrame*> outs;
+        for (int i = 0; i < 50; i++) {
+            SrsAudioFrame frame;
+            frame.add_sample(opus, sizeof(opus));
+            frame.dts = 1000 + i * 20;
+            HELPER_EXPECT_SUCCESS(codec.transcode(&frame, outs));
+        }
+
+        // Wait for worker to transcode all frames, about 50*960/1024 AAC frames.
+        for (int i = 0; i < 100 && codec.nn_frames() < 45; i++) {
+            srs_usleep(10 * SRS_UTIME_MILLISECONDS);
+        }
+
+        SrsAudioFrame empty;
+        HELPER_EXPECT_SUCCESS(codec.transcode(&empty, outs));
+        EXPECT_GE((int)outs.size(), 45);
+        EXPECT_EQ(codec.nn_frames(), (int64_t)outs.size());
+        EXPECT_GT(codec.cpu(), 0);
+
+        // The frames are in order.
+        for (int i = 1; i < (int)outs.size(); i++) {
+            EXPECT_LT(outs.at(i - 1)->dts, outs.at(i)->dts);
+        }
+        codec.free_frames(outs);
+    }
+
+    // Drop the audio if exceed the max transcoders.
+    if (true) {
+        SrsSetEnvConfig(max_transcoders, "SRS_THREADS_MAX_TRANSCODERS", "1");
+
+        SrsAsyncAudioTranscoder codec;
+        HELPER_EXPECT_SUCCESS(codec.initialize(&req, SrsAudioCodecIdOpus, SrsAudioCodecIdAAC, 2, 48000, 48000));
+        EXPECT_TRUE(codec.admitted_);
+
+        SrsAsyncAudioTranscoder codec2;
+        HELPER_EXPECT_SUCCESS(codec2.initialize(&req, SrsAudioCodecIdOpus, SrsAudioCodecIdAAC, 2, 48000, 48000));
+        EXPECT_FALSE(codec2.admitted_);
+
+        std::vector<SrsAudioFrame*> outs;
+        SrsAudioFrame frame;
+        frame.add_sample(opus, sizeof(opus));
+        HELPER_EXPECT_SUCCESS(codec2.transcode(&frame, outs));
+        EXPECT_TRUE(outs.empty());
+        EXPECT_EQ(1, codec2.nn_drops_);
+    }
+}
+#endif
@@ -23,6 +23,7 @@ using namespace std;
 #include <srs_protocol_http_client.hpp>
 #include <srs_protocol_rtmp_conn.hpp>
 #include <srs_protocol_conn.hpp>
+#include <srs_kernel_flv.hpp>
 #include <sys/socket.h>
 #include <netdb.h>
 #include <st.h>
@@ -474,6 +475,102 @@ VOID TEST(TCPServerTest, WritevIOVC)
 	}
 }
 
+VOID TEST(TCPServerTest, WritevZerocopy)
+{
+	srs_error_t err;
+
+	if (true) {
+		MockTcpHandler h;
+        SrsTcpListener l(&h);
+        l.set_endpoint(_srs_tmp_host, _srs_tmp_port);
+		HELPER_EXPECT_SUCCESS(l.listen());
+
+		SrsTcpClient c(_srs_tmp_host, _srs_tmp_port, _srs_tmp_timeout);
+		HELPER_EXPECT_SUCCESS(c.connect());
+
+		srs_usleep(30 * SRS_UTIME_MILLISECONDS);
+#ifdef SRS_OSX
+		ASSERT_TRUE(h.fd != NULL);
+#endif
+        SrsStSocket skt(h.fd);
+
+        // Ignore if kernel does not support MSG_ZEROCOPY.
+        if ((err = skt.enable_zerocopy(1024)) != srs_success) {
+            srs_freep(err);
+            return;
+        }
+        SrsZerocopySender* zc = skt.zerocopy();
+        ASSERT_TRUE(zc != NULL);
+
+        char* payload = new char[65536];
+        memset(payload, 'x', 65536);
+        SrsSharedPtrMessage* msg = new SrsSharedPtrMessage();
+        HELPER_EXPECT_SUCCESS(msg->create(NULL, payload, 65536));
+
+        char header[4] = {'H', 'D', 'R', 0};
+		iovec iovs[2];
+		iovs[0].iov_base = (void*)header;
+		iovs[0].iov_len = 3;
+		iovs[1].iov_base = (void*)msg->payload;
+		iovs[1].iov_len = msg->size;
+
+        // Small write is copied, even though the message is pinned.
+        zc->pin(&msg, 1);
+		HELPER_EXPECT_SUCCESS(skt.writev(iovs, 1, NULL));
+        zc->unpin();
+        EXPECT_EQ(0, zc->zerocopy_bytes());
+        EXPECT_EQ(0, zc->pinned_bytes());
+
+        // The header is copied, so it's ok to reuse it after writing.
+        zc->pin(&msg, 1);
+		HELPER_EXPECT_SUCCESS(skt.writev(iovs, 2, NULL));
+        zc->unpin();
+        srs_freep(msg);
+        memcpy(header, "XXX", 3);
+        EXPECT_EQ(65539, zc->zerocopy_bytes());
+        EXPECT_EQ(65539, zc->pinned_bytes());
+
+        SrsUniquePtr<char[]> buf(new char[65542]);
+		HELPER_EXPECT_SUCCESS(c.read_fully(buf.get(), 65542, NULL));
+        EXPECT_EQ(0, memcmp(buf.get(), "HDRHDR", 6));
+        EXPECT_EQ('x', buf.get()[6]);
+        EXPECT_EQ('x', buf.get()[65541]);
+
+        // Unpin the messages when kernel notifies, it's copied over loopback.
+        for (int i = 0; i < 100 && zc->pinned_bytes(); i++) {
+            srs_usleep(1 * SRS_UTIME_MILLISECONDS);
+            zc->reap();
+        }
+        EXPECT_EQ(0, zc->pinned_bytes());
+
+        // Reap between two writes of the same pinned messages, the completion of first write is never lost.
+        msg = new SrsSharedPtrMessage();
+        HELPER_EXPECT_SUCCESS(msg->create(NULL, new char[65536], 65536));
+        memset(msg->payload, 'y', 65536);
+        iovs[1].iov_base = (void*)msg->payload;
+
+        zc->pin(&msg, 1);
+        srs_freep(msg);
+        for (int i = 0; i < 2; i++) {
+            EXPECT_EQ(65539, zc->writev(iovs, 2, SRS_UTIME_NO_TIMEOUT));
+            HELPER_EXPECT_SUCCESS(c.read_fully(buf.get(), 65539, NULL));
+            EXPECT_EQ('y', buf.get()[65538]);
+
+            for (int j = 0; j < 10; j++) {
+                srs_usleep(1 * SRS_UTIME_MILLISECONDS);
+                zc->reap();
+            }
+        }
+        zc->unpin();
+
+        for (int i = 0; i < 100 && zc->pinned_bytes(); i++) {
+            srs_usleep(1 * SRS_UTIME_MILLISECONDS);
+            zc->reap();
+        }
+        EXPECT_EQ(0, zc->pinned_bytes());
+	}
+}
+
 VOID TEST(HTTPServerTest, MessageConnection)
 {
     srs_error_t err;